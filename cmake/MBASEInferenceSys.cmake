@@ -3,6 +3,7 @@ include_guard(GLOBAL)
 include(MBASECommonConfig)
 include(MBASEStdSys)
 include(MBASECoreSys)
+include(MBASEJsonSys)
 
 set(MBASE_INFERENCE_SYS_STRING "MBASE Inference")
 set(MBASE_INFERENCE_LIB_NAME "inference")
@@ -20,11 +21,13 @@ message("${MBASE_INFERENCE_SYS_STRING} lib source path: ${MBASE_INFERENCE_LIB_PA
 list(APPEND MBASE_INFERENCE_INCLUDE_DEPENDS
     ${MBASE_STD_INCLUDES}
     ${MBASE_CORE_INCLUDE_DEPENDS}
+    ${MBASE_JSON_INCLUDE_DEPENDS}
 )
 
 list(APPEND MBASE_INFERENCE_LIB_DEPENDS
     ${MBASE_STD_LIBS}
     mb_pc
+    mb_json
 )
 
 if(MBASE_FORCE_BUNDLE STREQUAL "ON")
@@ -64,7 +67,11 @@ list(APPEND MBASE_INFERENCE_INCLUDE_STABLE_FILES
     inf_device_desc.h
     inf_embedder_client.h
     inf_embedder.h
+    inf_fused_sampler.h
     inf_gguf_metadata_configurator.h
+    inf_grammar.h
+    inf_histogram.h
+    inf_jinja.h
     inf_maip_callbacks.h
     inf_maip_model_description.h
     inf_maip_peer_base.h
@@ -79,6 +86,7 @@ list(APPEND MBASE_INFERENCE_INCLUDE_STABLE_FILES
     inf_t2t_model.h
     inf_t2t_proc_diagnostics.h
     inf_t2t_processor.h
+    inf_vector_store.h
 )
 
 add_library(mb_inference
@@ -86,7 +94,11 @@ add_library(mb_inference
     ${MBASE_INFERENCE_LIB_PATH}/inf_device_desc.cpp
     ${MBASE_INFERENCE_LIB_PATH}/inf_common.cpp
     ${MBASE_INFERENCE_LIB_PATH}/inf_embedder.cpp
+    ${MBASE_INFERENCE_LIB_PATH}/inf_fused_sampler.cpp
     ${MBASE_INFERENCE_LIB_PATH}/inf_gguf_meta_configurator.cpp
+    ${MBASE_INFERENCE_LIB_PATH}/inf_grammar.cpp
+    ${MBASE_INFERENCE_LIB_PATH}/inf_histogram.cpp
+    ${MBASE_INFERENCE_LIB_PATH}/inf_jinja.cpp
     ${MBASE_INFERENCE_LIB_PATH}/inf_maip_callbacks.cpp
     ${MBASE_INFERENCE_LIB_PATH}/inf_maip_model_description.cpp
     ${MBASE_INFERENCE_LIB_PATH}/inf_maip_peer_base.cpp
@@ -100,6 +112,7 @@ add_library(mb_inference
     ${MBASE_INFERENCE_LIB_PATH}/inf_t2t_model.cpp
     ${MBASE_INFERENCE_LIB_PATH}/inf_t2t_processor.cpp
     ${MBASE_INFERENCE_LIB_PATH}/inf_t2t_proc_diagnostics.cpp
+    ${MBASE_INFERENCE_LIB_PATH}/inf_vector_store.cpp
 )
 
 target_compile_definitions(mb_inference PRIVATE ${MBASE_COMMON_COMPILE_DEFINITIONS} llama)
@@ -46,6 +46,7 @@ list(APPEND MBASE_STD_INCLUDE_STABLE_FILES
     maip_client.h
     maip_parser.h
     map.h
+    mapped_file.h
     mbase_std.h
     node_type.h
     platform.h
@@ -1,11 +1,20 @@
 #include <mbase/inference/inf_t2t_model.h>
 #include <mbase/inference/inf_t2t_processor.h>
 #include <mbase/inference/inf_t2t_client.h>
+#include <mbase/inference/inf_histogram.h>
+#include <mbase/inference/inf_fused_sampler.h>
 #include <mbase/argument_get_value.h>
 #include <mbase/filesystem.h>
 #include <mbase/json/json.h>
+#include <cpp-httplib/httplib.h>
 #include <math.h>
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <random>
+#include <thread>
 #include <signal.h>
 
 #define MBASE_BENCHMARK_VERSION "v1.0.0"
@@ -15,6 +24,7 @@ using namespace mbase;
 class BenchmarkModel;
 class BenchmarkProcessor;
 class BenchmarkClient;
+class LoadClient;
 
 struct program_parameters {
     mbase::string mModelFile;
@@ -30,11 +40,55 @@ struct program_parameters {
     I32 mFps = 500;
     I32 mUserCount = 1;
     bool mFlashAttention = true;
+
+    // Load generator mode
+    mbase::string mEndpoint; // openai server to drive instead of loading the model in process
+    mbase::string mApiKey;
+    F32 mRequestRate = 1.0f; // mean arrivals per second
+    F32 mPromptCv = 0.5f; // coefficient of variation of the prompt length, 0 means fixed
+    F32 mPredictCv = 0.5f;
+    I32 mRequestCount = 32;
+    I32 mSloTtftMs = 2000;
+    I32 mSloItlMs = 200;
+    U32 mSeed = 1;
+    bool mLoadGenerator = false;
+
+    // Sampler benchmark mode
+    I32 mSamplerVocab = 152064;
+    bool mSamplerBenchmark = false;
+};
+
+struct load_request {
+    using time_point = std::chrono::steady_clock::time_point;
+    U32 mPromptLength = 0;
+    U32 mOutputLength = 0;
+    U32 mGeneratedTokens = 0;
+    F64 mArrivalOffset = 0.0; // seconds after the load start
+    bool mFailed = false;
+    time_point mArrivalTime;
+    time_point mStartTime; // processor acquired or request sent
+    time_point mFirstTokenTime;
+    time_point mLastTokenTime;
+    time_point mEndTime;
+};
+
+struct load_state {
+    mbase::vector<load_request> mRequests;
+    std::deque<U32> mPendingRequests;
+    std::chrono::steady_clock::time_point mBeginTime;
+    std::atomic<U32> mCompletedRequests{0};
+    U32 mNextArrival = 0;
+    F32 mElapsedSeconds = 0.0f;
+    InfHistogram mTtft; // arrival to first token, microseconds
+    InfHistogram mItl;
+    InfHistogram mQueueDelay; // arrival to processor acquisition or dispatch
+    InfHistogram mEndToEnd;
 };
 
 mbase::vector<InfDeviceDescription> deviceDescription;
 program_parameters gSampleParams;
-bool gIsProgramRunning = true;
+load_state gLoadState;
+std::atomic<bool> gIsProgramRunning{true};
 I32 gFinishedProcessors = 0;
 
 GENERIC catching_interrupt_signal(I32 out_sig_id);
@@ -69,6 +123,9 @@ GENERIC print_usage()
     printf("Usage: mbase_benchmark_t2t <model_path> *[<option> [<value>]]\n");
     printf("       mbase_benchmark_t2t model.gguf -uc 1 -fps 500 -jout .\n");
     printf("       mbase_benchmark_t2t model.gguf -uc 1 -fps 500 -jout . -mdout .\n");
+    printf("       mbase_benchmark_t2t model.gguf -lg -uc 4 -rps 2 -rc 64 -jout .\n");
+    printf("       mbase_benchmark_t2t <served_model_name> -lg -ep http://127.0.0.1:8080 -uc 16 -rps 2 -rc 64\n");
+    printf("       mbase_benchmark_t2t -sb 152064 -np 512\n");
     printf("Options: \n\n");
     printf("-h, --help                           Print usage.\n");
     printf("-v, --version                        Shows program version.\n");
@@ -83,7 +140,18 @@ GENERIC print_usage()
     printf("-uc, --user-count <int>              Number of users that will be processed in parallel. (default=1)\n");
     printf("-fps, --frame-per-second <int>       Max FPS of the main loop. This is for measuring the effects of inference engine on main application loop(default=500, min=10, max=1000).\n");
     printf("-jout, --json-output-path <str>      If the json output path is specified, result will be written there in file(mbase_bench.json) (default='').\n");
-    printf("-mdout, --markdown-output-path <str> If the markdown output path is specified, result will be written there in file(mbase_bench.md) (default='').\n\n");
+    printf("-mdout, --markdown-output-path <str> If the markdown output path is specified, result will be written there in file(mbase_bench.md) (default='').\n");
+    printf("-lg, --load-generator                Load generator mode. Requests arrive as a poisson process and are served by -uc users (default=off).\n");
+    printf("-rps, --request-rate <float>         Mean request arrivals per second in load generator mode (default=1.0).\n");
+    printf("-rc, --request-count <int>           Number of requests to send in load generator mode (default=32).\n");
+    printf("-prcv, --prompt-cv <float>           Coefficient of variation of the log-normal prompt length around -pr, 0 is fixed (default=0.5).\n");
+    printf("-npcv, --n-predict-cv <float>        Coefficient of variation of the log-normal output length around -np, 0 is fixed (default=0.5).\n");
+    printf("-slottft, --slo-ttft <int>           Time to first token SLO in milliseconds, used for goodput (default=2000).\n");
+    printf("-sloitl, --slo-itl <int>             Mean inter-token latency SLO in milliseconds, used for goodput (default=200).\n");
+    printf("-seed, --seed <int>                  Seed of the arrival and length distributions (default=1).\n");
+    printf("-ep, --endpoint <str>                Drive an openai server (e.g http://127.0.0.1:8080) instead of loading the model. The first argument is then the served model name.\n");
+    printf("--api-key <str>                      API key of the openai server.\n");
+    printf("-sb, --sampler-benchmark <int>       Measure the per-token sampling cost on synthetic logits of the given vocabulary size, no model is loaded. -np sets the token count (default=152064).\n\n");
 }
 
 class BenchmarkModel : public InfModelTextToText {
@@ -122,6 +190,8 @@ public:
         --mNPredict;
     }
     I32 get_predict_count(){ return mNPredict; }
+    load_request* get_load_request(){ return mLoadRequest; }
+    GENERIC set_load_request(load_request* in_request){ mLoadRequest = in_request; }
     F32 get_average_eval_per_second()
     {
         F32 totalEvalSeconds = 0;
@@ -134,6 +204,7 @@ public:
 private:
     mbase::vector<F32> tokensSet;
     I32 mNPredict = 0;
+    load_request* mLoadRequest = NULL;
 };
 
 class BenchmarkClient : public InfClientTextToText {
@@ -185,6 +256,526 @@ public:
 private:
 };
 
+GENERIC generate_load_schedule()
+{
+    std::mt19937_64 randomEngine(gSampleParams.mSeed);
+    std::exponential_distribution<F64> arrivalDistribution(gSampleParams.mRequestRate);
+
+    // log-normal with the given mean and coefficient of variation
+    auto lengthDistribution = [](F32 in_mean, F32 in_cv) {
+        F64 sigmaSquared = log(1.0 + (F64)in_cv * in_cv);
+        return std::lognormal_distribution<F64>(log((F64)in_mean) - sigmaSquared / 2, sqrt(sigmaSquared));
+    };
+    std::lognormal_distribution<F64> promptDistribution = lengthDistribution(gSampleParams.mPromptLength, gSampleParams.mPromptCv);
+    std::lognormal_distribution<F64> predictDistribution = lengthDistribution(gSampleParams.mPredictCount, gSampleParams.mPredictCv);
+
+    F64 arrivalOffset = 0.0;
+    for(I32 i = 0; i < gSampleParams.mRequestCount; i++)
+    {
+        load_request newRequest;
+        arrivalOffset += arrivalDistribution(randomEngine);
+        newRequest.mArrivalOffset = arrivalOffset;
+
+        I64 promptLength = gSampleParams.mPromptCv > 0 ? llround(promptDistribution(randomEngine)) : gSampleParams.mPromptLength;
+        I64 outputLength = gSampleParams.mPredictCv > 0 ? llround(predictDistribution(randomEngine)) : gSampleParams.mPredictCount;
+
+        // prompt and output must fit into the context together
+        promptLength = std::max<I64>(1, std::min<I64>(promptLength, gSampleParams.mContextLength - 2));
+        outputLength = std::max<I64>(1, std::min<I64>(outputLength, gSampleParams.mContextLength - 1 - promptLength));
+        newRequest.mPromptLength = static_cast<U32>(promptLength);
+        newRequest.mOutputLength = static_cast<U32>(outputLength);
+        gLoadState.mRequests.push_back(newRequest);
+    }
+}
+
+GENERIC complete_load_request(load_request& in_request)
+{
+    in_request.mEndTime = std::chrono::steady_clock::now();
+    if(!in_request.mFailed && in_request.mGeneratedTokens)
+    {
+        gLoadState.mTtft.record(std::chrono::duration_cast<std::chrono::microseconds>(in_request.mFirstTokenTime - in_request.mArrivalTime).count());
+        gLoadState.mEndToEnd.record(std::chrono::duration_cast<std::chrono::microseconds>(in_request.mEndTime - in_request.mArrivalTime).count());
+    }
+
+    if(++gLoadState.mCompletedRequests == gLoadState.mRequests.size())
+    {
+        gIsProgramRunning = false;
+    }
+}
+
+GENERIC record_load_token(load_request& in_request)
+{
+    std::chrono::steady_clock::time_point tokenTime = std::chrono::steady_clock::now();
+    if(!in_request.mGeneratedTokens)
+    {
+        in_request.mFirstTokenTime = tokenTime;
+    }
+    else
+    {
+        gLoadState.mItl.record(std::chrono::duration_cast<std::chrono::microseconds>(tokenTime - in_request.mLastTokenTime).count());
+    }
+    in_request.mLastTokenTime = tokenTime;
+    ++in_request.mGeneratedTokens;
+}
+
+GENERIC dispatch_load_arrivals(mbase::vector<BenchmarkProcessor*>& in_processors)
+{
+    std::chrono::steady_clock::time_point currentTime = std::chrono::steady_clock::now();
+    F64 elapsedSeconds = std::chrono::duration<F64>(currentTime - gLoadState.mBeginTime).count();
+    while(gLoadState.mNextArrival < gLoadState.mRequests.size() && gLoadState.mRequests[gLoadState.mNextArrival].mArrivalOffset <= elapsedSeconds)
+    {
+        load_request& arrivedRequest = gLoadState.mRequests[gLoadState.mNextArrival];
+        arrivedRequest.mArrivalTime = gLoadState.mBeginTime + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<F64>(arrivedRequest.mArrivalOffset));
+        gLoadState.mPendingRequests.push_back(gLoadState.mNextArrival++);
+    }
+
+    for(BenchmarkProcessor* tmpProc : in_processors)
+    {
+        if(!gLoadState.mPendingRequests.size())
+        {
+            break;
+        }
+
+        if(tmpProc->get_load_request() || !tmpProc->is_available())
+        {
+            continue;
+        }
+
+        load_request& nextRequest = gLoadState.mRequests[gLoadState.mPendingRequests.front()];
+        gLoadState.mPendingRequests.pop_front();
+        nextRequest.mStartTime = currentTime;
+        gLoadState.mQueueDelay.record(std::chrono::duration_cast<std::chrono::microseconds>(currentTime - nextRequest.mArrivalTime).count());
+
+        tmpProc->set_load_request(&nextRequest);
+        mbase::inf_text_token_vector tokVec(nextRequest.mPromptLength, 1);
+        if(tmpProc->execute_input(tokVec) != BenchmarkProcessor::flags::INF_PROC_SUCCESS)
+        {
+            nextRequest.mFailed = true;
+            tmpProc->set_load_request(NULL);
+            complete_load_request(nextRequest);
+        }
+    }
+}
+
+class LoadClient : public InfClientTextToText {
+public:
+    GENERIC on_register([[maybe_unused]] InfProcessorBase* out_processor) override
+    {
+    }
+
+    GENERIC on_unregister([[maybe_unused]] InfProcessorBase* out_processor) override
+    {
+    }
+
+    GENERIC on_batch_processed(InfProcessorTextToText* out_processor, [[maybe_unused]] const U32& out_proc_batch_length, [[maybe_unused]] const bool& out_is_kv_locked) override
+    {
+        mbase::decode_behavior_description dbd;
+        dbd.mTokenAtMost = 1;
+        dbd.mHaltOnWrite = false;
+        out_processor->next(dbd);
+    }
+
+    GENERIC on_write(InfProcessorTextToText* out_processor, [[maybe_unused]] const inf_text_token_vector& out_token, bool out_is_finish) override
+    {
+        BenchmarkProcessor* hostProcessor = static_cast<BenchmarkProcessor*>(out_processor);
+        load_request* activeRequest = hostProcessor->get_load_request();
+        if(!activeRequest)
+        {
+            return;
+        }
+
+        record_load_token(*activeRequest);
+        if(out_is_finish || activeRequest->mGeneratedTokens >= activeRequest->mOutputLength)
+        {
+            // the processor is picked up by dispatch_load_arrivals on the next frame
+            hostProcessor->set_load_request(NULL);
+            complete_load_request(*activeRequest);
+            return;
+        }
+
+        mbase::decode_behavior_description dbd;
+        dbd.mTokenAtMost = 1;
+        dbd.mHaltOnWrite = false;
+        hostProcessor->next(dbd);
+    }
+
+    GENERIC on_finish([[maybe_unused]] InfProcessorTextToText* out_processor, [[maybe_unused]] size_type out_total_token_size, [[maybe_unused]] InfProcessorTextToText::finish_state out_finish_state) override
+    {
+    }
+};
+
+GENERIC send_endpoint_request(httplib::Client& in_client, load_request& in_request)
+{
+    mbase::string promptString;
+    for(U32 i = 0; i < in_request.mPromptLength; i++)
+    {
+        promptString += "hello ";
+    }
+
+    mbase::Json requestJson;
+    requestJson["model"] = gSampleParams.mModelFile;
+    requestJson["messages"][0]["role"] = "user";
+    requestJson["messages"][0]["content"] = promptString;
+    requestJson["max_tokens"] = in_request.mOutputLength;
+    requestJson["stream"] = true;
+    mbase::string requestBody = requestJson.toString();
+
+    httplib::Request httpRequest;
+    httpRequest.method = "POST";
+    httpRequest.path = "/v1/chat/completions";
+    httpRequest.body = std::string(requestBody.c_str(), requestBody.size());
+    httpRequest.set_header("Content-Type", "application/json");
+    if(gSampleParams.mApiKey.size())
+    {
+        httpRequest.set_header("Authorization", std::string("Bearer ") + gSampleParams.mApiKey.c_str());
+    }
+
+    // every "data: " event of the stream carries one generated token
+    std::string eventBuffer;
+    httpRequest.content_receiver = [&](const char* in_data, size_t in_length, uint64_t, uint64_t) {
+        eventBuffer.append(in_data, in_length);
+        size_t lineEnd = 0;
+        while((lineEnd = eventBuffer.find('\n')) != std::string::npos)
+        {
+            if(!eventBuffer.compare(0, 6, "data: ") && eventBuffer.compare(0, 12, "data: [DONE]"))
+            {
+                record_load_token(in_request);
+            }
+            eventBuffer.erase(0, lineEnd + 1);
+        }
+        return true;
+    };
+
+    in_request.mStartTime = std::chrono::steady_clock::now();
+    httplib::Result httpResult = in_client.send(httpRequest);
+    if(!httpResult || httpResult->status != 200)
+    {
+        in_request.mFailed = true;
+    }
+}
+
+I32 run_endpoint_load()
+{
+    std::mutex pendingMutex;
+    std::condition_variable pendingCondition;
+    bool arrivalsFinished = false;
+
+    // every user is a thread with its own connection, arrivals wait in the pending queue until a user is free
+    mbase::vector<std::thread*> userThreads;
+    for(I32 i = 0; i < gSampleParams.mUserCount; i++)
+    {
+        userThreads.push_back(new std::thread([&]() {
+            httplib::Client httpClient(gSampleParams.mEndpoint.c_str());
+            httpClient.set_read_timeout(600);
+            while(true)
+            {
+                U32 requestIndex = 0;
+                {
+                    std::unique_lock<std::mutex> pendingLock(pendingMutex);
+                    pendingCondition.wait(pendingLock, [&]{ return gLoadState.mPendingRequests.size() || arrivalsFinished || !gIsProgramRunning; });
+                    if(!gLoadState.mPendingRequests.size() || !gIsProgramRunning)
+                    {
+                        return;
+                    }
+                    requestIndex = gLoadState.mPendingRequests.front();
+                    gLoadState.mPendingRequests.pop_front();
+                }
+
+                load_request& activeRequest = gLoadState.mRequests[requestIndex];
+                gLoadState.mQueueDelay.record(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - activeRequest.mArrivalTime).count());
+                send_endpoint_request(httpClient, activeRequest);
+                complete_load_request(activeRequest);
+            }
+        }));
+    }
+
+    for(load_request& tmpRequest : gLoadState.mRequests)
+    {
+        std::chrono::steady_clock::time_point arrivalTime = gLoadState.mBeginTime + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<F64>(tmpRequest.mArrivalOffset));
+        // sleep in slices, an interrupt must not wait for a far arrival
+        while(gIsProgramRunning && std::chrono::steady_clock::now() < arrivalTime)
+        {
+            std::this_thread::sleep_until(std::min(arrivalTime, std::chrono::steady_clock::now() + std::chrono::milliseconds(20)));
+        }
+        if(!gIsProgramRunning)
+        {
+            break;
+        }
+
+        std::lock_guard<std::mutex> pendingLock(pendingMutex);
+        tmpRequest.mArrivalTime = arrivalTime;
+        gLoadState.mPendingRequests.push_back(static_cast<U32>(&tmpRequest - gLoadState.mRequests.data()));
+        pendingCondition.notify_one();
+    }
+
+    {
+        // also wakes the idle users if the program is stopped, the signal handler can't notify them
+        std::lock_guard<std::mutex> pendingLock(pendingMutex);
+        arrivalsFinished = true;
+        pendingCondition.notify_all();
+    }
+
+    for(std::thread* tmpThread : userThreads)
+    {
+        tmpThread->join();
+        delete tmpThread;
+    }
+    return 0;
+}
+
+GENERIC build_load_report(mbase::Json& out_json, mbase::string& out_markdown)
+{
+    U32 completedCount = 0;
+    U32 failedCount = 0;
+    U32 goodCount = 0;
+    U64 generatedTokens = 0;
+    for(load_request& tmpRequest : gLoadState.mRequests)
+    {
+        if(tmpRequest.mFailed)
+        {
+            ++failedCount;
+            continue;
+        }
+
+        if(!tmpRequest.mGeneratedTokens)
+        {
+            // not dispatched before the run was interrupted
+            continue;
+        }
+
+        ++completedCount;
+        generatedTokens += tmpRequest.mGeneratedTokens;
+        F64 ttftMs = std::chrono::duration<F64, std::milli>(tmpRequest.mFirstTokenTime - tmpRequest.mArrivalTime).count();
+        F64 meanItlMs = 0.0;
+        if(tmpRequest.mGeneratedTokens > 1)
+        {
+            meanItlMs = std::chrono::duration<F64, std::milli>(tmpRequest.mLastTokenTime - tmpRequest.mFirstTokenTime).count() / (tmpRequest.mGeneratedTokens - 1);
+        }
+
+        if(ttftMs <= gSampleParams.mSloTtftMs && meanItlMs <= gSampleParams.mSloItlMs)
+        {
+            ++goodCount;
+        }
+    }
+
+    F32 elapsedSeconds = gLoadState.mElapsedSeconds > 0 ? gLoadState.mElapsedSeconds : 1.0f;
+    F32 goodput = goodCount / elapsedSeconds;
+    F32 throughput = completedCount / elapsedSeconds;
+    F32 sloAttainment = completedCount ? goodCount / (F32)completedCount : 0.0f;
+
+    struct latency_row {
+        MSTRING mName;
+        const InfHistogram* mHistogram;
+    };
+    const latency_row latencyRows[] = {
+        {"ttft", &gLoadState.mTtft},
+        {"itl", &gLoadState.mItl},
+        {"queue_delay", &gLoadState.mQueueDelay},
+        {"end_to_end", &gLoadState.mEndToEnd}
+    };
+
+    out_json["request_rate"] = gSampleParams.mRequestRate;
+    out_json["request_count"] = gSampleParams.mRequestCount;
+    out_json["completed_requests"] = completedCount;
+    out_json["failed_requests"] = failedCount;
+    out_json["generated_tokens"] = generatedTokens;
+    out_json["elapsed_seconds"] = elapsedSeconds;
+    out_json["throughput_rps"] = throughput;
+    out_json["output_tokens_per_sec"] = generatedTokens / elapsedSeconds;
+    out_json["slo_ttft_ms"] = gSampleParams.mSloTtftMs;
+    out_json["slo_itl_ms"] = gSampleParams.mSloItlMs;
+    out_json["goodput_rps"] = goodput;
+    out_json["slo_attainment"] = sloAttainment;
+
+    out_markdown = "### Load Generator\n"
+    + mbase::string::from_format("__Request rate__: %.2f/s, __Requests__: %d, __Completed__: %u, __Failed__: %u<br>\n", gSampleParams.mRequestRate, gSampleParams.mRequestCount, completedCount, failedCount)
+    + mbase::string::from_format("__Throughput__: %.2f req/s, %.2f tokens/s<br>\n", throughput, generatedTokens / elapsedSeconds)
+    + mbase::string::from_format("__Goodput__: %.2f req/s (%.1f%% within TTFT <= %d ms, ITL <= %d ms)<br>\n", goodput, sloAttainment * 100, gSampleParams.mSloTtftMs, gSampleParams.mSloItlMs)
+    + "\n| Latency ms | p50 | p90 | p99 | max |\n"
+    + "| ---------- | --- | --- | --- | --- |\n";
+
+    printf("\n==== Load generator ====\n");
+    printf("- Completed: %u, Failed: %u, Elapsed: %.2f s\n", completedCount, failedCount, elapsedSeconds);
+    printf("- Throughput: %.2f req/s, %.2f tokens/s\n", throughput, generatedTokens / elapsedSeconds);
+    printf("- Goodput: %.2f req/s (%.1f%% of requests within TTFT <= %d ms, ITL <= %d ms)\n", goodput, sloAttainment * 100, gSampleParams.mSloTtftMs, gSampleParams.mSloItlMs);
+    printf("| Latency ms\\t| p50\\t| p90\\t| p99\\t| max\\t|\n");
+
+    for(const latency_row& tmpRow : latencyRows)
+    {
+        F64 p50 = tmpRow.mHistogram->get_percentile(0.5) / 1000.0;
+        F64 p90 = tmpRow.mHistogram->get_percentile(0.9) / 1000.0;
+        F64 p99 = tmpRow.mHistogram->get_percentile(0.99) / 1000.0;
+        F64 maxValue = tmpRow.mHistogram->get_max() / 1000.0;
+        out_json["latency_ms"][tmpRow.mName]["p50"] = p50;
+        out_json["latency_ms"][tmpRow.mName]["p90"] = p90;
+        out_json["latency_ms"][tmpRow.mName]["p99"] = p99;
+        out_json["latency_ms"][tmpRow.mName]["max"] = maxValue;
+        out_markdown += mbase::string::from_format("| %s | %.2f | %.2f | %.2f | %.2f |\n", tmpRow.mName, p50, p90, p99, maxValue);
+        printf("| %s\\t| %.2f\\t| %.2f\\t| %.2f\\t| %.2f\\t|\n", tmpRow.mName, p50, p90, p99, maxValue);
+    }
+}
+
+struct sampler_benchmark_config {
+    MSTRING mName;
+    I32 mTopK;
+    F32 mTopP;
+    F32 mMinP;
+    F32 mTemp;
+};
+
+// microseconds per sampled token, the candidate array is refilled outside of the measured region
+GENERIC measure_sampler_chain(llama_sampler* in_chain, const mbase::vector<mbase::vector<F32>>& in_logit_sets, mbase::vector<llama_token_data>& in_candidates, InfHistogram& out_histogram)
+{
+    for(I32 i = 0; i < gSampleParams.mPredictCount; i++)
+    {
+        const mbase::vector<F32>& tmpLogits = in_logit_sets[i % in_logit_sets.size()];
+        for(I32 j = 0; j < gSampleParams.mSamplerVocab; j++)
+        {
+            in_candidates[j] = llama_token_data{j, tmpLogits[j], 0.0f};
+        }
+
+        llama_token_data_array candidateArray = {in_candidates.data(), in_candidates.size(), -1, false};
+        std::chrono::steady_clock::time_point beginTime = std::chrono::steady_clock::now();
+        llama_sampler_apply(in_chain, &candidateArray);
+        llama_sampler_accept(in_chain, candidateArray.data[candidateArray.selected].id);
+        out_histogram.record(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - beginTime).count());
+    }
+}
+
+I32 run_sampler_benchmark()
+{
+    if(gSampleParams.mSamplerVocab <= 0 || gSampleParams.mPredictCount <= 0)
+    {
+        printf("ERR: Vocabulary size and token count must be positive\n");
+        return 1;
+    }
+
+    // logits of a real model are heavy tailed around a few likely tokens,
+    // a wide normal distribution with a handful of boosted tokens comes close enough
+    std::mt19937 logitGenerator(gSampleParams.mSeed);
+    std::normal_distribution<F32> logitDistribution(0.0f, 2.5f);
+    std::uniform_int_distribution<I32> boostDistribution(0, gSampleParams.mSamplerVocab - 1);
+    mbase::vector<mbase::vector<F32>> logitSets;
+    for(I32 i = 0; i < 8; i++)
+    {
+        mbase::vector<F32> tmpLogits;
+        tmpLogits.reserve(gSampleParams.mSamplerVocab);
+        for(I32 j = 0; j < gSampleParams.mSamplerVocab; j++)
+        {
+            tmpLogits.push_back(logitDistribution(logitGenerator));
+        }
+        for(I32 j = 0; j < 8; j++)
+        {
+            tmpLogits[boostDistribution(logitGenerator)] += 12.0f - j;
+        }
+        logitSets.push_back(tmpLogits);
+    }
+
+    mbase::vector<llama_token_data> candidateVector;
+    candidateVector.reserve(gSampleParams.mSamplerVocab);
+    for(I32 i = 0; i < gSampleParams.mSamplerVocab; i++)
+    {
+        candidateVector.push_back(llama_token_data{i, 0.0f, 0.0f});
+    }
+
+    const sampler_benchmark_config benchConfigs[] = {
+        {"top_k=40 top_p=0.95 min_p=0.05 temp=0.8", 40, 0.95f, 0.05f, 0.8f},
+        {"top_p=0.95 min_p=0.05 temp=0.8", 0, 0.95f, 0.05f, 0.8f},
+        {"top_p=0.9 temp=1.0", 0, 0.9f, 0.0f, 1.0f}
+    };
+
+    printf("Sampling %d tokens over a vocabulary of %d\n\n", gSampleParams.mPredictCount, gSampleParams.mSamplerVocab);
+    printf("| Samplers\t| Chain mean(us)\t| Chain p99(us)\t| Fused mean(us)\t| Fused p99(us)\t| Speedup\t|\n");
+    mbase::Json benchJson;
+    benchJson.setArray();
+    mbase::string benchMarkdown = "### Sampler Benchmark\n"
+    + mbase::string::from_format("__Vocabulary__: %d<br>\n", gSampleParams.mSamplerVocab)
+    + mbase::string::from_format("__Tokens__: %d<br>\n\n", gSampleParams.mPredictCount)
+    + "| Samplers | Chain mean(us) | Chain p99(us) | Fused mean(us) | Fused p99(us) | Speedup |\n"
+    + "| -------- | -------------- | ------------- | -------------- | ------------- | ------- |\n";
+
+    size_t configIndex = 0;
+    for(const sampler_benchmark_config& tmpConfig : benchConfigs)
+    {
+        llama_sampler* separateChain = llama_sampler_chain_init(llama_sampler_chain_default_params());
+        if(tmpConfig.mTopK > 0)
+        {
+            llama_sampler_chain_add(separateChain, llama_sampler_init_top_k(tmpConfig.mTopK));
+        }
+        llama_sampler_chain_add(separateChain, llama_sampler_init_top_p(tmpConfig.mTopP, 1));
+        if(tmpConfig.mMinP > 0.0f)
+        {
+            llama_sampler_chain_add(separateChain, llama_sampler_init_min_p(tmpConfig.mMinP, 1));
+        }
+        llama_sampler_chain_add(separateChain, llama_sampler_init_temp(tmpConfig.mTemp));
+        llama_sampler_chain_add(separateChain, llama_sampler_init_dist(gSampleParams.mSeed));
+
+        inf_fused_sampler_params fusedParams;
+        fusedParams.mTopK = tmpConfig.mTopK;
+        fusedParams.mTopP = tmpConfig.mTopP;
+        fusedParams.mMinP = tmpConfig.mMinP;
+        fusedParams.mTemp = tmpConfig.mTemp;
+        llama_sampler* fusedChain = llama_sampler_chain_init(llama_sampler_chain_default_params());
+        llama_sampler_chain_add(fusedChain, InfFusedSampler::init(fusedParams));
+        llama_sampler_chain_add(fusedChain, llama_sampler_init_dist(gSampleParams.mSeed));
+
+        InfHistogram separateHistogram;
+        InfHistogram fusedHistogram;
+        measure_sampler_chain(separateChain, logitSets, candidateVector, separateHistogram);
+        measure_sampler_chain(fusedChain, logitSets, candidateVector, fusedHistogram);
+        llama_sampler_free(separateChain);
+        llama_sampler_free(fusedChain);
+
+        const F64 separateMean = separateHistogram.get_mean();
+        const F64 fusedMean = fusedHistogram.get_mean();
+        const F64 speedUp = fusedMean > 0.0 ? separateMean / fusedMean : 0.0;
+        printf("| %s\t| %.1f\t| %llu\t| %.1f\t| %llu\t| %.2fx\t|\n", tmpConfig.mName, separateMean, static_cast<unsigned long long>(separateHistogram.get_percentile(0.99)), fusedMean, static_cast<unsigned long long>(fusedHistogram.get_percentile(0.99)), speedUp);
+        benchMarkdown += mbase::string::from_format("| %s | %.1f | %llu | %.1f | %llu | %.2fx |\n", tmpConfig.mName, separateMean, static_cast<unsigned long long>(separateHistogram.get_percentile(0.99)), fusedMean, static_cast<unsigned long long>(fusedHistogram.get_percentile(0.99)), speedUp);
+
+        mbase::Json& configJson = benchJson[configIndex++];
+        configJson["samplers"] = tmpConfig.mName;
+        configJson["chain_mean_us"] = separateMean;
+        configJson["chain_p99_us"] = separateHistogram.get_percentile(0.99);
+        configJson["fused_mean_us"] = fusedMean;
+        configJson["fused_p99_us"] = fusedHistogram.get_percentile(0.99);
+    }
+
+    if(gSampleParams.mJsonOut.size())
+    {
+        mbase::Json jsOut;
+        jsOut.setObject();
+        jsOut["session_information"]["vocabulary"] = gSampleParams.mSamplerVocab;
+        jsOut["session_information"]["tokens"] = gSampleParams.mPredictCount;
+        jsOut["sampler_benchmark"] = benchJson;
+
+        mbase::io_file iof;
+        iof.open_file(mbase::from_utf8(gSampleParams.mJsonOut + "/mbase_bench.json"));
+        if(!iof.is_file_open())
+        {
+            printf("ERR: Unable to output mbase_bench.json on path: %s\n", gSampleParams.mJsonOut.c_str());
+        }
+        else
+        {
+            iof.write_data(jsOut.toStringPretty());
+        }
+    }
+
+    if(gSampleParams.mMdOut.size())
+    {
+        mbase::io_file iof;
+        iof.open_file(mbase::from_utf8(gSampleParams.mMdOut + "/mbase_bench.md"));
+        if(!iof.is_file_open())
+        {
+            printf("ERR: Unable to output mbase_bench.md on path: %s\n", gSampleParams.mMdOut.c_str());
+        }
+        else
+        {
+            iof.write_data(benchMarkdown);
+        }
+    }
+    return 0;
+}
+
 int main(int argc, char** argv)
 {
     if(argc < 2)
@@ -208,13 +799,15 @@ int main(int argc, char** argv)
         return 0;
     }
 
-    if(!mbase::is_file_valid(mbase::from_utf8(gSampleParams.mModelFile)))
+    // options may start right away when no model is needed (-sb)
+    I32 optionBegin = 2;
+    if(gSampleParams.mModelFile.size() && gSampleParams.mModelFile[0] == '-')
     {
-        printf("ERR: Can't open model file: %s\n", gSampleParams.mModelFile.c_str());
-        return 1;
+        gSampleParams.mModelFile.clear();
+        optionBegin = 1;
     }
 
-    for(I32 i = 2; i < argc; i++)
+    for(I32 i = optionBegin; i < argc; i++)
     {
         mbase::string argumentString = argv[i];
         if(argumentString == "--help" || argumentString == "-h")
@@ -288,6 +881,78 @@ int main(int argc, char** argv)
         {
             mbase::argument_get<mbase::string>::value(i, argc, argv, gSampleParams.mMdOut);
         }
+
+        else if(argumentString == "-lg" || argumentString == "--load-generator")
+        {
+            gSampleParams.mLoadGenerator = true;
+        }
+
+        else if(argumentString == "-rps" || argumentString == "--request-rate")
+        {
+            mbase::argument_get<F32>::value(i, argc, argv, gSampleParams.mRequestRate);
+        }
+
+        else if(argumentString == "-rc" || argumentString == "--request-count")
+        {
+            mbase::argument_get<I32>::value(i, argc, argv, gSampleParams.mRequestCount);
+        }
+
+        else if(argumentString == "-prcv" || argumentString == "--prompt-cv")
+        {
+            mbase::argument_get<F32>::value(i, argc, argv, gSampleParams.mPromptCv);
+        }
+
+        else if(argumentString == "-npcv" || argumentString == "--n-predict-cv")
+        {
+            mbase::argument_get<F32>::value(i, argc, argv, gSampleParams.mPredictCv);
+        }
+
+        else if(argumentString == "-slottft" || argumentString == "--slo-ttft")
+        {
+            mbase::argument_get<I32>::value(i, argc, argv, gSampleParams.mSloTtftMs);
+        }
+
+        else if(argumentString == "-sloitl" || argumentString == "--slo-itl")
+        {
+            mbase::argument_get<I32>::value(i, argc, argv, gSampleParams.mSloItlMs);
+        }
+
+        else if(argumentString == "-seed" || argumentString == "--seed")
+        {
+            mbase::argument_get<U32>::value(i, argc, argv, gSampleParams.mSeed);
+        }
+
+        else if(argumentString == "-ep" || argumentString == "--endpoint")
+        {
+            mbase::argument_get<mbase::string>::value(i, argc, argv, gSampleParams.mEndpoint);
+            gSampleParams.mLoadGenerator = true;
+        }
+
+        else if(argumentString == "--api-key")
+        {
+            mbase::argument_get<mbase::string>::value(i, argc, argv, gSampleParams.mApiKey);
+        }
+
+        else if(argumentString == "-sb" || argumentString == "--sampler-benchmark")
+        {
+            gSampleParams.mSamplerBenchmark = true;
+            if(i + 1 < argc && argv[i + 1][0] != '-')
+            {
+                mbase::argument_get<I32>::value(i, argc, argv, gSampleParams.mSamplerVocab);
+            }
+        }
+    }
+
+    if(gSampleParams.mSamplerBenchmark)
+    {
+        return run_sampler_benchmark();
+    }
+
+    // against an endpoint, the first argument is the model name the server knows
+    if(!gSampleParams.mEndpoint.size() && !mbase::is_file_valid(mbase::from_utf8(gSampleParams.mModelFile)))
+    {
+        printf("ERR: Can't open model file: %s\n", gSampleParams.mModelFile.c_str());
+        return 1;
     }
     
     if(gSampleParams.mThreadCount <= 0)
@@ -306,12 +971,87 @@ int main(int argc, char** argv)
     {
         printf("ERR: Invalid FPS value(%d). It must be between [10, 1000]\n", gSampleParams.mFps);
     }
+    if(gSampleParams.mLoadGenerator)
+    {
+        if(gSampleParams.mRequestRate <= 0 || gSampleParams.mRequestCount <= 0)
+        {
+            printf("ERR: Request rate and request count must be positive\n");
+            return 1;
+        }
+
+        if(gSampleParams.mUserCount <= 0 || gSampleParams.mPromptCv < 0 || gSampleParams.mPredictCv < 0)
+        {
+            printf("ERR: User count must be positive and coefficients of variation can't be negative\n");
+            return 1;
+        }
+        generate_load_schedule();
+    }
+
+    if(gSampleParams.mEndpoint.size())
+    {
+        printf("Driving %d requests at %.2f req/s against %s with %d users\n", gSampleParams.mRequestCount, gSampleParams.mRequestRate, gSampleParams.mEndpoint.c_str(), gSampleParams.mUserCount);
+        signal(SIGINT, catching_interrupt_signal);
+        gLoadState.mBeginTime = std::chrono::steady_clock::now();
+        run_endpoint_load();
+        gLoadState.mElapsedSeconds = std::chrono::duration<F32>(std::chrono::steady_clock::now() - gLoadState.mBeginTime).count();
+
+        mbase::Json loadJson;
+        mbase::string loadMarkdown;
+        build_load_report(loadJson, loadMarkdown);
+
+        if(gSampleParams.mJsonOut.size())
+        {
+            mbase::Json jsOut;
+            jsOut.setObject();
+            jsOut["session_information"]["endpoint"] = gSampleParams.mEndpoint;
+            jsOut["session_information"]["model"] = gSampleParams.mModelFile;
+            jsOut["session_information"]["user_count"] = gSampleParams.mUserCount;
+            jsOut["session_information"]["prompt_length"] = gSampleParams.mPromptLength;
+            jsOut["session_information"]["predict"] = gSampleParams.mPredictCount;
+            jsOut["load_generator"] = loadJson;
+
+            mbase::io_file iof;
+            iof.open_file(mbase::from_utf8(gSampleParams.mJsonOut + "/mbase_bench.json"));
+            if(!iof.is_file_open())
+            {
+                printf("ERR: Unable to output mbase_bench.json on path: %s\n", gSampleParams.mJsonOut.c_str());
+            }
+            else
+            {
+                iof.write_data(jsOut.toStringPretty());
+            }
+        }
+
+        if(gSampleParams.mMdOut.size())
+        {
+            mbase::string sessionInfoMd = "### Session Information\n"
+            + mbase::string::from_format("__Endpoint__: %s<br>\n", gSampleParams.mEndpoint.c_str())
+            + mbase::string::from_format("__Model__: %s<br>\n", gSampleParams.mModelFile.c_str())
+            + mbase::string::from_format("__User count__: %d<br>\n", gSampleParams.mUserCount)
+            + mbase::string::from_format("__Prompt length__: %d<br>\n", gSampleParams.mPromptLength)
+            + mbase::string::from_format("__N Predict__: %d<br>\n", gSampleParams.mPredictCount);
+
+            mbase::io_file iof;
+            iof.open_file(mbase::from_utf8(gSampleParams.mMdOut + "/mbase_bench.md"));
+            if(!iof.is_file_open())
+            {
+                printf("ERR: Unable to output mbase_bench.md on path: %s\n", gSampleParams.mMdOut.c_str());
+            }
+            else
+            {
+                iof.write_data(sessionInfoMd + loadMarkdown);
+            }
+        }
+        return 0;
+    }
+
     F32 roundedSeconds = std::round((1 / (F32)gSampleParams.mFps) * (1000));
     gSampleParams.mFps = 1 / (roundedSeconds / 1000.0f);
     deviceDescription = inf_query_devices();
 
     BenchmarkModel benchModel;
     BenchmarkClient benchClient;
+    LoadClient loadClient;
     mbase::vector<BenchmarkProcessor*> processorsList; 
     for(I32 i = 0; i < gSampleParams.mUserCount; i++)
     {
@@ -356,7 +1096,14 @@ int main(int argc, char** argv)
             tmpProc->update();
             mbase::sleep(2);
         }
-        tmpProc->set_inference_client(&benchClient);
+        if(gSampleParams.mLoadGenerator)
+        {
+            tmpProc->set_inference_client(&loadClient);
+        }
+        else
+        {
+            tmpProc->set_inference_client(&benchClient);
+        }
     }
     printf("Processors are initialized!\n");
     signal(SIGINT, catching_interrupt_signal);
@@ -412,10 +1159,13 @@ int main(int argc, char** argv)
 
     printf("Benchmark started!\n\n");
 
-    for(BenchmarkProcessor* tmpProc : processorsList)
+    if(!gSampleParams.mLoadGenerator)
     {
-        mbase::inf_text_token_vector tokVec(gSampleParams.mPromptLength, 1);
-        tmpProc->execute_input(tokVec);
+        for(BenchmarkProcessor* tmpProc : processorsList)
+        {
+            mbase::inf_text_token_vector tokVec(gSampleParams.mPromptLength, 1);
+            tmpProc->execute_input(tokVec);
+        }
     }
 
     I32 frameCounter = 0;
@@ -425,9 +1175,14 @@ int main(int argc, char** argv)
     I32 sleepInterval = roundedSeconds;
     
     std::chrono::high_resolution_clock::time_point programBeginTime = std::chrono::high_resolution_clock::now();
+    gLoadState.mBeginTime = std::chrono::steady_clock::now();
     while(gIsProgramRunning)
     {
         std::chrono::high_resolution_clock::time_point beginTime = std::chrono::high_resolution_clock::now();
+        if(gSampleParams.mLoadGenerator)
+        {
+            dispatch_load_arrivals(processorsList);
+        }
         benchModel.update();
         std::chrono::high_resolution_clock::time_point endTime = std::chrono::high_resolution_clock::now();
         
@@ -455,6 +1210,7 @@ int main(int argc, char** argv)
 
     F32 averageFps = diagnosticFps / (F32)nonResetFrameCounter;
     F32 totalElapsedTimeInSeconds = std::chrono::duration_cast<std::chrono::milliseconds>(programEndTime - programBeginTime).count() / 1000.0f;
+    gLoadState.mElapsedSeconds = totalElapsedTimeInSeconds;
 
     printf("\n");
     printf("\n==== Useful metrics ====\n");
@@ -470,6 +1226,28 @@ int main(int argc, char** argv)
         tmpProc->release_inference_client_stacked();
     }
 
+    mbase::Json loadJson;
+    mbase::string loadMarkdown;
+    if(gSampleParams.mLoadGenerator)
+    {
+        build_load_report(loadJson, loadMarkdown);
+
+        // engine side view of the same run, merged over every processor
+        InfProcT2TDiagnostics engineDiagnostics;
+        for(BenchmarkProcessor* tmpProc : processorsList)
+        {
+            engineDiagnostics.merge(tmpProc->get_diagnostics());
+        }
+        F64 decodeP50 = engineDiagnostics.decodeStepMicroseconds.get_percentile(0.5) / 1000.0;
+        F64 decodeP99 = engineDiagnostics.decodeStepMicroseconds.get_percentile(0.99) / 1000.0;
+        F64 batchP50 = (F64)engineDiagnostics.batchSize.get_percentile(0.5);
+        printf("- Engine decode step ms p50: %.2f, p99: %.2f, batch size p50: %.0f\n", decodeP50, decodeP99, batchP50);
+        loadJson["engine"]["decode_step_ms"]["p50"] = decodeP50;
+        loadJson["engine"]["decode_step_ms"]["p99"] = decodeP99;
+        loadJson["engine"]["batch_size_p50"] = batchP50;
+        loadMarkdown += mbase::string::from_format("\n__Engine decode step__: p50 %.2f ms, p99 %.2f ms, batch size p50 %.0f<br>\n", decodeP50, decodeP99, batchP50);
+    }
+
     if(gSampleParams.mJsonOut.size())
     {
         gSampleParams.mJsonOut.push_back('/');
@@ -540,6 +1318,10 @@ int main(int argc, char** argv)
         }
 
         jsOut["processor_diagnostics"] = processorDiagnostics;
+        if(gSampleParams.mLoadGenerator)
+        {
+            jsOut["load_generator"] = loadJson;
+        }
 
         mbase::string outString = jsOut.toStringPretty();
         mbase::io_file iof;
@@ -595,7 +1377,7 @@ int main(int argc, char** argv)
             InfProcT2TDiagnostics& t2tDiag = tmpProc->get_diagnostics();
             processorDiagnostics += mbase::string::from_format("| %lld | %.2f | %.2f |\n", t2tDiag.loadTimeInMilliseconds, t2tDiag.ppTokensPerSecond, tmpProc->get_average_eval_per_second());
         }
-        mbase::string totalMdContent = modelInfoMd + sessionInfoMd + usefulMetricsMd + processorDiagnostics;
+        mbase::string totalMdContent = modelInfoMd + sessionInfoMd + usefulMetricsMd + processorDiagnostics + loadMarkdown;
         
         mbase::io_file iof;
         iof.open_file(mbase::from_utf8(markdownFile));
@@ -0,0 +1,508 @@
+#include <mbase/allocator.h>
+#include <mbase/string.h>
+#include <mbase/vector.h>
+#include <mbase/list.h>
+#include <mbase/set.h>
+#include <mbase/unordered_map.h>
+#include <mbase/argument_get_value.h>
+#include <mbase/maip_parser.h>
+#include <mbase/inference/inf_common.h>
+#include <mbase/inference/inf_vector_store.h>
+#include <chrono>
+#include <random>
+#include <math.h>
+#include <stdio.h>
+
+#define MBASE_MICRO_BENCHMARK_VERSION "v1.0.0"
+
+using namespace mbase;
+
+struct program_parameters {
+    mbase::string mMode = "all";
+    I32 mIterationCount = 10000;
+    I32 mRowCount = 100000;
+    I32 mDimension = 384;
+};
+
+program_parameters gSampleParams;
+
+GENERIC print_usage();
+
+GENERIC print_usage()
+{
+    printf("========================================\n");
+    printf("#Program name:      mbase_micro_benchmark\n");
+    printf("#Version:           %s\n", MBASE_MICRO_BENCHMARK_VERSION);
+    printf("#Type:              Utility, Example\n");
+    printf("***** DESCRIPTION *****\n");
+    printf("This is a utility program to measure the hot paths of the MBASE libraries in isolation.\n");
+    printf("It does not load any model, every case runs on synthetic data.\n");
+    printf("Available modes:\n");
+    printf("- alloc: Simulates the per-request container churn of a server (string kvals, list, set, unordered_map and vector)\n");
+    printf("\tand reports upstream allocations and nanoseconds per request for the heap, the monotonic arena and the node pool.\n");
+    printf("- simd: Reranks a row-major embedding matrix against a query with the scalar loop and the dispatched SIMD kernels\n");
+    printf("\tand reports milliseconds per query and the effective memory bandwidth.\n");
+    printf("- ann: Builds the FLAT, IVF and HNSW vector store indexes over clustered synthetic embeddings\n");
+    printf("\tand reports build time, milliseconds per top-10 query and recall against the exact scan. Not part of 'all' since building the graph takes a while.\n");
+    printf("- maip: Parses typical MAIP request headers and reads their values the way the server callbacks do\n");
+    printf("\tand reports nanoseconds per request and the parse throughput.\n");
+    printf("========================================\n\n");
+    printf("Usage: mbase_micro_benchmark *[<option> [<value>]]\n");
+    printf("       mbase_micro_benchmark -m alloc -n 100000\n");
+    printf("Options: \n\n");
+    printf("-h, --help                           Print usage.\n");
+    printf("-v, --version                        Shows program version.\n");
+    printf("-m, --mode <str>                     Benchmark mode to run (default=all).\n");
+    printf("-n, --iteration-count <int>          Amount of iterations per case (default=10000).\n");
+    printf("-rc, --row-count <int>               Amount of embedding rows for the simd and ann modes (default=100000).\n");
+    printf("-d, --dimension <int>                Embedding dimension for the simd and ann modes (default=384).\n");
+}
+
+/* ===== ALLOCATION BENCHMARK BEGIN ===== */
+
+class counting_resource : public memory_resource {
+public:
+    counting_resource(memory_resource* in_upstream = get_new_delete_resource()) noexcept : mUpstream(in_upstream), mAllocationCount(0) {}
+
+    SIZE_T get_allocation_count() const noexcept { return mAllocationCount; }
+
+protected:
+    PTRGENERIC do_allocate(size_type in_bytes, size_type in_alignment) override
+    {
+        ++mAllocationCount;
+        return mUpstream->allocate(in_bytes, in_alignment);
+    }
+
+    GENERIC do_deallocate(PTRGENERIC in_ptr, size_type in_bytes, size_type in_alignment) override
+    {
+        mUpstream->deallocate(in_ptr, in_bytes, in_alignment);
+    }
+
+    bool do_is_equal(const memory_resource& in_other) const noexcept override
+    {
+        return this == &in_other;
+    }
+
+private:
+    memory_resource* mUpstream;
+    SIZE_T mAllocationCount;
+};
+
+using bench_string = mbase::character_sequence<IBYTE, mbase::type_sequence<IBYTE>, polymorphic_allocator<IBYTE>>;
+using bench_kval = mbase::pair<bench_string, bench_string>;
+using bench_kval_list = mbase::list<bench_kval, polymorphic_allocator<bench_kval>>;
+using bench_key_set = mbase::set<I32, std::less<I32>, polymorphic_allocator<I32>>;
+using bench_header_map = mbase::unordered_map<I32, I32, std::hash<I32>, std::equal_to<I32>, polymorphic_allocator<mbase::pair<I32, I32>>>;
+using bench_float_vector = mbase::vector<F32, polymorphic_allocator<F32>>;
+
+F64 simulate_request(memory_resource* in_node_resource, memory_resource* in_block_resource)
+{
+    // roughly the shape of a parsed MAIP request with a handful of kvals,
+    // a header table and a decoded embedding payload
+    bench_kval_list kvalList{polymorphic_allocator<bench_kval>(in_node_resource)};
+    bench_key_set keySet{std::less<I32>(), polymorphic_allocator<I32>(in_node_resource)};
+    bench_header_map headerMap(gUmapDefaultBucketCount, polymorphic_allocator<mbase::pair<I32, I32>>(in_node_resource));
+    bench_float_vector payload{polymorphic_allocator<F32>(in_block_resource)};
+
+    for(I32 i = 0; i < 32; i++)
+    {
+        bench_string kvalKey{polymorphic_allocator<IBYTE>(in_block_resource)};
+        kvalKey.append("CONTENT-KEY-NUMBER-");
+        kvalKey.append(mbase::string::from_format("%d", i).c_str());
+        bench_string kvalValue{polymorphic_allocator<IBYTE>(in_block_resource)};
+        kvalValue.append("a moderately long value that does not fit into the initial capacity");
+        kvalList.push_back(bench_kval(std::move(kvalKey), std::move(kvalValue)));
+        keySet.insert(i * 7 % 32);
+        headerMap.insert(mbase::pair<I32, I32>(i, i * 2));
+    }
+
+    for(I32 i = 0; i < 256; i++)
+    {
+        payload.push_back(static_cast<F32>(i));
+    }
+
+    return static_cast<F64>(kvalList.size() + keySet.size() + headerMap.size() + payload.size());
+}
+
+GENERIC run_alloc_benchmark()
+{
+    printf("***** ALLOCATION BENCHMARK *****\n");
+    printf("%-10s %16s %16s\n", "Resource", "allocs/request", "ns/request");
+
+    F64 checkSum = 0;
+    auto report = [&](const IBYTE* in_name, SIZE_T in_allocations, std::chrono::nanoseconds in_elapsed) {
+        printf("%-10s %16.2f %16.2f\n",
+            in_name,
+            static_cast<F64>(in_allocations) / gSampleParams.mIterationCount,
+            static_cast<F64>(in_elapsed.count()) / gSampleParams.mIterationCount
+        );
+    };
+
+    {
+        counting_resource heapResource;
+        auto startTime = std::chrono::high_resolution_clock::now();
+        for(I32 i = 0; i < gSampleParams.mIterationCount; i++)
+        {
+            checkSum += simulate_request(&heapResource, &heapResource);
+        }
+        report("heap", heapResource.get_allocation_count(), std::chrono::high_resolution_clock::now() - startTime);
+    }
+
+    {
+        counting_resource heapResource;
+        monotonic_buffer_resource requestArena(16384, &heapResource);
+        auto startTime = std::chrono::high_resolution_clock::now();
+        for(I32 i = 0; i < gSampleParams.mIterationCount; i++)
+        {
+            checkSum += simulate_request(&requestArena, &requestArena);
+            requestArena.release();
+        }
+        report("arena", heapResource.get_allocation_count(), std::chrono::high_resolution_clock::now() - startTime);
+    }
+
+    {
+        counting_resource heapResource;
+        node_pool_resource nodePool(128, 256, &heapResource);
+        auto startTime = std::chrono::high_resolution_clock::now();
+        for(I32 i = 0; i < gSampleParams.mIterationCount; i++)
+        {
+            checkSum += simulate_request(&nodePool, &heapResource);
+        }
+        report("pool", heapResource.get_allocation_count(), std::chrono::high_resolution_clock::now() - startTime);
+    }
+
+    printf("(checksum %.0f)\n\n", checkSum);
+}
+
+/* ===== ALLOCATION BENCHMARK END ===== */
+
+/* ===== SIMD BENCHMARK BEGIN ===== */
+
+// The pre-dispatch implementation of inf_common_cosine_similarity, kept as the baseline
+F32 scalar_cosine_similarity(const F32* in_data1, const F32* in_data2, SIZE_T in_length)
+{
+    F32 sum = 0.0f;
+    F32 sum1 = 0.0f;
+    F32 sum2 = 0.0f;
+    for(SIZE_T i = 0; i < in_length; i++)
+    {
+        sum += in_data1[i] * in_data2[i];
+        sum1 += in_data1[i] * in_data1[i];
+        sum2 += in_data2[i] * in_data2[i];
+    }
+    if(sum1 == 0.0f || sum2 == 0.0f)
+    {
+        return (sum1 == 0.0f && sum2 == 0.0f) ? 1.0f : 0.0f;
+    }
+    return sum / (sqrtf(sum1) * sqrtf(sum2));
+}
+
+GENERIC run_simd_benchmark()
+{
+    const SIZE_T rowCount = static_cast<SIZE_T>(gSampleParams.mRowCount);
+    const SIZE_T dimension = static_cast<SIZE_T>(gSampleParams.mDimension);
+    const I32 queryCount = 10;
+
+    printf("***** SIMD BENCHMARK *****\n");
+    printf("Dispatched ISA: %s, rows: %zu, dimension: %zu\n", inf_common_simd_isa(), rowCount, dimension);
+
+    std::mt19937 randomEngine(42);
+    std::uniform_real_distribution<F32> valueDistribution(-1.0f, 1.0f);
+    mbase::vector<F32> embeddingMatrix(rowCount * dimension);
+    mbase::vector<F32> queryVector(dimension);
+    mbase::vector<F32> scoreList(rowCount);
+    for(SIZE_T i = 0; i < rowCount * dimension; i++)
+    {
+        embeddingMatrix.push_back(valueDistribution(randomEngine));
+    }
+    for(SIZE_T i = 0; i < dimension; i++)
+    {
+        queryVector.push_back(valueDistribution(randomEngine));
+    }
+    scoreList.resize(rowCount);
+
+    F64 checkSum = 0;
+    const F64 matrixBytes = static_cast<F64>(rowCount * dimension * sizeof(F32));
+    printf("%-22s %12s %12s\n", "Kernel", "ms/query", "GB/s");
+    auto report = [&](const IBYTE* in_name, std::chrono::nanoseconds in_elapsed) {
+        F64 msPerQuery = static_cast<F64>(in_elapsed.count()) / 1e6 / queryCount;
+        printf("%-22s %12.3f %12.2f\n", in_name, msPerQuery, matrixBytes / (msPerQuery * 1e6));
+        checkSum += scoreList[rowCount / 2];
+    };
+
+    auto startTime = std::chrono::high_resolution_clock::now();
+    for(I32 q = 0; q < queryCount; q++)
+    {
+        for(SIZE_T i = 0; i < rowCount; i++)
+        {
+            scoreList[i] = scalar_cosine_similarity(queryVector.data(), embeddingMatrix.data() + i * dimension, dimension);
+        }
+    }
+    report("scalar pairwise", std::chrono::high_resolution_clock::now() - startTime);
+
+    startTime = std::chrono::high_resolution_clock::now();
+    for(I32 q = 0; q < queryCount; q++)
+    {
+        for(SIZE_T i = 0; i < rowCount; i++)
+        {
+            scoreList[i] = inf_common_cosine_similarity(queryVector.data(), embeddingMatrix.data() + i * dimension, static_cast<I32>(dimension));
+        }
+    }
+    report("simd pairwise", std::chrono::high_resolution_clock::now() - startTime);
+
+    startTime = std::chrono::high_resolution_clock::now();
+    for(I32 q = 0; q < queryCount; q++)
+    {
+        inf_common_cosine_similarity_batch(queryVector.data(), embeddingMatrix.data(), rowCount, dimension, scoreList.data());
+    }
+    report("simd batch", std::chrono::high_resolution_clock::now() - startTime);
+
+    // normalized rows turn the cosine into a single dot product per row
+    for(SIZE_T i = 0; i < rowCount; i++)
+    {
+        inf_common_embd_normalize(embeddingMatrix.data() + i * dimension, embeddingMatrix.data() + i * dimension, dimension);
+    }
+    inf_common_embd_normalize(queryVector.data(), queryVector.data(), dimension);
+
+    startTime = std::chrono::high_resolution_clock::now();
+    for(I32 q = 0; q < queryCount; q++)
+    {
+        inf_common_cosine_similarity_batch(queryVector.data(), embeddingMatrix.data(), rowCount, dimension, scoreList.data(), true);
+    }
+    report("simd batch normalized", std::chrono::high_resolution_clock::now() - startTime);
+
+    printf("(checksum %.4f)\n\n", checkSum);
+}
+
+/* ===== SIMD BENCHMARK END ===== */
+
+/* ===== ANN BENCHMARK BEGIN ===== */
+
+GENERIC run_ann_benchmark()
+{
+    const SIZE_T rowCount = static_cast<SIZE_T>(gSampleParams.mRowCount);
+    const SIZE_T dimension = static_cast<SIZE_T>(gSampleParams.mDimension);
+    const SIZE_T clusterCount = 256;
+    const I32 queryCount = 100;
+    const SIZE_T topK = 10;
+
+    printf("***** ANN BENCHMARK *****\n");
+    printf("Rows: %zu, dimension: %zu, top-k: %zu\n", rowCount, dimension, topK);
+
+    // embeddings of real corpora are clustered, uniform noise would make every index look equally bad
+    std::mt19937 randomEngine(42);
+    std::normal_distribution<F32> valueDistribution(0.0f, 1.0f);
+    mbase::vector<F32> clusterCenters;
+    for(SIZE_T i = 0; i < clusterCount * dimension; i++)
+    {
+        clusterCenters.push_back(valueDistribution(randomEngine));
+    }
+
+    auto generateVector = [&](mbase::vector<F32>& out_vector) {
+        const SIZE_T clusterIndex = randomEngine() % clusterCount;
+        for(SIZE_T i = 0; i < dimension; i++)
+        {
+            out_vector.push_back(clusterCenters[clusterIndex * dimension + i] + 0.6f * valueDistribution(randomEngine));
+        }
+    };
+
+    mbase::vector<F32> embeddingMatrix;
+    mbase::vector<F32> queryMatrix;
+    for(SIZE_T i = 0; i < rowCount; i++)
+    {
+        generateVector(embeddingMatrix);
+    }
+    for(I32 i = 0; i < queryCount; i++)
+    {
+        generateVector(queryMatrix);
+    }
+
+    printf("%-8s %12s %12s %12s\n", "Index", "build ms", "ms/query", "recall@10");
+    const InfVectorStore::index_type indexTypes[3] = {InfVectorStore::index_type::FLAT, InfVectorStore::index_type::IVF, InfVectorStore::index_type::HNSW};
+    const IBYTE* indexNames[3] = {"flat", "ivf", "hnsw"};
+    for(I32 t = 0; t < 3; t++)
+    {
+        InfVectorStore vectorStore;
+        vectorStore.initialize(static_cast<U32>(dimension), indexTypes[t]);
+
+        auto startTime = std::chrono::high_resolution_clock::now();
+        for(SIZE_T i = 0; i < rowCount; i++)
+        {
+            vectorStore.add(embeddingMatrix.data() + i * dimension);
+        }
+        vectorStore.build_index();
+        F64 buildMs = static_cast<F64>((std::chrono::high_resolution_clock::now() - startTime).count()) / 1e6;
+
+        InfVectorStore::search_result_vector searchResults;
+        startTime = std::chrono::high_resolution_clock::now();
+        for(I32 q = 0; q < queryCount; q++)
+        {
+            vectorStore.search(queryMatrix.data() + q * dimension, topK, searchResults);
+        }
+        F64 msPerQuery = static_cast<F64>((std::chrono::high_resolution_clock::now() - startTime).count()) / 1e6 / queryCount;
+
+        inf_vector_search_options exactOptions;
+        exactOptions.mExact = true;
+        SIZE_T hitCount = 0;
+        InfVectorStore::search_result_vector exactResults;
+        for(I32 q = 0; q < queryCount; q++)
+        {
+            vectorStore.search(queryMatrix.data() + q * dimension, topK, searchResults);
+            vectorStore.search(queryMatrix.data() + q * dimension, topK, exactResults, exactOptions);
+            for(const inf_vector_search_result& approxResult : searchResults)
+            {
+                for(const inf_vector_search_result& exactResult : exactResults)
+                {
+                    if(approxResult.mRow == exactResult.mRow)
+                    {
+                        ++hitCount;
+                        break;
+                    }
+                }
+            }
+        }
+        printf("%-8s %12.1f %12.3f %12.3f\n", indexNames[t], buildMs, msPerQuery, static_cast<F64>(hitCount) / (queryCount * topK));
+    }
+    printf("\n");
+}
+
+/* ===== ANN BENCHMARK END ===== */
+
+/* ===== MAIP BENCHMARK BEGIN ===== */
+
+GENERIC run_maip_benchmark()
+{
+    // the shapes of the most frequent requests, a short poll, a context creation and an input with a body
+    const IBYTE* requestList[] = {
+        "MAIP1.0 EXEC exec_next \nSTOK:a3f9c2e1b7d84e0f9a1b2c3d4e5f6a7b\nCTXID:7\nEND\n",
+        "MAIP1.0 INF inf_create_context \nSTOK:a3f9c2e1b7d84e0f9a1b2c3d4e5f6a7b\nMODEL:Qwen2.5-7B-Instruct-Q4_K_M\nCTXSIZE:8192\nKTYPE:q8_0\nVTYPE:q8_0\nFLASHATTN:1\nEND\n",
+        "MAIP1.0 EXEC exec_set_input \nSTOK:a3f9c2e1b7d84e0f9a1b2c3d4e5f6a7b\nCTXID:42\nROLE:User\nLENGTH:26\nEND\nhello, how are you today??"
+    };
+    const I32 requestCount = sizeof(requestList) / sizeof(requestList[0]);
+
+    SIZE_T requestBytes = 0;
+    for(I32 i = 0; i < requestCount; i++)
+    {
+        requestBytes += strlen(requestList[i]);
+    }
+
+    printf("***** MAIP BENCHMARK *****\n");
+    printf("%-22s %12s %12s\n", "Case", "ns/request", "MB/s");
+
+    U64 checkSum = 0;
+    auto report = [&](const IBYTE* in_name, std::chrono::nanoseconds in_elapsed) {
+        F64 nsPerRequest = static_cast<F64>(in_elapsed.count()) / (static_cast<F64>(gSampleParams.mIterationCount) * requestCount);
+        F64 bytesPerSecond = static_cast<F64>(requestBytes) * gSampleParams.mIterationCount / (static_cast<F64>(in_elapsed.count()) / 1e9);
+        printf("%-22s %12.1f %12.1f\n", in_name, nsPerRequest, bytesPerSecond / 1e6);
+    };
+
+    auto startTime = std::chrono::high_resolution_clock::now();
+    for(I32 i = 0; i < gSampleParams.mIterationCount; i++)
+    {
+        for(I32 j = 0; j < requestCount; j++)
+        {
+            mbase::char_stream requestStream(const_cast<IBYTEBUFFER>(requestList[j]), strlen(requestList[j]));
+            maip_peer_request peerRequest;
+            checkSum += static_cast<U64>(peerRequest.parse_request(requestStream));
+            checkSum += peerRequest.get_kval<U64>("CTXID") + peerRequest.get_kval<mbase::string>("STOK").size();
+        }
+    }
+    report("parse + read", std::chrono::high_resolution_clock::now() - startTime);
+
+    // the server parses into a fresh request every time, this is the parser alone
+    maip_peer_request reusedRequest;
+    startTime = std::chrono::high_resolution_clock::now();
+    for(I32 i = 0; i < gSampleParams.mIterationCount; i++)
+    {
+        for(I32 j = 0; j < requestCount; j++)
+        {
+            mbase::char_stream requestStream(const_cast<IBYTEBUFFER>(requestList[j]), strlen(requestList[j]));
+            checkSum += static_cast<U64>(reusedRequest.parse_request(requestStream));
+            checkSum += reusedRequest.get_kvals().size();
+        }
+    }
+    report("parse only", std::chrono::high_resolution_clock::now() - startTime);
+
+    printf("(checksum %llu)\n\n", static_cast<unsigned long long>(checkSum));
+}
+
+/* ===== MAIP BENCHMARK END ===== */
+
+int main(int argc, char** argv)
+{
+    for(I32 i = 1; i < argc; i++)
+    {
+        mbase::string argumentString = argv[i];
+        if(argumentString == "--help" || argumentString == "-h")
+        {
+            print_usage();
+            return 1;
+        }
+
+        else if(argumentString == "-v" || argumentString == "--version")
+        {
+            printf("MBASE Micro Benchmark %s\n", MBASE_MICRO_BENCHMARK_VERSION);
+            return 0;
+        }
+
+        else if(argumentString == "-m" || argumentString == "--mode")
+        {
+            mbase::argument_get<mbase::string>::value(i, argc, argv, gSampleParams.mMode);
+        }
+
+        else if(argumentString == "-n" || argumentString == "--iteration-count")
+        {
+            mbase::argument_get<I32>::value(i, argc, argv, gSampleParams.mIterationCount);
+        }
+
+        else if(argumentString == "-rc" || argumentString == "--row-count")
+        {
+            mbase::argument_get<I32>::value(i, argc, argv, gSampleParams.mRowCount);
+        }
+
+        else if(argumentString == "-d" || argumentString == "--dimension")
+        {
+            mbase::argument_get<I32>::value(i, argc, argv, gSampleParams.mDimension);
+        }
+    }
+
+    if(gSampleParams.mIterationCount <= 0 || gSampleParams.mRowCount <= 0 || gSampleParams.mDimension <= 0)
+    {
+        printf("ERR: Iteration count, row count and dimension must be positive\n");
+        return 1;
+    }
+
+    bool isModeKnown = false;
+    if(gSampleParams.mMode == "all" || gSampleParams.mMode == "alloc")
+    {
+        isModeKnown = true;
+        run_alloc_benchmark();
+    }
+
+    if(gSampleParams.mMode == "all" || gSampleParams.mMode == "simd")
+    {
+        isModeKnown = true;
+        run_simd_benchmark();
+    }
+
+    if(gSampleParams.mMode == "all" || gSampleParams.mMode == "maip")
+    {
+        isModeKnown = true;
+        run_maip_benchmark();
+    }
+
+    if(gSampleParams.mMode == "ann")
+    {
+        isModeKnown = true;
+        run_ann_benchmark();
+    }
+
+    if(!isModeKnown)
+    {
+        printf("ERR: Unknown mode: %s\n", gSampleParams.mMode.c_str());
+        print_usage();
+        return 1;
+    }
+
+    return 0;
+}
@@ -45,6 +45,190 @@ void print_usage()
     printf("-jsdesc <str>                   JSON description file for the openai server program.\n\n");
 }
 
+template<typename ProcessorType>
+bool acquireModelProcessor(mbase::OpenaiModel* in_model, const httplib::Request& in_req, httplib::Response& in_resp, ProcessorType*& out_processor)
+{
+    uint32_t waitMs = UINT32_MAX; // the model's max_queue_wait_ms applies
+    if(in_req.has_header("X-Queue-Timeout-Ms"))
+    {
+        waitMs = static_cast<uint32_t>(strtoul(in_req.get_header_value("X-Queue-Timeout-Ms").c_str(), NULL, 10));
+    }
+
+    mbase::OpenaiModel::acquire_result acquireResult = in_model->acquire_processor(mbase::openaiClientKey(in_req), waitMs, out_processor);
+    if(acquireResult == mbase::OpenaiModel::acquire_result::ACQUIRED)
+    {
+        return true;
+    }
+
+    if(acquireResult == mbase::OpenaiModel::acquire_result::QUEUE_FULL)
+    {
+        in_resp.status = 429;
+        in_resp.set_header("Retry-After", std::to_string(in_model->get_retry_after_seconds()));
+        mbase::sendOpenaiError(
+            in_req,
+            in_resp,
+            "Too many requests are waiting for this model. Please retry after the given time.",
+            "requests",
+            "rate_limit_exceeded"
+        );
+        return false;
+    }
+
+    in_resp.status = 503;
+    mbase::sendOpenaiError(
+        in_req,
+        in_resp,
+        "The engine is currently overloaded. Please try again later.",
+        "server_error",
+        "engine_overloaded"
+    );
+    return false;
+}
+
+void queueStatusHandler(const httplib::Request& in_req, httplib::Response& in_resp)
+{
+    /* /v1/queue */
+    mbase::string providedKey = "";
+    if(!mbase::openaiAuthCheck(in_req, in_resp, gProgramData.apiKey, providedKey))
+    {
+        in_resp.status = 401;
+        mbase::sendOpenaiError(
+            in_req,
+            in_resp,
+            mbase::string::from_format("Invalid API key provided: [%s]", providedKey.c_str()),
+            "invalid_request_error",
+            "missing_parameter"
+        );
+        return;
+    }
+
+    mbase::Json queueList;
+    queueList.setArray();
+
+    for(size_t i = 0; i < gProgramData.programModels.size(); i++)
+    {
+        mbase::OpenaiModel* tmpModel = gProgramData.programModels[i];
+        mbase::openai_queue_metrics queueMetrics = tmpModel->get_queue_metrics();
+        queueList[i]["model"] = tmpModel->get_model_name();
+        queueList[i]["processor_count"] = queueMetrics.mProcessorCount;
+        queueList[i]["available_processors"] = queueMetrics.mAvailableProcessors;
+        queueList[i]["queue_depth"] = queueMetrics.mQueueDepth;
+        queueList[i]["peak_queue_depth"] = queueMetrics.mPeakQueueDepth;
+        queueList[i]["max_queue_depth"] = queueMetrics.mMaxQueueDepth;
+        queueList[i]["max_queue_wait_ms"] = queueMetrics.mMaxWaitMs;
+        queueList[i]["admitted"] = queueMetrics.mAdmittedCount;
+        queueList[i]["queued"] = queueMetrics.mQueuedCount;
+        queueList[i]["rejected"] = queueMetrics.mRejectedCount;
+        queueList[i]["timed_out"] = queueMetrics.mTimedOutCount;
+        queueList[i]["average_wait_ms"] = queueMetrics.mQueuedCount ? (queueMetrics.mTotalWaitUs / queueMetrics.mQueuedCount) / 1000 : 0;
+        queueList[i]["peak_wait_ms"] = queueMetrics.mPeakWaitUs / 1000;
+    }
+
+    mbase::Json responseJSon;
+    responseJSon["object"] = "list";
+    responseJSon["data"] = queueList;
+
+    mbase::string resultantString = responseJSon.toString();
+    in_resp.set_content(resultantString.c_str(), resultantString.size(), "application/json");
+}
+
+void metricsHandler(const httplib::Request& in_req, httplib::Response& in_resp)
+{
+    /* /metrics */
+    mbase::string providedKey = "";
+    if(!mbase::openaiAuthCheck(in_req, in_resp, gProgramData.apiKey, providedKey))
+    {
+        in_resp.status = 401;
+        mbase::sendOpenaiError(
+            in_req,
+            in_resp,
+            mbase::string::from_format("Invalid API key provided: [%s]", providedKey.c_str()),
+            "invalid_request_error",
+            "missing_parameter"
+        );
+        return;
+    }
+
+    mbase::string metricsText;
+    mbase::vector<mbase::string> modelLabels;
+    for(mbase::OpenaiModel* tmpModel : gProgramData.programModels)
+    {
+        modelLabels.push_back("model=\"" + mbase::InfHistogram::escape_prometheus_label(tmpModel->get_model_name()) + "\"");
+    }
+
+    // per processor series plus a processor="all" series per model, quantiles can't be summed by the scraper
+    mbase::vector<mbase::inf_t2t_diagnostics_source> diagSources;
+    for(size_t i = 0; i < gProgramData.programModels.size(); i++)
+    {
+        mbase::OpenaiModel* tmpModel = gProgramData.programModels[i];
+        if(tmpModel->is_embedding_model())
+        {
+            continue;
+        }
+        tmpModel->append_diagnostics_sources(modelLabels[i], diagSources);
+
+        mbase::InfProcT2TDiagnostics* mergedDiagnostics = new mbase::InfProcT2TDiagnostics;
+        tmpModel->merge_processor_diagnostics(*mergedDiagnostics);
+
+        mbase::inf_t2t_diagnostics_source modelSource;
+        modelSource.mLabels = modelLabels[i] + ",processor=\"all\"";
+        modelSource.mDiagnostics = mergedDiagnostics;
+        diagSources.push_back(modelSource);
+    }
+    mbase::InfProcT2TDiagnostics::write_prometheus("mbase_openai_t2t_", diagSources, metricsText);
+    for(mbase::inf_t2t_diagnostics_source& tmpSource : diagSources)
+    {
+        delete tmpSource.mDiagnostics;
+    }
+
+    mbase::InfHistogram::write_prometheus_header("mbase_openai_queue_wait_seconds", "Time a request waited for a processor.", metricsText);
+    for(size_t i = 0; i < gProgramData.programModels.size(); i++)
+    {
+        gProgramData.programModels[i]->get_queue_wait_histogram().write_prometheus("mbase_openai_queue_wait_seconds", modelLabels[i], 1e-6, metricsText);
+    }
+
+    struct queue_counter {
+        const char* mName;
+        const char* mHelp;
+        uint64_t mbase::openai_queue_metrics::* mCounter;
+    };
+    const queue_counter queueCounters[] = {
+        {"mbase_openai_requests_admitted_total", "Requests that acquired a processor.", &mbase::openai_queue_metrics::mAdmittedCount},
+        {"mbase_openai_requests_queued_total", "Requests that waited in the queue.", &mbase::openai_queue_metrics::mQueuedCount},
+        {"mbase_openai_requests_rejected_total", "Requests rejected with 429 because the queue was full.", &mbase::openai_queue_metrics::mRejectedCount},
+        {"mbase_openai_requests_timed_out_total", "Requests whose queue deadline passed.", &mbase::openai_queue_metrics::mTimedOutCount}
+    };
+
+    mbase::vector<mbase::openai_queue_metrics> queueMetrics;
+    for(mbase::OpenaiModel* tmpModel : gProgramData.programModels)
+    {
+        queueMetrics.push_back(tmpModel->get_queue_metrics());
+    }
+
+    for(const queue_counter& tmpCounter : queueCounters)
+    {
+        metricsText += mbase::string::from_format("# HELP %s %s\n# TYPE %s counter\n", tmpCounter.mName, tmpCounter.mHelp, tmpCounter.mName);
+        for(size_t i = 0; i < queueMetrics.size(); i++)
+        {
+            metricsText += mbase::string::from_format("%s{%s} %llu\n", tmpCounter.mName, modelLabels[i].c_str(), static_cast<unsigned long long>(queueMetrics[i].*tmpCounter.mCounter));
+        }
+    }
+
+    metricsText += "# HELP mbase_openai_queue_depth Requests currently waiting for a processor.\n# TYPE mbase_openai_queue_depth gauge\n";
+    for(size_t i = 0; i < queueMetrics.size(); i++)
+    {
+        metricsText += mbase::string::from_format("mbase_openai_queue_depth{%s} %u\n", modelLabels[i].c_str(), queueMetrics[i].mQueueDepth);
+    }
+
+    metricsText += "# HELP mbase_openai_available_processors Processors that are currently free.\n# TYPE mbase_openai_available_processors gauge\n";
+    for(size_t i = 0; i < queueMetrics.size(); i++)
+    {
+        metricsText += mbase::string::from_format("mbase_openai_available_processors{%s} %u\n", modelLabels[i].c_str(), queueMetrics[i].mAvailableProcessors);
+    }
+
+    in_resp.set_content(metricsText.c_str(), metricsText.size(), "text/plain; version=0.0.4");
+}
+
 void modelListHandler(const httplib::Request& in_req, httplib::Response& in_resp)
 {
     /* /v1/models */
@@ -65,14 +249,28 @@ void modelListHandler(const httplib::Request& in_req, httplib::Response& in_resp
     mbase::Json modelList;
     modelList.setArray();
 
+    size_t listIndex = 0;
     for(size_t i = 0; i < gProgramData.programModels.size(); i++)
     {
         mbase::OpenaiModel* tmpModel = gProgramData.programModels[i];
         mbase::string modelName = tmpModel->get_model_name();
-        modelList[i]["id"] = modelName;
-        modelList[i]["object"] = "model";
-        modelList[i]["created"] = tmpModel->get_creation_date_in_epoch();
-        modelList[i]["owned_by"] = "MBASE Inference Infrastructure";
+        modelList[listIndex]["id"] = modelName;
+        modelList[listIndex]["object"] = "model";
+        modelList[listIndex]["created"] = tmpModel->get_creation_date_in_epoch();
+        modelList[listIndex]["owned_by"] = "MBASE Inference Infrastructure";
+        ++listIndex;
+
+        // every adapter of the model can be requested by its name
+        mbase::vector<mbase::inf_lora_adapter> modelAdapters = tmpModel->get_adapters();
+        for(mbase::inf_lora_adapter& tmpAdapter : modelAdapters)
+        {
+            modelList[listIndex]["id"] = tmpAdapter.mAdapterName;
+            modelList[listIndex]["object"] = "model";
+            modelList[listIndex]["created"] = tmpModel->get_creation_date_in_epoch();
+            modelList[listIndex]["owned_by"] = "MBASE Inference Infrastructure";
+            modelList[listIndex]["parent"] = modelName;
+            ++listIndex;
+        }
     }
 
     mbase::Json responseJSon;
@@ -119,13 +317,19 @@ void modelRetrieveHandler(const httplib::Request& in_req, httplib::Response& in_
     {
         mbase::OpenaiModel* tmpModel = gProgramData.programModels[i];
         mbase::string tmpModelName = tmpModel->get_model_name();
-        if(requestedModel == tmpModelName)
+        mbase::inf_lora_adapter tmpAdapter;
+        bool isAdapter = requestedModel != tmpModelName && tmpModel->has_lora_adapter(requestedModel, tmpAdapter);
+        if(requestedModel == tmpModelName || isAdapter)
         {
             mbase::Json dataObject;
-            dataObject["id"] = tmpModelName;
+            dataObject["id"] = requestedModel;
             dataObject["object"] = "model";
             dataObject["created"] = tmpModel->get_creation_date_in_epoch();
             dataObject["owned_by"] = "MBASE Infrastructure Project";
+            if(isAdapter)
+            {
+                dataObject["parent"] = tmpModelName;
+            }
             
             mbase::string responseString = dataObject.toString();
             in_resp.set_content(responseString.c_str(), responseString.size(), "application/json");
@@ -142,6 +346,59 @@ void modelRetrieveHandler(const httplib::Request& in_req, httplib::Response& in_
     );
 }
 
+// "response_format" as in the openai api, "grammar" (GBNF) as an extension.
+// The processor is reused between requests, so the grammar of the previous request is always replaced or cleared.
+bool applyResponseFormat(mbase::Json& in_request, mbase::OpenaiTextToTextProcessor* in_processor, mbase::string& out_error)
+{
+    if(in_request["grammar"].isString())
+    {
+        if(in_processor->set_grammar(in_request["grammar"].getString()) != mbase::OpenaiTextToTextProcessor::flags::INF_PROC_SUCCESS)
+        {
+            out_error = "The given grammar is invalid.";
+            return false;
+        }
+        return true;
+    }
+
+    mbase::Json& responseFormat = in_request["response_format"];
+    mbase::string formatType = responseFormat["type"].isString() ? responseFormat["type"].getString() : mbase::string("text");
+    if(formatType == "json_object")
+    {
+        if(in_processor->set_grammar(mbase::InfGrammar::json_object_gbnf()) != mbase::OpenaiTextToTextProcessor::flags::INF_PROC_SUCCESS)
+        {
+            out_error = "The server had an error while processing your request.";
+            return false;
+        }
+        return true;
+    }
+
+    if(formatType == "json_schema")
+    {
+        mbase::Json& jsonSchema = responseFormat["json_schema"]["schema"];
+        if(!jsonSchema.isObject())
+        {
+            out_error = "'response_format.json_schema.schema' must be an object.";
+            return false;
+        }
+
+        if(in_processor->set_json_schema(jsonSchema.toString()) != mbase::OpenaiTextToTextProcessor::flags::INF_PROC_SUCCESS)
+        {
+            out_error = "The given JSON schema is invalid or not supported.";
+            return false;
+        }
+        return true;
+    }
+
+    if(formatType != "text")
+    {
+        out_error = "Invalid 'response_format.type': " + formatType;
+        return false;
+    }
+
+    in_processor->clear_grammar();
+    return true;
+}
+
 void chatCompletionHandler(const httplib::Request& in_req, httplib::Response& in_resp)
 {
     /* /v1/chat/completions */
@@ -203,14 +460,23 @@ void chatCompletionHandler(const httplib::Request& in_req, httplib::Response& in
     }
     
     mbase::string requestedModel = jsonObject["model"].getString();
+    mbase::string requestedAdapter; // empty if the base model is requested
     mbase::OpenaiModel* activeModel = NULL;
 
     for(mbase::vector<mbase::OpenaiModel*>::iterator It = gProgramData.programModels.begin(); It != gProgramData.programModels.end(); ++It)
     {
         mbase::OpenaiModel* tmpModel = *It;
         mbase::string tmpModelName = tmpModel->get_model_name();
-        if(tmpModelName == requestedModel)
+        mbase::inf_lora_adapter tmpAdapter;
+        bool isAdapter = tmpModelName != requestedModel && tmpModel->has_lora_adapter(requestedModel, tmpAdapter);
+        if(tmpModelName == requestedModel || isAdapter)
         {
+            if(isAdapter)
+            {
+                // adapters are served by the processors of their base model
+                requestedAdapter = requestedModel;
+            }
+
             if(tmpModel->is_embedding_model())
             {
                 // Trying to call chat completions api on embedder model
@@ -241,14 +507,35 @@ void chatCompletionHandler(const httplib::Request& in_req, httplib::Response& in
     }
 
     mbase::OpenaiTextToTextProcessor* t2tProcessor = NULL;
-    if(!activeModel->acquire_processor(t2tProcessor))
+    if(!acquireModelProcessor(activeModel, in_req, in_resp, t2tProcessor))
     {
+        return;
+    }
+
+    if(t2tProcessor->select_lora_adapter(requestedAdapter) != mbase::OpenaiTextToTextProcessor::flags::INF_PROC_SUCCESS)
+    {
+        // the adapter was removed after the lookup
+        activeModel->release_processor(t2tProcessor);
         mbase::sendOpenaiError(
             in_req,
             in_resp,
-            "The engine is currently overloaded. Please try again later.",
-            "server_error",
-            "engine_overloaded"
+            "The specified model is not available or invalid.",
+            "invalid_request_error",
+            "invalid_model"
+        );
+        return;
+    }
+
+    mbase::string formatError;
+    if(!applyResponseFormat(jsonObject, t2tProcessor, formatError))
+    {
+        activeModel->release_processor(t2tProcessor);
+        mbase::sendOpenaiError(
+            in_req,
+            in_resp,
+            formatError,
+            "invalid_request_error",
+            "invalid_response_format"
         );
         return;
     }
@@ -522,15 +809,8 @@ void embeddingsHandler(const httplib::Request& in_req, httplib::Response& in_res
     }
 
     mbase::OpenaiEmbedderProcessor* embedderProcesor = NULL;
-    if(!activeModel->acquire_processor(embedderProcesor))
+    if(!acquireModelProcessor(activeModel, in_req, in_resp, embedderProcesor))
     {
-        mbase::sendOpenaiError(
-            in_req,
-            in_resp,
-            "The engine is currently overloaded. Please try again later.",
-            "server_error",
-            "engine_overloaded"
-        );
         return;
     }
 
@@ -690,6 +970,18 @@ void server_start()
     svr->Post("/chat/completions", chatCompletionHandler);
     svr->Post("/v1/chat/completions", chatCompletionHandler);
     svr->Post("/v1/embeddings", embeddingsHandler);
+    svr->Get("/v1/queue", queueStatusHandler);
+    svr->Get("/metrics", metricsHandler);
+
+    // queued requests block their worker thread while waiting, every waiter and every running
+    // request needs one, plus a few for the requests that are rejected or don't need a processor
+    size_t workerCount = 8;
+    for(mbase::OpenaiModel* tmpModel : gProgramData.programModels)
+    {
+        mbase::openai_queue_metrics queueMetrics = tmpModel->get_queue_metrics();
+        workerCount += queueMetrics.mProcessorCount + queueMetrics.mMaxQueueDepth;
+    }
+    svr->new_task_queue = [workerCount] { return new httplib::ThreadPool(workerCount); };
 
     std::string httpHost(gProgramData.hostName.c_str(), gProgramData.hostName.size());
     svr->listen(httpHost, gProgramData.listenPort);
@@ -728,6 +1020,12 @@ void apply_json_desc(const mbase::string& in_json_string)
         uint32_t contextLength = 4096;
         uint32_t batchLength = 512;
         uint32_t gpuLayers = 999;
+        uint32_t maxQueueDepth = 0;
+        uint32_t maxQueueWaitMs = 30000;
+        uint32_t memoryBudgetMb = 0;
+        bool flashAttention = true;
+        mbase::inf_kv_cache_type keyCacheType = mbase::inf_kv_cache_type::F16;
+        mbase::inf_kv_cache_type valueCacheType = mbase::inf_kv_cache_type::F16;
         if(modelObject["model_path"].isString())
         {
             modelPath = mbase::from_utf8(modelObject["model_path"].getString());
@@ -763,6 +1061,39 @@ void apply_json_desc(const mbase::string& in_json_string)
             gpuLayers = modelObject["gpu_layers"].getLong();
         }
 
+        maxQueueDepth = processorCount * 4;
+        if(modelObject["max_queue_depth"].isLong())
+        {
+            maxQueueDepth = modelObject["max_queue_depth"].getLong();
+        }
+
+        if(modelObject["max_queue_wait_ms"].isLong())
+        {
+            maxQueueWaitMs = modelObject["max_queue_wait_ms"].getLong();
+        }
+
+        if(modelObject["memory_budget_mb"].isLong())
+        {
+            memoryBudgetMb = modelObject["memory_budget_mb"].getLong();
+        }
+
+        if(modelObject["flash_attention"].isBool())
+        {
+            flashAttention = modelObject["flash_attention"].getBool();
+        }
+
+        if(modelObject["kv_cache_type_k"].isString() && !mbase::inf_common_kv_cache_type_from_string(modelObject["kv_cache_type_k"].getString(), keyCacheType))
+        {
+            printf("ERR: Invalid kv_cache_type_k, expected f16, q8_0 or q4_0\n");
+            exit(1);
+        }
+
+        if(modelObject["kv_cache_type_v"].isString() && !mbase::inf_common_kv_cache_type_from_string(modelObject["kv_cache_type_v"].getString(), valueCacheType))
+        {
+            printf("ERR: Invalid kv_cache_type_v, expected f16, q8_0 or q4_0\n");
+            exit(1);
+        }
+
         if(!mbase::is_file_valid(modelPath))
         {
             printf("ERR: Cant open file: %s\n", modelObject["model_path"].getString().c_str());
@@ -784,6 +1115,45 @@ void apply_json_desc(const mbase::string& in_json_string)
             exit(1);
         }
         printf("Model is succesfully loaded!\n");
+        newModel->set_memory_budget(static_cast<uint64_t>(memoryBudgetMb) * 1024 * 1024);
+
+        if(modelObject["lora_adapters"].isArray())
+        {
+            // adapters are loaded once per model, requests pick one through the model field
+            for(mbase::Json& adapterObject : modelObject["lora_adapters"].getArray())
+            {
+                if(!adapterObject["name"].isString() || !adapterObject["path"].isString())
+                {
+                    printf("ERR: Each LoRA adapter must have a 'name' and 'path' field\n");
+                    exit(1);
+                }
+
+                mbase::inf_lora_adapter loraAdapter;
+                loraAdapter.mAdapterName = adapterObject["name"].getString();
+                loraAdapter.mLoraPath = mbase::from_utf8(adapterObject["path"].getString());
+                if(adapterObject["scale"].isFloat())
+                {
+                    loraAdapter.mLoraScale = adapterObject["scale"].getFloat();
+                }
+
+                if(!mbase::is_file_valid(loraAdapter.mLoraPath))
+                {
+                    printf("ERR: Cant open file: %s\n", adapterObject["path"].getString().c_str());
+                    exit(1);
+                }
+                newModel->declare_lora_adapter(loraAdapter);
+            }
+
+            if(newModel->start_lora_operation() == mbase::OpenaiModel::flags::INF_MODEL_SUCCESS)
+            {
+                while(newModel->signal_lora_operation())
+                {
+                    mbase::sleep(5);
+                }
+                newModel->update();
+                printf("LoRA adapters loaded: %d\n", static_cast<int>(newModel->get_adapters().size()));
+            }
+        }
 
         mbase::inf_sampling_set samplersList;
 
@@ -830,6 +1200,31 @@ void apply_json_desc(const mbase::string& in_json_string)
                 }
             }
 
+            if(samplerObject["dry"].isObject())
+            {
+                mbase::Json& dryObject = samplerObject["dry"];
+                isd.mSamplerType = mbase::InfSamplerDescription::SAMPLER::DRY;
+                if(dryObject["multiplier"].isFloat())
+                {
+                    isd.mDry.mDryMultiplier = dryObject["multiplier"].getFloat();
+                    isd.mDry.mDryBase = dryObject["base"].isFloat() ? dryObject["base"].getFloat() : 1.75f;
+                    isd.mDry.mDryAllowedLength = dryObject["allowed_length"].isLong() ? static_cast<int32_t>(dryObject["allowed_length"].getLong()) : 2;
+                    isd.mDry.mDryPenaltyLastN = dryObject["penalty_last_n"].isLong() ? static_cast<int32_t>(dryObject["penalty_last_n"].getLong()) : -1;
+                    samplersList.insert(isd);
+                }
+            }
+
+            if(samplerObject["xtc"].isObject())
+            {
+                isd.mSamplerType = mbase::InfSamplerDescription::SAMPLER::XTC;
+                if(samplerObject["xtc"]["probability"].isFloat() && samplerObject["xtc"]["threshold"].isFloat())
+                {
+                    isd.mXtc.mProbability = samplerObject["xtc"]["probability"].getFloat();
+                    isd.mXtc.mThreshold = samplerObject["xtc"]["threshold"].getFloat();
+                    samplersList.insert(isd);
+                }
+            }
+
             if(samplerObject["repetition"].isObject())
             {
                 isd.mSamplerType = mbase::InfSamplerDescription::SAMPLER::REPETITION;
@@ -861,14 +1256,21 @@ void apply_json_desc(const mbase::string& in_json_string)
 
         else
         {
-            newModel->initialize_t2t_processors(
+            if(newModel->initialize_t2t_processors(
                 processorCount,
                 threadCount,
                 batchThreadCount,
                 contextLength,
                 batchLength,
-                samplersList
-            );
+                samplersList,
+                flashAttention,
+                keyCacheType,
+                valueCacheType
+            ) == mbase::OpenaiModel::init_proc_err::ERR_MEMORY_BUDGET_EXCEEDED)
+            {
+                printf("ERR: %d processors with %d context length exceed the memory budget of %s (%d MB)\n", processorCount, contextLength, modelString.c_str(), memoryBudgetMb);
+                exit(1);
+            }
         }
 
         while(!newModel->is_init_finished())
@@ -878,6 +1280,7 @@ void apply_json_desc(const mbase::string& in_json_string)
         }
 
         printf("All processors are successfully initialized!\n");
+        newModel->set_queue_limits(maxQueueDepth, maxQueueWaitMs);
 
         if(!newModel->is_embedding_model() && systemPromptString.size())
         {
@@ -20,7 +20,10 @@ OpenaiModel::init_proc_err OpenaiModel::initialize_t2t_processors(
         const U32& in_batch_thread_count,
         const U32& in_context_length,
         const U32& in_batch_length,
-        const inf_sampling_set& in_sampling_set
+        const inf_sampling_set& in_sampling_set,
+        bool in_flash_attention,
+        inf_kv_cache_type in_key_type,
+        inf_kv_cache_type in_value_type
 )
 {
     if(!in_processor_count)
@@ -55,17 +58,24 @@ OpenaiModel::init_proc_err OpenaiModel::initialize_t2t_processors(
         OpenaiTextToTextProcessor* newProcessor = new OpenaiTextToTextProcessor(i);
         
         newProcessor->set_manual_caching(true, mbase::InfProcessorTextToText::cache_mode::KV_LOCK_MODE);
+        newProcessor->set_kv_cache_types(in_key_type, in_value_type);
         
-        this->register_context_process(
+        flags registerResult = this->register_context_process(
             newProcessor,
             in_context_length,
             in_batch_length,
             in_thread_count,
             in_batch_thread_count,
-            true,
+            in_flash_attention,
             in_sampling_set
         );
-        mAvailableT2tProcessors.push_back(newProcessor);
+
+        if(registerResult == flags::INF_MODEL_ERR_MEMORY_BUDGET_EXCEEDED)
+        {
+            delete newProcessor;
+            return OpenaiModel::init_proc_err::ERR_MEMORY_BUDGET_EXCEEDED;
+        }
+        mT2tQueue.add_processor(newProcessor);
     }
 
     return OpenaiModel::init_proc_err::PROC_SUCCESS;
@@ -107,57 +117,66 @@ OpenaiModel::init_proc_err OpenaiModel::initialize_embedder_processors(
             contextLength,
             in_thread_count
         );
-        mAvailableEmbedderProcessors.push_back(newProcessor);
+        mEmbedderQueue.add_processor(newProcessor);
     }
 
     return OpenaiModel::init_proc_err::PROC_SUCCESS;
 }
 
 
-bool OpenaiModel::acquire_processor(OpenaiTextToTextProcessor*& out_processor)
+GENERIC OpenaiModel::set_queue_limits(const U32& in_max_queue_depth, const U32& in_max_wait_ms)
 {
-    mbase::lock_guard lockGuard(mProcDistributionSync);
-
-    mbase::vector<OpenaiTextToTextProcessor*>::iterator It = mAvailableT2tProcessors.begin();
-    if(It == mAvailableT2tProcessors.end())
-    {
-        return false;
-    }
-
-    out_processor = *It;
-    mAvailableT2tProcessors.erase(It);
+    mT2tQueue.set_limits(in_max_queue_depth, in_max_wait_ms);
+    mEmbedderQueue.set_limits(in_max_queue_depth, in_max_wait_ms);
+}
 
-    return true;
+OpenaiModel::acquire_result OpenaiModel::acquire_processor(const mbase::string& in_client_key, const U32& in_wait_ms, OpenaiTextToTextProcessor*& out_processor)
+{
+    return mT2tQueue.acquire(in_client_key, in_wait_ms, out_processor);
 }
 
 GENERIC OpenaiModel::release_processor(OpenaiTextToTextProcessor* in_processor)
 {
-    mbase::lock_guard lockGuard(mProcDistributionSync);
-    
-    mAvailableT2tProcessors.push_back(in_processor);
+    mT2tQueue.release(in_processor);
+}
+
+OpenaiModel::acquire_result OpenaiModel::acquire_processor(const mbase::string& in_client_key, const U32& in_wait_ms, OpenaiEmbedderProcessor*& out_processor)
+{
+    return mEmbedderQueue.acquire(in_client_key, in_wait_ms, out_processor);
 }
 
-bool OpenaiModel::acquire_processor(OpenaiEmbedderProcessor*& out_processor)
+GENERIC OpenaiModel::release_processor(OpenaiEmbedderProcessor* in_processor)
 {
-    mbase::lock_guard lockGuard(mProcDistributionSync);
+    mEmbedderQueue.release(in_processor);
+}
 
-    mbase::vector<OpenaiEmbedderProcessor*>::iterator It = mAvailableEmbedderProcessors.begin();
-    if(It == mAvailableEmbedderProcessors.end())
+openai_queue_metrics OpenaiModel::get_queue_metrics()
+{
+    // a model serves either completions or embeddings, only one of the queues has processors
+    openai_queue_metrics t2tMetrics = mT2tQueue.get_metrics();
+    if(t2tMetrics.mProcessorCount)
     {
-        return false;
+        return t2tMetrics;
     }
+    return mEmbedderQueue.get_metrics();
+}
 
-    out_processor = *It;
-    mAvailableEmbedderProcessors.erase(It);
-
-    return true;
+const InfHistogram& OpenaiModel::get_queue_wait_histogram()
+{
+    if(mT2tQueue.get_metrics().mProcessorCount)
+    {
+        return mT2tQueue.get_wait_histogram();
+    }
+    return mEmbedderQueue.get_wait_histogram();
 }
 
-GENERIC OpenaiModel::release_processor(OpenaiEmbedderProcessor* in_processor)
+U32 OpenaiModel::get_retry_after_seconds()
 {
-    mbase::lock_guard lockGuard(mProcDistributionSync);
-    
-    mAvailableEmbedderProcessors.push_back(in_processor);
+    if(mT2tQueue.get_metrics().mProcessorCount)
+    {
+        return mT2tQueue.get_retry_after_seconds();
+    }
+    return mEmbedderQueue.get_retry_after_seconds();
 }
 
 bool OpenaiModel::is_init_finished()
@@ -6,6 +6,7 @@
 #include <mbase/inference/inf_t2t_model.h>
 #include <mbase/vector.h>
 #include <mbase/synchronization.h>
+#include "processor_queue.h"
 
 MBASE_BEGIN
 
@@ -24,6 +25,7 @@ public:
         ERR_INVALID_BATCH_THREAD_COUNT,
         ERR_INVALID_CONTEXT_LENGTH,
         ERR_INVALID_BATCH_LENGTH,
+        ERR_MEMORY_BUDGET_EXCEEDED,
     };
     U64 get_creation_date_in_epoch();
     init_proc_err initialize_t2t_processors(
@@ -32,15 +34,26 @@ public:
         const U32& in_batch_thread_count,
         const U32& in_context_length,
         const U32& in_batch_length,
-        const inf_sampling_set& in_sampling_set
+        const inf_sampling_set& in_sampling_set,
+        bool in_flash_attention = true,
+        inf_kv_cache_type in_key_type = inf_kv_cache_type::F16,
+        inf_kv_cache_type in_value_type = inf_kv_cache_type::F16
     );
     init_proc_err initialize_embedder_processors(
         const U32& in_processor_count,
         const U32& in_context_length,
         const U32& in_thread_count
     );
-    bool acquire_processor(OpenaiTextToTextProcessor*& out_processor);
-    bool acquire_processor(OpenaiEmbedderProcessor*& out_processor);
+    using t2t_queue = OpenaiProcessorQueue<OpenaiTextToTextProcessor>;
+    using embedder_queue = OpenaiProcessorQueue<OpenaiEmbedderProcessor>;
+    using acquire_result = openai_acquire_result;
+
+    GENERIC set_queue_limits(const U32& in_max_queue_depth, const U32& in_max_wait_ms);
+    acquire_result acquire_processor(const mbase::string& in_client_key, const U32& in_wait_ms, OpenaiTextToTextProcessor*& out_processor);
+    acquire_result acquire_processor(const mbase::string& in_client_key, const U32& in_wait_ms, OpenaiEmbedderProcessor*& out_processor);
+    openai_queue_metrics get_queue_metrics();
+    const InfHistogram& get_queue_wait_histogram();
+    U32 get_retry_after_seconds();
     bool is_init_finished();
     GENERIC release_processor(OpenaiTextToTextProcessor* in_processor);
     GENERIC release_processor(OpenaiEmbedderProcessor* out_processor);
@@ -51,9 +64,8 @@ public:
 	GENERIC on_destroy() override;
 
 private:
-    mbase::mutex mProcDistributionSync;
-    mbase::vector<OpenaiTextToTextProcessor*> mAvailableT2tProcessors; // will leak memory but its okay.
-    mbase::vector<OpenaiEmbedderProcessor*> mAvailableEmbedderProcessors;
+    t2t_queue mT2tQueue; // will leak memory but its okay.
+    embedder_queue mEmbedderQueue;
     U32 mAccessLimit;
     U64 mCreationDate;
     I32 mProcRgrCounter = 0;
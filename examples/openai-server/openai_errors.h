@@ -34,6 +34,20 @@ GENERIC sendOpenaiError(
     in_resp.set_content(responseString.c_str(), responseString.size(), "application/json");
 }
 
+// Requests are queued fairly between clients, a client is its bearer token or its address when there is none
+mbase::string openaiClientKey(const httplib::Request& in_req)
+{
+    if(in_req.has_header("Authorization"))
+    {
+        std::string authToken = in_req.get_header_value("Authorization");
+        if(authToken.size())
+        {
+            return mbase::string(authToken.c_str(), authToken.size());
+        }
+    }
+    return mbase::string(in_req.remote_addr.c_str(), in_req.remote_addr.size());
+}
+
 bool openaiAuthCheck(const httplib::Request& in_req, httplib::Response& in_resp, const mbase::string& in_server_key, mbase::string& out_provided_key)
 {
     if(!in_server_key.size())
@@ -0,0 +1,239 @@
+#ifndef MBASE_OPENAI_PROCESSOR_QUEUE_H
+#define MBASE_OPENAI_PROCESSOR_QUEUE_H
+
+#include <mbase/common.h>
+#include <mbase/string.h>
+#include <mbase/vector.h>
+#include <mbase/inference/inf_histogram.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+
+MBASE_BEGIN
+
+enum class openai_acquire_result {
+    ACQUIRED,
+    QUEUE_FULL, // queue bound exceeded, the client should retry later
+    DEADLINE_EXCEEDED // waited the full deadline without getting a processor
+};
+
+struct openai_queue_metrics {
+    U32 mProcessorCount = 0;
+    U32 mAvailableProcessors = 0;
+    U32 mQueueDepth = 0;
+    U32 mPeakQueueDepth = 0;
+    U32 mMaxQueueDepth = 0;
+    U32 mMaxWaitMs = 0;
+    U64 mAdmittedCount = 0; // every successful acquire, queued or not
+    U64 mQueuedCount = 0; // acquires that had to wait
+    U64 mRejectedCount = 0; // queue bound exceeded, answered with 429
+    U64 mTimedOutCount = 0; // deadline passed while waiting, answered with 503
+    U64 mTotalWaitUs = 0; // summed over queued acquires
+    U64 mPeakWaitUs = 0;
+};
+
+/*
+    Processor pool with a bounded wait queue in front of it.
+
+    When no processor is free, the request waits until its deadline instead of failing right away.
+    Waiters are grouped by client key (API key or remote address) and a released processor is
+    handed to the clients in round-robin order, so a single client flooding the server can only
+    take its share of the processors while the others are waiting.
+
+    The processor is handed directly to the waiter on release, a request arriving while others
+    are queued never overtakes them.
+*/
+
+template<typename ProcessorType>
+class OpenaiProcessorQueue {
+public:
+    using acquire_result = openai_acquire_result;
+    using clock_type = std::chrono::steady_clock;
+
+    GENERIC set_limits(const U32& in_max_queue_depth, const U32& in_max_wait_ms)
+    {
+        std::lock_guard<std::mutex> queueLock(mQueueSync);
+        mMetrics.mMaxQueueDepth = in_max_queue_depth;
+        mMetrics.mMaxWaitMs = in_max_wait_ms;
+    }
+
+    GENERIC add_processor(ProcessorType* in_processor)
+    {
+        std::lock_guard<std::mutex> queueLock(mQueueSync);
+        mAvailableProcessors.push_back(in_processor);
+        ++mMetrics.mProcessorCount;
+    }
+
+    // in_wait_ms lowers the configured wait limit for this request, it can't raise it
+    acquire_result acquire(const mbase::string& in_client_key, const U32& in_wait_ms, ProcessorType*& out_processor)
+    {
+        std::unique_lock<std::mutex> queueLock(mQueueSync);
+        if(mAvailableProcessors.size())
+        {
+            out_processor = mAvailableProcessors.back();
+            mAvailableProcessors.pop_back();
+            _on_acquired(out_processor);
+            mWaitHistogram.record(0);
+            return acquire_result::ACQUIRED;
+        }
+
+        if(mMetrics.mQueueDepth >= mMetrics.mMaxQueueDepth)
+        {
+            ++mMetrics.mRejectedCount;
+            return acquire_result::QUEUE_FULL;
+        }
+
+        const U32 waitMs = std::min(in_wait_ms, mMetrics.mMaxWaitMs);
+        const clock_type::time_point enqueueTime = clock_type::now();
+        const clock_type::time_point deadlineTime = enqueueTime + std::chrono::milliseconds(waitMs);
+
+        queue_waiter queueWaiter;
+        waiter_list& clientWaiters = mClientWaiters[in_client_key];
+        if(!clientWaiters.size())
+        {
+            mClientRing.push_back(in_client_key);
+        }
+        clientWaiters.push_back(&queueWaiter);
+        ++mMetrics.mQueueDepth;
+        ++mMetrics.mQueuedCount;
+        mMetrics.mPeakQueueDepth = std::max(mMetrics.mPeakQueueDepth, mMetrics.mQueueDepth);
+
+        queueWaiter.mCondition.wait_until(queueLock, deadlineTime, [&queueWaiter]{ return queueWaiter.mProcessor != NULL; });
+
+        const U64 waitUs = static_cast<U64>(std::chrono::duration_cast<std::chrono::microseconds>(clock_type::now() - enqueueTime).count());
+        mMetrics.mTotalWaitUs += waitUs;
+        mMetrics.mPeakWaitUs = std::max(mMetrics.mPeakWaitUs, waitUs);
+
+        if(!queueWaiter.mProcessor)
+        {
+            // still queued, release() removes the waiter only when it hands out a processor
+            _remove_waiter(in_client_key, &queueWaiter);
+            --mMetrics.mQueueDepth;
+            ++mMetrics.mTimedOutCount;
+            return acquire_result::DEADLINE_EXCEEDED;
+        }
+
+        out_processor = queueWaiter.mProcessor;
+        _on_acquired(out_processor);
+        mWaitHistogram.record(waitUs);
+        return acquire_result::ACQUIRED;
+    }
+
+    GENERIC release(ProcessorType* in_processor)
+    {
+        std::lock_guard<std::mutex> queueLock(mQueueSync);
+        auto acquireIt = mAcquireTimes.find(in_processor);
+        if(acquireIt != mAcquireTimes.end())
+        {
+            // moving average of how long a request holds a processor, used for Retry-After
+            const F64 holdSeconds = std::chrono::duration<F64>(clock_type::now() - acquireIt->second).count();
+            mAverageHoldSeconds = mAverageHoldSeconds ? mAverageHoldSeconds * 0.8 + holdSeconds * 0.2 : holdSeconds;
+            mAcquireTimes.erase(acquireIt);
+        }
+
+        if(!mClientRing.size())
+        {
+            mAvailableProcessors.push_back(in_processor);
+            return;
+        }
+
+        mbase::string clientKey = mClientRing.front();
+        mClientRing.pop_front();
+        waiter_list& clientWaiters = mClientWaiters[clientKey];
+        queue_waiter* nextWaiter = clientWaiters.front();
+        clientWaiters.pop_front();
+        if(clientWaiters.size())
+        {
+            mClientRing.push_back(clientKey);
+        }
+        else
+        {
+            mClientWaiters.erase(clientKey);
+        }
+
+        --mMetrics.mQueueDepth;
+        nextWaiter->mProcessor = in_processor;
+        nextWaiter->mCondition.notify_one();
+    }
+
+    openai_queue_metrics get_metrics()
+    {
+        std::lock_guard<std::mutex> queueLock(mQueueSync);
+        openai_queue_metrics outMetrics = mMetrics;
+        outMetrics.mAvailableProcessors = static_cast<U32>(mAvailableProcessors.size());
+        return outMetrics;
+    }
+
+    // microseconds every admitted request waited for its processor, zero when one was free
+    const InfHistogram& get_wait_histogram() const
+    {
+        return mWaitHistogram;
+    }
+
+    // estimated seconds until a slot frees up, the queue is drained processor count requests at a time
+    U32 get_retry_after_seconds()
+    {
+        std::lock_guard<std::mutex> queueLock(mQueueSync);
+        const F64 drainRounds = static_cast<F64>(mMetrics.mQueueDepth + 1) / std::max(1u, mMetrics.mProcessorCount);
+        const F64 retrySeconds = std::ceil(drainRounds * mAverageHoldSeconds);
+        return static_cast<U32>(std::min(60.0, std::max(1.0, retrySeconds)));
+    }
+
+private:
+    struct queue_waiter {
+        std::condition_variable mCondition;
+        ProcessorType* mProcessor = NULL;
+    };
+    using waiter_list = std::deque<queue_waiter*>;
+
+    GENERIC _on_acquired(ProcessorType* in_processor)
+    {
+        ++mMetrics.mAdmittedCount;
+        mAcquireTimes[in_processor] = clock_type::now();
+    }
+
+    GENERIC _remove_waiter(const mbase::string& in_client_key, queue_waiter* in_waiter)
+    {
+        waiter_list& clientWaiters = mClientWaiters[in_client_key];
+        for(typename waiter_list::iterator It = clientWaiters.begin(); It != clientWaiters.end(); ++It)
+        {
+            if(*It == in_waiter)
+            {
+                clientWaiters.erase(It);
+                break;
+            }
+        }
+
+        if(clientWaiters.size())
+        {
+            return;
+        }
+
+        mClientWaiters.erase(in_client_key);
+        for(typename std::deque<mbase::string>::iterator It = mClientRing.begin(); It != mClientRing.end(); ++It)
+        {
+            if(*It == in_client_key)
+            {
+                mClientRing.erase(It);
+                break;
+            }
+        }
+    }
+
+    std::mutex mQueueSync;
+    mbase::vector<ProcessorType*> mAvailableProcessors;
+    std::unordered_map<mbase::string, waiter_list> mClientWaiters;
+    std::deque<mbase::string> mClientRing; // clients with queued requests, served round-robin
+    std::unordered_map<ProcessorType*, clock_type::time_point> mAcquireTimes;
+    openai_queue_metrics mMetrics;
+    InfHistogram mWaitHistogram;
+    F64 mAverageHoldSeconds = 0.0;
+};
+
+MBASE_END
+
+#endif // MBASE_OPENAI_PROCESSOR_QUEUE_H
@@ -1,11 +1,13 @@
 #include <mbase/inference/inf_embedder.h>
 #include <mbase/inference/inf_embedder_client.h>
 #include <mbase/inference/inf_t2t_model.h>
+#include <mbase/inference/inf_vector_store.h>
 #include <mbase/argument_get_value.h>
 #include <mbase/filesystem.h>
 #include <mbase/io_file.h>
 #include <mbase/json/json.h>
 #include <iostream>
+#include <unordered_map>
 
 #define MBASE_RETRIEVAL_VERSION "v0.1.0"
 
@@ -19,28 +21,26 @@ struct program_parameters {
     mbase::string mModelFile; // direct argument
     mbase::vector<mbase::string> mPromptFiles;
     mbase::string mQuery; // -q, --query
+    mbase::string mVectorStore; // -vs, --vector-store
+    I32 mTopK = 0; // -k, --top-k
     I32 mThreadCount = 16; // -t, --thread-count
     I32 mGpuLayer = 999; // -gl, --gpu-layers
 };
 
-struct prompt_file_data {
-    mbase::string mFileName;
-    F32 mSimilarityValue = 0.0f;
-
-    friend bool operator>(const prompt_file_data& in_lhs, const prompt_file_data& in_rhs)
-    {
-        return in_lhs.mSimilarityValue > in_rhs.mSimilarityValue;
-    }
-};
-
-mbase::set<prompt_file_data, std::greater<prompt_file_data>> gPromptFileData;
+InfVectorStore gVectorStore;
+std::unordered_map<U32, mbase::string> gRowFileNames; // rows of the files given in this run
 mbase::vector<F32> gQueryEmbeddingVector;
 mbase::vector<mbase::string>::iterator gPromptIt;
 program_parameters gSampleParams;
 mbase::string gModelName;
 bool gQueryEmbedded = false;
+U32 gReusedFileCount = 0;
+U32 gEmbeddedFileCount = 0;
 
 GENERIC print_usage();
+mbase::string make_store_key(const mbase::string& in_file_name, const mbase::string& in_content);
+bool is_requested_row(const InfVectorStore& in_store, const U32& in_row, PTRGENERIC in_user_data);
+GENERIC print_results();
 
 GENERIC print_usage()
 {
@@ -53,19 +53,66 @@ GENERIC print_usage()
     printf("An example program for generating using the embedder to retrieval operation on multiple text seperated by <embd_sep>.\n");
     printf("What this program does is that it takes a query from the user and creates the embeddings of the user input and all other texts.\n");
     printf("After the embeddings are generated, it applies the cosine similarity function to all embeddings and shows the distance of the query to each text.\n");
+    printf("If a vector store file is given, file embeddings are persisted in it and files that were embedded on a previous run are not embedded again.\n");
     printf("The code here is using the embedder.cpp's implementation as a base and makes slight modifications to it.\n");
     printf("========================================\n\n");
     printf("Usage: mbase_retrieval <model_path> *[<option> [<value>]]\n");
     printf("       mbase_retrieval model.gguf -q 'What is MBASE' -pf file1.txt -pf file2.txt -gl 80\n");
+    printf("       mbase_retrieval model.gguf -q 'What is MBASE' -pf file1.txt -pf file2.txt -vs corpus.mbvs -k 1\n");
     printf("Options: \n\n");
     printf("-h, --help                      Print usage.\n");
     printf("-v, --version                   Shows program version.\n");
     printf("-q, --query <str>               User query.\n");
     printf("-pf, --prompt-file <str>        File containing prompt(default=''). To give multiple prompt files, call this option multiple times.\n");
+    printf("-vs, --vector-store <str>       Vector store file to persist and reuse the file embeddings (default='', in memory).\n");
+    printf("-k, --top-k <int>               Amount of most similar files to show (default=0, all files).\n");
     printf("-t, --thread-count <int>        Threads used to compute embeddings (default=16).\n");
     printf("-gl, --gpu-layers <int>         GPU layers to offload to (default=999).\n\n");
 }
 
+mbase::string make_store_key(const mbase::string& in_file_name, const mbase::string& in_content)
+{
+    // content hash is a part of the key so that an edited file is embedded again instead of reusing a stale vector
+    U64 contentHash = 14695981039346656037ull;
+    for(const IBYTE& tmpChar : in_content)
+    {
+        contentHash ^= static_cast<U8>(tmpChar);
+        contentHash *= 1099511628211ull;
+    }
+    IBYTE hashString[32] = {0};
+    snprintf(hashString, sizeof(hashString), "#%016llx", static_cast<unsigned long long>(contentHash));
+    return in_file_name + hashString;
+}
+
+bool is_requested_row([[maybe_unused]] const InfVectorStore& in_store, const U32& in_row, [[maybe_unused]] PTRGENERIC in_user_data)
+{
+    // the store may hold files of previous runs, only the files given in this run are ranked
+    return gRowFileNames.find(in_row) != gRowFileNames.end();
+}
+
+GENERIC print_results()
+{
+    if(gVectorStore.is_persistent() && gVectorStore.get_log_row_count())
+    {
+        if(gVectorStore.save() != InfVectorStore::flags::INF_VS_SUCCESS)
+        {
+            printf("WARN: Unable to compact the vector store, new embeddings stay in its log.\n");
+        }
+    }
+
+    printf("INFO: %u file(s) embedded, %u file(s) reused from the vector store.\n", gEmbeddedFileCount, gReusedFileCount);
+
+    SIZE_T topK = gSampleParams.mTopK > 0 ? static_cast<SIZE_T>(gSampleParams.mTopK) : gRowFileNames.size();
+    inf_vector_search_options searchOptions;
+    searchOptions.mFilter = is_requested_row;
+    InfVectorStore::search_result_vector searchResults;
+    gVectorStore.search(gQueryEmbeddingVector.data(), topK, searchResults, searchOptions);
+    for(const inf_vector_search_result& tmpResult : searchResults)
+    {
+        printf("Similarity: %f, File: %s\n", tmpResult.mScore, gRowFileNames[tmpResult.mRow].c_str());
+    }
+}
+
 class EmbedderModel : public InfModelTextToText {
 public:
     GENERIC on_initialize_fail([[maybe_unused]] init_fail_code out_fail_code) override
@@ -117,7 +164,6 @@ public:
     GENERIC on_write(InfEmbedderProcessor* out_processor, PTRF32 out_embeddings, [[maybe_unused]] const U32& out_cursor, [[maybe_unused]] bool out_is_finished) override
     {
         const U32& embeddingLength = out_processor->get_embedding_length();
-        inf_common_embd_normalize(out_embeddings, out_embeddings, embeddingLength);
         if(!gQueryEmbedded)
         {
             for(U32 i = 0; i < embeddingLength; ++i)
@@ -128,8 +174,13 @@ public:
         }
         else
         {
-            mCurrentFd.mSimilarityValue = inf_common_cosine_similarity(gQueryEmbeddingVector.data(), out_embeddings, embeddingLength);
-            gPromptFileData.insert(mCurrentFd);
+            U32 storeRow = 0;
+            if(gVectorStore.add(out_embeddings, mCurrentKey, 0, &storeRow) == InfVectorStore::flags::INF_VS_ERR_UNABLE_TO_WRITE_FILE)
+            {
+                printf("WARN: Unable to append the embedding of %s to the vector store log.\n", mCurrentFileName.c_str());
+            }
+            gRowFileNames[storeRow] = mCurrentFileName;
+            ++gEmbeddedFileCount;
         }
     }
 
@@ -137,31 +188,39 @@ public:
     {
         InfEmbedderProcessor* hostProc = static_cast<InfEmbedderProcessor*>(out_processor);
 
-        if(gPromptIt != gSampleParams.mPromptFiles.end())
+        while(gPromptIt != gSampleParams.mPromptFiles.end())
         {
-            mCurrentFd.mFileName = *gPromptIt;
-            mbase::string promptString = mbase::read_file_as_string(mbase::from_utf8(*gPromptIt));
+            mCurrentFileName = *gPromptIt;
+            ++gPromptIt;
+            mbase::string promptString = mbase::read_file_as_string(mbase::from_utf8(mCurrentFileName));
+            mCurrentKey = make_store_key(mCurrentFileName, promptString);
+
+            U32 storeRow = 0;
+            if(gVectorStore.find_key(mCurrentKey, storeRow))
+            {
+                // embedded on a previous run, the vector is read from the store
+                gRowFileNames[storeRow] = mCurrentFileName;
+                ++gReusedFileCount;
+                continue;
+            }
+
             mbase::inf_text_token_vector tokVec;
             hostProc->tokenize_input(promptString, tokVec);
             if(hostProc->execute_input({tokVec}) == InfEmbedderProcessor::flags::INF_PROC_ERR_INPUT_EXCEED_TOKEN_LIMIT)
             {
-                printf("ERR: Given files (%s) prompt's token length is greater than embedder context length.\n", mCurrentFd.mFileName.c_str());
+                printf("ERR: Given files (%s) prompt's token length is greater than embedder context length.\n", mCurrentFileName.c_str());
                 exit(1);
             }
-            ++gPromptIt;
-        }
-        else
-        {
-            // ALL EMBEDDINGS ARE GENERATED, AND COSINE SIMILARITIES ARE CALCULATED.
-            for(prompt_file_data& tmpPrompt : gPromptFileData)
-            {
-                printf("Similarity: %f, File: %s\n", tmpPrompt.mSimilarityValue, tmpPrompt.mFileName.c_str());
-            }
-            exit(0);
+            return;
         }
+
+        // ALL EMBEDDINGS ARE GENERATED OR REUSED, RANK THEM AGAINST THE QUERY.
+        print_results();
+        exit(0);
     }
 private:
-    prompt_file_data mCurrentFd;
+    mbase::string mCurrentFileName;
+    mbase::string mCurrentKey;
 };
 
 int main(int argc, char** argv)
@@ -220,6 +279,16 @@ int main(int argc, char** argv)
             gSampleParams.mPromptFiles.push_back(tmpPromptFile);
         }
 
+        else if(argumentString == "-vs" || argumentString == "--vector-store")
+        {
+            mbase::argument_get<mbase::string>::value(i, argc, argv, gSampleParams.mVectorStore);
+        }
+
+        else if(argumentString == "-k" || argumentString == "--top-k")
+        {
+            mbase::argument_get<I32>::value(i, argc, argv, gSampleParams.mTopK);
+        }
+
         else if(argumentString == "-t" || argumentString == "--thread-count")
         {
             mbase::argument_get<I32>::value(i, argc, argv, gSampleParams.mThreadCount);
@@ -256,6 +325,28 @@ int main(int argc, char** argv)
         return 1;
     }
 
+    InfVectorStore::flags storeResult = InfVectorStore::flags::INF_VS_SUCCESS;
+    if(gSampleParams.mVectorStore.size())
+    {
+        storeResult = gVectorStore.open_store(gSampleParams.mVectorStore, embdModel.get_embedding_length());
+    }
+    else
+    {
+        storeResult = gVectorStore.initialize(embdModel.get_embedding_length());
+    }
+
+    if(storeResult == InfVectorStore::flags::INF_VS_ERR_DIMENSION_MISMATCH)
+    {
+        printf("ERR: Vector store (%s) was built with a different embedding model.\n", gSampleParams.mVectorStore.c_str());
+        return 1;
+    }
+
+    if(storeResult != InfVectorStore::flags::INF_VS_SUCCESS)
+    {
+        printf("ERR: Unable to open the vector store: %s\n", gSampleParams.mVectorStore.c_str());
+        return 1;
+    }
+
     U32 ctxLength = embdModel.get_max_embedding_context();
     embdModel.register_context_process(&embdProcessor, ctxLength, gSampleParams.mThreadCount);
 
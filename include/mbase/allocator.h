@@ -4,6 +4,8 @@
 #include <mbase/common.h>
 #include <utility> // std::forward
 #include <cstring>
+#include <cstddef> // std::max_align_t
+#include <new> // std::align_val_t
 MBASE_STD_BEGIN
 
 /* 
@@ -67,6 +69,10 @@ public:
 		::operator delete(src);
 	}
 
+	static MBASE_INLINE_EXPR GENERIC deallocate(pointer src, [[maybe_unused]] size_type in_amount) noexcept {
+		::operator delete(src);
+	}
+
 	template<class... Args>
 	static MBASE_INLINE_EXPR GENERIC construct(pointer src, Args&& ... args) noexcept 
 	{
@@ -130,16 +136,33 @@ public:
 	using const_void_pointer = CPTRGENERIC;
 	using difference_type = PTRDIFF;
 	using size_type = SIZE_T;
+
+	template<typename U>
+	struct rebind {
+		using other = allocator<U>;
+	};
+
+	/* ===== BUILDER METHODS BEGIN ===== */
+	MBASE_INLINE_EXPR allocator() noexcept = default;
+	template<typename U>
+	MBASE_INLINE_EXPR allocator([[maybe_unused]] const allocator<U>& in_rhs) noexcept {}
+	/* ===== BUILDER METHODS END ===== */
 	
 	/* ===== NON-MODIFIER METHODS BEGIN ===== */
 	MBASE_ND(MBASE_ALLOCATE_WARNING) MBASE_INLINE_EXPR T* allocate(size_type in_amount) const;
 	MBASE_ND(MBASE_ALLOCATE_WARNING) MBASE_INLINE_EXPR T* allocate(size_type in_amount, bool in_zero_memory) const;
 	MBASE_ND(MBASE_ALLOCATE_WARNING) MBASE_INLINE_EXPR T* allocate(size_type in_amount, const T* base) const;
 	MBASE_INLINE_EXPR GENERIC deallocate(T* src) const;
+	MBASE_INLINE_EXPR GENERIC deallocate(T* src, size_type in_amount) const;
 	template< class... Args >
 	MBASE_INLINE_EXPR GENERIC construct(T* src, Args&& ... args) const;
 	MBASE_INLINE_EXPR GENERIC destroy(T* src) const;
 	/* ===== NON-MODIFIER METHODS END ===== */
+
+	/* ===== OPERATOR NON-MEMBER FUNCTIONS BEGIN ===== */
+	friend MBASE_INLINE_EXPR bool operator==(const allocator&, const allocator&) noexcept { return true; }
+	friend MBASE_INLINE_EXPR bool operator!=(const allocator&, const allocator&) noexcept { return false; }
+	/* ===== OPERATOR NON-MEMBER FUNCTIONS END ===== */
 };
 
 template<typename T>
@@ -185,6 +208,12 @@ MBASE_INLINE_EXPR GENERIC allocator<T>::deallocate(T* src) const
 	::operator delete(src);
 }
 
+template<typename T>
+MBASE_INLINE_EXPR GENERIC allocator<T>::deallocate(T* src, [[maybe_unused]] size_type in_amount) const
+{
+	::operator delete(src);
+}
+
 template<typename T>
 MBASE_INLINE_EXPR GENERIC allocator<T>::destroy(T* src) const
 {
@@ -202,6 +231,620 @@ MBASE_INLINE_EXPR GENERIC allocator<T>::construct(T* src, Args && ...args) const
 	::new((void*)src) T(std::forward<Args>(args)...);
 }
 
+/*
+
+	--- CLASS INFORMATION ---
+Identification: S0C34-SAB-NA-ST
+
+Name: memory_resource
+
+Parent: None
+
+Behaviour List:
+- Abstract Interfaceable
+
+Description:
+memory_resource is the abstract source of raw memory for polymorphic_allocator,
+in the spirit of std::pmr::memory_resource.
+
+Containers that are instantiated with polymorphic_allocator take their memory from the
+memory_resource the allocator points to, instead of the global operator new.
+This makes it possible to serve the allocations of short lived objects, such as
+the objects that are built while handling a single request, from an arena or a pool.
+
+The byte count passed to deallocate may be zero, which means that the caller does not know
+the size of the block. Resources must handle this case.
+
+*/
+
+class memory_resource {
+public:
+	using size_type = SIZE_T;
+
+	/* ===== BUILDER METHODS BEGIN ===== */
+	virtual ~memory_resource() = default;
+	/* ===== BUILDER METHODS END ===== */
+
+	/* ===== NON-MODIFIER METHODS BEGIN ===== */
+	MBASE_ND(MBASE_ALLOCATE_WARNING) PTRGENERIC allocate(size_type in_bytes, size_type in_alignment = alignof(std::max_align_t))
+	{
+		return do_allocate(in_bytes, in_alignment);
+	}
+
+	GENERIC deallocate(PTRGENERIC in_ptr, size_type in_bytes = 0, size_type in_alignment = alignof(std::max_align_t))
+	{
+		if(!in_ptr)
+		{
+			return;
+		}
+		do_deallocate(in_ptr, in_bytes, in_alignment);
+	}
+
+	MBASE_ND(MBASE_RESULT_IGNORE) bool is_equal(const memory_resource& in_rhs) const noexcept
+	{
+		return do_is_equal(in_rhs);
+	}
+	/* ===== NON-MODIFIER METHODS END ===== */
+
+protected:
+	virtual PTRGENERIC do_allocate(size_type in_bytes, size_type in_alignment) = 0;
+	virtual GENERIC do_deallocate(PTRGENERIC in_ptr, size_type in_bytes, size_type in_alignment) = 0;
+	virtual bool do_is_equal(const memory_resource& in_rhs) const noexcept
+	{
+		return this == &in_rhs;
+	}
+};
+
+class new_delete_resource : public memory_resource {
+protected:
+	PTRGENERIC do_allocate(size_type in_bytes, size_type in_alignment) override
+	{
+		if(in_alignment > __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+		{
+			return ::operator new(in_bytes, std::align_val_t(in_alignment));
+		}
+		return ::operator new(in_bytes);
+	}
+
+	GENERIC do_deallocate(PTRGENERIC in_ptr, [[maybe_unused]] size_type in_bytes, size_type in_alignment) override
+	{
+		if(in_alignment > __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+		{
+			::operator delete(in_ptr, std::align_val_t(in_alignment));
+			return;
+		}
+		::operator delete(in_ptr);
+	}
+
+	bool do_is_equal(const memory_resource& in_rhs) const noexcept override
+	{
+		return dynamic_cast<const new_delete_resource*>(&in_rhs) != nullptr;
+	}
+};
+
+MBASE_INLINE memory_resource* get_new_delete_resource() noexcept
+{
+	static new_delete_resource gNewDeleteResource;
+	return &gNewDeleteResource;
+}
+
+/*
+
+	--- CLASS INFORMATION ---
+Identification: S0C35-OBJ-UD-ST
+
+Name: monotonic_buffer_resource
+
+Parent: S0C34-SAB-NA-ST
+
+Behaviour List:
+- Default Constructible
+- Destructible
+
+Description:
+monotonic_buffer_resource is an arena. Allocations are served by bumping a pointer
+inside a chunk and deallocation does nothing. When the chunk is exhausted, a new chunk which is twice as big
+as the previous one is requested from the upstream resource.
+
+All memory is given back at once by calling release or destroying the resource.
+After release, the next chunk size starts from the initial size again, so an arena
+that is released at the end of every request settles into a single upstream allocation per request.
+
+If an initial buffer is given, it is used first and never freed by the resource.
+
+The resource is not thread safe. It is meant to be owned by the code path handling a single request.
+
+*/
+
+class monotonic_buffer_resource : public memory_resource {
+public:
+	/* ===== BUILDER METHODS BEGIN ===== */
+	MBASE_INLINE MBASE_EXPLICIT monotonic_buffer_resource(memory_resource* in_upstream = get_new_delete_resource()) noexcept;
+	MBASE_INLINE MBASE_EXPLICIT monotonic_buffer_resource(size_type in_initial_size, memory_resource* in_upstream = get_new_delete_resource()) noexcept;
+	MBASE_INLINE monotonic_buffer_resource(PTRGENERIC in_buffer, size_type in_buffer_size, memory_resource* in_upstream = get_new_delete_resource()) noexcept;
+	monotonic_buffer_resource(const monotonic_buffer_resource&) = delete;
+	MBASE_INLINE ~monotonic_buffer_resource() override;
+	/* ===== BUILDER METHODS END ===== */
+
+	/* ===== OPERATOR BUILDER METHODS BEGIN ===== */
+	monotonic_buffer_resource& operator=(const monotonic_buffer_resource&) = delete;
+	/* ===== OPERATOR BUILDER METHODS END ===== */
+
+	/* ===== OBSERVATION METHODS BEGIN ===== */
+	MBASE_ND(MBASE_OBS_IGNORE) MBASE_INLINE memory_resource* upstream_resource() const noexcept;
+	MBASE_ND(MBASE_OBS_IGNORE) MBASE_INLINE size_type get_bytes_allocated() const noexcept;
+	MBASE_ND(MBASE_OBS_IGNORE) MBASE_INLINE size_type get_upstream_allocation_count() const noexcept;
+	/* ===== OBSERVATION METHODS END ===== */
+
+	/* ===== STATE-MODIFIER METHODS BEGIN ===== */
+	MBASE_INLINE GENERIC release() noexcept;
+	/* ===== STATE-MODIFIER METHODS END ===== */
+
+protected:
+	MBASE_INLINE PTRGENERIC do_allocate(size_type in_bytes, size_type in_alignment) override;
+	MBASE_INLINE GENERIC do_deallocate(PTRGENERIC in_ptr, size_type in_bytes, size_type in_alignment) override;
+
+private:
+	struct chunk_header {
+		chunk_header* next;
+		size_type size;
+	};
+
+	memory_resource* mUpstream;
+	chunk_header* mChunkList;
+	PTRGENERIC mInitialBuffer;
+	size_type mInitialBufferSize;
+	size_type mInitialChunkSize;
+	size_type mNextChunkSize;
+	IBYTEBUFFER mCurrent;
+	size_type mSpaceLeft;
+	size_type mBytesAllocated;
+	size_type mUpstreamAllocationCount;
+};
+
+MBASE_INLINE monotonic_buffer_resource::monotonic_buffer_resource(memory_resource* in_upstream) noexcept : monotonic_buffer_resource(1024, in_upstream)
+{
+}
+
+MBASE_INLINE monotonic_buffer_resource::monotonic_buffer_resource(size_type in_initial_size, memory_resource* in_upstream) noexcept :
+	mUpstream(in_upstream),
+	mChunkList(nullptr),
+	mInitialBuffer(nullptr),
+	mInitialBufferSize(0),
+	mInitialChunkSize(in_initial_size ? in_initial_size : 1024),
+	mNextChunkSize(mInitialChunkSize),
+	mCurrent(nullptr),
+	mSpaceLeft(0),
+	mBytesAllocated(0),
+	mUpstreamAllocationCount(0)
+{
+}
+
+MBASE_INLINE monotonic_buffer_resource::monotonic_buffer_resource(PTRGENERIC in_buffer, size_type in_buffer_size, memory_resource* in_upstream) noexcept :
+	mUpstream(in_upstream),
+	mChunkList(nullptr),
+	mInitialBuffer(in_buffer),
+	mInitialBufferSize(in_buffer_size),
+	mInitialChunkSize(in_buffer_size ? in_buffer_size * 2 : 1024),
+	mNextChunkSize(mInitialChunkSize),
+	mCurrent(static_cast<IBYTEBUFFER>(in_buffer)),
+	mSpaceLeft(in_buffer_size),
+	mBytesAllocated(0),
+	mUpstreamAllocationCount(0)
+{
+}
+
+MBASE_INLINE monotonic_buffer_resource::~monotonic_buffer_resource()
+{
+	release();
+}
+
+MBASE_ND(MBASE_OBS_IGNORE) MBASE_INLINE memory_resource* monotonic_buffer_resource::upstream_resource() const noexcept
+{
+	return mUpstream;
+}
+
+MBASE_ND(MBASE_OBS_IGNORE) MBASE_INLINE typename monotonic_buffer_resource::size_type monotonic_buffer_resource::get_bytes_allocated() const noexcept
+{
+	return mBytesAllocated;
+}
+
+MBASE_ND(MBASE_OBS_IGNORE) MBASE_INLINE typename monotonic_buffer_resource::size_type monotonic_buffer_resource::get_upstream_allocation_count() const noexcept
+{
+	return mUpstreamAllocationCount;
+}
+
+MBASE_INLINE GENERIC monotonic_buffer_resource::release() noexcept
+{
+	while(mChunkList)
+	{
+		chunk_header* nextChunk = mChunkList->next;
+		mUpstream->deallocate(mChunkList, mChunkList->size, alignof(std::max_align_t));
+		mChunkList = nextChunk;
+	}
+	mCurrent = static_cast<IBYTEBUFFER>(mInitialBuffer);
+	mSpaceLeft = mInitialBufferSize;
+	mNextChunkSize = mInitialChunkSize;
+	mBytesAllocated = 0;
+}
+
+MBASE_INLINE PTRGENERIC monotonic_buffer_resource::do_allocate(size_type in_bytes, size_type in_alignment)
+{
+	if(!in_bytes)
+	{
+		in_bytes = 1;
+	}
+
+	size_type alignmentPadding = (in_alignment - (reinterpret_cast<uintptr_t>(mCurrent) & (in_alignment - 1))) & (in_alignment - 1);
+	if(!mCurrent || alignmentPadding + in_bytes > mSpaceLeft)
+	{
+		size_type requiredSize = sizeof(chunk_header) + in_bytes + in_alignment;
+		size_type chunkSize = mNextChunkSize;
+		while(chunkSize < requiredSize)
+		{
+			chunkSize *= 2;
+		}
+
+		chunk_header* newChunk = static_cast<chunk_header*>(mUpstream->allocate(chunkSize, alignof(std::max_align_t)));
+		newChunk->next = mChunkList;
+		newChunk->size = chunkSize;
+		mChunkList = newChunk;
+		++mUpstreamAllocationCount;
+
+		mCurrent = reinterpret_cast<IBYTEBUFFER>(newChunk) + sizeof(chunk_header);
+		mSpaceLeft = chunkSize - sizeof(chunk_header);
+		mNextChunkSize = chunkSize * 2;
+		alignmentPadding = (in_alignment - (reinterpret_cast<uintptr_t>(mCurrent) & (in_alignment - 1))) & (in_alignment - 1);
+	}
+
+	IBYTEBUFFER outData = mCurrent + alignmentPadding;
+	mCurrent = outData + in_bytes;
+	mSpaceLeft -= alignmentPadding + in_bytes;
+	mBytesAllocated += in_bytes;
+	return outData;
+}
+
+MBASE_INLINE GENERIC monotonic_buffer_resource::do_deallocate([[maybe_unused]] PTRGENERIC in_ptr, [[maybe_unused]] size_type in_bytes, [[maybe_unused]] size_type in_alignment)
+{
+	// memory is given back on release
+}
+
+/*
+
+	--- CLASS INFORMATION ---
+Identification: S0C36-OBJ-UD-ST
+
+Name: node_pool_resource
+
+Parent: S0C34-SAB-NA-ST
+
+Behaviour List:
+- Destructible
+
+Description:
+node_pool_resource serves fixed-size blocks from chunks that are requested from the upstream resource,
+and keeps the deallocated blocks in a free list for reuse.
+It is meant for node based containers (list, set, unordered_map buckets) whose nodes all have the same size.
+
+Requests that are bigger than the block size, or that require stricter alignment than std::max_align_t, are
+forwarded to the upstream resource.
+
+Blocks are not returned to the upstream resource until release is called or the resource is destroyed.
+
+The resource is not thread safe.
+
+*/
+
+class node_pool_resource : public memory_resource {
+public:
+	/* ===== BUILDER METHODS BEGIN ===== */
+	MBASE_INLINE MBASE_EXPLICIT node_pool_resource(size_type in_block_size, size_type in_blocks_per_chunk = 256, memory_resource* in_upstream = get_new_delete_resource()) noexcept;
+	node_pool_resource(const node_pool_resource&) = delete;
+	MBASE_INLINE ~node_pool_resource() override;
+	/* ===== BUILDER METHODS END ===== */
+
+	/* ===== OPERATOR BUILDER METHODS BEGIN ===== */
+	node_pool_resource& operator=(const node_pool_resource&) = delete;
+	/* ===== OPERATOR BUILDER METHODS END ===== */
+
+	/* ===== OBSERVATION METHODS BEGIN ===== */
+	MBASE_ND(MBASE_OBS_IGNORE) MBASE_INLINE memory_resource* upstream_resource() const noexcept;
+	MBASE_ND(MBASE_OBS_IGNORE) MBASE_INLINE size_type get_block_size() const noexcept;
+	MBASE_ND(MBASE_OBS_IGNORE) MBASE_INLINE size_type get_blocks_in_use() const noexcept;
+	MBASE_ND(MBASE_OBS_IGNORE) MBASE_INLINE size_type get_upstream_allocation_count() const noexcept;
+	/* ===== OBSERVATION METHODS END ===== */
+
+	/* ===== STATE-MODIFIER METHODS BEGIN ===== */
+	MBASE_INLINE GENERIC release() noexcept;
+	/* ===== STATE-MODIFIER METHODS END ===== */
+
+protected:
+	MBASE_INLINE PTRGENERIC do_allocate(size_type in_bytes, size_type in_alignment) override;
+	MBASE_INLINE GENERIC do_deallocate(PTRGENERIC in_ptr, size_type in_bytes, size_type in_alignment) override;
+
+private:
+	struct free_block {
+		free_block* next;
+	};
+
+	struct chunk_header {
+		chunk_header* next;
+		size_type size;
+	};
+
+	MBASE_INLINE bool _is_owned(PTRGENERIC in_ptr) const noexcept;
+
+	memory_resource* mUpstream;
+	chunk_header* mChunkList;
+	free_block* mFreeList;
+	IBYTEBUFFER mCurrent;
+	size_type mBlocksLeft;
+	size_type mBlockSize;
+	size_type mBlocksPerChunk;
+	size_type mBlocksInUse;
+	size_type mUpstreamAllocationCount;
+};
+
+MBASE_INLINE node_pool_resource::node_pool_resource(size_type in_block_size, size_type in_blocks_per_chunk, memory_resource* in_upstream) noexcept :
+	mUpstream(in_upstream),
+	mChunkList(nullptr),
+	mFreeList(nullptr),
+	mCurrent(nullptr),
+	mBlocksLeft(0),
+	mBlockSize(0),
+	mBlocksPerChunk(in_blocks_per_chunk ? in_blocks_per_chunk : 1),
+	mBlocksInUse(0),
+	mUpstreamAllocationCount(0)
+{
+	const size_type blockAlignment = alignof(std::max_align_t);
+	if(in_block_size < sizeof(free_block))
+	{
+		in_block_size = sizeof(free_block);
+	}
+	mBlockSize = (in_block_size + blockAlignment - 1) & ~(blockAlignment - 1);
+}
+
+MBASE_INLINE node_pool_resource::~node_pool_resource()
+{
+	release();
+}
+
+MBASE_ND(MBASE_OBS_IGNORE) MBASE_INLINE memory_resource* node_pool_resource::upstream_resource() const noexcept
+{
+	return mUpstream;
+}
+
+MBASE_ND(MBASE_OBS_IGNORE) MBASE_INLINE typename node_pool_resource::size_type node_pool_resource::get_block_size() const noexcept
+{
+	return mBlockSize;
+}
+
+MBASE_ND(MBASE_OBS_IGNORE) MBASE_INLINE typename node_pool_resource::size_type node_pool_resource::get_blocks_in_use() const noexcept
+{
+	return mBlocksInUse;
+}
+
+MBASE_ND(MBASE_OBS_IGNORE) MBASE_INLINE typename node_pool_resource::size_type node_pool_resource::get_upstream_allocation_count() const noexcept
+{
+	return mUpstreamAllocationCount;
+}
+
+MBASE_INLINE GENERIC node_pool_resource::release() noexcept
+{
+	while(mChunkList)
+	{
+		chunk_header* nextChunk = mChunkList->next;
+		mUpstream->deallocate(mChunkList, mChunkList->size, alignof(std::max_align_t));
+		mChunkList = nextChunk;
+	}
+	mFreeList = nullptr;
+	mCurrent = nullptr;
+	mBlocksLeft = 0;
+	mBlocksInUse = 0;
+}
+
+MBASE_INLINE bool node_pool_resource::_is_owned(PTRGENERIC in_ptr) const noexcept
+{
+	CBYTEBUFFER targetPtr = static_cast<CBYTEBUFFER>(in_ptr);
+	for(chunk_header* currentChunk = mChunkList; currentChunk; currentChunk = currentChunk->next)
+	{
+		CBYTEBUFFER chunkBegin = reinterpret_cast<CBYTEBUFFER>(currentChunk);
+		if(targetPtr >= chunkBegin && targetPtr < chunkBegin + currentChunk->size)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+MBASE_INLINE PTRGENERIC node_pool_resource::do_allocate(size_type in_bytes, size_type in_alignment)
+{
+	if(in_bytes > mBlockSize || in_alignment > alignof(std::max_align_t))
+	{
+		return mUpstream->allocate(in_bytes, in_alignment);
+	}
+
+	++mBlocksInUse;
+	if(mFreeList)
+	{
+		free_block* outBlock = mFreeList;
+		mFreeList = mFreeList->next;
+		return outBlock;
+	}
+
+	if(!mBlocksLeft)
+	{
+		// header is padded to the block size so that every block stays aligned
+		size_type chunkSize = mBlockSize * (mBlocksPerChunk + 1);
+		chunk_header* newChunk = static_cast<chunk_header*>(mUpstream->allocate(chunkSize, alignof(std::max_align_t)));
+		newChunk->next = mChunkList;
+		newChunk->size = chunkSize;
+		mChunkList = newChunk;
+		++mUpstreamAllocationCount;
+
+		mCurrent = reinterpret_cast<IBYTEBUFFER>(newChunk) + mBlockSize;
+		mBlocksLeft = mBlocksPerChunk;
+	}
+
+	IBYTEBUFFER outData = mCurrent;
+	mCurrent += mBlockSize;
+	--mBlocksLeft;
+	return outData;
+}
+
+MBASE_INLINE GENERIC node_pool_resource::do_deallocate(PTRGENERIC in_ptr, size_type in_bytes, size_type in_alignment)
+{
+	bool isPoolBlock = false;
+	if(in_bytes)
+	{
+		isPoolBlock = in_bytes <= mBlockSize && in_alignment <= alignof(std::max_align_t);
+	}
+	else
+	{
+		// size is unknown, decide by the address
+		isPoolBlock = _is_owned(in_ptr);
+	}
+
+	if(!isPoolBlock)
+	{
+		mUpstream->deallocate(in_ptr, in_bytes, in_alignment);
+		return;
+	}
+
+	free_block* releasedBlock = static_cast<free_block*>(in_ptr);
+	releasedBlock->next = mFreeList;
+	mFreeList = releasedBlock;
+	--mBlocksInUse;
+}
+
+/*
+
+	--- CLASS INFORMATION ---
+Identification: S0C37-UTL-NA-ST
+
+Name: polymorphic_allocator
+
+Parent: None
+
+Behaviour List:
+- Allocate Aware
+- Templated
+- Type Aware
+
+Description:
+polymorphic_allocator has the same interface as the mbase::allocator, but it is stateful:
+it holds a pointer to a memory_resource and takes all of its memory from it.
+A default constructed polymorphic_allocator uses the new/delete resource.
+
+Passing a polymorphic_allocator to an mbase container makes the container, and the nodes
+it allocates internally, use the given memory resource:
+
+mbase::monotonic_buffer_resource requestArena(16384);
+mbase::polymorphic_allocator<mbase::string> requestAlloc(&requestArena);
+mbase::list<mbase::string, mbase::polymorphic_allocator<mbase::string>> kvals(requestAlloc);
+
+The memory resource must outlive every container that uses it.
+
+*/
+
+template<typename T>
+class polymorphic_allocator {
+public:
+	using value_type = T;
+	using pointer = T*;
+	using const_pointer = const pointer;
+	using void_pointer = PTRGENERIC;
+	using const_void_pointer = CPTRGENERIC;
+	using difference_type = PTRDIFF;
+	using size_type = SIZE_T;
+
+	template<typename U>
+	struct rebind {
+		using other = polymorphic_allocator<U>;
+	};
+
+	/* ===== BUILDER METHODS BEGIN ===== */
+	MBASE_INLINE polymorphic_allocator() noexcept : mResource(get_new_delete_resource()) {}
+	MBASE_INLINE polymorphic_allocator(memory_resource* in_resource) noexcept : mResource(in_resource ? in_resource : get_new_delete_resource()) {}
+	MBASE_INLINE polymorphic_allocator(const polymorphic_allocator& in_rhs) noexcept = default;
+	template<typename U>
+	MBASE_INLINE polymorphic_allocator(const polymorphic_allocator<U>& in_rhs) noexcept : mResource(in_rhs.resource()) {}
+	/* ===== BUILDER METHODS END ===== */
+
+	/* ===== OPERATOR BUILDER METHODS BEGIN ===== */
+	MBASE_INLINE polymorphic_allocator& operator=(const polymorphic_allocator& in_rhs) noexcept = default;
+	/* ===== OPERATOR BUILDER METHODS END ===== */
+
+	/* ===== OBSERVATION METHODS BEGIN ===== */
+	MBASE_ND(MBASE_OBS_IGNORE) MBASE_INLINE memory_resource* resource() const noexcept { return mResource; }
+	/* ===== OBSERVATION METHODS END ===== */
+
+	/* ===== NON-MODIFIER METHODS BEGIN ===== */
+	MBASE_ND(MBASE_ALLOCATE_WARNING) MBASE_INLINE T* allocate(size_type in_amount) const
+	{
+		if(in_amount <= 0)
+		{
+			return nullptr;
+		}
+		return static_cast<T*>(mResource->allocate(sizeof(value_type) * in_amount, alignof(value_type)));
+	}
+
+	MBASE_ND(MBASE_ALLOCATE_WARNING) MBASE_INLINE T* allocate(size_type in_amount, bool in_zero_memory) const
+	{
+		T* out_data = allocate(in_amount);
+		if(out_data && in_zero_memory)
+		{
+			memset(out_data, 0, sizeof(value_type) * in_amount);
+		}
+		return out_data;
+	}
+
+	MBASE_INLINE GENERIC deallocate(T* src) const
+	{
+		mResource->deallocate(src, 0, alignof(value_type));
+	}
+
+	MBASE_INLINE GENERIC deallocate(T* src, size_type in_amount) const
+	{
+		mResource->deallocate(src, sizeof(value_type) * in_amount, alignof(value_type));
+	}
+
+	template<class... Args>
+	MBASE_INLINE GENERIC construct(T* src, Args&& ... args) const
+	{
+		::new((void*)src) T(std::forward<Args>(args)...);
+	}
+
+	MBASE_INLINE GENERIC destroy(T* src) const
+	{
+		if(!src)
+		{
+			return;
+		}
+		src->~T();
+		deallocate(src, 1);
+	}
+	/* ===== NON-MODIFIER METHODS END ===== */
+
+	/* ===== OPERATOR NON-MEMBER FUNCTIONS BEGIN ===== */
+	friend MBASE_INLINE bool operator==(const polymorphic_allocator& in_lhs, const polymorphic_allocator& in_rhs) noexcept
+	{
+		return in_lhs.mResource == in_rhs.mResource || in_lhs.mResource->is_equal(*in_rhs.mResource);
+	}
+
+	friend MBASE_INLINE bool operator!=(const polymorphic_allocator& in_lhs, const polymorphic_allocator& in_rhs) noexcept
+	{
+		return !(in_lhs == in_rhs);
+	}
+	/* ===== OPERATOR NON-MEMBER FUNCTIONS END ===== */
+
+private:
+	memory_resource* mResource;
+};
+
+template<typename Allocator, typename T>
+using allocator_rebind_t = typename Allocator::template rebind<T>::other;
+
 MBASE_STD_END
 
 #endif // !MBASE_ALLOCATOR_H
@@ -24,6 +24,7 @@ struct inf_processor_watcher {
     typename mbase::list<inf_processor_watcher<TargetObject>>::iterator mItSelf;
     TargetObject* mSubject = NULL;
     U32 mContextLength = 0;
+    U64 mMemorySize = 0; // estimated kv cache bytes of the context
 };
 
 struct inf_token_description {
@@ -56,6 +57,14 @@ struct MBASE_API inf_lora_adapter {
 
 using lora_adapter_map = mbase::unordered_map<mbase::string, inf_lora_adapter>;
 
+// Element type of the K and V caches of a context.
+// A quantized V cache needs flash attention, the processor turns it on for such contexts.
+enum class inf_kv_cache_type : U8 {
+    F16,
+    Q8_0, // about half the size of F16
+    Q4_0 // about a quarter of the size of F16
+};
+
 // The rest is common functionality inspired from llama.cpp common library for examples
 // The set of functions will be populated as new needs are found
 
@@ -79,6 +88,50 @@ MBASE_API F32 inf_common_cosine_similarity(
     const I32& in_length
 );
 
+// Embedding math kernels below are dispatched at runtime to the widest
+// instruction set the CPU supports (AVX-512, AVX2+FMA, NEON or scalar).
+// Matrices are contiguous and row-major, one embedding per row.
+
+MBASE_API F32 inf_common_dot_product(
+    const PTRF32 in_data1,
+    const PTRF32 in_data2,
+    const SIZE_T& in_length
+);
+
+MBASE_API F32 inf_common_l2_norm(
+    const PTRF32 in_data,
+    const SIZE_T& in_length
+);
+
+// One query against every row of the matrix, out_scores must hold in_row_count floats.
+// If both sides are already normalized, the norms are skipped and the score is the dot product.
+MBASE_API GENERIC inf_common_cosine_similarity_batch(
+    const PTRF32 in_query,
+    const PTRF32 in_matrix,
+    const SIZE_T& in_row_count,
+    const SIZE_T& in_dimension,
+    PTRF32 out_scores,
+    bool in_is_normalized = false
+);
+
+// Every row of in_lhs against every row of in_rhs, out_scores is in_lhs_rows x in_rhs_rows row-major.
+MBASE_API GENERIC inf_common_cosine_similarity_matrix(
+    const PTRF32 in_lhs,
+    const SIZE_T& in_lhs_rows,
+    const PTRF32 in_rhs,
+    const SIZE_T& in_rhs_rows,
+    const SIZE_T& in_dimension,
+    PTRF32 out_scores,
+    bool in_is_normalized = false
+);
+
+// Name of the instruction set the kernels are dispatched to, for diagnostics
+MBASE_API MSTRING inf_common_simd_isa();
+
+MBASE_API ggml_type inf_common_kv_cache_ggml_type(inf_kv_cache_type in_type);
+MBASE_API MSTRING inf_common_kv_cache_type_string(inf_kv_cache_type in_type);
+MBASE_API bool inf_common_kv_cache_type_from_string(const mbase::string& in_string, inf_kv_cache_type& out_type); // "f16", "q8_0" or "q4_0"
+
 MBASE_API mbase::string inf_get_sys_name_total();
 
 MBASE_END
@@ -0,0 +1,43 @@
+#ifndef MBASE_INF_FUSED_SAMPLER_H
+#define MBASE_INF_FUSED_SAMPLER_H
+
+#include <mbase/common.h>
+#include <mbase/vector.h>
+#include <llama.h>
+
+MBASE_BEGIN
+
+struct inf_fused_sampler_params {
+    I32 mTopK = 0; // <= 0 disables
+    F32 mTopP = 1.0f; // >= 1 disables
+    F32 mMinP = 0.0f; // <= 0 disables
+    F32 mTemp = 1.0f; // <= 0 keeps the most probable token only
+};
+
+/*
+    InfFusedSampler does the work of the top-k, top-p, min-p and temperature samplers of a llama.cpp
+    sampler chain, in that order, with the same results, but without sorting or normalizing the whole
+    vocabulary at every stage.
+
+    A single pass over the logits keeps the k best candidates in a heap (or, without top-k, the
+    candidates that can pass min-p against the running maximum) while accumulating an online softmax
+    denominator. Only the surviving candidates are sorted, and only as far as top-p needs them.
+    On 150k+ vocabularies this leaves a few hundred candidates to sort instead of the whole array.
+
+    The result is sorted by logit when top-k or top-p is set, the temperature is applied to the logits and
+    the token is picked by the next sampler of the chain (dist, mirostat ...).
+*/
+
+class MBASE_API InfFusedSampler {
+public:
+    using candidate_vector = mbase::vector<llama_token_data>;
+
+    /* ===== NON-MEMBER FUNCTIONS BEGIN ===== */
+    static llama_sampler* init(const inf_fused_sampler_params& in_params); // free it with llama_sampler_free or through the owning chain
+    static GENERIC apply(const inf_fused_sampler_params& in_params, candidate_vector& in_scratch, llama_token_data_array* in_candidates);
+    /* ===== NON-MEMBER FUNCTIONS END ===== */
+};
+
+MBASE_END
+
+#endif // MBASE_INF_FUSED_SAMPLER_H
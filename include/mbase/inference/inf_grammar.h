@@ -0,0 +1,97 @@
+#ifndef MBASE_INF_GRAMMAR_H
+#define MBASE_INF_GRAMMAR_H
+
+#include <mbase/common.h>
+#include <mbase/string.h>
+#include <mbase/synchronization.h>
+#include <mbase/json/json.h>
+#include <llama.h>
+#include <deque>
+#include <unordered_map>
+
+MBASE_BEGIN
+
+/*
+    InfGrammar converts JSON-Schema documents into GBNF grammars that the llama.cpp grammar sampler
+    can enforce during decoding.
+
+    Supported keywords: type (also as a list), properties, required, items, prefixItems, minItems,
+    maxItems, minLength, maxLength, enum, const, anyOf, oneOf, allOf (of objects), $ref into
+    "#/definitions" or "#/$defs", additionalProperties (as a schema, when there are no properties).
+    Properties of an object are emitted in key order, required ones first, and properties that are not
+    listed are never generated. Unknown keywords (pattern, format, minimum ...) are ignored, the value
+    is then only constrained by its type.
+*/
+
+class MBASE_API InfGrammar {
+public:
+    enum class flags : U8 {
+        INF_GRAMMAR_SUCCESS,
+        INF_GRAMMAR_ERR_INVALID_JSON,
+        INF_GRAMMAR_ERR_INVALID_SCHEMA,
+        INF_GRAMMAR_ERR_UNRESOLVED_REF,
+        INF_GRAMMAR_ERR_UNABLE_TO_COMPILE
+    };
+
+    /* ===== NON-MEMBER FUNCTIONS BEGIN ===== */
+    static flags json_schema_to_gbnf(const mbase::string& in_schema, mbase::string& out_grammar);
+    static flags json_schema_to_gbnf(const mbase::Json& in_schema, mbase::string& out_grammar);
+    static mbase::string json_object_gbnf(); // any JSON object, for {"type": "json_object"} response formats
+    static U64 hash(const mbase::string& in_text, const mbase::string& in_salt = mbase::string()); // FNV-1a
+    /* ===== NON-MEMBER FUNCTIONS END ===== */
+};
+
+/*
+    Compiled grammars of a model, keyed by the hash of their source text.
+
+    Parsing a grammar and building its stacks against the vocabulary is by far the most expensive
+    part of constrained decoding setup. The cache keeps one compiled prototype sampler per distinct
+    grammar or JSON-Schema and hands out clones of it, so a schema that is sent with every request
+    is only compiled once per model.
+
+    Thread safe, the cache holds at most in_capacity prototypes and evicts the oldest one when full.
+*/
+
+class MBASE_API InfGrammarCache {
+public:
+    using flags = InfGrammar::flags;
+
+    /* ===== BUILDER METHODS BEGIN ===== */
+    InfGrammarCache(const U32& in_capacity = 64) noexcept;
+    ~InfGrammarCache();
+    InfGrammarCache(const InfGrammarCache&) = delete;
+    InfGrammarCache& operator=(const InfGrammarCache&) = delete;
+    /* ===== BUILDER METHODS END ===== */
+
+    /* ===== OBSERVATION METHODS BEGIN ===== */
+    MBASE_ND(MBASE_OBS_IGNORE) U32 get_size();
+    MBASE_ND(MBASE_OBS_IGNORE) U64 get_hit_count();
+    MBASE_ND(MBASE_OBS_IGNORE) U64 get_miss_count();
+    /* ===== OBSERVATION METHODS END ===== */
+
+    /* ===== STATE-MODIFIER METHODS BEGIN ===== */
+    // out_sampler is a fresh grammar sampler owned by the caller, free it with llama_sampler_free
+    flags acquire_grammar(const llama_vocab* in_vocab, const mbase::string& in_grammar, const mbase::string& in_root, llama_sampler*& out_sampler);
+    flags acquire_json_schema(const llama_vocab* in_vocab, const mbase::string& in_schema, llama_sampler*& out_sampler);
+    GENERIC clear();
+    /* ===== STATE-MODIFIER METHODS END ===== */
+
+private:
+    struct cache_entry {
+        mbase::string mSource; // grammar or schema text, compared on hit against hash collisions
+        llama_sampler* mPrototype;
+    };
+
+    flags _acquire(const llama_vocab* in_vocab, const mbase::string& in_source, const mbase::string& in_salt, const mbase::string& in_root, bool in_is_schema, llama_sampler*& out_sampler);
+
+    mbase::mutex mCacheMutex;
+    std::unordered_map<U64, cache_entry> mEntries;
+    std::deque<U64> mInsertionOrder;
+    U32 mCapacity;
+    U64 mHitCount;
+    U64 mMissCount;
+};
+
+MBASE_END
+
+#endif // MBASE_INF_GRAMMAR_H
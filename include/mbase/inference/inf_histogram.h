@@ -0,0 +1,69 @@
+#ifndef MBASE_INF_HISTOGRAM_H
+#define MBASE_INF_HISTOGRAM_H
+
+#include <mbase/common.h>
+#include <mbase/string.h>
+#include <atomic>
+
+MBASE_BEGIN
+
+/*
+    InfHistogram is a fixed size, log-linear bucketed histogram in the spirit of HdrHistogram.
+
+    Values below 64 have their own bucket, above that every power of two range is split into 32
+    buckets, so any recorded value is reported within ~3% of its real value. Values up to 2^36
+    are tracked (about 19 hours in microseconds), larger values are clamped into the last bucket.
+
+    Recording is lock-free, a single relaxed atomic increment on the bucket plus count, sum and max
+    updates. It is safe to record from the processor thread while another thread reads percentiles
+    or merges the histogram, the reader sees a consistent enough snapshot for reporting.
+*/
+
+class MBASE_API InfHistogram {
+public:
+    static constexpr U32 SUB_BUCKET_BITS = 5;
+    static constexpr U32 SUB_BUCKET_COUNT = 1 << SUB_BUCKET_BITS;
+    static constexpr U32 MAX_VALUE_BITS = 36;
+    static constexpr U32 BUCKET_COUNT = (MAX_VALUE_BITS - SUB_BUCKET_BITS + 1) * SUB_BUCKET_COUNT;
+
+    /* ===== BUILDER METHODS BEGIN ===== */
+    InfHistogram() noexcept;
+    InfHistogram(const InfHistogram&) = delete;
+    InfHistogram& operator=(const InfHistogram&) = delete;
+    /* ===== BUILDER METHODS END ===== */
+
+    /* ===== OBSERVATION METHODS BEGIN ===== */
+    MBASE_ND(MBASE_OBS_IGNORE) U64 get_count() const noexcept;
+    MBASE_ND(MBASE_OBS_IGNORE) U64 get_sum() const noexcept;
+    MBASE_ND(MBASE_OBS_IGNORE) U64 get_max() const noexcept;
+    MBASE_ND(MBASE_OBS_IGNORE) F64 get_mean() const noexcept;
+    MBASE_ND(MBASE_OBS_IGNORE) U64 get_percentile(const F64& in_quantile) const noexcept; // in_quantile is in [0, 1]
+    /* ===== OBSERVATION METHODS END ===== */
+
+    /* ===== STATE-MODIFIER METHODS BEGIN ===== */
+    GENERIC record(const U64& in_value) noexcept;
+    GENERIC merge(const InfHistogram& in_histogram) noexcept;
+    GENERIC reset() noexcept;
+    /* ===== STATE-MODIFIER METHODS END ===== */
+
+    /* ===== NON-MODIFIER METHODS BEGIN ===== */
+    // Prometheus text format, written as a summary. in_scale converts the recorded unit to the exported one
+    // (1e-6 for microseconds to seconds). in_labels is the label list without braces, may be empty.
+    static GENERIC write_prometheus_header(const mbase::string& in_name, const mbase::string& in_help, mbase::string& out_text);
+    GENERIC write_prometheus(const mbase::string& in_name, const mbase::string& in_labels, const F64& in_scale, mbase::string& out_text) const;
+    static mbase::string escape_prometheus_label(const mbase::string& in_value);
+    /* ===== NON-MODIFIER METHODS END ===== */
+
+    static U32 bucket_index(U64 in_value) noexcept;
+    static U64 bucket_upper_bound(const U32& in_index) noexcept;
+
+private:
+    std::atomic<U64> mBuckets[BUCKET_COUNT];
+    std::atomic<U64> mCount;
+    std::atomic<U64> mSum;
+    std::atomic<U64> mMax;
+};
+
+MBASE_END
+
+#endif // MBASE_INF_HISTOGRAM_H
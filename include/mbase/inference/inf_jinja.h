@@ -0,0 +1,96 @@
+#ifndef MBASE_INF_JINJA_H
+#define MBASE_INF_JINJA_H
+
+#include <mbase/common.h>
+#include <mbase/string.h>
+#include <mbase/inference/inf_context_line.h>
+#include <memory>
+
+MBASE_BEGIN
+
+struct inf_jinja_program;
+
+struct inf_chat_role_strings {
+    mbase::string mConversationStart; // rendered before the first message, the bos token if the template adds it
+    mbase::string mSystemStart;
+    mbase::string mSystemEnd;
+    mbase::string mUserStart;
+    mbase::string mUserEnd;
+    mbase::string mAssistantStart;
+    mbase::string mAssistantEnd;
+};
+
+/*
+    InfJinjaTemplate compiles the Jinja chat templates that are shipped in the GGUF files
+    (tokenizer.chat_template) into a flat bytecode program once, and renders conversations with it.
+
+    The subset is what the chat templates of real models use:
+    - {{ }}, {% %}, {# #} with the '-' whitespace control, trim_blocks and lstrip_blocks are on like in transformers.
+    - if/elif/else, for/else with loop.index, index0, revindex, revindex0, first, last, length and tuple unpacking,
+      set (also namespace attributes), generation blocks (ignored).
+    - Literals, lists, dicts, attribute and item access, slicing, arithmetic, ~, comparisons, in, and/or/not,
+      the conditional expression.
+    - Filters: trim, length, count, upper, lower, capitalize, title, string, int, float, default, tojson, join,
+      first, last, list, reverse, replace, safe, items, select, reject, selectattr, rejectattr, map(attribute=).
+    - Tests: defined, undefined, none, string, number, integer, float, boolean, mapping, sequence, iterable,
+      true, false, equalto, odd, even.
+    - Functions: raise_exception, namespace, range, strftime_now.
+    - String, list and dict methods like strip, split, startswith, endswith, replace, items, keys, values, get, append.
+
+    Macros, includes and custom filters are not supported, compile reports them as errors.
+    Names of filters, tests, functions and methods are resolved at compile time, the render loop only
+    dispatches on opcodes.
+*/
+
+class MBASE_API InfJinjaTemplate {
+public:
+    using size_type = SIZE_T;
+
+    enum class flags : U8 {
+        INF_JINJA_SUCCESS,
+        INF_JINJA_ERR_SYNTAX,
+        INF_JINJA_ERR_UNSUPPORTED,
+        INF_JINJA_ERR_NOT_COMPILED,
+        INF_JINJA_ERR_RENDER,
+        INF_JINJA_ERR_TEMPLATE_EXCEPTION, // the template called raise_exception
+        INF_JINJA_ERR_UNABLE_TO_EXTRACT
+    };
+
+    /* ===== BUILDER METHODS BEGIN ===== */
+    InfJinjaTemplate();
+    ~InfJinjaTemplate();
+    InfJinjaTemplate(const InfJinjaTemplate&) = delete;
+    InfJinjaTemplate& operator=(const InfJinjaTemplate&) = delete;
+    /* ===== BUILDER METHODS END ===== */
+
+    /* ===== OBSERVATION METHODS BEGIN ===== */
+    MBASE_ND(MBASE_OBS_IGNORE) bool is_compiled() const;
+    MBASE_ND(MBASE_OBS_IGNORE) const mbase::string& get_source() const;
+    MBASE_ND(MBASE_OBS_IGNORE) const mbase::string& get_last_error() const; // compile error, or the last render error
+    MBASE_ND(MBASE_OBS_IGNORE) size_type get_instruction_count() const;
+    /* ===== OBSERVATION METHODS END ===== */
+
+    /* ===== STATE-MODIFIER METHODS BEGIN ===== */
+    flags compile(const mbase::string& in_source);
+    GENERIC set_special_tokens(const mbase::string& in_bos_token, const mbase::string& in_eos_token);
+    GENERIC clear();
+    /* ===== STATE-MODIFIER METHODS END ===== */
+
+    /* ===== NON-MODIFIER METHODS BEGIN ===== */
+    flags render(const context_line* in_lines, size_type in_count, bool in_add_generation_prompt, mbase::string& out_text);
+    // Renders probe conversations and splits the output into the role header and footer strings.
+    // The system strings are the user strings if the template doesn't render system messages on their own.
+    flags extract_role_strings(inf_chat_role_strings& out_strings);
+    /* ===== NON-MODIFIER METHODS END ===== */
+
+private:
+    std::unique_ptr<inf_jinja_program> mProgram;
+    mbase::string mSource;
+    mbase::string mLastError;
+    mbase::string mBosToken;
+    mbase::string mEosToken;
+};
+
+MBASE_END
+
+#endif // MBASE_INF_JINJA_H
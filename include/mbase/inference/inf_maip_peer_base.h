@@ -20,12 +20,14 @@ public:
 	std::shared_ptr<mbase::PcNetPeerClient> get_maip_peer() const;
 	const mbase::string& get_maip_username() const;
 	const inf_model_category& get_peer_category() const;
+	bool is_binary_framing() const; // token stream is sent in binary MAIP frames
 	InfProcessorBase* get_processor_by_id(const U64& in_id);
 	mbase::vector<U64> get_processor_ids() const;
 
 	GENERIC add_processor(InfProcessorBase* in_address, U64& out_context_id);
 	GENERIC set_network_peer(std::shared_ptr<mbase::PcNetPeerClient> in_peer);
 	GENERIC set_maip_username(const mbase::string& in_username);
+	GENERIC set_binary_framing(bool in_is_binary);
 	GENERIC remove_processor_by_address(InfProcessorBase* in_address);
 	GENERIC remove_processor_by_id(const U64& in_id);
 
@@ -37,6 +39,7 @@ protected:
 	mbase::string mMaipUsername;
 	inf_model_category mPeerCategory;
 	U64 mContextCounter = 1;
+	bool mIsBinaryFraming = false;
 };
 
 MBASE_END
@@ -8,15 +8,17 @@ MBASE_BEGIN
 
 class InfMaipTextToTextProcessor;
 class InfMaipPeerTextToText;
+class maip_binary_frame_builder;
 
 class MBASE_API InfMaipTextToTextProcessor : public mbase::InfProcessorTextToText {
 public:
-    InfMaipTextToTextProcessor(InfMaipPeerTextToText* in_peer);
+    InfMaipTextToTextProcessor(InfMaipPeerTextToText* in_peer, const mbase::string& in_adapter = mbase::string());
     GENERIC on_initialize_fail(last_fail_code out_code) override;
 	GENERIC on_initialize() override;
 	GENERIC on_destroy() override;
 private:
     InfMaipPeerTextToText* mClientNominee;
+    mbase::string mAdapterName; // LoRA adapter the session is served with, empty for the base model
 };
 
 class MBASE_API InfMaipPeerTextToText : public mbase::InfMaipPeerBase, public mbase::InfClientTextToText {
@@ -29,8 +31,15 @@ public:
     GENERIC on_batch_processed(InfProcessorTextToText* out_processor, const U32& out_proc_batch_length, const bool& out_is_kv_locked) override;
     GENERIC on_write(InfProcessorTextToText* out_processor, const inf_text_token_vector& out_token, bool out_is_finish) override;
 	GENERIC on_finish(InfProcessorTextToText* out_processor, size_type out_total_token_size, InfProcessorTextToText::finish_state out_finish_state) override;
+    GENERIC resume_output(); // continues the generation paused because the peer didn't read its output
 private:
+    GENERIC _write_binary_frame(mbase::maip_binary_frame_builder& in_frame_builder);
+    GENERIC _write_text_token(U16 in_response_code, const inf_token_description& in_description);
+    GENERIC _add_binary_token(mbase::maip_binary_frame_builder& in_frame_builder, inf_text_token in_token, const inf_token_description& in_description); // a full frame is sent and a new one is started
+
     inf_token_description mLastToken;
+    inf_text_token mLastTokenId = 0;
+    InfProcessorTextToText* mPausedProcessor = NULL;
 };
 
 MBASE_END
@@ -17,32 +17,47 @@ class InfMaipDefaultServer;
 
 typedef bool (*maip_request_callback)(InfProgram&, std::shared_ptr<PcNetPeerClient>, const maip_peer_request&, const mbase::string&, maip_packet_builder&);
 
-struct MBASE_API InfMaipPacketAccumulator {
-	U64 mDataToRead;
-	mbase::string mSessionToken;
-	mbase::string mAccumulatedData;
-	maip_peer_request mPeerRequest;
+/*
+	Requests are framed in place: the header is parsed from the receive buffer and the body is handed
+	to the callbacks as a view into it. Only a request that doesn't arrive in a single read is copied
+	into mPendingData, until it is complete. Multiple requests in one read are processed in order.
+
+	A server that runs on a reactor shard (PcNetReactorGroup) frames the requests on the shard thread and,
+	with a handoff queue set, posts the complete requests instead of dispatching them. The thread that owns
+	the program calls dispatch_handoff on any of the servers to process them.
+*/
+struct MBASE_API InfMaipRequestFramer {
+	U64 mDiscardLength = 0; // body bytes of a refused request that are still to be skipped
+	mbase::string mPendingData;
 };
 
 class MBASE_API InfMaipServerBase : public mbase::PcNetTcpServer {
 public:
-	using accumulation_map = std::unordered_map<PcNetPeerClient::socket_handle, InfMaipPacketAccumulator>;
+	using framer_map = std::unordered_map<PcNetPeerClient::socket_handle, InfMaipRequestFramer>;
 	using request_callback_map = std::unordered_map<mbase::string, maip_request_callback>;
 
 	GENERIC on_accept(std::shared_ptr<PcNetPeerClient> out_peer) override;
 	GENERIC on_data(std::shared_ptr<PcNetPeerClient> out_peer, CBYTEBUFFER out_data, size_type out_size) override;
 	GENERIC on_disconnect(std::shared_ptr<PcNetPeerClient> out_peer) override;
+	GENERIC on_write_drained(std::shared_ptr<PcNetPeerClient> out_peer) override;
 
 	virtual GENERIC on_informatic_request(const maip_peer_request& out_request, std::shared_ptr<PcNetPeerClient> out_peer) = 0;
 	virtual GENERIC on_execution_request(const maip_peer_request& out_request, std::shared_ptr<PcNetPeerClient> out_peer) = 0;
 	virtual GENERIC on_custom_request(const maip_peer_request& out_request, std::shared_ptr<PcNetPeerClient> out_peer) = 0;
+	virtual GENERIC on_output_drained(std::shared_ptr<PcNetPeerClient> out_peer); // on_write_drained, on the thread requests are dispatched from
+
+	GENERIC set_handoff(PcNetHandoffQueue* in_handoff) noexcept;
+	GENERIC dispatch_handoff(PcNetHandoffQueue& in_handoff);
 protected:
 
 	GENERIC register_request_callback(const mbase::string& in_operation, maip_request_callback in_callback);
-	GENERIC accumulated_processing(std::shared_ptr<PcNetPeerClient> out_peer, accumulation_map::iterator in_accum_iterator, CBYTEBUFFER out_data, size_type out_size);
-	GENERIC simple_processing(std::shared_ptr<PcNetPeerClient> out_peer, CBYTEBUFFER out_data, size_type out_size);
-	accumulation_map mAccumulationMap;
+	size_type frame_requests(std::shared_ptr<PcNetPeerClient> out_peer, InfMaipRequestFramer& in_framer, CBYTEBUFFER in_data, size_type in_size); // returns the consumed bytes
+	GENERIC dispatch_request(std::shared_ptr<PcNetPeerClient> out_peer, const maip_peer_request& in_request);
+	GENERIC send_generic_error(std::shared_ptr<PcNetPeerClient> out_peer, maip_generic_errors in_error);
+	framer_map mFramerMap;
 	request_callback_map mRequestCbMap;
+	PcNetHandoffQueue* mHandoff = NULL;
+	PcNetHandoffQueue::event_list mHandoffEvents;
 };
 
 class MBASE_API InfMaipDefaultServer : public mbase::InfMaipServerBase {
@@ -54,6 +69,7 @@ public:
 	GENERIC on_execution_request(const maip_peer_request& out_request, std::shared_ptr<PcNetPeerClient> out_peer) override;
 	GENERIC on_custom_request([[maybe_unused]] const maip_peer_request& out_request, [[maybe_unused]] std::shared_ptr<PcNetPeerClient> out_peer) override;
 
+	GENERIC on_output_drained(std::shared_ptr<PcNetPeerClient> out_peer) override;
 	GENERIC on_listen() override;
 	GENERIC on_stop() override;
 private:
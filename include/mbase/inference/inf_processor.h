@@ -77,6 +77,8 @@ public:
 		INF_PROC_ERR_MISSING_CLIENT,
 		INF_PROC_ERR_SAMPLER_NAME_MISMATCH,
 		INF_PROC_ERR_OPERATION_NOT_SUPPORTED,
+		INF_PROC_ERR_INVALID_GRAMMAR,
+		INF_PROC_ERR_LORA_MISSING,
 		INF_PROC_INFO_INITIALIZING,
 		INF_PROC_INFO_DESTROYING,
 		INF_PROC_INFO_HALTED,
@@ -95,6 +95,8 @@ public:
 		INF_MODEL_NOT_LOADED = 2029,
 		INF_LOADING_MODEL = 2030,
 		INF_MODEL_UNAVAILABLE = 2031,
+		INF_LORA_ADAPTER_MISSING = 2032,
+		INF_MODEL_MEMORY_BUDGET_EXCEEDED = 2033,
 		EXEC_SUCCESS = 3000,
 		EXEC_ALREADY_PROCESSING = 3001,
 		EXEC_MESSAGE_ID_MISMATCH = 3002,
@@ -108,6 +110,7 @@ public:
 	};
 
 	bool is_session_token_valid(const mbase::string& in_session_token);
+	GENERIC resume_peer_output(std::shared_ptr<PcNetPeerClient> in_peer); // the peer drained its output, paused sessions continue
 	#ifdef MBASE_INTERNAL_API
 	accepted_client_map& get_accepted_clients();
 	registered_model_map& get_registered_models();
@@ -117,7 +120,7 @@ public:
 	maip_err_code inf_destroy_session(const mbase::string& in_session_token);
 	maip_err_code inf_get_accessible_models(const mbase::string& in_session_token, mbase::vector<mbase::string>& out_models);
 	maip_err_code inf_get_context_ids(const mbase::string& in_session_token, mbase::vector<U64>& out_contexts);
-	maip_err_code inf_create_context(const mbase::string& in_session_token, std::shared_ptr<mbase::PcNetPeerClient> in_peer, const mbase::string& in_model, const U32& in_ctsize);
+	maip_err_code inf_create_context(const mbase::string& in_session_token, std::shared_ptr<mbase::PcNetPeerClient> in_peer, const mbase::string& in_model, const U32& in_ctsize, const mbase::string& in_adapter = mbase::string(), inf_kv_cache_type in_key_type = inf_kv_cache_type::F16, inf_kv_cache_type in_value_type = inf_kv_cache_type::F16, bool in_flash_attention = true); // in_adapter: LoRA adapter of the model the context is served with
 	maip_err_code inf_clear_context_history(const mbase::string& in_session_token);
 	maip_err_code inf_get_context_status(const mbase::string& in_session_token, const U64& in_ctxId);
 	maip_err_code inf_destroy_context(const mbase::string& in_session_token, const U64& in_ctxId);
@@ -204,8 +207,9 @@ public:
 	maip_err_code exec_set_input(const mbase::string& in_session_token, const U64& in_ctxId, mbase::context_role in_role, const mbase::string& in_input, U32& out_msgid);
 	maip_err_code exec_set_input(const mbase::string& in_session_token, const U64& in_ctxId, mbase::context_role in_role, CBYTEBUFFER in_input, const size_type& in_length, U32& out_msgid);
 	maip_err_code exec_execute_input(const mbase::string& in_session_token, const U64& in_ctxId, mbase::vector<U32>& in_msgid); // TODO: CHANGE CONTENT
-	maip_err_code exec_next(const mbase::string& in_session_token, std::shared_ptr<mbase::PcNetPeerClient> in_peer, const U64& in_ctxId);
+	maip_err_code exec_next(const mbase::string& in_session_token, std::shared_ptr<mbase::PcNetPeerClient> in_peer, const U64& in_ctxId, bool in_binary_framing = false);
 
+	GENERIC write_prometheus_metrics(mbase::string& out_text); // T2T processor histograms of every hosted model
 	GENERIC push_dead_model(InfModelBase& in_model);
 	GENERIC push_dead_processor(InfProcessorBase& in_processor);
 	GENERIC initialize(InfProgramInformation in_program_information);
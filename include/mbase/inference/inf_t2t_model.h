@@ -4,11 +4,25 @@
 #include <mbase/inference/inf_model.h>
 #include <mbase/inference/inf_sampling_set.h>
 #include <mbase/inference/inf_device_desc.h>
+#include <mbase/inference/inf_grammar.h>
+#include <mbase/inference/inf_jinja.h>
+#include <mbase/inference/inf_context_line.h>
 
 MBASE_BEGIN
 
 class InfProcessorTextToText;
 class InfEmbedderProcessor;
+class InfProcT2TDiagnostics;
+struct inf_t2t_diagnostics_source;
+
+// A static piece of the chat prompt (role header, footer or the conversation start), tokenized once at model load.
+// A fragment that begins or ends with a special token can be concatenated with its neighbours as tokens.
+struct inf_chat_fragment {
+	mbase::string mText;
+	inf_text_token_vector mTokens;
+	bool mBeginsSpecial = false;
+	bool mEndsSpecial = false;
+};
 
 class MBASE_API InfModelTextToText : public InfModelBase {
 public:
@@ -39,6 +53,7 @@ public:
 		INF_MODEL_ERR_LORA_FILE_INVALID,
 		INF_MODEL_ERR_LORA_OPERATION_ACTIVE,
 		INF_MODEL_ERR_LORA_NOTHING_TO_OPERATE,
+		INF_MODEL_ERR_MEMORY_BUDGET_EXCEEDED,
 		INF_MODEL_ERR_GENERIC
 	};
 
@@ -50,11 +65,12 @@ public:
 	/* ===== OBSERVATION METHODS BEGIN ===== */
 	MBASE_ND(MBASE_OBS_IGNORE) bool signal_lora_operation() const;
 	MBASE_ND(MBASE_OBS_IGNORE) bool signal_state_lora_operation() const;
-	MBASE_ND(MBASE_OBS_IGNORE) bool is_available(const U32& in_context_size) const;
+	MBASE_ND(MBASE_OBS_IGNORE) bool is_available(const U32& in_context_size, inf_kv_cache_type in_key_type = inf_kv_cache_type::F16, inf_kv_cache_type in_value_type = inf_kv_cache_type::F16) const;
 	MBASE_ND(MBASE_OBS_IGNORE) bool is_embedding_model() const;
 	MBASE_ND(MBASE_OBS_IGNORE) bool has_lora_adapter(const mbase::string& in_name, inf_lora_adapter& out_adapter);
 	mbase::vector<inf_lora_adapter> get_adapters() const;
 	llama_model* get_raw_model();
+	InfGrammarCache& get_grammar_cache();
 	mbase::vector<inf_text_token> get_special_tokens() const;
 	mbase::vector<mbase::string> get_special_tokens_string() const;
 	const mbase::string& get_model_name() const;
@@ -65,6 +81,11 @@ public:
 	const mbase::string& get_sys_end() const;
 	const mbase::string& get_assistant_end() const;
 	const mbase::string& get_usr_end() const;
+	const inf_chat_fragment& get_role_start_fragment(context_role in_role) const;
+	const inf_chat_fragment& get_role_end_fragment(context_role in_role) const;
+	const inf_chat_fragment& get_conversation_start_fragment() const;
+	InfJinjaTemplate& get_chat_template(); // compiled tokenizer.chat_template of the model, not compiled if the model has none
+	bool is_chat_template_embedded() const; // role strings are derived from the model's own template instead of the architecture table
 	inf_text_token get_eot_token() const;
 	inf_text_token get_lf_token() const;
 	I32 get_vocab_count() const;
@@ -79,6 +100,9 @@ public:
 	const mbase::string& get_quantization_string() const;
 	const U32& get_total_context_size() const;
 	const U32& get_occupied_context_size() const;
+	U64 get_kv_cache_size(const U32& in_context_length, inf_kv_cache_type in_key_type = inf_kv_cache_type::F16, inf_kv_cache_type in_value_type = inf_kv_cache_type::F16) const; // estimated bytes of a context's kv cache
+	U64 get_occupied_memory() const; // model weights plus the kv caches of the registered contexts, in bytes
+	const U64& get_memory_budget() const;
 	/* ===== OBSERVATION METHODS END ===== */
 
 	/* ===== NON-MEMBER FUNCTIONS BEGIN ===== */
@@ -92,6 +116,7 @@ public:
 	flags initialize_model_sync(const mbase::wstring& in_path, const U32& in_total_context_size, const I32& in_gpu_layers = -1);
 	flags destroy();
 	flags destroy_sync();
+	GENERIC set_memory_budget(const U64& in_bytes); // contexts exceeding it are refused, 0 is unlimited
 	flags register_context_process(
 		InfProcessorTextToText* in_processor, 
 		const U32& in_context_length,
@@ -117,6 +142,8 @@ public:
 
 	/* ===== NON-MODIFIER METHODS BEGIN ===== */
 	flags tokenize_input(CBYTEBUFFER in_data, size_type in_size, inf_text_token_vector& out_tokens);
+	GENERIC merge_processor_diagnostics(InfProcT2TDiagnostics& out_diagnostics); // histograms of every T2T processor of the model
+	GENERIC append_diagnostics_sources(const mbase::string& in_labels, mbase::vector<inf_t2t_diagnostics_source>& out_sources); // one source per T2T processor, labeled with in_labels and processor, the caller deletes their snapshots
 	/* ===== NON-MODIFIER METHODS END ===== */
 
 	/* ===== INTERFACE METHODS BEGIN ===== */
@@ -132,6 +159,8 @@ private:
 	GENERIC _initialize_model();
 	GENERIC _destroy_model();
 	GENERIC _lora_operate();
+	GENERIC _free_retired_adapters();
+	GENERIC _initialize_chat_template();
 
 	llama_model* mModel;
 	mbase::string mQuantizationString;
@@ -144,6 +173,11 @@ private:
 	mbase::string mSystemEnd;
 	mbase::string mAssistantEnd;
 	mbase::string mUserEnd;
+	InfJinjaTemplate mChatTemplate;
+	inf_chat_fragment mConversationStart;
+	inf_chat_fragment mRoleStartFragments[3]; // indexed by context_role, SYSTEM, ASSISTANT and USER
+	inf_chat_fragment mRoleEndFragments[3];
+	bool mIsChatTemplateEmbedded;
 	mbase::wstring mModelPath;
 	llama_model_params mSuppliedParams;
 	inf_text_token mEndOfToken;
@@ -151,9 +185,14 @@ private:
 	mbase::vector<inf_lora_adapter> mLoraDeclares;
 	mbase::vector<inf_lora_adapter> mLoraRemoves;
 	mbase::vector<inf_lora_adapter> mLoraAdapters;
+	mbase::vector<inf_lora_adapter> mRetiredAdapters; // removed from the model, freed once no processor has them attached
+	mutable mbase::mutex mLoraMutex; // guards the adapter lists read by the processors
+	InfGrammarCache mGrammarCache;
 	U64 mModelSize;
 	U32 mOccupiedContext;
 	U32 mTotalContextSize;
+	U64 mOccupiedKvMemory;
+	U64 mMemoryBudget;
 	F32 mQuantizationCoefficient;
 	bool mIsEmbeddingModel; // Not supported if (llama_model_has_encoder(model) && llama_model_has_decoder(model) is true)
 	processor_signal mLoraOperationSignal;
@@ -2,19 +2,55 @@
 #define MBASE_INF_T2T_PROC_DIAGNOSTICS
 
 #include <mbase/inference/inf_common.h>
+#include <mbase/inference/inf_histogram.h>
 #include <mbase/pc/pc_diagnostics.h>
+#include <mbase/vector.h>
 
 MBASE_BEGIN
 
+class InfProcT2TDiagnostics;
+
+struct inf_t2t_diagnostics_source {
+    mbase::string mLabels; // prometheus labels without braces, e.g model="x",processor="0"
+    const InfProcT2TDiagnostics* mDiagnostics = NULL; // a snapshot owned by whoever filled the source, the processor may be gone by the time it is written
+};
+
+/*
+    Averaged rates are kept for the existing reports, the histograms below hold the distributions.
+    Times are recorded in microseconds:
+
+    queueTimeMicroseconds: from execute_input until the processor thread starts decoding the input.
+    timeToFirstTokenMicroseconds: from execute_input until the first token of the response is sampled.
+    interTokenMicroseconds: between two consecutive sampled tokens of the same response.
+    samplingMicroseconds: time spent in the sampler chain for every sampled token.
+    decodeStepMicroseconds: duration of every llama_decode call, prompt batches and generation steps alike.
+    batchSize: token count of every llama_decode call.
+    kvOccupancyPercent: context fill percentage after every llama_decode call.
+*/
+
 class MBASE_API InfProcT2TDiagnostics : public mbase::PcDiagnostics {
 public:
     InfProcT2TDiagnostics();
 
+    GENERIC merge(const InfProcT2TDiagnostics& in_diagnostics) noexcept;
+    GENERIC reset_histograms() noexcept;
+
+    // writes every histogram of every source, grouped by metric as the prometheus text format requires
+    static GENERIC write_prometheus(const mbase::string& in_prefix, const mbase::vector<inf_t2t_diagnostics_source>& in_sources, mbase::string& out_text);
+
     I64 loadTimeInMilliseconds;
     F32 ppTokensPerSecond;
     F32 evalTokensPerSecond;
+
+    InfHistogram queueTimeMicroseconds;
+    InfHistogram timeToFirstTokenMicroseconds;
+    InfHistogram interTokenMicroseconds;
+    InfHistogram samplingMicroseconds;
+    InfHistogram decodeStepMicroseconds;
+    InfHistogram batchSize;
+    InfHistogram kvOccupancyPercent;
 };
 
 MBASE_END
 
-#endif // MBASE_INF_T2T_PROC_DIAGNOSTICS
\ No newline at end of file
+#endif // MBASE_INF_T2T_PROC_DIAGNOSTICS
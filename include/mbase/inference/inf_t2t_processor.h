@@ -6,6 +6,8 @@
 #include <mbase/inference/inf_sampling_set.h>
 #include <mbase/inference/inf_context_line.h>
 #include <mbase/inference/inf_t2t_proc_diagnostics.h>
+#include <chrono>
+#include <atomic>
 
 MBASE_BEGIN
 
@@ -15,6 +17,11 @@ struct decode_behavior_description {
 	bool mHaltOnWrite = false;
 };
 
+struct inf_tokenized_chunk {
+	mbase::string mText; // template rendered messages of the chunk
+	inf_text_token_vector mTokens;
+};
+
 class InfModelTextToText;
 
 class MBASE_API InfProcessorTextToText : public mbase::InfProcessorBase {
@@ -38,11 +45,15 @@ public:
 	InfProcT2TDiagnostics& get_diagnostics();
 	last_fail_code get_last_fail_code() const;
 	cache_mode get_manual_cache_mode() const;
+	inf_kv_cache_type get_key_cache_type() const;
+	inf_kv_cache_type get_value_cache_type() const;
 	bool is_benchmark() const;
 	bool is_update_required() const;
 	bool is_init_failed() const;
 	bool is_available() const;
 	bool is_manual_caching() const;
+	bool has_grammar() const;
+	mbase::vector<inf_lora_adapter> get_assigned_adapters();
 	bool signal_state_lora_operate() const;
 	bool signal_state_input_process() const;
 	bool signal_state_decode_process() const;
@@ -57,6 +68,7 @@ public:
 	const U32& get_batch_size() const;
 	const U32& get_max_token_length() const;
 	const U32& get_context_cursor_position() const;
+	const U32& get_reused_token_count() const; // tokens of the last input that were already in the kv cache
 	I32 get_cache_token_count() const;
 	I32 get_batch_thread_count() const;
 	I32 get_thread_count() const;
@@ -74,9 +86,12 @@ public:
 	flags next_sync(const decode_behavior_description& in_description);
 	flags clear_response();
 	flags set_inference_client(InfClientBase* in_client) override;
-	flags declare_lora_assign(const inf_lora_adapter& in_adapter);
+	flags declare_lora_assign(const inf_lora_adapter& in_adapter); // the adapter must be loaded by the model, only its name is used
 	flags declare_lora_remove(const inf_lora_adapter& in_adapter);
-	flags start_lora_operation();
+	flags start_lora_operation(); // applied by the processor thread at the next decode step boundary
+	flags select_lora_adapter(const mbase::string& in_name); // only the named adapter stays attached, empty name serves the base model
+	flags set_grammar(const mbase::string& in_grammar, const mbase::string& in_root = "root"); // GBNF, applies to every input until cleared
+	flags set_json_schema(const mbase::string& in_schema);
 	flags initialize(
 		InfModelTextToText* in_model, 
 		const U32& in_context_length, 
@@ -102,8 +117,11 @@ public:
 	GENERIC set_benchmark(bool in_is_on);
 	GENERIC clear_token_candidates();
 	GENERIC clear_samplers();
+	GENERIC clear_grammar();
 	GENERIC clear_kv_cache();
+	GENERIC clear_tokenization_cache();
 	GENERIC set_manual_caching(bool in_manual_cache, cache_mode in_cache_mode = cache_mode::AUTO_LOGIT_STORE_MODE);
+	GENERIC set_kv_cache_types(inf_kv_cache_type in_key_type, inf_kv_cache_type in_value_type); // call before registering the processor
 	GENERIC update() override;
 	GENERIC update_t() override;
 
@@ -114,31 +132,43 @@ public:
 	virtual GENERIC on_initialize() = 0;
 	virtual GENERIC on_destroy() = 0;
 
-	// this is an internal call, do not call it manually
+	// these are internal calls, do not call them manually
 	GENERIC _internal_adapter_remove(mbase::vector<inf_lora_adapter>& in_adapters_to_remove);
+	bool _internal_is_adapter_attached(llama_adapter_lora* in_handle);
 
 private:
+	I64 _timed_decode(llama_batch& in_batch); // returns the decode duration in microseconds
+	bool _is_kv_tracked() const; // kv prefix of the next input is reused, off in logit store mode
+	size_type _reuse_kv_prefix();
+	inf_text_token _sample_token();
+	GENERIC _fill_sample_candidates();
 	GENERIC _decode_cached_logits();
 	GENERIC _decode_kv_locked_input();
 	GENERIC _decode_input();
 	GENERIC _decode_next();
 	GENERIC _lora_operate();
+	GENERIC _apply_pending_lora(); // before an input is decoded
 	GENERIC _initialize_context();
 	GENERIC _destroy_context();
 
 	InfProcT2TDiagnostics mDiagnostics;
 	llama_sampler* mSamplerChain;
+	llama_sampler* mGrammarSampler;
 	llama_context* mModelContext;
 	llama_batch mInputBatch;
 	inf_text_token_candidates mPresetCandidates;
+	inf_text_token_candidates mSampleCandidates; // reused between tokens, one entry per vocabulary token
 	inf_text_token_vector mTokenizedInput;
 	inf_text_token_vector mGeneratedTokenVector;
 	inf_text_token_vector mLogitTokenVector;
+	inf_text_token_vector mKvTokenVector; // tokens in the kv cache after the locked prompt
+	mbase::vector<inf_tokenized_chunk> mTokenizedChunks; // tokenized history of the last context_line input
 	mbase::vector<inf_lora_adapter> mDeclaredAdapters;
 	mbase::vector<inf_lora_adapter> mRemoveAdapters;
 	mbase::vector<inf_lora_adapter> mAssignedAdapters;
 	inf_sampling_set mSamplerDescriptions;
 	lora_adapter_map mLoraMap;
+	mbase::mutex mLoraMutex; // adapter lists are declared by the user and the model, applied by the processor thread
 	U32 mContextCursor; // -----> if it exceeds the context size, stop generating
 	U32 mBatchSize;
 	U32 mThreadCount;
@@ -146,6 +176,8 @@ private:
 	U32 mProcessedBatchLength;
 	U32 mLogitStartIndex;
 	U32 mPromptStartIndex;
+	U32 mReusedTokenCount;
+	I8 mChunkedTokenizeState; // 0 unverified, 1 the chunked tokens match the whole prompt, -1 they don't and the whole prompt is tokenized
 	processor_signal mInputSignal;
 	processor_signal mDecodeSignal;
 	processor_signal mInputKvLockedSignal;
@@ -158,6 +190,11 @@ private:
 	bool mIsBenchmarkOn;
 	decode_behavior_description mDecodeBehavior;
 	cache_mode mCacheMode;
+	inf_kv_cache_type mKeyCacheType;
+	inf_kv_cache_type mValueCacheType;
+	std::atomic<I64> mInputSubmitTime; // steady clock ticks, set by execute_input before mAwaitingFirstToken
+	std::chrono::steady_clock::time_point mLastTokenTime;
+	std::atomic<bool> mAwaitingFirstToken;
 };
 
 MBASE_END
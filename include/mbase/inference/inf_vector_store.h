@@ -0,0 +1,210 @@
+#ifndef MBASE_INF_VECTOR_STORE_H
+#define MBASE_INF_VECTOR_STORE_H
+
+#include <mbase/common.h>
+#include <mbase/string.h>
+#include <mbase/vector.h>
+#include <mbase/io_file.h>
+#include <mbase/mapped_file.h>
+#include <mbase/unordered_map.h>
+
+MBASE_BEGIN
+
+class InfVectorStore;
+
+// Row filter applied on search, returning false excludes the row from the results
+typedef bool (*inf_vector_filter)(const InfVectorStore& in_store, const U32& in_row, PTRGENERIC in_user_data);
+
+struct inf_vector_index_params {
+    U32 mHnswM = 16; // links per node on upper layers, level 0 holds twice as many
+    U32 mHnswEfConstruction = 100;
+    U32 mHnswEfSearch = 64;
+    U32 mIvfListCount = 0; // 0 means sqrt(row count) at build time
+    U32 mIvfProbeCount = 8;
+    U32 mIvfTrainIterations = 10;
+};
+
+struct inf_vector_search_options {
+    U64 mRequiredTags = 0; // row is a candidate only if (tag & mRequiredTags) == mRequiredTags
+    inf_vector_filter mFilter = NULL;
+    PTRGENERIC mFilterData = NULL;
+    U32 mEfSearch = 0; // 0 means the store default
+    U32 mProbeCount = 0; // 0 means the store default
+    bool mExact = false; // bypass the index and scan every row
+};
+
+struct inf_vector_search_result {
+    U32 mRow = 0;
+    F32 mScore = 0.0f;
+};
+
+/*
+    InfVectorStore keeps normalized embeddings with an optional string key and a 64 bit tag per row
+    and answers top-k cosine similarity queries through one of three indexes:
+
+    FLAT: exact scan over every row, using the SIMD batch kernels.
+    IVF: k-means partitioned inverted lists, only the closest mIvfProbeCount lists are scanned.
+    HNSW: hierarchical navigable small world graph, sub-linear search with incremental inserts.
+
+    The store file is laid out so that it can be mapped as is. Vectors, tags, keys and the index of
+    the compacted rows are read straight from the mapping and are never copied or re-embedded on open.
+    Rows added after the last save are appended to "<store>.log" as checksummed records and replayed on
+    open, a torn record at the end of the log (crash while appending) is discarded.
+
+    The mapping is private, HNSW link updates of mapped rows caused by new inserts are copy-on-write
+    and only reach the disk on save(), which rewrites the store file and truncates the log.
+
+    The store is not thread safe, search shares a visited table between calls.
+*/
+
+class MBASE_API InfVectorStore {
+public:
+    enum class index_type : U32 {
+        FLAT,
+        IVF,
+        HNSW
+    };
+
+    enum class flags : U8 {
+        INF_VS_SUCCESS,
+        INF_VS_ERR_ALREADY_OPEN,
+        INF_VS_ERR_NOT_OPEN,
+        INF_VS_ERR_INVALID_DIMENSION,
+        INF_VS_ERR_DIMENSION_MISMATCH,
+        INF_VS_ERR_CORRUPTED_STORE,
+        INF_VS_ERR_UNABLE_TO_OPEN_FILE,
+        INF_VS_ERR_UNABLE_TO_WRITE_FILE,
+        INF_VS_ERR_DUPLICATE_KEY,
+        INF_VS_ERR_NO_STORE_FILE
+    };
+
+    using size_type = SIZE_T;
+    using search_result_vector = mbase::vector<inf_vector_search_result>;
+
+    /* ===== BUILDER METHODS BEGIN ===== */
+    InfVectorStore() noexcept;
+    ~InfVectorStore() noexcept;
+    /* ===== BUILDER METHODS END ===== */
+
+    /* ===== OBSERVATION METHODS BEGIN ===== */
+    MBASE_ND(MBASE_OBS_IGNORE) bool is_open() const noexcept;
+    MBASE_ND(MBASE_OBS_IGNORE) bool is_persistent() const noexcept;
+    MBASE_ND(MBASE_OBS_IGNORE) bool is_index_trained() const noexcept;
+    MBASE_ND(MBASE_OBS_IGNORE) index_type get_index_type() const noexcept;
+    MBASE_ND(MBASE_OBS_IGNORE) const inf_vector_index_params& get_index_params() const noexcept;
+    MBASE_ND(MBASE_OBS_IGNORE) U32 get_dimension() const noexcept;
+    MBASE_ND(MBASE_OBS_IGNORE) size_type get_row_count() const noexcept;
+    MBASE_ND(MBASE_OBS_IGNORE) size_type get_mapped_row_count() const noexcept;
+    MBASE_ND(MBASE_OBS_IGNORE) size_type get_log_row_count() const noexcept;
+    MBASE_ND(MBASE_OBS_IGNORE) const mbase::string& get_store_path() const noexcept;
+    MBASE_ND(MBASE_OBS_IGNORE) const F32* get_vector(const U32& in_row) const noexcept;
+    MBASE_ND(MBASE_OBS_IGNORE) U64 get_tag(const U32& in_row) const noexcept;
+    MBASE_ND(MBASE_OBS_IGNORE) mbase::string get_key(const U32& in_row) const;
+    MBASE_ND(MBASE_OBS_IGNORE) bool find_key(const mbase::string& in_key, U32& out_row);
+    /* ===== OBSERVATION METHODS END ===== */
+
+    /* ===== STATE-MODIFIER METHODS BEGIN ===== */
+    flags initialize(const U32& in_dimension, index_type in_type = index_type::HNSW, const inf_vector_index_params& in_params = inf_vector_index_params());
+    flags open_store(const mbase::string& in_path, const U32& in_dimension, index_type in_type = index_type::HNSW, const inf_vector_index_params& in_params = inf_vector_index_params());
+    flags add(const PTRF32 in_vector, const mbase::string& in_key = mbase::string(), const U64& in_tag = 0, U32* out_row = NULL);
+    flags build_index();
+    flags build_index(index_type in_type);
+    flags search(const PTRF32 in_query, const size_type& in_k, search_result_vector& out_results, const inf_vector_search_options& in_options = inf_vector_search_options()) const;
+    flags save();
+    GENERIC close_store() noexcept;
+    /* ===== STATE-MODIFIER METHODS END ===== */
+
+private:
+    struct candidate {
+        F32 mScore;
+        U32 mRow;
+    };
+    using candidate_vector = mbase::vector<candidate>;
+
+    flags _load_store_file();
+    flags _replay_log();
+    flags _append_row(const PTRF32 in_vector, const mbase::string& in_key, const U64& in_tag);
+    flags _write_store_file(const mbase::string& in_path);
+    GENERIC _reset() noexcept;
+    GENERIC _build_key_index();
+    GENERIC _index_row(const U32& in_row);
+    bool _row_accepted(const U32& in_row, const inf_vector_search_options& in_options) const;
+    GENERIC _push_result(candidate_vector& in_heap, const size_type& in_k, const candidate& in_candidate) const;
+    GENERIC _finish_results(candidate_vector& in_heap, search_result_vector& out_results) const;
+    GENERIC _search_flat(const F32* in_query, const size_type& in_k, const inf_vector_search_options& in_options, candidate_vector& out_heap) const;
+    GENERIC _search_ivf(const F32* in_query, const size_type& in_k, const inf_vector_search_options& in_options, candidate_vector& out_heap) const;
+    GENERIC _search_hnsw(const F32* in_query, const size_type& in_k, const inf_vector_search_options& in_options, candidate_vector& out_heap) const;
+
+    // IVF
+    GENERIC _ivf_train();
+    U32 _ivf_nearest_list(const F32* in_vector, PTRF32 in_score_buffer) const;
+    size_type _ivf_list_size(const U32& in_list) const;
+
+    // HNSW
+    U32 _hnsw_node_level(const U32& in_row) const noexcept;
+    U32* _hnsw_links(const U32& in_row, const U32& in_level) noexcept;
+    const U32* _hnsw_links(const U32& in_row, const U32& in_level) const noexcept;
+    U32 _hnsw_max_links(const U32& in_level) const noexcept;
+    U32 _hnsw_random_level(const U32& in_row) const noexcept;
+    GENERIC _hnsw_reset();
+    GENERIC _hnsw_insert(const U32& in_row);
+    U32 _hnsw_greedy(const F32* in_query, U32 in_entry, const U32& in_level) const;
+    GENERIC _hnsw_search_layer(const F32* in_query, const candidate_vector& in_entries, const U32& in_ef, const U32& in_level, candidate_vector& out_results, const inf_vector_search_options* in_options) const;
+    GENERIC _hnsw_select_neighbors(candidate_vector& in_candidates, const U32& in_max_count) const;
+    GENERIC _hnsw_connect(const U32& in_row, const U32& in_level, candidate_vector& in_neighbors);
+
+    F32 _similarity(const F32* in_lhs, const F32* in_rhs) const noexcept;
+    U32 _next_visit_epoch() const;
+
+    mbase::string mStorePath;
+    mbase::mapped_file mMappedStore;
+    mbase::io_file mLogFile;
+    inf_vector_index_params mParams;
+    index_type mIndexType;
+    U32 mDimension;
+    bool mIsOpen;
+
+    // rows [0, mMappedRowCount) live in the mapping, the rest live in the memory tail below
+    size_type mMappedRowCount;
+    size_type mLogRowCount;
+    const F32* mMappedVectors;
+    const U64* mMappedTags;
+    const U64* mMappedKeyOffsets;
+    const IBYTE* mMappedKeyBlob;
+    mbase::vector<F32> mTailVectors;
+    mbase::vector<U64> mTailTags;
+    mbase::vector<mbase::string> mTailKeys;
+    mbase::unordered_map<mbase::string, U32> mKeyIndex;
+    bool mKeyIndexBuilt;
+
+    // IVF state, lists of mapped rows are read from the mapping until the index is rebuilt
+    mbase::vector<F32> mIvfCentroids;
+    const F32* mIvfMappedCentroids;
+    const U64* mIvfMappedListOffsets;
+    const U32* mIvfMappedListRows;
+    mbase::vector<mbase::vector<U32>> mIvfLists;
+    U32 mIvfListCount;
+
+    // HNSW state, level 0 links are (mM0 + 1) U32 per row: [count, neighbors...],
+    // upper levels of a row are (mM + 1) U32 per level at the row's upper offset
+    size_type mHnswMappedRows;
+    const U8* mHnswMappedLevels;
+    U32* mHnswMappedLinks;
+    const U32* mHnswMappedUpperOffsets;
+    U32* mHnswMappedUpperLinks;
+    mbase::vector<U8> mHnswLevels;
+    mbase::vector<U32> mHnswLinks;
+    mbase::vector<U32> mHnswUpperOffsets;
+    mbase::vector<U32> mHnswUpperLinks;
+    U32 mHnswM0;
+    U32 mHnswEntryPoint;
+    I32 mHnswMaxLevel;
+    F64 mHnswLevelMultiplier;
+
+    mutable mbase::vector<U32> mVisitedEpochs;
+    mutable U32 mVisitEpoch;
+};
+
+MBASE_END
+
+#endif // MBASE_INF_VECTOR_STORE_H
@@ -133,6 +133,7 @@ public:
 	MBASE_INLINE size_type read_data(char_stream& in_src) override;
 	MBASE_INLINE size_type read_data(char_stream& in_src, size_type in_length) override;
 	MBASE_INLINE size_type read_available_data(IBYTEBUFFER in_src, size_type in_length);
+	MBASE_INLINE size_type read_all_data(mbase::string& out_data);
 	/* ===== STATE-MODIFIER METHODS END ===== */
 
 private:
@@ -492,22 +493,56 @@ MBASE_INLINE typename io_file::size_type io_file::read_available_data(IBYTEBUFFE
 	return readResult;
 }
 
-MBASE_INLINE mbase::string read_file_as_string(mbase::io_file& in_iof)
+MBASE_INLINE typename io_file::size_type io_file::read_all_data(mbase::string& out_data)
 {
-	mbase::string fileContent;
+	// Reads everything from the current file pointer until EOF into out_data.
+	// The string is sized once from the file size so that the file is read in
+	// large blocks directly into its final location.
+	// If the size can't be known upfront (pipes, character devices) or the file grows
+	// while reading, the remaining data is read in 128KB blocks.
+
+	if(!is_file_open())
+	{
+		return 0;
+	}
+
+	size_type maxChunkSize = 128 * (1024);
+	size_type totalBytesRead = 0;
+	size_type filePointerPos = get_file_pointer_pos();
+	size_type fileSize = get_file_size();
+	size_type expectedSize = fileSize > filePointerPos ? fileSize - filePointerPos : 0;
+
+#ifdef MBASE_PLATFORM_UNIX
+	#ifndef MBASE_PLATFORM_APPLE
+	posix_fadvise(mRawContext.raw_handle, 0, 0, POSIX_FADV_SEQUENTIAL);
+	#endif
+#endif
+
+	out_data.resize(expectedSize);
+	if(expectedSize)
+	{
+		totalBytesRead = this->read_data(out_data.data(), expectedSize);
+	}
 
-	while(true)
+	while(is_file_open() && totalBytesRead == out_data.size())
 	{
-		IBYTE fileData[512] = {0};
-		SIZE_T bytesRead = in_iof.read_data(fileData, 512);
-		if(!bytesRead)
+		out_data.resize(totalBytesRead + maxChunkSize);
+		size_type bytesRead = this->read_data(out_data.data() + totalBytesRead, maxChunkSize);
+		totalBytesRead += bytesRead;
+		if(bytesRead < maxChunkSize)
 		{
 			break;
 		}
-
-		fileContent.append(fileData, bytesRead);
 	}
+	out_data.resize(totalBytesRead);
 
+	return totalBytesRead;
+}
+
+MBASE_INLINE mbase::string read_file_as_string(mbase::io_file& in_iof)
+{
+	mbase::string fileContent;
+	in_iof.read_all_data(fileContent);
 	return fileContent;
 }
 
@@ -40,6 +40,10 @@ The read/write operation which are through read_data/write_data methods are sync
 blocking operations. Attempting to write to an invalid socket handle will result in a OS dependant behavior.
 io_tcp_client does not make further control on read/write operations whether the socket handle is valid or not.
 
+The name is resolved for both IPv4 and IPv6, the resolved addresses are tried in order.
+If a connect timeout is given, each address gets the part of it that is left.
+For a non-blocking client and a connection pool, refer to the PcNetClient and PcNetConnectionPool.
+
 To achieve async io behavior, refer to the section Async I/O in MBASE.
 
 */
@@ -48,17 +52,18 @@ class io_tcp_client : public io_base, public non_copymovable {
 public:
 	/* ===== BUILDER METHODS BEGIN ===== */
 	io_tcp_client() noexcept;
-	io_tcp_client(const mbase::string& in_name, const mbase::string& in_port) noexcept;
+	io_tcp_client(const mbase::string& in_name, const mbase::string& in_port, U32 in_timeout_ms = 0) noexcept;
 	~io_tcp_client() noexcept;
 	/* ===== BUILDER METHODS END ===== */
 
 	/* ===== OBSERVATION METHODS BEGIN ===== */
-	MBASE_ND(MBASE_OBS_IGNORE) mbase::string get_remote_ipv4() const noexcept;
-	MBASE_ND(MBASE_OBS_IGNORE) mbase::string get_remote_ipv6() const noexcept;
+	MBASE_ND(MBASE_OBS_IGNORE) mbase::string get_remote_ipv4() const noexcept; // empty if the remote is IPv6
+	MBASE_ND(MBASE_OBS_IGNORE) mbase::string get_remote_ipv6() const noexcept; // empty if the remote is IPv4
+	MBASE_ND(MBASE_OBS_IGNORE) bool is_ipv6() const noexcept;
 	/* ===== OBSERVATION METHODS END ===== */
 
 	/* ===== STATE-MODIFIER METHODS BEGIN ===== */
-	I32 connect_target(const mbase::string& in_name, const mbase::string& in_port) noexcept;
+	I32 connect_target(const mbase::string& in_name, const mbase::string& in_port, U32 in_timeout_ms = 0) noexcept; // 0 blocks until the OS gives up
 	I32 disconnect() noexcept;
 	size_type write_data(CBYTEBUFFER in_src) override;
 	size_type write_data(CBYTEBUFFER in_src, size_type in_length) override;
@@ -71,17 +76,19 @@ public:
 	/* ===== STATE-MODIFIER METHODS END ===== */
 
 private:
+	I32 _connect_with_timeout(const addrinfo* in_addr, U32 in_timeout_ms) noexcept;
+
 	SOCKET mRawHandle = INVALID_SOCKET;
-	sockaddr_in mSocketAddr = {0};
+	sockaddr_storage mSocketAddr = {0};
 };
 
 io_tcp_client::io_tcp_client() noexcept : mRawHandle(INVALID_SOCKET) 
 {
 }
 
-io_tcp_client::io_tcp_client(const mbase::string& in_name, const mbase::string& in_port) noexcept 
+io_tcp_client::io_tcp_client(const mbase::string& in_name, const mbase::string& in_port, U32 in_timeout_ms) noexcept 
 {
-	if(!connect_target(in_name, in_port))
+	if(!connect_target(in_name, in_port, in_timeout_ms))
 	{
 		mOperateReady = true;
 	}
@@ -93,19 +100,32 @@ io_tcp_client::~io_tcp_client() noexcept {
 
 MBASE_ND(MBASE_OBS_IGNORE) mbase::string io_tcp_client::get_remote_ipv4() const noexcept
 {
+	if(mSocketAddr.ss_family != AF_INET)
+	{
+		return mbase::string();
+	}
 	IBYTE ipOut[INET_ADDRSTRLEN] = { 0 };
-	inet_ntop(AF_INET, &mSocketAddr.sin_addr, ipOut, sizeof(ipOut));
+	inet_ntop(AF_INET, &reinterpret_cast<const sockaddr_in*>(&mSocketAddr)->sin_addr, ipOut, sizeof(ipOut));
 	return mbase::string(ipOut);
 }
 
 MBASE_ND(MBASE_OBS_IGNORE) mbase::string io_tcp_client::get_remote_ipv6() const noexcept 
 {
+	if(mSocketAddr.ss_family != AF_INET6)
+	{
+		return mbase::string();
+	}
 	IBYTE ipOut[INET6_ADDRSTRLEN] = { 0 };
-	inet_ntop(AF_INET6, &mSocketAddr.sin_addr, ipOut, sizeof(ipOut));
+	inet_ntop(AF_INET6, &reinterpret_cast<const sockaddr_in6*>(&mSocketAddr)->sin6_addr, ipOut, sizeof(ipOut));
 	return mbase::string(ipOut);
 }
 
-I32 io_tcp_client::connect_target(const mbase::string& in_name, const mbase::string& in_port) noexcept 
+MBASE_ND(MBASE_OBS_IGNORE) bool io_tcp_client::is_ipv6() const noexcept
+{
+	return mSocketAddr.ss_family == AF_INET6;
+}
+
+I32 io_tcp_client::connect_target(const mbase::string& in_name, const mbase::string& in_port, U32 in_timeout_ms) noexcept 
 {
 	disconnect();
 
@@ -113,19 +133,26 @@ I32 io_tcp_client::connect_target(const mbase::string& in_name, const mbase::str
 
 	addrinfo* result = nullptr;
 	addrinfo hints = { 0 };
-	hints.ai_family = AF_INET;
+	hints.ai_family = AF_UNSPEC;
 	hints.ai_socktype = SOCK_STREAM;
 	hints.ai_protocol = IPPROTO_TCP;
+	hints.ai_flags = AI_ADDRCONFIG;
 
 	I32 addrResult = getaddrinfo(in_name.c_str(), in_port.c_str(), &hints, &result);
 	if (addrResult)
 	{
 		_set_last_error(addrResult);
-		freeaddrinfo(result);
 		return 1;
 	}
 
+	SIZE_T addressCount = 0;
 	for (addrinfo* pt_addr = result; pt_addr != nullptr; pt_addr = pt_addr->ai_next)
+	{
+		++addressCount;
+	}
+
+	U64 connectStart = GetTickCount64();
+	for (addrinfo* pt_addr = result; pt_addr != nullptr; pt_addr = pt_addr->ai_next, --addressCount)
 	{
 		mRawHandle = socket(pt_addr->ai_family, pt_addr->ai_socktype, pt_addr->ai_protocol);
 		if (mRawHandle == INVALID_SOCKET)
@@ -137,7 +164,23 @@ I32 io_tcp_client::connect_target(const mbase::string& in_name, const mbase::str
 			return 1;
 		}
 
-		addrResult = connect(mRawHandle, pt_addr->ai_addr, pt_addr->ai_addrlen);
+		if(in_timeout_ms)
+		{
+			U64 elapsedTime = GetTickCount64() - connectStart;
+			if(elapsedTime >= in_timeout_ms)
+			{
+				closesocket(mRawHandle);
+				mRawHandle = INVALID_SOCKET;
+				break;
+			}
+			// an address that doesn't answer shouldn't use up the time of the ones after it
+			addrResult = _connect_with_timeout(pt_addr, static_cast<U32>((in_timeout_ms - elapsedTime) / addressCount));
+		}
+		else
+		{
+			addrResult = connect(mRawHandle, pt_addr->ai_addr, static_cast<I32>(pt_addr->ai_addrlen));
+		}
+
 		if (addrResult == SOCKET_ERROR)
 		{
 			closesocket(mRawHandle);
@@ -163,6 +206,36 @@ I32 io_tcp_client::connect_target(const mbase::string& in_name, const mbase::str
 	return 0;
 }
 
+I32 io_tcp_client::_connect_with_timeout(const addrinfo* in_addr, U32 in_timeout_ms) noexcept
+{
+	u_long ctlMode = 1;
+	ioctlsocket(mRawHandle, FIONBIO, &ctlMode);
+
+	I32 connectResult = connect(mRawHandle, in_addr->ai_addr, static_cast<I32>(in_addr->ai_addrlen));
+	if(connectResult == SOCKET_ERROR && WSAGetLastError() == WSAEWOULDBLOCK)
+	{
+		WSAPOLLFD pollDescriptor = { 0 };
+		pollDescriptor.fd = mRawHandle;
+		pollDescriptor.events = POLLWRNORM;
+		connectResult = SOCKET_ERROR;
+		if(WSAPoll(&pollDescriptor, 1, static_cast<INT>(in_timeout_ms)) > 0)
+		{
+			I32 socketError = 0;
+			I32 errorLength = sizeof(socketError);
+			getsockopt(mRawHandle, SOL_SOCKET, SO_ERROR, reinterpret_cast<char*>(&socketError), &errorLength);
+			if(!socketError)
+			{
+				connectResult = 0;
+			}
+		}
+	}
+
+	// reads and writes stay blocking
+	ctlMode = 0;
+	ioctlsocket(mRawHandle, FIONBIO, &ctlMode);
+	return connectResult;
+}
+
 I32 io_tcp_client::disconnect() noexcept
 {
 	mOperateReady = false;
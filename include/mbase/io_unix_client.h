@@ -0,0 +1,295 @@
+#ifndef MBASE_IOUNIXCLIENT_H
+#define MBASE_IOUNIXCLIENT_H
+
+#include <mbase/io_base.h>
+#include <mbase/string.h> // mbase::string
+#include <mbase/behaviors.h> // mbase::non_copymovable
+
+#ifdef MBASE_PLATFORM_UNIX
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stddef.h>
+
+MBASE_STD_BEGIN
+
+/*
+
+	--- CLASS INFORMATION ---
+Identification: S0C19-OBJ-UD-ST
+
+Name: io_unix_client
+
+Parent: S0C16-SAB-UD-ST, S0C6-STR-NA-ST
+
+Behaviour List:
+- Default Constructible
+- Destructible
+
+Description:
+io_unix_client is the unix domain stream socket counterpart of the io_tcp_client.
+It connects to a server that is created with PcNetManager::create_local_server, a MAIP server
+on the same machine for instance, without going through the loopback TCP stack.
+
+A path starting with '@' is a name in the linux abstract namespace, otherwise it is a filesystem path.
+The credentials of the process listening on the socket can be observed through get_peer_uid and
+get_peer_pid to make sure the client talks to the expected server.
+
+The read/write operations are blocking like the ones of io_tcp_client.
+Writing to a disconnected peer doesn't raise SIGPIPE, the write returns 0 and the client disconnects.
+
+*/
+
+class io_unix_client : public io_base, public non_copymovable {
+public:
+	/* ===== BUILDER METHODS BEGIN ===== */
+	MBASE_INLINE io_unix_client() noexcept;
+	MBASE_INLINE io_unix_client(const mbase::string& in_path) noexcept;
+	MBASE_INLINE ~io_unix_client() noexcept;
+	/* ===== BUILDER METHODS END ===== */
+
+	/* ===== OBSERVATION METHODS BEGIN ===== */
+	MBASE_ND(MBASE_OBS_IGNORE) MBASE_INLINE const mbase::string& get_path() const noexcept;
+	MBASE_ND(MBASE_OBS_IGNORE) MBASE_INLINE I32 get_peer_pid() const noexcept;
+	MBASE_ND(MBASE_OBS_IGNORE) MBASE_INLINE I32 get_peer_uid() const noexcept;
+	MBASE_ND(MBASE_OBS_IGNORE) MBASE_INLINE I32 get_peer_gid() const noexcept;
+	/* ===== OBSERVATION METHODS END ===== */
+
+	/* ===== STATE-MODIFIER METHODS BEGIN ===== */
+	MBASE_INLINE I32 connect_target(const mbase::string& in_path) noexcept;
+	MBASE_INLINE I32 disconnect() noexcept;
+	MBASE_INLINE size_type write_data(CBYTEBUFFER in_src) override;
+	MBASE_INLINE size_type write_data(CBYTEBUFFER in_src, size_type in_length) override;
+	MBASE_INLINE size_type write_data(const mbase::string& in_src) override;
+	MBASE_INLINE size_type write_data(char_stream& in_src) override;
+	MBASE_INLINE size_type write_data(char_stream& in_src, size_type in_length) override;
+	MBASE_INLINE size_type read_data(IBYTEBUFFER in_src, size_type in_length) override;
+	MBASE_INLINE size_type read_data(char_stream& in_src) override;
+	MBASE_INLINE size_type read_data(char_stream& in_src, size_type in_length) override;
+	/* ===== STATE-MODIFIER METHODS END ===== */
+
+private:
+	I32 mRawHandle = -1;
+	mbase::string mPath;
+	I32 mPeerPid = -1;
+	I32 mPeerUid = -1;
+	I32 mPeerGid = -1;
+};
+
+MBASE_INLINE io_unix_client::io_unix_client() noexcept : mRawHandle(-1)
+{
+}
+
+MBASE_INLINE io_unix_client::io_unix_client(const mbase::string& in_path) noexcept
+{
+	if(!connect_target(in_path))
+	{
+		mOperateReady = true;
+	}
+}
+
+MBASE_INLINE io_unix_client::~io_unix_client() noexcept
+{
+	disconnect();
+}
+
+MBASE_ND(MBASE_OBS_IGNORE) MBASE_INLINE const mbase::string& io_unix_client::get_path() const noexcept
+{
+	return mPath;
+}
+
+MBASE_ND(MBASE_OBS_IGNORE) MBASE_INLINE I32 io_unix_client::get_peer_pid() const noexcept
+{
+	return mPeerPid;
+}
+
+MBASE_ND(MBASE_OBS_IGNORE) MBASE_INLINE I32 io_unix_client::get_peer_uid() const noexcept
+{
+	return mPeerUid;
+}
+
+MBASE_ND(MBASE_OBS_IGNORE) MBASE_INLINE I32 io_unix_client::get_peer_gid() const noexcept
+{
+	return mPeerGid;
+}
+
+MBASE_INLINE I32 io_unix_client::connect_target(const mbase::string& in_path) noexcept
+{
+	disconnect();
+
+	struct sockaddr_un localAddr = {};
+	localAddr.sun_family = AF_UNIX;
+	const bool isAbstract = in_path.size() && in_path[0] == '@';
+	if(!in_path.size() || in_path.size() >= sizeof(localAddr.sun_path) || (isAbstract && in_path.size() == 1))
+	{
+		_set_last_error(ENAMETOOLONG);
+		return 1;
+	}
+
+	memcpy(localAddr.sun_path, in_path.c_str(), in_path.size());
+	socklen_t addrLength = static_cast<socklen_t>(sizeof(localAddr));
+	if(isAbstract)
+	{
+		localAddr.sun_path[0] = '\0';
+		addrLength = static_cast<socklen_t>(offsetof(struct sockaddr_un, sun_path) + in_path.size());
+	}
+
+	mRawHandle = socket(AF_UNIX, SOCK_STREAM, 0);
+	if(mRawHandle == -1)
+	{
+		_set_last_error(errno);
+		return 1;
+	}
+
+	if(connect(mRawHandle, reinterpret_cast<struct sockaddr*>(&localAddr), addrLength) == -1)
+	{
+		_set_last_error(errno);
+		close(mRawHandle);
+		mRawHandle = -1;
+		return 1;
+	}
+
+	#ifdef MBASE_PLATFORM_APPLE
+	I32 noSigpipe = 1;
+	setsockopt(mRawHandle, SOL_SOCKET, SO_NOSIGPIPE, &noSigpipe, sizeof(noSigpipe));
+	uid_t credUid = 0;
+	gid_t credGid = 0;
+	if(!getpeereid(mRawHandle, &credUid, &credGid))
+	{
+		mPeerUid = static_cast<I32>(credUid);
+		mPeerGid = static_cast<I32>(credGid);
+	}
+	pid_t credPid = 0;
+	socklen_t credLength = sizeof(credPid);
+	if(!getsockopt(mRawHandle, SOL_LOCAL, LOCAL_PEERPID, &credPid, &credLength))
+	{
+		mPeerPid = static_cast<I32>(credPid);
+	}
+	#else
+	struct ucred peerCredentials = {};
+	socklen_t credLength = sizeof(peerCredentials);
+	if(!getsockopt(mRawHandle, SOL_SOCKET, SO_PEERCRED, &peerCredentials, &credLength))
+	{
+		mPeerPid = static_cast<I32>(peerCredentials.pid);
+		mPeerUid = static_cast<I32>(peerCredentials.uid);
+		mPeerGid = static_cast<I32>(peerCredentials.gid);
+	}
+	#endif
+
+	mPath = in_path;
+	_set_raw_context(mRawHandle);
+	mOperateReady = true;
+	return 0;
+}
+
+MBASE_INLINE I32 io_unix_client::disconnect() noexcept
+{
+	mOperateReady = false;
+	if(mRawHandle == -1)
+	{
+		return 0;
+	}
+
+	I32 dcResult = close(mRawHandle);
+	if(dcResult == -1)
+	{
+		_set_last_error(errno);
+	}
+	mRawHandle = -1;
+	mPeerPid = -1;
+	mPeerUid = -1;
+	mPeerGid = -1;
+	_set_raw_context(0);
+	return dcResult;
+}
+
+MBASE_INLINE typename io_unix_client::size_type io_unix_client::write_data(CBYTEBUFFER in_src)
+{
+	return write_data(in_src, type_sequence<IBYTE>::length_bytes(in_src));
+}
+
+MBASE_INLINE typename io_unix_client::size_type io_unix_client::write_data(CBYTEBUFFER in_src, size_type in_length)
+{
+	#ifdef MBASE_PLATFORM_APPLE
+	const I32 sendFlags = 0;
+	#else
+	const I32 sendFlags = MSG_NOSIGNAL;
+	#endif
+
+	size_type totalWritten = 0;
+	while(totalWritten < in_length)
+	{
+		ssize_t dataWritten = send(mRawHandle, in_src + totalWritten, in_length - totalWritten, sendFlags);
+		if(dataWritten == -1)
+		{
+			if(errno == EINTR)
+			{
+				continue;
+			}
+			_set_last_error(errno);
+			disconnect();
+			return 0;
+		}
+		totalWritten += static_cast<size_type>(dataWritten);
+	}
+	return totalWritten;
+}
+
+MBASE_INLINE typename io_unix_client::size_type io_unix_client::write_data(const mbase::string& in_src)
+{
+	return write_data(in_src.c_str(), in_src.size());
+}
+
+MBASE_INLINE typename io_unix_client::size_type io_unix_client::write_data(char_stream& in_src)
+{
+	PTRDIFF cursorPos = in_src.get_pos();
+	return write_data(in_src.get_bufferc(), in_src.buffer_length() - cursorPos);
+}
+
+MBASE_INLINE typename io_unix_client::size_type io_unix_client::write_data(char_stream& in_src, size_type in_length)
+{
+	PTRDIFF cursorPos = in_src.get_pos();
+	size_type remainingLength = in_src.buffer_length() - cursorPos;
+	return write_data(in_src.get_bufferc(), in_length < remainingLength ? in_length : remainingLength);
+}
+
+MBASE_INLINE typename io_unix_client::size_type io_unix_client::read_data(IBYTEBUFFER in_src, size_type in_length)
+{
+	ssize_t dataRead = 0;
+	do
+	{
+		dataRead = recv(mRawHandle, in_src, in_length, 0);
+	} while(dataRead == -1 && errno == EINTR);
+
+	if(dataRead <= 0)
+	{
+		if(dataRead == -1)
+		{
+			_set_last_error(errno);
+		}
+		disconnect();
+		return 0;
+	}
+	return static_cast<size_type>(dataRead);
+}
+
+MBASE_INLINE typename io_unix_client::size_type io_unix_client::read_data(char_stream& in_src)
+{
+	PTRDIFF cursorPos = in_src.get_pos();
+	return read_data(in_src.get_bufferc(), in_src.buffer_length() - cursorPos);
+}
+
+MBASE_INLINE typename io_unix_client::size_type io_unix_client::read_data(char_stream& in_src, size_type in_length)
+{
+	PTRDIFF cursorPos = in_src.get_pos();
+	size_type remainingLength = in_src.buffer_length() - cursorPos;
+	return read_data(in_src.get_bufferc(), in_length < remainingLength ? in_length : remainingLength);
+}
+
+MBASE_STD_END
+
+#endif // MBASE_PLATFORM_UNIX
+
+#endif // MBASE_IOUNIXCLIENT_H
@@ -50,13 +50,17 @@ template<typename T, typename Allocator = mbase::allocator<T>>
 class list {
 private:
 	using node_type = list_node<T>;
-	using node_allocator = typename mbase::allocator<node_type>;
+	using node_allocator = mbase::allocator_rebind_t<Allocator, node_type>;
 	node_type* mFirstNode;
 	node_type* mLastNode;
 	SIZE_T mSize;
+	node_allocator mNodeAllocator;
 	
 	/* ===== STATE-MODIFIER METHODS BEGIN ===== */
 	MBASE_INLINE GENERIC _push_back_node(node_type* in_node);
+	template<typename ... Args>
+	MBASE_INLINE node_type* _create_node(Args&& ... in_args);
+	MBASE_INLINE GENERIC _destroy_node(node_type* in_node) noexcept;
 	/* ===== STATE-MODIFIER METHODS END ===== */
 public:
 	using value_type = T;
@@ -194,18 +198,18 @@ MBASE_INLINE list<T, Allocator>::list() noexcept : mFirstNode(nullptr), mLastNod
 }
 
 template<typename T, typename Allocator>
-MBASE_INLINE list<T, Allocator>::list([[maybe_unused]] const Allocator& in_alloc) : mFirstNode(nullptr), mLastNode(nullptr), mSize(0)
+MBASE_INLINE list<T, Allocator>::list(const Allocator& in_alloc) : mFirstNode(nullptr), mLastNode(nullptr), mSize(0), mNodeAllocator(in_alloc)
 {
 }
 
 template<typename T, typename Allocator>
-list<T, Allocator>::list(size_type in_count, const T& in_value, [[maybe_unused]] const Allocator& in_alloc) : mFirstNode(nullptr), mLastNode(nullptr), mSize(0)
+list<T, Allocator>::list(size_type in_count, const T& in_value, const Allocator& in_alloc) : mFirstNode(nullptr), mLastNode(nullptr), mSize(0), mNodeAllocator(in_alloc)
 {
 	assign(in_count, in_value);
 }
 
 template<typename T, typename Allocator>
-MBASE_INLINE list<T, Allocator>::list(size_type in_count, [[maybe_unused]] const Allocator& in_alloc) : mFirstNode(nullptr), mLastNode(nullptr), mSize(0)
+MBASE_INLINE list<T, Allocator>::list(size_type in_count, const Allocator& in_alloc) : mFirstNode(nullptr), mLastNode(nullptr), mSize(0), mNodeAllocator(in_alloc)
 {
 	T defaultValue;
 	assign(in_count, std::move(defaultValue));
@@ -213,7 +217,7 @@ MBASE_INLINE list<T, Allocator>::list(size_type in_count, [[maybe_unused]] const
 
 template<typename T, typename Allocator>
 template<typename InputIt, typename>
-MBASE_INLINE_EXPR list<T, Allocator>::list(InputIt in_begin, InputIt in_end, [[maybe_unused]] const Allocator& in_alloc) : mFirstNode(nullptr), mLastNode(nullptr), mSize(0) 
+MBASE_INLINE_EXPR list<T, Allocator>::list(InputIt in_begin, InputIt in_end, const Allocator& in_alloc) : mFirstNode(nullptr), mLastNode(nullptr), mSize(0), mNodeAllocator(in_alloc) 
 {
 	for (in_begin; in_begin != in_end; in_begin++) {
 		push_back(*in_begin);
@@ -221,7 +225,7 @@ MBASE_INLINE_EXPR list<T, Allocator>::list(InputIt in_begin, InputIt in_end, [[m
 }
 
 template<typename T, typename Allocator>
-list<T, Allocator>::list(const list& in_rhs) : mFirstNode(nullptr), mLastNode(nullptr), mSize(0)
+list<T, Allocator>::list(const list& in_rhs) : mFirstNode(nullptr), mLastNode(nullptr), mSize(0), mNodeAllocator(in_rhs.mNodeAllocator)
 {
 	clear();
 	for(const_iterator cit = in_rhs.cbegin(); cit != in_rhs.cend(); cit++)
@@ -231,7 +235,7 @@ list<T, Allocator>::list(const list& in_rhs) : mFirstNode(nullptr), mLastNode(nu
 }
 
 template<typename T, typename Allocator>
-list<T, Allocator>::list(const list& in_rhs, [[maybe_unused]] const Allocator& in_alloc) : mFirstNode(nullptr), mLastNode(nullptr), mSize(0)
+list<T, Allocator>::list(const list& in_rhs, const Allocator& in_alloc) : mFirstNode(nullptr), mLastNode(nullptr), mSize(0), mNodeAllocator(in_alloc)
 {
 	clear();
 	for (const_iterator cit = in_rhs.cbegin(); cit != in_rhs.cend(); cit++)
@@ -241,15 +245,28 @@ list<T, Allocator>::list(const list& in_rhs, [[maybe_unused]] const Allocator& i
 }
 
 template<typename T, typename Allocator>
-list<T, Allocator>::list(list&& in_rhs) : mFirstNode(in_rhs.mFirstNode), mLastNode(in_rhs.mLastNode), mSize(in_rhs.mSize) {
+list<T, Allocator>::list(list&& in_rhs) : mFirstNode(in_rhs.mFirstNode), mLastNode(in_rhs.mLastNode), mSize(in_rhs.mSize), mNodeAllocator(in_rhs.mNodeAllocator) {
 	in_rhs.mSize = 0;
 	in_rhs.mFirstNode = nullptr;
 	in_rhs.mLastNode = nullptr;
 }
 
 template<typename T, typename Allocator>
-list<T, Allocator>::list(list&& in_rhs, [[maybe_unused]] const Allocator& in_alloc) : mFirstNode(in_rhs.mFirstNode), mLastNode(in_rhs.mLastNode), mSize(in_rhs.mSize)
+list<T, Allocator>::list(list&& in_rhs, const Allocator& in_alloc) : mFirstNode(in_rhs.mFirstNode), mLastNode(in_rhs.mLastNode), mSize(in_rhs.mSize), mNodeAllocator(in_alloc)
 {
+	if(!(mNodeAllocator == in_rhs.mNodeAllocator))
+	{
+		// nodes belong to another allocator, move the elements one by one
+		mFirstNode = nullptr;
+		mLastNode = nullptr;
+		mSize = 0;
+		for(iterator It = in_rhs.begin(); It != in_rhs.end(); It++)
+		{
+			push_back(std::move(*It));
+		}
+		in_rhs.clear();
+		return;
+	}
 	in_rhs.mSize = 0;
 	in_rhs.mFirstNode = nullptr;
 	in_rhs.mLastNode = nullptr;
@@ -284,6 +301,16 @@ template<typename T, typename Allocator>
 list<T, Allocator>& list<T, Allocator>::operator=(list&& in_rhs) noexcept 
 {
 	clear();
+	if(!(mNodeAllocator == in_rhs.mNodeAllocator))
+	{
+		// nodes belong to another allocator, move the elements one by one
+		for(iterator It = in_rhs.begin(); It != in_rhs.end(); It++)
+		{
+			push_back(std::move(*It));
+		}
+		in_rhs.clear();
+		return *this;
+	}
 
 	mSize = in_rhs.mSize;
 	mFirstNode = in_rhs.mFirstNode;
@@ -435,7 +462,7 @@ MBASE_ND(MBASE_OBS_IGNORE) MBASE_INLINE typename list<T, Allocator>::size_type l
 template<typename T, typename Allocator>
 MBASE_ND(MBASE_OBS_IGNORE) MBASE_INLINE_EXPR Allocator list<T, Allocator>::get_allocator() const noexcept 
 {
-	return Allocator();
+	return Allocator(mNodeAllocator);
 }
 
 template<typename T, typename Allocator>
@@ -489,7 +516,7 @@ MBASE_INLINE_EXPR GENERIC list<T, Allocator>::clear() noexcept
 template<typename T, typename Allocator>
 MBASE_INLINE_EXPR GENERIC list<T, Allocator>::push_back(const_reference in_data) noexcept
 {
-	node_type* newNode = new node_type(in_data);
+	node_type* newNode = _create_node(in_data);
 	newNode->prev = mLastNode;
 	if (mLastNode)
 	{
@@ -507,7 +534,7 @@ MBASE_INLINE_EXPR GENERIC list<T, Allocator>::push_back(const_reference in_data)
 template<typename T, typename Allocator>
 MBASE_INLINE_EXPR GENERIC list<T, Allocator>::push_back(move_reference in_data) noexcept 
 {
-	node_type* newNode = new node_type(std::move(in_data));
+	node_type* newNode = _create_node(std::move(in_data));
 	newNode->prev = mLastNode;
 	if (mLastNode)
 	{
@@ -525,7 +552,7 @@ MBASE_INLINE_EXPR GENERIC list<T, Allocator>::push_back(move_reference in_data)
 template<typename T, typename Allocator>
 MBASE_INLINE_EXPR GENERIC list<T, Allocator>::push_front(const_reference in_data) noexcept 
 {
-	node_type* newNode = new node_type(in_data);
+	node_type* newNode = _create_node(in_data);
 	newNode->next = mFirstNode;
 	if (mFirstNode)
 	{
@@ -544,7 +571,7 @@ MBASE_INLINE_EXPR GENERIC list<T, Allocator>::push_front(const_reference in_data
 template<typename T, typename Allocator>
 MBASE_INLINE_EXPR GENERIC list<T, Allocator>::push_front(move_reference in_data) noexcept 
 {
-	node_type* newNode = new node_type(std::move(in_data));
+	node_type* newNode = _create_node(std::move(in_data));
 	newNode->next = mFirstNode;
 	if (mFirstNode)
 	{
@@ -565,14 +592,14 @@ MBASE_INLINE_EXPR GENERIC list<T, Allocator>::pop_back() noexcept
 {
 	if (!(--mSize))
 	{
-		delete mLastNode;
+		_destroy_node(mLastNode);
 		mLastNode = nullptr;
 		mFirstNode = nullptr;
 		return;
 	}
 	node_type* newmLastNode = mLastNode->prev;
 	newmLastNode->next = nullptr;
-	delete mLastNode;
+	_destroy_node(mLastNode);
 	mLastNode = newmLastNode;
 }
 
@@ -581,7 +608,7 @@ MBASE_INLINE_EXPR GENERIC list<T, Allocator>::pop_front() noexcept
 {
 	if (!(--mSize))
 	{
-		delete mFirstNode;
+		_destroy_node(mFirstNode);
 		mLastNode = nullptr;
 		mFirstNode = nullptr;
 		return;
@@ -589,7 +616,7 @@ MBASE_INLINE_EXPR GENERIC list<T, Allocator>::pop_front() noexcept
 
 	node_type* newmFirstNode = mFirstNode->next;
 	newmFirstNode->prev = nullptr;
-	delete mFirstNode;
+	_destroy_node(mFirstNode);
 	mFirstNode = newmFirstNode;
 }
 
@@ -609,7 +636,7 @@ MBASE_INLINE_EXPR typename list<T, Allocator>::iterator list<T, Allocator>::inse
 	}
 
 	node_type* mNode = const_cast<node_type*>(in_pos._get_node());
-	node_type* newNode = new node_type(in_object);
+	node_type* newNode = _create_node(in_object);
 	newNode->prev = mNode->prev;
 	if (mNode->prev)
 	{
@@ -637,7 +664,7 @@ MBASE_INLINE_EXPR typename list<T, Allocator>::iterator list<T, Allocator>::inse
 	}
 
 	node_type* mNode = const_cast<node_type*>(in_pos._get_node());
-	node_type* newNode = new node_type(std::move(in_object));
+	node_type* newNode = _create_node(std::move(in_object));
 	newNode->prev = mNode->prev;
 	if (mNode->prev)
 	{
@@ -750,7 +777,7 @@ MBASE_INLINE_EXPR typename list<T, Allocator>::iterator list<T, Allocator>::eras
 	{
 		mNode->prev->next = mNode->next;
 		mNode->next->prev = mNode->prev;
-		delete mNode;
+		_destroy_node(mNode);
 		--mSize;
 	}
 	return returnedNode;
@@ -777,7 +804,7 @@ MBASE_INLINE_EXPR typename list<T, Allocator>::iterator list<T, Allocator>::eras
 	{
 		mNode->prev->next = mNode->next;
 		mNode->next->prev = mNode->prev;
-		delete mNode;
+		_destroy_node(mNode);
 		--mSize;
 	}
 	return returnedNode;
@@ -942,6 +969,7 @@ MBASE_INLINE_EXPR GENERIC list<T, Allocator>::swap(list& in_src) noexcept
 	std::swap(mFirstNode, in_src.mFirstNode);
 	std::swap(mLastNode, in_src.mLastNode);
 	std::swap(mSize, in_src.mSize);
+	std::swap(mNodeAllocator, in_src.mNodeAllocator); // the nodes are freed through the allocator that made them
 }
 
 template<typename T, typename Allocator>
@@ -1022,6 +1050,22 @@ MBASE_INLINE mbase::list<T, Allocator> list<T, Allocator>::deserialize(IBYTEBUFF
 	return deserializedList;
 }
 
+template<typename T, typename Allocator>
+template<typename ... Args>
+MBASE_INLINE typename list<T, Allocator>::node_type* list<T, Allocator>::_create_node(Args&& ... in_args)
+{
+	node_type* newNode = mNodeAllocator.allocate(1);
+	mNodeAllocator.construct(newNode, std::forward<Args>(in_args)...);
+	return newNode;
+}
+
+template<typename T, typename Allocator>
+MBASE_INLINE GENERIC list<T, Allocator>::_destroy_node(node_type* in_node) noexcept
+{
+	in_node->~node_type();
+	mNodeAllocator.deallocate(in_node, 1);
+}
+
 template<typename T, typename Allocator>
 MBASE_INLINE GENERIC list<T, Allocator>::_push_back_node(node_type* in_node) 
 {
@@ -120,33 +120,76 @@ public:
 	bool modify_model_tags(const mbase::string& in_model, const mbase::vector<mbase::string>& in_tags, mbase::string& out_payload);
 	bool modify_model_context_length(const mbase::string& in_model, const U32& in_ctx_length, mbase::string& out_payload);
 
-	GENERIC resolve_packet(CBYTEBUFFER in_data, size_type in_size);
+	MBASE_ND(MBASE_OBS_IGNORE) const mbase::string& get_session_token() const;
+	MBASE_ND(MBASE_OBS_IGNORE) bool is_binary_framing() const; // the server advertised the binary framing on access
+
+	// Returns the amount of bytes the response took, 0 if the response is not received as a whole yet
+	size_type resolve_packet(CBYTEBUFFER in_data, size_type in_size);
 	virtual GENERIC	on_resolve(const maip_operation& out_last_operation, const maip_peer_request& out_result);
 
 private:
 	maip_operation mLastOperation;
 	mbase::string mSessionToken = "123456";
+	bool mIsBinaryFraming = false;
 };
 
 class maip_context {
 public:
 	using size_type = SIZE_T;
 
-	maip_context(const mbase::string& in_session_token, const U64& in_context_id);
+	maip_context(const mbase::string& in_session_token, const U64& in_context_id, bool in_binary_framing = false);
+	maip_context(const maip_client& in_client, const U64& in_context_id); // takes the session and the framing of the client
 
 	bool set_input(maip_input_role in_role, const mbase::string& in_input, mbase::string& out_payload);
 	bool execute_input(const mbase::vector<U32>& in_msg_ids, mbase::string& out_payload);
-	bool next();
+	bool next(mbase::string& out_payload);
 
-	GENERIC resolve_packet(CBYTEBUFFER in_data, size_type in_size);
+	// Returns the amount of bytes the response took, 0 if the response is not received as a whole yet.
+	// Token frames of a binary framed exec_next are given to on_resolve_frame.
+	size_type resolve_packet(CBYTEBUFFER in_data, size_type in_size);
 	virtual GENERIC on_resolve(const maip_operation& out_last_operation, const maip_peer_request& out_result);
+	virtual GENERIC on_resolve_frame(const maip_operation& out_last_operation, const maip_binary_frame& out_frame);
 
 private:
 	maip_operation mLastOperation;
 	U64 mContextId;
 	mbase::string mSessionToken;
+	bool mIsBinaryFraming;
 };
 
+MBASE_INLINE maip_generic_errors maip_parse_response(CBYTEBUFFER in_data, SIZE_T in_size, maip_peer_request& out_result, SIZE_T& out_length)
+{
+	// out_length is the length of the response with its data, 0 if it is not received as a whole yet
+	out_length = 0;
+	mbase::char_stream responseStream(const_cast<IBYTEBUFFER>(in_data), in_size);
+	maip_generic_errors parseResult = out_result.parse_result(responseStream);
+	if(parseResult == maip_generic_errors::PACKET_TOO_SHORT || parseResult == maip_generic_errors::PACKET_INCOMPLETE)
+	{
+		return parseResult;
+	}
+
+	I64 contentLength = out_result.get_content_length();
+	if(parseResult != maip_generic_errors::SUCCESS || contentLength < 0)
+	{
+		out_length = in_size; // nothing after a malformed response can be framed
+		return parseResult != maip_generic_errors::SUCCESS ? parseResult : maip_generic_errors::DATA_LENGTH_INCONSISTENCY;
+	}
+
+	SIZE_T headerLength = responseStream.get_pos();
+	if(in_size - headerLength < static_cast<U64>(contentLength))
+	{
+		return maip_generic_errors::PACKET_INCOMPLETE;
+	}
+
+	if(contentLength)
+	{
+		mbase::char_stream dataStream(const_cast<IBYTEBUFFER>(in_data + headerLength), contentLength);
+		out_result.set_external_data(dataStream);
+	}
+	out_length = headerLength + contentLength;
+	return maip_generic_errors::SUCCESS;
+}
+
 bool maip_client::access_request(const mbase::string& in_username, const mbase::string& in_access_token, mbase::string& out_payload)
 {
 	if(!in_username.size() || !in_access_token.size())
@@ -539,12 +582,162 @@ bool maip_client::modify_model_context_length(const mbase::string& in_model, con
 	return true;
 }
 
-GENERIC maip_client::resolve_packet(CBYTEBUFFER in_data, size_type in_size)
+const mbase::string& maip_client::get_session_token() const
+{
+	return mSessionToken;
+}
+
+bool maip_client::is_binary_framing() const
+{
+	return mIsBinaryFraming;
+}
+
+typename maip_client::size_type maip_client::resolve_packet(CBYTEBUFFER in_data, size_type in_size)
+{
+	maip_peer_request packetResult;
+	size_type packetLength = 0;
+	if(maip_parse_response(in_data, in_size, packetResult, packetLength) != maip_generic_errors::SUCCESS)
+	{
+		return packetLength;
+	}
+
+	if(mLastOperation == maip_operation::ACCESS_REQUEST && packetResult.has_key("STOK"))
+	{
+		mSessionToken = packetResult.get_kval<mbase::string>("STOK");
+		mIsBinaryFraming = false;
+		for(const maip_description_kval& tmpKval : packetResult.get_kvals())
+		{
+			if(tmpKval.mKey == MBASE_MAIP_FRAMING_KEY && tmpKval.mValue.mValue == MBASE_MAIP_FRAMING_BINARY)
+			{
+				mIsBinaryFraming = true;
+			}
+		}
+	}
+	on_resolve(mLastOperation, packetResult);
+	return packetLength;
+}
+
+GENERIC	maip_client::on_resolve([[maybe_unused]] const maip_operation& out_last_operation, [[maybe_unused]] const maip_peer_request& out_result)
+{
+
+}
+
+maip_context::maip_context(const mbase::string& in_session_token, const U64& in_context_id, bool in_binary_framing) :
+	mLastOperation(maip_operation::NEXT),
+	mContextId(in_context_id),
+	mSessionToken(in_session_token),
+	mIsBinaryFraming(in_binary_framing)
+{
+}
+
+maip_context::maip_context(const maip_client& in_client, const U64& in_context_id) :
+	mLastOperation(maip_operation::NEXT),
+	mContextId(in_context_id),
+	mSessionToken(in_client.get_session_token()),
+	mIsBinaryFraming(in_client.is_binary_framing())
+{
+}
+
+bool maip_context::set_input(maip_input_role in_role, const mbase::string& in_input, mbase::string& out_payload)
+{
+	MBASE_MAIP_CLIENT_CHECK_SESSION;
+
+	mbase::string contextRole;
+	switch (in_role)
+	{
+	case maip_input_role::SYSTEM:
+		contextRole = "System";
+		break;
+	case maip_input_role::ASSISTANT:
+		contextRole = "Assistant";
+		break;
+	case maip_input_role::USER:
+		contextRole = "User";
+		break;
+	default:
+		return false;
+	}
+
+	packetBuilder.set_request_message("EXEC", "exec_set_input");
+	packetBuilder.set_kval("CTXID", mContextId);
+	packetBuilder.set_kval("ROLE", contextRole);
+	packetBuilder.generate_payload(out_payload, in_input);
+
+	mLastOperation = maip_operation::SET_INPUT;
+	return true;
+}
+
+bool maip_context::execute_input(const mbase::vector<U32>& in_msg_ids, mbase::string& out_payload)
+{
+	MBASE_MAIP_CLIENT_CHECK_SESSION;
+
+	if(!in_msg_ids.size())
+	{
+		return false;
+	}
+
+	packetBuilder.set_request_message("EXEC", "exec_execute_input");
+	packetBuilder.set_kval("CTXID", mContextId);
+	for(const U32& msgId : in_msg_ids)
+	{
+		packetBuilder.set_kval("MSGID", msgId);
+	}
+	packetBuilder.generate_payload(out_payload);
+
+	mLastOperation = maip_operation::EXECUTE_INPUT;
+	return true;
+}
+
+bool maip_context::next(mbase::string& out_payload)
+{
+	MBASE_MAIP_CLIENT_CHECK_SESSION;
+
+	packetBuilder.set_request_message("EXEC", "exec_next");
+	packetBuilder.set_kval("CTXID", mContextId);
+	if(mIsBinaryFraming)
+	{
+		packetBuilder.set_kval(MBASE_MAIP_FRAMING_KEY, mbase::string(MBASE_MAIP_FRAMING_BINARY));
+	}
+	packetBuilder.generate_payload(out_payload);
+
+	mLastOperation = maip_operation::NEXT;
+	return true;
+}
+
+typename maip_context::size_type maip_context::resolve_packet(CBYTEBUFFER in_data, size_type in_size)
+{
+	if(maip_binary_frame::is_binary_frame(in_data, in_size))
+	{
+		maip_binary_frame tokenFrame;
+		maip_generic_errors frameResult = tokenFrame.parse_frame(in_data, in_size);
+		if(frameResult == maip_generic_errors::PACKET_INCOMPLETE)
+		{
+			return 0;
+		}
+
+		if(frameResult != maip_generic_errors::SUCCESS)
+		{
+			return in_size; // the stream can't be framed after a corrupt frame
+		}
+		on_resolve_frame(mLastOperation, tokenFrame);
+		return tokenFrame.get_frame_length();
+	}
+
+	maip_peer_request packetResult;
+	size_type packetLength = 0;
+	if(maip_parse_response(in_data, in_size, packetResult, packetLength) == maip_generic_errors::SUCCESS)
+	{
+		on_resolve(mLastOperation, packetResult);
+	}
+	return packetLength;
+}
+
+GENERIC maip_context::on_resolve([[maybe_unused]] const maip_operation& out_last_operation, [[maybe_unused]] const maip_peer_request& out_result)
 {
 
 }
 
-GENERIC	maip_client::on_resolve(const maip_operation& out_last_operation, const maip_peer_request& out_result)
+GENERIC maip_context::on_resolve_frame([[maybe_unused]] const maip_operation& out_last_operation, [[maybe_unused]] const maip_binary_frame& out_frame)
 {
 
 }
@@ -5,7 +5,13 @@
 #include <mbase/char_stream.h>
 #include <mbase/string.h>
 #include <mbase/unordered_map.h>
+#include <mbase/vector.h>
 #include <ctype.h>
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
+#include <string_view>
+#include <type_traits>
 
 MBASE_STD_BEGIN
 
@@ -30,7 +36,7 @@ MBASE_STD_BEGIN
 	maip-identification-line = maip-req-identification-line / maip-resp-identification-line SP LF
 
 	message-description-key = ALPHA *64(VCHAR)
-	message-description-value = *256(VCHAR / WSP)
+	message-description-value = *(VCHAR / WSP) ; a description line is at most 8192 characters
 	message-description = message-description-key ":" message-description-value *(";" message-description-value) LF
 
 	maip-end = "END" LF
@@ -67,10 +73,21 @@ enum class maip_generic_errors : U16 {
 
 static const U32 gMaipVersionMinLength = 7;
 static const U32 gMaipDescriptionKeyLength = 64;
-static const U32 gMaipDescriptionValueLength = 256;
+static const U32 gMaipDescriptionValueLength = 8192; // of the whole value list of a description
 static const U32 gMaipOpTypeLength = 32;
 static const U32 gMaipOpStringLength = 64;
 static const U32 gMaipMaxKvalCount = 64;
+static const U32 gMaipMaxHeaderLength = 65536; // identification line, descriptions and the END line
+static const U32 gMaipMaxContentLength = 20 * 1024 * 1024;
+static const U32 gMaipBinaryFrameHeaderLength = 16;
+static const U8 gMaipBinaryFrameMagic = 0xB1;
+static const U8 gMaipBinaryFrameVersion = 1;
+static const U16 gMaipBinaryMaxPieceLength = 0x7FFF; // the high bit of a piece length is the special token flag
+static const U16 gMaipBinaryMaxTokenCount = 0xFFFF;
+
+#define MBASE_MAIP_FRAMING_KEY "FRAMING"
+#define MBASE_MAIP_FRAMING_TEXT "TEXT"
+#define MBASE_MAIP_FRAMING_BINARY "BINARY"
 
 using maip_sequence_helper = mbase::type_sequence<IBYTE>;
 
@@ -87,8 +104,8 @@ struct maip_version {
 
 struct maip_request_identification {
 	maip_version mVersion;
-	mbase::string mOpType = "";
-	mbase::string mOpString = "";
+	std::string_view mOpType; // slices of the parsed buffer
+	std::string_view mOpString;
 };
 
 struct maip_response_identification {
@@ -96,67 +113,105 @@ struct maip_response_identification {
 	I16 mResponseCode = 0;
 };
 
-struct maip_description_value {
-	maip_description_value() : mStringValue{ 0 } {}
-	maip_description_value(const maip_description_value& in_rhs) : mStringValue{ 0 }
+/*
+	A vector that keeps its first InlineCount items in place and only allocates when it grows past them.
+	It is used for the descriptions of a request, so parsing a typical request doesn't touch the heap.
+	Only trivially copyable types are allowed, items are moved with memcpy.
+*/
+template<typename T, SIZE_T InlineCount>
+class maip_small_vector {
+public:
+	static_assert(std::is_trivially_copyable<T>::value, "maip_small_vector holds trivially copyable types only");
+
+	using size_type = SIZE_T;
+	using iterator = T*;
+	using const_iterator = const T*;
+
+	maip_small_vector() noexcept : mOverflowItems(nullptr), mSize(0), mCapacity(InlineCount) {}
+	maip_small_vector(const maip_small_vector& in_rhs) : mOverflowItems(nullptr), mSize(0), mCapacity(InlineCount)
+	{
+		*this = in_rhs;
+	}
+	~maip_small_vector()
 	{
-		mValType = in_rhs.mValType;
-		maip_sequence_helper::copy_bytes(mStringValue, in_rhs.mStringValue);
+		delete[] mOverflowItems;
 	}
-	maip_description_value& operator=(const maip_description_value& in_rhs)
+
+	maip_small_vector& operator=(const maip_small_vector& in_rhs)
 	{
-		mValType = in_rhs.mValType;
-		if (*mStringValue != '\0')
+		if(this == &in_rhs)
 		{
-			maip_sequence_helper::fill(mStringValue, '\0', gMaipDescriptionValueLength);
+			return *this;
 		}
-		maip_sequence_helper::copy_bytes(mStringValue, in_rhs.mStringValue);
+		clear();
+		reserve(in_rhs.mSize);
+		std::memcpy(static_cast<PTRGENERIC>(data()), in_rhs.data(), in_rhs.mSize * sizeof(T));
+		mSize = in_rhs.mSize;
 		return *this;
 	}
 
-	maip_value_type mValType = maip_value_type::MAIP_VALTPYE_STRING;
-	union {
-		IBYTE mStringValue[gMaipDescriptionValueLength];
-		I64 mIntValue;
-		F64 mFloatValue;
-	};
-};
-
-struct maip_description_kval {
-	maip_description_kval() : mKey{ 0 } {}
-	maip_description_kval(const maip_description_kval& in_rhs) noexcept : mKey{ 0 }
+	MBASE_ND(MBASE_IGNORE_NONTRIVIAL) MBASE_INLINE T* data() noexcept { return mOverflowItems ? mOverflowItems : mInlineItems; }
+	MBASE_ND(MBASE_IGNORE_NONTRIVIAL) MBASE_INLINE const T* data() const noexcept { return mOverflowItems ? mOverflowItems : mInlineItems; }
+	MBASE_ND(MBASE_IGNORE_NONTRIVIAL) MBASE_INLINE iterator begin() noexcept { return data(); }
+	MBASE_ND(MBASE_IGNORE_NONTRIVIAL) MBASE_INLINE iterator end() noexcept { return data() + mSize; }
+	MBASE_ND(MBASE_IGNORE_NONTRIVIAL) MBASE_INLINE const_iterator begin() const noexcept { return data(); }
+	MBASE_ND(MBASE_IGNORE_NONTRIVIAL) MBASE_INLINE const_iterator end() const noexcept { return data() + mSize; }
+	MBASE_ND(MBASE_OBS_IGNORE) MBASE_INLINE size_type size() const noexcept { return mSize; }
+	MBASE_ND(MBASE_OBS_IGNORE) MBASE_INLINE bool empty() const noexcept { return !mSize; }
+	MBASE_ND(MBASE_IGNORE_NONTRIVIAL) MBASE_INLINE T& operator[](size_type in_index) noexcept { return data()[in_index]; }
+	MBASE_ND(MBASE_IGNORE_NONTRIVIAL) MBASE_INLINE const T& operator[](size_type in_index) const noexcept { return data()[in_index]; }
+
+	MBASE_INLINE GENERIC reserve(size_type in_capacity)
 	{
-		maip_sequence_helper::copy_bytes(mKey, in_rhs.mKey);
-		mValues = in_rhs.mValues;
+		if(in_capacity <= mCapacity)
+		{
+			return;
+		}
+		T* newItems = new T[in_capacity];
+		std::memcpy(static_cast<PTRGENERIC>(newItems), data(), mSize * sizeof(T));
+		delete[] mOverflowItems;
+		mOverflowItems = newItems;
+		mCapacity = in_capacity;
 	}
-	maip_description_kval(maip_description_kval&& in_rhs) noexcept : mKey{ 0 }
+
+	MBASE_INLINE GENERIC push_back(const T& in_item)
 	{
-		maip_sequence_helper::copy_bytes(mKey, in_rhs.mKey);
-		maip_sequence_helper::fill(in_rhs.mKey, '\0', gMaipDescriptionKeyLength);
-		mValues = std::move(in_rhs.mValues);
+		if(mSize == mCapacity)
+		{
+			reserve(mCapacity * 2);
+		}
+		data()[mSize++] = in_item;
 	}
 
-	maip_description_kval& operator=(const maip_description_kval& in_rhs)
+	MBASE_INLINE GENERIC clear() noexcept
 	{
-		maip_sequence_helper::fill(mKey, '\0', gMaipDescriptionKeyLength);
-		maip_sequence_helper::copy_bytes(mKey, in_rhs.mKey);
-
-		mValues = in_rhs.mValues;
-		return *this;
+		mSize = 0; // the overflow storage is kept for the next parse
 	}
 
-	maip_description_kval& operator=(maip_description_kval&& in_rhs) noexcept
-	{
-		maip_sequence_helper::fill(mKey, '\0', gMaipDescriptionKeyLength);
-		maip_sequence_helper::copy_bytes(mKey, in_rhs.mKey);
-		maip_sequence_helper::fill(in_rhs.mKey, '\0', gMaipDescriptionKeyLength);
+private:
+	T mInlineItems[InlineCount];
+	T* mOverflowItems;
+	size_type mSize;
+	size_type mCapacity;
+};
 
-		mValues = std::move(in_rhs.mValues);
-		return *this;
+struct maip_description_value {
+	MBASE_ND(MBASE_IGNORE_NONTRIVIAL) MBASE_INLINE mbase::string get_string() const
+	{
+		return mbase::string(mValue.data(), mValue.size());
 	}
 
-	IBYTE mKey[gMaipDescriptionKeyLength];
-	mbase::vector<maip_description_value> mValues;
+	std::string_view mValue; // slice of the parsed buffer, the text of the value whatever its type is
+	maip_value_type mValType = maip_value_type::MAIP_VALTPYE_STRING;
+	union {
+		I64 mIntValue = 0;
+		F64 mFloatValue;
+	};
+};
+
+struct maip_description_kval {
+	std::string_view mKey;
+	maip_description_value mValue;
 };
 
 template<typename T>
@@ -210,11 +265,17 @@ private:
 	kval_container mDescriptionKVals;
 };
 
+/*
+	maip_peer_request doesn't copy the parsed message. Identification, keys and values are slices of the source
+	buffer and the data is a stream over it, so the buffer must outlive the request.
+	Every value of a description is stored as its own kval, a key given multiple times or with ';' separated values
+	yields multiple kvals with the same key in the order they were given.
+*/
 class maip_peer_request {
 public:
-	using kval_container = mbase::unordered_map<mbase::string, mbase::vector<maip_description_kval>>;
-	using kval_container_reference = mbase::unordered_map<mbase::string, mbase::vector<maip_description_kval>>&;
-	using kval_container_const_reference = const mbase::unordered_map<mbase::string, mbase::vector<maip_description_kval>>&;
+	using kval_container = maip_small_vector<maip_description_kval, 32>;
+	using kval_container_reference = kval_container&;
+	using kval_container_const_reference = const kval_container&;
 	using iterator = typename kval_container::iterator;
 	using const_iterator = typename kval_container::const_iterator;
 
@@ -229,12 +290,17 @@ public:
 	MBASE_ND(MBASE_IGNORE_NONTRIVIAL) MBASE_INLINE I16 get_version_major() const noexcept;
 	MBASE_ND(MBASE_IGNORE_NONTRIVIAL) MBASE_INLINE I16 get_version_minor() const noexcept;
 	MBASE_ND(MBASE_IGNORE_NONTRIVIAL) MBASE_INLINE const maip_request_identification& get_identification() const noexcept;
+	MBASE_ND(MBASE_IGNORE_NONTRIVIAL) MBASE_INLINE I16 get_response_code() const noexcept;
 	MBASE_ND(MBASE_IGNORE_NONTRIVIAL) MBASE_INLINE kval_container_const_reference get_kvals() const noexcept;
-	MBASE_ND(MBASE_IGNORE_NONTRIVIAL) MBASE_INLINE I64 get_content_length() const;
+	MBASE_ND(MBASE_IGNORE_NONTRIVIAL) MBASE_INLINE I64 get_content_length() const noexcept;
 	MBASE_ND(MBASE_IGNORE_NONTRIVIAL) MBASE_INLINE const char_stream& get_data() const noexcept;
 	template<typename T>
+	MBASE_ND(MBASE_IGNORE_NONTRIVIAL) MBASE_INLINE T get_kval(const IBYTE* in_key) const;
+	template<typename T>
 	MBASE_ND(MBASE_IGNORE_NONTRIVIAL) MBASE_INLINE T get_kval(const mbase::string& in_key) const;
-	MBASE_ND(MBASE_IGNORE_NONTRIVIAL) MBASE_INLINE bool has_key(const mbase::string& in_key) const;
+	MBASE_ND(MBASE_IGNORE_NONTRIVIAL) MBASE_INLINE bool has_key(const IBYTE* in_key) const noexcept;
+	MBASE_ND(MBASE_IGNORE_NONTRIVIAL) MBASE_INLINE bool has_key(const mbase::string& in_key) const noexcept;
+	MBASE_ND(MBASE_IGNORE_NONTRIVIAL) MBASE_INLINE const maip_description_value* find_kval(std::string_view in_key) const noexcept; // first value of the key, NULL if missing
 
 	MBASE_INLINE maip_generic_errors parse_request(mbase::char_stream& in_stream);
 	MBASE_INLINE maip_generic_errors parse_result(mbase::char_stream& in_stream);
@@ -242,250 +308,226 @@ public:
 
 	MBASE_INLINE GENERIC set_external_data(mbase::char_stream& in_stream);
 private:
-	MBASE_INLINE maip_generic_errors _parse_version(mbase::char_stream& in_stream);
-	MBASE_INLINE maip_generic_errors _parse_req_identification_line(mbase::char_stream& in_stream);
-	MBASE_INLINE maip_generic_errors _parse_resp_identification_line(mbase::char_stream& in_stream);
-	MBASE_INLINE maip_generic_errors _parse_message_description(mbase::char_stream& in_stream, maip_description_kval& out_kval);
-	MBASE_INLINE maip_generic_errors _parse_end(mbase::char_stream& in_stream);
+	MBASE_INLINE maip_generic_errors _parse_version(CBYTEBUFFER& in_cursor, CBYTEBUFFER in_end);
+	MBASE_INLINE maip_generic_errors _parse_req_identification_line(CBYTEBUFFER& in_cursor, CBYTEBUFFER in_end);
+	MBASE_INLINE maip_generic_errors _parse_resp_identification_line(CBYTEBUFFER& in_cursor, CBYTEBUFFER in_end);
+	MBASE_INLINE maip_generic_errors _parse_message_descriptions(CBYTEBUFFER& in_cursor, CBYTEBUFFER in_end);
+	MBASE_INLINE maip_generic_errors _parse_end(CBYTEBUFFER& in_cursor, CBYTEBUFFER in_end);
+	MBASE_INLINE static GENERIC _classify_value(maip_description_value& out_value);
+	MBASE_INLINE static bool _is_printable(CBYTEBUFFER in_begin, CBYTEBUFFER in_end) noexcept;
 
 	MBASE_INLINE GENERIC _clear_request()
 	{
 		mMaipVersion.mVersionMajor = 0;
 		mMaipVersion.mVersionMinor = 0;
 		mRequestIdentification = maip_request_identification();
+		mResponseCode = 0;
 		mDescriptionKvals.clear();
+		mDataStream = mbase::char_stream();
 	}
 
 	maip_version mMaipVersion;
 	maip_request_identification mRequestIdentification;
+	I16 mResponseCode = 0;
 	kval_container mDescriptionKvals;
 	mbase::char_stream mDataStream;
 };
 
 template<typename T, typename VecType = void>
 struct kval_converter {
-	static T get_key(const mbase::string& in_key, maip_peer_request::kval_container_const_reference in_kval_container)
+	static T get_key(std::string_view in_key, const maip_peer_request& in_request)
 	{
-		try
-		{
-			const mbase::vector<maip_description_kval>& mKval = in_kval_container.at(in_key);
-			if (mKval.size())
-			{
-				const maip_description_kval& tempKval = mKval.front();
-				if (tempKval.mValues.size())
-				{
-					if (tempKval.mValues.front().mValType == mbase::maip_value_type::MAIP_VALTYPE_INT)
-					{
-						return tempKval.mValues.front().mIntValue;
-					}
-				}
-
-				return 0;
-			}
-			return 0;
-		}
-		catch ([[maybe_unused]] const std::exception& out_except)
+		const maip_description_value* tempValue = in_request.find_kval(in_key);
+		if (tempValue && tempValue->mValType == mbase::maip_value_type::MAIP_VALTYPE_INT)
 		{
-			return 0;
+			return static_cast<T>(tempValue->mIntValue);
 		}
+		return T();
 	}
 };
 
 template<typename T>
 struct kval_converter<T, typename std::enable_if<std::is_same<T, mbase::vector<typename T::value_type>>::value>::type> {
-	static T get_key(const mbase::string& in_key, maip_peer_request::kval_container_const_reference in_kval_container)
+	static T get_key(std::string_view in_key, const maip_peer_request& in_request)
 	{
-		try
+		T tempVector;
+		for (const maip_description_kval& kval_iter : in_request.get_kvals())
 		{
-			const mbase::vector<maip_description_kval>& mKval = in_kval_container.at(in_key);
-			T tempVector;
-			for (auto& kval_iter : mKval)
+			if (kval_iter.mKey == in_key && kval_iter.mValue.mValType == mbase::maip_value_type::MAIP_VALTYPE_INT)
 			{
-				for (auto& values_iter : kval_iter.mValues)
-				{
-					if (values_iter.mValType == mbase::maip_value_type::MAIP_VALTYPE_INT)
-					{
-						tempVector.push_back(values_iter.mIntValue);
-					}
-				}
+				tempVector.push_back(static_cast<typename T::value_type>(kval_iter.mValue.mIntValue));
 			}
-			return tempVector;
-		}
-		catch ([[maybe_unused]] const std::exception& out_except)
-		{
-			return T();
 		}
+		return tempVector;
 	}
 };
 
 template<>
 struct kval_converter<F64> {
-	static F64 get_key(const mbase::string& in_key, maip_peer_request::kval_container_const_reference in_kval_container)
+	static F64 get_key(std::string_view in_key, const maip_peer_request& in_request)
 	{
-		try
+		const maip_description_value* tempValue = in_request.find_kval(in_key);
+		if (tempValue && tempValue->mValType == mbase::maip_value_type::MAIP_VALTYPE_FLOAT)
 		{
-			const mbase::vector<maip_description_kval>& mKval = in_kval_container.at(in_key);
-			if (mKval.size())
-			{
-				const maip_description_kval& tempKval = mKval.front();
-				if (tempKval.mValues.size())
-				{
-					if (tempKval.mValues.front().mValType == mbase::maip_value_type::MAIP_VALTYPE_FLOAT)
-					{
-						return tempKval.mValues.front().mFloatValue;
-					}
-				}
-
-				return 0.0f;
-			}
-			return 0.0f;
-		}
-		catch ([[maybe_unused]] const std::exception& out_except)
-		{
-			return 0.0f;
+			return tempValue->mFloatValue;
 		}
+		return 0.0;
 	}
 };
 
 template<>
 struct kval_converter<F32> {
-	static F32 get_key(const mbase::string& in_key, maip_peer_request::kval_container_const_reference in_kval_container)
+	static F32 get_key(std::string_view in_key, const maip_peer_request& in_request)
 	{
-		try
-		{
-			const mbase::vector<maip_description_kval>& mKval = in_kval_container.at(in_key);
-			if (mKval.size())
-			{
-				const maip_description_kval& tempKval = mKval.front();
-				if (tempKval.mValues.size())
-				{
-					if (tempKval.mValues.front().mValType == mbase::maip_value_type::MAIP_VALTYPE_FLOAT)
-					{
-						return static_cast<F32>(tempKval.mValues.front().mFloatValue);
-					}
-				}
-
-				return 0.0f;
-			}
-			return 0.0f;
-		}
-		catch ([[maybe_unused]] const std::exception& out_except)
-		{
-			return 0.0f;
-		}
+		return static_cast<F32>(kval_converter<F64>::get_key(in_key, in_request));
 	}
 };
 
 template<>
 struct kval_converter<mbase::string> {
-	static mbase::string get_key(const mbase::string& in_key, maip_peer_request::kval_container_const_reference in_kval_container)
+	static mbase::string get_key(std::string_view in_key, const maip_peer_request& in_request)
 	{
-		try
-		{
-			const mbase::vector<maip_description_kval>& mKval = in_kval_container.at(in_key);
-			if (mKval.size())
-			{
-				const maip_description_kval& tempKval = mKval.front();
-				if (tempKval.mValues.size())
-				{
-					if (tempKval.mValues.front().mValType == mbase::maip_value_type::MAIP_VALTPYE_STRING)
-					{
-						return tempKval.mValues.front().mStringValue;
-					}
-				}
-
-				return "";
-			}
-			return "";
-		}
-		catch ([[maybe_unused]] const std::exception& out_except)
+		const maip_description_value* tempValue = in_request.find_kval(in_key);
+		if (tempValue)
 		{
-			return "";
+			return tempValue->get_string();
 		}
+		return "";
 	}
 };
 
 template<>
 struct kval_converter<mbase::vector<F32>> {
-	static mbase::vector<F32> get_key(const mbase::string& in_key, maip_peer_request::kval_container_const_reference in_kval_container)
+	static mbase::vector<F32> get_key(std::string_view in_key, const maip_peer_request& in_request)
 	{
-		try
+		mbase::vector<F32> tempVector;
+		for (const maip_description_kval& kval_iter : in_request.get_kvals())
 		{
-			const mbase::vector<maip_description_kval>& mKval = in_kval_container.at(in_key);
-			mbase::vector<F32> tempVector;
-			for (auto& kval_iter : mKval)
+			if (kval_iter.mKey == in_key && kval_iter.mValue.mValType == mbase::maip_value_type::MAIP_VALTYPE_FLOAT)
 			{
-				for (auto& values_iter : kval_iter.mValues)
-				{
-					if (values_iter.mValType == mbase::maip_value_type::MAIP_VALTYPE_FLOAT)
-					{
-						tempVector.push_back(values_iter.mFloatValue);
-					}
-				}
+				tempVector.push_back(static_cast<F32>(kval_iter.mValue.mFloatValue));
 			}
-			return tempVector;
-		}
-		catch ([[maybe_unused]] const std::exception& out_except)
-		{
-			return mbase::vector<F32>();
 		}
+		return tempVector;
 	}
 };
 
 template<>
 struct kval_converter<mbase::vector<F64>> {
-	static mbase::vector<F64> get_key(const mbase::string& in_key, maip_peer_request::kval_container_const_reference in_kval_container)
+	static mbase::vector<F64> get_key(std::string_view in_key, const maip_peer_request& in_request)
 	{
-		try
+		mbase::vector<F64> tempVector;
+		for (const maip_description_kval& kval_iter : in_request.get_kvals())
 		{
-			const mbase::vector<maip_description_kval>& mKval = in_kval_container.at(in_key);
-			mbase::vector<F64> tempVector;
-			for (auto& kval_iter : mKval)
+			if (kval_iter.mKey == in_key && kval_iter.mValue.mValType == mbase::maip_value_type::MAIP_VALTYPE_FLOAT)
 			{
-				for (auto& values_iter : kval_iter.mValues)
-				{
-					if (values_iter.mValType == mbase::maip_value_type::MAIP_VALTYPE_FLOAT)
-					{
-						tempVector.push_back(values_iter.mFloatValue);
-					}
-				}
+				tempVector.push_back(kval_iter.mValue.mFloatValue);
 			}
-			return tempVector;
-		}
-		catch ([[maybe_unused]] const std::exception& out_except)
-		{
-			return mbase::vector<F64>();
 		}
+		return tempVector;
 	}
 };
 
 template<>
 struct kval_converter<mbase::vector<mbase::string>> {
-	static mbase::vector<mbase::string> get_key(const mbase::string& in_key, maip_peer_request::kval_container_const_reference in_kval_container)
+	static mbase::vector<mbase::string> get_key(std::string_view in_key, const maip_peer_request& in_request)
 	{
-		try
+		mbase::vector<mbase::string> tempVector;
+		for (const maip_description_kval& kval_iter : in_request.get_kvals())
 		{
-			const mbase::vector<maip_description_kval>& mKval = in_kval_container.at(in_key);
-			mbase::vector<mbase::string> tempVector;
-			for (auto& kval_iter : mKval)
+			if (kval_iter.mKey == in_key)
 			{
-				for (auto& values_iter : kval_iter.mValues)
-				{
-					if (values_iter.mValType == mbase::maip_value_type::MAIP_VALTPYE_STRING)
-					{
-						tempVector.push_back(values_iter.mStringValue);
-					}
-				}
+				tempVector.push_back(kval_iter.mValue.get_string());
 			}
-			return tempVector;
-		}
-		catch ([[maybe_unused]] const std::exception& out_except)
-		{
-			return mbase::vector<mbase::string>();
 		}
+		return tempVector;
 	}
 };
 
+/*
+	Binary framing of the MAIP responses, for the token stream of exec_next where the identification and
+	description lines of a text message cost more than the token they carry. The server advertises it with
+	FRAMING:TEXT;BINARY in the inf_access_request response and the client asks for it with FRAMING:BINARY
+	in exec_next. The operations and the response codes are the same as in the text framing.
+
+	A frame is a fixed 16 byte header and its payload, integers are little endian:
+
+	+------+-----+---------+-------+---------------+-------------+----------------+-------------+
+	| 0xB1 | 'M' | version | flags | response code | token count | payload length | total count |
+	|  1   |  1  |    1    |   1   |       2       |      2      |       4        |      4      |
+	+------+-----+---------+-------+---------------+-------------+----------------+-------------+
+
+	payload = token-count * I32 token id, token-count * U16 piece length, the UTF-8 pieces back to back
+	The high bit of a piece length marks a special token. A text message can't begin with 0xB1, so a client
+	tells the framings apart from the first byte.
+*/
+
+class maip_binary_frame_builder {
+public:
+	enum class flags : U8 {
+		BINARY_BUILDER_SUCCESS,
+		BINARY_BUILDER_ERR_PIECE_TOO_LONG,
+		BINARY_BUILDER_ERR_TOO_MANY_TOKENS
+	};
+
+	using size_type = SIZE_T;
+
+	MBASE_INLINE GENERIC set_response_code(U16 in_response_code) noexcept;
+	MBASE_INLINE GENERIC set_total(U32 in_total) noexcept;
+	MBASE_INLINE flags add_token(I32 in_token, const mbase::string& in_piece, bool in_is_special);
+	MBASE_ND(MBASE_OBS_IGNORE) MBASE_INLINE U16 get_response_code() const noexcept;
+	MBASE_ND(MBASE_OBS_IGNORE) MBASE_INLINE U32 get_total() const noexcept;
+	MBASE_ND(MBASE_OBS_IGNORE) MBASE_INLINE size_type get_token_count() const noexcept;
+	MBASE_INLINE size_type generate_payload(mbase::string& out_payload) const;
+	MBASE_INLINE GENERIC clear() noexcept;
+
+private:
+	U16 mResponseCode = 0;
+	U32 mTotal = 0;
+	mbase::vector<I32> mTokens;
+	mbase::vector<U16> mPieceLengths;
+	mbase::string mPieces;
+};
+
+/*
+	maip_binary_frame is a view over a received frame, like maip_peer_request it doesn't copy the buffer.
+	Token ids and piece lengths are decoded on access since the arrays are not aligned in the frame.
+*/
+class maip_binary_frame {
+public:
+	using size_type = SIZE_T;
+
+	MBASE_ND(MBASE_OBS_IGNORE) static MBASE_INLINE bool is_binary_frame(CBYTEBUFFER in_data, size_type in_size) noexcept;
+
+	MBASE_ND(MBASE_OBS_IGNORE) MBASE_INLINE size_type get_frame_length() const noexcept; // header and payload, what to consume from the stream
+	MBASE_ND(MBASE_OBS_IGNORE) MBASE_INLINE U8 get_version() const noexcept;
+	MBASE_ND(MBASE_OBS_IGNORE) MBASE_INLINE U16 get_response_code() const noexcept;
+	MBASE_ND(MBASE_OBS_IGNORE) MBASE_INLINE U32 get_total() const noexcept;
+	MBASE_ND(MBASE_OBS_IGNORE) MBASE_INLINE size_type get_token_count() const noexcept;
+	MBASE_ND(MBASE_OBS_IGNORE) MBASE_INLINE I32 get_token(size_type in_index) const noexcept;
+	MBASE_ND(MBASE_OBS_IGNORE) MBASE_INLINE bool is_special(size_type in_index) const noexcept;
+	MBASE_ND(MBASE_OBS_IGNORE) MBASE_INLINE std::string_view get_piece(size_type in_index) const noexcept;
+	MBASE_ND(MBASE_OBS_IGNORE) MBASE_INLINE std::string_view get_pieces() const noexcept; // all pieces, the generated text of the frame
+
+	// PACKET_INCOMPLETE if the frame is not received as a whole yet
+	MBASE_INLINE maip_generic_errors parse_frame(CBYTEBUFFER in_data, size_type in_size);
+
+private:
+	MBASE_INLINE static U16 _read_u16(CBYTEBUFFER in_data) noexcept;
+	MBASE_INLINE static U32 _read_u32(CBYTEBUFFER in_data) noexcept;
+
+	CBYTEBUFFER mTokenData = NULL;
+	CBYTEBUFFER mLengthData = NULL;
+	CBYTEBUFFER mPieceData = NULL;
+	mbase::vector<U32> mPieceOffsets;
+	size_type mFrameLength = 0;
+	size_type mPieceDataLength = 0;
+	size_type mTokenCount = 0;
+	U32 mTotal = 0;
+	U16 mResponseCode = 0;
+	U8 mVersion = 0;
+};
+
 MBASE_INLINE GENERIC maip_packet_builder::set_version(U8 in_version_major, U8 in_version_minor)
 {
 	mVersionString = mbase::string::from_format("MAIP%d.%d ", in_version_major, in_version_minor);
@@ -652,12 +694,12 @@ MBASE_ND(MBASE_IGNORE_NONTRIVIAL) MBASE_INLINE typename maip_peer_request::const
 
 MBASE_ND(MBASE_IGNORE_NONTRIVIAL) MBASE_INLINE typename maip_peer_request::const_iterator maip_peer_request::cbegin() const noexcept
 {
-	return mDescriptionKvals.cbegin();
+	return mDescriptionKvals.begin();
 }
 
 MBASE_ND(MBASE_IGNORE_NONTRIVIAL) MBASE_INLINE typename maip_peer_request::const_iterator maip_peer_request::cend() const noexcept
 {
-	return mDescriptionKvals.cend();
+	return mDescriptionKvals.end();
 }
 
 MBASE_ND(MBASE_IGNORE_NONTRIVIAL) MBASE_INLINE const maip_version& maip_peer_request::get_version() const noexcept
@@ -680,27 +722,23 @@ MBASE_ND(MBASE_IGNORE_NONTRIVIAL) MBASE_INLINE const maip_request_identification
 	return mRequestIdentification;
 }
 
+MBASE_ND(MBASE_IGNORE_NONTRIVIAL) MBASE_INLINE I16 maip_peer_request::get_response_code() const noexcept
+{
+	return mResponseCode;
+}
+
 MBASE_ND(MBASE_IGNORE_NONTRIVIAL) MBASE_INLINE typename maip_peer_request::kval_container_const_reference maip_peer_request::get_kvals() const noexcept
 {
 	return mDescriptionKvals;
 }
 
-MBASE_ND(MBASE_IGNORE_NONTRIVIAL) MBASE_INLINE I64 maip_peer_request::get_content_length() const
+MBASE_ND(MBASE_IGNORE_NONTRIVIAL) MBASE_INLINE I64 maip_peer_request::get_content_length() const noexcept
 {
-	mbase::string myString = "LENGTH";
-	try
-	{
-		const mbase::vector<maip_description_value>& tempVals = mDescriptionKvals.at(myString).front().mValues;
-		if (tempVals[0].mValType == maip_value_type::MAIP_VALTYPE_INT)
-		{
-			return mDescriptionKvals.at(myString).front().mValues[0].mIntValue;
-		}
-	}
-	catch ([[maybe_unused]] const std::exception& out_except)
+	const maip_description_value* lengthValue = find_kval("LENGTH");
+	if (lengthValue && lengthValue->mValType == maip_value_type::MAIP_VALTYPE_INT)
 	{
-		return 0;
+		return lengthValue->mIntValue;
 	}
-
 	return 0;
 }
 
@@ -709,113 +747,118 @@ MBASE_ND(MBASE_IGNORE_NONTRIVIAL) MBASE_INLINE const char_stream& maip_peer_requ
 	return mDataStream;
 }
 
+template<typename T>
+MBASE_ND(MBASE_IGNORE_NONTRIVIAL) MBASE_INLINE T maip_peer_request::get_kval(const IBYTE* in_key) const
+{
+	return mbase::kval_converter<T>::get_key(in_key, *this);
+}
+
 template<typename T>
 MBASE_ND(MBASE_IGNORE_NONTRIVIAL) MBASE_INLINE T maip_peer_request::get_kval(const mbase::string& in_key) const
 {
-	return mbase::kval_converter<T>::get_key(in_key, mDescriptionKvals);
+	return mbase::kval_converter<T>::get_key(std::string_view(in_key.c_str(), in_key.size()), *this);
+}
+
+MBASE_ND(MBASE_IGNORE_NONTRIVIAL) MBASE_INLINE bool maip_peer_request::has_key(const IBYTE* in_key) const noexcept
+{
+	return find_kval(in_key) != NULL;
+}
+
+MBASE_ND(MBASE_IGNORE_NONTRIVIAL) MBASE_INLINE bool maip_peer_request::has_key(const mbase::string& in_key) const noexcept
+{
+	return find_kval(std::string_view(in_key.c_str(), in_key.size())) != NULL;
 }
 
-MBASE_ND(MBASE_IGNORE_NONTRIVIAL) MBASE_INLINE bool maip_peer_request::has_key(const mbase::string& in_key) const
+MBASE_ND(MBASE_IGNORE_NONTRIVIAL) MBASE_INLINE const maip_description_value* maip_peer_request::find_kval(std::string_view in_key) const noexcept
 {
-	return mDescriptionKvals.contains(in_key);
+	// a request has a handful of keys, a linear scan beats hashing them
+	for (const maip_description_kval& n : mDescriptionKvals)
+	{
+		if (n.mKey == in_key)
+		{
+			return &n.mValue;
+		}
+	}
+	return NULL;
 }
 
 MBASE_INLINE maip_generic_errors maip_peer_request::parse_request(mbase::char_stream& in_stream)
 {
 	_clear_request();
 
-	maip_generic_errors parseResult = _parse_version(in_stream);
+	CBYTEBUFFER streamBegin = in_stream.get_bufferc();
+	CBYTEBUFFER streamEnd = in_stream.get_buffer() + in_stream.buffer_length();
+	CBYTEBUFFER streamCursor = streamBegin;
+
+	maip_generic_errors parseResult = _parse_version(streamCursor, streamEnd);
 	if (parseResult != maip_generic_errors::SUCCESS)
 	{
 		return parseResult;
 	}
-	parseResult = _parse_req_identification_line(in_stream);
+	parseResult = _parse_req_identification_line(streamCursor, streamEnd);
 	if (parseResult != maip_generic_errors::SUCCESS)
 	{
 		return parseResult;
 	}
-
-	while (mDescriptionKvals.size() != gMaipMaxKvalCount) // max key values
+	parseResult = _parse_message_descriptions(streamCursor, streamEnd);
+	if (parseResult != maip_generic_errors::SUCCESS)
 	{
-		maip_description_kval mdk;
-		parseResult = _parse_message_description(in_stream, mdk);
-		if (parseResult == maip_generic_errors::PACKET_INCOMPLETE)
-		{
-			break;
-		}
-		else if (parseResult == maip_generic_errors::SUCCESS)
-		{
-			mDescriptionKvals[mdk.mKey].push_back(std::move(mdk));
-		}
-		else
-		{
-			return parseResult;
-		}
+		return parseResult;
+	}
+	parseResult = _parse_end(streamCursor, streamEnd);
+	if (parseResult == maip_generic_errors::SUCCESS)
+	{
+		in_stream.advance(streamCursor - streamBegin); // the data begins at the cursor
 	}
-	return _parse_end(in_stream);
+	return parseResult;
 }
 
 MBASE_INLINE maip_generic_errors maip_peer_request::parse_result(mbase::char_stream& in_stream)
 {
 	_clear_request();
 
-	maip_generic_errors parseResult = _parse_version(in_stream);
+	CBYTEBUFFER streamBegin = in_stream.get_bufferc();
+	CBYTEBUFFER streamEnd = in_stream.get_buffer() + in_stream.buffer_length();
+	CBYTEBUFFER streamCursor = streamBegin;
+
+	maip_generic_errors parseResult = _parse_version(streamCursor, streamEnd);
 	if (parseResult != maip_generic_errors::SUCCESS)
 	{
 		return parseResult;
 	}
-	parseResult = _parse_resp_identification_line(in_stream);
+	parseResult = _parse_resp_identification_line(streamCursor, streamEnd);
 	if (parseResult != maip_generic_errors::SUCCESS)
 	{
 		return parseResult;
 	}
-
-	while (mDescriptionKvals.size() != gMaipMaxKvalCount) // max key values
+	parseResult = _parse_message_descriptions(streamCursor, streamEnd);
+	if (parseResult != maip_generic_errors::SUCCESS)
 	{
-		maip_description_kval mdk;
-		parseResult = _parse_message_description(in_stream, mdk);
-		if (parseResult == maip_generic_errors::PACKET_INCOMPLETE)
-		{
-			break;
-		}
-		else if (parseResult == maip_generic_errors::SUCCESS)
-		{
-			mDescriptionKvals[mdk.mKey].push_back(std::move(mdk));
-		}
-		else
-		{
-			return parseResult;
-		}
+		return parseResult;
 	}
-	return _parse_end(in_stream);
+	parseResult = _parse_end(streamCursor, streamEnd);
+	if (parseResult == maip_generic_errors::SUCCESS)
+	{
+		in_stream.advance(streamCursor - streamBegin);
+	}
+	return parseResult;
 }
 
 MBASE_INLINE maip_generic_errors maip_peer_request::parse_data(mbase::char_stream& in_stream)
 {
-	mDataStream = in_stream;
-
-	if (in_stream.is_cursor_end())
+	if (in_stream.get_pos() >= in_stream.buffer_length())
 	{
 		return maip_generic_errors::MISSING_DATA;
 	}
 
-	I32 processedBytes = 0;
-	try
-	{
-		for (U32 i = 0; i < mDataStream.buffer_length(); i++)
-		{
-			mDataStream.putc(in_stream.getc());
-			++processedBytes;
-			in_stream.advance_safe();
-			mDataStream.advance_safe();
-		}
-	}
-	catch ([[maybe_unused]] const std::exception& out_except)
+	I64 contentLength = get_content_length();
+	if (contentLength < 0 || static_cast<U64>(contentLength) > in_stream.get_difference())
 	{
-		in_stream.reverse_safe(processedBytes);
 		return maip_generic_errors::DATA_LENGTH_INCONSISTENCY;
 	}
 
+	mbase::char_stream dataStream(in_stream.get_bufferc(), contentLength ? static_cast<SIZE_T>(contentLength) : in_stream.get_difference());
+	mDataStream = dataStream;
 	return maip_generic_errors::SUCCESS;
 }
 
@@ -824,378 +867,528 @@ MBASE_INLINE GENERIC maip_peer_request::set_external_data(mbase::char_stream& in
 	mDataStream = in_stream;
 }
 
-MBASE_INLINE maip_generic_errors maip_peer_request::_parse_version(mbase::char_stream& in_stream)
+MBASE_INLINE maip_generic_errors maip_peer_request::_parse_version(CBYTEBUFFER& in_cursor, CBYTEBUFFER in_end)
 {
-	if (in_stream.buffer_length() < gMaipVersionMinLength)
+	if (in_end - in_cursor < static_cast<PTRDIFF>(gMaipVersionMinLength))
 	{
 		return maip_generic_errors::PACKET_TOO_SHORT;
 	}
 
-	if (maip_sequence_helper::compare_bytes(in_stream.get_buffer(), "MAIP", 4))
+	if (maip_sequence_helper::compare_bytes(in_cursor, "MAIP", 4))
 	{
 		return maip_generic_errors::INVALID_PROTOCOL;
 	}
 
-	I32 processedBytes = 0;
+	CBYTEBUFFER tmpCursor = in_cursor + 4;
+	I32 versionMajor = 0;
+	I32 versionMinor = 0;
+
+	I32 digitCount = 0;
+	for (; tmpCursor != in_end && isdigit(static_cast<U8>(*tmpCursor)); ++tmpCursor, ++digitCount)
+	{
+		versionMajor = versionMajor * 10 + (*tmpCursor - '0');
+	}
 
-	try
+	if (tmpCursor == in_end)
 	{
-		in_stream.advance_safe(4);
+		return maip_generic_errors::PACKET_TOO_SHORT;
+	}
 
-		I32 versionMajorLength = 0;
-		I32 versionMinorLength = 0;
-		IBYTE versionMajor[5] = { 0 };
-		IBYTE versionMinor[5] = { 0 };
-		bool tempFoundDot = false;
+	if (!digitCount || digitCount > 4)
+	{
+		// missing version major or it contains a non digit
+		return maip_generic_errors::INVALID_VERSION_MAJOR;
+	}
 
-		for (; versionMajorLength < 4; versionMajorLength++)
-		{
-			if (in_stream.getc() == '.')
-			{
-				if (!versionMajorLength)
-				{
-					// missing version major
-					in_stream.reverse_safe(processedBytes);
-					return maip_generic_errors::INVALID_VERSION_MAJOR;
-				}
-				// means version major is formed
-				++processedBytes;
-				in_stream.advance_safe();
-				tempFoundDot = true;
-				break;
-			}
+	if (*tmpCursor != '.')
+	{
+		return maip_generic_errors::INVALID_IDENTIFICATION_ENDING;
+	}
+	++tmpCursor;
 
-			if (!isdigit(in_stream.getc()))
-			{
-				// means version major contains non digit
-				in_stream.reverse_safe(processedBytes);
-				return maip_generic_errors::INVALID_VERSION_MAJOR;
-			}
-			versionMajor[versionMajorLength] = in_stream.getc();
-			++processedBytes;
-			in_stream.advance_safe();
+	digitCount = 0;
+	for (; tmpCursor != in_end && isdigit(static_cast<U8>(*tmpCursor)); ++tmpCursor, ++digitCount)
+	{
+		versionMinor = versionMinor * 10 + (*tmpCursor - '0');
+	}
+
+	if (tmpCursor == in_end)
+	{
+		return maip_generic_errors::PACKET_TOO_SHORT;
+	}
+
+	if (!digitCount || digitCount > 4 || *tmpCursor != ' ')
+	{
+		return maip_generic_errors::INVALID_IDENTIFICATION_ENDING;
+	}
+
+	mMaipVersion.mVersionMajor = static_cast<I16>(versionMajor);
+	mMaipVersion.mVersionMinor = static_cast<I16>(versionMinor);
+	in_cursor = tmpCursor + 1;
+	return maip_generic_errors::SUCCESS;
+}
+
+MBASE_INLINE maip_generic_errors maip_peer_request::_parse_req_identification_line(CBYTEBUFFER& in_cursor, CBYTEBUFFER in_end)
+{
+	CBYTEBUFFER opTypeBegin = in_cursor;
+	CBYTEBUFFER tmpCursor = in_cursor;
+	for (; tmpCursor != in_end && *tmpCursor != ' '; ++tmpCursor)
+	{
+		if (tmpCursor - opTypeBegin == static_cast<PTRDIFF>(gMaipOpTypeLength))
+		{
+			return maip_generic_errors::OP_TYPE_TOO_LONG;
 		}
 
-		if (!tempFoundDot)
+		if (!isalnum(static_cast<U8>(*tmpCursor)))
 		{
-			// INVALID FORMAT
-			in_stream.reverse_safe(processedBytes);
-			return maip_generic_errors::INVALID_IDENTIFICATION_ENDING;
+			return maip_generic_errors::OP_TYPE_NON_ALPHA;
 		}
+	}
+
+	if (tmpCursor == in_end)
+	{
+		return maip_generic_errors::PACKET_TOO_SHORT;
+	}
+
+	if (tmpCursor == opTypeBegin)
+	{
+		return maip_generic_errors::MISSING_OP_TYPE;
+	}
+	std::string_view opType(opTypeBegin, tmpCursor - opTypeBegin);
 
-		for (; versionMinorLength < 4; versionMinorLength++)
+	CBYTEBUFFER opStringBegin = ++tmpCursor;
+	for (; tmpCursor != in_end && *tmpCursor != ' '; ++tmpCursor)
+	{
+		if (tmpCursor - opStringBegin == static_cast<PTRDIFF>(gMaipOpStringLength))
 		{
-			if (!isdigit(in_stream.getc()))
-			{
-				break;
-			}
+			return maip_generic_errors::OP_STRING_TOO_LONG;
+		}
 
-			versionMinor[versionMinorLength] = in_stream.getc();
-			++processedBytes;
-			in_stream.advance_safe();
+		if (!_is_printable(tmpCursor, tmpCursor + 1))
+		{
+			return maip_generic_errors::OP_STRING_NON_PRINTABLE;
 		}
+	}
+
+	if (in_end - tmpCursor < 2)
+	{
+		return maip_generic_errors::PACKET_TOO_SHORT;
+	}
+
+	if (tmpCursor[1] != '\n')
+	{
+		return maip_generic_errors::INVALID_IDENTIFICATION_ENDING;
+	}
+
+	mRequestIdentification.mOpType = opType;
+	mRequestIdentification.mOpString = std::string_view(opStringBegin, tmpCursor - opStringBegin);
+	in_cursor = tmpCursor + 2;
+	return maip_generic_errors::SUCCESS;
+}
 
-		if (!versionMinorLength)
+MBASE_INLINE maip_generic_errors maip_peer_request::_parse_resp_identification_line(CBYTEBUFFER& in_cursor, CBYTEBUFFER in_end)
+{
+	CBYTEBUFFER codeBegin = in_cursor;
+	CBYTEBUFFER tmpCursor = in_cursor;
+	I32 responseCode = 0;
+	for (; tmpCursor != in_end && *tmpCursor != ' '; ++tmpCursor)
+	{
+		if (tmpCursor - codeBegin == 4 || !isdigit(static_cast<U8>(*tmpCursor)))
 		{
-			in_stream.reverse_safe(processedBytes);
 			return maip_generic_errors::INVALID_IDENTIFICATION_ENDING;
 		}
-		++processedBytes;
-		in_stream.advance_safe();
-
-		mMaipVersion.mVersionMajor = static_cast<I16>(atoi(versionMajor));
-		mMaipVersion.mVersionMinor = static_cast<I16>(atoi(versionMinor));
+		responseCode = responseCode * 10 + (*tmpCursor - '0');
 	}
-	catch ([[maybe_unused]] const std::exception& out_except)
+
+	if (in_end - tmpCursor < 2)
 	{
-		// MEANS, BUFFER IS OUT OF BOUNDS
-		in_stream.reverse_safe(processedBytes);
 		return maip_generic_errors::PACKET_TOO_SHORT;
 	}
 
+	if (tmpCursor[1] != '\n')
+	{
+		return maip_generic_errors::INVALID_IDENTIFICATION_ENDING;
+	}
+
+	mResponseCode = static_cast<I16>(responseCode);
+	in_cursor = tmpCursor + 2;
 	return maip_generic_errors::SUCCESS;
 }
 
-MBASE_INLINE maip_generic_errors maip_peer_request::_parse_req_identification_line(mbase::char_stream& in_stream)
+MBASE_INLINE maip_generic_errors maip_peer_request::_parse_message_descriptions(CBYTEBUFFER& in_cursor, CBYTEBUFFER in_end)
 {
-	I32 processedBytes = 0;
-	try
+	for (U32 lineCount = 0; lineCount < gMaipMaxKvalCount; lineCount++)
 	{
-		mbase::string opType;
-		I32 opLengthMax = 32;
-		for (I32 i = 0; in_stream.getc() != 32; i++)
+		CBYTEBUFFER keyBegin = in_cursor;
+		CBYTEBUFFER tmpCursor = in_cursor;
+		for (; tmpCursor != in_end && *tmpCursor != ':'; ++tmpCursor)
 		{
-			if (i == opLengthMax)
+			if (*tmpCursor == '\n')
 			{
-				in_stream.reverse_safe(processedBytes);
-				return maip_generic_errors::OP_TYPE_TOO_LONG;
+				// not a description, the END line is next
+				return maip_generic_errors::SUCCESS;
 			}
 
-			if (!mbase::string::is_alnum(in_stream.getc()))
+			if (tmpCursor - keyBegin == static_cast<PTRDIFF>(gMaipDescriptionKeyLength - 1))
 			{
-				in_stream.reverse_safe(processedBytes);
-				return maip_generic_errors::OP_TYPE_NON_ALPHA;
+				return maip_generic_errors::KEY_LENGTH_TOO_LARGE;
 			}
-			opType += in_stream.getc();
-			++processedBytes;
-			in_stream.advance_safe();
 		}
 
-		if (!opType.size())
+		if (tmpCursor == in_end)
 		{
-			in_stream.reverse_safe(processedBytes);
-			return maip_generic_errors::MISSING_OP_TYPE;
+			return maip_generic_errors::PACKET_TOO_SHORT;
 		}
-		++processedBytes;
-		in_stream.advance_safe();
 
-		mbase::string opString;
-		opLengthMax = gMaipOpStringLength;
+		if (tmpCursor == keyBegin)
+		{
+			return maip_generic_errors::MISSING_KEY;
+		}
 
-		for (I32 i = 0; in_stream.getc() != 32; i++)
+		maip_description_kval newKval;
+		newKval.mKey = std::string_view(keyBegin, tmpCursor - keyBegin);
+
+		CBYTEBUFFER lineBegin = tmpCursor + 1;
+		CBYTEBUFFER lineLimit = in_end - lineBegin > static_cast<PTRDIFF>(gMaipDescriptionValueLength) ? lineBegin + gMaipDescriptionValueLength + 1 : in_end;
+		CBYTEBUFFER lineEnd = static_cast<CBYTEBUFFER>(std::memchr(lineBegin, '\n', lineLimit - lineBegin));
+		if (!lineEnd)
 		{
-			if (i == opLengthMax)
-			{
-				// OP LENGTH IS TOO LONG
-				in_stream.reverse_safe(processedBytes);
-				return maip_generic_errors::OP_STRING_TOO_LONG;
-			}
+			return lineLimit == in_end ? maip_generic_errors::PACKET_TOO_SHORT : maip_generic_errors::VALUE_LENGTH_TOO_LARGE;
+		}
+
+		if (!_is_printable(lineBegin, lineEnd))
+		{
+			return maip_generic_errors::INVALID_KVAL_FORMAT;
+		}
 
-			if (in_stream.getc() == 32)
+		CBYTEBUFFER valueBegin = lineBegin;
+		while (valueBegin <= lineEnd)
+		{
+			CBYTEBUFFER valueEnd = static_cast<CBYTEBUFFER>(std::memchr(valueBegin, ';', lineEnd - valueBegin));
+			if (!valueEnd)
 			{
-				in_stream.reverse_safe(processedBytes);
-				return maip_generic_errors::OP_STRING_NON_PRINTABLE;
+				valueEnd = lineEnd;
 			}
 
-			if (!mbase::string::is_print(in_stream.getc()))
+			if (valueEnd != valueBegin)
 			{
-				// contains non alpha numeric
-				in_stream.reverse_safe(processedBytes);
-				return maip_generic_errors::OP_STRING_NON_PRINTABLE;
+				newKval.mValue.mValue = std::string_view(valueBegin, valueEnd - valueBegin);
+				_classify_value(newKval.mValue);
+				mDescriptionKvals.push_back(newKval);
 			}
-
-			opString += in_stream.getc();
-			++processedBytes;
-			in_stream.advance_safe();
+			valueBegin = valueEnd + 1;
 		}
-		++processedBytes;
-		in_stream.advance_safe();
-		if (in_stream.getc() != '\n')
-		{
-			// ENDING IS INVALID
-			in_stream.reverse_safe(processedBytes);
-			return maip_generic_errors::INVALID_IDENTIFICATION_ENDING;
-		}
-		++processedBytes;
-		in_stream.advance_safe();
-		mRequestIdentification.mOpType = std::move(opType);
-		mRequestIdentification.mOpString = std::move(opString);
+		in_cursor = lineEnd + 1;
 	}
-	catch ([[maybe_unused]] const std::exception& out_except)
+	return maip_generic_errors::SUCCESS;
+}
+
+MBASE_INLINE maip_generic_errors maip_peer_request::_parse_end(CBYTEBUFFER& in_cursor, CBYTEBUFFER in_end)
+{
+	if (in_end - in_cursor < 4)
 	{
-		// MEANS, BUFFER IS OUT OF BOUNDS
-		in_stream.reverse_safe(processedBytes);
-		return maip_generic_errors::PACKET_TOO_SHORT;
+		return maip_generic_errors::PACKET_INCOMPLETE;
+	}
+
+	if (maip_sequence_helper::compare_bytes(in_cursor, "END\n", 4))
+	{
+		// INVALID ENDING
+		return maip_generic_errors::PACKET_INCOMPLETE;
 	}
+	in_cursor += 4;
 	return maip_generic_errors::SUCCESS;
 }
 
-MBASE_INLINE maip_generic_errors maip_peer_request::_parse_resp_identification_line(mbase::char_stream& in_stream)
+MBASE_INLINE bool maip_peer_request::_is_printable(CBYTEBUFFER in_begin, CBYTEBUFFER in_end) noexcept
 {
-	if (in_stream.is_cursor_end())
+	// isprint of the C locale without the call per character, the loop vectorizes
+	bool isPrintable = true;
+	for (; in_begin != in_end; ++in_begin)
 	{
-		return maip_generic_errors::PACKET_TOO_SHORT;
+		isPrintable &= static_cast<U8>(*in_begin - 0x20) < 0x5f;
+	}
+	return isPrintable;
+}
+
+MBASE_INLINE GENERIC maip_peer_request::_classify_value(maip_description_value& out_value)
+{
+	const IBYTE* valueBegin = out_value.mValue.data();
+	const IBYTE* valueEnd = valueBegin + out_value.mValue.size();
+	const IBYTE* digitsBegin = (*valueBegin == '+' || *valueBegin == '-') ? valueBegin + 1 : valueBegin;
+
+	out_value.mValType = maip_value_type::MAIP_VALTPYE_STRING;
+	if (digitsBegin == valueEnd || valueEnd - digitsBegin > gNumericControlMaxStringLength)
+	{
+		return;
 	}
 
-	I32 processedBytes = 0;
-	try
+	I32 dotCount = 0;
+	for (const IBYTE* n = digitsBegin; n != valueEnd; ++n)
 	{
-		for (I32 i = 0; in_stream.getc() != 32; i++)
+		if (*n == '.')
 		{
-			if (i == 4)
-			{
-				return maip_generic_errors::INVALID_IDENTIFICATION_ENDING;
-			}
-			++processedBytes;
-			in_stream.advance_safe();
+			++dotCount;
 		}
-
-		if (processedBytes > 4)
+		else if (!isdigit(static_cast<U8>(*n)))
 		{
-			return maip_generic_errors::INVALID_IDENTIFICATION_ENDING;
+			return;
 		}
+	}
 
-		++processedBytes;
-		in_stream.advance_safe();
-
-		if (in_stream.getc() != '\n')
+	if (!dotCount)
+	{
+		// from_chars doesn't take the plus sign
+		const IBYTE* numberBegin = *valueBegin == '+' ? digitsBegin : valueBegin;
+		std::from_chars_result convResult = std::from_chars(numberBegin, valueEnd, out_value.mIntValue);
+		if (convResult.ec == std::errc() && convResult.ptr == valueEnd)
 		{
-			in_stream.reverse_safe(processedBytes);
-			return maip_generic_errors::INVALID_IDENTIFICATION_ENDING;
+			out_value.mValType = maip_value_type::MAIP_VALTYPE_INT;
 		}
-		++processedBytes;
-		in_stream.advance_safe();
 	}
-	catch ([[maybe_unused]] const std::exception& out_except)
+	else if (dotCount == 1 && valueEnd - digitsBegin > 1)
 	{
-		in_stream.reverse_safe(processedBytes);
-		return maip_generic_errors::PACKET_TOO_SHORT;
+		#ifdef __cpp_lib_to_chars
+		const IBYTE* numberBegin = *valueBegin == '+' ? digitsBegin : valueBegin;
+		std::from_chars_result convResult = std::from_chars(numberBegin, valueEnd, out_value.mFloatValue);
+		if (convResult.ec == std::errc() && convResult.ptr == valueEnd)
+		{
+			out_value.mValType = maip_value_type::MAIP_VALTYPE_FLOAT;
+		}
+		#else
+		// floating point from_chars is missing in this standard library
+		IBYTE floatString[gNumericControlMaxStringLength + 2] = { 0 };
+		std::memcpy(floatString, valueBegin, valueEnd - valueBegin);
+		out_value.mFloatValue = strtod(floatString, NULL);
+		out_value.mValType = maip_value_type::MAIP_VALTYPE_FLOAT;
+		#endif
 	}
-	return maip_generic_errors::SUCCESS;
 }
 
-MBASE_INLINE maip_generic_errors maip_peer_request::_parse_message_description(mbase::char_stream& in_stream, maip_description_kval& out_kval)
+MBASE_INLINE GENERIC maip_binary_frame_builder::set_response_code(U16 in_response_code) noexcept
 {
-	I32 processedBytes = 0;
-	try
+	mResponseCode = in_response_code;
+}
+
+MBASE_INLINE GENERIC maip_binary_frame_builder::set_total(U32 in_total) noexcept
+{
+	mTotal = in_total;
+}
+
+MBASE_INLINE typename maip_binary_frame_builder::flags maip_binary_frame_builder::add_token(I32 in_token, const mbase::string& in_piece, bool in_is_special)
+{
+	if (in_piece.size() > gMaipBinaryMaxPieceLength)
 	{
-		I32 maxKeyLength = gMaipDescriptionKeyLength - 1;
-		mbase::char_stream keyBuffer(out_kval.mKey, gMaipDescriptionKeyLength);
-		for (I32 i = 0; in_stream.getc() != ':'; i++)
-		{
-			if (in_stream.getc() == '\n')
-			{
-				// this is for understanding that we are reached the END LF
-				in_stream.reverse_safe(processedBytes);
-				return maip_generic_errors::PACKET_INCOMPLETE;
-			}
+		return flags::BINARY_BUILDER_ERR_PIECE_TOO_LONG;
+	}
 
-			if (i == maxKeyLength)
-			{
-				in_stream.reverse_safe(processedBytes);
-				return maip_generic_errors::KEY_LENGTH_TOO_LARGE;
-			}
-			keyBuffer.putc(in_stream.getc());
-			++processedBytes;
-			in_stream.advance_safe();
-			keyBuffer.advance_safe();
-		}
+	if (mTokens.size() == gMaipBinaryMaxTokenCount)
+	{
+		return flags::BINARY_BUILDER_ERR_TOO_MANY_TOKENS;
+	}
 
-		if (!keyBuffer.get_pos())
-		{
-			// MISSING KEY
-			in_stream.reverse_safe(processedBytes);
-			return maip_generic_errors::MISSING_KEY;
-		}
+	mTokens.push_back(in_token);
+	mPieceLengths.push_back(static_cast<U16>(in_piece.size() | (in_is_special ? 0x8000 : 0)));
+	mPieces += in_piece;
+	return flags::BINARY_BUILDER_SUCCESS;
+}
 
-		I32	countValueLength = 0;
+MBASE_ND(MBASE_OBS_IGNORE) MBASE_INLINE U16 maip_binary_frame_builder::get_response_code() const noexcept
+{
+	return mResponseCode;
+}
 
-		++processedBytes;
-		in_stream.advance_safe();
-		maip_description_value mdv;
-		for (I32 i = 0; in_stream.getc() != '\n' && i != 8192; i++)
-		{
-			if (countValueLength == gMaipDescriptionValueLength)
-			{
-				// value too long
-				in_stream.reverse_safe(processedBytes);
-				return maip_generic_errors::VALUE_LENGTH_TOO_LARGE;
-			}
+MBASE_ND(MBASE_OBS_IGNORE) MBASE_INLINE U32 maip_binary_frame_builder::get_total() const noexcept
+{
+	return mTotal;
+}
 
-			//if(in_stream.getc() == 32)
-			//{
-			//	// IGNORE SP | WSP
-			//	if(countValueLength)
-			//	{
-			//		// invalid format
-			//		in_stream.reverse_safe(processedBytes);
-			//		return maip_generic_errors::INVALID_KVAL_FORMAT;
-			//	}
-
-			//	++processedBytes;
-			//	in_stream.advance_safe();
-			//	continue;
-			//}
-
-			if (!mbase::string::is_print(in_stream.getc()))
-			{
-				// non printable characters
-				in_stream.reverse_safe(processedBytes);
-				return maip_generic_errors::INVALID_KVAL_FORMAT;
-			}
+MBASE_ND(MBASE_OBS_IGNORE) MBASE_INLINE typename maip_binary_frame_builder::size_type maip_binary_frame_builder::get_token_count() const noexcept
+{
+	return mTokens.size();
+}
 
-			if (in_stream.getc() == ';')
-			{
-				if (!countValueLength)
-				{
-					// do nothing
-				}
-				else
-				{
-					out_kval.mValues.push_back(mdv);
-					maip_sequence_helper::fill(mdv.mStringValue, '\0', countValueLength);
-					countValueLength = 0;
-				}
-			}
-			else
-			{
-				mdv.mStringValue[countValueLength] = in_stream.getc();
-				++countValueLength;
-			}
+MBASE_INLINE typename maip_binary_frame_builder::size_type maip_binary_frame_builder::generate_payload(mbase::string& out_payload) const
+{
+	const size_type tokenCount = mTokens.size();
+	const size_type payloadLength = tokenCount * (sizeof(I32) + sizeof(U16)) + mPieces.size();
 
-			++processedBytes;
-			in_stream.advance_safe();
-		}
-		++processedBytes;
-		in_stream.advance_safe();
+	out_payload.clear();
+	out_payload.resize(gMaipBinaryFrameHeaderLength + payloadLength);
+	U8* frameCursor = reinterpret_cast<U8*>(out_payload.data());
 
-		if (countValueLength)
+	auto writeInteger = [&frameCursor](U32 in_value, size_type in_width) {
+		for (size_type i = 0; i < in_width; i++)
 		{
-			out_kval.mValues.push_back(mdv);
+			*frameCursor++ = static_cast<U8>(in_value >> (i * 8));
 		}
+	};
 
-		for (auto& n : out_kval.mValues)
-		{
-			if (mbase::string::is_integer(n.mStringValue))
-			{
-				n.mValType = maip_value_type::MAIP_VALTYPE_INT;
-				#ifdef MBASE_PLATFORM_WINDOWS
-				n.mIntValue = _atoi64(n.mStringValue);
-				#endif
-				
-				#ifdef MBASE_PLATFORM_UNIX
-				IBYTEBUFFER endCharacter = NULL;
-				n.mIntValue = strtoll(n.mStringValue, &endCharacter, 10);
-				#endif
-			}
-			else if (mbase::string::is_float(n.mStringValue))
-			{
-				n.mValType = maip_value_type::MAIP_VALTYPE_FLOAT;
-				n.mFloatValue = atof(n.mStringValue);
-			}
-			else
-			{
-				n.mValType = maip_value_type::MAIP_VALTPYE_STRING;
-			}
-		}
+	*frameCursor++ = gMaipBinaryFrameMagic;
+	*frameCursor++ = 'M';
+	*frameCursor++ = gMaipBinaryFrameVersion;
+	*frameCursor++ = 0; // flags, reserved
+	writeInteger(mResponseCode, 2);
+	writeInteger(static_cast<U32>(tokenCount), 2);
+	writeInteger(static_cast<U32>(payloadLength), 4);
+	writeInteger(mTotal, 4);
+
+	for (size_type i = 0; i < tokenCount; i++)
+	{
+		writeInteger(static_cast<U32>(mTokens[i]), 4);
 	}
 
-	catch ([[maybe_unused]] const std::exception& out_except)
+	for (size_type i = 0; i < tokenCount; i++)
 	{
-		// MEANS, BUFFER IS OUT OF BOUNDS
-		in_stream.reverse_safe(processedBytes);
-		return maip_generic_errors::PACKET_TOO_SHORT;
+		writeInteger(mPieceLengths[i], 2);
 	}
-	return maip_generic_errors::SUCCESS;
+
+	if (mPieces.size())
+	{
+		std::memcpy(frameCursor, mPieces.c_str(), mPieces.size());
+	}
+	return out_payload.size();
+}
+
+MBASE_INLINE GENERIC maip_binary_frame_builder::clear() noexcept
+{
+	mResponseCode = 0;
+	mTotal = 0;
+	mTokens.clear();
+	mPieceLengths.clear();
+	mPieces.clear();
+}
+
+MBASE_ND(MBASE_OBS_IGNORE) MBASE_INLINE bool maip_binary_frame::is_binary_frame(CBYTEBUFFER in_data, size_type in_size) noexcept
+{
+	return in_size && static_cast<U8>(*in_data) == gMaipBinaryFrameMagic;
+}
+
+MBASE_ND(MBASE_OBS_IGNORE) MBASE_INLINE typename maip_binary_frame::size_type maip_binary_frame::get_frame_length() const noexcept
+{
+	return mFrameLength;
+}
+
+MBASE_ND(MBASE_OBS_IGNORE) MBASE_INLINE U8 maip_binary_frame::get_version() const noexcept
+{
+	return mVersion;
+}
+
+MBASE_ND(MBASE_OBS_IGNORE) MBASE_INLINE U16 maip_binary_frame::get_response_code() const noexcept
+{
+	return mResponseCode;
+}
+
+MBASE_ND(MBASE_OBS_IGNORE) MBASE_INLINE U32 maip_binary_frame::get_total() const noexcept
+{
+	return mTotal;
 }
 
-MBASE_INLINE maip_generic_errors maip_peer_request::_parse_end(mbase::char_stream& in_stream)
+MBASE_ND(MBASE_OBS_IGNORE) MBASE_INLINE typename maip_binary_frame::size_type maip_binary_frame::get_token_count() const noexcept
 {
-	SIZE_T bfLength = in_stream.buffer_length() - in_stream.get_pos();
-	if (bfLength < 4)
+	return mTokenCount;
+}
+
+MBASE_ND(MBASE_OBS_IGNORE) MBASE_INLINE I32 maip_binary_frame::get_token(size_type in_index) const noexcept
+{
+	return static_cast<I32>(_read_u32(mTokenData + in_index * sizeof(I32)));
+}
+
+MBASE_ND(MBASE_OBS_IGNORE) MBASE_INLINE bool maip_binary_frame::is_special(size_type in_index) const noexcept
+{
+	return (_read_u16(mLengthData + in_index * sizeof(U16)) & 0x8000) != 0;
+}
+
+MBASE_ND(MBASE_OBS_IGNORE) MBASE_INLINE std::string_view maip_binary_frame::get_piece(size_type in_index) const noexcept
+{
+	U32 pieceLength = _read_u16(mLengthData + in_index * sizeof(U16)) & gMaipBinaryMaxPieceLength;
+	return std::string_view(mPieceData + mPieceOffsets[in_index], pieceLength);
+}
+
+MBASE_ND(MBASE_OBS_IGNORE) MBASE_INLINE std::string_view maip_binary_frame::get_pieces() const noexcept
+{
+	return std::string_view(mPieceData, mPieceDataLength);
+}
+
+MBASE_INLINE maip_generic_errors maip_binary_frame::parse_frame(CBYTEBUFFER in_data, size_type in_size)
+{
+	mFrameLength = 0;
+	mTokenCount = 0;
+	mPieceDataLength = 0;
+	mPieceOffsets.clear();
+
+	if (in_size < gMaipBinaryFrameHeaderLength)
 	{
 		return maip_generic_errors::PACKET_INCOMPLETE;
 	}
 
-	if (maip_sequence_helper::compare_bytes(in_stream.get_bufferc(), "END\n", 4))
+	if (static_cast<U8>(in_data[0]) != gMaipBinaryFrameMagic || in_data[1] != 'M')
+	{
+		return maip_generic_errors::INVALID_PROTOCOL;
+	}
+
+	mVersion = static_cast<U8>(in_data[2]);
+	if (mVersion != gMaipBinaryFrameVersion)
+	{
+		return maip_generic_errors::INVALID_VERSION_MAJOR;
+	}
+
+	mResponseCode = _read_u16(in_data + 4);
+	size_type tokenCount = _read_u16(in_data + 6);
+	size_type payloadLength = _read_u32(in_data + 8);
+	mTotal = _read_u32(in_data + 12);
+
+	if (payloadLength > gMaipMaxContentLength)
+	{
+		return maip_generic_errors::PACKET_TOO_LARGE;
+	}
+
+	if (in_size - gMaipBinaryFrameHeaderLength < payloadLength)
 	{
-		// INVALID ENDING
 		return maip_generic_errors::PACKET_INCOMPLETE;
 	}
-	in_stream.advance(3);
+
+	const size_type arrayLength = tokenCount * (sizeof(I32) + sizeof(U16));
+	if (payloadLength < arrayLength)
+	{
+		return maip_generic_errors::DATA_LENGTH_INCONSISTENCY;
+	}
+
+	mTokenData = in_data + gMaipBinaryFrameHeaderLength;
+	mLengthData = mTokenData + tokenCount * sizeof(I32);
+	mPieceData = mLengthData + tokenCount * sizeof(U16);
+
+	U32 pieceOffset = 0;
+	mPieceOffsets.reserve(tokenCount);
+	for (size_type i = 0; i < tokenCount; i++)
+	{
+		mPieceOffsets.push_back(pieceOffset);
+		pieceOffset += _read_u16(mLengthData + i * sizeof(U16)) & gMaipBinaryMaxPieceLength;
+	}
+
+	if (pieceOffset != payloadLength - arrayLength)
+	{
+		mPieceOffsets.clear();
+		return maip_generic_errors::DATA_LENGTH_INCONSISTENCY;
+	}
+
+	mTokenCount = tokenCount;
+	mPieceDataLength = pieceOffset;
+	mFrameLength = gMaipBinaryFrameHeaderLength + payloadLength;
 	return maip_generic_errors::SUCCESS;
 }
 
+MBASE_INLINE U16 maip_binary_frame::_read_u16(CBYTEBUFFER in_data) noexcept
+{
+	const U8* byteData = reinterpret_cast<const U8*>(in_data);
+	return static_cast<U16>(byteData[0] | (byteData[1] << 8));
+}
+
+MBASE_INLINE U32 maip_binary_frame::_read_u32(CBYTEBUFFER in_data) noexcept
+{
+	const U8* byteData = reinterpret_cast<const U8*>(in_data);
+	return static_cast<U32>(byteData[0]) | (static_cast<U32>(byteData[1]) << 8) | (static_cast<U32>(byteData[2]) << 16) | (static_cast<U32>(byteData[3]) << 24);
+}
+
 MBASE_STD_END
 
 #endif // !MBASE_MAIP_PARSER_H
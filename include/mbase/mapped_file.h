@@ -0,0 +1,315 @@
+#ifndef MBASE_MAPPEDFILE_H
+#define MBASE_MAPPEDFILE_H
+
+#include <mbase/common.h>
+#include <mbase/string.h> // mbase::string, mbase::wstring
+#include <mbase/behaviors.h> // mbase::non_copymovable
+#include <mbase/char_stream.h> // mbase::char_stream
+
+#ifdef MBASE_PLATFORM_WINDOWS
+#include <Windows.h> // CreateFileW, CreateFileMappingW, MapViewOfFile, UnmapViewOfFile
+#endif
+
+#ifdef MBASE_PLATFORM_UNIX
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MBASE_STD_BEGIN
+
+/*
+
+	--- CLASS INFORMATION ---
+Identification: S0C33-OBJ-UD-ST
+
+Name: mapped_file
+
+Parent: S0C11-OBJ-DV-ST, S0C6-STR-NA-ST
+
+Behaviour List:
+- Default Constructible
+- Destructible
+
+Description:
+mapped_file maps the entire content of a file into the address space of the process
+and exposes it as a char_stream. Since it is a char_stream, it can be passed
+wherever a char_stream is accepted without copying the file content into an intermediate buffer.
+
+The mapping is private (copy-on-write), which means that writing into the stream
+will never modify the underlying file. Pages are loaded by the OS on demand and the
+access pattern hint given to open_file or advise is forwarded to the OS (madvise on unix)
+so that large sequential scans are read ahead.
+
+Mapping an empty file is valid. In that case, the file is considered open but the
+buffer is null and the buffer length is zero.
+
+*/
+
+class mapped_file : public char_stream, public non_copymovable {
+public:
+	enum class access_advice : U8 {
+		NORMAL,
+		SEQUENTIAL,
+		RANDOM,
+		WILL_NEED
+	};
+
+	/* ===== BUILDER METHODS BEGIN ===== */
+	MBASE_INLINE mapped_file() noexcept;
+	MBASE_INLINE MBASE_EXPLICIT mapped_file(const mbase::wstring& in_filename, access_advice in_advice = access_advice::SEQUENTIAL) noexcept;
+	MBASE_INLINE MBASE_EXPLICIT mapped_file(const mbase::string& in_filename, access_advice in_advice = access_advice::SEQUENTIAL) noexcept;
+	MBASE_INLINE ~mapped_file() noexcept;
+	/* ===== BUILDER METHODS END ===== */
+
+	/* ===== OBSERVATION METHODS BEGIN ===== */
+	MBASE_ND(MBASE_OBS_IGNORE) MBASE_INLINE bool is_file_open() const noexcept;
+	MBASE_ND(MBASE_OBS_IGNORE) MBASE_INLINE const mbase::wstring& get_file_name() const noexcept;
+	MBASE_ND(MBASE_OBS_IGNORE) MBASE_INLINE size_type get_file_size() const noexcept;
+	MBASE_ND(MBASE_OBS_IGNORE) MBASE_INLINE U32 get_last_error() const noexcept;
+	MBASE_ND(MBASE_OBS_IGNORE) MBASE_INLINE mbase::string to_string() const;
+	/* ===== OBSERVATION METHODS END ===== */
+
+	/* ===== STATE-MODIFIER METHODS BEGIN ===== */
+	MBASE_INLINE bool open_file(const mbase::wstring& in_filename, access_advice in_advice = access_advice::SEQUENTIAL) noexcept;
+	MBASE_INLINE bool open_file(const mbase::string& in_filename, access_advice in_advice = access_advice::SEQUENTIAL) noexcept;
+	MBASE_INLINE GENERIC advise(access_advice in_advice) noexcept;
+	MBASE_INLINE GENERIC close_file() noexcept;
+	MBASE_INLINE GENERIC _destroy_self() noexcept override;
+	/* ===== STATE-MODIFIER METHODS END ===== */
+
+private:
+	MBASE_INLINE bool _map_opened_file(access_advice in_advice) noexcept;
+
+	mbase::wstring mFileName;
+	bool mIsOpen;
+	U32 mLastError;
+	#ifdef MBASE_PLATFORM_WINDOWS
+	PTRGENERIC mFileHandle;
+	PTRGENERIC mMappingHandle;
+	#endif
+	#ifdef MBASE_PLATFORM_UNIX
+	I32 mFileHandle;
+	#endif
+};
+
+MBASE_INLINE mapped_file::mapped_file() noexcept : char_stream(), mFileName(), mIsOpen(false), mLastError(0)
+{
+	#ifdef MBASE_PLATFORM_WINDOWS
+	mFileHandle = INVALID_HANDLE_VALUE;
+	mMappingHandle = nullptr;
+	#endif
+	#ifdef MBASE_PLATFORM_UNIX
+	mFileHandle = -1;
+	#endif
+}
+
+MBASE_INLINE mapped_file::mapped_file(const mbase::wstring& in_filename, access_advice in_advice) noexcept : mapped_file()
+{
+	open_file(in_filename, in_advice);
+}
+
+MBASE_INLINE mapped_file::mapped_file(const mbase::string& in_filename, access_advice in_advice) noexcept : mapped_file()
+{
+	open_file(in_filename, in_advice);
+}
+
+MBASE_INLINE mapped_file::~mapped_file() noexcept
+{
+	close_file();
+}
+
+MBASE_ND(MBASE_OBS_IGNORE) MBASE_INLINE bool mapped_file::is_file_open() const noexcept
+{
+	return mIsOpen;
+}
+
+MBASE_ND(MBASE_OBS_IGNORE) MBASE_INLINE const mbase::wstring& mapped_file::get_file_name() const noexcept
+{
+	return mFileName;
+}
+
+MBASE_ND(MBASE_OBS_IGNORE) MBASE_INLINE typename mapped_file::size_type mapped_file::get_file_size() const noexcept
+{
+	return mBufferLength;
+}
+
+MBASE_ND(MBASE_OBS_IGNORE) MBASE_INLINE U32 mapped_file::get_last_error() const noexcept
+{
+	return mLastError;
+}
+
+MBASE_ND(MBASE_OBS_IGNORE) MBASE_INLINE mbase::string mapped_file::to_string() const
+{
+	if(!mBufferLength)
+	{
+		return mbase::string();
+	}
+	return mbase::string(mSrcBuffer, mBufferLength);
+}
+
+MBASE_INLINE bool mapped_file::open_file(const mbase::wstring& in_filename, access_advice in_advice) noexcept
+{
+	close_file();
+	mFileName = in_filename;
+#ifdef MBASE_PLATFORM_WINDOWS
+	mFileHandle = CreateFileW(mFileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if(mFileHandle == INVALID_HANDLE_VALUE)
+	{
+		mLastError = GetLastError();
+		return false;
+	}
+#endif
+#ifdef MBASE_PLATFORM_UNIX
+	mFileHandle = open(mbase::to_utf8(in_filename).c_str(), O_RDONLY);
+	if(mFileHandle == -1)
+	{
+		mLastError = errno;
+		return false;
+	}
+#endif
+	return _map_opened_file(in_advice);
+}
+
+MBASE_INLINE bool mapped_file::open_file(const mbase::string& in_filename, access_advice in_advice) noexcept
+{
+	return open_file(mbase::from_utf8(in_filename), in_advice);
+}
+
+MBASE_INLINE GENERIC mapped_file::advise(access_advice in_advice) noexcept
+{
+	if(!mSrcBuffer || !mBufferLength)
+	{
+		return;
+	}
+#ifdef MBASE_PLATFORM_UNIX
+	I32 adviceFlag = MADV_NORMAL;
+	switch (in_advice)
+	{
+	case access_advice::SEQUENTIAL:
+		adviceFlag = MADV_SEQUENTIAL;
+		break;
+	case access_advice::RANDOM:
+		adviceFlag = MADV_RANDOM;
+		break;
+	case access_advice::WILL_NEED:
+		adviceFlag = MADV_WILLNEED;
+		break;
+	default:
+		break;
+	}
+	madvise(mSrcBuffer, mBufferLength, adviceFlag);
+#endif
+#ifdef MBASE_PLATFORM_WINDOWS
+	// Windows does not have per-range access pattern hints for mapped views,
+	// sequential scan is already requested through FILE_FLAG_SEQUENTIAL_SCAN
+	(void)in_advice;
+#endif
+}
+
+MBASE_INLINE GENERIC mapped_file::close_file() noexcept
+{
+	_destroy_self();
+}
+
+MBASE_INLINE GENERIC mapped_file::_destroy_self() noexcept
+{
+#ifdef MBASE_PLATFORM_WINDOWS
+	if(mSrcBuffer)
+	{
+		UnmapViewOfFile(mSrcBuffer);
+	}
+	if(mMappingHandle)
+	{
+		CloseHandle(mMappingHandle);
+		mMappingHandle = nullptr;
+	}
+	if(mFileHandle != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(mFileHandle);
+		mFileHandle = INVALID_HANDLE_VALUE;
+	}
+#endif
+#ifdef MBASE_PLATFORM_UNIX
+	if(mSrcBuffer)
+	{
+		munmap(mSrcBuffer, mBufferLength);
+	}
+	if(mFileHandle != -1)
+	{
+		close(mFileHandle);
+		mFileHandle = -1;
+	}
+#endif
+	mSrcBuffer = nullptr;
+	mBufferLength = 0;
+	mStreamCursor = 0;
+	mIsOpen = false;
+}
+
+MBASE_INLINE bool mapped_file::_map_opened_file(access_advice in_advice) noexcept
+{
+	size_type fileSize = 0;
+#ifdef MBASE_PLATFORM_WINDOWS
+	LARGE_INTEGER lInt;
+	if(!GetFileSizeEx(mFileHandle, &lInt))
+	{
+		mLastError = GetLastError();
+		close_file();
+		return false;
+	}
+	fileSize = static_cast<size_type>(lInt.QuadPart);
+	if(fileSize)
+	{
+		mMappingHandle = CreateFileMappingW(mFileHandle, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+		if(!mMappingHandle)
+		{
+			mLastError = GetLastError();
+			close_file();
+			return false;
+		}
+
+		PTRGENERIC mappedView = MapViewOfFile(mMappingHandle, FILE_MAP_COPY, 0, 0, 0);
+		if(!mappedView)
+		{
+			mLastError = GetLastError();
+			close_file();
+			return false;
+		}
+		mSrcBuffer = static_cast<IBYTEBUFFER>(mappedView);
+	}
+#endif
+#ifdef MBASE_PLATFORM_UNIX
+	struct stat fileStat;
+	if(fstat(mFileHandle, &fileStat) == -1)
+	{
+		mLastError = errno;
+		close_file();
+		return false;
+	}
+	fileSize = static_cast<size_type>(fileStat.st_size);
+	if(fileSize)
+	{
+		// MAP_PRIVATE makes the view copy-on-write so that char_stream put operations can never reach the file
+		PTRGENERIC mappedView = mmap(nullptr, fileSize, PROT_READ | PROT_WRITE, MAP_PRIVATE, mFileHandle, 0);
+		if(mappedView == MAP_FAILED)
+		{
+			mLastError = errno;
+			close_file();
+			return false;
+		}
+		mSrcBuffer = static_cast<IBYTEBUFFER>(mappedView);
+	}
+#endif
+	mBufferLength = fileSize;
+	mStreamCursor = 0;
+	mIsOpen = true;
+	advise(in_advice);
+	return true;
+}
+
+MBASE_STD_END
+
+#endif // !MBASE_MAPPEDFILE_H
@@ -17,6 +17,7 @@
 
 #include <mbase/io_base.h>
 #include <mbase/io_file.h>
+#include <mbase/mapped_file.h>
 #include <mbase/filesystem.h>
 #include <mbase/thread.h>
 #include <mbase/index_assigner.h>
@@ -21,6 +21,7 @@ struct McpServerHttpInit {
     mbase::string mHostname;
     mbase::string mMcpEndpoint = "/mcp";
     mbase::string mApiKey;
+    mbase::string mUnixSocketPath; // if set, the server is reached through this unix domain socket instead of mHostname, '@' prefix for the abstract namespace
 };
 
 MBASE_END
@@ -12,12 +12,14 @@ public:
     const mbase::string& get_api_key() const noexcept;
     const mbase::string& get_hostname() const noexcept;
     const mbase::string& get_mcp_endpoint() const noexcept;
+    const mbase::string& get_unix_socket_path() const noexcept;
     mbase::string get_header_value(const mbase::string& in_header) const noexcept;
     const mbase::unordered_map<mbase::string, mbase::string>& get_headers() const noexcept;
 
     GENERIC set_mcp_endpoint(const mbase::string& in_endpoint);
     GENERIC set_hostname(const mbase::string& in_hostname);
     GENERIC set_api_key(const mbase::string& in_api_key);
+    GENERIC set_unix_socket_path(const mbase::string& in_path);
     GENERIC add_header(const mbase::string& in_header, const mbase::string& in_value);
     GENERIC remove_header(const mbase::string& in_header);
     GENERIC send_mcp_payload(const mbase::string& in_payload) override;
@@ -26,6 +28,7 @@ private:
     mbase::string mHostname;
     mbase::string mApiKey;
     mbase::string mMcpEndpoint;
+    mbase::string mUnixSocketPath;
     mbase::unordered_map<mbase::string, mbase::string> mHeadersMap;
     mbase::vector<mbase::string> mPayloadList;
     mbase::mutex mPayloadListSync;
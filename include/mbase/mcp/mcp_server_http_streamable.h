@@ -5,6 +5,7 @@
 #include <mbase/mcp/mcp_server_base.h> // McpServerBase
 #include <mbase/mcp/mcp_server_client_http_streamable.h> // McpServerHttpBase
 #include <memory>
+#include <atomic>
 
 namespace httplib
 {
@@ -13,7 +14,28 @@ namespace httplib
 
 MBASE_BEGIN
 
-// TODO: implement the security layer and rate limits
+struct McpServerHttpLimits {
+    I32 mWorkerCount = 8; // http worker threads, each one serves a connection at a time, 0 keeps the httplib default
+    I32 mMaxQueuedConnections = 256; // connections waiting for a free worker, closed without a response beyond it, 0 is unbounded
+    I32 mMaxInFlightRequests = 6; // requests that are dispatched to the server at the same time, 503 beyond it, 0 is unbounded
+    U64 mMaxBodySize = 4 * 1024 * 1024; // 413 beyond it, the body is skipped without being buffered
+    F64 mRequestsPerSecond = 50.0; // token bucket refill rate per session or client address, 0 disables rate limiting
+    F64 mBurst = 100.0; // token bucket capacity
+};
+
+/*
+    Every POST to the endpoint goes through the admission check before its body is read:
+    - No Content-Length: 411, a length is required so the body cap can apply. A chunked body is left unread
+      and the connection is closed after the response.
+    - Content-Length above mMaxBodySize: 413 from the payload limit, the body is skipped without being buffered.
+    - The token bucket of the session (a known Mcp-Session-Id) or the client address is empty: 429 with Retry-After.
+    - mMaxInFlightRequests requests are already being processed: 503 with Retry-After.
+
+    The body of a 429 or 503 is within the cap, it is read and dropped before the response so the connection
+    stays usable. A burst is shed without touching the JSON parser or the request queue of the server.
+    The in-flight limit should be lower than the worker count, the spare workers answer the 503s right away
+    instead of leaving the connections in the queue.
+*/
 
 class MBASE_API McpServerHttpBase : public mbase::McpServerBase {
 public:
@@ -30,11 +52,42 @@ public:
     const mbase::string& get_hostname() const noexcept;
     const mbase::string& get_api_key() const noexcept;
     const I32& get_port() const noexcept;
+    const mbase::string& get_unix_socket_path() const noexcept;
+    // Serves on a unix domain socket instead of the hostname and port, must be set before the server starts.
+    // '@' prefix for the abstract namespace, a filesystem socket is created with 0600 permissions.
+    // A socket file that still accepts connections is not replaced. On linux, requests of peers running as
+    // a user other than the server's or root are answered 403.
+    GENERIC set_unix_socket_path(const mbase::string& in_path);
+    const McpServerHttpLimits& get_limits() const noexcept;
+    I32 get_in_flight_request_count() const noexcept;
+    U64 get_rejected_request_count() const noexcept;
+    // Must be set before the server starts.
+    GENERIC set_limits(const McpServerHttpLimits& in_limits);
 protected:
+    struct token_bucket {
+        F64 mTokens = 0.0;
+        I64 mLastRefillMs = 0;
+    };
+
+    // Whether the session id belongs to a live session, the rate limit is keyed by the address otherwise
+    // so that made up session ids don't get a fresh bucket each.
+    virtual bool _is_known_session(const mbase::string& in_session_id);
+    GENERIC _listen();
+
     std::unique_ptr<httplib::Server> svr;
     mbase::string mHostname = "localhost";
     mbase::string mApiKey;
     I32 mPort = 8000;
+    mbase::string mUnixSocketPath;
+private:
+    I32 _take_token(const mbase::string& in_key); // 0 if admitted, seconds to retry after otherwise
+
+    McpServerHttpLimits mLimits;
+    mbase::mutex mBucketSync;
+    mbase::unordered_map<mbase::string, token_bucket> mTokenBuckets;
+    I64 mLastBucketPruneMs = 0;
+    std::atomic<I32> mInFlightRequests = 0;
+    std::atomic<U64> mRejectedRequests = 0;
 };
 
 class MBASE_API McpServerHttpStreamableStateful : public mbase::McpServerHttpBase {
@@ -51,7 +104,10 @@ public:
     ~McpServerHttpStreamableStateful();
     bool is_server_running() const noexcept;
     GENERIC update_t() override;
+protected:
+    bool _is_known_session(const mbase::string& in_session_id) override;
 private:
+    mbase::mutex mStreamableClientsSync; // the http workers look up and add sessions concurrently
     mbase::unordered_map<mbase::string, mbase::McpServerClientHttpStreamable*> mStreambleClients;
 };
 
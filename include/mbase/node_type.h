@@ -3,6 +3,7 @@
 
 #include <mbase/common.h>
 #include <mbase/algorithm.h> // mbase::max
+#include <new>
 
 MBASE_STD_BEGIN
 
@@ -147,26 +148,49 @@ struct avl_node {
     ~avl_node() noexcept {}
     static I32 get_height(avl_node* in_node) { return (in_node == nullptr) ? -1 : in_node->height; }
 
-    template<typename ExternalIterator>
-    static std::pair<ExternalIterator, bool> insert_node(avl_node*& in_node, const T& in_value, avl_node* in_parent)
+    template<typename NodeAllocator>
+    static avl_node* create_node(NodeAllocator& in_alloc, const T& in_value)
+    {
+        avl_node* newNode = in_alloc.allocate(1);
+        new (newNode) avl_node(in_value);
+        return newNode;
+    }
+
+    template<typename NodeAllocator>
+    static avl_node* create_node(NodeAllocator& in_alloc, T&& in_value)
+    {
+        avl_node* newNode = in_alloc.allocate(1);
+        new (newNode) avl_node(std::move(in_value));
+        return newNode;
+    }
+
+    template<typename NodeAllocator>
+    static GENERIC destroy_node(NodeAllocator& in_alloc, avl_node* in_node)
+    {
+        in_node->~avl_node();
+        in_alloc.deallocate(in_node, 1);
+    }
+
+    template<typename ExternalIterator, typename NodeAllocator>
+    static std::pair<ExternalIterator, bool> insert_node(avl_node*& in_node, const T& in_value, avl_node* in_parent, NodeAllocator& in_alloc)
     {
         key_compare comparator;
         std::pair<ExternalIterator, bool> resultPair = std::make_pair(nullptr, false);
         if (in_node == nullptr)
         {
-            in_node = new avl_node(in_value);
+            in_node = create_node(in_alloc, in_value);
             in_node->parent = in_parent;
             resultPair = std::make_pair(in_node, true);
             balance(in_node);
         }
         else if (comparator(in_value, in_node->data))
         {
-            resultPair = insert_node<ExternalIterator>(in_node->left, in_value, in_node);
+            resultPair = insert_node<ExternalIterator>(in_node->left, in_value, in_node, in_alloc);
             balance(in_node);
         }
         else if (comparator(in_node->data, in_value))
         {
-            resultPair = insert_node<ExternalIterator>(in_node->right, in_value, in_node);
+            resultPair = insert_node<ExternalIterator>(in_node->right, in_value, in_node, in_alloc);
             balance(in_node);
         }
         else
@@ -181,25 +205,25 @@ struct avl_node {
         return resultPair;
     }
     
-    template<typename ExternalIterator>
-    static std::pair<ExternalIterator, bool> insert_node(avl_node*& in_node, T&& in_value, avl_node* in_parent)
+    template<typename ExternalIterator, typename NodeAllocator>
+    static std::pair<ExternalIterator, bool> insert_node(avl_node*& in_node, T&& in_value, avl_node* in_parent, NodeAllocator& in_alloc)
     {
         key_compare comparator;
         std::pair<ExternalIterator, bool> resultPair = std::make_pair(nullptr, false);
         if (in_node == nullptr)
         {
-            in_node = new avl_node(std::move(in_value));
+            in_node = create_node(in_alloc, std::move(in_value));
             in_node->parent = in_parent;
             resultPair = std::make_pair(ExternalIterator(in_node), true);
             balance(in_node);
         }
         else if (comparator(in_value, in_node->data))
         {
-            resultPair = insert_node<ExternalIterator>(in_node->left, std::move(in_value), in_node);
+            resultPair = insert_node<ExternalIterator>(in_node->left, std::move(in_value), in_node, in_alloc);
         }
         else if (comparator(in_node->data, in_value))
         {
-            resultPair = insert_node<ExternalIterator>(in_node->right, std::move(in_value), in_node);
+            resultPair = insert_node<ExternalIterator>(in_node->right, std::move(in_value), in_node, in_alloc);
         }
         else
         {
@@ -313,7 +337,8 @@ struct avl_node {
     }
 
 
-    static GENERIC remove_node(avl_node*& in_node, const T& in_value)
+    template<typename NodeAllocator>
+    static GENERIC remove_node(avl_node*& in_node, const T& in_value, NodeAllocator& in_alloc)
     {
         if (!in_node)
         {
@@ -324,11 +349,11 @@ struct avl_node {
             key_compare comparator;
             if (comparator(in_value, in_node->data))
             {
-                remove_node(in_node->left, in_value);
+                remove_node(in_node->left, in_value, in_alloc);
             }
             else if (comparator(in_node->data, in_value))
             {
-                remove_node(in_node->right, in_value);
+                remove_node(in_node->right, in_value, in_alloc);
             }
             else
             {
@@ -340,7 +365,7 @@ struct avl_node {
                         successor = successor->left;
                     }
                     in_node->data = std::move(successor->data);
-                    remove_node(in_node->right, successor->data);
+                    remove_node(in_node->right, successor->data, in_alloc);
                     return;
                 }
                 
@@ -371,7 +396,7 @@ struct avl_node {
                     in_node = nullptr;
                 }
                 
-                delete current;
+                destroy_node(in_alloc, current);
             }
         }
         balance(in_node);
@@ -7,6 +7,7 @@
 #include <mbase/string.h>
 #include <mbase/list.h>
 #include <mbase/vector.h>
+#include <mbase/unordered_map.h>
 #include <mbase/synchronization.h>
 #include <mbase/framework/timers.h>
 #include <mbase/framework/object_watcher.h>
@@ -14,28 +15,76 @@
 #include <mbase/wsa_init.h>
 #endif // MBASE_PLATFORM_WINDOWS
 #include <mbase/framework/logical_processing.h>
+#include <mbase/pc/pc_stream_manager.h>
 #include <memory>
 
 MBASE_BEGIN
 
-static const U16 gNetDefaultPacketSize = 32768; // 32KB
+static const U32 gNetMinReadSize = 4096; // a read starts in a stack buffer of this size, a pooled buffer is taken only if bytes arrive
+static const U32 gNetMaxReadSize = 1048576; // 1MB, the most a single on_data delivers
+static const U32 gNetMaxWriteSlices = 64; // slices flushed by a single vectored send
+static const U32 gNetZeroCopyThreshold = 65536; // sends of at least this many bytes use MSG_ZEROCOPY where it is available
+static const U32 gNetMaxAcceptBatch = 64; // connections taken from the backlog in one I/O loop
+static const U32 gNetMaxIoWaitMs = 50; // longest the I/O thread sleeps in poll, the timeouts are checked at least this often
 
 class PcNetClient;
 class PcNetServer;
 class PcNetPeerClient;
+class PcNetManager;
+class PcNetConnectionPool;
+class PcDiagnostics;
+class PcNetIoWakeup; // wakes the I/O thread of a manager from its poll
+
+// a socket the I/O thread waits on
+struct MBASE_API PcNetIoInterest {
+	#ifdef MBASE_PLATFORM_WINDOWS
+	SOCKET mSocket;
+	#endif
+	#ifdef MBASE_PLATFORM_UNIX
+	I32 mSocket;
+	#endif
+	bool mRead;
+	bool mWrite;
+};
+
+// a resolved socket address, large enough for a sockaddr_storage
+struct MBASE_API PcNetEndpoint {
+	I32 mFamily = 0;
+	U32 mLength = 0;
+	alignas(8) U8 mAddress[128] = {0};
+};
+
+// an outbound buffer that can be queued on many peers without being copied
+using PcNetSharedBuffer = std::shared_ptr<const mbase::string>;
+
+struct MBASE_API PcNetBufferSlice {
+	PcNetSharedBuffer mBuffer;
+	mbase::string* mAppendable = NULL; // set on the copies write_data makes, small writes are coalesced into them until they are sent
+	SIZE_T mOffset = 0;
+	SIZE_T mLength = 0;
+};
 
 struct MBASE_API PcNetPacket {
-	PcNetPacket(U16 in_min_packet_size = gNetDefaultPacketSize) noexcept;
-	PcNetPacket(const PcNetPacket& in_rhs) noexcept;
+	using size_type = SIZE_T;
+
+	PcNetPacket() noexcept;
 	PcNetPacket(PcNetPacket&& in_rhs) noexcept;
+	~PcNetPacket();
 
-	PcNetPacket& operator=(const PcNetPacket& in_rhs) noexcept;
 	PcNetPacket& operator=(PcNetPacket&& in_rhs) noexcept;
 
-	~PcNetPacket() = default;
-
-	mbase::deep_char_stream mPacketContent;
-	mbase::string mWriteBuffer;
+	GENERIC release_read_buffer() noexcept;
+	GENERIC clear() noexcept;
+
+	IBYTEBUFFER mReadBuffer;
+	size_type mReadCapacity;
+	size_type mReadLength;
+	mbase::vector<PcNetBufferSlice> mWriteQueue;
+	size_type mWriteQueueFront;
+	size_type mPendingWriteBytes;
+	mbase::vector<std::pair<U32, PcNetSharedBuffer>> mZeroCopyPending; // buffers the kernel may still read from
+	U32 mZeroCopySequence;
+	I8 mZeroCopyState; // 0 untried, 1 enabled, -1 unavailable
 };
 
 class MBASE_API PcNetPeerClient : public non_copyable {
@@ -52,6 +101,7 @@ public:
 	friend class PcNetManager;
 	friend class PcNetClient;
 	friend class PcNetTcpServer;
+	friend class PcNetConnectionPool;
 
 	enum class flags : U8 {
 		NET_PEER_SUCCCES,
@@ -61,7 +111,8 @@ public:
 		NET_PEER_ERR_DISCONNECTED,
 		NET_PEER_ERR_ALREADY_PROCESSED,
 		NET_PEER_ERR_DATA_IS_NOT_AVAILABLE,
-		NET_PEER_ERR_INVALID_SIZE
+		NET_PEER_ERR_INVALID_SIZE,
+		NET_PEER_ERR_WRITE_LIMIT // the peer doesn't read its output, it is disconnected
 	};
 
 	PcNetPeerClient(socket_handle in_socket);
@@ -80,11 +131,24 @@ public:
 	MBASE_ND(MBASE_OBS_IGNORE) mbase::string get_peer_addr() const noexcept;
 	MBASE_ND(MBASE_OBS_IGNORE) I32 get_peer_port() const noexcept;
 	MBASE_ND(MBASE_OBS_IGNORE) socket_handle get_raw_socket() const noexcept;
-
-	flags write_data(CBYTEBUFFER in_data, size_type in_size); // TODO: CHECK NET PACKET OVERFLOW
+	MBASE_ND(MBASE_OBS_IGNORE) bool is_local_peer() const noexcept; // connected through a unix domain socket
+	MBASE_ND(MBASE_OBS_IGNORE) I32 get_peer_pid() const noexcept; // -1 if the platform doesn't report it
+	MBASE_ND(MBASE_OBS_IGNORE) I32 get_peer_uid() const noexcept; // -1 on tcp peers
+	MBASE_ND(MBASE_OBS_IGNORE) I32 get_peer_gid() const noexcept; // -1 on tcp peers
+
+	MBASE_ND(MBASE_OBS_IGNORE) size_type get_pending_write_size() noexcept;
+	// True once the pending output goes above the high watermark, until it drains below the low one.
+	// Producers should stop generating for the peer meanwhile, the server calls on_write_drained when it clears.
+	MBASE_ND(MBASE_OBS_IGNORE) bool is_write_paused() noexcept;
+
+	flags write_data(CBYTEBUFFER in_data, size_type in_size); // copied into the write queue
+	flags write_buffer(const PcNetSharedBuffer& in_buffer); // queued without a copy, the buffer must not change until it is sent
+	flags write_buffer(const PcNetSharedBuffer& in_buffer, size_type in_offset, size_type in_length);
 	flags send_read_signal();
 	flags send_write_signal();
 	flags disconnect();
+	GENERIC set_write_watermarks(size_type in_high_watermark, size_type in_low_watermark); // 0 disables the pausing
+	GENERIC set_max_pending_write(size_type in_max_size); // writes above it disconnect the peer, 0 is unlimited
 
 	bool operator==(const PcNetPeerClient& in_rhs);
 	bool operator!=(const PcNetPeerClient& in_rhs);
@@ -92,6 +156,13 @@ public:
 private:
 	GENERIC _destroy_peer() noexcept;
 	GENERIC _set_new_socket_handle(socket_handle in_socket) noexcept;
+	bool _update_io(); // recv/send of the I/O thread, false if the peer is destroyed
+	bool _read_io();
+	bool _write_io();
+	GENERIC _reap_zero_copy() noexcept;
+	GENERIC _begin_dispatch() noexcept; // the read buffer is handed to on_data
+	GENERIC _end_dispatch() noexcept; // releases it and signals the read deferred meanwhile
+	GENERIC _wake_io() noexcept;
 
 	socket_handle mPeerSocket;
 	processor_signal mReadSignal;
@@ -99,7 +170,24 @@ private:
 	processor_signal mDisconnectSignal;
 	mbase::string mPeerAddr;
 	I32 mPeerPort;
+	I32 mPeerPid;
+	I32 mPeerUid;
+	I32 mPeerGid;
+	bool mIsLocalPeer;
 	PcNetPacket mNetPacket;
+	mbase::mutex mWriteMutex;
+	mbase::mutex mReadMutex; // the read signal and the flags below, set from the I/O thread and the dispatching one
+	bool mIsDispatchingData; // read signals are deferred while on_data uses the receive buffer
+	bool mIsReadDeferred;
+	std::shared_ptr<PcNetIoWakeup> mIoWakeup; // of the manager the peer is served by
+	size_type mWriteHighWatermark;
+	size_type mWriteLowWatermark;
+	size_type mMaxPendingWrite;
+	bool mIsWritePaused;
+	bool mIsWriteLimitExceeded;
+	processor_signal mDrainSignal; // the paused output drained, update dispatches it
+	U64 mLastActivityTime; // last recv or send that moved bytes, I/O thread only
+	U64 mWriteStallTime; // since when the pending output can't be sent, 0 if it can
 };
 
 class MBASE_API PcNetServer : public non_copymovable {
@@ -130,8 +218,14 @@ public:
 	MBASE_ND(MBASE_OBS_IGNORE) bool is_listening() const noexcept;
 	MBASE_ND(MBASE_OBS_IGNORE) mbase::string get_address() const noexcept;
 	MBASE_ND(MBASE_OBS_IGNORE) I32 get_port() const noexcept;
+	MBASE_ND(MBASE_OBS_IGNORE) bool is_local() const noexcept; // created with create_local_server, the address is the socket path
+	MBASE_ND(MBASE_OBS_IGNORE) bool is_local_peer_allowed(I32 in_uid) const noexcept;
 
 	flags listen() noexcept;
+	// Local peers are authenticated by the uid the kernel reports for them.
+	// The uid of the server process and root are always allowed.
+	GENERIC allow_local_uid(I32 in_uid);
+	GENERIC allow_any_local_uid(bool in_allow) noexcept;
 	flags stop() noexcept;
 	GENERIC acquire_object_watcher(mbase::list_object_watcher<PcNetServer>* in_watcher);
 	GENERIC release_object_watcher();
@@ -140,13 +234,45 @@ public:
 	virtual GENERIC update_t() = 0;
 
 protected:
+	virtual GENERIC _collect_io(mbase::vector<PcNetIoInterest>& out_interests); // the sockets the manager polls for the server
+
 	mbase::list_object_watcher<PcNetServer>* mObjectWatcher;
+	std::shared_ptr<PcNetIoWakeup> mIoWakeup;
 	bool mIsListening;
+	bool mIsAcceptReady; // the listener polled readable, set by the manager before update_t
 	socket_handle mRawSocket;
 	mbase::string mAddr;
 	I32 mPort;
+	bool mIsLocal;
+	bool mIsAnyLocalUidAllowed;
+	mbase::vector<I32> mAllowedLocalUids;
+};
+
+struct MBASE_API PcNetServerLimits {
+	U32 mMaxConnections = 0; // 0 is unlimited
+	U32 mMaxConnectionsPerAddress = 0; // tcp peers only, 0 is unlimited
+	U32 mIdleTimeoutMs = 0; // nothing received or sent for this long, 0 disables
+	U32 mReadTimeoutMs = 0; // the peer leaves its pending output unread for this long, 0 disables
+	SIZE_T mWriteHighWatermark = 1048576; // output of a peer is paused above
+	SIZE_T mWriteLowWatermark = 262144; // and resumed below
+	SIZE_T mMaxPendingWrite = 16777216; // a peer with more unsent output is disconnected, 0 is unlimited
+};
+
+struct MBASE_API PcNetServerStatistics {
+	U64 mAcceptedConnections = 0;
+	U64 mRejectedConnections = 0; // over the connection limits
+	U64 mIdleTimeouts = 0;
+	U64 mReadTimeouts = 0;
+	U64 mWriteLimitDisconnects = 0;
+	U64 mWritePauses = 0;
 };
 
+/*
+	PcNetTcpServer applies the PcNetServerLimits on the I/O thread: connections over the limits are closed
+	right after accept, idle and slow peers are disconnected and every peer gets the write watermarks.
+	The events are counted in PcNetServerStatistics and, if a PcDiagnostics is set, logged into it from update().
+*/
+
 class MBASE_API PcNetTcpServer : public PcNetServer {
 public:
 	using client_list = mbase::list<std::shared_ptr<PcNetPeerClient>>;
@@ -156,6 +282,8 @@ public:
 	~PcNetTcpServer();
 
 	MBASE_ND(MBASE_OBS_IGNORE) const client_list& get_connected_peers() const noexcept;
+	MBASE_ND(MBASE_OBS_IGNORE) PcNetServerLimits get_limits() noexcept;
+	MBASE_ND(MBASE_OBS_IGNORE) PcNetServerStatistics get_statistics() noexcept;
 	bool signal_accepting();
 	bool signal_state_accepting();
 	bool signal_processing_data();
@@ -164,31 +292,221 @@ public:
 	virtual GENERIC on_accept(std::shared_ptr<PcNetPeerClient> out_peer) = 0;
 	virtual GENERIC on_data(std::shared_ptr<PcNetPeerClient> out_peer, CBYTEBUFFER out_data, size_type out_size) = 0;
 	virtual GENERIC on_disconnect(std::shared_ptr<PcNetPeerClient> out_peer) = 0;
+	virtual GENERIC on_write_drained(std::shared_ptr<PcNetPeerClient> out_peer); // the output of a paused peer is below the low watermark
 
-	GENERIC accept();
+	GENERIC set_limits(const PcNetServerLimits& in_limits); // applies to the peers accepted afterwards
+	GENERIC set_diagnostics(PcDiagnostics* in_diagnostics) noexcept;
+	bool accept(); // false if the backlog is empty
 	GENERIC update() override;
 	GENERIC update_t() override;
 
+protected:
+	GENERIC _collect_io(mbase::vector<PcNetIoInterest>& out_interests) override;
+
 private:
+	GENERIC _record_event(U64 PcNetServerStatistics::* in_counter, const mbase::string& in_message);
+	GENERIC _release_address(const std::shared_ptr<PcNetPeerClient>& in_peer);
+
 	accept_clients mAcceptClients;
 	client_list mConnectedClients;
 	client_list mConnectedClientsProcessLoop;
 	mbase::mutex mAcceptMutex;
+	mbase::mutex mLimitsMutex; // limits, statistics and the events are shared with the I/O thread
+	PcNetServerLimits mLimits;
+	PcNetServerStatistics mStatistics;
+	mbase::vector<mbase::string> mPendingEvents;
+	PcDiagnostics* mDiagnostics;
+	mbase::unordered_map<mbase::string, U32> mAddressConnections; // I/O thread only
 
 	processor_signal mConnectionAccept;
 	processor_signal mDataProcess;
 };
 
+/*
+	PcNetClient is the outgoing connection counterpart of the PcNetTcpServer.
+	PcNetManager::create_connection resolves the address for both IPv4 and IPv6 and returns immediately.
+	The I/O thread of the manager tries the resolved addresses one after another with non-blocking
+	connects, alternating between the address families, each attempt gets a share of the remaining timeout.
+
+	The callbacks are called from update(), on the thread that calls it, same as the server callbacks.
+	The connected peer is read and written through the PcNetPeerClient interface.
+*/
+
+class MBASE_API PcNetClient : public non_copymovable {
+public:
+	using size_type = SIZE_T;
+	#ifdef MBASE_PLATFORM_WINDOWS
+	using socket_handle = SOCKET;
+	#endif
+
+	#ifdef MBASE_PLATFORM_UNIX
+	using socket_handle = I32;
+	#endif
+
+	friend class PcNetManager;
+	friend class PcNetConnectionPool;
+
+	enum class flags : U8 {
+		NET_CLIENT_SUCCESS,
+		NET_CLIENT_ERR_HOST_NOT_FOUND,
+		NET_CLIENT_ERR_CONNECTION_FAILED, // every resolved address refused or was unreachable
+		NET_CLIENT_ERR_TIMEOUT,
+		NET_CLIENT_ERR_NOT_CONNECTED,
+		NET_CLIENT_ERR_BUSY
+	};
+
+	PcNetClient();
+	~PcNetClient();
+
+	virtual GENERIC on_connect(std::shared_ptr<PcNetPeerClient> out_peer) = 0;
+	virtual GENERIC on_connect_failed(flags out_reason) = 0;
+	virtual GENERIC on_data(std::shared_ptr<PcNetPeerClient> out_peer, CBYTEBUFFER out_data, size_type out_size) = 0;
+	virtual GENERIC on_disconnect(std::shared_ptr<PcNetPeerClient> out_peer) = 0;
+
+	MBASE_ND(MBASE_OBS_IGNORE) bool is_connecting() const noexcept;
+	MBASE_ND(MBASE_OBS_IGNORE) bool is_connected() const noexcept;
+	MBASE_ND(MBASE_OBS_IGNORE) std::shared_ptr<PcNetPeerClient> get_peer();
+	MBASE_ND(MBASE_OBS_IGNORE) mbase::string get_address() const noexcept;
+	MBASE_ND(MBASE_OBS_IGNORE) I32 get_port() const noexcept;
+
+	flags disconnect();
+
+	GENERIC update();
+	GENERIC update_t();
+
+private:
+	enum class connect_state : U8 {
+		IDLE,
+		CONNECTING,
+		CONNECTED,
+		FAILED
+	};
+
+	GENERIC _begin_connect(const mbase::vector<PcNetEndpoint>& in_endpoints, const mbase::string& in_addr, I32 in_port, U32 in_timeout_ms);
+	GENERIC _attach_socket(socket_handle in_socket, const mbase::string& in_addr, I32 in_port);
+	socket_handle _detach_socket(); // hands the connected socket over without closing it
+	GENERIC _close_pending_socket() noexcept;
+	GENERIC _step_connect();
+	GENERIC _collect_io(mbase::vector<PcNetIoInterest>& out_interests);
+	GENERIC _release_watcher();
+
+	PcNetManager* mManager;
+	mbase::list_object_watcher<PcNetClient>* mObjectWatcher;
+	mbase::mutex mStateMutex;
+	volatile connect_state mConnectState;
+	flags mConnectResult;
+	processor_signal mConnectSignal; // the connect attempt finished, update dispatches it
+	mbase::vector<PcNetEndpoint> mEndpoints;
+	size_type mEndpointIndex;
+	socket_handle mPendingSocket;
+	U64 mAttemptDeadline;
+	U64 mConnectDeadline;
+	bool mIsTimedOut;
+	std::shared_ptr<PcNetPeerClient> mPeer;
+	mbase::string mAddr;
+	I32 mPort;
+};
+
+/*
+	PcNetConnectionPool keeps connected sockets keyed by their address and port so that a gateway or a
+	client with many sessions doesn't reconnect for every exchange.
+	An idle connection is checked before it is handed out again and by update(): a connection the peer closed
+	or that has unread data on it is dropped, so is one idle for longer than the idle timeout.
+*/
+
+class MBASE_API PcNetConnectionPool : public non_copymovable {
+public:
+	using size_type = SIZE_T;
+	using socket_handle = PcNetClient::socket_handle;
+
+	enum class flags : U8 {
+		NET_POOL_SUCCESS,
+		NET_POOL_REUSED, // an idle connection is attached, on_connect is called on the next update of the client
+		NET_POOL_ERR_HOST_NOT_FOUND,
+		NET_POOL_ERR_CLIENT_BUSY,
+		NET_POOL_ERR_NOT_CONNECTED,
+		NET_POOL_ERR_PENDING_WRITE
+	};
+
+	PcNetConnectionPool(PcNetManager& in_manager, U32 in_max_idle_per_key = 8, U32 in_idle_timeout_ms = 60000, U32 in_connect_timeout_ms = 5000);
+	~PcNetConnectionPool();
+
+	MBASE_ND(MBASE_OBS_IGNORE) size_type get_idle_count() const noexcept;
+	MBASE_ND(MBASE_OBS_IGNORE) size_type get_idle_count(const mbase::string& in_addr, I32 in_port) const noexcept;
+
+	flags acquire(const mbase::string& in_addr, I32 in_port, PcNetClient& out_client);
+	flags release(PcNetClient& in_client); // the client is detached without on_disconnect
+	GENERIC update(); // idle eviction and health checks
+	GENERIC clear();
+
+private:
+	struct idle_connection {
+		socket_handle mSocket;
+		U64 mIdleSince;
+	};
+	using idle_list = mbase::vector<idle_connection>;
+
+	static mbase::string _make_key(const mbase::string& in_addr, I32 in_port);
+	static bool _is_healthy(socket_handle in_socket) noexcept;
+	static GENERIC _close_socket(socket_handle in_socket) noexcept;
+
+	PcNetManager* mManager;
+	mbase::unordered_map<mbase::string, idle_list> mIdleConnections;
+	U32 mMaxIdlePerKey;
+	U32 mIdleTimeout;
+	U32 mConnectTimeout;
+};
+
+/*
+	PcNetHandoffQueue carries peer events from the threads that call the server callbacks to the thread
+	that owns the application state. Sharded servers frame their requests on their own reactor threads and
+	post only the complete requests, the owner takes them in batches.
+	Writing to a peer is thread safe, the owner replies on the peer directly.
+*/
+
+class MBASE_API PcNetHandoffQueue : public non_copymovable {
+public:
+	using size_type = SIZE_T;
+
+	enum class event_type : U8 {
+		NET_HANDOFF_DATA,
+		NET_HANDOFF_WRITE_DRAINED
+	};
+
+	struct handoff_event {
+		event_type mType;
+		std::shared_ptr<PcNetPeerClient> mPeer;
+		mbase::string mData;
+	};
+	using event_list = mbase::vector<handoff_event>;
+
+	MBASE_ND(MBASE_OBS_IGNORE) size_type get_pending_count() noexcept;
+
+	GENERIC post(event_type in_type, std::shared_ptr<PcNetPeerClient> in_peer, CBYTEBUFFER in_data = NULL, size_type in_size = 0);
+	GENERIC take_all(event_list& out_events); // out_events is replaced, keep it across calls to reuse its memory
+
+private:
+	mbase::mutex mQueueMutex;
+	event_list mEvents;
+};
+
 class MBASE_API PcNetManager : public logical_processor {
 public:
 	using watcher_type = mbase::list_object_watcher<PcNetServer>;
 	using servers_list = mbase::list<watcher_type>;
+	using client_watcher_type = mbase::list_object_watcher<PcNetClient>;
+	using clients_list = mbase::list<client_watcher_type>;
+
+	friend class PcNetClient;
+	friend class PcNetConnectionPool;
 
 	enum class flags : U8 {
 		NET_MNG_SUCCESS,
 		NET_MNG_ERR_ADDR_IN_USE,
 		NET_MNG_ERR_HOST_NOT_FOUND,
 		NET_MNG_ERR_AWAITING_PREVIOUS_CONNECTION,
+		NET_MNG_ERR_INVALID_PATH,
+		NET_MNG_ERR_UNSUPPORTED,
 		NET_MNG_ERR_UNKNOWN
 	};
 
@@ -198,16 +516,67 @@ public:
 	};
 
 	PcNetManager();
-	~PcNetManager();
-	// flags create_connection(const mbase::string& in_addr, I32 in_port, PcNetClient& out_client);
-	flags create_server(const mbase::string& in_addr, I32 in_port, PcNetServer& out_server);
+	virtual ~PcNetManager();
+	// Resolves in_addr on the calling thread, the connect itself happens on the I/O thread
+	flags create_connection(const mbase::string& in_addr, I32 in_port, PcNetClient& out_client, U32 in_timeout_ms = 5000);
+	// With in_reuse_port, the listener is opened with SO_REUSEPORT so that the listeners of other managers
+	// share the port. Linux spreads the incoming connections across them, see PcNetReactorGroup.
+	flags create_server(const mbase::string& in_addr, I32 in_port, PcNetServer& out_server, bool in_reuse_port = false);
+	// Unix domain stream socket, peers show up through the same PcNetTcpServer callbacks.
+	// A leading '@' binds to the linux abstract namespace, otherwise in_path is a filesystem path,
+	// a stale socket file left by a dead server is removed and the new one gets in_permissions.
+	flags create_local_server(const mbase::string& in_path, PcNetServer& out_server, U32 in_permissions = 0600);
+
+	GENERIC set_processor_core(I32 in_core) noexcept; // pins the I/O thread to a core when it starts, -1 doesn't pin
+	// The server and client callbacks are called from the I/O thread of the manager,
+	// their update() must not be called by the program then.
+	GENERIC set_dispatch_on_io_thread(bool in_dispatch) noexcept;
 
 	GENERIC update() override;
 	GENERIC update_t() override;
 
 private:
+	GENERIC _register_server(PcNetServer& out_server);
+	GENERIC _register_client(PcNetClient& out_client);
+	static flags _resolve(const mbase::string& in_addr, I32 in_port, mbase::vector<PcNetEndpoint>& out_endpoints);
+	GENERIC _wait_io(); // sleeps until a polled socket is ready, the manager is woken or gNetMaxIoWaitMs passes
+
+	std::shared_ptr<PcNetIoWakeup> mIoWakeup;
+	mbase::vector<PcNetIoInterest> mIoInterests; // I/O thread only
+	mbase::vector<PcNetServer::socket_handle> mReadyListeners; // I/O thread only
 	mbase::mutex mServerReleaseLock;
 	servers_list mServers;
+	mbase::mutex mClientReleaseLock;
+	clients_list mClients;
+	I32 mProcessorCore;
+	bool mIsDispatchingOnIoThread;
+};
+
+/*
+	PcNetReactorGroup runs a server on N reactors, each one is a PcNetManager with its own I/O thread pinned to a core
+	and its own listener on the same port (SO_REUSEPORT). The kernel balances the connections between the listeners
+	and a connection stays on the reactor that accepted it, the server callbacks are called from that reactor's thread,
+	so the servers of the shards share nothing unless the program does.
+	A reactor with nothing to do sleeps in poll on its listener and peers, writes and read signals from other threads wake it.
+	Application state that isn't thread safe is reached through a PcNetHandoffQueue.
+*/
+
+class MBASE_API PcNetReactorGroup : public non_copymovable {
+public:
+	using size_type = SIZE_T;
+
+	PcNetReactorGroup(U32 in_shard_count = 0, bool in_pin_to_cores = true); // 0 is a shard per hardware thread
+	~PcNetReactorGroup();
+
+	MBASE_ND(MBASE_OBS_IGNORE) size_type get_shard_count() const noexcept;
+	MBASE_ND(MBASE_OBS_IGNORE) PcNetManager& get_shard(size_type in_index);
+
+	// in_servers holds a server per shard, the listener of the first shard that fails is the error
+	PcNetManager::flags create_server(const mbase::string& in_addr, I32 in_port, PcNetServer* const* in_servers);
+	GENERIC update(); // removes released servers and clients of the shards
+
+private:
+	mbase::vector<PcNetManager*> mShards;
 };
 
 MBASE_END
@@ -6,6 +6,7 @@
 #include <mbase/behaviors.h>
 #include <mbase/vector.h>
 #include <mbase/stack.h>
+#include <atomic>
 
 MBASE_BEGIN
 
@@ -13,11 +14,41 @@ MBASE_BEGIN
 
 static const U32 gDefaultStreamCount = 32;
 static const U32 gDefaultStreamSize = 0xfffff; // 1MB
+static const U32 gStreamMinClassShift = 12; // 4KB, the smallest size class and the alignment of every pooled buffer
+static const U32 gStreamMaxClassShift = 26; // 64MB, larger buffers are allocated and freed on every use
+static const U32 gStreamHugePageShift = 21; // 2MB, buffers from this size on are mapped directly and may be backed by huge pages
+static const U64 gStreamDefaultHighWatermark = 268435456; // 256MB
+
+struct MBASE_API PcStreamPoolStatistics {
+	U64 mHits = 0; // served from a thread cache or a free list
+	U64 mMisses = 0; // served by a new allocation
+	U64 mHugePageAllocations = 0;
+	U64 mTrimmedBytes = 0; // freed by the high watermark or trim calls
+	U64 mBytesResident = 0; // pooled and ready to be handed out
+	U64 mBytesInUse = 0; // handed out and not released yet
+};
+
+/*
+	PcStreamManager is the buffer pool that the network, file I/O and inference paths share.
+
+	acquire_buffer rounds the size up to a power of two size class from 4KB to 64MB and the release_buffer
+	puts it back on the free list of its class. The free lists are lock-free stacks, so is the accounting.
+	The pool returned by get_shared also keeps a few small buffers per thread, most acquire/release pairs
+	of a thread don't touch the shared lists at all.
+
+	When the pooled bytes pass the high watermark, the pool frees buffers, largest first, until half of it remains.
+	Buffers of 2MB and more are mapped directly, on linux they are backed by huge pages when it is enabled,
+	with a transparent huge page hint if the hugetlb pool is empty.
+
+	The stream handle methods are kept for the I/O manager, they hand out deep_char_streams of the stream size
+	and grow when all of them are taken. They are not thread-safe.
+*/
 
 class MBASE_API PcStreamManager : public non_copymovable {
 public:
 
 	using stream_handle = I32;
+	using size_type = SIZE_T;
 
 	enum class flags : U8 {
 		STREAM_MNG_SUCCESS = 0,
@@ -25,23 +56,62 @@ public:
 		STREAM_ERR_INVALID_HANDLE
 	};
 
-	PcStreamManager() = default;
-	~PcStreamManager() = default;
+	PcStreamManager(size_type in_high_watermark = gStreamDefaultHighWatermark, bool in_huge_pages = false);
+	~PcStreamManager();
+
+	static PcStreamManager& get_shared();
 
 	flags get_stream_by_handle(stream_handle& in_stream_handle, char_stream*& out_stream);
 	U32 get_stream_count();
 	U32 get_stream_size();
+	MBASE_ND(MBASE_OBS_IGNORE) PcStreamPoolStatistics get_statistics() const noexcept;
+	MBASE_ND(MBASE_OBS_IGNORE) size_type get_high_watermark() const noexcept;
+	MBASE_ND(MBASE_OBS_IGNORE) bool is_huge_pages_enabled() const noexcept;
 
 	bool initialize(U32 in_stream_count = gDefaultStreamCount, U32 in_stream_size = gDefaultStreamSize);
 	flags acquire_stream(stream_handle& out_stream_handle);
 	flags acquire_stream(stream_handle& out_stream_handle, char_stream*& out_stream);
 	flags release_stream(stream_handle& in_stream_handle);
 
+	IBYTEBUFFER acquire_buffer(size_type in_size, size_type& out_capacity); // NULL if the allocation fails
+	GENERIC release_buffer(IBYTEBUFFER in_buffer, size_type in_capacity) noexcept; // in_capacity is the out_capacity of the acquire
+	GENERIC set_high_watermark(size_type in_bytes) noexcept;
+	GENERIC set_huge_pages(bool in_state) noexcept; // affects the allocations from now on, mapped buffers are released the same way either way
+	GENERIC trim(size_type in_target_bytes = 0) noexcept; // frees pooled buffers until at most in_target_bytes remain, thread caches excluded
+
 private:
-	mbase::vector<deep_char_stream> mStreams;
+	struct thread_cache;
+
+	static const U32 gClassCount = gStreamMaxClassShift - gStreamMinClassShift + 1;
+
+	struct free_list {
+		std::atomic<U64> mHead{0}; // buffer address, the low 12 and (on 64-bit) the upper 16 bits count the pushes against ABA
+		std::atomic<U32> mPoppers{0}; // a trimmed buffer is freed once no pop may still be reading it
+	};
+
+	static thread_cache& _get_thread_cache() noexcept; // used by the shared pool only
+	static U32 _get_size_class(size_type in_size) noexcept; // gClassCount if too large to pool
+	IBYTEBUFFER _allocate(size_type in_capacity) noexcept;
+	GENERIC _deallocate(IBYTEBUFFER in_buffer, size_type in_capacity) noexcept;
+	IBYTEBUFFER _pop_free(U32 in_size_class) noexcept;
+	GENERIC _push_free(U32 in_size_class, IBYTEBUFFER in_buffer) noexcept;
+
+	free_list mFreeLists[gClassCount];
+	std::atomic<U64> mHits{0};
+	std::atomic<U64> mMisses{0};
+	std::atomic<U64> mHugePageAllocations{0};
+	std::atomic<U64> mTrimmedBytes{0};
+	std::atomic<U64> mBytesResident{0};
+	std::atomic<U64> mBytesInUse{0};
+	std::atomic<size_type> mHighWatermark;
+	std::atomic<bool> mIsHugePages;
+	std::atomic<bool> mIsTrimming{false};
+	bool mIsThreadCached = false;
+
+	mbase::vector<deep_char_stream*> mStreams;
 	mbase::stack<I32> mHandleStack;
-	U32 mStreamCount;
-	U32 mStreamSize;
+	U32 mStreamCount = 0;
+	U32 mStreamSize = gDefaultStreamSize;
 };
 
 MBASE_END
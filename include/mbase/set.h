@@ -27,6 +27,7 @@ public:
 	using value_compare = Compare;
 	using _node_type = avl_node<Key, Compare>;
 	using allocator_type = Allocator;
+	using node_allocator = mbase::allocator_rebind_t<Allocator, _node_type>;
 	using reference = Key&;
 	using const_reference = const Key&;
 	using pointer = Key*;
@@ -45,7 +46,7 @@ public:
 	MBASE_INLINE set(set&& in_rhs, const Allocator& in_alloc);
 	MBASE_INLINE set(std::initializer_list<value_type> in_list, const Compare& in_comp = Compare(), const Allocator& in_alloc = Allocator());
 	template<typename InputIt, typename = std::enable_if_t<std::is_constructible_v<Key, typename std::iterator_traits<InputIt>::value_type>>>
-	set(InputIt in_begin, InputIt in_end, [[maybe_unused]] const Allocator& in_alloc = Allocator()) : mRootNode(nullptr), mSize(0) {
+	set(InputIt in_begin, InputIt in_end, const Allocator& in_alloc = Allocator()) : mRootNode(nullptr), mSize(0), mNodeAllocator(in_alloc) {
 		for (in_begin; in_begin != in_end; in_begin++)
 		{
 			insert(*in_begin);
@@ -144,6 +145,7 @@ public:
 private:
 	_node_type* mRootNode;
 	size_type mSize;
+	node_allocator mNodeAllocator;
 };
 
 /* ----- SET IMPLEMENTATION ----- */
@@ -153,12 +155,12 @@ MBASE_INLINE set<Key, Compare, Allocator>::set() : mRootNode(nullptr), mSize(0)
 }
 
 template<typename Key, typename Compare, typename Allocator>
-MBASE_INLINE set<Key, Compare, Allocator>::set([[maybe_unused]] const Compare& in_comp, [[maybe_unused]] const Allocator& in_alloc) : mRootNode(nullptr), mSize(0)
+MBASE_INLINE set<Key, Compare, Allocator>::set([[maybe_unused]] const Compare& in_comp, const Allocator& in_alloc) : mRootNode(nullptr), mSize(0), mNodeAllocator(in_alloc)
 {
 }
 
 template<typename Key, typename Compare, typename Allocator>
-MBASE_INLINE set<Key, Compare, Allocator>::set(const set& in_rhs) : mRootNode(nullptr), mSize(0) {
+MBASE_INLINE set<Key, Compare, Allocator>::set(const set& in_rhs) : mRootNode(nullptr), mSize(0), mNodeAllocator(in_rhs.mNodeAllocator) {
 	const_iterator itBegin = in_rhs.begin();
 	for (; itBegin != in_rhs.end(); itBegin++)
 	{
@@ -167,7 +169,7 @@ MBASE_INLINE set<Key, Compare, Allocator>::set(const set& in_rhs) : mRootNode(nu
 }
 
 template<typename Key, typename Compare, typename Allocator>
-MBASE_INLINE set<Key, Compare, Allocator>::set(const set& in_rhs, [[maybe_unused]] const Allocator& in_alloc) : mRootNode(nullptr), mSize(0) {
+MBASE_INLINE set<Key, Compare, Allocator>::set(const set& in_rhs, const Allocator& in_alloc) : mRootNode(nullptr), mSize(0), mNodeAllocator(in_alloc) {
 	const_iterator itBegin = in_rhs.begin();
 	for (; itBegin != in_rhs.end(); itBegin++)
 	{
@@ -176,22 +178,34 @@ MBASE_INLINE set<Key, Compare, Allocator>::set(const set& in_rhs, [[maybe_unused
 }
 
 template<typename Key, typename Compare, typename Allocator>
-MBASE_INLINE set<Key, Compare, Allocator>::set(set&& in_rhs) : mRootNode(in_rhs.mRootNode), mSize(in_rhs.mSize) {
+MBASE_INLINE set<Key, Compare, Allocator>::set(set&& in_rhs) : mRootNode(in_rhs.mRootNode), mSize(in_rhs.mSize), mNodeAllocator(in_rhs.mNodeAllocator) {
 	in_rhs.mRootNode = nullptr;
 	in_rhs.mSize = 0;
 }
 
 template<typename Key, typename Compare, typename Allocator>
-MBASE_INLINE set<Key, Compare, Allocator>::set(set&& in_rhs, [[maybe_unused]] const Allocator& in_alloc) {
-	mRootNode = in_rhs.mRootNode;
-	mSize = in_rhs.mSize;
+MBASE_INLINE set<Key, Compare, Allocator>::set(set&& in_rhs, const Allocator& in_alloc) : mRootNode(nullptr), mSize(0), mNodeAllocator(in_alloc) {
+	if(mNodeAllocator == in_rhs.mNodeAllocator)
+	{
+		mRootNode = in_rhs.mRootNode;
+		mSize = in_rhs.mSize;
 
-	in_rhs.mRootNode = nullptr;
-	in_rhs.mSize = 0;
+		in_rhs.mRootNode = nullptr;
+		in_rhs.mSize = 0;
+	}
+	else
+	{
+		// nodes can not be adopted across unequal allocators, move the keys one by one
+		for(iterator It = in_rhs.begin(); It != in_rhs.end(); It++)
+		{
+			insert(std::move(*It));
+		}
+		in_rhs.clear();
+	}
 }
 
 template<typename Key, typename Compare, typename Allocator>
-MBASE_INLINE set<Key, Compare, Allocator>::set(std::initializer_list<value_type> in_list, [[maybe_unused]] const Compare& in_comp, [[maybe_unused]] const Allocator& in_alloc) : mRootNode(nullptr), mSize(0) {
+MBASE_INLINE set<Key, Compare, Allocator>::set(std::initializer_list<value_type> in_list, [[maybe_unused]] const Compare& in_comp, const Allocator& in_alloc) : mRootNode(nullptr), mSize(0), mNodeAllocator(in_alloc) {
 	insert(in_list.begin(), in_list.end());
 }
 
@@ -313,7 +327,7 @@ MBASE_ND(MBASE_OBS_IGNORE) MBASE_INLINE typename set<Key, Compare, Allocator>::s
 
 template<typename Key, typename Compare, typename Allocator>
 MBASE_ND(MBASE_OBS_IGNORE) MBASE_INLINE typename set<Key, Compare, Allocator>::allocator_type set<Key, Compare, Allocator>::get_allocator() const noexcept {
-	return allocator_type();
+	return allocator_type(mNodeAllocator);
 }
 
 template<typename Key, typename Compare, typename Allocator>
@@ -459,7 +473,7 @@ MBASE_ND(MBASE_OBS_IGNORE) MBASE_INLINE typename set<Key, Compare, Allocator>::c
 
 template<typename Key, typename Compare, typename Allocator>
 MBASE_INLINE std::pair<typename set<Key, Compare, Allocator>::iterator, bool> set<Key, Compare, Allocator>::insert(const value_type& in_value) {
-	std::pair<iterator, bool> insertResult = _node_type::template insert_node<iterator>(mRootNode, in_value, mRootNode);
+	std::pair<iterator, bool> insertResult = _node_type::template insert_node<iterator>(mRootNode, in_value, mRootNode, mNodeAllocator);
 	if (insertResult.second)
 	{
 		++mSize;
@@ -470,7 +484,7 @@ MBASE_INLINE std::pair<typename set<Key, Compare, Allocator>::iterator, bool> se
 
 template<typename Key, typename Compare, typename Allocator>
 MBASE_INLINE std::pair<typename set<Key, Compare, Allocator>::iterator, bool> set<Key, Compare, Allocator>::insert(value_type&& in_value) {
-	std::pair<iterator, bool> insertResult = _node_type::template insert_node<iterator>(mRootNode, std::move(in_value), mRootNode);
+	std::pair<iterator, bool> insertResult = _node_type::template insert_node<iterator>(mRootNode, std::move(in_value), mRootNode, mNodeAllocator);
 	if (insertResult.second)
 	{
 		++mSize;
@@ -514,12 +528,12 @@ MBASE_INLINE typename set<Key, Compare, Allocator>::iterator set<Key, Compare, A
 	++itBegin;
 	if (mRootNode == nt)
 	{
-		mRootNode->remove_node(nt, *in_pos);
+		mRootNode->remove_node(nt, *in_pos, mNodeAllocator);
 		mRootNode = nt;
 	}
 	else
 	{
-		mRootNode->remove_node(nt, *in_pos);
+		mRootNode->remove_node(nt, *in_pos, mNodeAllocator);
 	}
 	--mSize;
 	return itBegin;
@@ -571,6 +585,7 @@ MBASE_INLINE GENERIC set<Key, Compare, Allocator>::swap(set& in_rhs) noexcept
 {
 	std::swap(mRootNode, in_rhs.mRootNode);
 	std::swap(mSize, in_rhs.mSize);
+	std::swap(mNodeAllocator, in_rhs.mNodeAllocator);
 }
 
 template<typename Key, typename Compare, typename Allocator>
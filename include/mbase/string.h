@@ -76,7 +76,7 @@ public:
 
     /* ===== BUILDER METHODS BEGIN ===== */
     MBASE_INLINE_EXPR character_sequence() noexcept;
-    MBASE_INLINE_EXPR character_sequence(pointer in_raw, size_type in_size, size_type in_capacity) noexcept; // THIS CONSTRUCTOR MUST NOT BE CALLED FROM OUTSIDE
+    MBASE_INLINE_EXPR character_sequence(pointer in_raw, size_type in_size, size_type in_capacity, const Allocator& in_alloc = Allocator()) noexcept; // THIS CONSTRUCTOR MUST NOT BE CALLED FROM OUTSIDE
     MBASE_INLINE_EXPR MBASE_EXPLICIT character_sequence(const Allocator& in_alloc) noexcept;
     MBASE_INLINE_EXPR character_sequence(size_type in_size, value_type in_ch, const Allocator& in_alloc = Allocator());
     MBASE_INLINE_EXPR character_sequence(const character_sequence& in_rhs, size_type in_pos, const Allocator& in_alloc = Allocator());
@@ -497,12 +497,12 @@ public:
         {
             totalCapacity *= 2; 
         }
-        allocator<SeqType> alc;
+        Allocator alc = in_lhs.mExternalAllocator;
         pointer new_data = alc.allocate(totalCapacity, true);
         //this->length();
-        SeqBase::concat(new_data, in_lhs.mRawData, in_lhs.mSize);
-        SeqBase::concat(new_data + in_lhs.mSize, in_rhs.mRawData, in_rhs.mSize);
-        return character_sequence(new_data, totalSize, totalCapacity);
+        SeqBase::copy_bytes(new_data, in_lhs.mRawData, in_lhs.mSize);
+        SeqBase::copy_bytes(new_data + in_lhs.mSize, in_rhs.mRawData, in_rhs.mSize);
+        return character_sequence(new_data, totalSize, totalCapacity, alc);
     }
     MBASE_INLINE_EXPR friend character_sequence operator+(const character_sequence& in_lhs, const_pointer in_rhs) noexcept {
         size_type rhsSize = SeqBase::length_bytes(in_rhs);
@@ -516,13 +516,13 @@ public:
         {
             totalCapacity *= 2;
         }
-        allocator<SeqType> alc;
+        Allocator alc = in_lhs.mExternalAllocator;
         pointer new_data = alc.allocate(totalCapacity, true);
 
-        SeqBase::concat(new_data, in_lhs.mRawData, in_lhs.mSize);
-        SeqBase::concat(new_data + in_lhs.mSize, in_rhs, rhsSize);
+        SeqBase::copy_bytes(new_data, in_lhs.mRawData, in_lhs.mSize);
+        SeqBase::copy_bytes(new_data + in_lhs.mSize, in_rhs, rhsSize);
 
-        return character_sequence(new_data, totalSize, totalCapacity);
+        return character_sequence(new_data, totalSize, totalCapacity, alc);
     }
     MBASE_INLINE_EXPR friend character_sequence operator+(const character_sequence& in_lhs, value_type in_rhs) noexcept {
         character_sequence cs = in_lhs;
@@ -588,7 +588,7 @@ MBASE_INLINE_EXPR character_sequence<SeqType, SeqBase, Allocator>::character_seq
 }
 
 template<typename SeqType, typename SeqBase, typename Allocator>
-MBASE_INLINE_EXPR character_sequence<SeqType, SeqBase, Allocator>::character_sequence(pointer in_raw, size_type in_size, size_type in_capacity) noexcept : mRawData(in_raw), mSize(in_size), mCapacity(in_capacity), mExternalAllocator(Allocator()) 
+MBASE_INLINE_EXPR character_sequence<SeqType, SeqBase, Allocator>::character_sequence(pointer in_raw, size_type in_size, size_type in_capacity, const Allocator& in_alloc) noexcept : mRawData(in_raw), mSize(in_size), mCapacity(in_capacity), mExternalAllocator(in_alloc) 
 {
     // THIS CONSTRUCTOR MUST NOT BE CALLED FROM OUTSIDE
 }
@@ -728,14 +728,14 @@ MBASE_INLINE_EXPR character_sequence<SeqType, SeqBase, Allocator>::character_seq
 }
 
 template<typename SeqType, typename SeqBase, typename Allocator>
-MBASE_INLINE_EXPR character_sequence<SeqType, SeqBase, Allocator>::character_sequence(const character_sequence& in_rhs) noexcept : mRawData(nullptr), mSize(in_rhs.mSize), mCapacity(in_rhs.mCapacity), mExternalAllocator(Allocator()) 
+MBASE_INLINE_EXPR character_sequence<SeqType, SeqBase, Allocator>::character_sequence(const character_sequence& in_rhs) noexcept : mRawData(nullptr), mSize(in_rhs.mSize), mCapacity(in_rhs.mCapacity), mExternalAllocator(in_rhs.mExternalAllocator) 
 {
     _build_string(mCapacity);
     this->copy_bytes(mRawData, in_rhs.mRawData, mSize); // no need the include null-terminator since we zero the memory
 }
 
 template<typename SeqType, typename SeqBase, typename Allocator>
-MBASE_INLINE_EXPR character_sequence<SeqType, SeqBase, Allocator>::character_sequence(character_sequence&& in_rhs) noexcept : mRawData(in_rhs.mRawData), mSize(in_rhs.mSize), mCapacity(in_rhs.mCapacity), mExternalAllocator(Allocator()) 
+MBASE_INLINE_EXPR character_sequence<SeqType, SeqBase, Allocator>::character_sequence(character_sequence&& in_rhs) noexcept : mRawData(in_rhs.mRawData), mSize(in_rhs.mSize), mCapacity(in_rhs.mCapacity), mExternalAllocator(in_rhs.mExternalAllocator) 
 {
     in_rhs.mRawData = NULL;
     in_rhs.mSize = 0;
@@ -752,6 +752,13 @@ MBASE_INLINE_EXPR character_sequence<SeqType, SeqBase, Allocator>::character_seq
 template<typename SeqType, typename SeqBase, typename Allocator>
 MBASE_INLINE_EXPR character_sequence<SeqType, SeqBase, Allocator>::character_sequence(character_sequence&& in_rhs, const Allocator& in_alloc) : mRawData(in_rhs.mRawData), mSize(in_rhs.mSize), mCapacity(in_rhs.mCapacity), mExternalAllocator(in_alloc) 
 {
+    if(!(mExternalAllocator == in_rhs.mExternalAllocator))
+    {
+        // memory belongs to another allocator, copy instead
+        _build_string(mCapacity);
+        this->copy_bytes(mRawData, in_rhs.mRawData, mSize);
+        return;
+    }
     in_rhs.mRawData = NULL;
     in_rhs.mSize = 0;
     in_rhs.mCapacity = 0;
@@ -773,7 +780,7 @@ MBASE_INLINE_EXPR character_sequence<SeqType, SeqBase, Allocator>::~character_se
 {
     if(mRawData)
     {
-        mExternalAllocator.deallocate(mRawData);
+        mExternalAllocator.deallocate(mRawData, mCapacity);
         mRawData = nullptr;
         mSize = 0;
         mCapacity = 0;
@@ -793,6 +800,11 @@ MBASE_INLINE character_sequence<SeqType, SeqBase, Allocator>& character_sequence
 template<typename SeqType, typename SeqBase, typename Allocator>
 MBASE_INLINE character_sequence<SeqType, SeqBase, Allocator>& character_sequence<SeqType, SeqBase, Allocator>::operator=(character_sequence&& in_rhs) noexcept 
 {
+    if(!(mExternalAllocator == in_rhs.mExternalAllocator))
+    {
+        // memory belongs to another allocator, copy instead
+        return *this = static_cast<const character_sequence&>(in_rhs);
+    }
     _clear_self();
     mSize = in_rhs.mSize;
     mCapacity = in_rhs.mCapacity;
@@ -2079,6 +2091,7 @@ MBASE_INLINE GENERIC character_sequence<SeqType, SeqBase, Allocator>::swap(chara
     std::swap(mRawData, in_src.mRawData);
     std::swap(mCapacity, in_src.mCapacity);
     std::swap(mSize, in_src.mSize);
+    std::swap(mExternalAllocator, in_src.mExternalAllocator); // the buffer is freed through the allocator that made it
 }
 
 template<typename SeqType, typename SeqBase, typename Allocator>
@@ -2340,7 +2353,7 @@ MBASE_ND(MBASE_RESULT_IGNORE) MBASE_INLINE character_sequence<SeqType, SeqBase,
     newSequence.fill(mString, 0, stringLength + 1);
     snprintf(mString, stringLength + 1, in_format, std::forward<Params>(in_params)...);
     newSequence = character_sequence(mString);
-    newSequence.mExternalAllocator.deallocate(mString);
+    newSequence.mExternalAllocator.deallocate(mString, stringLength + 1);
 
     return newSequence;
 }
@@ -2419,10 +2432,17 @@ MBASE_INLINE GENERIC character_sequence<SeqType, SeqBase, Allocator>::_resize(si
 {
     if (in_size > mSize)
     {
+        if(mRawData && in_size < mCapacity)
+        {
+            // enough room, no need to reallocate
+            this->fill(mRawData + mSize, SeqBase::null_value, in_size - mSize);
+            mSize = in_size;
+            return;
+        }
         size_type newCap = _calculate_capacity(in_size);
         pointer new_data = mExternalAllocator.allocate(newCap, true);
         this->copy_bytes(new_data, mRawData, mSize);
-        mExternalAllocator.deallocate(mRawData);
+        mExternalAllocator.deallocate(mRawData, mCapacity);
         mRawData = new_data;
         mSize = in_size;
         mCapacity = newCap;
@@ -2482,7 +2502,7 @@ MBASE_INLINE GENERIC character_sequence<SeqType, SeqBase, Allocator>::_clear_sel
 {
     if(mRawData)
     {
-        mExternalAllocator.deallocate(mRawData);
+        mExternalAllocator.deallocate(mRawData, mCapacity);
         mRawData = nullptr;
         mSize = 0;
         mCapacity = 0;
@@ -59,6 +59,20 @@ struct serialize_helper {
     /* ===== NON-MODIFIER METHODS END ===== */
 };
 
+/*
+    is_bulk_serializable marks the types whose serialized form is exactly their
+    in-memory representation. Containers serialize sequences of such types with a single
+    memory copy instead of going through serialize_helper for each element.
+
+    Arithmetic types are bulk serializable by default. It can be specialized for trivially
+    copyable user types that want the same treatment.
+*/
+template<typename T>
+struct is_bulk_serializable : std::bool_constant<std::is_arithmetic_v<T>> {};
+
+template<typename T>
+inline constexpr bool is_bulk_serializable_v = is_bulk_serializable<T>::value && std::is_trivially_copyable_v<T>;
+
 template<typename T1, typename T2>
 struct pair {
     using first_type = T1;
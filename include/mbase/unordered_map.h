@@ -29,8 +29,9 @@ public:
 	using size_type = SIZE_T;
 	using difference_type = PTRDIFF;
 	using hasher = Hash;
-	using bucket_node_type = mbase::list<value_type>;
-	using bucket_type = mbase::vector<bucket_node_type>;
+	using bucket_node_type = mbase::list<value_type, mbase::allocator_rebind_t<Allocator, value_type>>;
+	using bucket_allocator = mbase::allocator_rebind_t<Allocator, bucket_node_type>;
+	using bucket_type = mbase::vector<bucket_node_type, bucket_allocator>;
 	using key_equal = KeyEqual;
 	using allocator_type = Allocator;
 	using reference = value_type&;
@@ -166,24 +167,24 @@ MBASE_INLINE_EXPR unordered_map<Key, Value, Hash, KeyEqual, Allocator>::unordere
 }
 
 template<typename Key, typename Value, typename Hash, typename KeyEqual, typename Allocator>
-MBASE_INLINE_EXPR unordered_map<Key, Value, Hash, KeyEqual, Allocator>::unordered_map(size_type in_bucket_count, const Hash& in_hash, const key_equal& in_equal, [[maybe_unused]] const Allocator& in_alloc) noexcept : mBucketCount(in_bucket_count), mHash(in_hash), mKeyEqual(in_equal), mBucket(mBucketCount, bucket_node_type()), mSize(0)
+MBASE_INLINE_EXPR unordered_map<Key, Value, Hash, KeyEqual, Allocator>::unordered_map(size_type in_bucket_count, const Hash& in_hash, const key_equal& in_equal, const Allocator& in_alloc) noexcept : mBucketCount(in_bucket_count), mHash(in_hash), mKeyEqual(in_equal), mBucket(mBucketCount, bucket_node_type(in_alloc), bucket_allocator(in_alloc)), mSize(0)
 {
 }
 
 template<typename Key, typename Value, typename Hash, typename KeyEqual, typename Allocator>
-MBASE_INLINE_EXPR unordered_map<Key, Value, Hash, KeyEqual, Allocator>::unordered_map(size_type in_bucket_count, [[maybe_unused]] const Allocator& in_alloc) noexcept : mBucketCount(in_bucket_count), mHash(), mKeyEqual(), mBucket(mBucketCount), mSize(0)
+MBASE_INLINE_EXPR unordered_map<Key, Value, Hash, KeyEqual, Allocator>::unordered_map(size_type in_bucket_count, const Allocator& in_alloc) noexcept : mBucketCount(in_bucket_count), mHash(), mKeyEqual(), mBucket(mBucketCount, bucket_node_type(in_alloc), bucket_allocator(in_alloc)), mSize(0)
 {
 
 }
 
 template<typename Key, typename Value, typename Hash, typename KeyEqual, typename Allocator>
-MBASE_INLINE_EXPR unordered_map<Key, Value, Hash, KeyEqual, Allocator>::unordered_map(size_type in_bucket_count, const Hash& in_hash, [[maybe_unused]] const Allocator& in_alloc) noexcept : mBucketCount(in_bucket_count), mHash(in_hash), mKeyEqual(), mBucket(mBucketCount), mSize(0)
+MBASE_INLINE_EXPR unordered_map<Key, Value, Hash, KeyEqual, Allocator>::unordered_map(size_type in_bucket_count, const Hash& in_hash, const Allocator& in_alloc) noexcept : mBucketCount(in_bucket_count), mHash(in_hash), mKeyEqual(), mBucket(mBucketCount, bucket_node_type(in_alloc), bucket_allocator(in_alloc)), mSize(0)
 {
 
 }
 
 template<typename Key, typename Value, typename Hash, typename KeyEqual, typename Allocator>
-unordered_map<Key, Value, Hash, KeyEqual, Allocator>::unordered_map([[maybe_unused]] const Allocator& in_alloc) noexcept : mBucketCount(gUmapDefaultBucketCount), mHash(), mKeyEqual(), mBucket(mBucketCount), mSize(0)
+unordered_map<Key, Value, Hash, KeyEqual, Allocator>::unordered_map(const Allocator& in_alloc) noexcept : mBucketCount(gUmapDefaultBucketCount), mHash(), mKeyEqual(), mBucket(mBucketCount, bucket_node_type(in_alloc), bucket_allocator(in_alloc)), mSize(0)
 {
 
 }
@@ -194,8 +195,16 @@ MBASE_INLINE_EXPR unordered_map<Key, Value, Hash, KeyEqual, Allocator>::unordere
 }
 
 template<typename Key, typename Value, typename Hash, typename KeyEqual, typename Allocator>
-MBASE_INLINE_EXPR unordered_map<Key, Value, Hash, KeyEqual, Allocator>::unordered_map(const unordered_map& in_rhs, [[maybe_unused]] const Allocator& in_alloc) noexcept : mBucketCount(in_rhs.mBucketCount), mHash(in_rhs.mHash), mKeyEqual(in_rhs.mKeyEqual), mBucket(in_rhs.mBucket), mSize(in_rhs.mSize)
+MBASE_INLINE_EXPR unordered_map<Key, Value, Hash, KeyEqual, Allocator>::unordered_map(const unordered_map& in_rhs, const Allocator& in_alloc) noexcept : mBucketCount(in_rhs.mBucketCount), mHash(in_rhs.mHash), mKeyEqual(in_rhs.mKeyEqual), mBucket(mBucketCount, bucket_node_type(in_alloc), bucket_allocator(in_alloc)), mSize(in_rhs.mSize)
 {
+	// bucket count and hasher are the same, so every pair lands on the same bucket index
+	for(size_type i = 0; i < mBucketCount; ++i)
+	{
+		for(typename bucket_node_type::const_iterator It = in_rhs.mBucket[i].cbegin(); It != in_rhs.mBucket[i].cend(); It++)
+		{
+			mBucket[i].push_back(*It);
+		}
+	}
 }
 
 template<typename Key, typename Value, typename Hash, typename KeyEqual, typename Allocator>
@@ -206,14 +215,31 @@ MBASE_INLINE_EXPR unordered_map<Key, Value, Hash, KeyEqual, Allocator>::unordere
 }
 
 template<typename Key, typename Value, typename Hash, typename KeyEqual, typename Allocator>
-MBASE_INLINE_EXPR unordered_map<Key, Value, Hash, KeyEqual, Allocator>::unordered_map(unordered_map&& in_rhs, [[maybe_unused]] const Allocator& in_alloc) noexcept : mBucketCount(in_rhs.mBucketCount), mHash(in_rhs.mHash), mKeyEqual(in_rhs.mKeyEqual), mBucket(std::move(in_rhs.mBucket)), mSize(in_rhs.mSize)
+MBASE_INLINE_EXPR unordered_map<Key, Value, Hash, KeyEqual, Allocator>::unordered_map(unordered_map&& in_rhs, const Allocator& in_alloc) noexcept : mBucketCount(in_rhs.mBucketCount), mHash(in_rhs.mHash), mKeyEqual(in_rhs.mKeyEqual), mBucket(mBucketCount, bucket_node_type(in_alloc), bucket_allocator(in_alloc)), mSize(in_rhs.mSize)
 {
+	if(mBucket.get_allocator() == in_rhs.mBucket.get_allocator())
+	{
+		mBucket = std::move(in_rhs.mBucket);
+	}
+	else
+	{
+		// buckets belong to another allocator, move the pairs one by one
+		// bucket count and hasher are the same, so every pair lands on the same bucket index
+		for(size_type i = 0; i < mBucketCount; ++i)
+		{
+			for(typename bucket_node_type::iterator It = in_rhs.mBucket[i].begin(); It != in_rhs.mBucket[i].end(); It++)
+			{
+				mBucket[i].push_back(std::move(*It));
+			}
+		}
+		in_rhs.mBucket.clear();
+	}
 	in_rhs.mBucketCount = 0;
 	in_rhs.mSize = 0;
 }
 
 template<typename Key, typename Value, typename Hash, typename KeyEqual, typename Allocator>
-MBASE_INLINE_EXPR unordered_map<Key, Value, Hash, KeyEqual, Allocator>::unordered_map(std::initializer_list<value_type> in_pairs, size_type in_bucket_count, const Hash& in_hash, const key_equal& in_equal, [[maybe_unused]] const Allocator& in_alloc) noexcept : mBucketCount(in_bucket_count), mHash(in_hash), mKeyEqual(in_equal), mSize(0)
+MBASE_INLINE_EXPR unordered_map<Key, Value, Hash, KeyEqual, Allocator>::unordered_map(std::initializer_list<value_type> in_pairs, size_type in_bucket_count, const Hash& in_hash, const key_equal& in_equal, const Allocator& in_alloc) noexcept : mBucketCount(in_bucket_count), mHash(in_hash), mKeyEqual(in_equal), mBucket(mBucketCount, bucket_node_type(in_alloc), bucket_allocator(in_alloc)), mSize(0)
 {
 	const value_type* currentObj = in_pairs.begin();
 	while (currentObj != in_pairs.end())
@@ -224,7 +250,7 @@ MBASE_INLINE_EXPR unordered_map<Key, Value, Hash, KeyEqual, Allocator>::unordere
 }
 
 template<typename Key, typename Value, typename Hash, typename KeyEqual, typename Allocator>
-MBASE_INLINE_EXPR unordered_map<Key, Value, Hash, KeyEqual, Allocator>::unordered_map(std::initializer_list<value_type> in_pairs, size_type in_bucket_count, [[maybe_unused]] const Allocator& in_alloc) noexcept : mBucketCount(in_bucket_count), mBucket(mBucketCount), mSize(0)
+MBASE_INLINE_EXPR unordered_map<Key, Value, Hash, KeyEqual, Allocator>::unordered_map(std::initializer_list<value_type> in_pairs, size_type in_bucket_count, const Allocator& in_alloc) noexcept : mBucketCount(in_bucket_count), mBucket(mBucketCount, bucket_node_type(in_alloc), bucket_allocator(in_alloc)), mSize(0)
 {
 	const value_type* currentObj = in_pairs.begin();
 	while (currentObj != in_pairs.end())
@@ -235,7 +261,7 @@ MBASE_INLINE_EXPR unordered_map<Key, Value, Hash, KeyEqual, Allocator>::unordere
 }
 
 template<typename Key, typename Value, typename Hash, typename KeyEqual, typename Allocator>
-MBASE_INLINE_EXPR unordered_map<Key, Value, Hash, KeyEqual, Allocator>::unordered_map(std::initializer_list<value_type> in_pairs, size_type in_bucket_count, const Hash& in_hash, [[maybe_unused]] const Allocator& in_alloc) noexcept : mBucketCount(in_bucket_count), mHash(in_hash), mKeyEqual(), mBucket(mBucketCount), mSize(0)
+MBASE_INLINE_EXPR unordered_map<Key, Value, Hash, KeyEqual, Allocator>::unordered_map(std::initializer_list<value_type> in_pairs, size_type in_bucket_count, const Hash& in_hash, const Allocator& in_alloc) noexcept : mBucketCount(in_bucket_count), mHash(in_hash), mKeyEqual(), mBucket(mBucketCount, bucket_node_type(in_alloc), bucket_allocator(in_alloc)), mSize(0)
 {
 	const value_type* currentObj = in_pairs.begin();
 	while (currentObj != in_pairs.end())
@@ -8,6 +8,7 @@
 #include <mbase/sequence_iterator.h>
 
 #include <initializer_list> // For std::initializer_list
+#include <algorithm> // For std::reverse
 
 /*
 			_
@@ -26,6 +27,36 @@ MBASE_STD_BEGIN
 static const SIZE_T gSerializedVectorElementCountLength = 8;
 static const SIZE_T gSerializedVectorBlockLength = 8;
 static const SIZE_T gVectorDefaultCapacity = 4;
+static const SIZE_T gSerializedVectorBulkFlag = static_cast<SIZE_T>(1) << (sizeof(SIZE_T) * 8 - 1); // set on the element count
+static const SIZE_T gSerializedVectorBulkHeaderLength = 8; // U32 element size + U32 endianness tag
+static const U32 gSerializedVectorEndiannessTag = 0x01020304;
+
+// The count and the element size of the bulk header are little endian on every machine, so a reader
+// of either byte order finds the bulk flag and checks the sizes. The tag is written in the byte order
+// of the writer and tells the reader whether the raw elements need swapping.
+template<typename IntType>
+MBASE_INLINE GENERIC serialized_vector_put_le(char_stream& out_buffer, IntType in_value) noexcept
+{
+	U8 leBytes[sizeof(IntType)];
+	for(SIZE_T i = 0; i < sizeof(IntType); i++)
+	{
+		leBytes[i] = static_cast<U8>(in_value >> (i * 8));
+	}
+	out_buffer.put_buffern(reinterpret_cast<CBYTEBUFFER>(leBytes), sizeof(IntType));
+}
+
+template<typename IntType>
+MBASE_INLINE IntType serialized_vector_get_le(char_stream& in_buffer) noexcept
+{
+	const U8* leBytes = reinterpret_cast<const U8*>(in_buffer.get_bufferc());
+	IntType outValue = 0;
+	for(SIZE_T i = 0; i < sizeof(IntType); i++)
+	{
+		outValue |= static_cast<IntType>(leBytes[i]) << (i * 8);
+	}
+	in_buffer.advance(sizeof(IntType));
+	return outValue;
+}
 
 /* --- OBJECT BEHAVIOURS --- */
 
@@ -298,6 +329,19 @@ MBASE_INLINE_EXPR vector<T, Allocator>::vector(vector&& in_rhs) noexcept : mRawD
 template<typename T, typename Allocator>
 MBASE_INLINE_EXPR vector<T, Allocator>::vector(vector&& in_rhs, const Allocator& in_alloc) noexcept : mRawData(in_rhs.mRawData), mSize(in_rhs.mSize), mCapacity(in_rhs.mCapacity), mExternalAllocator(in_alloc)
 {
+	if(!(mExternalAllocator == in_rhs.mExternalAllocator))
+	{
+		// memory belongs to another allocator, move the elements one by one
+		mRawData = nullptr;
+		mSize = 0;
+		build_vector(in_rhs.mCapacity ? in_rhs.mCapacity : gVectorDefaultCapacity);
+		for (size_type i = 0; i < in_rhs.mSize; i++)
+		{
+			push_back(std::move(in_rhs[i]));
+		}
+		in_rhs.deep_clear();
+		return;
+	}
 	in_rhs.mRawData = nullptr;
 	in_rhs.mSize = 0;
 	in_rhs.mCapacity = 0;
@@ -339,6 +383,17 @@ template<typename T, typename Allocator>
 MBASE_INLINE_EXPR vector<T, Allocator>& vector<T, Allocator>::operator=(vector&& in_rhs) noexcept
 {
 	deep_clear();
+	if(!(mExternalAllocator == in_rhs.mExternalAllocator))
+	{
+		// memory belongs to another allocator, move the elements one by one
+		build_vector(in_rhs.mCapacity ? in_rhs.mCapacity : gVectorDefaultCapacity);
+		for (size_type i = 0; i < in_rhs.mSize; i++)
+		{
+			push_back(std::move(in_rhs[i]));
+		}
+		in_rhs.deep_clear();
+		return *this;
+	}
 
 	mSize = in_rhs.mSize;
 	mCapacity = in_rhs.mCapacity;
@@ -432,6 +487,11 @@ template<typename T, typename Allocator>
 MBASE_ND(MBASE_RESULT_IGNORE) MBASE_INLINE_EXPR typename vector<T, Allocator>::size_type vector<T, Allocator>::get_serialized_size() const noexcept
 {
 	size_type totalSize = gSerializedVectorElementCountLength;
+	if constexpr(mbase::is_bulk_serializable_v<value_type>)
+	{
+		return totalSize + gSerializedVectorBulkHeaderLength + mSize * sizeof(value_type);
+	}
+
 	for(const_iterator It = cbegin(); It != cend(); It++)
 	{
 		bool isPrimitive = std::is_integral_v<value_type>;
@@ -577,6 +637,7 @@ MBASE_INLINE_EXPR GENERIC vector<T, Allocator>::swap(mbase::vector<value_type, A
 	std::swap(mRawData, in_src.mRawData);
 	std::swap(mCapacity, in_src.mCapacity);
 	std::swap(mSize, in_src.mSize);
+	std::swap(mExternalAllocator, in_src.mExternalAllocator); // the buffer is freed through the allocator that made it
 }
 
 template<typename T, typename Allocator>
@@ -598,7 +659,7 @@ MBASE_INLINE_EXPR GENERIC vector<T, Allocator>::deep_clear() noexcept
 		{
 			mRawData[i].~value_type();
 		}
-		mExternalAllocator.deallocate(mRawData);
+		mExternalAllocator.deallocate(mRawData, mCapacity);
 		mRawData = nullptr;
 	}
 	mSize = 0;
@@ -672,7 +733,7 @@ MBASE_INLINE_EXPR GENERIC vector<T, Allocator>::shrink_to_fit()
 		return;
 	}
 
-	mbase::vector<T, Allocator> newVector(mSize);
+	mbase::vector<T, Allocator> newVector(mSize, mExternalAllocator);
 
 	for(iterator It = begin(); It != end(); It++)
 	{
@@ -697,7 +758,7 @@ MBASE_INLINE_EXPR GENERIC vector<T, Allocator>::reserve(size_type in_capacity) n
 		mRawData[i].~value_type();
 	}
 
-	mExternalAllocator.deallocate(mRawData);
+	mExternalAllocator.deallocate(mRawData, mCapacity);
 
 	mCapacity = in_capacity;
 	mRawData = new_data;
@@ -945,6 +1006,19 @@ MBASE_INLINE_EXPR GENERIC vector<T, Allocator>::serialize(char_stream& out_buffe
 		return;
 	}
 
+	if constexpr(mbase::is_bulk_serializable_v<value_type>)
+	{
+		// [count | bulk flag, LE][element size, LE][endianness tag, native][raw elements, native]
+		serialized_vector_put_le<size_type>(out_buffer, mSize | gSerializedVectorBulkFlag);
+		serialized_vector_put_le<U32>(out_buffer, static_cast<U32>(sizeof(value_type)));
+		out_buffer.put_datan<U32>(gSerializedVectorEndiannessTag);
+		if (mSize)
+		{
+			out_buffer.put_buffern(reinterpret_cast<CBYTEBUFFER>(mRawData), mSize * sizeof(value_type));
+		}
+		return;
+	}
+
 	out_buffer.put_datan<size_type>(mSize);
 	if (mSize)
 	{
@@ -983,9 +1057,66 @@ MBASE_INLINE mbase::vector<T, Allocator> mbase::vector<T, Allocator>::deserializ
 	}
 
 	char_stream inBuffer(in_src, in_length);
-	size_type inSize = inBuffer.get_datan<size_type>();
+	size_type inSize = 0;
+	if constexpr(mbase::is_bulk_serializable_v<value_type>)
+	{
+		inSize = serialized_vector_get_le<size_type>(inBuffer);
+	}
+	else
+	{
+		inSize = inBuffer.get_datan<size_type>();
+	}
 	size_type bytes_processed = 0;
 
+	if(inSize & gSerializedVectorBulkFlag)
+	{
+		if constexpr(mbase::is_bulk_serializable_v<value_type>)
+		{
+			inSize &= ~gSerializedVectorBulkFlag;
+			if(in_length < gSerializedVectorElementCountLength + gSerializedVectorBulkHeaderLength)
+			{
+				throw mbase::invalid_size();
+			}
+
+			U32 elementSize = serialized_vector_get_le<U32>(inBuffer);
+			U32 endiannessTag = inBuffer.get_datan<U32>();
+			if(endiannessTag != gSerializedVectorEndiannessTag && endiannessTag != 0x04030201)
+			{
+				throw mbase::invalid_format();
+			}
+
+			size_type payloadLength = inSize * sizeof(value_type);
+			if(elementSize != sizeof(value_type) || inSize > (in_length - inBuffer.get_pos()) / sizeof(value_type))
+			{
+				throw mbase::invalid_size();
+			}
+
+			if(inSize)
+			{
+				deserializedVec.reserve(inSize);
+				IBYTEBUFFER targetBuffer = reinterpret_cast<IBYTEBUFFER>(deserializedVec.mRawData);
+				memcpy(targetBuffer, inBuffer.get_bufferc(), payloadLength);
+				deserializedVec.mSize = inSize;
+
+				if(endiannessTag != gSerializedVectorEndiannessTag)
+				{
+					// written on a machine with the opposite byte order
+					for(size_type i = 0; i < payloadLength; i += sizeof(value_type))
+					{
+						std::reverse(targetBuffer + i, targetBuffer + i + sizeof(value_type));
+					}
+				}
+			}
+
+			bytesProcessed = gSerializedVectorElementCountLength + gSerializedVectorBulkHeaderLength + payloadLength;
+			return deserializedVec;
+		}
+		else
+		{
+			throw mbase::invalid_format();
+		}
+	}
+
 	for(size_type i = 0; i < inSize; ++i)
 	{
 		size_type blockLength = 0;
@@ -1,6 +1,23 @@
 #include <mbase/inference/inf_common.h>
 #include <cmath>
 
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+    #define MBASE_INF_SIMD_X86
+    #include <immintrin.h>
+    #ifdef _MSC_VER
+        #include <intrin.h>
+        // MSVC accepts AVX intrinsics in any function, the dispatcher guarantees the CPU supports them
+        #define MBASE_INF_TARGET_AVX2
+        #define MBASE_INF_TARGET_AVX512
+    #else
+        #define MBASE_INF_TARGET_AVX2 __attribute__((target("avx2,fma")))
+        #define MBASE_INF_TARGET_AVX512 __attribute__((target("avx512f")))
+    #endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+    #define MBASE_INF_SIMD_NEON
+    #include <arm_neon.h>
+#endif
+
 MBASE_BEGIN
 
 GENERIC inf_llama_logger(ggml_log_level log_lvl, const char* usr_text, void* usr_data)
@@ -41,25 +58,366 @@ GENERIC inf_common_batch_add(
     in_batch.n_tokens++;
 }
 
+/* ===== EMBEDDING MATH KERNELS BEGIN ===== */
+
+// Every instruction set provides the same three primitives,
+// the exported functions are composed out of them.
+struct inf_simd_kernels {
+    F32 (*mDot)(const F32* in_lhs, const F32* in_rhs, SIZE_T in_length);
+    GENERIC (*mDotSumSquares)(const F32* in_lhs, const F32* in_rhs, SIZE_T in_length, F32& out_dot, F32& out_rhs_sq);
+    GENERIC (*mScale)(const F32* in_src, F32* out_dst, F32 in_factor, SIZE_T in_length);
+    MSTRING mName;
+};
+
+static F32 inf_scalar_dot(const F32* in_lhs, const F32* in_rhs, SIZE_T in_length)
+{
+    F32 sum = 0.0f;
+    for(SIZE_T i = 0; i < in_length; ++i)
+    {
+        sum += in_lhs[i] * in_rhs[i];
+    }
+    return sum;
+}
+
+static GENERIC inf_scalar_dot_sum_squares(const F32* in_lhs, const F32* in_rhs, SIZE_T in_length, F32& out_dot, F32& out_rhs_sq)
+{
+    F32 dotSum = 0.0f;
+    F32 squareSum = 0.0f;
+    for(SIZE_T i = 0; i < in_length; ++i)
+    {
+        dotSum += in_lhs[i] * in_rhs[i];
+        squareSum += in_rhs[i] * in_rhs[i];
+    }
+    out_dot = dotSum;
+    out_rhs_sq = squareSum;
+}
+
+static GENERIC inf_scalar_scale(const F32* in_src, F32* out_dst, F32 in_factor, SIZE_T in_length)
+{
+    for(SIZE_T i = 0; i < in_length; ++i)
+    {
+        out_dst[i] = in_src[i] * in_factor;
+    }
+}
+
+#ifdef MBASE_INF_SIMD_X86
+MBASE_INF_TARGET_AVX2 static F32 inf_avx2_horizontal_sum(__m256 in_value)
+{
+    __m128 lowHalf = _mm256_castps256_ps128(in_value);
+    __m128 highHalf = _mm256_extractf128_ps(in_value, 1);
+    lowHalf = _mm_add_ps(lowHalf, highHalf);
+    __m128 shuffled = _mm_movehdup_ps(lowHalf);
+    __m128 sums = _mm_add_ps(lowHalf, shuffled);
+    shuffled = _mm_movehl_ps(shuffled, sums);
+    sums = _mm_add_ss(sums, shuffled);
+    return _mm_cvtss_f32(sums);
+}
+
+MBASE_INF_TARGET_AVX2 static F32 inf_avx2_dot(const F32* in_lhs, const F32* in_rhs, SIZE_T in_length)
+{
+    // four independent accumulators hide the FMA latency
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    __m256 acc2 = _mm256_setzero_ps();
+    __m256 acc3 = _mm256_setzero_ps();
+    SIZE_T i = 0;
+    for(; i + 32 <= in_length; i += 32)
+    {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(in_lhs + i), _mm256_loadu_ps(in_rhs + i), acc0);
+        acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(in_lhs + i + 8), _mm256_loadu_ps(in_rhs + i + 8), acc1);
+        acc2 = _mm256_fmadd_ps(_mm256_loadu_ps(in_lhs + i + 16), _mm256_loadu_ps(in_rhs + i + 16), acc2);
+        acc3 = _mm256_fmadd_ps(_mm256_loadu_ps(in_lhs + i + 24), _mm256_loadu_ps(in_rhs + i + 24), acc3);
+    }
+    for(; i + 8 <= in_length; i += 8)
+    {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(in_lhs + i), _mm256_loadu_ps(in_rhs + i), acc0);
+    }
+    F32 sum = inf_avx2_horizontal_sum(_mm256_add_ps(_mm256_add_ps(acc0, acc1), _mm256_add_ps(acc2, acc3)));
+    for(; i < in_length; ++i)
+    {
+        sum += in_lhs[i] * in_rhs[i];
+    }
+    return sum;
+}
+
+MBASE_INF_TARGET_AVX2 static GENERIC inf_avx2_dot_sum_squares(const F32* in_lhs, const F32* in_rhs, SIZE_T in_length, F32& out_dot, F32& out_rhs_sq)
+{
+    __m256 dotAcc0 = _mm256_setzero_ps();
+    __m256 dotAcc1 = _mm256_setzero_ps();
+    __m256 sqAcc0 = _mm256_setzero_ps();
+    __m256 sqAcc1 = _mm256_setzero_ps();
+    SIZE_T i = 0;
+    for(; i + 16 <= in_length; i += 16)
+    {
+        __m256 rhs0 = _mm256_loadu_ps(in_rhs + i);
+        __m256 rhs1 = _mm256_loadu_ps(in_rhs + i + 8);
+        dotAcc0 = _mm256_fmadd_ps(_mm256_loadu_ps(in_lhs + i), rhs0, dotAcc0);
+        dotAcc1 = _mm256_fmadd_ps(_mm256_loadu_ps(in_lhs + i + 8), rhs1, dotAcc1);
+        sqAcc0 = _mm256_fmadd_ps(rhs0, rhs0, sqAcc0);
+        sqAcc1 = _mm256_fmadd_ps(rhs1, rhs1, sqAcc1);
+    }
+    for(; i + 8 <= in_length; i += 8)
+    {
+        __m256 rhs0 = _mm256_loadu_ps(in_rhs + i);
+        dotAcc0 = _mm256_fmadd_ps(_mm256_loadu_ps(in_lhs + i), rhs0, dotAcc0);
+        sqAcc0 = _mm256_fmadd_ps(rhs0, rhs0, sqAcc0);
+    }
+    F32 dotSum = inf_avx2_horizontal_sum(_mm256_add_ps(dotAcc0, dotAcc1));
+    F32 squareSum = inf_avx2_horizontal_sum(_mm256_add_ps(sqAcc0, sqAcc1));
+    for(; i < in_length; ++i)
+    {
+        dotSum += in_lhs[i] * in_rhs[i];
+        squareSum += in_rhs[i] * in_rhs[i];
+    }
+    out_dot = dotSum;
+    out_rhs_sq = squareSum;
+}
+
+MBASE_INF_TARGET_AVX2 static GENERIC inf_avx2_scale(const F32* in_src, F32* out_dst, F32 in_factor, SIZE_T in_length)
+{
+    __m256 scaleFactor = _mm256_set1_ps(in_factor);
+    SIZE_T i = 0;
+    for(; i + 8 <= in_length; i += 8)
+    {
+        _mm256_storeu_ps(out_dst + i, _mm256_mul_ps(_mm256_loadu_ps(in_src + i), scaleFactor));
+    }
+    for(; i < in_length; ++i)
+    {
+        out_dst[i] = in_src[i] * in_factor;
+    }
+}
+
+MBASE_INF_TARGET_AVX512 static F32 inf_avx512_horizontal_sum(__m512 in_value)
+{
+    // _mm512_reduce_add_ps trips -Wuninitialized inside some GCC headers, spill the lanes instead
+    alignas(64) F32 laneValues[16];
+    _mm512_store_ps(laneValues, in_value);
+    F32 sum = 0.0f;
+    for(I32 i = 0; i < 16; ++i)
+    {
+        sum += laneValues[i];
+    }
+    return sum;
+}
+
+MBASE_INF_TARGET_AVX512 static F32 inf_avx512_dot(const F32* in_lhs, const F32* in_rhs, SIZE_T in_length)
+{
+    __m512 acc0 = _mm512_setzero_ps();
+    __m512 acc1 = _mm512_setzero_ps();
+    SIZE_T i = 0;
+    for(; i + 32 <= in_length; i += 32)
+    {
+        acc0 = _mm512_fmadd_ps(_mm512_loadu_ps(in_lhs + i), _mm512_loadu_ps(in_rhs + i), acc0);
+        acc1 = _mm512_fmadd_ps(_mm512_loadu_ps(in_lhs + i + 16), _mm512_loadu_ps(in_rhs + i + 16), acc1);
+    }
+    for(; i + 16 <= in_length; i += 16)
+    {
+        acc0 = _mm512_fmadd_ps(_mm512_loadu_ps(in_lhs + i), _mm512_loadu_ps(in_rhs + i), acc0);
+    }
+    if(i < in_length)
+    {
+        // masked loads read the tail without touching memory past the end
+        __mmask16 tailMask = static_cast<__mmask16>((1u << (in_length - i)) - 1);
+        acc1 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(tailMask, in_lhs + i), _mm512_maskz_loadu_ps(tailMask, in_rhs + i), acc1);
+    }
+    return inf_avx512_horizontal_sum(_mm512_add_ps(acc0, acc1));
+}
+
+MBASE_INF_TARGET_AVX512 static GENERIC inf_avx512_dot_sum_squares(const F32* in_lhs, const F32* in_rhs, SIZE_T in_length, F32& out_dot, F32& out_rhs_sq)
+{
+    __m512 dotAcc = _mm512_setzero_ps();
+    __m512 sqAcc = _mm512_setzero_ps();
+    SIZE_T i = 0;
+    for(; i + 16 <= in_length; i += 16)
+    {
+        __m512 rhsValue = _mm512_loadu_ps(in_rhs + i);
+        dotAcc = _mm512_fmadd_ps(_mm512_loadu_ps(in_lhs + i), rhsValue, dotAcc);
+        sqAcc = _mm512_fmadd_ps(rhsValue, rhsValue, sqAcc);
+    }
+    if(i < in_length)
+    {
+        __mmask16 tailMask = static_cast<__mmask16>((1u << (in_length - i)) - 1);
+        __m512 rhsValue = _mm512_maskz_loadu_ps(tailMask, in_rhs + i);
+        dotAcc = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(tailMask, in_lhs + i), rhsValue, dotAcc);
+        sqAcc = _mm512_fmadd_ps(rhsValue, rhsValue, sqAcc);
+    }
+    out_dot = inf_avx512_horizontal_sum(dotAcc);
+    out_rhs_sq = inf_avx512_horizontal_sum(sqAcc);
+}
+
+MBASE_INF_TARGET_AVX512 static GENERIC inf_avx512_scale(const F32* in_src, F32* out_dst, F32 in_factor, SIZE_T in_length)
+{
+    __m512 scaleFactor = _mm512_set1_ps(in_factor);
+    SIZE_T i = 0;
+    for(; i + 16 <= in_length; i += 16)
+    {
+        _mm512_storeu_ps(out_dst + i, _mm512_mul_ps(_mm512_loadu_ps(in_src + i), scaleFactor));
+    }
+    if(i < in_length)
+    {
+        __mmask16 tailMask = static_cast<__mmask16>((1u << (in_length - i)) - 1);
+        _mm512_mask_storeu_ps(out_dst + i, tailMask, _mm512_mul_ps(_mm512_maskz_loadu_ps(tailMask, in_src + i), scaleFactor));
+    }
+}
+
+static bool inf_cpu_has_avx2() noexcept
+{
+#ifdef _MSC_VER
+    I32 cpuInfo[4];
+    __cpuid(cpuInfo, 0);
+    if(cpuInfo[0] < 7)
+    {
+        return false;
+    }
+    __cpuid(cpuInfo, 1);
+    bool hasOsxsave = (cpuInfo[2] & (1 << 27)) != 0;
+    bool hasFma = (cpuInfo[2] & (1 << 12)) != 0;
+    if(!hasOsxsave || !hasFma || (_xgetbv(0) & 0x6) != 0x6)
+    {
+        return false;
+    }
+    __cpuidex(cpuInfo, 7, 0);
+    return (cpuInfo[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+}
+
+static bool inf_cpu_has_avx512() noexcept
+{
+#ifdef _MSC_VER
+    if(!inf_cpu_has_avx2() || (_xgetbv(0) & 0xE6) != 0xE6)
+    {
+        return false;
+    }
+    I32 cpuInfo[4];
+    __cpuidex(cpuInfo, 7, 0);
+    return (cpuInfo[1] & (1 << 16)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx512f");
+#endif
+}
+#endif // MBASE_INF_SIMD_X86
+
+#ifdef MBASE_INF_SIMD_NEON
+static F32 inf_neon_dot(const F32* in_lhs, const F32* in_rhs, SIZE_T in_length)
+{
+    float32x4_t acc0 = vdupq_n_f32(0.0f);
+    float32x4_t acc1 = vdupq_n_f32(0.0f);
+    float32x4_t acc2 = vdupq_n_f32(0.0f);
+    float32x4_t acc3 = vdupq_n_f32(0.0f);
+    SIZE_T i = 0;
+    for(; i + 16 <= in_length; i += 16)
+    {
+        acc0 = vfmaq_f32(acc0, vld1q_f32(in_lhs + i), vld1q_f32(in_rhs + i));
+        acc1 = vfmaq_f32(acc1, vld1q_f32(in_lhs + i + 4), vld1q_f32(in_rhs + i + 4));
+        acc2 = vfmaq_f32(acc2, vld1q_f32(in_lhs + i + 8), vld1q_f32(in_rhs + i + 8));
+        acc3 = vfmaq_f32(acc3, vld1q_f32(in_lhs + i + 12), vld1q_f32(in_rhs + i + 12));
+    }
+    for(; i + 4 <= in_length; i += 4)
+    {
+        acc0 = vfmaq_f32(acc0, vld1q_f32(in_lhs + i), vld1q_f32(in_rhs + i));
+    }
+    F32 sum = vaddvq_f32(vaddq_f32(vaddq_f32(acc0, acc1), vaddq_f32(acc2, acc3)));
+    for(; i < in_length; ++i)
+    {
+        sum += in_lhs[i] * in_rhs[i];
+    }
+    return sum;
+}
+
+static GENERIC inf_neon_dot_sum_squares(const F32* in_lhs, const F32* in_rhs, SIZE_T in_length, F32& out_dot, F32& out_rhs_sq)
+{
+    float32x4_t dotAcc0 = vdupq_n_f32(0.0f);
+    float32x4_t dotAcc1 = vdupq_n_f32(0.0f);
+    float32x4_t sqAcc0 = vdupq_n_f32(0.0f);
+    float32x4_t sqAcc1 = vdupq_n_f32(0.0f);
+    SIZE_T i = 0;
+    for(; i + 8 <= in_length; i += 8)
+    {
+        float32x4_t rhs0 = vld1q_f32(in_rhs + i);
+        float32x4_t rhs1 = vld1q_f32(in_rhs + i + 4);
+        dotAcc0 = vfmaq_f32(dotAcc0, vld1q_f32(in_lhs + i), rhs0);
+        dotAcc1 = vfmaq_f32(dotAcc1, vld1q_f32(in_lhs + i + 4), rhs1);
+        sqAcc0 = vfmaq_f32(sqAcc0, rhs0, rhs0);
+        sqAcc1 = vfmaq_f32(sqAcc1, rhs1, rhs1);
+    }
+    F32 dotSum = vaddvq_f32(vaddq_f32(dotAcc0, dotAcc1));
+    F32 squareSum = vaddvq_f32(vaddq_f32(sqAcc0, sqAcc1));
+    for(; i < in_length; ++i)
+    {
+        dotSum += in_lhs[i] * in_rhs[i];
+        squareSum += in_rhs[i] * in_rhs[i];
+    }
+    out_dot = dotSum;
+    out_rhs_sq = squareSum;
+}
+
+static GENERIC inf_neon_scale(const F32* in_src, F32* out_dst, F32 in_factor, SIZE_T in_length)
+{
+    SIZE_T i = 0;
+    for(; i + 4 <= in_length; i += 4)
+    {
+        vst1q_f32(out_dst + i, vmulq_n_f32(vld1q_f32(in_src + i), in_factor));
+    }
+    for(; i < in_length; ++i)
+    {
+        out_dst[i] = in_src[i] * in_factor;
+    }
+}
+#endif // MBASE_INF_SIMD_NEON
+
+static inf_simd_kernels inf_select_kernels() noexcept
+{
+#ifdef MBASE_INF_SIMD_X86
+    if(inf_cpu_has_avx512())
+    {
+        return { inf_avx512_dot, inf_avx512_dot_sum_squares, inf_avx512_scale, "AVX-512" };
+    }
+    if(inf_cpu_has_avx2())
+    {
+        return { inf_avx2_dot, inf_avx2_dot_sum_squares, inf_avx2_scale, "AVX2" };
+    }
+#endif
+#ifdef MBASE_INF_SIMD_NEON
+    // NEON is mandatory on AArch64, no runtime check is needed
+    return { inf_neon_dot, inf_neon_dot_sum_squares, inf_neon_scale, "NEON" };
+#endif
+    return { inf_scalar_dot, inf_scalar_dot_sum_squares, inf_scalar_scale, "scalar" };
+}
+
+static const inf_simd_kernels& inf_get_kernels() noexcept
+{
+    static const inf_simd_kernels gSelectedKernels = inf_select_kernels();
+    return gSelectedKernels;
+}
+
+static F32 inf_cosine_from_parts(F32 in_dot, F32 in_lhs_sq, F32 in_rhs_sq) noexcept
+{
+    // Handle the case where one or both vectors are zero vectors
+    if (in_lhs_sq == 0.0f || in_rhs_sq == 0.0f) {
+        if (in_lhs_sq == 0.0f && in_rhs_sq == 0.0f) {
+            return 1.0f; // two zero vectors are similar
+        }
+        return 0.0f;
+    }
+
+    return in_dot / (std::sqrt(in_lhs_sq) * std::sqrt(in_rhs_sq));
+}
+
 GENERIC inf_common_embd_normalize(
     const PTRF32 in_inp, 
     PTRF32 out_normalized, 
     const SIZE_T& in_n
 )
 {
-    F32 tmpSum = 0.0;
-    for(SIZE_T i = 0; i < in_n; i++)
-    {
-        tmpSum += in_inp[i] * in_inp[i];
-    }
-    tmpSum = std::sqrt(tmpSum);
+    const inf_simd_kernels& simdKernels = inf_get_kernels();
+    F32 tmpSum = std::sqrt(simdKernels.mDot(in_inp, in_inp, in_n));
 
-    const F32 tmpNorm = tmpSum > 0.0 ? 1.0 / tmpSum : 0.0f;
- 
-    for(SIZE_T i = 0; i < in_n; i++)
-    {
-        out_normalized[i] = in_inp[i] * tmpNorm;
-    }
+    const F32 tmpNorm = tmpSum > 0.0f ? 1.0f / tmpSum : 0.0f;
+    simdKernels.mScale(in_inp, out_normalized, tmpNorm, in_n);
 }
 
 F32 inf_common_cosine_similarity(
@@ -68,25 +426,167 @@ F32 inf_common_cosine_similarity(
     const I32& in_length
 )
 {
-    F32 sum  = 0.0;
-    F32 sum1 = 0.0;
-    F32 sum2 = 0.0;
+    if(in_length <= 0)
+    {
+        return 1.0f;
+    }
+
+    const inf_simd_kernels& simdKernels = inf_get_kernels();
+    F32 sum = 0.0f;
+    F32 sum2 = 0.0f;
+    SIZE_T vectorLength = static_cast<SIZE_T>(in_length);
+    simdKernels.mDotSumSquares(in_data1, in_data2, vectorLength, sum, sum2);
+    F32 sum1 = simdKernels.mDot(in_data1, in_data1, vectorLength);
+
+    return inf_cosine_from_parts(sum, sum1, sum2);
+}
+
+F32 inf_common_dot_product(
+    const PTRF32 in_data1,
+    const PTRF32 in_data2,
+    const SIZE_T& in_length
+)
+{
+    return inf_get_kernels().mDot(in_data1, in_data2, in_length);
+}
 
-    for (I32 i = 0; i < in_length; i++) {
-        sum  += in_data1[i] * in_data2[i];
-        sum1 += in_data1[i] * in_data1[i];
-        sum2 += in_data2[i] * in_data2[i];
+F32 inf_common_l2_norm(
+    const PTRF32 in_data,
+    const SIZE_T& in_length
+)
+{
+    return std::sqrt(inf_get_kernels().mDot(in_data, in_data, in_length));
+}
+
+GENERIC inf_common_cosine_similarity_batch(
+    const PTRF32 in_query,
+    const PTRF32 in_matrix,
+    const SIZE_T& in_row_count,
+    const SIZE_T& in_dimension,
+    PTRF32 out_scores,
+    bool in_is_normalized
+)
+{
+    const inf_simd_kernels& simdKernels = inf_get_kernels();
+    if(in_is_normalized)
+    {
+        for(SIZE_T i = 0; i < in_row_count; ++i)
+        {
+            out_scores[i] = simdKernels.mDot(in_query, in_matrix + i * in_dimension, in_dimension);
+        }
+        return;
     }
 
-    // Handle the case where one or both vectors are zero vectors
-    if (sum1 == 0.0 || sum2 == 0.0) {
-        if (sum1 == 0.0 && sum2 == 0.0) {
-            return 1.0f; // two zero vectors are similar
+    // the query norm is computed once, each row is streamed a single time for both its dot and norm
+    F32 querySquare = simdKernels.mDot(in_query, in_query, in_dimension);
+    for(SIZE_T i = 0; i < in_row_count; ++i)
+    {
+        F32 dotValue = 0.0f;
+        F32 rowSquare = 0.0f;
+        simdKernels.mDotSumSquares(in_query, in_matrix + i * in_dimension, in_dimension, dotValue, rowSquare);
+        out_scores[i] = inf_cosine_from_parts(dotValue, querySquare, rowSquare);
+    }
+}
+
+GENERIC inf_common_cosine_similarity_matrix(
+    const PTRF32 in_lhs,
+    const SIZE_T& in_lhs_rows,
+    const PTRF32 in_rhs,
+    const SIZE_T& in_rhs_rows,
+    const SIZE_T& in_dimension,
+    PTRF32 out_scores,
+    bool in_is_normalized
+)
+{
+    const inf_simd_kernels& simdKernels = inf_get_kernels();
+    mbase::vector<F32> lhsSquares;
+    mbase::vector<F32> rhsSquares;
+    if(!in_is_normalized)
+    {
+        lhsSquares.reserve(in_lhs_rows);
+        rhsSquares.reserve(in_rhs_rows);
+        for(SIZE_T i = 0; i < in_lhs_rows; ++i)
+        {
+            const F32* lhsRow = in_lhs + i * in_dimension;
+            lhsSquares.push_back(simdKernels.mDot(lhsRow, lhsRow, in_dimension));
+        }
+        for(SIZE_T j = 0; j < in_rhs_rows; ++j)
+        {
+            const F32* rhsRow = in_rhs + j * in_dimension;
+            rhsSquares.push_back(simdKernels.mDot(rhsRow, rhsRow, in_dimension));
+        }
+    }
+
+    // rhs is walked in blocks that stay resident in L2 while every lhs row is scored against them
+    const SIZE_T rhsBlockRows = 64;
+    for(SIZE_T blockBegin = 0; blockBegin < in_rhs_rows; blockBegin += rhsBlockRows)
+    {
+        SIZE_T blockEnd = blockBegin + rhsBlockRows < in_rhs_rows ? blockBegin + rhsBlockRows : in_rhs_rows;
+        for(SIZE_T i = 0; i < in_lhs_rows; ++i)
+        {
+            const F32* lhsRow = in_lhs + i * in_dimension;
+            PTRF32 scoreRow = out_scores + i * in_rhs_rows;
+            for(SIZE_T j = blockBegin; j < blockEnd; ++j)
+            {
+                F32 dotValue = simdKernels.mDot(lhsRow, in_rhs + j * in_dimension, in_dimension);
+                scoreRow[j] = in_is_normalized ? dotValue : inf_cosine_from_parts(dotValue, lhsSquares[i], rhsSquares[j]);
+            }
         }
-        return 0.0f;
     }
+}
 
-    return sum / (std::sqrt(sum1) * std::sqrt(sum2));
+MSTRING inf_common_simd_isa()
+{
+    return inf_get_kernels().mName;
+}
+
+/* ===== EMBEDDING MATH KERNELS END ===== */
+
+ggml_type inf_common_kv_cache_ggml_type(inf_kv_cache_type in_type)
+{
+    switch(in_type)
+    {
+    case inf_kv_cache_type::Q8_0:
+        return GGML_TYPE_Q8_0;
+    case inf_kv_cache_type::Q4_0:
+        return GGML_TYPE_Q4_0;
+    default:
+        return GGML_TYPE_F16;
+    }
+}
+
+MSTRING inf_common_kv_cache_type_string(inf_kv_cache_type in_type)
+{
+    switch(in_type)
+    {
+    case inf_kv_cache_type::Q8_0:
+        return "q8_0";
+    case inf_kv_cache_type::Q4_0:
+        return "q4_0";
+    default:
+        return "f16";
+    }
+}
+
+bool inf_common_kv_cache_type_from_string(const mbase::string& in_string, inf_kv_cache_type& out_type)
+{
+    if(in_string == "f16")
+    {
+        out_type = inf_kv_cache_type::F16;
+    }
+    else if(in_string == "q8_0")
+    {
+        out_type = inf_kv_cache_type::Q8_0;
+    }
+    else if(in_string == "q4_0")
+    {
+        out_type = inf_kv_cache_type::Q4_0;
+    }
+    else
+    {
+        return false;
+    }
+    return true;
 }
 
 mbase::string inf_get_sys_name_total()
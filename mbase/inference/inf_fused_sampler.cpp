@@ -0,0 +1,268 @@
+#include <mbase/inference/inf_fused_sampler.h>
+#include <algorithm>
+#include <cmath>
+
+MBASE_BEGIN
+
+struct inf_fused_sampler_context {
+    inf_fused_sampler_params mParams;
+    InfFusedSampler::candidate_vector mScratch;
+};
+
+static bool inf_fused_logit_greater(const llama_token_data& in_lhs, const llama_token_data& in_rhs)
+{
+    return in_lhs.logit > in_rhs.logit;
+}
+
+static const char* inf_fused_sampler_name([[maybe_unused]] const llama_sampler* in_sampler)
+{
+    return "mbase-fused";
+}
+
+static void inf_fused_sampler_apply(llama_sampler* in_sampler, llama_token_data_array* in_candidates)
+{
+    inf_fused_sampler_context* samplerContext = static_cast<inf_fused_sampler_context*>(in_sampler->ctx);
+    InfFusedSampler::apply(samplerContext->mParams, samplerContext->mScratch, in_candidates);
+}
+
+static llama_sampler* inf_fused_sampler_clone(const llama_sampler* in_sampler)
+{
+    const inf_fused_sampler_context* samplerContext = static_cast<const inf_fused_sampler_context*>(in_sampler->ctx);
+    return InfFusedSampler::init(samplerContext->mParams);
+}
+
+static void inf_fused_sampler_free(llama_sampler* in_sampler)
+{
+    delete static_cast<inf_fused_sampler_context*>(in_sampler->ctx);
+}
+
+static llama_sampler_i gInfFusedSamplerInterface = {
+    inf_fused_sampler_name,
+    NULL, // accept, stateless
+    inf_fused_sampler_apply,
+    NULL, // reset, stateless
+    inf_fused_sampler_clone,
+    inf_fused_sampler_free
+};
+
+llama_sampler* InfFusedSampler::init(const inf_fused_sampler_params& in_params)
+{
+    inf_fused_sampler_context* samplerContext = new inf_fused_sampler_context;
+    samplerContext->mParams = in_params;
+    return llama_sampler_init(&gInfFusedSamplerInterface, samplerContext);
+}
+
+GENERIC InfFusedSampler::apply(const inf_fused_sampler_params& in_params, candidate_vector& in_scratch, llama_token_data_array* in_candidates)
+{
+    const size_t candidateCount = in_candidates->size;
+    if(!candidateCount)
+    {
+        return;
+    }
+
+    const bool useTopK = in_params.mTopK > 0 && static_cast<size_t>(in_params.mTopK) < candidateCount;
+    const bool useTopP = in_params.mTopP < 1.0f;
+    const bool useMinP = in_params.mMinP > 0.0f;
+    const F32 minPLog = useMinP ? logf(in_params.mMinP) : -INFINITY;
+
+    if(!useTopK && !useTopP && !useMinP)
+    {
+        // nothing to truncate, the temperature is applied in place like the llama.cpp temp sampler
+        if(in_params.mTemp <= 0.0f)
+        {
+            llama_token_data* maxCandidate = std::max_element(in_candidates->data, in_candidates->data + candidateCount, [](const llama_token_data& in_lhs, const llama_token_data& in_rhs) { return in_lhs.logit < in_rhs.logit; });
+            std::swap(in_candidates->data[0], *maxCandidate);
+            in_candidates->size = 1;
+            in_candidates->sorted = true;
+        }
+        else if(in_params.mTemp != 1.0f)
+        {
+            for(size_t i = 0; i < candidateCount; i++)
+            {
+                in_candidates->data[i].logit /= in_params.mTemp;
+            }
+        }
+        in_candidates->selected = -1;
+        return;
+    }
+
+    llama_token_data* keptCandidates = in_candidates->data;
+    size_t keptCount = 0;
+    F32 maxLogit = -INFINITY;
+    F64 expSum = 0.0; // softmax denominator relative to maxLogit, over the set top-p normalizes against
+
+    if(useTopK && static_cast<size_t>(in_params.mTopK) > candidateCount / 8)
+    {
+        // k is a large part of the vocabulary, selecting in place is cheaper than a heap that big
+        keptCount = static_cast<size_t>(in_params.mTopK);
+        std::nth_element(keptCandidates, keptCandidates + keptCount - 1, keptCandidates + candidateCount, inf_fused_logit_greater);
+        for(size_t i = 0; i < keptCount; i++)
+        {
+            maxLogit = std::max(maxLogit, keptCandidates[i].logit);
+        }
+
+        if(useTopP)
+        {
+            for(size_t i = 0; i < keptCount; i++)
+            {
+                expSum += expf(keptCandidates[i].logit - maxLogit);
+            }
+        }
+    }
+    else if(useTopK)
+    {
+        // min-heap of the k best logits, most tokens are rejected by a single compare with its front
+        const size_t topK = static_cast<size_t>(in_params.mTopK);
+        in_scratch.clear();
+        in_scratch.reserve(topK);
+        for(size_t i = 0; i < candidateCount; i++)
+        {
+            const llama_token_data& tmpCandidate = in_candidates->data[i];
+            if(in_scratch.size() < topK)
+            {
+                in_scratch.push_back(tmpCandidate);
+                std::push_heap(in_scratch.data(), in_scratch.data() + in_scratch.size(), inf_fused_logit_greater);
+            }
+            else if(tmpCandidate.logit > in_scratch.data()[0].logit)
+            {
+                std::pop_heap(in_scratch.data(), in_scratch.data() + topK, inf_fused_logit_greater);
+                in_scratch.data()[topK - 1] = tmpCandidate;
+                std::push_heap(in_scratch.data(), in_scratch.data() + topK, inf_fused_logit_greater);
+            }
+        }
+
+        keptCandidates = in_scratch.data();
+        keptCount = in_scratch.size();
+        for(size_t i = 0; i < keptCount; i++)
+        {
+            maxLogit = std::max(maxLogit, keptCandidates[i].logit);
+        }
+
+        if(useTopP)
+        {
+            for(size_t i = 0; i < keptCount; i++)
+            {
+                expSum += expf(keptCandidates[i].logit - maxLogit);
+            }
+        }
+    }
+    else
+    {
+        // online softmax over the whole vocabulary, tokens that can't pass min-p against the running
+        // maximum are dropped right away, the final maximum can only raise the threshold
+        for(size_t i = 0; i < candidateCount; i++)
+        {
+            const F32 tmpLogit = in_candidates->data[i].logit;
+            if(tmpLogit > maxLogit)
+            {
+                expSum = expSum * expf(maxLogit - tmpLogit) + 1.0;
+                maxLogit = tmpLogit;
+            }
+            else
+            {
+                expSum += expf(tmpLogit - maxLogit);
+            }
+
+            if(tmpLogit >= maxLogit + minPLog)
+            {
+                in_candidates->data[keptCount++] = in_candidates->data[i];
+            }
+        }
+    }
+
+    bool isSorted = false;
+    if(useTopP)
+    {
+        // sort only as far as the cumulative probability needs, growing the sorted prefix
+        size_t sortedCount = 0;
+        size_t sortTarget = std::min<size_t>(keptCount, 64);
+        size_t cutCount = keptCount;
+        const F64 inverseExpSum = 1.0 / expSum;
+        F64 cumulativeProbability = 0.0;
+        bool isCut = false;
+        while(!isCut)
+        {
+            if(sortTarget < keptCount)
+            {
+                std::nth_element(keptCandidates + sortedCount, keptCandidates + sortTarget - 1, keptCandidates + keptCount, inf_fused_logit_greater);
+            }
+            std::sort(keptCandidates + sortedCount, keptCandidates + sortTarget, inf_fused_logit_greater);
+            for(size_t i = sortedCount; i < sortTarget; i++)
+            {
+                cumulativeProbability += expf(keptCandidates[i].logit - maxLogit) * inverseExpSum;
+                if(cumulativeProbability >= in_params.mTopP)
+                {
+                    cutCount = i + 1;
+                    isCut = true;
+                    break;
+                }
+            }
+
+            sortedCount = sortTarget;
+            if(sortTarget == keptCount)
+            {
+                break;
+            }
+            // once most of the set is needed, selecting before sorting costs more than it saves
+            sortTarget = sortTarget * 4 > keptCount / 2 ? keptCount : sortTarget * 4;
+        }
+        keptCount = cutCount;
+        isSorted = true;
+    }
+    else if(useTopK)
+    {
+        std::sort(keptCandidates, keptCandidates + keptCount, inf_fused_logit_greater);
+        isSorted = true;
+    }
+
+    if(useMinP)
+    {
+        const F32 minLogit = maxLogit + minPLog;
+        if(isSorted)
+        {
+            while(keptCount > 1 && keptCandidates[keptCount - 1].logit < minLogit)
+            {
+                --keptCount;
+            }
+        }
+        else
+        {
+            size_t passCount = 0;
+            for(size_t i = 0; i < keptCount; i++)
+            {
+                if(keptCandidates[i].logit >= minLogit)
+                {
+                    keptCandidates[passCount++] = keptCandidates[i];
+                }
+            }
+            keptCount = passCount;
+        }
+    }
+
+    if(in_params.mTemp <= 0.0f)
+    {
+        if(!isSorted)
+        {
+            std::swap(keptCandidates[0], *std::max_element(keptCandidates, keptCandidates + keptCount, [](const llama_token_data& in_lhs, const llama_token_data& in_rhs) { return in_lhs.logit < in_rhs.logit; }));
+        }
+        keptCount = 1;
+        isSorted = true;
+    }
+    else if(in_params.mTemp != 1.0f)
+    {
+        for(size_t i = 0; i < keptCount; i++)
+        {
+            keptCandidates[i].logit /= in_params.mTemp;
+        }
+    }
+
+    if(keptCandidates != in_candidates->data)
+    {
+        std::copy(keptCandidates, keptCandidates + keptCount, in_candidates->data);
+    }
+    in_candidates->size = keptCount;
+    in_candidates->sorted = isSorted;
+    in_candidates->selected = -1;
+}
+
+MBASE_END
@@ -0,0 +1,759 @@
+#include <mbase/inference/inf_grammar.h>
+#include <unordered_set>
+
+MBASE_BEGIN
+
+struct inf_gbnf_primitive {
+    MSTRING mName;
+    MSTRING mBody;
+    MSTRING mDependencies[6];
+};
+
+// same shapes as the llama.cpp json-schema-to-grammar primitives
+static const inf_gbnf_primitive gInfGbnfPrimitives[] = {
+    {"space", "| \" \" | \"\\n\" [ \\t]{0,20}", {}},
+    {"boolean", "(\"true\" | \"false\") space", {"space"}},
+    {"null", "\"null\" space", {"space"}},
+    {"decimal-part", "[0-9]{1,16}", {}},
+    {"integral-part", "[0] | [1-9] [0-9]{0,15}", {}},
+    {"integer", "(\"-\"? integral-part) space", {"integral-part", "space"}},
+    {"number", "(\"-\"? integral-part) (\".\" decimal-part)? ([eE] [-+]? integral-part)? space", {"integral-part", "decimal-part", "space"}},
+    {"char", "[^\"\\\\\\x7F\\x00-\\x1F] | [\\\\] ([\"\\\\bfnrt] | \"u\" [0-9a-fA-F]{4})", {}},
+    {"string", "\"\\\"\" char* \"\\\"\" space", {"char", "space"}},
+    {"object", "\"{\" space ( string \":\" space value (\",\" space string \":\" space value)* )? \"}\" space", {"string", "value", "space"}},
+    {"array", "\"[\" space ( value (\",\" space value)* )? \"]\" space", {"value", "space"}},
+    {"value", "object | array | string | number | boolean | null", {"object", "array", "string", "number", "boolean", "null"}}
+};
+
+static const mbase::Json* inf_schema_member(const mbase::Json& in_schema, const mbase::string& in_key)
+{
+    if(!in_schema.isObject())
+    {
+        return NULL;
+    }
+    const std::map<mbase::string, mbase::Json>& schemaObject = in_schema.getObject();
+    std::map<mbase::string, mbase::Json>::const_iterator It = schemaObject.find(in_key);
+    if(It == schemaObject.end())
+    {
+        return NULL;
+    }
+    return &It->second;
+}
+
+static mbase::string inf_gbnf_literal(const mbase::string& in_text)
+{
+    mbase::string outLiteral = "\"";
+    for(const I8& tmpChar : in_text)
+    {
+        switch (tmpChar)
+        {
+        case '"':
+            outLiteral += "\\\"";
+            break;
+        case '\\':
+            outLiteral += "\\\\";
+            break;
+        case '\n':
+            outLiteral += "\\n";
+            break;
+        case '\r':
+            outLiteral += "\\r";
+            break;
+        case '\t':
+            outLiteral += "\\t";
+            break;
+        default:
+            if(static_cast<U8>(tmpChar) < 0x20)
+            {
+                outLiteral += mbase::string::from_format("\\x%02X", static_cast<U8>(tmpChar));
+            }
+            else
+            {
+                outLiteral.push_back(tmpChar);
+            }
+            break;
+        }
+    }
+    outLiteral.push_back('"');
+    return outLiteral;
+}
+
+static mbase::string inf_gbnf_rule_name(const mbase::string& in_name)
+{
+    mbase::string outName;
+    for(const I8& tmpChar : in_name)
+    {
+        if((tmpChar >= 'a' && tmpChar <= 'z') || (tmpChar >= 'A' && tmpChar <= 'Z') || (tmpChar >= '0' && tmpChar <= '9') || tmpChar == '-')
+        {
+            outName.push_back(tmpChar);
+        }
+        else
+        {
+            outName.push_back('-');
+        }
+    }
+    return outName.size() ? outName : mbase::string("rule");
+}
+
+class inf_gbnf_builder {
+public:
+    using size_type = SIZE_T;
+
+    inf_gbnf_builder(const mbase::Json& in_root_schema) : mRootSchema(in_root_schema), mResult(InfGrammar::flags::INF_GRAMMAR_SUCCESS) {}
+
+    InfGrammar::flags build(mbase::string& out_grammar)
+    {
+        visit(mRootSchema, "root");
+        if(mResult != InfGrammar::flags::INF_GRAMMAR_SUCCESS)
+        {
+            return mResult;
+        }
+
+        for(const mbase::string& ruleName : mRuleOrder)
+        {
+            out_grammar += ruleName + " ::= " + mRules[ruleName] + "\n";
+        }
+        return mResult;
+    }
+
+private:
+    mbase::string add_rule(const mbase::string& in_name, const mbase::string& in_body, bool in_reuse = true)
+    {
+        mbase::string ruleName = inf_gbnf_rule_name(in_name);
+        mbase::string uniqueName = ruleName;
+        for(U32 i = 1; mRules.find(uniqueName) != mRules.end(); i++)
+        {
+            if(in_reuse && mRules[uniqueName] == in_body)
+            {
+                return uniqueName;
+            }
+            uniqueName = ruleName + mbase::string::from_format("%u", i);
+        }
+        mRules[uniqueName] = in_body;
+        mRuleOrder.push_back(uniqueName);
+        return uniqueName;
+    }
+
+    mbase::string use_primitive(const mbase::string& in_name)
+    {
+        if(mRules.find(in_name) != mRules.end())
+        {
+            return in_name;
+        }
+
+        for(const inf_gbnf_primitive& tmpPrimitive : gInfGbnfPrimitives)
+        {
+            if(in_name != tmpPrimitive.mName)
+            {
+                continue;
+            }
+
+            // registered before the dependencies, value and object refer to each other
+            mRules[in_name] = tmpPrimitive.mBody;
+            mRuleOrder.push_back(in_name);
+            for(MSTRING tmpDependency : tmpPrimitive.mDependencies)
+            {
+                if(tmpDependency)
+                {
+                    use_primitive(tmpDependency);
+                }
+            }
+            break;
+        }
+        return in_name;
+    }
+
+    mbase::string resolve_ref(const mbase::string& in_ref)
+    {
+        std::unordered_map<mbase::string, mbase::string>::iterator refIt = mRefRules.find(in_ref);
+        if(refIt != mRefRules.end())
+        {
+            return refIt->second;
+        }
+
+        if(!in_ref.size() || in_ref[0] != '#')
+        {
+            // remote references are never fetched
+            mResult = InfGrammar::flags::INF_GRAMMAR_ERR_UNRESOLVED_REF;
+            return use_primitive("value");
+        }
+
+        const mbase::Json* targetSchema = &mRootSchema;
+        mbase::string lastSegment = "root";
+        size_type segmentBegin = 2;
+        while(segmentBegin <= in_ref.size() && in_ref.size() > 1)
+        {
+            size_type segmentEnd = in_ref.find('/', segmentBegin);
+            if(segmentEnd == mbase::string::npos)
+            {
+                segmentEnd = in_ref.size();
+            }
+            lastSegment = in_ref.substr(segmentBegin, segmentEnd - segmentBegin);
+            targetSchema = inf_schema_member(*targetSchema, lastSegment);
+            if(!targetSchema)
+            {
+                mResult = InfGrammar::flags::INF_GRAMMAR_ERR_UNRESOLVED_REF;
+                return use_primitive("value");
+            }
+            segmentBegin = segmentEnd + 1;
+        }
+
+        // the name is reserved before visiting so that recursive schemas refer back to it
+        mbase::string ruleName = add_rule("def-" + lastSegment, mbase::string(), false);
+        mRefRules[in_ref] = ruleName;
+        mRules[ruleName] = build_body(*targetSchema, ruleName);
+        return ruleName;
+    }
+
+    mbase::string visit(const mbase::Json& in_schema, const mbase::string& in_name)
+    {
+        mbase::string ruleBody = build_body(in_schema, in_name);
+        if(mRules.find(ruleBody) != mRules.end())
+        {
+            // body is a single rule reference, don't wrap it
+            if(in_name != "root")
+            {
+                return ruleBody;
+            }
+        }
+        return add_rule(in_name, ruleBody);
+    }
+
+    mbase::string build_alternatives(const mbase::vector<mbase::Json>& in_schemas, const mbase::string& in_name)
+    {
+        mbase::string outBody;
+        for(size_type i = 0; i < in_schemas.size(); i++)
+        {
+            if(i)
+            {
+                outBody += " | ";
+            }
+            outBody += visit(in_schemas[i], in_name + mbase::string::from_format("-%u", static_cast<U32>(i)));
+        }
+        return outBody;
+    }
+
+    mbase::string build_body(const mbase::Json& in_schema, const mbase::string& in_name)
+    {
+        if(in_schema.isBool())
+        {
+            // "true" accepts anything, "false" nothing, which can't be generated
+            if(!in_schema.getBool())
+            {
+                mResult = InfGrammar::flags::INF_GRAMMAR_ERR_INVALID_SCHEMA;
+            }
+            return use_primitive("value");
+        }
+
+        if(!in_schema.isObject())
+        {
+            mResult = InfGrammar::flags::INF_GRAMMAR_ERR_INVALID_SCHEMA;
+            return use_primitive("value");
+        }
+
+        if(const mbase::Json* refValue = inf_schema_member(in_schema, "$ref"))
+        {
+            if(!refValue->isString())
+            {
+                mResult = InfGrammar::flags::INF_GRAMMAR_ERR_INVALID_SCHEMA;
+                return use_primitive("value");
+            }
+            return resolve_ref(refValue->getString());
+        }
+
+        if(const mbase::Json* constValue = inf_schema_member(in_schema, "const"))
+        {
+            return inf_gbnf_literal(constValue->toString()) + " " + use_primitive("space");
+        }
+
+        if(const mbase::Json* enumValue = inf_schema_member(in_schema, "enum"))
+        {
+            if(!enumValue->isArray() || !enumValue->getArray().size())
+            {
+                mResult = InfGrammar::flags::INF_GRAMMAR_ERR_INVALID_SCHEMA;
+                return use_primitive("value");
+            }
+
+            mbase::string outBody = "(";
+            const mbase::vector<mbase::Json>& enumArray = enumValue->getArray();
+            for(size_type i = 0; i < enumArray.size(); i++)
+            {
+                outBody += (i ? " | " : "") + inf_gbnf_literal(enumArray[i].toString());
+            }
+            return outBody + ") " + use_primitive("space");
+        }
+
+        const mbase::Json* anyOfValue = inf_schema_member(in_schema, "anyOf");
+        if(!anyOfValue)
+        {
+            anyOfValue = inf_schema_member(in_schema, "oneOf");
+        }
+
+        if(anyOfValue)
+        {
+            if(!anyOfValue->isArray() || !anyOfValue->getArray().size())
+            {
+                mResult = InfGrammar::flags::INF_GRAMMAR_ERR_INVALID_SCHEMA;
+                return use_primitive("value");
+            }
+            return build_alternatives(anyOfValue->getArray(), in_name);
+        }
+
+        if(const mbase::Json* allOfValue = inf_schema_member(in_schema, "allOf"))
+        {
+            return build_all_of(*allOfValue, in_name);
+        }
+
+        const mbase::Json* typeValue = inf_schema_member(in_schema, "type");
+        if(typeValue && typeValue->isArray())
+        {
+            mbase::vector<mbase::Json> typedSchemas;
+            for(const mbase::Json& tmpType : typeValue->getArray())
+            {
+                mbase::Json typedSchema = in_schema;
+                typedSchema["type"] = tmpType;
+                typedSchemas.push_back(typedSchema);
+            }
+            return build_alternatives(typedSchemas, in_name);
+        }
+
+        mbase::string typeString;
+        if(typeValue && typeValue->isString())
+        {
+            typeString = typeValue->getString();
+        }
+        else if(inf_schema_member(in_schema, "properties"))
+        {
+            typeString = "object";
+        }
+        else if(inf_schema_member(in_schema, "items") || inf_schema_member(in_schema, "prefixItems"))
+        {
+            typeString = "array";
+        }
+
+        if(typeString == "object")
+        {
+            return build_object(in_schema, in_name);
+        }
+
+        if(typeString == "array")
+        {
+            return build_array(in_schema, in_name);
+        }
+
+        if(typeString == "string")
+        {
+            return build_string(in_schema);
+        }
+
+        if(typeString == "integer" || typeString == "number" || typeString == "boolean" || typeString == "null")
+        {
+            return use_primitive(typeString);
+        }
+
+        if(typeString.size())
+        {
+            mResult = InfGrammar::flags::INF_GRAMMAR_ERR_INVALID_SCHEMA;
+        }
+        return use_primitive("value");
+    }
+
+    mbase::string build_all_of(const mbase::Json& in_all_of, const mbase::string& in_name)
+    {
+        if(!in_all_of.isArray())
+        {
+            mResult = InfGrammar::flags::INF_GRAMMAR_ERR_INVALID_SCHEMA;
+            return use_primitive("value");
+        }
+
+        // only object schemas can be merged, their properties and required lists are combined
+        mbase::Json mergedSchema;
+        mergedSchema["type"] = "object";
+        mergedSchema["properties"].setObject();
+        mergedSchema["required"].setArray();
+        for(const mbase::Json& tmpSchema : in_all_of.getArray())
+        {
+            const mbase::Json* partSchema = resolve_schema(tmpSchema);
+            if(!partSchema)
+            {
+                return use_primitive("value");
+            }
+
+            if(const mbase::Json* partProperties = inf_schema_member(*partSchema, "properties"))
+            {
+                if(!partProperties->isObject())
+                {
+                    mResult = InfGrammar::flags::INF_GRAMMAR_ERR_INVALID_SCHEMA;
+                    return use_primitive("value");
+                }
+
+                for(const std::pair<const mbase::string, mbase::Json>& tmpProperty : partProperties->getObject())
+                {
+                    mergedSchema["properties"][tmpProperty.first] = tmpProperty.second;
+                }
+            }
+
+            if(const mbase::Json* partRequired = inf_schema_member(*partSchema, "required"))
+            {
+                if(partRequired->isArray())
+                {
+                    for(const mbase::Json& tmpRequired : partRequired->getArray())
+                    {
+                        mergedSchema["required"].getArray().push_back(tmpRequired);
+                    }
+                }
+            }
+        }
+        return build_object(mergedSchema, in_name);
+    }
+
+    const mbase::Json* resolve_schema(const mbase::Json& in_schema)
+    {
+        const mbase::Json* refValue = inf_schema_member(in_schema, "$ref");
+        if(!refValue)
+        {
+            return &in_schema;
+        }
+
+        const mbase::Json* targetSchema = &mRootSchema;
+        const mbase::string& refString = refValue->isString() ? refValue->getString() : mbase::string();
+        if(!refString.size() || refString[0] != '#')
+        {
+            mResult = InfGrammar::flags::INF_GRAMMAR_ERR_UNRESOLVED_REF;
+            return NULL;
+        }
+
+        size_type segmentBegin = 2;
+        while(segmentBegin <= refString.size() && refString.size() > 1)
+        {
+            size_type segmentEnd = refString.find('/', segmentBegin);
+            if(segmentEnd == mbase::string::npos)
+            {
+                segmentEnd = refString.size();
+            }
+            targetSchema = inf_schema_member(*targetSchema, refString.substr(segmentBegin, segmentEnd - segmentBegin));
+            if(!targetSchema)
+            {
+                mResult = InfGrammar::flags::INF_GRAMMAR_ERR_UNRESOLVED_REF;
+                return NULL;
+            }
+            segmentBegin = segmentEnd + 1;
+        }
+        return targetSchema;
+    }
+
+    mbase::string build_object(const mbase::Json& in_schema, const mbase::string& in_name)
+    {
+        const mbase::Json* propertiesValue = inf_schema_member(in_schema, "properties");
+        if(!propertiesValue || !propertiesValue->isObject() || !propertiesValue->getObject().size())
+        {
+            const mbase::Json* additionalValue = inf_schema_member(in_schema, "additionalProperties");
+            if(additionalValue && additionalValue->isObject())
+            {
+                mbase::string valueRule = visit(*additionalValue, in_name + "-value");
+                mbase::string kvRule = add_rule(in_name + "-kv", use_primitive("string") + " \":\" space " + valueRule);
+                return "\"{\" space (" + kvRule + " (\",\" space " + kvRule + ")*)? \"}\" space";
+            }
+            return use_primitive("object");
+        }
+
+        std::unordered_set<mbase::string> requiredSet;
+        if(const mbase::Json* requiredValue = inf_schema_member(in_schema, "required"))
+        {
+            if(requiredValue->isArray())
+            {
+                for(const mbase::Json& tmpRequired : requiredValue->getArray())
+                {
+                    if(tmpRequired.isString())
+                    {
+                        requiredSet.insert(tmpRequired.getString());
+                    }
+                }
+            }
+        }
+
+        use_primitive("space");
+        mbase::vector<mbase::string> requiredRules;
+        mbase::vector<mbase::string> optionalRules;
+        for(const std::pair<const mbase::string, mbase::Json>& tmpProperty : propertiesValue->getObject())
+        {
+            mbase::string propName = in_name + "-" + tmpProperty.first;
+            mbase::string valueRule = visit(tmpProperty.second, propName);
+            mbase::string kvRule = add_rule(propName + "-kv", inf_gbnf_literal(mbase::Json(tmpProperty.first).toString()) + " space \":\" space " + valueRule);
+            if(requiredSet.find(tmpProperty.first) != requiredSet.end())
+            {
+                requiredRules.push_back(kvRule);
+            }
+            else
+            {
+                optionalRules.push_back(kvRule);
+            }
+        }
+
+        mbase::string outBody = "\"{\" space ";
+        for(size_type i = 0; i < requiredRules.size(); i++)
+        {
+            outBody += (i ? "\",\" space " : "") + requiredRules[i] + " ";
+        }
+
+        if(optionalRules.size())
+        {
+            if(requiredRules.size())
+            {
+                for(const mbase::string& tmpOptional : optionalRules)
+                {
+                    outBody += "(\",\" space " + tmpOptional + ")? ";
+                }
+            }
+            else
+            {
+                // any optional property can come first, the ones after it stay optional
+                outBody += "(";
+                for(size_type i = 0; i < optionalRules.size(); i++)
+                {
+                    outBody += (i ? " | " : "") + optionalRules[i];
+                    for(size_type j = i + 1; j < optionalRules.size(); j++)
+                    {
+                        outBody += " (\",\" space " + optionalRules[j] + ")?";
+                    }
+                }
+                outBody += ")? ";
+            }
+        }
+        return outBody + "\"}\" space";
+    }
+
+    mbase::string build_array(const mbase::Json& in_schema, const mbase::string& in_name)
+    {
+        use_primitive("space");
+        if(const mbase::Json* prefixValue = inf_schema_member(in_schema, "prefixItems"))
+        {
+            if(!prefixValue->isArray())
+            {
+                mResult = InfGrammar::flags::INF_GRAMMAR_ERR_INVALID_SCHEMA;
+                return use_primitive("array");
+            }
+
+            mbase::string outBody = "\"[\" space ";
+            const mbase::vector<mbase::Json>& prefixArray = prefixValue->getArray();
+            for(size_type i = 0; i < prefixArray.size(); i++)
+            {
+                outBody += (i ? "\",\" space " : "") + visit(prefixArray[i], in_name + mbase::string::from_format("-%u", static_cast<U32>(i))) + " ";
+            }
+            return outBody + "\"]\" space";
+        }
+
+        const mbase::Json* itemsValue = inf_schema_member(in_schema, "items");
+        mbase::string itemRule = itemsValue ? visit(*itemsValue, in_name + "-item") : use_primitive("value");
+
+        const mbase::Json* minValue = inf_schema_member(in_schema, "minItems");
+        const mbase::Json* maxValue = inf_schema_member(in_schema, "maxItems");
+        I64 minItems = minValue && minValue->isLong() ? minValue->getLong() : 0;
+        I64 maxItems = maxValue && maxValue->isLong() ? maxValue->getLong() : -1;
+        if(minItems < 0 || (maxItems >= 0 && maxItems < minItems))
+        {
+            mResult = InfGrammar::flags::INF_GRAMMAR_ERR_INVALID_SCHEMA;
+            return use_primitive("array");
+        }
+
+        if(!maxItems)
+        {
+            return "\"[\" space \"]\" space";
+        }
+
+        mbase::string tailRepeat = maxItems < 0 ? mbase::string::from_format("{%lld,}", static_cast<long long>(minItems ? minItems - 1 : 0))
+                                                : mbase::string::from_format("{%lld,%lld}", static_cast<long long>(minItems ? minItems - 1 : 0), static_cast<long long>(maxItems - 1));
+        mbase::string itemList = itemRule + " (\",\" space " + itemRule + ")" + tailRepeat;
+        if(!minItems)
+        {
+            itemList = "(" + itemList + ")?";
+        }
+        return "\"[\" space " + itemList + " \"]\" space";
+    }
+
+    mbase::string build_string(const mbase::Json& in_schema)
+    {
+        const mbase::Json* minValue = inf_schema_member(in_schema, "minLength");
+        const mbase::Json* maxValue = inf_schema_member(in_schema, "maxLength");
+        if(!minValue && !maxValue)
+        {
+            return use_primitive("string");
+        }
+
+        I64 minLength = minValue && minValue->isLong() ? minValue->getLong() : 0;
+        I64 maxLength = maxValue && maxValue->isLong() ? maxValue->getLong() : -1;
+        if(minLength < 0 || (maxLength >= 0 && maxLength < minLength))
+        {
+            mResult = InfGrammar::flags::INF_GRAMMAR_ERR_INVALID_SCHEMA;
+            return use_primitive("string");
+        }
+
+        mbase::string charRepeat = maxLength < 0 ? mbase::string::from_format("{%lld,}", static_cast<long long>(minLength))
+                                                 : mbase::string::from_format("{%lld,%lld}", static_cast<long long>(minLength), static_cast<long long>(maxLength));
+        use_primitive("space");
+        return "\"\\\"\" " + use_primitive("char") + charRepeat + " \"\\\"\" space";
+    }
+
+    const mbase::Json& mRootSchema;
+    std::unordered_map<mbase::string, mbase::string> mRules;
+    std::unordered_map<mbase::string, mbase::string> mRefRules;
+    mbase::vector<mbase::string> mRuleOrder;
+    InfGrammar::flags mResult;
+};
+
+InfGrammar::flags InfGrammar::json_schema_to_gbnf(const mbase::string& in_schema, mbase::string& out_grammar)
+{
+    std::pair<mbase::Json::Status, mbase::Json> parseResult = mbase::Json::parse(in_schema);
+    if(parseResult.first != mbase::Json::Status::success)
+    {
+        return flags::INF_GRAMMAR_ERR_INVALID_JSON;
+    }
+    return json_schema_to_gbnf(parseResult.second, out_grammar);
+}
+
+InfGrammar::flags InfGrammar::json_schema_to_gbnf(const mbase::Json& in_schema, mbase::string& out_grammar)
+{
+    inf_gbnf_builder gbnfBuilder(in_schema);
+    mbase::string generatedGrammar;
+    flags buildResult = gbnfBuilder.build(generatedGrammar);
+    if(buildResult == flags::INF_GRAMMAR_SUCCESS)
+    {
+        out_grammar = generatedGrammar;
+    }
+    return buildResult;
+}
+
+mbase::string InfGrammar::json_object_gbnf()
+{
+    mbase::string outGrammar;
+    mbase::Json objectSchema;
+    objectSchema["type"] = "object";
+    json_schema_to_gbnf(objectSchema, outGrammar);
+    return outGrammar;
+}
+
+U64 InfGrammar::hash(const mbase::string& in_text, const mbase::string& in_salt)
+{
+    U64 hashValue = 14695981039346656037ull;
+    for(const I8& tmpChar : in_salt)
+    {
+        hashValue = (hashValue ^ static_cast<U8>(tmpChar)) * 1099511628211ull;
+    }
+    hashValue = (hashValue ^ 0xff) * 1099511628211ull;
+    for(const I8& tmpChar : in_text)
+    {
+        hashValue = (hashValue ^ static_cast<U8>(tmpChar)) * 1099511628211ull;
+    }
+    return hashValue;
+}
+
+InfGrammarCache::InfGrammarCache(const U32& in_capacity) noexcept :
+    mCapacity(in_capacity ? in_capacity : 1),
+    mHitCount(0),
+    mMissCount(0)
+{
+}
+
+InfGrammarCache::~InfGrammarCache()
+{
+    clear();
+}
+
+U32 InfGrammarCache::get_size()
+{
+    mbase::lock_guard cacheLock(mCacheMutex);
+    return static_cast<U32>(mEntries.size());
+}
+
+U64 InfGrammarCache::get_hit_count()
+{
+    mbase::lock_guard cacheLock(mCacheMutex);
+    return mHitCount;
+}
+
+U64 InfGrammarCache::get_miss_count()
+{
+    mbase::lock_guard cacheLock(mCacheMutex);
+    return mMissCount;
+}
+
+InfGrammarCache::flags InfGrammarCache::acquire_grammar(const llama_vocab* in_vocab, const mbase::string& in_grammar, const mbase::string& in_root, llama_sampler*& out_sampler)
+{
+    return _acquire(in_vocab, in_grammar, "gbnf:" + in_root, in_root, false, out_sampler);
+}
+
+InfGrammarCache::flags InfGrammarCache::acquire_json_schema(const llama_vocab* in_vocab, const mbase::string& in_schema, llama_sampler*& out_sampler)
+{
+    return _acquire(in_vocab, in_schema, "json-schema", "root", true, out_sampler);
+}
+
+GENERIC InfGrammarCache::clear()
+{
+    mbase::lock_guard cacheLock(mCacheMutex);
+    for(std::pair<const U64, cache_entry>& tmpEntry : mEntries)
+    {
+        llama_sampler_free(tmpEntry.second.mPrototype);
+    }
+    mEntries.clear();
+    mInsertionOrder.clear();
+}
+
+InfGrammarCache::flags InfGrammarCache::_acquire(const llama_vocab* in_vocab, const mbase::string& in_source, const mbase::string& in_salt, const mbase::string& in_root, bool in_is_schema, llama_sampler*& out_sampler)
+{
+    const U64 sourceHash = InfGrammar::hash(in_source, in_salt);
+    {
+        mbase::lock_guard cacheLock(mCacheMutex);
+        std::unordered_map<U64, cache_entry>::iterator entryIt = mEntries.find(sourceHash);
+        if(entryIt != mEntries.end() && entryIt->second.mSource == in_source)
+        {
+            ++mHitCount;
+            out_sampler = llama_sampler_clone(entryIt->second.mPrototype);
+            return flags::INF_GRAMMAR_SUCCESS;
+        }
+        ++mMissCount;
+    }
+
+    // compiled outside of the lock, a large grammar takes a while
+    mbase::string grammarText = in_source;
+    if(in_is_schema)
+    {
+        grammarText.clear();
+        flags convertResult = InfGrammar::json_schema_to_gbnf(in_source, grammarText);
+        if(convertResult != flags::INF_GRAMMAR_SUCCESS)
+        {
+            return convertResult;
+        }
+    }
+
+    llama_sampler* compiledGrammar = llama_sampler_init_grammar(in_vocab, grammarText.c_str(), in_root.c_str());
+    if(!compiledGrammar)
+    {
+        return flags::INF_GRAMMAR_ERR_UNABLE_TO_COMPILE;
+    }
+
+    mbase::lock_guard cacheLock(mCacheMutex);
+    out_sampler = llama_sampler_clone(compiledGrammar);
+    std::unordered_map<U64, cache_entry>::iterator entryIt = mEntries.find(sourceHash);
+    if(entryIt != mEntries.end())
+    {
+        // compiled concurrently by another processor or a colliding hash, keep the newer one
+        llama_sampler_free(entryIt->second.mPrototype);
+        entryIt->second.mSource = in_source;
+        entryIt->second.mPrototype = compiledGrammar;
+        return flags::INF_GRAMMAR_SUCCESS;
+    }
+
+    if(mEntries.size() >= mCapacity)
+    {
+        std::unordered_map<U64, cache_entry>::iterator oldestIt = mEntries.find(mInsertionOrder.front());
+        llama_sampler_free(oldestIt->second.mPrototype);
+        mEntries.erase(oldestIt);
+        mInsertionOrder.pop_front();
+    }
+
+    mEntries[sourceHash] = cache_entry{in_source, compiledGrammar};
+    mInsertionOrder.push_back(sourceHash);
+    return flags::INF_GRAMMAR_SUCCESS;
+}
+
+MBASE_END
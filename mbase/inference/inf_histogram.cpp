@@ -0,0 +1,209 @@
+#include <mbase/inference/inf_histogram.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+MBASE_BEGIN
+
+static const F64 gInfHistogramQuantiles[] = {0.5, 0.9, 0.99, 0.999};
+
+static U32 inf_histogram_msb(const U64& in_value) noexcept
+{
+    #if defined(__GNUC__) || defined(__clang__)
+        return 63 - static_cast<U32>(__builtin_clzll(in_value));
+    #elif defined(_MSC_VER) && defined(_M_X64)
+        unsigned long bitIndex = 0;
+        _BitScanReverse64(&bitIndex, in_value);
+        return static_cast<U32>(bitIndex);
+    #else
+        U32 bitIndex = 0;
+        U64 tmpValue = in_value;
+        while(tmpValue >>= 1)
+        {
+            ++bitIndex;
+        }
+        return bitIndex;
+    #endif
+}
+
+InfHistogram::InfHistogram() noexcept
+{
+    reset();
+}
+
+U64 InfHistogram::get_count() const noexcept
+{
+    return mCount.load(std::memory_order_relaxed);
+}
+
+U64 InfHistogram::get_sum() const noexcept
+{
+    return mSum.load(std::memory_order_relaxed);
+}
+
+U64 InfHistogram::get_max() const noexcept
+{
+    return mMax.load(std::memory_order_relaxed);
+}
+
+F64 InfHistogram::get_mean() const noexcept
+{
+    U64 totalCount = get_count();
+    if(!totalCount)
+    {
+        return 0.0;
+    }
+    return static_cast<F64>(get_sum()) / totalCount;
+}
+
+U64 InfHistogram::get_percentile(const F64& in_quantile) const noexcept
+{
+    // buckets are summed instead of reading mCount, so that a concurrent record can't push the rank past the last bucket
+    U64 totalCount = 0;
+    for(U32 i = 0; i < BUCKET_COUNT; i++)
+    {
+        totalCount += mBuckets[i].load(std::memory_order_relaxed);
+    }
+
+    if(!totalCount)
+    {
+        return 0;
+    }
+
+    F64 clampedQuantile = in_quantile < 0.0 ? 0.0 : (in_quantile > 1.0 ? 1.0 : in_quantile);
+    U64 targetRank = static_cast<U64>(clampedQuantile * totalCount + 0.5);
+    if(!targetRank)
+    {
+        targetRank = 1;
+    }
+
+    U64 seenCount = 0;
+    for(U32 i = 0; i < BUCKET_COUNT; i++)
+    {
+        seenCount += mBuckets[i].load(std::memory_order_relaxed);
+        if(seenCount >= targetRank)
+        {
+            U64 upperBound = bucket_upper_bound(i);
+            U64 maxValue = get_max();
+            return upperBound < maxValue ? upperBound : maxValue;
+        }
+    }
+    return get_max();
+}
+
+GENERIC InfHistogram::record(const U64& in_value) noexcept
+{
+    mBuckets[bucket_index(in_value)].fetch_add(1, std::memory_order_relaxed);
+    mCount.fetch_add(1, std::memory_order_relaxed);
+    mSum.fetch_add(in_value, std::memory_order_relaxed);
+
+    U64 currentMax = mMax.load(std::memory_order_relaxed);
+    while(in_value > currentMax && !mMax.compare_exchange_weak(currentMax, in_value, std::memory_order_relaxed))
+    {
+    }
+}
+
+GENERIC InfHistogram::merge(const InfHistogram& in_histogram) noexcept
+{
+    for(U32 i = 0; i < BUCKET_COUNT; i++)
+    {
+        U64 bucketCount = in_histogram.mBuckets[i].load(std::memory_order_relaxed);
+        if(bucketCount)
+        {
+            mBuckets[i].fetch_add(bucketCount, std::memory_order_relaxed);
+        }
+    }
+    mCount.fetch_add(in_histogram.get_count(), std::memory_order_relaxed);
+    mSum.fetch_add(in_histogram.get_sum(), std::memory_order_relaxed);
+
+    U64 otherMax = in_histogram.get_max();
+    U64 currentMax = mMax.load(std::memory_order_relaxed);
+    while(otherMax > currentMax && !mMax.compare_exchange_weak(currentMax, otherMax, std::memory_order_relaxed))
+    {
+    }
+}
+
+GENERIC InfHistogram::reset() noexcept
+{
+    for(U32 i = 0; i < BUCKET_COUNT; i++)
+    {
+        mBuckets[i].store(0, std::memory_order_relaxed);
+    }
+    mCount.store(0, std::memory_order_relaxed);
+    mSum.store(0, std::memory_order_relaxed);
+    mMax.store(0, std::memory_order_relaxed);
+}
+
+GENERIC InfHistogram::write_prometheus_header(const mbase::string& in_name, const mbase::string& in_help, mbase::string& out_text)
+{
+    out_text += "# HELP " + in_name + " " + in_help + "\n";
+    out_text += "# TYPE " + in_name + " summary\n";
+}
+
+GENERIC InfHistogram::write_prometheus(const mbase::string& in_name, const mbase::string& in_labels, const F64& in_scale, mbase::string& out_text) const
+{
+    mbase::string labelPrefix = in_labels.size() ? in_labels + "," : mbase::string();
+    for(const F64& tmpQuantile : gInfHistogramQuantiles)
+    {
+        out_text += mbase::string::from_format("%s{%squantile=\"%g\"} %.9g\n", in_name.c_str(), labelPrefix.c_str(), tmpQuantile, get_percentile(tmpQuantile) * in_scale);
+    }
+
+    mbase::string labelSet = in_labels.size() ? "{" + in_labels + "}" : mbase::string();
+    out_text += mbase::string::from_format("%s_sum%s %.9g\n", in_name.c_str(), labelSet.c_str(), get_sum() * in_scale);
+    out_text += mbase::string::from_format("%s_count%s %llu\n", in_name.c_str(), labelSet.c_str(), static_cast<unsigned long long>(get_count()));
+}
+
+mbase::string InfHistogram::escape_prometheus_label(const mbase::string& in_value)
+{
+    mbase::string outValue;
+    for(const I8& tmpChar : in_value)
+    {
+        if(tmpChar == '\\' || tmpChar == '"')
+        {
+            outValue.push_back('\\');
+            outValue.push_back(tmpChar);
+        }
+        else if(tmpChar == '\n')
+        {
+            outValue += "\\n";
+        }
+        else
+        {
+            outValue.push_back(tmpChar);
+        }
+    }
+    return outValue;
+}
+
+U32 InfHistogram::bucket_index(U64 in_value) noexcept
+{
+    if(in_value < (2 * SUB_BUCKET_COUNT))
+    {
+        return static_cast<U32>(in_value);
+    }
+
+    const U64 maxValue = (1ull << MAX_VALUE_BITS) - 1;
+    if(in_value > maxValue)
+    {
+        in_value = maxValue;
+    }
+
+    // the top SUB_BUCKET_BITS + 1 bits select the bucket, the rest is the resolution lost
+    U32 bitShift = inf_histogram_msb(in_value) - SUB_BUCKET_BITS;
+    return (bitShift + 1) * SUB_BUCKET_COUNT + static_cast<U32>((in_value >> bitShift) - SUB_BUCKET_COUNT);
+}
+
+U64 InfHistogram::bucket_upper_bound(const U32& in_index) noexcept
+{
+    if(in_index < (2 * SUB_BUCKET_COUNT))
+    {
+        return in_index;
+    }
+
+    U32 bitShift = in_index / SUB_BUCKET_COUNT - 1;
+    U64 lowerBound = static_cast<U64>(SUB_BUCKET_COUNT + in_index % SUB_BUCKET_COUNT) << bitShift;
+    return lowerBound + (1ull << bitShift) - 1;
+}
+
+MBASE_END
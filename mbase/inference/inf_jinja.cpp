@@ -0,0 +1,3516 @@
+#include <mbase/inference/inf_jinja.h>
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+
+MBASE_BEGIN
+
+struct inf_jinja_map;
+
+struct inf_jinja_value {
+    enum class kind : U8 {
+        UNDEFINED,
+        NONE,
+        BOOL,
+        INT,
+        FLOAT,
+        STRING,
+        LIST,
+        MAP
+    };
+
+    kind mKind = kind::UNDEFINED;
+    bool mBool = false;
+    I64 mInt = 0;
+    F64 mFloat = 0.0;
+    mbase::string mString;
+    // shared like python objects, append and namespace attributes mutate in place
+    std::shared_ptr<std::vector<inf_jinja_value>> mList;
+    std::shared_ptr<inf_jinja_map> mMap;
+
+    static inf_jinja_value make_none() { inf_jinja_value outValue; outValue.mKind = kind::NONE; return outValue; }
+    static inf_jinja_value make_bool(bool in_value) { inf_jinja_value outValue; outValue.mKind = kind::BOOL; outValue.mBool = in_value; return outValue; }
+    static inf_jinja_value make_int(I64 in_value) { inf_jinja_value outValue; outValue.mKind = kind::INT; outValue.mInt = in_value; return outValue; }
+    static inf_jinja_value make_float(F64 in_value) { inf_jinja_value outValue; outValue.mKind = kind::FLOAT; outValue.mFloat = in_value; return outValue; }
+    static inf_jinja_value make_string(const mbase::string& in_value) { inf_jinja_value outValue; outValue.mKind = kind::STRING; outValue.mString = in_value; return outValue; }
+    static inf_jinja_value make_list();
+    static inf_jinja_value make_map();
+
+    bool is_number() const { return mKind == kind::BOOL || mKind == kind::INT || mKind == kind::FLOAT; }
+    bool is_integral() const { return mKind == kind::BOOL || mKind == kind::INT; }
+    I64 as_int() const { return mKind == kind::BOOL ? static_cast<I64>(mBool) : mKind == kind::INT ? mInt : static_cast<I64>(mFloat); }
+    F64 as_float() const { return mKind == kind::FLOAT ? mFloat : static_cast<F64>(as_int()); }
+};
+
+using inf_jinja_list = std::vector<inf_jinja_value>;
+
+// insertion ordered like python dicts, the maps of chat templates hold a handful of keys
+struct inf_jinja_map {
+    std::vector<std::pair<mbase::string, inf_jinja_value>> mEntries;
+
+    const inf_jinja_value* find(const mbase::string& in_key) const
+    {
+        for(const std::pair<mbase::string, inf_jinja_value>& tmpEntry : mEntries)
+        {
+            if(tmpEntry.first == in_key)
+            {
+                return &tmpEntry.second;
+            }
+        }
+        return NULL;
+    }
+
+    GENERIC set(const mbase::string& in_key, const inf_jinja_value& in_value)
+    {
+        for(std::pair<mbase::string, inf_jinja_value>& tmpEntry : mEntries)
+        {
+            if(tmpEntry.first == in_key)
+            {
+                tmpEntry.second = in_value;
+                return;
+            }
+        }
+        mEntries.push_back(std::make_pair(in_key, in_value));
+    }
+};
+
+inf_jinja_value inf_jinja_value::make_list()
+{
+    inf_jinja_value outValue;
+    outValue.mKind = kind::LIST;
+    outValue.mList = std::make_shared<inf_jinja_list>();
+    return outValue;
+}
+
+inf_jinja_value inf_jinja_value::make_map()
+{
+    inf_jinja_value outValue;
+    outValue.mKind = kind::MAP;
+    outValue.mMap = std::make_shared<inf_jinja_map>();
+    return outValue;
+}
+
+enum class inf_jinja_op : U8 {
+    TEXT, // a: text index
+    EMIT,
+    CONST, // a: constant index
+    LOAD, // a: name id
+    STORE, // a: name id
+    STORE_ATTR, // a: name id, pops value and object
+    GET_ATTR, // a: name id
+    GET_ITEM,
+    SLICE, // a: mask of the given start(1), stop(2), step(4)
+    CALL, // a: function, b: argument count, c: keyword list or -1
+    CALL_METHOD, // a: method, b: argument count, c: keyword list or -1
+    FILTER, // a: filter, b: argument count, c: keyword list or -1
+    TEST, // a: test, b: argument count, c: negated
+    NOT,
+    NEGATE,
+    BINARY, // a: binary operator
+    JUMP, // a: relative
+    JUMP_FALSE, // a: relative, pops the condition
+    JUMP_FALSE_KEEP, // a: relative, keeps the condition if it jumps
+    JUMP_TRUE_KEEP, // a: relative, keeps the condition if it jumps
+    BUILD_LIST, // a: count
+    BUILD_DICT, // a: pair count
+    FOR_BEGIN, // a: relative to the else branch or the end if empty, b: variable, c: second variable or -1
+    FOR_NEXT, // a: relative to the loop body
+    FOR_BREAK
+};
+
+enum class inf_jinja_binary : I32 {
+    ADD,
+    SUBTRACT,
+    MULTIPLY,
+    DIVIDE,
+    FLOOR_DIVIDE,
+    MODULO,
+    CONCAT,
+    EQUAL,
+    NOT_EQUAL,
+    LESS,
+    GREATER,
+    LESS_EQUAL,
+    GREATER_EQUAL,
+    CONTAINS,
+    NOT_CONTAINS
+};
+
+enum class inf_jinja_function : I32 {
+    RAISE_EXCEPTION,
+    NAMESPACE,
+    RANGE,
+    STRFTIME_NOW,
+    DICT
+};
+
+enum class inf_jinja_filter : I32 {
+    TRIM,
+    LENGTH,
+    UPPER,
+    LOWER,
+    CAPITALIZE,
+    TITLE,
+    STRING,
+    INT,
+    FLOAT,
+    DEFAULT,
+    TOJSON,
+    JOIN,
+    FIRST,
+    LAST,
+    LIST,
+    REVERSE,
+    REPLACE,
+    SAFE,
+    ITEMS,
+    SELECT,
+    REJECT,
+    SELECTATTR,
+    REJECTATTR,
+    MAP
+};
+
+enum class inf_jinja_test : I32 {
+    DEFINED,
+    UNDEFINED,
+    NONE,
+    STRING,
+    NUMBER,
+    INTEGER,
+    FLOAT,
+    BOOLEAN,
+    MAPPING,
+    SEQUENCE,
+    ITERABLE,
+    IS_TRUE,
+    IS_FALSE,
+    EQUALTO,
+    NOT_EQUALTO,
+    ODD,
+    EVEN,
+    CONTAINED
+};
+
+enum class inf_jinja_method : I32 {
+    STRIP,
+    LSTRIP,
+    RSTRIP,
+    STARTSWITH,
+    ENDSWITH,
+    SPLIT,
+    UPPER,
+    LOWER,
+    TITLE,
+    CAPITALIZE,
+    REPLACE,
+    FIND,
+    ITEMS,
+    KEYS,
+    VALUES,
+    GET,
+    APPEND
+};
+
+struct inf_jinja_builtin {
+    MSTRING mName;
+    I32 mId;
+};
+
+static const inf_jinja_builtin gInfJinjaFunctions[] = {
+    {"raise_exception", static_cast<I32>(inf_jinja_function::RAISE_EXCEPTION)},
+    {"namespace", static_cast<I32>(inf_jinja_function::NAMESPACE)},
+    {"range", static_cast<I32>(inf_jinja_function::RANGE)},
+    {"strftime_now", static_cast<I32>(inf_jinja_function::STRFTIME_NOW)},
+    {"dict", static_cast<I32>(inf_jinja_function::DICT)}
+};
+
+static const inf_jinja_builtin gInfJinjaFilters[] = {
+    {"trim", static_cast<I32>(inf_jinja_filter::TRIM)},
+    {"length", static_cast<I32>(inf_jinja_filter::LENGTH)},
+    {"count", static_cast<I32>(inf_jinja_filter::LENGTH)},
+    {"upper", static_cast<I32>(inf_jinja_filter::UPPER)},
+    {"lower", static_cast<I32>(inf_jinja_filter::LOWER)},
+    {"capitalize", static_cast<I32>(inf_jinja_filter::CAPITALIZE)},
+    {"title", static_cast<I32>(inf_jinja_filter::TITLE)},
+    {"string", static_cast<I32>(inf_jinja_filter::STRING)},
+    {"int", static_cast<I32>(inf_jinja_filter::INT)},
+    {"float", static_cast<I32>(inf_jinja_filter::FLOAT)},
+    {"default", static_cast<I32>(inf_jinja_filter::DEFAULT)},
+    {"d", static_cast<I32>(inf_jinja_filter::DEFAULT)},
+    {"tojson", static_cast<I32>(inf_jinja_filter::TOJSON)},
+    {"join", static_cast<I32>(inf_jinja_filter::JOIN)},
+    {"first", static_cast<I32>(inf_jinja_filter::FIRST)},
+    {"last", static_cast<I32>(inf_jinja_filter::LAST)},
+    {"list", static_cast<I32>(inf_jinja_filter::LIST)},
+    {"reverse", static_cast<I32>(inf_jinja_filter::REVERSE)},
+    {"replace", static_cast<I32>(inf_jinja_filter::REPLACE)},
+    {"safe", static_cast<I32>(inf_jinja_filter::SAFE)},
+    {"items", static_cast<I32>(inf_jinja_filter::ITEMS)},
+    {"select", static_cast<I32>(inf_jinja_filter::SELECT)},
+    {"reject", static_cast<I32>(inf_jinja_filter::REJECT)},
+    {"selectattr", static_cast<I32>(inf_jinja_filter::SELECTATTR)},
+    {"rejectattr", static_cast<I32>(inf_jinja_filter::REJECTATTR)},
+    {"map", static_cast<I32>(inf_jinja_filter::MAP)}
+};
+
+static const inf_jinja_builtin gInfJinjaTests[] = {
+    {"defined", static_cast<I32>(inf_jinja_test::DEFINED)},
+    {"undefined", static_cast<I32>(inf_jinja_test::UNDEFINED)},
+    {"none", static_cast<I32>(inf_jinja_test::NONE)},
+    {"string", static_cast<I32>(inf_jinja_test::STRING)},
+    {"number", static_cast<I32>(inf_jinja_test::NUMBER)},
+    {"integer", static_cast<I32>(inf_jinja_test::INTEGER)},
+    {"float", static_cast<I32>(inf_jinja_test::FLOAT)},
+    {"boolean", static_cast<I32>(inf_jinja_test::BOOLEAN)},
+    {"mapping", static_cast<I32>(inf_jinja_test::MAPPING)},
+    {"sequence", static_cast<I32>(inf_jinja_test::SEQUENCE)},
+    {"iterable", static_cast<I32>(inf_jinja_test::ITERABLE)},
+    {"true", static_cast<I32>(inf_jinja_test::IS_TRUE)},
+    {"false", static_cast<I32>(inf_jinja_test::IS_FALSE)},
+    {"equalto", static_cast<I32>(inf_jinja_test::EQUALTO)},
+    {"eq", static_cast<I32>(inf_jinja_test::EQUALTO)},
+    {"==", static_cast<I32>(inf_jinja_test::EQUALTO)},
+    {"sameas", static_cast<I32>(inf_jinja_test::EQUALTO)},
+    {"ne", static_cast<I32>(inf_jinja_test::NOT_EQUALTO)},
+    {"!=", static_cast<I32>(inf_jinja_test::NOT_EQUALTO)},
+    {"odd", static_cast<I32>(inf_jinja_test::ODD)},
+    {"even", static_cast<I32>(inf_jinja_test::EVEN)},
+    {"in", static_cast<I32>(inf_jinja_test::CONTAINED)}
+};
+
+static const inf_jinja_builtin gInfJinjaMethods[] = {
+    {"strip", static_cast<I32>(inf_jinja_method::STRIP)},
+    {"lstrip", static_cast<I32>(inf_jinja_method::LSTRIP)},
+    {"rstrip", static_cast<I32>(inf_jinja_method::RSTRIP)},
+    {"startswith", static_cast<I32>(inf_jinja_method::STARTSWITH)},
+    {"endswith", static_cast<I32>(inf_jinja_method::ENDSWITH)},
+    {"split", static_cast<I32>(inf_jinja_method::SPLIT)},
+    {"upper", static_cast<I32>(inf_jinja_method::UPPER)},
+    {"lower", static_cast<I32>(inf_jinja_method::LOWER)},
+    {"title", static_cast<I32>(inf_jinja_method::TITLE)},
+    {"capitalize", static_cast<I32>(inf_jinja_method::CAPITALIZE)},
+    {"replace", static_cast<I32>(inf_jinja_method::REPLACE)},
+    {"find", static_cast<I32>(inf_jinja_method::FIND)},
+    {"items", static_cast<I32>(inf_jinja_method::ITEMS)},
+    {"keys", static_cast<I32>(inf_jinja_method::KEYS)},
+    {"values", static_cast<I32>(inf_jinja_method::VALUES)},
+    {"get", static_cast<I32>(inf_jinja_method::GET)},
+    {"append", static_cast<I32>(inf_jinja_method::APPEND)}
+};
+
+template<SIZE_T N>
+static I32 inf_jinja_find_builtin(const inf_jinja_builtin (&in_table)[N], const mbase::string& in_name)
+{
+    for(const inf_jinja_builtin& tmpBuiltin : in_table)
+    {
+        if(in_name == tmpBuiltin.mName)
+        {
+            return tmpBuiltin.mId;
+        }
+    }
+    return -1;
+}
+
+struct inf_jinja_instruction {
+    inf_jinja_op mOp;
+    I32 mA = 0;
+    I32 mB = 0;
+    I32 mC = 0;
+};
+
+using inf_jinja_code = std::vector<inf_jinja_instruction>;
+
+struct inf_jinja_program {
+    inf_jinja_code mCode;
+    std::vector<mbase::string> mTexts;
+    std::vector<inf_jinja_value> mConstants;
+    std::vector<mbase::string> mNames;
+    std::unordered_map<mbase::string, I32> mNameIndex;
+    std::vector<std::vector<I32>> mKeywordLists; // keyword argument names of the call sites
+    I32 mLoopName = -1;
+
+    I32 intern(const mbase::string& in_name)
+    {
+        std::unordered_map<mbase::string, I32>::iterator It = mNameIndex.find(in_name);
+        if(It != mNameIndex.end())
+        {
+            return It->second;
+        }
+        I32 nameId = static_cast<I32>(mNames.size());
+        mNames.push_back(in_name);
+        mNameIndex[in_name] = nameId;
+        return nameId;
+    }
+
+    I32 find_name(const mbase::string& in_name) const
+    {
+        std::unordered_map<mbase::string, I32>::const_iterator It = mNameIndex.find(in_name);
+        return It == mNameIndex.end() ? -1 : It->second;
+    }
+};
+
+/* ===== VALUE HELPERS ===== */
+
+static bool inf_jinja_is_space(I8 in_char)
+{
+    return in_char == ' ' || in_char == '\t' || in_char == '\n' || in_char == '\r' || in_char == '\f' || in_char == '\v';
+}
+
+static mbase::string inf_jinja_substring(const mbase::string& in_string, SIZE_T in_pos, SIZE_T in_count = mbase::string::npos)
+{
+    if(in_pos >= in_string.size())
+    {
+        return mbase::string();
+    }
+    return mbase::string(in_string.c_str() + in_pos, std::min(in_count, in_string.size() - in_pos));
+}
+
+static bool inf_jinja_has_prefix(const mbase::string& in_string, const mbase::string& in_prefix)
+{
+    return in_prefix.size() <= in_string.size() && !memcmp(in_string.c_str(), in_prefix.c_str(), in_prefix.size());
+}
+
+static bool inf_jinja_has_suffix(const mbase::string& in_string, const mbase::string& in_suffix)
+{
+    return in_suffix.size() <= in_string.size() && !memcmp(in_string.c_str() + in_string.size() - in_suffix.size(), in_suffix.c_str(), in_suffix.size());
+}
+
+static mbase::string inf_jinja_strip(const mbase::string& in_string, bool in_left, bool in_right, const mbase::string* in_chars = NULL)
+{
+    auto isStripped = [in_chars](I8 in_char) {
+        return in_chars ? in_chars->find(in_char) != mbase::string::npos : inf_jinja_is_space(in_char);
+    };
+    SIZE_T beginIndex = 0;
+    SIZE_T endIndex = in_string.size();
+    while(in_left && beginIndex < endIndex && isStripped(in_string[beginIndex]))
+    {
+        ++beginIndex;
+    }
+    while(in_right && endIndex > beginIndex && isStripped(in_string[endIndex - 1]))
+    {
+        --endIndex;
+    }
+    return mbase::string(in_string.c_str() + beginIndex, endIndex - beginIndex);
+}
+
+static mbase::string inf_jinja_change_case(const mbase::string& in_string, I32 in_mode) // 0 upper, 1 lower, 2 capitalize, 3 title
+{
+    mbase::string outString = in_string;
+    bool isWordStart = true;
+    for(SIZE_T i = 0; i < outString.size(); i++)
+    {
+        I8& tmpChar = outString[i];
+        bool toUpper = in_mode == 0 || (in_mode == 2 && i == 0) || (in_mode == 3 && isWordStart);
+        tmpChar = toUpper ? static_cast<I8>(toupper(static_cast<unsigned char>(tmpChar))) : static_cast<I8>(tolower(static_cast<unsigned char>(tmpChar)));
+        isWordStart = !isalnum(static_cast<unsigned char>(tmpChar));
+    }
+    return outString;
+}
+
+static mbase::string inf_jinja_replace(const mbase::string& in_string, const mbase::string& in_old, const mbase::string& in_new, I64 in_count = -1)
+{
+    if(in_old.empty())
+    {
+        return in_string;
+    }
+    mbase::string outString;
+    SIZE_T searchIndex = 0;
+    SIZE_T foundIndex = 0;
+    while(in_count != 0 && (foundIndex = in_string.find(in_old, searchIndex)) != mbase::string::npos)
+    {
+        outString.append(in_string.c_str() + searchIndex, foundIndex - searchIndex);
+        outString += in_new;
+        searchIndex = foundIndex + in_old.size();
+        --in_count;
+    }
+    outString.append(in_string.c_str() + searchIndex, in_string.size() - searchIndex);
+    return outString;
+}
+
+static SIZE_T inf_jinja_utf8_length(const mbase::string& in_string)
+{
+    SIZE_T codepointCount = 0;
+    for(const I8& tmpChar : in_string)
+    {
+        codepointCount += (static_cast<unsigned char>(tmpChar) & 0xC0) != 0x80;
+    }
+    return codepointCount;
+}
+
+static GENERIC inf_jinja_utf8_split(const mbase::string& in_string, inf_jinja_list& out_characters)
+{
+    for(SIZE_T i = 0; i < in_string.size();)
+    {
+        SIZE_T charLength = 1;
+        while(i + charLength < in_string.size() && (static_cast<unsigned char>(in_string[i + charLength]) & 0xC0) == 0x80)
+        {
+            ++charLength;
+        }
+        out_characters.push_back(inf_jinja_value::make_string(mbase::string(in_string.c_str() + i, charLength)));
+        i += charLength;
+    }
+}
+
+static mbase::string inf_jinja_float_repr(F64 in_value)
+{
+    if(std::isnan(in_value))
+    {
+        return "nan";
+    }
+    if(std::isinf(in_value))
+    {
+        return in_value > 0 ? "inf" : "-inf";
+    }
+    I8 floatBuffer[64];
+    // shortest round-trip form like python repr
+    for(I32 floatPrecision = 1; floatPrecision <= 17; floatPrecision++)
+    {
+        snprintf(floatBuffer, sizeof(floatBuffer), "%.*g", floatPrecision, in_value);
+        if(strtod(floatBuffer, NULL) == in_value)
+        {
+            break;
+        }
+    }
+    mbase::string outString = floatBuffer;
+    if(outString.find('.') == mbase::string::npos && outString.find('e') == mbase::string::npos && outString.find('n') == mbase::string::npos)
+    {
+        outString += ".0";
+    }
+    return outString;
+}
+
+static mbase::string inf_jinja_int_string(I64 in_value)
+{
+    I8 intBuffer[32];
+    snprintf(intBuffer, sizeof(intBuffer), "%lld", static_cast<long long>(in_value));
+    return intBuffer;
+}
+
+static GENERIC inf_jinja_repr(const inf_jinja_value& in_value, mbase::string& out_string);
+
+static GENERIC inf_jinja_to_string(const inf_jinja_value& in_value, mbase::string& out_string)
+{
+    switch (in_value.mKind)
+    {
+    case inf_jinja_value::kind::UNDEFINED:
+        break;
+    case inf_jinja_value::kind::NONE:
+        out_string += "None";
+        break;
+    case inf_jinja_value::kind::BOOL:
+        out_string += in_value.mBool ? "True" : "False";
+        break;
+    case inf_jinja_value::kind::INT:
+        out_string += inf_jinja_int_string(in_value.mInt);
+        break;
+    case inf_jinja_value::kind::FLOAT:
+        out_string += inf_jinja_float_repr(in_value.mFloat);
+        break;
+    case inf_jinja_value::kind::STRING:
+        out_string += in_value.mString;
+        break;
+    case inf_jinja_value::kind::LIST:
+        out_string += "[";
+        for(SIZE_T i = 0; i < in_value.mList->size(); i++)
+        {
+            if(i)
+            {
+                out_string += ", ";
+            }
+            inf_jinja_repr((*in_value.mList)[i], out_string);
+        }
+        out_string += "]";
+        break;
+    case inf_jinja_value::kind::MAP:
+        out_string += "{";
+        for(SIZE_T i = 0; i < in_value.mMap->mEntries.size(); i++)
+        {
+            if(i)
+            {
+                out_string += ", ";
+            }
+            inf_jinja_repr(inf_jinja_value::make_string(in_value.mMap->mEntries[i].first), out_string);
+            out_string += ": ";
+            inf_jinja_repr(in_value.mMap->mEntries[i].second, out_string);
+        }
+        out_string += "}";
+        break;
+    }
+}
+
+static GENERIC inf_jinja_repr(const inf_jinja_value& in_value, mbase::string& out_string)
+{
+    if(in_value.mKind != inf_jinja_value::kind::STRING)
+    {
+        inf_jinja_to_string(in_value, out_string);
+        return;
+    }
+    out_string += "'";
+    for(const I8& tmpChar : in_value.mString)
+    {
+        switch (tmpChar)
+        {
+        case '\'':
+            out_string += "\\'";
+            break;
+        case '\\':
+            out_string += "\\\\";
+            break;
+        case '\n':
+            out_string += "\\n";
+            break;
+        case '\t':
+            out_string += "\\t";
+            break;
+        case '\r':
+            out_string += "\\r";
+            break;
+        default:
+            out_string.push_back(tmpChar);
+            break;
+        }
+    }
+    out_string += "'";
+}
+
+static mbase::string inf_jinja_to_string(const inf_jinja_value& in_value)
+{
+    if(in_value.mKind == inf_jinja_value::kind::STRING)
+    {
+        return in_value.mString;
+    }
+    mbase::string outString;
+    inf_jinja_to_string(in_value, outString);
+    return outString;
+}
+
+static GENERIC inf_jinja_json_string(const mbase::string& in_string, mbase::string& out_string)
+{
+    out_string += "\"";
+    for(const I8& tmpChar : in_string)
+    {
+        switch (tmpChar)
+        {
+        case '"':
+            out_string += "\\\"";
+            break;
+        case '\\':
+            out_string += "\\\\";
+            break;
+        case '\n':
+            out_string += "\\n";
+            break;
+        case '\r':
+            out_string += "\\r";
+            break;
+        case '\t':
+            out_string += "\\t";
+            break;
+        case '\b':
+            out_string += "\\b";
+            break;
+        case '\f':
+            out_string += "\\f";
+            break;
+        default:
+            if(static_cast<unsigned char>(tmpChar) < 0x20)
+            {
+                I8 escapeBuffer[8];
+                snprintf(escapeBuffer, sizeof(escapeBuffer), "\\u%04x", static_cast<unsigned char>(tmpChar));
+                out_string += escapeBuffer;
+            }
+            else
+            {
+                out_string.push_back(tmpChar); // no ascii escaping, like transformers
+            }
+            break;
+        }
+    }
+    out_string += "\"";
+}
+
+static GENERIC inf_jinja_to_json(const inf_jinja_value& in_value, I32 in_indent, I32 in_level, mbase::string& out_string)
+{
+    auto newLine = [&](I32 in_lineLevel) {
+        out_string += "\n";
+        out_string.append(static_cast<SIZE_T>(in_indent * in_lineLevel), ' ');
+    };
+
+    switch (in_value.mKind)
+    {
+    case inf_jinja_value::kind::UNDEFINED:
+    case inf_jinja_value::kind::NONE:
+        out_string += "null";
+        break;
+    case inf_jinja_value::kind::BOOL:
+        out_string += in_value.mBool ? "true" : "false";
+        break;
+    case inf_jinja_value::kind::INT:
+        out_string += inf_jinja_int_string(in_value.mInt);
+        break;
+    case inf_jinja_value::kind::FLOAT:
+        out_string += inf_jinja_float_repr(in_value.mFloat);
+        break;
+    case inf_jinja_value::kind::STRING:
+        inf_jinja_json_string(in_value.mString, out_string);
+        break;
+    case inf_jinja_value::kind::LIST:
+        if(in_value.mList->empty())
+        {
+            out_string += "[]";
+            break;
+        }
+        out_string += "[";
+        for(SIZE_T i = 0; i < in_value.mList->size(); i++)
+        {
+            out_string += i ? (in_indent >= 0 ? "," : ", ") : "";
+            if(in_indent >= 0)
+            {
+                newLine(in_level + 1);
+            }
+            inf_jinja_to_json((*in_value.mList)[i], in_indent, in_level + 1, out_string);
+        }
+        if(in_indent >= 0)
+        {
+            newLine(in_level);
+        }
+        out_string += "]";
+        break;
+    case inf_jinja_value::kind::MAP:
+        if(in_value.mMap->mEntries.empty())
+        {
+            out_string += "{}";
+            break;
+        }
+        out_string += "{";
+        for(SIZE_T i = 0; i < in_value.mMap->mEntries.size(); i++)
+        {
+            out_string += i ? (in_indent >= 0 ? "," : ", ") : "";
+            if(in_indent >= 0)
+            {
+                newLine(in_level + 1);
+            }
+            inf_jinja_json_string(in_value.mMap->mEntries[i].first, out_string);
+            out_string += ": ";
+            inf_jinja_to_json(in_value.mMap->mEntries[i].second, in_indent, in_level + 1, out_string);
+        }
+        if(in_indent >= 0)
+        {
+            newLine(in_level);
+        }
+        out_string += "}";
+        break;
+    }
+}
+
+static bool inf_jinja_is_true(const inf_jinja_value& in_value)
+{
+    switch (in_value.mKind)
+    {
+    case inf_jinja_value::kind::BOOL:
+        return in_value.mBool;
+    case inf_jinja_value::kind::INT:
+        return in_value.mInt != 0;
+    case inf_jinja_value::kind::FLOAT:
+        return in_value.mFloat != 0.0;
+    case inf_jinja_value::kind::STRING:
+        return !in_value.mString.empty();
+    case inf_jinja_value::kind::LIST:
+        return !in_value.mList->empty();
+    case inf_jinja_value::kind::MAP:
+        return !in_value.mMap->mEntries.empty();
+    default:
+        return false;
+    }
+}
+
+static bool inf_jinja_equals(const inf_jinja_value& in_lhs, const inf_jinja_value& in_rhs)
+{
+    if(in_lhs.is_number() && in_rhs.is_number())
+    {
+        if(in_lhs.is_integral() && in_rhs.is_integral())
+        {
+            return in_lhs.as_int() == in_rhs.as_int();
+        }
+        return in_lhs.as_float() == in_rhs.as_float();
+    }
+    if(in_lhs.mKind != in_rhs.mKind)
+    {
+        return false;
+    }
+    switch (in_lhs.mKind)
+    {
+    case inf_jinja_value::kind::STRING:
+        return in_lhs.mString == in_rhs.mString;
+    case inf_jinja_value::kind::LIST:
+        if(in_lhs.mList->size() != in_rhs.mList->size())
+        {
+            return false;
+        }
+        for(SIZE_T i = 0; i < in_lhs.mList->size(); i++)
+        {
+            if(!inf_jinja_equals((*in_lhs.mList)[i], (*in_rhs.mList)[i]))
+            {
+                return false;
+            }
+        }
+        return true;
+    case inf_jinja_value::kind::MAP:
+        if(in_lhs.mMap->mEntries.size() != in_rhs.mMap->mEntries.size())
+        {
+            return false;
+        }
+        for(const std::pair<mbase::string, inf_jinja_value>& tmpEntry : in_lhs.mMap->mEntries)
+        {
+            const inf_jinja_value* rhsValue = in_rhs.mMap->find(tmpEntry.first);
+            if(!rhsValue || !inf_jinja_equals(tmpEntry.second, *rhsValue))
+            {
+                return false;
+            }
+        }
+        return true;
+    default:
+        return true; // both none or both undefined
+    }
+}
+
+static bool inf_jinja_contains(const inf_jinja_value& in_container, const inf_jinja_value& in_value)
+{
+    switch (in_container.mKind)
+    {
+    case inf_jinja_value::kind::STRING:
+        return in_value.mKind == inf_jinja_value::kind::STRING && in_container.mString.find(in_value.mString) != mbase::string::npos;
+    case inf_jinja_value::kind::LIST:
+        for(const inf_jinja_value& tmpValue : *in_container.mList)
+        {
+            if(inf_jinja_equals(tmpValue, in_value))
+            {
+                return true;
+            }
+        }
+        return false;
+    case inf_jinja_value::kind::MAP:
+        return in_value.mKind == inf_jinja_value::kind::STRING && in_container.mMap->find(in_value.mString) != NULL;
+    default:
+        return false;
+    }
+}
+
+static bool inf_jinja_item(const inf_jinja_value& in_object, const inf_jinja_value& in_key, inf_jinja_value& out_value)
+{
+    out_value = inf_jinja_value();
+    if(in_object.mKind == inf_jinja_value::kind::MAP)
+    {
+        const inf_jinja_value* foundValue = in_key.mKind == inf_jinja_value::kind::STRING ? in_object.mMap->find(in_key.mString) : NULL;
+        if(foundValue)
+        {
+            out_value = *foundValue;
+        }
+        return true;
+    }
+
+    if(!in_key.is_integral() || (in_object.mKind != inf_jinja_value::kind::LIST && in_object.mKind != inf_jinja_value::kind::STRING))
+    {
+        return in_object.mKind == inf_jinja_value::kind::UNDEFINED || in_object.mKind == inf_jinja_value::kind::NONE ? false : true;
+    }
+
+    I64 itemCount = static_cast<I64>(in_object.mKind == inf_jinja_value::kind::LIST ? in_object.mList->size() : in_object.mString.size());
+    I64 itemIndex = in_key.as_int();
+    if(itemIndex < 0)
+    {
+        itemIndex += itemCount;
+    }
+    if(itemIndex < 0 || itemIndex >= itemCount)
+    {
+        return true;
+    }
+    if(in_object.mKind == inf_jinja_value::kind::LIST)
+    {
+        out_value = (*in_object.mList)[static_cast<SIZE_T>(itemIndex)];
+    }
+    else
+    {
+        out_value = inf_jinja_value::make_string(mbase::string(in_object.mString.c_str() + itemIndex, 1));
+    }
+    return true;
+}
+
+static bool inf_jinja_to_list(const inf_jinja_value& in_value, inf_jinja_value& out_list)
+{
+    switch (in_value.mKind)
+    {
+    case inf_jinja_value::kind::LIST:
+        out_list = in_value;
+        return true;
+    case inf_jinja_value::kind::MAP:
+        out_list = inf_jinja_value::make_list();
+        for(const std::pair<mbase::string, inf_jinja_value>& tmpEntry : in_value.mMap->mEntries)
+        {
+            out_list.mList->push_back(inf_jinja_value::make_string(tmpEntry.first));
+        }
+        return true;
+    case inf_jinja_value::kind::STRING:
+        out_list = inf_jinja_value::make_list();
+        inf_jinja_utf8_split(in_value.mString, *out_list.mList);
+        return true;
+    case inf_jinja_value::kind::UNDEFINED:
+    case inf_jinja_value::kind::NONE:
+        out_list = inf_jinja_value::make_list();
+        return true;
+    default:
+        return false;
+    }
+}
+
+/* ===== TEMPLATE SEGMENTS ===== */
+
+struct inf_jinja_segment {
+    enum class kind : U8 {
+        TEXT,
+        EXPRESSION,
+        STATEMENT
+    };
+
+    kind mKind;
+    mbase::string mText;
+};
+
+static SIZE_T inf_jinja_find_tag_end(const mbase::string& in_source, SIZE_T in_pos, I8 in_closing)
+{
+    I8 quoteChar = 0;
+    for(SIZE_T i = in_pos; i + 1 < in_source.size(); i++)
+    {
+        const I8 tmpChar = in_source[i];
+        if(quoteChar)
+        {
+            if(tmpChar == '\\')
+            {
+                ++i;
+            }
+            else if(tmpChar == quoteChar)
+            {
+                quoteChar = 0;
+            }
+        }
+        else if(tmpChar == '\'' || tmpChar == '"')
+        {
+            quoteChar = tmpChar;
+        }
+        else if(tmpChar == in_closing && in_source[i + 1] == '}')
+        {
+            return i;
+        }
+    }
+    return mbase::string::npos;
+}
+
+static bool inf_jinja_segment_source(const mbase::string& in_source, std::vector<inf_jinja_segment>& out_segments, mbase::string& out_error)
+{
+    SIZE_T sourceIndex = 0;
+    bool stripNextText = false; // '-' at the end of the previous tag
+    bool trimNextNewline = false; // trim_blocks after a statement or comment
+
+    while(sourceIndex <= in_source.size())
+    {
+        SIZE_T tagBegin = sourceIndex;
+        while((tagBegin = in_source.find('{', tagBegin)) != mbase::string::npos)
+        {
+            if(tagBegin + 1 < in_source.size() && (in_source[tagBegin + 1] == '{' || in_source[tagBegin + 1] == '%' || in_source[tagBegin + 1] == '#'))
+            {
+                break;
+            }
+            ++tagBegin;
+        }
+
+        mbase::string textPart = inf_jinja_substring(in_source, sourceIndex, tagBegin == mbase::string::npos ? mbase::string::npos : tagBegin - sourceIndex);
+        if(stripNextText)
+        {
+            textPart = inf_jinja_strip(textPart, true, false);
+        }
+        else if(trimNextNewline)
+        {
+            if(inf_jinja_has_prefix(textPart, "\n"))
+            {
+                textPart = inf_jinja_substring(textPart, 1);
+            }
+            else if(inf_jinja_has_prefix(textPart, "\r\n"))
+            {
+                textPart = inf_jinja_substring(textPart, 2);
+            }
+        }
+
+        if(tagBegin == mbase::string::npos)
+        {
+            if(!textPart.empty())
+            {
+                out_segments.push_back({inf_jinja_segment::kind::TEXT, textPart});
+            }
+            break;
+        }
+
+        const I8 tagKind = in_source[tagBegin + 1];
+        SIZE_T contentBegin = tagBegin + 2;
+        const bool stripBefore = contentBegin < in_source.size() && in_source[contentBegin] == '-';
+        const bool keepBefore = contentBegin < in_source.size() && in_source[contentBegin] == '+';
+        if(stripBefore || keepBefore)
+        {
+            ++contentBegin;
+        }
+
+        if(stripBefore)
+        {
+            textPart = inf_jinja_strip(textPart, false, true);
+        }
+        else if(tagKind != '{' && !keepBefore)
+        {
+            // lstrip_blocks, the whitespace between the line start and the block is dropped
+            SIZE_T lineStart = textPart.size();
+            while(lineStart && textPart[lineStart - 1] != '\n')
+            {
+                --lineStart;
+            }
+            bool isBlank = true;
+            for(SIZE_T i = lineStart; i < textPart.size() && isBlank; i++)
+            {
+                isBlank = textPart[i] == ' ' || textPart[i] == '\t';
+            }
+            if(isBlank && (lineStart || tagBegin == textPart.size() || sourceIndex == 0 || trimNextNewline || stripNextText))
+            {
+                textPart = inf_jinja_substring(textPart, 0, lineStart);
+            }
+        }
+
+        if(!textPart.empty())
+        {
+            out_segments.push_back({inf_jinja_segment::kind::TEXT, textPart});
+        }
+
+        SIZE_T tagEnd = mbase::string::npos;
+        if(tagKind == '#')
+        {
+            tagEnd = in_source.find("#}", contentBegin);
+        }
+        else
+        {
+            tagEnd = inf_jinja_find_tag_end(in_source, contentBegin, tagKind == '{' ? '}' : '%');
+        }
+
+        if(tagEnd == mbase::string::npos)
+        {
+            out_error = "unclosed tag";
+            return false;
+        }
+
+        SIZE_T contentEnd = tagEnd;
+        const bool stripAfter = contentEnd > contentBegin && in_source[contentEnd - 1] == '-';
+        if(stripAfter)
+        {
+            --contentEnd;
+        }
+
+        if(tagKind != '#')
+        {
+            out_segments.push_back({tagKind == '{' ? inf_jinja_segment::kind::EXPRESSION : inf_jinja_segment::kind::STATEMENT, inf_jinja_substring(in_source, contentBegin, contentEnd - contentBegin)});
+        }
+
+        stripNextText = stripAfter;
+        trimNextNewline = !stripAfter && tagKind != '{';
+        sourceIndex = tagEnd + 2;
+    }
+    return true;
+}
+
+/* ===== TAG TOKENIZER ===== */
+
+struct inf_jinja_token {
+    enum class kind : U8 {
+        NAME,
+        STRING,
+        INT,
+        FLOAT,
+        OPERATOR,
+        END
+    };
+
+    kind mKind = kind::END;
+    mbase::string mText;
+    I64 mInt = 0;
+    F64 mFloat = 0.0;
+};
+
+static bool inf_jinja_tokenize(const mbase::string& in_source, std::vector<inf_jinja_token>& out_tokens, mbase::string& out_error)
+{
+    static const MSTRING twoCharOperators[] = {"==", "!=", "<=", ">=", "//", "**"};
+    static const MSTRING singleCharOperators = "+-*/%~<>=()[]{}.,:|";
+
+    out_tokens.clear();
+    SIZE_T sourceIndex = 0;
+    while(sourceIndex < in_source.size())
+    {
+        const I8 tmpChar = in_source[sourceIndex];
+        inf_jinja_token newToken;
+        if(inf_jinja_is_space(tmpChar))
+        {
+            ++sourceIndex;
+            continue;
+        }
+
+        if(isalpha(static_cast<unsigned char>(tmpChar)) || tmpChar == '_')
+        {
+            SIZE_T nameEnd = sourceIndex;
+            while(nameEnd < in_source.size() && (isalnum(static_cast<unsigned char>(in_source[nameEnd])) || in_source[nameEnd] == '_'))
+            {
+                ++nameEnd;
+            }
+            newToken.mKind = inf_jinja_token::kind::NAME;
+            newToken.mText = inf_jinja_substring(in_source, sourceIndex, nameEnd - sourceIndex);
+            sourceIndex = nameEnd;
+        }
+        else if(isdigit(static_cast<unsigned char>(tmpChar)))
+        {
+            SIZE_T numberEnd = sourceIndex;
+            while(numberEnd < in_source.size() && isdigit(static_cast<unsigned char>(in_source[numberEnd])))
+            {
+                ++numberEnd;
+            }
+            bool isFloat = false;
+            if(numberEnd + 1 < in_source.size() && in_source[numberEnd] == '.' && isdigit(static_cast<unsigned char>(in_source[numberEnd + 1])))
+            {
+                isFloat = true;
+                ++numberEnd;
+                while(numberEnd < in_source.size() && isdigit(static_cast<unsigned char>(in_source[numberEnd])))
+                {
+                    ++numberEnd;
+                }
+            }
+            newToken.mText = inf_jinja_substring(in_source, sourceIndex, numberEnd - sourceIndex);
+            if(isFloat)
+            {
+                newToken.mKind = inf_jinja_token::kind::FLOAT;
+                newToken.mFloat = strtod(newToken.mText.c_str(), NULL);
+            }
+            else
+            {
+                newToken.mKind = inf_jinja_token::kind::INT;
+                newToken.mInt = strtoll(newToken.mText.c_str(), NULL, 10);
+            }
+            sourceIndex = numberEnd;
+        }
+        else if(tmpChar == '\'' || tmpChar == '"')
+        {
+            newToken.mKind = inf_jinja_token::kind::STRING;
+            SIZE_T stringIndex = sourceIndex + 1;
+            for(; stringIndex < in_source.size() && in_source[stringIndex] != tmpChar; stringIndex++)
+            {
+                I8 stringChar = in_source[stringIndex];
+                if(stringChar == '\\' && stringIndex + 1 < in_source.size())
+                {
+                    stringChar = in_source[++stringIndex];
+                    switch (stringChar)
+                    {
+                    case 'n':
+                        stringChar = '\n';
+                        break;
+                    case 't':
+                        stringChar = '\t';
+                        break;
+                    case 'r':
+                        stringChar = '\r';
+                        break;
+                    default:
+                        break;
+                    }
+                }
+                newToken.mText.push_back(stringChar);
+            }
+            if(stringIndex >= in_source.size())
+            {
+                out_error = "unterminated string literal";
+                return false;
+            }
+            sourceIndex = stringIndex + 1;
+        }
+        else
+        {
+            newToken.mKind = inf_jinja_token::kind::OPERATOR;
+            for(MSTRING tmpOperator : twoCharOperators)
+            {
+                if(sourceIndex + 1 < in_source.size() && tmpChar == tmpOperator[0] && in_source[sourceIndex + 1] == tmpOperator[1])
+                {
+                    newToken.mText = tmpOperator;
+                    break;
+                }
+            }
+            if(newToken.mText.empty())
+            {
+                if(!strchr(singleCharOperators, tmpChar))
+                {
+                    out_error = mbase::string("unexpected character '") + mbase::string(&tmpChar, 1) + "'";
+                    return false;
+                }
+                newToken.mText.push_back(tmpChar);
+            }
+            sourceIndex += newToken.mText.size();
+        }
+        out_tokens.push_back(newToken);
+    }
+    out_tokens.push_back(inf_jinja_token());
+    return true;
+}
+
+/* ===== COMPILER ===== */
+
+class inf_jinja_compiler {
+public:
+    inf_jinja_compiler(inf_jinja_program& in_program) : mProgram(in_program) {}
+
+    InfJinjaTemplate::flags compile(const std::vector<inf_jinja_segment>& in_segments, mbase::string& out_error)
+    {
+        mProgram.mLoopName = mProgram.intern("loop");
+        for(const inf_jinja_segment& tmpSegment : in_segments)
+        {
+            bool isCompiled = true;
+            if(tmpSegment.mKind == inf_jinja_segment::kind::TEXT)
+            {
+                mProgram.mTexts.push_back(tmpSegment.mText);
+                _emit(mProgram.mCode, inf_jinja_op::TEXT, static_cast<I32>(mProgram.mTexts.size() - 1));
+                continue;
+            }
+
+            if(!inf_jinja_tokenize(tmpSegment.mText, mTokens, mError))
+            {
+                out_error = mError;
+                return InfJinjaTemplate::flags::INF_JINJA_ERR_SYNTAX;
+            }
+            mTokenIndex = 0;
+
+            if(tmpSegment.mKind == inf_jinja_segment::kind::EXPRESSION)
+            {
+                isCompiled = _parse_expression(mProgram.mCode) && _expect_end();
+                _emit(mProgram.mCode, inf_jinja_op::EMIT);
+            }
+            else
+            {
+                isCompiled = _compile_statement();
+            }
+
+            if(!isCompiled)
+            {
+                out_error = mError + " in '" + inf_jinja_strip(tmpSegment.mText, true, true) + "'";
+                return mErrorFlag;
+            }
+        }
+
+        if(!mBlocks.empty())
+        {
+            out_error = mBlocks.back().mIsLoop ? "missing endfor" : "missing endif";
+            return InfJinjaTemplate::flags::INF_JINJA_ERR_SYNTAX;
+        }
+        return InfJinjaTemplate::flags::INF_JINJA_SUCCESS;
+    }
+
+private:
+    struct inf_jinja_block {
+        bool mIsLoop = false;
+        bool mHasElse = false;
+        I32 mPendingJump = -1; // the false jump of the current if/elif branch
+        I32 mLoopBegin = -1;
+        I32 mBodyStart = 0;
+        std::vector<I32> mEndJumps;
+        std::vector<I32> mContinueJumps;
+        std::vector<I32> mBreakJumps;
+    };
+
+    /* ===== TOKEN HELPERS ===== */
+
+    const inf_jinja_token& _current() const { return mTokens[mTokenIndex]; }
+    const inf_jinja_token& _peek() const { return mTokens[std::min(mTokenIndex + 1, mTokens.size() - 1)]; }
+    GENERIC _advance() { if(mTokenIndex + 1 < mTokens.size()) { ++mTokenIndex; } }
+
+    bool _is_operator(MSTRING in_operator) const
+    {
+        return _current().mKind == inf_jinja_token::kind::OPERATOR && _current().mText == in_operator;
+    }
+
+    bool _is_keyword(MSTRING in_keyword) const
+    {
+        return _current().mKind == inf_jinja_token::kind::NAME && _current().mText == in_keyword;
+    }
+
+    bool _accept_operator(MSTRING in_operator)
+    {
+        if(_is_operator(in_operator))
+        {
+            _advance();
+            return true;
+        }
+        return false;
+    }
+
+    bool _accept_keyword(MSTRING in_keyword)
+    {
+        if(_is_keyword(in_keyword))
+        {
+            _advance();
+            return true;
+        }
+        return false;
+    }
+
+    bool _fail(InfJinjaTemplate::flags in_flag, const mbase::string& in_error)
+    {
+        mErrorFlag = in_flag;
+        mError = in_error;
+        return false;
+    }
+
+    bool _expect_operator(MSTRING in_operator)
+    {
+        if(_accept_operator(in_operator))
+        {
+            return true;
+        }
+        return _fail(InfJinjaTemplate::flags::INF_JINJA_ERR_SYNTAX, mbase::string("expected '") + in_operator + "'");
+    }
+
+    bool _expect_name(mbase::string& out_name)
+    {
+        if(_current().mKind != inf_jinja_token::kind::NAME)
+        {
+            return _fail(InfJinjaTemplate::flags::INF_JINJA_ERR_SYNTAX, "expected a name");
+        }
+        out_name = _current().mText;
+        _advance();
+        return true;
+    }
+
+    bool _expect_end()
+    {
+        if(_current().mKind == inf_jinja_token::kind::END)
+        {
+            return true;
+        }
+        return _fail(InfJinjaTemplate::flags::INF_JINJA_ERR_SYNTAX, "unexpected '" + _current().mText + "'");
+    }
+
+    static I32 _emit(inf_jinja_code& out_code, inf_jinja_op in_op, I32 in_a = 0, I32 in_b = 0, I32 in_c = 0)
+    {
+        inf_jinja_instruction newInstruction;
+        newInstruction.mOp = in_op;
+        newInstruction.mA = in_a;
+        newInstruction.mB = in_b;
+        newInstruction.mC = in_c;
+        out_code.push_back(newInstruction);
+        return static_cast<I32>(out_code.size() - 1);
+    }
+
+    static GENERIC _append(inf_jinja_code& out_code, const inf_jinja_code& in_code)
+    {
+        out_code.insert(out_code.end(), in_code.begin(), in_code.end());
+    }
+
+    GENERIC _patch(I32 in_instruction, I32 in_target)
+    {
+        mProgram.mCode[in_instruction].mA = in_target - (in_instruction + 1);
+    }
+
+    I32 _here() const { return static_cast<I32>(mProgram.mCode.size()); }
+
+    I32 _constant(const inf_jinja_value& in_value)
+    {
+        mProgram.mConstants.push_back(in_value);
+        return static_cast<I32>(mProgram.mConstants.size() - 1);
+    }
+
+    /* ===== EXPRESSIONS ===== */
+
+    bool _parse_expression(inf_jinja_code& out_code)
+    {
+        inf_jinja_code valueCode;
+        if(!_parse_or(valueCode))
+        {
+            return false;
+        }
+        if(!_accept_keyword("if"))
+        {
+            _append(out_code, valueCode);
+            return true;
+        }
+
+        inf_jinja_code conditionCode;
+        inf_jinja_code elseCode;
+        if(!_parse_or(conditionCode))
+        {
+            return false;
+        }
+        if(_accept_keyword("else"))
+        {
+            if(!_parse_expression(elseCode))
+            {
+                return false;
+            }
+        }
+        else
+        {
+            _emit(elseCode, inf_jinja_op::CONST, _constant(inf_jinja_value()));
+        }
+
+        _append(out_code, conditionCode);
+        _emit(out_code, inf_jinja_op::JUMP_FALSE, static_cast<I32>(valueCode.size() + 1));
+        _append(out_code, valueCode);
+        _emit(out_code, inf_jinja_op::JUMP, static_cast<I32>(elseCode.size()));
+        _append(out_code, elseCode);
+        return true;
+    }
+
+    bool _parse_or(inf_jinja_code& out_code)
+    {
+        if(!_parse_and(out_code))
+        {
+            return false;
+        }
+        while(_accept_keyword("or"))
+        {
+            inf_jinja_code rhsCode;
+            if(!_parse_and(rhsCode))
+            {
+                return false;
+            }
+            _emit(out_code, inf_jinja_op::JUMP_TRUE_KEEP, static_cast<I32>(rhsCode.size()));
+            _append(out_code, rhsCode);
+        }
+        return true;
+    }
+
+    bool _parse_and(inf_jinja_code& out_code)
+    {
+        if(!_parse_not(out_code))
+        {
+            return false;
+        }
+        while(_accept_keyword("and"))
+        {
+            inf_jinja_code rhsCode;
+            if(!_parse_not(rhsCode))
+            {
+                return false;
+            }
+            _emit(out_code, inf_jinja_op::JUMP_FALSE_KEEP, static_cast<I32>(rhsCode.size()));
+            _append(out_code, rhsCode);
+        }
+        return true;
+    }
+
+    bool _parse_not(inf_jinja_code& out_code)
+    {
+        if(_accept_keyword("not"))
+        {
+            if(!_parse_not(out_code))
+            {
+                return false;
+            }
+            _emit(out_code, inf_jinja_op::NOT);
+            return true;
+        }
+        return _parse_compare(out_code);
+    }
+
+    bool _parse_compare(inf_jinja_code& out_code)
+    {
+        static const std::pair<MSTRING, inf_jinja_binary> compareOperators[] = {
+            {"==", inf_jinja_binary::EQUAL},
+            {"!=", inf_jinja_binary::NOT_EQUAL},
+            {"<=", inf_jinja_binary::LESS_EQUAL},
+            {">=", inf_jinja_binary::GREATER_EQUAL},
+            {"<", inf_jinja_binary::LESS},
+            {">", inf_jinja_binary::GREATER}
+        };
+
+        if(!_parse_math1(out_code))
+        {
+            return false;
+        }
+        while(true)
+        {
+            I32 binaryOperator = -1;
+            for(const std::pair<MSTRING, inf_jinja_binary>& tmpOperator : compareOperators)
+            {
+                if(_accept_operator(tmpOperator.first))
+                {
+                    binaryOperator = static_cast<I32>(tmpOperator.second);
+                    break;
+                }
+            }
+            if(binaryOperator == -1)
+            {
+                if(_accept_keyword("in"))
+                {
+                    binaryOperator = static_cast<I32>(inf_jinja_binary::CONTAINS);
+                }
+                else if(_is_keyword("not") && _peek().mKind == inf_jinja_token::kind::NAME && _peek().mText == "in")
+                {
+                    _advance();
+                    _advance();
+                    binaryOperator = static_cast<I32>(inf_jinja_binary::NOT_CONTAINS);
+                }
+                else
+                {
+                    return true;
+                }
+            }
+            if(!_parse_math1(out_code))
+            {
+                return false;
+            }
+            _emit(out_code, inf_jinja_op::BINARY, binaryOperator);
+        }
+    }
+
+    bool _parse_math1(inf_jinja_code& out_code)
+    {
+        if(!_parse_concat(out_code))
+        {
+            return false;
+        }
+        while(_is_operator("+") || _is_operator("-"))
+        {
+            inf_jinja_binary binaryOperator = _is_operator("+") ? inf_jinja_binary::ADD : inf_jinja_binary::SUBTRACT;
+            _advance();
+            if(!_parse_concat(out_code))
+            {
+                return false;
+            }
+            _emit(out_code, inf_jinja_op::BINARY, static_cast<I32>(binaryOperator));
+        }
+        return true;
+    }
+
+    bool _parse_concat(inf_jinja_code& out_code)
+    {
+        if(!_parse_math2(out_code))
+        {
+            return false;
+        }
+        while(_accept_operator("~"))
+        {
+            if(!_parse_math2(out_code))
+            {
+                return false;
+            }
+            _emit(out_code, inf_jinja_op::BINARY, static_cast<I32>(inf_jinja_binary::CONCAT));
+        }
+        return true;
+    }
+
+    bool _parse_math2(inf_jinja_code& out_code)
+    {
+        static const std::pair<MSTRING, inf_jinja_binary> mathOperators[] = {
+            {"//", inf_jinja_binary::FLOOR_DIVIDE},
+            {"*", inf_jinja_binary::MULTIPLY},
+            {"/", inf_jinja_binary::DIVIDE},
+            {"%", inf_jinja_binary::MODULO}
+        };
+
+        if(!_parse_unary(out_code))
+        {
+            return false;
+        }
+        while(true)
+        {
+            I32 binaryOperator = -1;
+            for(const std::pair<MSTRING, inf_jinja_binary>& tmpOperator : mathOperators)
+            {
+                if(_accept_operator(tmpOperator.first))
+                {
+                    binaryOperator = static_cast<I32>(tmpOperator.second);
+                    break;
+                }
+            }
+            if(binaryOperator == -1)
+            {
+                return true;
+            }
+            if(!_parse_unary(out_code))
+            {
+                return false;
+            }
+            _emit(out_code, inf_jinja_op::BINARY, binaryOperator);
+        }
+    }
+
+    bool _parse_unary(inf_jinja_code& out_code)
+    {
+        if(_is_operator("-") || _is_operator("+"))
+        {
+            const bool isNegated = _is_operator("-");
+            _advance();
+            if(!_parse_unary(out_code))
+            {
+                return false;
+            }
+            if(isNegated)
+            {
+                _emit(out_code, inf_jinja_op::NEGATE);
+            }
+            return true;
+        }
+        return _parse_primary(out_code) && _parse_postfix(out_code) && _parse_filters(out_code);
+    }
+
+    bool _parse_arguments(inf_jinja_code& out_code, I32& out_count, I32& out_keywords)
+    {
+        std::vector<I32> keywordNames;
+        out_count = 0;
+        if(!_expect_operator("("))
+        {
+            return false;
+        }
+        while(!_is_operator(")"))
+        {
+            if(_current().mKind == inf_jinja_token::kind::NAME && _peek().mKind == inf_jinja_token::kind::OPERATOR && _peek().mText == "=")
+            {
+                keywordNames.push_back(mProgram.intern(_current().mText));
+                _advance();
+                _advance();
+            }
+            else if(!keywordNames.empty())
+            {
+                return _fail(InfJinjaTemplate::flags::INF_JINJA_ERR_SYNTAX, "positional argument after keyword argument");
+            }
+
+            if(!_parse_expression(out_code))
+            {
+                return false;
+            }
+            ++out_count;
+            if(!_accept_operator(","))
+            {
+                break;
+            }
+        }
+        if(!_expect_operator(")"))
+        {
+            return false;
+        }
+
+        out_keywords = -1;
+        if(!keywordNames.empty())
+        {
+            mProgram.mKeywordLists.push_back(keywordNames);
+            out_keywords = static_cast<I32>(mProgram.mKeywordLists.size() - 1);
+        }
+        return true;
+    }
+
+    bool _parse_sequence(inf_jinja_code& out_code, MSTRING in_closing, I32& out_count)
+    {
+        out_count = 0;
+        while(!_is_operator(in_closing))
+        {
+            if(!_parse_expression(out_code))
+            {
+                return false;
+            }
+            ++out_count;
+            if(!_accept_operator(","))
+            {
+                break;
+            }
+        }
+        return _expect_operator(in_closing);
+    }
+
+    bool _parse_primary(inf_jinja_code& out_code)
+    {
+        const inf_jinja_token& currentToken = _current();
+        switch (currentToken.mKind)
+        {
+        case inf_jinja_token::kind::STRING:
+        {
+            mbase::string literalString;
+            while(_current().mKind == inf_jinja_token::kind::STRING)
+            {
+                literalString += _current().mText;
+                _advance();
+            }
+            _emit(out_code, inf_jinja_op::CONST, _constant(inf_jinja_value::make_string(literalString)));
+            return true;
+        }
+        case inf_jinja_token::kind::INT:
+            _emit(out_code, inf_jinja_op::CONST, _constant(inf_jinja_value::make_int(currentToken.mInt)));
+            _advance();
+            return true;
+        case inf_jinja_token::kind::FLOAT:
+            _emit(out_code, inf_jinja_op::CONST, _constant(inf_jinja_value::make_float(currentToken.mFloat)));
+            _advance();
+            return true;
+        case inf_jinja_token::kind::NAME:
+        {
+            const mbase::string nameText = currentToken.mText;
+            _advance();
+            if(nameText == "true" || nameText == "True" || nameText == "false" || nameText == "False")
+            {
+                _emit(out_code, inf_jinja_op::CONST, _constant(inf_jinja_value::make_bool(nameText[0] == 't' || nameText[0] == 'T')));
+                return true;
+            }
+            if(nameText == "none" || nameText == "None")
+            {
+                _emit(out_code, inf_jinja_op::CONST, _constant(inf_jinja_value::make_none()));
+                return true;
+            }
+            if(_is_operator("("))
+            {
+                I32 functionId = inf_jinja_find_builtin(gInfJinjaFunctions, nameText);
+                if(functionId == -1)
+                {
+                    return _fail(InfJinjaTemplate::flags::INF_JINJA_ERR_UNSUPPORTED, "unsupported function '" + nameText + "'");
+                }
+                I32 argumentCount = 0;
+                I32 keywordList = -1;
+                if(!_parse_arguments(out_code, argumentCount, keywordList))
+                {
+                    return false;
+                }
+                _emit(out_code, inf_jinja_op::CALL, functionId, argumentCount, keywordList);
+                return true;
+            }
+            _emit(out_code, inf_jinja_op::LOAD, mProgram.intern(nameText));
+            return true;
+        }
+        case inf_jinja_token::kind::OPERATOR:
+        {
+            I32 itemCount = 0;
+            if(_accept_operator("("))
+            {
+                if(!_parse_expression(out_code))
+                {
+                    return false;
+                }
+                if(_accept_operator(","))
+                {
+                    // tuple, behaves like a list
+                    if(!_parse_sequence(out_code, ")", itemCount))
+                    {
+                        return false;
+                    }
+                    _emit(out_code, inf_jinja_op::BUILD_LIST, itemCount + 1);
+                    return true;
+                }
+                return _expect_operator(")");
+            }
+            if(_accept_operator("["))
+            {
+                if(!_parse_sequence(out_code, "]", itemCount))
+                {
+                    return false;
+                }
+                _emit(out_code, inf_jinja_op::BUILD_LIST, itemCount);
+                return true;
+            }
+            if(_accept_operator("{"))
+            {
+                while(!_is_operator("}"))
+                {
+                    if(!_parse_expression(out_code) || !_expect_operator(":") || !_parse_expression(out_code))
+                    {
+                        return false;
+                    }
+                    ++itemCount;
+                    if(!_accept_operator(","))
+                    {
+                        break;
+                    }
+                }
+                if(!_expect_operator("}"))
+                {
+                    return false;
+                }
+                _emit(out_code, inf_jinja_op::BUILD_DICT, itemCount);
+                return true;
+            }
+            if(_is_operator("**"))
+            {
+                return _fail(InfJinjaTemplate::flags::INF_JINJA_ERR_UNSUPPORTED, "unsupported operator '**'");
+            }
+            return _fail(InfJinjaTemplate::flags::INF_JINJA_ERR_SYNTAX, "unexpected '" + currentToken.mText + "'");
+        }
+        default:
+            return _fail(InfJinjaTemplate::flags::INF_JINJA_ERR_SYNTAX, "unexpected end of expression");
+        }
+    }
+
+    bool _parse_postfix(inf_jinja_code& out_code)
+    {
+        while(true)
+        {
+            if(_accept_operator("."))
+            {
+                mbase::string attributeName;
+                if(!_expect_name(attributeName))
+                {
+                    return false;
+                }
+                if(_is_operator("("))
+                {
+                    I32 methodId = inf_jinja_find_builtin(gInfJinjaMethods, attributeName);
+                    if(methodId == -1)
+                    {
+                        return _fail(InfJinjaTemplate::flags::INF_JINJA_ERR_UNSUPPORTED, "unsupported method '" + attributeName + "'");
+                    }
+                    I32 argumentCount = 0;
+                    I32 keywordList = -1;
+                    if(!_parse_arguments(out_code, argumentCount, keywordList))
+                    {
+                        return false;
+                    }
+                    _emit(out_code, inf_jinja_op::CALL_METHOD, methodId, argumentCount, keywordList);
+                }
+                else
+                {
+                    _emit(out_code, inf_jinja_op::GET_ATTR, mProgram.intern(attributeName));
+                }
+            }
+            else if(_accept_operator("["))
+            {
+                I32 sliceMask = 0;
+                bool isSlice = false;
+                if(!_is_operator(":"))
+                {
+                    if(!_parse_expression(out_code))
+                    {
+                        return false;
+                    }
+                    sliceMask |= 1;
+                }
+                if(_accept_operator(":"))
+                {
+                    isSlice = true;
+                    if(!_is_operator("]") && !_is_operator(":"))
+                    {
+                        if(!_parse_expression(out_code))
+                        {
+                            return false;
+                        }
+                        sliceMask |= 2;
+                    }
+                    if(_accept_operator(":") && !_is_operator("]"))
+                    {
+                        if(!_parse_expression(out_code))
+                        {
+                            return false;
+                        }
+                        sliceMask |= 4;
+                    }
+                }
+                if(!_expect_operator("]"))
+                {
+                    return false;
+                }
+                if(isSlice)
+                {
+                    _emit(out_code, inf_jinja_op::SLICE, sliceMask);
+                }
+                else
+                {
+                    _emit(out_code, inf_jinja_op::GET_ITEM);
+                }
+            }
+            else
+            {
+                return true;
+            }
+        }
+    }
+
+    bool _parse_filters(inf_jinja_code& out_code)
+    {
+        while(true)
+        {
+            if(_accept_operator("|"))
+            {
+                mbase::string filterName;
+                if(!_expect_name(filterName))
+                {
+                    return false;
+                }
+                I32 filterId = inf_jinja_find_builtin(gInfJinjaFilters, filterName);
+                if(filterId == -1)
+                {
+                    return _fail(InfJinjaTemplate::flags::INF_JINJA_ERR_UNSUPPORTED, "unsupported filter '" + filterName + "'");
+                }
+                I32 argumentCount = 0;
+                I32 keywordList = -1;
+                if(_is_operator("(") && !_parse_arguments(out_code, argumentCount, keywordList))
+                {
+                    return false;
+                }
+                _emit(out_code, inf_jinja_op::FILTER, filterId, argumentCount, keywordList);
+            }
+            else if(_accept_keyword("is"))
+            {
+                const bool isNegated = _accept_keyword("not");
+                mbase::string testName;
+                if(_current().mKind == inf_jinja_token::kind::OPERATOR && (_is_operator("==") || _is_operator("!=")))
+                {
+                    testName = _current().mText;
+                    _advance();
+                }
+                else if(!_expect_name(testName))
+                {
+                    return false;
+                }
+                I32 testId = inf_jinja_find_builtin(gInfJinjaTests, testName);
+                if(testId == -1)
+                {
+                    return _fail(InfJinjaTemplate::flags::INF_JINJA_ERR_UNSUPPORTED, "unsupported test '" + testName + "'");
+                }
+
+                I32 argumentCount = 0;
+                I32 keywordList = -1;
+                if(_is_operator("("))
+                {
+                    if(!_parse_arguments(out_code, argumentCount, keywordList))
+                    {
+                        return false;
+                    }
+                }
+                else if(_current().mKind == inf_jinja_token::kind::STRING || _current().mKind == inf_jinja_token::kind::INT ||
+                    _current().mKind == inf_jinja_token::kind::FLOAT || (_current().mKind == inf_jinja_token::kind::NAME && !_is_keyword("and") &&
+                    !_is_keyword("or") && !_is_keyword("if") && !_is_keyword("else") && !_is_keyword("in") && !_is_keyword("not") && !_is_keyword("is")))
+                {
+                    // 'is equalto x' form
+                    if(!_parse_primary(out_code) || !_parse_postfix(out_code))
+                    {
+                        return false;
+                    }
+                    argumentCount = 1;
+                }
+                _emit(out_code, inf_jinja_op::TEST, testId, argumentCount, isNegated);
+            }
+            else
+            {
+                return true;
+            }
+        }
+    }
+
+    /* ===== STATEMENTS ===== */
+
+    inf_jinja_block* _innermost_loop()
+    {
+        for(std::vector<inf_jinja_block>::reverse_iterator It = mBlocks.rbegin(); It != mBlocks.rend(); ++It)
+        {
+            if(It->mIsLoop)
+            {
+                return &*It;
+            }
+        }
+        return NULL;
+    }
+
+    GENERIC _patch_all(const std::vector<I32>& in_jumps, I32 in_target)
+    {
+        for(const I32& tmpJump : in_jumps)
+        {
+            _patch(tmpJump, in_target);
+        }
+    }
+
+    bool _compile_statement()
+    {
+        mbase::string statementName;
+        if(!_expect_name(statementName))
+        {
+            return false;
+        }
+
+        inf_jinja_code& programCode = mProgram.mCode;
+        if(statementName == "if")
+        {
+            inf_jinja_block newBlock;
+            if(!_parse_expression(programCode) || !_expect_end())
+            {
+                return false;
+            }
+            newBlock.mPendingJump = _emit(programCode, inf_jinja_op::JUMP_FALSE);
+            mBlocks.push_back(newBlock);
+            return true;
+        }
+
+        if(statementName == "elif" || statementName == "else" || statementName == "endif")
+        {
+            if(mBlocks.empty() || (mBlocks.back().mIsLoop && statementName != "else") || (mBlocks.back().mHasElse && statementName != "endif"))
+            {
+                return _fail(InfJinjaTemplate::flags::INF_JINJA_ERR_SYNTAX, "unexpected " + statementName);
+            }
+            inf_jinja_block& activeBlock = mBlocks.back();
+            if(activeBlock.mIsLoop)
+            {
+                // for-else, rendered when the loop had nothing to iterate
+                if(!_expect_end())
+                {
+                    return false;
+                }
+                I32 loopNext = _emit(programCode, inf_jinja_op::FOR_NEXT, activeBlock.mBodyStart - (_here() + 1));
+                _patch_all(activeBlock.mContinueJumps, loopNext);
+                activeBlock.mEndJumps.push_back(_emit(programCode, inf_jinja_op::JUMP));
+                _patch(activeBlock.mLoopBegin, _here());
+                activeBlock.mHasElse = true;
+                return true;
+            }
+
+            if(statementName == "endif")
+            {
+                if(!_expect_end())
+                {
+                    return false;
+                }
+                if(activeBlock.mPendingJump != -1)
+                {
+                    _patch(activeBlock.mPendingJump, _here());
+                }
+                _patch_all(activeBlock.mEndJumps, _here());
+                mBlocks.pop_back();
+                return true;
+            }
+
+            activeBlock.mEndJumps.push_back(_emit(programCode, inf_jinja_op::JUMP));
+            _patch(activeBlock.mPendingJump, _here());
+            activeBlock.mPendingJump = -1;
+            if(statementName == "else")
+            {
+                activeBlock.mHasElse = true;
+                return _expect_end();
+            }
+            if(!_parse_expression(programCode) || !_expect_end())
+            {
+                return false;
+            }
+            activeBlock.mPendingJump = _emit(programCode, inf_jinja_op::JUMP_FALSE);
+            return true;
+        }
+
+        if(statementName == "for")
+        {
+            mbase::string loopVariable;
+            mbase::string secondVariable;
+            if(!_expect_name(loopVariable))
+            {
+                return false;
+            }
+            if(_accept_operator(",") && !_expect_name(secondVariable))
+            {
+                return false;
+            }
+            if(_is_operator(","))
+            {
+                return _fail(InfJinjaTemplate::flags::INF_JINJA_ERR_UNSUPPORTED, "unpacking more than two loop variables");
+            }
+            if(!_accept_keyword("in"))
+            {
+                return _fail(InfJinjaTemplate::flags::INF_JINJA_ERR_SYNTAX, "expected 'in'");
+            }
+            // no conditional expression here, 'for x in y if z' is a loop filter
+            if(!_parse_or(programCode))
+            {
+                return false;
+            }
+            if(_is_keyword("if") || _is_keyword("recursive"))
+            {
+                return _fail(InfJinjaTemplate::flags::INF_JINJA_ERR_UNSUPPORTED, "loop filters and recursive loops");
+            }
+            if(!_expect_end())
+            {
+                return false;
+            }
+
+            inf_jinja_block newBlock;
+            newBlock.mIsLoop = true;
+            newBlock.mLoopBegin = _emit(programCode, inf_jinja_op::FOR_BEGIN, 0, mProgram.intern(loopVariable), secondVariable.empty() ? -1 : mProgram.intern(secondVariable));
+            newBlock.mBodyStart = _here();
+            mBlocks.push_back(newBlock);
+            return true;
+        }
+
+        if(statementName == "endfor")
+        {
+            if(mBlocks.empty() || !mBlocks.back().mIsLoop || !_expect_end())
+            {
+                return mBlocks.empty() || !mBlocks.back().mIsLoop ? _fail(InfJinjaTemplate::flags::INF_JINJA_ERR_SYNTAX, "unexpected endfor") : false;
+            }
+            inf_jinja_block& activeBlock = mBlocks.back();
+            if(!activeBlock.mHasElse)
+            {
+                I32 loopNext = _emit(programCode, inf_jinja_op::FOR_NEXT, activeBlock.mBodyStart - (_here() + 1));
+                _patch_all(activeBlock.mContinueJumps, loopNext);
+                _patch(activeBlock.mLoopBegin, _here());
+            }
+            _patch_all(activeBlock.mEndJumps, _here());
+            _patch_all(activeBlock.mBreakJumps, _here());
+            mBlocks.pop_back();
+            return true;
+        }
+
+        if(statementName == "break" || statementName == "continue")
+        {
+            inf_jinja_block* loopBlock = _innermost_loop();
+            if(!loopBlock || loopBlock->mHasElse || !_expect_end())
+            {
+                return loopBlock && !loopBlock->mHasElse ? false : _fail(InfJinjaTemplate::flags::INF_JINJA_ERR_SYNTAX, statementName + " outside of a loop");
+            }
+            if(statementName == "break")
+            {
+                _emit(programCode, inf_jinja_op::FOR_BREAK);
+                loopBlock->mBreakJumps.push_back(_emit(programCode, inf_jinja_op::JUMP));
+            }
+            else
+            {
+                loopBlock->mContinueJumps.push_back(_emit(programCode, inf_jinja_op::JUMP));
+            }
+            return true;
+        }
+
+        if(statementName == "set")
+        {
+            mbase::string targetName;
+            mbase::string attributeName;
+            if(!_expect_name(targetName))
+            {
+                return false;
+            }
+            if(_accept_operator(".") && !_expect_name(attributeName))
+            {
+                return false;
+            }
+            if(!_is_operator("="))
+            {
+                return _fail(InfJinjaTemplate::flags::INF_JINJA_ERR_UNSUPPORTED, "block assignments and tuple assignments");
+            }
+            _advance();
+
+            if(!attributeName.empty())
+            {
+                _emit(programCode, inf_jinja_op::LOAD, mProgram.intern(targetName));
+            }
+            if(!_parse_expression(programCode) || !_expect_end())
+            {
+                return false;
+            }
+            if(attributeName.empty())
+            {
+                _emit(programCode, inf_jinja_op::STORE, mProgram.intern(targetName));
+            }
+            else
+            {
+                _emit(programCode, inf_jinja_op::STORE_ATTR, mProgram.intern(attributeName));
+            }
+            return true;
+        }
+
+        if(statementName == "generation" || statementName == "endgeneration")
+        {
+            // marks the assistant tokens for training masks, nothing to render
+            return _expect_end();
+        }
+
+        return _fail(InfJinjaTemplate::flags::INF_JINJA_ERR_UNSUPPORTED, "unsupported statement '" + statementName + "'");
+    }
+
+    inf_jinja_program& mProgram;
+    std::vector<inf_jinja_token> mTokens;
+    SIZE_T mTokenIndex = 0;
+    std::vector<inf_jinja_block> mBlocks;
+    InfJinjaTemplate::flags mErrorFlag = InfJinjaTemplate::flags::INF_JINJA_ERR_SYNTAX;
+    mbase::string mError;
+};
+
+/* ===== RENDER MACHINE ===== */
+
+class inf_jinja_machine {
+public:
+    inf_jinja_machine(const inf_jinja_program& in_program) : mProgram(in_program)
+    {
+        mScopes.emplace_back();
+    }
+
+    GENERIC set_global(MSTRING in_name, const inf_jinja_value& in_value)
+    {
+        I32 nameId = mProgram.find_name(in_name);
+        if(nameId != -1)
+        {
+            mScopes.front()[nameId] = in_value;
+        }
+    }
+
+    InfJinjaTemplate::flags run(mbase::string& out_text, mbase::string& out_error)
+    {
+        const inf_jinja_code& programCode = mProgram.mCode;
+        const SIZE_T codeSize = programCode.size();
+        SIZE_T programCounter = 0;
+        while(programCounter < codeSize)
+        {
+            const inf_jinja_instruction& activeInstruction = programCode[programCounter++];
+            switch (activeInstruction.mOp)
+            {
+            case inf_jinja_op::TEXT:
+                out_text += mProgram.mTexts[activeInstruction.mA];
+                break;
+            case inf_jinja_op::EMIT:
+                inf_jinja_to_string(mStack.back(), out_text);
+                mStack.pop_back();
+                break;
+            case inf_jinja_op::CONST:
+                mStack.push_back(mProgram.mConstants[activeInstruction.mA]);
+                break;
+            case inf_jinja_op::LOAD:
+                mStack.push_back(_load(activeInstruction.mA));
+                break;
+            case inf_jinja_op::STORE:
+                mScopes.back()[activeInstruction.mA] = std::move(mStack.back());
+                mStack.pop_back();
+                break;
+            case inf_jinja_op::STORE_ATTR:
+            {
+                inf_jinja_value& objectValue = mStack[mStack.size() - 2];
+                if(objectValue.mKind != inf_jinja_value::kind::MAP)
+                {
+                    return _error(out_error, "cannot assign attribute '" + mProgram.mNames[activeInstruction.mA] + "' on a non-namespace value");
+                }
+                objectValue.mMap->set(mProgram.mNames[activeInstruction.mA], mStack.back());
+                mStack.pop_back();
+                mStack.pop_back();
+                break;
+            }
+            case inf_jinja_op::GET_ATTR:
+            {
+                inf_jinja_value& objectValue = mStack.back();
+                if(objectValue.mKind == inf_jinja_value::kind::UNDEFINED || objectValue.mKind == inf_jinja_value::kind::NONE)
+                {
+                    return _error(out_error, "'" + mProgram.mNames[activeInstruction.mA] + "' of an undefined value");
+                }
+                const inf_jinja_value* attributeValue = objectValue.mKind == inf_jinja_value::kind::MAP ? objectValue.mMap->find(mProgram.mNames[activeInstruction.mA]) : NULL;
+                objectValue = attributeValue ? *attributeValue : inf_jinja_value();
+                break;
+            }
+            case inf_jinja_op::GET_ITEM:
+            {
+                inf_jinja_value itemValue;
+                if(!inf_jinja_item(mStack[mStack.size() - 2], mStack.back(), itemValue))
+                {
+                    return _error(out_error, "subscript of an undefined value");
+                }
+                mStack.pop_back();
+                mStack.back() = std::move(itemValue);
+                break;
+            }
+            case inf_jinja_op::SLICE:
+                if(!_slice(activeInstruction.mA, out_error))
+                {
+                    return InfJinjaTemplate::flags::INF_JINJA_ERR_RENDER;
+                }
+                break;
+            case inf_jinja_op::CALL:
+            case inf_jinja_op::CALL_METHOD:
+            case inf_jinja_op::FILTER:
+            {
+                InfJinjaTemplate::flags callResult = _call(activeInstruction, out_error);
+                if(callResult != InfJinjaTemplate::flags::INF_JINJA_SUCCESS)
+                {
+                    return callResult;
+                }
+                break;
+            }
+            case inf_jinja_op::TEST:
+            {
+                _collect_arguments(activeInstruction.mB, -1);
+                bool testResult = false;
+                if(!_test(activeInstruction.mA, mStack.back(), _argument(0, NULL), testResult, out_error))
+                {
+                    return InfJinjaTemplate::flags::INF_JINJA_ERR_RENDER;
+                }
+                mStack.back() = inf_jinja_value::make_bool(activeInstruction.mC ? !testResult : testResult);
+                break;
+            }
+            case inf_jinja_op::NOT:
+                mStack.back() = inf_jinja_value::make_bool(!inf_jinja_is_true(mStack.back()));
+                break;
+            case inf_jinja_op::NEGATE:
+                if(!mStack.back().is_number())
+                {
+                    return _error(out_error, "bad operand for unary -");
+                }
+                mStack.back() = mStack.back().mKind == inf_jinja_value::kind::FLOAT ? inf_jinja_value::make_float(-mStack.back().mFloat) : inf_jinja_value::make_int(-mStack.back().as_int());
+                break;
+            case inf_jinja_op::BINARY:
+            {
+                inf_jinja_value resultValue;
+                if(!_binary(static_cast<inf_jinja_binary>(activeInstruction.mA), mStack[mStack.size() - 2], mStack.back(), resultValue, out_error))
+                {
+                    return InfJinjaTemplate::flags::INF_JINJA_ERR_RENDER;
+                }
+                mStack.pop_back();
+                mStack.back() = std::move(resultValue);
+                break;
+            }
+            case inf_jinja_op::JUMP:
+                programCounter += activeInstruction.mA;
+                break;
+            case inf_jinja_op::JUMP_FALSE:
+            {
+                const bool isTrue = inf_jinja_is_true(mStack.back());
+                mStack.pop_back();
+                if(!isTrue)
+                {
+                    programCounter += activeInstruction.mA;
+                }
+                break;
+            }
+            case inf_jinja_op::JUMP_FALSE_KEEP:
+            case inf_jinja_op::JUMP_TRUE_KEEP:
+                if(inf_jinja_is_true(mStack.back()) == (activeInstruction.mOp == inf_jinja_op::JUMP_TRUE_KEEP))
+                {
+                    programCounter += activeInstruction.mA;
+                }
+                else
+                {
+                    mStack.pop_back();
+                }
+                break;
+            case inf_jinja_op::BUILD_LIST:
+            {
+                inf_jinja_value listValue = inf_jinja_value::make_list();
+                const SIZE_T listBase = mStack.size() - activeInstruction.mA;
+                listValue.mList->assign(std::make_move_iterator(mStack.begin() + listBase), std::make_move_iterator(mStack.end()));
+                mStack.erase(mStack.begin() + listBase, mStack.end());
+                mStack.push_back(std::move(listValue));
+                break;
+            }
+            case inf_jinja_op::BUILD_DICT:
+            {
+                inf_jinja_value mapValue = inf_jinja_value::make_map();
+                const SIZE_T mapBase = mStack.size() - activeInstruction.mA * 2;
+                for(SIZE_T i = mapBase; i < mStack.size(); i += 2)
+                {
+                    mapValue.mMap->set(inf_jinja_to_string(mStack[i]), mStack[i + 1]);
+                }
+                mStack.erase(mStack.begin() + mapBase, mStack.end());
+                mStack.push_back(std::move(mapValue));
+                break;
+            }
+            case inf_jinja_op::FOR_BEGIN:
+            {
+                inf_jinja_loop_frame newFrame;
+                inf_jinja_value iterableList;
+                if(!inf_jinja_to_list(mStack.back(), iterableList))
+                {
+                    return _error(out_error, "value is not iterable");
+                }
+                mStack.pop_back();
+                if(iterableList.mList->empty())
+                {
+                    programCounter += activeInstruction.mA;
+                    break;
+                }
+                newFrame.mItems = iterableList.mList;
+                newFrame.mLoopObject = inf_jinja_value::make_map();
+                for(MSTRING tmpName : {"index", "index0", "revindex", "revindex0", "first", "last", "length"})
+                {
+                    newFrame.mLoopObject.mMap->mEntries.push_back(std::make_pair(mbase::string(tmpName), inf_jinja_value()));
+                }
+                newFrame.mVariable = activeInstruction.mB;
+                newFrame.mSecondVariable = activeInstruction.mC;
+                mFrames.push_back(std::move(newFrame));
+                mScopes.emplace_back();
+                if(!_bind_loop(out_error))
+                {
+                    return InfJinjaTemplate::flags::INF_JINJA_ERR_RENDER;
+                }
+                break;
+            }
+            case inf_jinja_op::FOR_NEXT:
+                if(++mFrames.back().mIndex < mFrames.back().mItems->size())
+                {
+                    if(!_bind_loop(out_error))
+                    {
+                        return InfJinjaTemplate::flags::INF_JINJA_ERR_RENDER;
+                    }
+                    programCounter += activeInstruction.mA;
+                }
+                else
+                {
+                    mFrames.pop_back();
+                    mScopes.pop_back();
+                }
+                break;
+            case inf_jinja_op::FOR_BREAK:
+                mFrames.pop_back();
+                mScopes.pop_back();
+                break;
+            }
+        }
+        return InfJinjaTemplate::flags::INF_JINJA_SUCCESS;
+    }
+
+private:
+    struct inf_jinja_loop_frame {
+        std::shared_ptr<inf_jinja_list> mItems;
+        inf_jinja_value mLoopObject;
+        SIZE_T mIndex = 0;
+        I32 mVariable = -1;
+        I32 mSecondVariable = -1;
+    };
+
+    InfJinjaTemplate::flags _error(mbase::string& out_error, const mbase::string& in_message)
+    {
+        out_error = in_message;
+        return InfJinjaTemplate::flags::INF_JINJA_ERR_RENDER;
+    }
+
+    const inf_jinja_value& _load(I32 in_name) const
+    {
+        static const inf_jinja_value undefinedValue;
+        for(std::vector<std::unordered_map<I32, inf_jinja_value>>::const_reverse_iterator It = mScopes.rbegin(); It != mScopes.rend(); ++It)
+        {
+            std::unordered_map<I32, inf_jinja_value>::const_iterator foundValue = It->find(in_name);
+            if(foundValue != It->end())
+            {
+                return foundValue->second;
+            }
+        }
+        return undefinedValue;
+    }
+
+    bool _bind_loop(mbase::string& out_error)
+    {
+        inf_jinja_loop_frame& activeFrame = mFrames.back();
+        std::unordered_map<I32, inf_jinja_value>& loopScope = mScopes.back();
+        const inf_jinja_value& itemValue = (*activeFrame.mItems)[activeFrame.mIndex];
+        if(activeFrame.mSecondVariable == -1)
+        {
+            loopScope[activeFrame.mVariable] = itemValue;
+        }
+        else
+        {
+            if(itemValue.mKind != inf_jinja_value::kind::LIST || itemValue.mList->size() != 2)
+            {
+                out_error = "cannot unpack the loop item into two variables";
+                return false;
+            }
+            loopScope[activeFrame.mVariable] = (*itemValue.mList)[0];
+            loopScope[activeFrame.mSecondVariable] = (*itemValue.mList)[1];
+        }
+
+        const I64 loopLength = static_cast<I64>(activeFrame.mItems->size());
+        const I64 loopIndex = static_cast<I64>(activeFrame.mIndex);
+        std::vector<std::pair<mbase::string, inf_jinja_value>>& loopEntries = activeFrame.mLoopObject.mMap->mEntries;
+        loopEntries[0].second = inf_jinja_value::make_int(loopIndex + 1);
+        loopEntries[1].second = inf_jinja_value::make_int(loopIndex);
+        loopEntries[2].second = inf_jinja_value::make_int(loopLength - loopIndex);
+        loopEntries[3].second = inf_jinja_value::make_int(loopLength - loopIndex - 1);
+        loopEntries[4].second = inf_jinja_value::make_bool(loopIndex == 0);
+        loopEntries[5].second = inf_jinja_value::make_bool(loopIndex == loopLength - 1);
+        loopEntries[6].second = inf_jinja_value::make_int(loopLength);
+        loopScope[mProgram.mLoopName] = activeFrame.mLoopObject;
+        return true;
+    }
+
+    GENERIC _collect_arguments(I32 in_count, I32 in_keywords)
+    {
+        const SIZE_T keywordCount = in_keywords == -1 ? 0 : mProgram.mKeywordLists[in_keywords].size();
+        const SIZE_T argumentBase = mStack.size() - in_count;
+        const SIZE_T positionalCount = in_count - keywordCount;
+        mArguments.assign(std::make_move_iterator(mStack.begin() + argumentBase), std::make_move_iterator(mStack.begin() + argumentBase + positionalCount));
+        mKeywordArguments.clear();
+        for(SIZE_T i = 0; i < keywordCount; i++)
+        {
+            mKeywordArguments.push_back(std::make_pair(&mProgram.mNames[mProgram.mKeywordLists[in_keywords][i]], std::move(mStack[argumentBase + positionalCount + i])));
+        }
+        mStack.erase(mStack.begin() + argumentBase, mStack.end());
+    }
+
+    const inf_jinja_value* _argument(SIZE_T in_position, MSTRING in_keyword) const
+    {
+        if(in_position < mArguments.size())
+        {
+            return &mArguments[in_position];
+        }
+        for(const std::pair<const mbase::string*, inf_jinja_value>& tmpArgument : mKeywordArguments)
+        {
+            if(in_keyword && *tmpArgument.first == in_keyword)
+            {
+                return &tmpArgument.second;
+            }
+        }
+        return NULL;
+    }
+
+    mbase::string _string_argument(SIZE_T in_position, MSTRING in_keyword, const mbase::string& in_default = mbase::string()) const
+    {
+        const inf_jinja_value* argumentValue = _argument(in_position, in_keyword);
+        return argumentValue && argumentValue->mKind != inf_jinja_value::kind::UNDEFINED ? inf_jinja_to_string(*argumentValue) : in_default;
+    }
+
+    bool _slice(I32 in_mask, mbase::string& out_error)
+    {
+        I64 sliceStep = 1;
+        bool hasStart = false;
+        bool hasStop = false;
+        I64 sliceStart = 0;
+        I64 sliceStop = 0;
+        if(in_mask & 4)
+        {
+            if(mStack.back().mKind != inf_jinja_value::kind::NONE)
+            {
+                sliceStep = mStack.back().as_int();
+            }
+            mStack.pop_back();
+        }
+        if(in_mask & 2)
+        {
+            hasStop = mStack.back().mKind != inf_jinja_value::kind::NONE;
+            sliceStop = mStack.back().as_int();
+            mStack.pop_back();
+        }
+        if(in_mask & 1)
+        {
+            hasStart = mStack.back().mKind != inf_jinja_value::kind::NONE;
+            sliceStart = mStack.back().as_int();
+            mStack.pop_back();
+        }
+        if(!sliceStep)
+        {
+            out_error = "slice step cannot be zero";
+            return false;
+        }
+
+        inf_jinja_value& objectValue = mStack.back();
+        I64 itemCount = 0;
+        if(objectValue.mKind == inf_jinja_value::kind::LIST)
+        {
+            itemCount = static_cast<I64>(objectValue.mList->size());
+        }
+        else if(objectValue.mKind == inf_jinja_value::kind::STRING)
+        {
+            itemCount = static_cast<I64>(objectValue.mString.size());
+        }
+        else
+        {
+            out_error = "value is not sliceable";
+            return false;
+        }
+
+        // python slice index normalization
+        auto normalizeIndex = [&](I64 in_index, bool in_given, bool in_isStart) {
+            if(!in_given)
+            {
+                return sliceStep > 0 ? (in_isStart ? 0 : itemCount) : (in_isStart ? itemCount - 1 : -1);
+            }
+            if(in_index < 0)
+            {
+                in_index += itemCount;
+                if(in_index < 0)
+                {
+                    in_index = sliceStep > 0 ? 0 : -1;
+                }
+            }
+            else if(in_index >= itemCount)
+            {
+                in_index = sliceStep > 0 ? itemCount : itemCount - 1;
+            }
+            return in_index;
+        };
+        sliceStart = normalizeIndex(sliceStart, hasStart, true);
+        sliceStop = normalizeIndex(sliceStop, hasStop, false);
+
+        if(objectValue.mKind == inf_jinja_value::kind::LIST)
+        {
+            inf_jinja_value slicedValue = inf_jinja_value::make_list();
+            for(I64 i = sliceStart; sliceStep > 0 ? i < sliceStop : i > sliceStop; i += sliceStep)
+            {
+                slicedValue.mList->push_back((*objectValue.mList)[static_cast<SIZE_T>(i)]);
+            }
+            objectValue = std::move(slicedValue);
+        }
+        else
+        {
+            mbase::string slicedString;
+            for(I64 i = sliceStart; sliceStep > 0 ? i < sliceStop : i > sliceStop; i += sliceStep)
+            {
+                slicedString.push_back(objectValue.mString[static_cast<SIZE_T>(i)]);
+            }
+            objectValue = inf_jinja_value::make_string(slicedString);
+        }
+        return true;
+    }
+
+    bool _binary(inf_jinja_binary in_operator, const inf_jinja_value& in_lhs, const inf_jinja_value& in_rhs, inf_jinja_value& out_value, mbase::string& out_error)
+    {
+        const bool bothNumbers = in_lhs.is_number() && in_rhs.is_number();
+        const bool bothIntegral = in_lhs.is_integral() && in_rhs.is_integral();
+        switch (in_operator)
+        {
+        case inf_jinja_binary::ADD:
+            if(bothNumbers)
+            {
+                out_value = bothIntegral ? inf_jinja_value::make_int(in_lhs.as_int() + in_rhs.as_int()) : inf_jinja_value::make_float(in_lhs.as_float() + in_rhs.as_float());
+                return true;
+            }
+            if(in_lhs.mKind == inf_jinja_value::kind::STRING && in_rhs.mKind == inf_jinja_value::kind::STRING)
+            {
+                out_value = inf_jinja_value::make_string(in_lhs.mString + in_rhs.mString);
+                return true;
+            }
+            if(in_lhs.mKind == inf_jinja_value::kind::LIST && in_rhs.mKind == inf_jinja_value::kind::LIST)
+            {
+                out_value = inf_jinja_value::make_list();
+                *out_value.mList = *in_lhs.mList;
+                out_value.mList->insert(out_value.mList->end(), in_rhs.mList->begin(), in_rhs.mList->end());
+                return true;
+            }
+            break;
+        case inf_jinja_binary::SUBTRACT:
+            if(bothNumbers)
+            {
+                out_value = bothIntegral ? inf_jinja_value::make_int(in_lhs.as_int() - in_rhs.as_int()) : inf_jinja_value::make_float(in_lhs.as_float() - in_rhs.as_float());
+                return true;
+            }
+            break;
+        case inf_jinja_binary::MULTIPLY:
+            if(bothNumbers)
+            {
+                out_value = bothIntegral ? inf_jinja_value::make_int(in_lhs.as_int() * in_rhs.as_int()) : inf_jinja_value::make_float(in_lhs.as_float() * in_rhs.as_float());
+                return true;
+            }
+            if(in_lhs.mKind == inf_jinja_value::kind::STRING && in_rhs.is_integral())
+            {
+                mbase::string repeatedString;
+                for(I64 i = 0; i < in_rhs.as_int(); i++)
+                {
+                    repeatedString += in_lhs.mString;
+                }
+                out_value = inf_jinja_value::make_string(repeatedString);
+                return true;
+            }
+            break;
+        case inf_jinja_binary::DIVIDE:
+        case inf_jinja_binary::FLOOR_DIVIDE:
+        case inf_jinja_binary::MODULO:
+            if(bothNumbers)
+            {
+                if(in_rhs.as_float() == 0.0)
+                {
+                    out_error = "division by zero";
+                    return false;
+                }
+                if(in_operator == inf_jinja_binary::DIVIDE)
+                {
+                    out_value = inf_jinja_value::make_float(in_lhs.as_float() / in_rhs.as_float());
+                }
+                else if(bothIntegral)
+                {
+                    // python rounds toward negative infinity
+                    const I64 lhsInt = in_lhs.as_int();
+                    const I64 rhsInt = in_rhs.as_int();
+                    I64 quotientValue = lhsInt / rhsInt;
+                    I64 remainderValue = lhsInt % rhsInt;
+                    if(remainderValue && ((remainderValue < 0) != (rhsInt < 0)))
+                    {
+                        --quotientValue;
+                        remainderValue += rhsInt;
+                    }
+                    out_value = inf_jinja_value::make_int(in_operator == inf_jinja_binary::FLOOR_DIVIDE ? quotientValue : remainderValue);
+                }
+                else
+                {
+                    const F64 floorValue = std::floor(in_lhs.as_float() / in_rhs.as_float());
+                    out_value = inf_jinja_value::make_float(in_operator == inf_jinja_binary::FLOOR_DIVIDE ? floorValue : in_lhs.as_float() - floorValue * in_rhs.as_float());
+                }
+                return true;
+            }
+            break;
+        case inf_jinja_binary::CONCAT:
+            out_value = inf_jinja_value::make_string(inf_jinja_to_string(in_lhs) + inf_jinja_to_string(in_rhs));
+            return true;
+        case inf_jinja_binary::EQUAL:
+            out_value = inf_jinja_value::make_bool(inf_jinja_equals(in_lhs, in_rhs));
+            return true;
+        case inf_jinja_binary::NOT_EQUAL:
+            out_value = inf_jinja_value::make_bool(!inf_jinja_equals(in_lhs, in_rhs));
+            return true;
+        case inf_jinja_binary::LESS:
+        case inf_jinja_binary::GREATER:
+        case inf_jinja_binary::LESS_EQUAL:
+        case inf_jinja_binary::GREATER_EQUAL:
+        {
+            I32 compareResult = 0;
+            if(bothNumbers)
+            {
+                compareResult = in_lhs.as_float() < in_rhs.as_float() ? -1 : in_lhs.as_float() > in_rhs.as_float() ? 1 : 0;
+            }
+            else if(in_lhs.mKind == inf_jinja_value::kind::STRING && in_rhs.mKind == inf_jinja_value::kind::STRING)
+            {
+                compareResult = in_lhs.mString < in_rhs.mString ? -1 : in_rhs.mString < in_lhs.mString ? 1 : 0;
+            }
+            else
+            {
+                break;
+            }
+            out_value = inf_jinja_value::make_bool(
+                in_operator == inf_jinja_binary::LESS ? compareResult < 0 :
+                in_operator == inf_jinja_binary::GREATER ? compareResult > 0 :
+                in_operator == inf_jinja_binary::LESS_EQUAL ? compareResult <= 0 : compareResult >= 0
+            );
+            return true;
+        }
+        case inf_jinja_binary::CONTAINS:
+            out_value = inf_jinja_value::make_bool(inf_jinja_contains(in_rhs, in_lhs));
+            return true;
+        case inf_jinja_binary::NOT_CONTAINS:
+            out_value = inf_jinja_value::make_bool(!inf_jinja_contains(in_rhs, in_lhs));
+            return true;
+        }
+        out_error = "unsupported operand types";
+        return false;
+    }
+
+    bool _test(I32 in_test, const inf_jinja_value& in_value, const inf_jinja_value* in_argument, bool& out_result, mbase::string& out_error)
+    {
+        switch (static_cast<inf_jinja_test>(in_test))
+        {
+        case inf_jinja_test::DEFINED:
+            out_result = in_value.mKind != inf_jinja_value::kind::UNDEFINED;
+            return true;
+        case inf_jinja_test::UNDEFINED:
+            out_result = in_value.mKind == inf_jinja_value::kind::UNDEFINED;
+            return true;
+        case inf_jinja_test::NONE:
+            out_result = in_value.mKind == inf_jinja_value::kind::NONE;
+            return true;
+        case inf_jinja_test::STRING:
+            out_result = in_value.mKind == inf_jinja_value::kind::STRING;
+            return true;
+        case inf_jinja_test::NUMBER:
+            out_result = in_value.mKind == inf_jinja_value::kind::INT || in_value.mKind == inf_jinja_value::kind::FLOAT;
+            return true;
+        case inf_jinja_test::INTEGER:
+            out_result = in_value.mKind == inf_jinja_value::kind::INT;
+            return true;
+        case inf_jinja_test::FLOAT:
+            out_result = in_value.mKind == inf_jinja_value::kind::FLOAT;
+            return true;
+        case inf_jinja_test::BOOLEAN:
+            out_result = in_value.mKind == inf_jinja_value::kind::BOOL;
+            return true;
+        case inf_jinja_test::MAPPING:
+            out_result = in_value.mKind == inf_jinja_value::kind::MAP;
+            return true;
+        case inf_jinja_test::SEQUENCE:
+        case inf_jinja_test::ITERABLE:
+            out_result = in_value.mKind == inf_jinja_value::kind::LIST || in_value.mKind == inf_jinja_value::kind::STRING || in_value.mKind == inf_jinja_value::kind::MAP;
+            return true;
+        case inf_jinja_test::IS_TRUE:
+            out_result = in_value.mKind == inf_jinja_value::kind::BOOL && in_value.mBool;
+            return true;
+        case inf_jinja_test::IS_FALSE:
+            out_result = in_value.mKind == inf_jinja_value::kind::BOOL && !in_value.mBool;
+            return true;
+        case inf_jinja_test::ODD:
+        case inf_jinja_test::EVEN:
+            if(!in_value.is_integral())
+            {
+                out_error = "odd and even tests need an integer";
+                return false;
+            }
+            out_result = (in_value.as_int() % 2 != 0) == (static_cast<inf_jinja_test>(in_test) == inf_jinja_test::ODD);
+            return true;
+        case inf_jinja_test::EQUALTO:
+        case inf_jinja_test::NOT_EQUALTO:
+        case inf_jinja_test::CONTAINED:
+            if(!in_argument)
+            {
+                out_error = "the test needs an argument";
+                return false;
+            }
+            if(static_cast<inf_jinja_test>(in_test) == inf_jinja_test::CONTAINED)
+            {
+                out_result = inf_jinja_contains(*in_argument, in_value);
+            }
+            else
+            {
+                out_result = inf_jinja_equals(in_value, *in_argument) == (static_cast<inf_jinja_test>(in_test) == inf_jinja_test::EQUALTO);
+            }
+            return true;
+        }
+        out_result = false;
+        return true;
+    }
+
+    InfJinjaTemplate::flags _call(const inf_jinja_instruction& in_instruction, mbase::string& out_error)
+    {
+        _collect_arguments(in_instruction.mB, in_instruction.mC);
+        if(in_instruction.mOp == inf_jinja_op::CALL)
+        {
+            inf_jinja_value resultValue;
+            InfJinjaTemplate::flags callResult = _call_function(static_cast<inf_jinja_function>(in_instruction.mA), resultValue, out_error);
+            if(callResult == InfJinjaTemplate::flags::INF_JINJA_SUCCESS)
+            {
+                mStack.push_back(std::move(resultValue));
+            }
+            return callResult;
+        }
+
+        inf_jinja_value resultValue;
+        const bool isCalled = in_instruction.mOp == inf_jinja_op::FILTER ?
+            _call_filter(static_cast<inf_jinja_filter>(in_instruction.mA), mStack.back(), resultValue, out_error) :
+            _call_method(static_cast<inf_jinja_method>(in_instruction.mA), mStack.back(), resultValue, out_error);
+        if(!isCalled)
+        {
+            return InfJinjaTemplate::flags::INF_JINJA_ERR_RENDER;
+        }
+        mStack.back() = std::move(resultValue);
+        return InfJinjaTemplate::flags::INF_JINJA_SUCCESS;
+    }
+
+    InfJinjaTemplate::flags _call_function(inf_jinja_function in_function, inf_jinja_value& out_value, mbase::string& out_error)
+    {
+        switch (in_function)
+        {
+        case inf_jinja_function::RAISE_EXCEPTION:
+            out_error = _string_argument(0, "message", "raise_exception called");
+            return InfJinjaTemplate::flags::INF_JINJA_ERR_TEMPLATE_EXCEPTION;
+        case inf_jinja_function::NAMESPACE:
+        case inf_jinja_function::DICT:
+            out_value = inf_jinja_value::make_map();
+            for(const inf_jinja_value& tmpArgument : mArguments)
+            {
+                if(tmpArgument.mKind == inf_jinja_value::kind::MAP)
+                {
+                    for(const std::pair<mbase::string, inf_jinja_value>& tmpEntry : tmpArgument.mMap->mEntries)
+                    {
+                        out_value.mMap->set(tmpEntry.first, tmpEntry.second);
+                    }
+                }
+            }
+            for(const std::pair<const mbase::string*, inf_jinja_value>& tmpArgument : mKeywordArguments)
+            {
+                out_value.mMap->set(*tmpArgument.first, tmpArgument.second);
+            }
+            return InfJinjaTemplate::flags::INF_JINJA_SUCCESS;
+        case inf_jinja_function::RANGE:
+        {
+            I64 rangeStart = 0;
+            I64 rangeStop = 0;
+            I64 rangeStep = 1;
+            if(mArguments.empty() || mArguments.size() > 3)
+            {
+                return _error(out_error, "range takes 1 to 3 arguments");
+            }
+            if(mArguments.size() == 1)
+            {
+                rangeStop = mArguments[0].as_int();
+            }
+            else
+            {
+                rangeStart = mArguments[0].as_int();
+                rangeStop = mArguments[1].as_int();
+                rangeStep = mArguments.size() == 3 ? mArguments[2].as_int() : 1;
+            }
+            if(!rangeStep)
+            {
+                return _error(out_error, "range step cannot be zero");
+            }
+            out_value = inf_jinja_value::make_list();
+            for(I64 i = rangeStart; rangeStep > 0 ? i < rangeStop : i > rangeStop; i += rangeStep)
+            {
+                if(out_value.mList->size() >= 1000000)
+                {
+                    return _error(out_error, "range is too large");
+                }
+                out_value.mList->push_back(inf_jinja_value::make_int(i));
+            }
+            return InfJinjaTemplate::flags::INF_JINJA_SUCCESS;
+        }
+        case inf_jinja_function::STRFTIME_NOW:
+        {
+            const mbase::string timeFormat = _string_argument(0, "format", "%Y-%m-%d");
+            time_t currentTime = time(NULL);
+            struct tm localTime;
+        #ifdef MBASE_PLATFORM_WINDOWS
+            localtime_s(&localTime, &currentTime);
+        #else
+            localtime_r(&currentTime, &localTime);
+        #endif
+            I8 timeBuffer[256] = {0};
+            strftime(timeBuffer, sizeof(timeBuffer), timeFormat.c_str(), &localTime);
+            out_value = inf_jinja_value::make_string(timeBuffer);
+            return InfJinjaTemplate::flags::INF_JINJA_SUCCESS;
+        }
+        }
+        return _error(out_error, "unknown function");
+    }
+
+    bool _select_test(const inf_jinja_value& in_item, bool in_by_attribute, bool& out_result, mbase::string& out_error)
+    {
+        // select/reject: test name and its argument, selectattr/rejectattr: attribute first
+        const SIZE_T testPosition = in_by_attribute ? 1 : 0;
+        inf_jinja_value testedValue = in_item;
+        if(in_by_attribute)
+        {
+            const inf_jinja_value* attributeName = _argument(0, NULL);
+            if(!attributeName || attributeName->mKind != inf_jinja_value::kind::STRING)
+            {
+                out_error = "selectattr and rejectattr need an attribute name";
+                return false;
+            }
+            const inf_jinja_value* foundValue = in_item.mKind == inf_jinja_value::kind::MAP ? in_item.mMap->find(attributeName->mString) : NULL;
+            testedValue = foundValue ? *foundValue : inf_jinja_value();
+        }
+
+        if(mArguments.size() <= testPosition)
+        {
+            out_result = inf_jinja_is_true(testedValue);
+            return true;
+        }
+
+        const mbase::string testName = inf_jinja_to_string(mArguments[testPosition]);
+        I32 testId = inf_jinja_find_builtin(gInfJinjaTests, testName);
+        if(testId == -1)
+        {
+            out_error = "unsupported test '" + testName + "'";
+            return false;
+        }
+        return _test(testId, testedValue, _argument(testPosition + 1, NULL), out_result, out_error);
+    }
+
+    bool _call_filter(inf_jinja_filter in_filter, const inf_jinja_value& in_value, inf_jinja_value& out_value, mbase::string& out_error)
+    {
+        const bool isString = in_value.mKind == inf_jinja_value::kind::STRING;
+        switch (in_filter)
+        {
+        case inf_jinja_filter::TRIM:
+            out_value = inf_jinja_value::make_string(inf_jinja_strip(inf_jinja_to_string(in_value), true, true));
+            return true;
+        case inf_jinja_filter::LENGTH:
+            if(isString)
+            {
+                out_value = inf_jinja_value::make_int(static_cast<I64>(inf_jinja_utf8_length(in_value.mString)));
+            }
+            else if(in_value.mKind == inf_jinja_value::kind::LIST)
+            {
+                out_value = inf_jinja_value::make_int(static_cast<I64>(in_value.mList->size()));
+            }
+            else if(in_value.mKind == inf_jinja_value::kind::MAP)
+            {
+                out_value = inf_jinja_value::make_int(static_cast<I64>(in_value.mMap->mEntries.size()));
+            }
+            else
+            {
+                out_value = inf_jinja_value::make_int(0);
+            }
+            return true;
+        case inf_jinja_filter::UPPER:
+        case inf_jinja_filter::LOWER:
+        case inf_jinja_filter::CAPITALIZE:
+        case inf_jinja_filter::TITLE:
+        {
+            const I32 caseMode = in_filter == inf_jinja_filter::UPPER ? 0 : in_filter == inf_jinja_filter::LOWER ? 1 : in_filter == inf_jinja_filter::CAPITALIZE ? 2 : 3;
+            out_value = inf_jinja_value::make_string(inf_jinja_change_case(inf_jinja_to_string(in_value), caseMode));
+            return true;
+        }
+        case inf_jinja_filter::STRING:
+            out_value = inf_jinja_value::make_string(inf_jinja_to_string(in_value));
+            return true;
+        case inf_jinja_filter::INT:
+            out_value = inf_jinja_value::make_int(isString ? static_cast<I64>(strtod(in_value.mString.c_str(), NULL)) : in_value.is_number() ? in_value.as_int() : 0);
+            return true;
+        case inf_jinja_filter::FLOAT:
+            out_value = inf_jinja_value::make_float(isString ? strtod(in_value.mString.c_str(), NULL) : in_value.is_number() ? in_value.as_float() : 0.0);
+            return true;
+        case inf_jinja_filter::DEFAULT:
+        {
+            const inf_jinja_value* defaultValue = _argument(0, "default_value");
+            const inf_jinja_value* booleanMode = _argument(1, "boolean");
+            const bool useDefault = in_value.mKind == inf_jinja_value::kind::UNDEFINED || (booleanMode && inf_jinja_is_true(*booleanMode) && !inf_jinja_is_true(in_value));
+            out_value = useDefault ? (defaultValue ? *defaultValue : inf_jinja_value::make_string("")) : in_value;
+            return true;
+        }
+        case inf_jinja_filter::TOJSON:
+        {
+            const inf_jinja_value* jsonIndent = _argument(0, "indent");
+            mbase::string jsonString;
+            inf_jinja_to_json(in_value, jsonIndent && jsonIndent->is_integral() ? static_cast<I32>(jsonIndent->as_int()) : -1, 0, jsonString);
+            out_value = inf_jinja_value::make_string(jsonString);
+            return true;
+        }
+        case inf_jinja_filter::JOIN:
+        {
+            const mbase::string joinSeparator = _string_argument(0, "d");
+            const inf_jinja_value* joinAttribute = _argument(1, "attribute");
+            inf_jinja_value joinedList;
+            if(!inf_jinja_to_list(in_value, joinedList))
+            {
+                out_error = "join needs an iterable";
+                return false;
+            }
+            mbase::string joinedString;
+            for(SIZE_T i = 0; i < joinedList.mList->size(); i++)
+            {
+                if(i)
+                {
+                    joinedString += joinSeparator;
+                }
+                const inf_jinja_value& joinedItem = (*joinedList.mList)[i];
+                if(joinAttribute && joinedItem.mKind == inf_jinja_value::kind::MAP)
+                {
+                    const inf_jinja_value* attributeValue = joinedItem.mMap->find(inf_jinja_to_string(*joinAttribute));
+                    if(attributeValue)
+                    {
+                        inf_jinja_to_string(*attributeValue, joinedString);
+                    }
+                }
+                else
+                {
+                    inf_jinja_to_string(joinedItem, joinedString);
+                }
+            }
+            out_value = inf_jinja_value::make_string(joinedString);
+            return true;
+        }
+        case inf_jinja_filter::FIRST:
+        case inf_jinja_filter::LAST:
+        {
+            inf_jinja_value itemList;
+            if(!inf_jinja_to_list(in_value, itemList))
+            {
+                out_error = "first and last need a sequence";
+                return false;
+            }
+            out_value = itemList.mList->empty() ? inf_jinja_value() : in_filter == inf_jinja_filter::FIRST ? itemList.mList->front() : itemList.mList->back();
+            return true;
+        }
+        case inf_jinja_filter::LIST:
+        case inf_jinja_filter::REVERSE:
+        {
+            inf_jinja_value itemList;
+            if(!inf_jinja_to_list(in_value, itemList))
+            {
+                out_error = "value is not iterable";
+                return false;
+            }
+            out_value = inf_jinja_value::make_list();
+            *out_value.mList = *itemList.mList;
+            if(in_filter == inf_jinja_filter::REVERSE)
+            {
+                std::reverse(out_value.mList->begin(), out_value.mList->end());
+                if(isString)
+                {
+                    mbase::string reversedString;
+                    for(const inf_jinja_value& tmpCharacter : *out_value.mList)
+                    {
+                        reversedString += tmpCharacter.mString;
+                    }
+                    out_value = inf_jinja_value::make_string(reversedString);
+                }
+            }
+            return true;
+        }
+        case inf_jinja_filter::REPLACE:
+        {
+            const inf_jinja_value* replaceCount = _argument(2, "count");
+            out_value = inf_jinja_value::make_string(inf_jinja_replace(inf_jinja_to_string(in_value), _string_argument(0, "old"), _string_argument(1, "new"), replaceCount && replaceCount->is_integral() ? replaceCount->as_int() : -1));
+            return true;
+        }
+        case inf_jinja_filter::SAFE:
+            out_value = in_value;
+            return true;
+        case inf_jinja_filter::ITEMS:
+            out_value = inf_jinja_value::make_list();
+            if(in_value.mKind == inf_jinja_value::kind::MAP)
+            {
+                for(const std::pair<mbase::string, inf_jinja_value>& tmpEntry : in_value.mMap->mEntries)
+                {
+                    inf_jinja_value pairValue = inf_jinja_value::make_list();
+                    pairValue.mList->push_back(inf_jinja_value::make_string(tmpEntry.first));
+                    pairValue.mList->push_back(tmpEntry.second);
+                    out_value.mList->push_back(std::move(pairValue));
+                }
+            }
+            return true;
+        case inf_jinja_filter::SELECT:
+        case inf_jinja_filter::REJECT:
+        case inf_jinja_filter::SELECTATTR:
+        case inf_jinja_filter::REJECTATTR:
+        {
+            inf_jinja_value itemList;
+            if(!inf_jinja_to_list(in_value, itemList))
+            {
+                out_error = "value is not iterable";
+                return false;
+            }
+            out_value = inf_jinja_value::make_list();
+            for(const inf_jinja_value& tmpItem : *itemList.mList)
+            {
+                bool isSelected = false;
+                if(!_select_test(tmpItem, in_filter == inf_jinja_filter::SELECTATTR || in_filter == inf_jinja_filter::REJECTATTR, isSelected, out_error))
+                {
+                    return false;
+                }
+                if(isSelected == (in_filter == inf_jinja_filter::SELECT || in_filter == inf_jinja_filter::SELECTATTR))
+                {
+                    out_value.mList->push_back(tmpItem);
+                }
+            }
+            return true;
+        }
+        case inf_jinja_filter::MAP:
+        {
+            const inf_jinja_value* mapAttribute = _argument(SIZE_MAX, "attribute");
+            const inf_jinja_value* mapDefault = _argument(SIZE_MAX, "default");
+            inf_jinja_value itemList;
+            if(!mapAttribute || !mArguments.empty())
+            {
+                out_error = "map is only supported with the attribute argument";
+                return false;
+            }
+            if(!inf_jinja_to_list(in_value, itemList))
+            {
+                out_error = "value is not iterable";
+                return false;
+            }
+            out_value = inf_jinja_value::make_list();
+            for(const inf_jinja_value& tmpItem : *itemList.mList)
+            {
+                const inf_jinja_value* attributeValue = tmpItem.mKind == inf_jinja_value::kind::MAP ? tmpItem.mMap->find(inf_jinja_to_string(*mapAttribute)) : NULL;
+                out_value.mList->push_back(attributeValue ? *attributeValue : mapDefault ? *mapDefault : inf_jinja_value());
+            }
+            return true;
+        }
+        }
+        out_error = "unknown filter";
+        return false;
+    }
+
+    bool _call_method(inf_jinja_method in_method, const inf_jinja_value& in_value, inf_jinja_value& out_value, mbase::string& out_error)
+    {
+        if(in_value.mKind == inf_jinja_value::kind::STRING)
+        {
+            const mbase::string& sourceString = in_value.mString;
+            switch (in_method)
+            {
+            case inf_jinja_method::STRIP:
+            case inf_jinja_method::LSTRIP:
+            case inf_jinja_method::RSTRIP:
+            {
+                const inf_jinja_value* stripChars = _argument(0, "chars");
+                const bool hasChars = stripChars && stripChars->mKind == inf_jinja_value::kind::STRING;
+                out_value = inf_jinja_value::make_string(inf_jinja_strip(sourceString, in_method != inf_jinja_method::RSTRIP, in_method != inf_jinja_method::LSTRIP, hasChars ? &stripChars->mString : NULL));
+                return true;
+            }
+            case inf_jinja_method::STARTSWITH:
+            case inf_jinja_method::ENDSWITH:
+            {
+                const inf_jinja_value* affixValue = _argument(0, NULL);
+                if(!affixValue)
+                {
+                    break;
+                }
+                inf_jinja_value affixList = *affixValue;
+                if(affixList.mKind != inf_jinja_value::kind::LIST)
+                {
+                    affixList = inf_jinja_value::make_list();
+                    affixList.mList->push_back(*affixValue);
+                }
+                bool isMatched = false;
+                for(const inf_jinja_value& tmpAffix : *affixList.mList)
+                {
+                    const mbase::string affixString = inf_jinja_to_string(tmpAffix);
+                    isMatched |= in_method == inf_jinja_method::STARTSWITH ? inf_jinja_has_prefix(sourceString, affixString) : inf_jinja_has_suffix(sourceString, affixString);
+                }
+                out_value = inf_jinja_value::make_bool(isMatched);
+                return true;
+            }
+            case inf_jinja_method::SPLIT:
+            {
+                const inf_jinja_value* splitSeparator = _argument(0, "sep");
+                const inf_jinja_value* splitLimit = _argument(1, "maxsplit");
+                I64 remainingSplits = splitLimit && splitLimit->is_integral() ? splitLimit->as_int() : -1;
+                out_value = inf_jinja_value::make_list();
+                if(!splitSeparator || splitSeparator->mKind != inf_jinja_value::kind::STRING)
+                {
+                    // runs of whitespace, empty parts are dropped
+                    SIZE_T partBegin = 0;
+                    while(partBegin < sourceString.size())
+                    {
+                        while(partBegin < sourceString.size() && inf_jinja_is_space(sourceString[partBegin]))
+                        {
+                            ++partBegin;
+                        }
+                        if(partBegin == sourceString.size())
+                        {
+                            break;
+                        }
+                        SIZE_T partEnd = partBegin;
+                        if(remainingSplits == 0)
+                        {
+                            partEnd = sourceString.size();
+                            while(partEnd > partBegin && inf_jinja_is_space(sourceString[partEnd - 1]))
+                            {
+                                --partEnd;
+                            }
+                        }
+                        while(partEnd < sourceString.size() && !inf_jinja_is_space(sourceString[partEnd]))
+                        {
+                            ++partEnd;
+                        }
+                        out_value.mList->push_back(inf_jinja_value::make_string(inf_jinja_substring(sourceString, partBegin, partEnd - partBegin)));
+                        --remainingSplits;
+                        partBegin = partEnd;
+                    }
+                    return true;
+                }
+                if(splitSeparator->mString.empty())
+                {
+                    out_error = "empty separator";
+                    return false;
+                }
+                SIZE_T partBegin = 0;
+                SIZE_T partEnd = 0;
+                while(remainingSplits != 0 && (partEnd = sourceString.find(splitSeparator->mString, partBegin)) != mbase::string::npos)
+                {
+                    out_value.mList->push_back(inf_jinja_value::make_string(inf_jinja_substring(sourceString, partBegin, partEnd - partBegin)));
+                    partBegin = partEnd + splitSeparator->mString.size();
+                    --remainingSplits;
+                }
+                out_value.mList->push_back(inf_jinja_value::make_string(inf_jinja_substring(sourceString, partBegin)));
+                return true;
+            }
+            case inf_jinja_method::UPPER:
+            case inf_jinja_method::LOWER:
+            case inf_jinja_method::CAPITALIZE:
+            case inf_jinja_method::TITLE:
+            {
+                const I32 caseMode = in_method == inf_jinja_method::UPPER ? 0 : in_method == inf_jinja_method::LOWER ? 1 : in_method == inf_jinja_method::CAPITALIZE ? 2 : 3;
+                out_value = inf_jinja_value::make_string(inf_jinja_change_case(sourceString, caseMode));
+                return true;
+            }
+            case inf_jinja_method::REPLACE:
+            {
+                const inf_jinja_value* replaceCount = _argument(2, "count");
+                out_value = inf_jinja_value::make_string(inf_jinja_replace(sourceString, _string_argument(0, "old"), _string_argument(1, "new"), replaceCount && replaceCount->is_integral() ? replaceCount->as_int() : -1));
+                return true;
+            }
+            case inf_jinja_method::FIND:
+            {
+                const SIZE_T foundIndex = sourceString.find(_string_argument(0, "sub"));
+                out_value = inf_jinja_value::make_int(foundIndex == mbase::string::npos ? -1 : static_cast<I64>(foundIndex));
+                return true;
+            }
+            default:
+                break;
+            }
+        }
+        else if(in_value.mKind == inf_jinja_value::kind::MAP)
+        {
+            switch (in_method)
+            {
+            case inf_jinja_method::ITEMS:
+                return _call_filter(inf_jinja_filter::ITEMS, in_value, out_value, out_error);
+            case inf_jinja_method::KEYS:
+            case inf_jinja_method::VALUES:
+                out_value = inf_jinja_value::make_list();
+                for(const std::pair<mbase::string, inf_jinja_value>& tmpEntry : in_value.mMap->mEntries)
+                {
+                    out_value.mList->push_back(in_method == inf_jinja_method::KEYS ? inf_jinja_value::make_string(tmpEntry.first) : tmpEntry.second);
+                }
+                return true;
+            case inf_jinja_method::GET:
+            {
+                const inf_jinja_value* foundValue = in_value.mMap->find(_string_argument(0, "key"));
+                const inf_jinja_value* defaultValue = _argument(1, "default");
+                out_value = foundValue ? *foundValue : defaultValue ? *defaultValue : inf_jinja_value::make_none();
+                return true;
+            }
+            default:
+                break;
+            }
+        }
+        else if(in_value.mKind == inf_jinja_value::kind::LIST && in_method == inf_jinja_method::APPEND && !mArguments.empty())
+        {
+            in_value.mList->push_back(mArguments[0]);
+            out_value = inf_jinja_value::make_none();
+            return true;
+        }
+
+        out_error = "unsupported method call on this value";
+        return false;
+    }
+
+    const inf_jinja_program& mProgram;
+    std::vector<inf_jinja_value> mStack;
+    std::vector<std::unordered_map<I32, inf_jinja_value>> mScopes;
+    std::vector<inf_jinja_loop_frame> mFrames;
+    std::vector<inf_jinja_value> mArguments;
+    std::vector<std::pair<const mbase::string*, inf_jinja_value>> mKeywordArguments;
+};
+
+static MSTRING inf_jinja_role_name(context_role in_role)
+{
+    switch (in_role)
+    {
+    case context_role::SYSTEM:
+        return "system";
+    case context_role::ASSISTANT:
+        return "assistant";
+    default:
+        return "user";
+    }
+}
+
+InfJinjaTemplate::InfJinjaTemplate()
+{
+}
+
+InfJinjaTemplate::~InfJinjaTemplate()
+{
+}
+
+bool InfJinjaTemplate::is_compiled() const
+{
+    return mProgram != NULL;
+}
+
+const mbase::string& InfJinjaTemplate::get_source() const
+{
+    return mSource;
+}
+
+const mbase::string& InfJinjaTemplate::get_last_error() const
+{
+    return mLastError;
+}
+
+typename InfJinjaTemplate::size_type InfJinjaTemplate::get_instruction_count() const
+{
+    return mProgram ? mProgram->mCode.size() : 0;
+}
+
+InfJinjaTemplate::flags InfJinjaTemplate::compile(const mbase::string& in_source)
+{
+    clear();
+    mSource = in_source;
+
+    std::vector<inf_jinja_segment> templateSegments;
+    if(!inf_jinja_segment_source(in_source, templateSegments, mLastError))
+    {
+        return flags::INF_JINJA_ERR_SYNTAX;
+    }
+
+    std::unique_ptr<inf_jinja_program> newProgram = std::make_unique<inf_jinja_program>();
+    inf_jinja_compiler templateCompiler(*newProgram);
+    flags compileResult = templateCompiler.compile(templateSegments, mLastError);
+    if(compileResult != flags::INF_JINJA_SUCCESS)
+    {
+        return compileResult;
+    }
+    mProgram = std::move(newProgram);
+    return flags::INF_JINJA_SUCCESS;
+}
+
+GENERIC InfJinjaTemplate::set_special_tokens(const mbase::string& in_bos_token, const mbase::string& in_eos_token)
+{
+    mBosToken = in_bos_token;
+    mEosToken = in_eos_token;
+}
+
+GENERIC InfJinjaTemplate::clear()
+{
+    mProgram.reset();
+    mSource.clear();
+    mLastError.clear();
+}
+
+InfJinjaTemplate::flags InfJinjaTemplate::render(const context_line* in_lines, size_type in_count, bool in_add_generation_prompt, mbase::string& out_text)
+{
+    if(!mProgram)
+    {
+        return flags::INF_JINJA_ERR_NOT_COMPILED;
+    }
+
+    inf_jinja_value messageList = inf_jinja_value::make_list();
+    for(size_type i = 0; i < in_count; i++)
+    {
+        if(in_lines[i].mRole == context_role::NONE)
+        {
+            continue;
+        }
+        inf_jinja_value messageValue = inf_jinja_value::make_map();
+        messageValue.mMap->set("role", inf_jinja_value::make_string(inf_jinja_role_name(in_lines[i].mRole)));
+        messageValue.mMap->set("content", inf_jinja_value::make_string(in_lines[i].mMessage));
+        messageList.mList->push_back(std::move(messageValue));
+    }
+
+    inf_jinja_machine renderMachine(*mProgram);
+    renderMachine.set_global("messages", messageList);
+    renderMachine.set_global("add_generation_prompt", inf_jinja_value::make_bool(in_add_generation_prompt));
+    renderMachine.set_global("bos_token", inf_jinja_value::make_string(mBosToken));
+    renderMachine.set_global("eos_token", inf_jinja_value::make_string(mEosToken));
+
+    out_text.clear();
+    flags renderResult = renderMachine.run(out_text, mLastError);
+    if(renderResult != flags::INF_JINJA_SUCCESS)
+    {
+        out_text.clear();
+    }
+    return renderResult;
+}
+
+InfJinjaTemplate::flags InfJinjaTemplate::extract_role_strings(inf_chat_role_strings& out_strings)
+{
+    static const mbase::string systemMarker = "MBASESYSTEMMARKER0";
+    static const mbase::string userMarker = "MBASEUSERMARKER1";
+    static const mbase::string assistantMarker = "MBASEASSISTANTMARKER2";
+    static const mbase::string secondUserMarker = "MBASEUSERMARKER3";
+
+    if(!mProgram)
+    {
+        return flags::INF_JINJA_ERR_NOT_COMPILED;
+    }
+
+    auto renderProbe = [&](std::initializer_list<std::pair<context_role, mbase::string>> in_messages, bool in_generation_prompt, mbase::string& out_rendered, bool* out_bos = NULL) {
+        std::vector<context_line> probeLines;
+        for(const std::pair<context_role, mbase::string>& tmpMessage : in_messages)
+        {
+            context_line probeLine;
+            probeLine.mRole = tmpMessage.first;
+            probeLine.mMessage = tmpMessage.second;
+            probeLine.mMessageIndex = static_cast<U32>(probeLines.size());
+            probeLines.push_back(probeLine);
+        }
+        if(render(probeLines.data(), probeLines.size(), in_generation_prompt, out_rendered) != flags::INF_JINJA_SUCCESS)
+        {
+            return false;
+        }
+        // the bos token is added by the tokenizer and a closing eos is not a part of any role string
+        if(!mBosToken.empty() && inf_jinja_has_prefix(out_rendered, mBosToken))
+        {
+            if(out_bos)
+            {
+                *out_bos = true;
+            }
+            out_rendered = inf_jinja_substring(out_rendered, mBosToken.size());
+        }
+        if(!in_generation_prompt && !mEosToken.empty() && inf_jinja_has_suffix(out_rendered, mEosToken))
+        {
+            out_rendered = inf_jinja_substring(out_rendered, 0, out_rendered.size() - mEosToken.size());
+        }
+        return true;
+    };
+
+    auto unableToExtract = [&](MSTRING in_reason) {
+        mLastError = mbase::string("unable to extract the role strings: ") + in_reason;
+        return flags::INF_JINJA_ERR_UNABLE_TO_EXTRACT;
+    };
+
+    mbase::string userOnly;
+    mbase::string userPrompted;
+    mbase::string multiTurn;
+    bool hasBos = false;
+    if(!renderProbe({{context_role::USER, userMarker}}, false, userOnly, &hasBos) ||
+       !renderProbe({{context_role::USER, userMarker}}, true, userPrompted) ||
+       !renderProbe({{context_role::USER, userMarker}, {context_role::ASSISTANT, assistantMarker}, {context_role::USER, secondUserMarker}}, false, multiTurn))
+    {
+        return unableToExtract("the probe conversations don't render");
+    }
+
+    const SIZE_T userIndex = userOnly.find(userMarker);
+    const SIZE_T firstUserIndex = multiTurn.find(userMarker);
+    const SIZE_T assistantIndex = multiTurn.find(assistantMarker);
+    const SIZE_T secondUserIndex = multiTurn.find(secondUserMarker);
+    if(userIndex == mbase::string::npos || firstUserIndex == mbase::string::npos || assistantIndex == mbase::string::npos || secondUserIndex == mbase::string::npos ||
+       firstUserIndex > assistantIndex || assistantIndex > secondUserIndex || !inf_jinja_has_prefix(userPrompted, userOnly))
+    {
+        return unableToExtract("the messages are not rendered in order");
+    }
+
+    inf_chat_role_strings roleStrings;
+    if(hasBos)
+    {
+        roleStrings.mConversationStart = mBosToken;
+    }
+    roleStrings.mAssistantStart = inf_jinja_substring(userPrompted, userOnly.size());
+
+    const SIZE_T firstUserEnd = firstUserIndex + userMarker.size();
+    const SIZE_T assistantEnd = assistantIndex + assistantMarker.size();
+    const mbase::string userToAssistant = inf_jinja_substring(multiTurn, firstUserEnd, assistantIndex - firstUserEnd);
+    const mbase::string assistantToUser = inf_jinja_substring(multiTurn, assistantEnd, secondUserIndex - assistantEnd);
+    const mbase::string userPrefix = inf_jinja_substring(userOnly, 0, userIndex);
+
+    // the generation prompt may carry more than the header of the rendered assistant turns (a forced <think> for example),
+    // the user footer ends where the longest part of it that is also a prefix of the generation prompt begins
+    SIZE_T headerLength = std::min(userToAssistant.size(), roleStrings.mAssistantStart.size());
+    while(headerLength && memcmp(userToAssistant.c_str() + userToAssistant.size() - headerLength, roleStrings.mAssistantStart.c_str(), headerLength))
+    {
+        --headerLength;
+    }
+    if(!headerLength && roleStrings.mAssistantStart.size())
+    {
+        return unableToExtract("the generation prompt differs from the assistant header");
+    }
+    roleStrings.mUserEnd = inf_jinja_substring(userToAssistant, 0, userToAssistant.size() - headerLength);
+
+    if(roleStrings.mUserEnd.size() && inf_jinja_has_prefix(assistantToUser, roleStrings.mUserEnd) && inf_jinja_has_suffix(userPrefix, inf_jinja_substring(assistantToUser, roleStrings.mUserEnd.size())))
+    {
+        roleStrings.mAssistantEnd = roleStrings.mUserEnd;
+        roleStrings.mUserStart = inf_jinja_substring(assistantToUser, roleStrings.mUserEnd.size());
+    }
+    else
+    {
+        // the user header is the part the gap shares with what precedes the first user message
+        SIZE_T commonLength = 0;
+        while(commonLength < assistantToUser.size() && commonLength < userPrefix.size() &&
+              assistantToUser[assistantToUser.size() - commonLength - 1] == userPrefix[userPrefix.size() - commonLength - 1])
+        {
+            ++commonLength;
+        }
+        roleStrings.mUserStart = inf_jinja_substring(assistantToUser, assistantToUser.size() - commonLength);
+        roleStrings.mAssistantEnd = inf_jinja_substring(assistantToUser, 0, assistantToUser.size() - commonLength);
+    }
+
+    if(!inf_jinja_has_suffix(userPrefix, roleStrings.mUserStart))
+    {
+        return unableToExtract("the first user message has a different header");
+    }
+
+    // templates that fold the system prompt into the first user turn keep the user strings for it
+    roleStrings.mSystemStart = roleStrings.mUserStart;
+    roleStrings.mSystemEnd = roleStrings.mUserEnd;
+
+    mbase::string systemUser;
+    if(renderProbe({{context_role::SYSTEM, systemMarker}, {context_role::USER, userMarker}}, false, systemUser))
+    {
+        const SIZE_T systemIndex = systemUser.find(systemMarker);
+        const SIZE_T systemUserIndex = systemUser.find(userMarker);
+        if(systemIndex != mbase::string::npos && systemUserIndex != mbase::string::npos && systemIndex < systemUserIndex)
+        {
+            const SIZE_T systemEnd = systemIndex + systemMarker.size();
+            const mbase::string systemToUser = inf_jinja_substring(systemUser, systemEnd, systemUserIndex - systemEnd);
+            if(inf_jinja_has_suffix(systemToUser, roleStrings.mUserStart))
+            {
+                roleStrings.mSystemStart = inf_jinja_substring(systemUser, 0, systemIndex);
+                roleStrings.mSystemEnd = inf_jinja_substring(systemToUser, 0, systemToUser.size() - roleStrings.mUserStart.size());
+            }
+        }
+    }
+
+    mLastError.clear();
+    out_strings = roleStrings;
+    return flags::INF_JINJA_SUCCESS;
+}
+
+MBASE_END
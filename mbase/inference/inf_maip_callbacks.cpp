@@ -14,6 +14,8 @@ bool access_request_cb(InfProgram& in_program, [[maybe_unused]] std::shared_ptr<
     if(errCode == InfProgram::maip_err_code::INF_SUCCESS)
     {
         out_packet.set_kval("STOK", outToken);
+        out_packet.set_kval(MBASE_MAIP_FRAMING_KEY, mbase::string(MBASE_MAIP_FRAMING_TEXT));
+        out_packet.set_kval(MBASE_MAIP_FRAMING_KEY, mbase::string(MBASE_MAIP_FRAMING_BINARY));
     }
     out_packet.set_response_message((U16)errCode);
 
@@ -59,8 +61,33 @@ bool create_context_cb(InfProgram& in_program, [[maybe_unused]] std::shared_ptr<
 {
     mbase::string myModel = in_request.get_kval<mbase::string>("MODEL");
     U32 mCtxSize = in_request.get_kval<U32>("CTXSIZE");
+    mbase::string myAdapter;
+    if(in_request.has_key("ADAPTER"))
+    {
+        myAdapter = in_request.get_kval<mbase::string>("ADAPTER");
+    }
+
+    inf_kv_cache_type keyType = inf_kv_cache_type::F16;
+    inf_kv_cache_type valueType = inf_kv_cache_type::F16;
+    if(in_request.has_key("KTYPE") && !inf_common_kv_cache_type_from_string(in_request.get_kval<mbase::string>("KTYPE"), keyType))
+    {
+        out_packet.set_response_message((U16)InfProgram::maip_err_code::INF_INVALID_PARAMS);
+        return true;
+    }
+
+    if(in_request.has_key("VTYPE") && !inf_common_kv_cache_type_from_string(in_request.get_kval<mbase::string>("VTYPE"), valueType))
+    {
+        out_packet.set_response_message((U16)InfProgram::maip_err_code::INF_INVALID_PARAMS);
+        return true;
+    }
+
+    bool flashAttention = true;
+    if(in_request.has_key("FLASHATTN"))
+    {
+        flashAttention = in_request.get_kval<U32>("FLASHATTN") != 0;
+    }
 
-    InfProgram::maip_err_code errCode = in_program.inf_create_context(in_session_id, in_peer, myModel, mCtxSize);
+    InfProgram::maip_err_code errCode = in_program.inf_create_context(in_session_id, in_peer, myModel, mCtxSize, myAdapter, keyType, valueType, flashAttention);
     if(errCode == InfProgram::maip_err_code::INF_SUCCESS)
     {
         // If the operation is successful, program will own the client pointer
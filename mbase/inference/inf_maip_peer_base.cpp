@@ -31,6 +31,11 @@ const inf_model_category& InfMaipPeerBase::get_peer_category() const
     return mPeerCategory;
 }
 
+bool InfMaipPeerBase::is_binary_framing() const
+{
+    return mIsBinaryFraming;
+}
+
 InfProcessorBase* InfMaipPeerBase::get_processor_by_id(const U64& in_id)
 {
     return mIndexedProcMap[in_id];
@@ -65,6 +70,11 @@ GENERIC InfMaipPeerBase::set_maip_username(const mbase::string& in_user)
     mMaipUsername = in_user;
 }
 
+GENERIC InfMaipPeerBase::set_binary_framing(bool in_is_binary)
+{
+    mIsBinaryFraming = in_is_binary;
+}
+
 GENERIC InfMaipPeerBase::remove_processor_by_address(InfProcessorBase* in_address)
 {
     registered_processor_map::iterator It = mRegisteredProcMap.find(in_address);
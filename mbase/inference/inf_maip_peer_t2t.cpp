@@ -4,7 +4,9 @@
 
 MBASE_BEGIN
 
-InfMaipTextToTextProcessor::InfMaipTextToTextProcessor(InfMaipPeerTextToText* in_peer) : mClientNominee(in_peer)
+InfMaipTextToTextProcessor::InfMaipTextToTextProcessor(InfMaipPeerTextToText* in_peer, const mbase::string& in_adapter) : 
+    mClientNominee(in_peer),
+    mAdapterName(in_adapter)
 {
 
 }
@@ -16,6 +18,11 @@ GENERIC InfMaipTextToTextProcessor::on_initialize_fail(last_fail_code out_code)
 
 GENERIC InfMaipTextToTextProcessor::on_initialize()
 {
+    if(mAdapterName.size())
+    {
+        // attached by the processor thread before the first input is decoded
+        select_lora_adapter(mAdapterName);
+    }
     set_inference_client(mClientNominee);
 }
 
@@ -72,6 +79,10 @@ GENERIC InfMaipPeerTextToText::on_register(InfProcessorBase* out_processor)
 GENERIC InfMaipPeerTextToText::on_unregister(InfProcessorBase* out_processor)
 {  
     // Called if the processor being destroyed
+    if(mPausedProcessor == out_processor)
+    {
+        mPausedProcessor = NULL;
+    }
     remove_processor_by_address(out_processor);
     delete out_processor;
 }
@@ -86,39 +97,75 @@ GENERIC InfMaipPeerTextToText::on_write(InfProcessorTextToText* out_processor, c
     // Called every time a next token is generated
     inf_token_description tokenDescription;
     out_processor->token_to_description(out_token[0], tokenDescription);
-    out_processor->next({1, false});
+    if(mPeer->is_write_paused())
+    {
+        // the peer is behind on its output, the next token is requested when it drains
+        mPausedProcessor = out_processor;
+    }
+    else
+    {
+        out_processor->next({1, false});
+    }
     if(out_is_finish)
     {
         mLastToken = tokenDescription;
+        mLastTokenId = out_token[0];
         // After here, on_finish will be called on the next update
         return;
     }
 
-    if(mPeer->is_connected())
+    if(mPeer->is_connected() && is_binary_framing())
     {
-        mbase::maip_packet_builder tmpPacketBuilder;
-        mbase::string outPayload;
-        if(tokenDescription.mIsSpecial)
+        mbase::maip_binary_frame_builder frameBuilder;
+        frameBuilder.set_response_code((U16)InfProgram::maip_err_code::EXEC_MESSAGE_CONTINUE);
+        _add_binary_token(frameBuilder, out_token[0], tokenDescription);
+        for(size_type i = 1; i < out_token.size(); i++)
         {
-            tmpPacketBuilder.set_kval("SPECIAL", 1);
+            out_processor->token_to_description(out_token[i], tokenDescription);
+            _add_binary_token(frameBuilder, out_token[i], tokenDescription);
         }
-        else
+
+        if(frameBuilder.get_token_count())
         {
-            tmpPacketBuilder.set_kval("SPECIAL", 0);
+            _write_binary_frame(frameBuilder);
         }
+    }
 
-        tmpPacketBuilder.set_response_message((U16)InfProgram::maip_err_code::EXEC_MESSAGE_CONTINUE);
-        tmpPacketBuilder.generate_payload(outPayload, tokenDescription.mTokenString);
-        mPeer->write_data(outPayload.c_str(), outPayload.size());
-        mPeer->send_write_signal();
-        mPeer->send_read_signal();
+    else if(mPeer->is_connected())
+    {
+        _write_text_token((U16)InfProgram::maip_err_code::EXEC_MESSAGE_CONTINUE, tokenDescription);
     }
 }
 
 GENERIC InfMaipPeerTextToText::on_finish([[maybe_unused]] InfProcessorTextToText* out_processor, size_type out_total_token_size, InfProcessorTextToText::finish_state out_finish_state)
 {
     // Called if the token generation is finished for a reason stated in argument out_finish_state
-    if(mPeer->is_connected())
+    InfProgram::maip_err_code finishCode = InfProgram::maip_err_code::EXEC_MESSAGE_FINISH;
+    if(out_finish_state == InfProcessorTextToText::finish_state::FINISHED)
+    {
+    }
+
+    else if(out_finish_state == InfProcessorTextToText::finish_state::TOKEN_LIMIT_REACHED)
+    {
+        finishCode = InfProgram::maip_err_code::EXEC_TOKEN_LIMIT_EXCEEDED;
+    }
+
+    else if(out_finish_state == InfProcessorTextToText::finish_state::ABANDONED)
+    {
+        finishCode = InfProgram::maip_err_code::EXEC_ABANDONED;
+    }
+
+    if(mPeer->is_connected() && is_binary_framing())
+    {
+        mbase::maip_binary_frame_builder frameBuilder;
+        frameBuilder.set_response_code((U16)finishCode);
+        frameBuilder.set_total(static_cast<U32>(out_total_token_size));
+        _add_binary_token(frameBuilder, mLastTokenId, mLastToken);
+        // sent even without the token, it is the one that carries the finish code
+        _write_binary_frame(frameBuilder);
+    }
+
+    else if(mPeer->is_connected())
     {
         mbase::maip_packet_builder tmpPacketBuilder;
         mbase::string outPayload;
@@ -132,20 +179,6 @@ GENERIC InfMaipPeerTextToText::on_finish([[maybe_unused]] InfProcessorTextToText
             tmpPacketBuilder.set_kval("SPECIAL", 0);
         }
 
-        InfProgram::maip_err_code finishCode = InfProgram::maip_err_code::EXEC_MESSAGE_FINISH;
-        if(out_finish_state == InfProcessorTextToText::finish_state::FINISHED)
-        {
-        }
-
-        else if(out_finish_state == InfProcessorTextToText::finish_state::TOKEN_LIMIT_REACHED)
-        {
-            finishCode = InfProgram::maip_err_code::EXEC_TOKEN_LIMIT_EXCEEDED;
-        }
-
-        else if(out_finish_state == InfProcessorTextToText::finish_state::ABANDONED)
-        {
-            finishCode = InfProgram::maip_err_code::EXEC_ABANDONED;
-        }
         tmpPacketBuilder.set_kval("TOTAL", out_total_token_size);
         tmpPacketBuilder.set_response_message((U16)finishCode);
         tmpPacketBuilder.generate_payload(outPayload, mLastToken.mTokenString);
@@ -155,4 +188,76 @@ GENERIC InfMaipPeerTextToText::on_finish([[maybe_unused]] InfProcessorTextToText
     }
 }
 
+GENERIC InfMaipPeerTextToText::_write_binary_frame(mbase::maip_binary_frame_builder& in_frame_builder)
+{
+    mbase::string outPayload;
+    in_frame_builder.generate_payload(outPayload);
+    mPeer->write_data(outPayload.c_str(), outPayload.size());
+    mPeer->send_write_signal();
+    mPeer->send_read_signal();
+}
+
+GENERIC InfMaipPeerTextToText::_write_text_token(U16 in_response_code, const inf_token_description& in_description)
+{
+    mbase::maip_packet_builder tmpPacketBuilder;
+    mbase::string outPayload;
+    if(in_description.mIsSpecial)
+    {
+        tmpPacketBuilder.set_kval("SPECIAL", 1);
+    }
+    else
+    {
+        tmpPacketBuilder.set_kval("SPECIAL", 0);
+    }
+
+    tmpPacketBuilder.set_response_message(in_response_code);
+    tmpPacketBuilder.generate_payload(outPayload, in_description.mTokenString);
+    mPeer->write_data(outPayload.c_str(), outPayload.size());
+    mPeer->send_write_signal();
+    mPeer->send_read_signal();
+}
+
+GENERIC InfMaipPeerTextToText::_add_binary_token(mbase::maip_binary_frame_builder& in_frame_builder, inf_text_token in_token, const inf_token_description& in_description)
+{
+    using builder_flags = mbase::maip_binary_frame_builder::flags;
+    builder_flags addResult = in_frame_builder.add_token(in_token, in_description.mTokenString, in_description.mIsSpecial);
+    if(addResult == builder_flags::BINARY_BUILDER_SUCCESS)
+    {
+        return;
+    }
+
+    // the tokens so far go out first so the order is kept, the frame keeps its response code and total
+    const U16 frameResponseCode = in_frame_builder.get_response_code();
+    const U32 frameTotal = in_frame_builder.get_total();
+    if(in_frame_builder.get_token_count())
+    {
+        in_frame_builder.set_response_code((U16)InfProgram::maip_err_code::EXEC_MESSAGE_CONTINUE);
+        in_frame_builder.set_total(0);
+        _write_binary_frame(in_frame_builder);
+        in_frame_builder.clear();
+        in_frame_builder.set_response_code(frameResponseCode);
+        in_frame_builder.set_total(frameTotal);
+    }
+
+    if(addResult == builder_flags::BINARY_BUILDER_ERR_TOO_MANY_TOKENS && in_frame_builder.add_token(in_token, in_description.mTokenString, in_description.mIsSpecial) == builder_flags::BINARY_BUILDER_SUCCESS)
+    {
+        return;
+    }
+
+    // a piece longer than a frame can describe, the client takes a text message in between the frames
+    _write_text_token((U16)InfProgram::maip_err_code::EXEC_MESSAGE_CONTINUE, in_description);
+}
+
+GENERIC InfMaipPeerTextToText::resume_output()
+{
+    if(!mPausedProcessor)
+    {
+        return;
+    }
+
+    InfProcessorTextToText* pausedProcessor = mPausedProcessor;
+    mPausedProcessor = NULL;
+    pausedProcessor->next({1, false});
+}
+
 MBASE_END
\ No newline at end of file
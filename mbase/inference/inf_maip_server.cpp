@@ -3,6 +3,7 @@
 #include <mbase/char_stream.h>
 #include <mbase/io_file.h>
 #include <set>
+#include <algorithm>
 
 MBASE_BEGIN
 
@@ -13,137 +14,201 @@ GENERIC InfMaipServerBase::on_accept(std::shared_ptr<PcNetPeerClient> out_peer)
 
 GENERIC InfMaipServerBase::on_data(std::shared_ptr<PcNetPeerClient> out_peer, CBYTEBUFFER out_data, size_type out_size)
 {
-	mbase::string receivedData(out_data, out_size);
-	accumulation_map::iterator It = mAccumulationMap.find(out_peer->get_raw_socket());
-	if(It != mAccumulationMap.end())
+	InfMaipRequestFramer& requestFramer = mFramerMap[out_peer->get_raw_socket()];
+	if(requestFramer.mDiscardLength)
 	{
-		accumulated_processing(out_peer, It, out_data, out_size);
+		size_type skippedBytes = out_size < requestFramer.mDiscardLength ? out_size : static_cast<size_type>(requestFramer.mDiscardLength);
+		requestFramer.mDiscardLength -= skippedBytes;
+		out_data += skippedBytes;
+		out_size -= skippedBytes;
 	}
-	else
+
+	if(requestFramer.mPendingData.size())
 	{
-		simple_processing(out_peer, out_data, out_size);
+		requestFramer.mPendingData.append(out_data, out_size);
+		size_type consumedBytes = frame_requests(out_peer, requestFramer, requestFramer.mPendingData.c_str(), requestFramer.mPendingData.size());
+		requestFramer.mPendingData.erase(0, consumedBytes);
+	}
+	else if(out_size)
+	{
+		size_type consumedBytes = frame_requests(out_peer, requestFramer, out_data, out_size);
+		if(consumedBytes < out_size)
+		{
+			requestFramer.mPendingData.append(out_data + consumedBytes, out_size - consumedBytes);
+		}
+	}
+
+	if(requestFramer.mPendingData.size() || requestFramer.mDiscardLength || !out_size)
+	{
+		// the rest of a request is yet to arrive
+		out_peer->send_read_signal();
 	}
 }
 
 GENERIC InfMaipServerBase::on_disconnect(std::shared_ptr<PcNetPeerClient> out_peer)
 {
-	// Remove the peer from accumulation map if it exists
-	mAccumulationMap.erase(out_peer->get_raw_socket());
+	// Remove the peer from framer map if it exists
+	mFramerMap.erase(out_peer->get_raw_socket());
 }
 
-GENERIC InfMaipServerBase::register_request_callback(const mbase::string& in_operation, maip_request_callback in_callback)
+GENERIC InfMaipServerBase::on_write_drained(std::shared_ptr<PcNetPeerClient> out_peer)
 {
-	mRequestCbMap[in_operation] = in_callback;
+	if(mHandoff)
+	{
+		mHandoff->post(PcNetHandoffQueue::event_type::NET_HANDOFF_WRITE_DRAINED, out_peer);
+		return;
+	}
+	on_output_drained(out_peer);
+}
+
+GENERIC InfMaipServerBase::on_output_drained([[maybe_unused]] std::shared_ptr<PcNetPeerClient> out_peer)
+{
+
+}
+
+GENERIC InfMaipServerBase::set_handoff(PcNetHandoffQueue* in_handoff) noexcept
+{
+	mHandoff = in_handoff;
 }
 
-GENERIC InfMaipServerBase::accumulated_processing(std::shared_ptr<PcNetPeerClient> out_peer, accumulation_map::iterator in_accum_iterator, CBYTEBUFFER out_data, size_type out_size)
+GENERIC InfMaipServerBase::dispatch_handoff(PcNetHandoffQueue& in_handoff)
 {
-	InfMaipPacketAccumulator& in_accumulator = in_accum_iterator->second;
-	mbase::string& accumulatedData = in_accumulator.mAccumulatedData;
-	if(out_size)
+	in_handoff.take_all(mHandoffEvents);
+	for(PcNetHandoffQueue::handoff_event& handoffEvent : mHandoffEvents)
 	{
-		size_type dataToWrite = out_size;
-		if(accumulatedData.size() + out_size > in_accumulator.mDataToRead)
+		if(handoffEvent.mType == PcNetHandoffQueue::event_type::NET_HANDOFF_WRITE_DRAINED)
 		{
-			dataToWrite -= (accumulatedData.size() + out_size) - in_accumulator.mDataToRead; // DISCARD THE REST
+			on_output_drained(handoffEvent.mPeer);
+			continue;
 		}
-		accumulatedData.append(out_data, dataToWrite);
-		if(accumulatedData.size() == in_accumulator.mDataToRead)
+
+		// the shard framed and validated the request, the body follows the header
+		static const IBYTE headerEnding[] = "\nEND\n";
+		mbase::string& requestData = handoffEvent.mData;
+		size_type headerLength = requestData.find(headerEnding) + sizeof(headerEnding) - 1;
+		mbase::char_stream headerStream(requestData.data(), headerLength);
+		maip_peer_request maipPeerRequest;
+		if(maipPeerRequest.parse_request(headerStream) != maip_generic_errors::SUCCESS)
 		{
-			maip_peer_request& mMaipPeerRequest = in_accumulator.mPeerRequest;
-			const maip_request_identification& outIdentification = mMaipPeerRequest.get_identification();
-			mbase::char_stream dataStream(accumulatedData.data(), accumulatedData.size());
-			mMaipPeerRequest.set_external_data(dataStream);
-			if (outIdentification.mOpType == MBASE_MAIP_INF_OP_TYPE)
-			{
-				on_informatic_request(mMaipPeerRequest, out_peer);
-			}
-			else if (outIdentification.mOpType == MBASE_MAIP_EXEC_OP_TYPE)
-			{
-				on_execution_request(mMaipPeerRequest, out_peer);
-			}
-			else
-			{
-				on_custom_request(mMaipPeerRequest, out_peer);
-			}
-			mAccumulationMap.erase(in_accum_iterator);
-			return;
+			continue;
 		}
-		out_peer->send_read_signal();
 
+		if(requestData.size() > headerLength)
+		{
+			mbase::char_stream bodyStream(requestData.data() + headerLength, requestData.size() - headerLength);
+			maipPeerRequest.set_external_data(bodyStream);
+		}
+		dispatch_request(handoffEvent.mPeer, maipPeerRequest);
 	}
+	mHandoffEvents.clear();
+}
+
+GENERIC InfMaipServerBase::register_request_callback(const mbase::string& in_operation, maip_request_callback in_callback)
+{
+	mRequestCbMap[in_operation] = in_callback;
 }
 
-GENERIC InfMaipServerBase::simple_processing(std::shared_ptr<PcNetPeerClient> out_peer, CBYTEBUFFER out_data, size_type out_size)
+typename InfMaipServerBase::size_type InfMaipServerBase::frame_requests(std::shared_ptr<PcNetPeerClient> out_peer, InfMaipRequestFramer& in_framer, CBYTEBUFFER in_data, size_type in_size)
 {
-	mbase::string maipRequest(out_data, out_size);
-	mbase::char_stream cs(const_cast<IBYTEBUFFER>(out_data), out_size);
+	static const IBYTE headerEnding[] = "\nEND\n";
+	const size_type headerEndingLength = sizeof(headerEnding) - 1;
 
-	maip_peer_request mMaipPeerRequest;
-	maip_generic_errors tempGenericError = mMaipPeerRequest.parse_request(cs);
-	if (tempGenericError == maip_generic_errors::SUCCESS)
+	size_type consumedBytes = 0;
+	while(consumedBytes < in_size)
 	{
-		U32 messageContentLength = mMaipPeerRequest.get_content_length();
-		if (messageContentLength != 0)
+		CBYTEBUFFER requestBegin = in_data + consumedBytes;
+		size_type availableBytes = in_size - consumedBytes;
+		CBYTEBUFFER headerEnd = std::search(requestBegin, requestBegin + availableBytes, headerEnding, headerEnding + headerEndingLength);
+		if(headerEnd == requestBegin + availableBytes)
 		{
-			//cs.advance();
-			U32 messageSize = cs.get_difference();
-			if (messageSize >= messageContentLength) // rest of the message will be discarded
+			if(availableBytes > gMaipMaxHeaderLength)
 			{
-				mbase::char_stream charStream(cs.get_bufferc(), messageSize);
-				tempGenericError = mMaipPeerRequest.parse_data(charStream);
+				// there is no way to find the next request in the stream
+				send_generic_error(out_peer, maip_generic_errors::PACKET_TOO_LARGE);
+				out_peer->disconnect();
+				return in_size;
 			}
-			else
+			return consumedBytes;
+		}
+
+		size_type headerLength = (headerEnd - requestBegin) + headerEndingLength;
+		mbase::char_stream headerStream(const_cast<IBYTEBUFFER>(requestBegin), headerLength);
+		maip_peer_request maipPeerRequest;
+		maip_generic_errors parseResult = maipPeerRequest.parse_request(headerStream);
+		I64 contentLength = parseResult == maip_generic_errors::SUCCESS ? maipPeerRequest.get_content_length() : 0;
+		if(contentLength < 0)
+		{
+			parseResult = maip_generic_errors::DATA_LENGTH_INCONSISTENCY;
+			contentLength = 0;
+		}
+		else if(contentLength > gMaipMaxContentLength)
+		{
+			parseResult = maip_generic_errors::PACKET_TOO_LARGE;
+		}
+
+		size_type bodyBytes = availableBytes - headerLength;
+		if(parseResult == maip_generic_errors::SUCCESS && bodyBytes < static_cast<size_type>(contentLength))
+		{
+			// the body continues in the next reads, clients without a session are not allowed to send those
+			if(maipPeerRequest.has_key("STOK"))
 			{
-				// means we will accumulate
-				// if the client does not have a session token,
-				// accumulation is not allowed.
-				if (!mMaipPeerRequest.has_key("STOK"))
-				{
-					tempGenericError = maip_generic_errors::MISSING_MANDATORY_KEYS;
-				}
-
-				else
-				{
-					// TODO: CHECK IF THE MESSAGE CONTENT LENGTH IS BIGGER THAN 20 MB
-					// IF IT IS, RETURN PACKET TOO LARGE
-					mbase::string sessionToken = mMaipPeerRequest.get_kval<mbase::string>("STOK");
-					mbase::string processedDataLength;
-					processedDataLength.reserve(messageContentLength);
-					if (messageSize)
-					{
-						cs.advance();
-						processedDataLength.append(cs.get_bufferc(), messageSize - 1);
-					}
-					mAccumulationMap[out_peer->get_raw_socket()] = { messageContentLength, sessionToken, std::move(processedDataLength), mMaipPeerRequest };
-					out_peer->send_read_signal();
-					return;
-				}
+				in_framer.mPendingData.reserve(headerLength + contentLength);
+				return consumedBytes;
 			}
+			parseResult = maip_generic_errors::MISSING_MANDATORY_KEYS;
 		}
-	}
 
-	if (tempGenericError == maip_generic_errors::SUCCESS)
-	{
-		const maip_request_identification& outIdentification = mMaipPeerRequest.get_identification();
+		if(parseResult != maip_generic_errors::SUCCESS)
+		{
+			send_generic_error(out_peer, parseResult);
+			if(bodyBytes < static_cast<size_type>(contentLength))
+			{
+				in_framer.mDiscardLength = contentLength - bodyBytes;
+				return in_size;
+			}
+			consumedBytes += headerLength + contentLength;
+			continue;
+		}
 
-		if (outIdentification.mOpType == MBASE_MAIP_INF_OP_TYPE)
+		if(contentLength)
 		{
-			on_informatic_request(mMaipPeerRequest, out_peer);
+			mbase::char_stream bodyStream(const_cast<IBYTEBUFFER>(requestBegin + headerLength), contentLength);
+			maipPeerRequest.set_external_data(bodyStream);
 		}
-		else if (outIdentification.mOpType == MBASE_MAIP_EXEC_OP_TYPE)
+		if(mHandoff)
 		{
-			on_execution_request(mMaipPeerRequest, out_peer);
+			mHandoff->post(PcNetHandoffQueue::event_type::NET_HANDOFF_DATA, out_peer, requestBegin, headerLength + contentLength);
 		}
 		else
 		{
-			on_custom_request(mMaipPeerRequest, out_peer);
+			dispatch_request(out_peer, maipPeerRequest);
 		}
-		return;
+		consumedBytes += headerLength + contentLength;
 	}
+	return consumedBytes;
+}
 
+GENERIC InfMaipServerBase::dispatch_request(std::shared_ptr<PcNetPeerClient> out_peer, const maip_peer_request& in_request)
+{
+	const maip_request_identification& outIdentification = in_request.get_identification();
+	if (outIdentification.mOpType == MBASE_MAIP_INF_OP_TYPE)
+	{
+		on_informatic_request(in_request, out_peer);
+	}
+	else if (outIdentification.mOpType == MBASE_MAIP_EXEC_OP_TYPE)
+	{
+		on_execution_request(in_request, out_peer);
+	}
+	else
+	{
+		on_custom_request(in_request, out_peer);
+	}
+}
+
+GENERIC InfMaipServerBase::send_generic_error(std::shared_ptr<PcNetPeerClient> out_peer, maip_generic_errors in_error)
+{
 	maip_packet_builder tmpPacketBuilder;
-	U16 genericErrorCode = (U16)tempGenericError;
+	U16 genericErrorCode = (U16)in_error;
 	mbase::string outMessage;
 	tmpPacketBuilder.set_version(1, 0); // make it customizable
 	tmpPacketBuilder.set_response_message(genericErrorCode);
@@ -196,8 +261,8 @@ InfMaipDefaultServer::InfMaipDefaultServer(InfProgram& in_program)
 
 GENERIC InfMaipDefaultServer::on_informatic_request(const maip_peer_request& out_request, std::shared_ptr<PcNetPeerClient> out_peer)
 {
-	const mbase::string& requestString = out_request.get_identification().mOpString;
-	request_callback_map::iterator cbIt = mRequestCbMap.find(requestString);
+	std::string_view requestString = out_request.get_identification().mOpString;
+	request_callback_map::iterator cbIt = mRequestCbMap.find(mbase::string(requestString.data(), requestString.size()));
 	maip_packet_builder packetBuilder;
 	packetBuilder.set_version(1, 0); // TODO: Get the version from macros
 	
@@ -225,7 +290,7 @@ GENERIC InfMaipDefaultServer::on_informatic_request(const maip_peer_request& out
 
 GENERIC InfMaipDefaultServer::on_execution_request(const maip_peer_request& out_request, std::shared_ptr<PcNetPeerClient> out_peer)
 {
-	const mbase::string& requestString = out_request.get_identification().mOpString;
+	std::string_view requestString = out_request.get_identification().mOpString;
 	mbase::string sessionToken = out_request.get_kval<mbase::string>("STOK");
 	U64 contextId = out_request.get_kval<U64>("CTXID");
 	mbase::maip_packet_builder maipPacketBuilder;
@@ -271,7 +336,8 @@ GENERIC InfMaipDefaultServer::on_execution_request(const maip_peer_request& out_
 	else if(requestString == "exec_next")
 	{
 		// WILL ACQUIRE THE SOCKET ON SUCCESS
-		maipErr = mHostProgram->exec_next(sessionToken, out_peer, contextId);
+		bool isBinaryFraming = out_request.get_kval<mbase::string>(MBASE_MAIP_FRAMING_KEY) == MBASE_MAIP_FRAMING_BINARY;
+		maipErr = mHostProgram->exec_next(sessionToken, out_peer, contextId, isBinaryFraming);
 		if(maipErr == mbase::InfProgram::maip_err_code::EXEC_SUCCESS)
 		{
 			return;
@@ -290,8 +356,14 @@ GENERIC InfMaipDefaultServer::on_custom_request([[maybe_unused]] const maip_peer
 
 }
 
+GENERIC InfMaipDefaultServer::on_output_drained(std::shared_ptr<PcNetPeerClient> out_peer)
+{
+	mHostProgram->resume_peer_output(out_peer);
+}
+
 GENERIC InfMaipDefaultServer::on_listen()
 {
+	set_diagnostics(mHostProgram->get_diagnostics_manager());
 	std::cout << "Maip server started listening" << std::endl;
 }
 
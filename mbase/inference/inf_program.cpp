@@ -1,5 +1,6 @@
 #include <mbase/inference/inf_program.h>
 #include <mbase/inference/inf_t2t_model.h>
+#include <mbase/inference/inf_t2t_proc_diagnostics.h>
 #include <mbase/inference/inf_embedder.h>
 #include <mbase/inference/inf_maip_peer_t2t.h>
 #include <mbase/maip_parser.h>
@@ -73,6 +74,18 @@ bool InfProgram::is_session_token_valid(const mbase::string& in_session_token)
 	return true;
 }
 
+GENERIC InfProgram::resume_peer_output(std::shared_ptr<PcNetPeerClient> in_peer)
+{
+	for(accepted_client_map::iterator It = mSessionMap.begin(); It != mSessionMap.end(); ++It)
+	{
+		InfMaipPeerBase* clientSession = It->second;
+		if(clientSession->get_maip_peer() == in_peer && clientSession->get_peer_category() == inf_model_category::TEXT_TO_TEXT)
+		{
+			static_cast<InfMaipPeerTextToText*>(clientSession)->resume_output();
+		}
+	}
+}
+
 typename InfProgram::accepted_client_map& InfProgram::get_accepted_clients()
 {
 	return mSessionMap;
@@ -171,7 +184,7 @@ InfProgram::maip_err_code InfProgram::inf_get_context_ids(const mbase::string& i
 	return maip_err_code::INF_SUCCESS;
 }
 
-InfProgram::maip_err_code InfProgram::inf_create_context(const mbase::string& in_session_token, std::shared_ptr<mbase::PcNetPeerClient> in_peer, const mbase::string& in_model, const U32& in_ctsize)
+InfProgram::maip_err_code InfProgram::inf_create_context(const mbase::string& in_session_token, std::shared_ptr<mbase::PcNetPeerClient> in_peer, const mbase::string& in_model, const U32& in_ctsize, const mbase::string& in_adapter, inf_kv_cache_type in_key_type, inf_kv_cache_type in_value_type, bool in_flash_attention)
 {
 	MBASE_SESSION_CONTROL;
 	
@@ -188,7 +201,11 @@ InfProgram::maip_err_code InfProgram::inf_create_context(const mbase::string& in
 	// 9- Check if the available context length of the model is sufficent to create the given context
 	// 10- If not, return INF_MODEL_CONTEXT_FULL(2019)
 	// 11- If the model is embedding model, create and register embedder processor
-	// 12- If the model is not embedding model, create and register T2T processor
+	// 12- If the model is not embedding model, check the given LoRA adapter if any
+	// 13- If the model doesn't have it, return INF_LORA_ADAPTER_MISSING(2032)
+	// 14- Check if the model has the context length and the memory for the kv cache of the given types
+	// 15- If it doesn't have the memory, return INF_MODEL_MEMORY_BUDGET_EXCEEDED(2033), otherwise INF_MODEL_UNAVAILABLE(2031)
+	// 16- Create and register T2T processor, it selects the adapter when it is initialized
 
 	// CHECK NOTE: CHECK THE handlers on_initialize and on_initialize_fail then come back here again.
 	InfMaipUser& maipUser = mUserMap[clientSession->get_maip_username()];
@@ -229,11 +246,23 @@ InfProgram::maip_err_code InfProgram::inf_create_context(const mbase::string& in
 	{
 		InfMaipModelTextToText* t2tModel = static_cast<InfMaipModelTextToText*>(It2->second);
 		InfMaipPeerTextToText* t2tClient = static_cast<InfMaipPeerTextToText*>(clientSession);
-		InfMaipTextToTextProcessor* t2tProc = new InfMaipTextToTextProcessor(t2tClient);
 
-		if(!t2tModel->is_available(in_ctsize))
+		inf_lora_adapter selectedAdapter;
+		if(in_adapter.size() && !t2tModel->has_lora_adapter(in_adapter, selectedAdapter))
+		{
+			return maip_err_code::INF_LORA_ADAPTER_MISSING;
+		}
+
+		InfMaipTextToTextProcessor* t2tProc = new InfMaipTextToTextProcessor(t2tClient, in_adapter);
+		t2tProc->set_kv_cache_types(in_key_type, in_value_type);
+
+		if(!t2tModel->is_available(in_ctsize, in_key_type, in_value_type))
 		{
 			delete t2tProc;
+			if(t2tModel->get_memory_budget() && t2tModel->get_occupied_memory() + t2tModel->get_kv_cache_size(in_ctsize, in_key_type, in_value_type) > t2tModel->get_memory_budget())
+			{
+				return maip_err_code::INF_MODEL_MEMORY_BUDGET_EXCEEDED;
+			}
 			return maip_err_code::INF_MODEL_UNAVAILABLE;
 		}
 
@@ -243,12 +272,18 @@ InfProgram::maip_err_code InfProgram::inf_create_context(const mbase::string& in
 			maipUser.get_batch_size(),
 			maipUser.get_processor_thread_count(),
 			maipUser.get_processor_thread_count()/2,
-			true,
+			in_flash_attention,
 			maipUser.get_sampling_set()
 		);
 
 		clientSession->set_network_peer(in_peer);
 
+		if(rgrResult == InfModelTextToText::flags::INF_MODEL_ERR_MEMORY_BUDGET_EXCEEDED)
+		{
+			delete t2tProc;
+			return maip_err_code::INF_MODEL_MEMORY_BUDGET_EXCEEDED;
+		}
+
 		if(rgrResult != InfModelTextToText::flags::INF_MODEL_INFO_REGISTERING_PROCESSOR)
 		{
 			delete t2tProc;
@@ -1378,7 +1413,7 @@ InfProgram::maip_err_code InfProgram::exec_execute_input(const mbase::string& in
 	}
 }
 
-InfProgram::maip_err_code InfProgram::exec_next(const mbase::string& in_session_token, std::shared_ptr<mbase::PcNetPeerClient> in_peer, const U64& in_ctxId)
+InfProgram::maip_err_code InfProgram::exec_next(const mbase::string& in_session_token, std::shared_ptr<mbase::PcNetPeerClient> in_peer, const U64& in_ctxId, bool in_binary_framing)
 {
 	MBASE_SESSION_CONTROL;
 	InfProcessorBase* targetProcessor = clientSession->get_processor_by_id(in_ctxId);
@@ -1401,6 +1436,7 @@ InfProgram::maip_err_code InfProgram::exec_next(const mbase::string& in_session_
 				return maip_err_code::INF_CONTEXT_HALTED;
 			}
 			clientSession->set_network_peer(in_peer);
+			clientSession->set_binary_framing(in_binary_framing);
 			return maip_err_code::EXEC_MESSAGE_CONTINUE;
 		}
 		else
@@ -1681,6 +1717,38 @@ InfProgram::maip_err_code InfProgram::common_description_modification_control(In
 	return maip_err_code::INF_SUCCESS;
 }
 
+GENERIC InfProgram::write_prometheus_metrics(mbase::string& out_text)
+{
+	// per processor series plus one processor="all" series per model, merged from its processors
+	mbase::vector<inf_t2t_diagnostics_source> diagSources;
+	for(registered_model_map::iterator It = mRegisteredModels.begin(); It != mRegisteredModels.end(); ++It)
+	{
+		if(It->second->get_model_category() != inf_model_category::TEXT_TO_TEXT)
+		{
+			continue;
+		}
+
+		InfModelTextToText* t2tModel = static_cast<InfModelTextToText*>(It->second);
+		mbase::string modelLabel = "model=\"" + InfHistogram::escape_prometheus_label(It->first) + "\"";
+		t2tModel->append_diagnostics_sources(modelLabel, diagSources);
+
+		InfProcT2TDiagnostics* mergedDiagnostics = new InfProcT2TDiagnostics;
+		t2tModel->merge_processor_diagnostics(*mergedDiagnostics);
+
+		inf_t2t_diagnostics_source modelSource;
+		modelSource.mLabels = modelLabel + ",processor=\"all\"";
+		modelSource.mDiagnostics = mergedDiagnostics;
+		diagSources.push_back(modelSource);
+	}
+
+	InfProcT2TDiagnostics::write_prometheus("mbase_maip_t2t_", diagSources, out_text);
+
+	for(inf_t2t_diagnostics_source& tmpSource : diagSources)
+	{
+		delete tmpSource.mDiagnostics;
+	}
+}
+
 GENERIC InfProgram::update()
 {
 	for(actively_loading_models::iterator It = mLoadingModels.begin(); It != mLoadingModels.end();)
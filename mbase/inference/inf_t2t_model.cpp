@@ -25,10 +25,13 @@ if(!this->is_initialized())\
 
 InfModelTextToText::InfModelTextToText() :
 	mModel(NULL),
+	mIsChatTemplateEmbedded(false),
 	mEndOfToken(0),
 	mModelSize(0),
 	mOccupiedContext(0),
 	mTotalContextSize(0),
+	mOccupiedKvMemory(0),
+	mMemoryBudget(0),
 	mQuantizationCoefficient(0.0f),
 	mIsEmbeddingModel(false)
 {
@@ -56,6 +59,7 @@ InfModelTextToText::~InfModelTextToText()
 			}
 		}
 		
+		mGrammarCache.clear(); // compiled grammars refer to the model vocabulary
 		llama_model_free(mModel);
 	}
 }
@@ -70,7 +74,7 @@ bool InfModelTextToText::signal_state_lora_operation() const
 	return mLoraOperationSignal.get_signal_state();
 }
 
-bool InfModelTextToText::is_available(const U32& in_context_size) const
+bool InfModelTextToText::is_available(const U32& in_context_size, inf_kv_cache_type in_key_type, inf_kv_cache_type in_value_type) const
 {
 	if (this->signal_state_initializing())
 	{
@@ -88,6 +92,10 @@ bool InfModelTextToText::is_available(const U32& in_context_size) const
 	{
 		return false;
 	}
+	if(mMemoryBudget && get_occupied_memory() + get_kv_cache_size(in_context_size, in_key_type, in_value_type) > mMemoryBudget)
+	{
+		return false;
+	}
 	return true;
 }
 
@@ -100,8 +108,9 @@ bool InfModelTextToText::has_lora_adapter(const mbase::string& in_name, inf_lora
 {
 	inf_lora_adapter loraAdapter;
 	loraAdapter.mAdapterName = in_name;
+	mbase::lock_guard tmpLoraMutex(mLoraMutex);
 	mbase::vector<inf_lora_adapter>::iterator It = mbase::find(mLoraAdapters.begin(), mLoraAdapters.end(), loraAdapter);
-	if(It != mLoraAdapters.end())
+	if(It == mLoraAdapters.end())
 	{
 		return false;
 	}
@@ -111,6 +120,7 @@ bool InfModelTextToText::has_lora_adapter(const mbase::string& in_name, inf_lora
 
 mbase::vector<inf_lora_adapter> InfModelTextToText::get_adapters() const
 {
+	mbase::lock_guard tmpLoraMutex(mLoraMutex);
 	return mLoraAdapters;
 }
 
@@ -119,6 +129,11 @@ llama_model* InfModelTextToText::get_raw_model()
 	return mModel;
 }
 
+InfGrammarCache& InfModelTextToText::get_grammar_cache()
+{
+	return mGrammarCache;
+}
+
 mbase::vector<inf_text_token> InfModelTextToText::get_special_tokens() const
 {
 	mbase::vector<inf_text_token> out_tokens;
@@ -185,7 +200,7 @@ const mbase::string& InfModelTextToText::get_sys_end() const
 
 const mbase::string& InfModelTextToText::get_assistant_end() const
 {
-	return mAssistantStart;
+	return mAssistantEnd;
 }
 
 const mbase::string& InfModelTextToText::get_usr_end() const
@@ -193,6 +208,33 @@ const mbase::string& InfModelTextToText::get_usr_end() const
 	return mUserEnd;
 }
 
+const inf_chat_fragment& InfModelTextToText::get_role_start_fragment(context_role in_role) const
+{
+	static const inf_chat_fragment emptyFragment;
+	return in_role == context_role::NONE ? emptyFragment : mRoleStartFragments[static_cast<U32>(in_role)];
+}
+
+const inf_chat_fragment& InfModelTextToText::get_role_end_fragment(context_role in_role) const
+{
+	static const inf_chat_fragment emptyFragment;
+	return in_role == context_role::NONE ? emptyFragment : mRoleEndFragments[static_cast<U32>(in_role)];
+}
+
+const inf_chat_fragment& InfModelTextToText::get_conversation_start_fragment() const
+{
+	return mConversationStart;
+}
+
+InfJinjaTemplate& InfModelTextToText::get_chat_template()
+{
+	return mChatTemplate;
+}
+
+bool InfModelTextToText::is_chat_template_embedded() const
+{
+	return mIsChatTemplateEmbedded;
+}
+
 inf_text_token InfModelTextToText::get_eot_token() const
 {
 	const llama_vocab* tmpVocab = llama_model_get_vocab(mModel);
@@ -286,6 +328,66 @@ const U32& InfModelTextToText::get_occupied_context_size() const
 	return mOccupiedContext;
 }
 
+U64 InfModelTextToText::get_kv_cache_size(const U32& in_context_length, inf_kv_cache_type in_key_type, inf_kv_cache_type in_value_type) const
+{
+	if(!mModel)
+	{
+		return 0;
+	}
+
+	const U64 headCount = llama_model_n_head(mModel);
+	const U64 kvHeadCount = llama_model_n_head_kv(mModel);
+	if(!headCount || !kvHeadCount)
+	{
+		return 0;
+	}
+
+	// head dimensions default to n_embd / n_head, the architectures that differ store them in the metadata
+	U64 keyHeadLength = llama_model_n_embd(mModel) / headCount;
+	U64 valueHeadLength = keyHeadLength;
+	auto readHeadLength = [this](const mbase::string& in_key, U64& out_length) {
+		char metaValue[32] = {0};
+		if(llama_model_meta_val_str(mModel, in_key.c_str(), metaValue, sizeof(metaValue)) > 0)
+		{
+			U64 tmpLength = std::strtoull(metaValue, NULL, 10);
+			if(tmpLength)
+			{
+				out_length = tmpLength;
+			}
+		}
+	};
+	readHeadLength(mModelArchitecture + ".attention.key_length", keyHeadLength);
+	readHeadLength(mModelArchitecture + ".attention.value_length", valueHeadLength);
+
+	auto rowSize = [](inf_kv_cache_type in_type, U64 in_elements) -> U64 {
+		ggml_type tmpType = inf_common_kv_cache_ggml_type(in_type);
+		U64 blockSize = ggml_blck_size(tmpType);
+		return ggml_type_size(tmpType) * ((in_elements + blockSize - 1) / blockSize);
+	};
+
+	const U64 perTokenSize = rowSize(in_key_type, keyHeadLength * kvHeadCount) + rowSize(in_value_type, valueHeadLength * kvHeadCount);
+	return perTokenSize * llama_model_n_layer(mModel) * in_context_length;
+}
+
+U64 InfModelTextToText::get_occupied_memory() const
+{
+	if(!mModel)
+	{
+		return 0;
+	}
+	return get_size() + mOccupiedKvMemory;
+}
+
+const U64& InfModelTextToText::get_memory_budget() const
+{
+	return mMemoryBudget;
+}
+
+GENERIC InfModelTextToText::set_memory_budget(const U64& in_bytes)
+{
+	mMemoryBudget = in_bytes;
+}
+
 InfModelTextToText::flags InfModelTextToText::initialize_model_ex(const mbase::wstring& in_path, const U32& in_total_context_size, const I32& in_gpu_layers, bool in_use_mmap, bool in_use_mlock, mbase::vector<InfDeviceDescription> in_devices)
 {
 	if(is_initialized())
@@ -483,7 +585,14 @@ InfModelTextToText::flags InfModelTextToText::register_context_process
 		return flags::INF_MODEL_ERR_MODEL_CONTEXT_FULL;
 	}
 
+	const U64 kvCacheSize = get_kv_cache_size(in_context_length, in_processor->get_key_cache_type(), in_processor->get_value_cache_type());
+	if(mMemoryBudget && get_occupied_memory() + kvCacheSize > mMemoryBudget)
+	{
+		return flags::INF_MODEL_ERR_MEMORY_BUDGET_EXCEEDED;
+	}
+
 	mOccupiedContext += in_context_length;
+	mOccupiedKvMemory += kvCacheSize;
 
 	if(!in_batch_size)
 	{
@@ -516,6 +625,8 @@ InfModelTextToText::flags InfModelTextToText::register_context_process
 	watcher_type& newWatcher = mRegisteredProcessors.back();
 	newWatcher.mItSelf = mRegisteredProcessors.end_node();
 	newWatcher.mSubject = in_processor;
+	newWatcher.mContextLength = in_context_length;
+	newWatcher.mMemorySize = kvCacheSize;
 	in_processor->acquire_object_watcher(&newWatcher);
 	mProcessorListMutex.release();
 	return flags::INF_MODEL_INFO_REGISTERING_PROCESSOR;
@@ -565,7 +676,14 @@ InfModelTextToText::flags InfModelTextToText::register_context_process
 		return flags::INF_MODEL_ERR_MODEL_CONTEXT_FULL;
 	}
 
+	const U64 kvCacheSize = get_kv_cache_size(in_context_length, inf_kv_cache_type::F16, inf_kv_cache_type::F16);
+	if(mMemoryBudget && get_occupied_memory() + kvCacheSize > mMemoryBudget)
+	{
+		return flags::INF_MODEL_ERR_MEMORY_BUDGET_EXCEEDED;
+	}
+
 	mOccupiedContext += in_context_length;
+	mOccupiedKvMemory += kvCacheSize;
 
 	if(!in_thread_count)
 	{
@@ -584,6 +702,8 @@ InfModelTextToText::flags InfModelTextToText::register_context_process
 	watcher_type& newWatcher = mRegisteredProcessors.back();
 	newWatcher.mItSelf = mRegisteredProcessors.end_node();
 	newWatcher.mSubject = in_processor;
+	newWatcher.mContextLength = in_context_length;
+	newWatcher.mMemorySize = kvCacheSize;
 	in_processor->acquire_object_watcher(&newWatcher);
 	mProcessorListMutex.release();
 	return flags::INF_MODEL_INFO_REGISTERING_PROCESSOR;
@@ -619,7 +739,8 @@ InfModelTextToText::flags InfModelTextToText::declare_lora_remove(const inf_lora
 {
 	MBASE_INF_T2T_MODEL_RETURN_UNINITIALIZED;
 
-	if(mbase::find(mLoraAdapters.begin(), mLoraAdapters.end(), in_adapter) == mLoraAdapters.end())
+	inf_lora_adapter loadedAdapter;
+	if(!has_lora_adapter(in_adapter.mAdapterName, loadedAdapter))
 	{
 		return flags::INF_MODEL_ERR_LORA_MISSING;
 	}
@@ -654,7 +775,8 @@ InfModelTextToText::flags InfModelTextToText::declare_lora_adapter(const inf_lor
 {
 	MBASE_INF_T2T_MODEL_RETURN_UNINITIALIZED;
 
-	if(mbase::find(mLoraAdapters.begin(), mLoraAdapters.end(), in_adapter) != mLoraAdapters.end())
+	inf_lora_adapter loadedAdapter;
+	if(has_lora_adapter(in_adapter.mAdapterName, loadedAdapter))
 	{
 		return flags::INF_MODEL_ERR_LORA_EXISTS;
 	}
@@ -730,6 +852,58 @@ InfModelTextToText::flags InfModelTextToText::tokenize_input(CBYTEBUFFER in_data
 	return flags::INF_MODEL_SUCCESS;
 }
 
+GENERIC InfModelTextToText::merge_processor_diagnostics(InfProcT2TDiagnostics& out_diagnostics)
+{
+	if(is_embedding_model())
+	{
+		return;
+	}
+
+	mbase::lock_guard tmpListMutex(mProcessorListMutex);
+	for(context_processor_list::iterator It = mRegisteredProcessors.begin(); It != mRegisteredProcessors.end(); ++It)
+	{
+		if(It->mSubject)
+		{
+			InfProcessorTextToText* t2tProcessor = static_cast<InfProcessorTextToText*>(It->mSubject);
+			out_diagnostics.merge(t2tProcessor->get_diagnostics());
+		}
+	}
+}
+
+GENERIC InfModelTextToText::append_diagnostics_sources(const mbase::string& in_labels, mbase::vector<inf_t2t_diagnostics_source>& out_sources)
+{
+	if(is_embedding_model())
+	{
+		return;
+	}
+
+	mbase::lock_guard tmpListMutex(mProcessorListMutex);
+	U32 processorIndex = 0;
+	for(context_processor_list::iterator It = mRegisteredProcessors.begin(); It != mRegisteredProcessors.end(); ++It, ++processorIndex)
+	{
+		if(!It->mSubject)
+		{
+			continue;
+		}
+
+		InfProcessorTextToText* t2tProcessor = static_cast<InfProcessorTextToText*>(It->mSubject);
+		mbase::string processorLabel = InfHistogram::escape_prometheus_label(t2tProcessor->get_context_identifier());
+		if(!processorLabel.size())
+		{
+			processorLabel = mbase::string::from_format("%u", processorIndex);
+		}
+
+		inf_t2t_diagnostics_source diagSource;
+		diagSource.mLabels = in_labels.size() ? in_labels + "," : mbase::string();
+		diagSource.mLabels += "processor=\"" + processorLabel + "\"";
+		// copied while the list is locked, the processor may be destroyed once it is released
+		InfProcT2TDiagnostics* diagSnapshot = new InfProcT2TDiagnostics;
+		diagSnapshot->merge(t2tProcessor->get_diagnostics());
+		diagSource.mDiagnostics = diagSnapshot;
+		out_sources.push_back(diagSource);
+	}
+}
+
 GENERIC InfModelTextToText::on_lora_operate([[maybe_unused]] const mbase::vector<inf_lora_adapter>& out_active_loras)
 {
 }
@@ -888,6 +1062,8 @@ GENERIC InfModelTextToText::_initialize_model()
 		mIsEmbeddingModel = false;
 	}
 
+	_initialize_chat_template();
+
 	// This context is for finding out the pooling type of the model.
 	// If the pooling type is not NONE, mark the model as embedding model
 
@@ -920,6 +1096,69 @@ GENERIC InfModelTextToText::_initialize_model()
 	mInitializeSignal.set_signal_finished();
 }
 
+static GENERIC inf_tokenize_chat_fragment(const llama_vocab* in_vocab, const mbase::string& in_text, inf_chat_fragment& out_fragment)
+{
+	out_fragment = inf_chat_fragment();
+	out_fragment.mText = in_text;
+	if(!in_text.size())
+	{
+		return;
+	}
+
+	inf_text_token_vector tokenizedText(in_text.size() * 4);
+	I32 tokenCount = llama_tokenize(in_vocab, in_text.c_str(), static_cast<I32>(in_text.size()), tokenizedText.data(), static_cast<I32>(tokenizedText.capacity()), false, true);
+	if(tokenCount <= 0)
+	{
+		return;
+	}
+	tokenizedText.resize_on_preset(tokenCount);
+
+	auto isSpecialToken = [in_vocab](inf_text_token in_token) {
+		return (llama_vocab_get_attr(in_vocab, in_token) & (LLAMA_TOKEN_ATTR_CONTROL | LLAMA_TOKEN_ATTR_USER_DEFINED)) != 0;
+	};
+	out_fragment.mBeginsSpecial = isSpecialToken(tokenizedText.front());
+	out_fragment.mEndsSpecial = isSpecialToken(tokenizedText.back());
+	out_fragment.mTokens = std::move(tokenizedText);
+}
+
+GENERIC InfModelTextToText::_initialize_chat_template()
+{
+	// The architecture table is the fallback, the template stored in the GGUF wins
+	// if the role strings can be derived from it
+	const llama_vocab* tmpVocab = llama_model_get_vocab(mModel);
+	auto tokenText = [tmpVocab](inf_text_token in_token) {
+		return in_token == LLAMA_TOKEN_NULL ? mbase::string() : mbase::string(llama_vocab_get_text(tmpVocab, in_token));
+	};
+
+	mbase::string conversationStart;
+	const char* embeddedTemplate = llama_model_chat_template(mModel, NULL);
+	if(embeddedTemplate)
+	{
+		inf_chat_role_strings roleStrings;
+		mChatTemplate.set_special_tokens(tokenText(llama_vocab_bos(tmpVocab)), tokenText(llama_vocab_eos(tmpVocab)));
+		if(mChatTemplate.compile(embeddedTemplate) == InfJinjaTemplate::flags::INF_JINJA_SUCCESS &&
+		   mChatTemplate.extract_role_strings(roleStrings) == InfJinjaTemplate::flags::INF_JINJA_SUCCESS)
+		{
+			mSystemStart = roleStrings.mSystemStart;
+			mSystemEnd = roleStrings.mSystemEnd;
+			mUsrStart = roleStrings.mUserStart;
+			mUserEnd = roleStrings.mUserEnd;
+			mAssistantStart = roleStrings.mAssistantStart;
+			mAssistantEnd = roleStrings.mAssistantEnd;
+			conversationStart = roleStrings.mConversationStart;
+			mIsChatTemplateEmbedded = true;
+		}
+	}
+
+	inf_tokenize_chat_fragment(tmpVocab, conversationStart, mConversationStart);
+	inf_tokenize_chat_fragment(tmpVocab, mSystemStart, mRoleStartFragments[static_cast<U32>(context_role::SYSTEM)]);
+	inf_tokenize_chat_fragment(tmpVocab, mSystemEnd, mRoleEndFragments[static_cast<U32>(context_role::SYSTEM)]);
+	inf_tokenize_chat_fragment(tmpVocab, mAssistantStart, mRoleStartFragments[static_cast<U32>(context_role::ASSISTANT)]);
+	inf_tokenize_chat_fragment(tmpVocab, mAssistantEnd, mRoleEndFragments[static_cast<U32>(context_role::ASSISTANT)]);
+	inf_tokenize_chat_fragment(tmpVocab, mUsrStart, mRoleStartFragments[static_cast<U32>(context_role::USER)]);
+	inf_tokenize_chat_fragment(tmpVocab, mUserEnd, mRoleEndFragments[static_cast<U32>(context_role::USER)]);
+}
+
 GENERIC InfModelTextToText::_destroy_model()
 {
 	mbase::lock_guard tmpListMutex(mProcessorListMutex);
@@ -932,6 +1171,21 @@ GENERIC InfModelTextToText::_destroy_model()
 		}
 	}
 
+	mGrammarCache.clear();
+	mLoraMutex.acquire();
+	for(mbase::vector<inf_lora_adapter>::iterator It = mLoraAdapters.begin(); It != mLoraAdapters.end(); ++It)
+	{
+		llama_adapter_lora_free(It->mAdapterHandle);
+	}
+	for(mbase::vector<inf_lora_adapter>::iterator It = mRetiredAdapters.begin(); It != mRetiredAdapters.end(); ++It)
+	{
+		llama_adapter_lora_free(It->mAdapterHandle);
+	}
+	mLoraAdapters.clear();
+	mRetiredAdapters.clear();
+	mLoraMutex.release();
+	mLoraDeclares.clear();
+	mLoraRemoves.clear();
 	llama_model_free(mModel);
 	mModel = NULL;
 
@@ -943,9 +1197,18 @@ GENERIC InfModelTextToText::_destroy_model()
 	mUserEnd.clear();
 	mSystemEnd.clear();
 	mAssistantEnd.clear();
+	mChatTemplate.clear();
+	mConversationStart = inf_chat_fragment();
+	for(U32 i = 0; i < 3; i++)
+	{
+		mRoleStartFragments[i] = inf_chat_fragment();
+		mRoleEndFragments[i] = inf_chat_fragment();
+	}
+	mIsChatTemplateEmbedded = false;
 	mModelPath.clear();
 	mEndOfToken = 0;
 	mOccupiedContext = 0;
+	mOccupiedKvMemory = 0;
 
 	/* RESETTING ALL SIGNALS ON LOGIC LOOP */
 
@@ -955,22 +1218,13 @@ GENERIC InfModelTextToText::_destroy_model()
 GENERIC InfModelTextToText::_lora_operate()
 {
 	// LoRA operation order is as follows:
-	// - Stop all registered context processors
-	// - Initialize declared loras
-	// - Remove, loras from context processors
-	// - Remove, remove tagged loras
-	
-	mbase::lock_guard tmpListMutex(mProcessorListMutex);
-	for(context_processor_list::iterator It = mRegisteredProcessors.begin(); It != mRegisteredProcessors.end(); ++It)
-	{
-		InfModelBase::watcher_type& wt = *It;
-		if(wt.mSubject)
-		{
-			InfProcessorBase* baseProcessor = wt.mSubject;
-			baseProcessor->stop_processor();
-		}
-	}
-	
+	// - Initialize declared loras, once per model
+	// - Move removed loras to the retired list
+	// - Tell the context processors to detach the removed loras
+	// Processors keep running, they attach and detach adapters between decode steps
+	// and the retired loras are freed when no processor has them attached anymore.
+
+	mbase::vector<inf_lora_adapter> loadedAdapters;
 	for(mbase::vector<inf_lora_adapter>::iterator It = mLoraDeclares.begin(); It != mLoraDeclares.end(); ++It)
 	{
 		llama_adapter_lora* loraOut = llama_adapter_lora_init(mModel, mbase::to_utf8(It->mLoraPath).c_str());
@@ -979,30 +1233,26 @@ GENERIC InfModelTextToText::_lora_operate()
 			// Means adapter init is successful
 			inf_lora_adapter loraAdapter = *It;
 			loraAdapter.mAdapterHandle = loraOut;
-			mLoraAdapters.push_back(loraAdapter);
+			loadedAdapters.push_back(loraAdapter);
 		}
 	}
 
 	mLoraDeclares.clear(); // Clear declared loras
 
-	// removing loras from context processors
-	for(context_processor_list::iterator It = mRegisteredProcessors.begin(); It != mRegisteredProcessors.end(); ++It)
+	mbase::vector<inf_lora_adapter> removedAdapters;
+	mLoraMutex.acquire();
+	for(mbase::vector<inf_lora_adapter>::iterator It = loadedAdapters.begin(); It != loadedAdapters.end(); ++It)
 	{
-		InfModelBase::watcher_type& wt = *It;
-		if(wt.mSubject)
-		{
-			InfProcessorTextToText* baseProcessor = static_cast<InfProcessorTextToText*>(wt.mSubject);
-			baseProcessor->_internal_adapter_remove(mLoraRemoves);
-		}
+		mLoraAdapters.push_back(*It);
 	}
 
 	mbase::vector<inf_lora_adapter> newAssignedAdapters;
-
 	for(mbase::vector<inf_lora_adapter>::iterator It = mLoraAdapters.begin(); It != mLoraAdapters.end(); ++It)
 	{
 		if(mbase::find(mLoraRemoves.begin(), mLoraRemoves.end(), *It) != mLoraRemoves.end())
 		{
-			llama_adapter_lora_free(It->mAdapterHandle);
+			removedAdapters.push_back(*It);
+			mRetiredAdapters.push_back(*It);
 		}
 
 		else
@@ -1010,13 +1260,84 @@ GENERIC InfModelTextToText::_lora_operate()
 			newAssignedAdapters.push_back(*It);
 		}
 	}
+	mLoraAdapters = newAssignedAdapters;
+	mLoraMutex.release();
 
 	mLoraRemoves.clear();
-	mLoraAdapters = newAssignedAdapters;
+
+	if(removedAdapters.size() && !mIsEmbeddingModel)
+	{
+		// the model lock must not be held here, processors look adapters up through the model while attaching
+		mbase::lock_guard tmpListMutex(mProcessorListMutex);
+		for(context_processor_list::iterator It = mRegisteredProcessors.begin(); It != mRegisteredProcessors.end(); ++It)
+		{
+			InfModelBase::watcher_type& wt = *It;
+			if(wt.mSubject)
+			{
+				InfProcessorTextToText* baseProcessor = static_cast<InfProcessorTextToText*>(wt.mSubject);
+				baseProcessor->_internal_adapter_remove(removedAdapters);
+			}
+		}
+	}
 
 	mLoraOperationSignal.set_signal_finished();
 }
 
+GENERIC InfModelTextToText::_free_retired_adapters()
+{
+	mLoraMutex.acquire();
+	mbase::vector<inf_lora_adapter> retiredAdapters = mRetiredAdapters;
+	mLoraMutex.release();
+
+	if(!retiredAdapters.size())
+	{
+		return;
+	}
+
+	mbase::vector<inf_lora_adapter> freeAdapters;
+	mProcessorListMutex.acquire();
+	for(mbase::vector<inf_lora_adapter>::iterator It = retiredAdapters.begin(); It != retiredAdapters.end(); ++It)
+	{
+		bool isAttached = false;
+		for(context_processor_list::iterator procIt = mRegisteredProcessors.begin(); procIt != mRegisteredProcessors.end(); ++procIt)
+		{
+			InfModelBase::watcher_type& wt = *procIt;
+			if(wt.mSubject && !mIsEmbeddingModel && static_cast<InfProcessorTextToText*>(wt.mSubject)->_internal_is_adapter_attached(It->mAdapterHandle))
+			{
+				isAttached = true;
+				break;
+			}
+		}
+
+		if(!isAttached)
+		{
+			freeAdapters.push_back(*It);
+		}
+	}
+	mProcessorListMutex.release();
+
+	if(!freeAdapters.size())
+	{
+		return;
+	}
+
+	// retired adapters can't be attached again, they are not in the adapter list anymore
+	mbase::lock_guard tmpLoraMutex(mLoraMutex);
+	mbase::vector<inf_lora_adapter> newRetiredAdapters;
+	for(mbase::vector<inf_lora_adapter>::iterator It = mRetiredAdapters.begin(); It != mRetiredAdapters.end(); ++It)
+	{
+		if(mbase::find(freeAdapters.begin(), freeAdapters.end(), *It) != freeAdapters.end())
+		{
+			llama_adapter_lora_free(It->mAdapterHandle);
+		}
+		else
+		{
+			newRetiredAdapters.push_back(*It);
+		}
+	}
+	mRetiredAdapters = newRetiredAdapters;
+}
+
 GENERIC InfModelTextToText::update()
 {
 	// load and unload control
@@ -1075,7 +1396,7 @@ GENERIC InfModelTextToText::update()
 	if(signal_state_lora_operation())
 	{
 		mLoraOperationSignal.reset_signal_state();
-		on_lora_operate(mLoraAdapters);
+		on_lora_operate(get_adapters());
 		return;
 	}
 
@@ -1085,8 +1406,9 @@ GENERIC InfModelTextToText::update()
 		InfModelBase::watcher_type& wt = *It;
 		if(!wt.mSubject)
 		{
-			It = mRegisteredProcessors.erase(wt.mItSelf);
 			mOccupiedContext -= wt.mContextLength;
+			mOccupiedKvMemory -= wt.mMemorySize;
+			It = mRegisteredProcessors.erase(wt.mItSelf);
 			continue;
 		}
 		InfProcessorBase* baseProcessor = wt.mSubject;
@@ -1102,7 +1424,15 @@ GENERIC InfModelTextToText::update_t()
 		if(signal_destroying())
 		{
 			_destroy_model();
+			return;
 		}
+
+		if(signal_lora_operation())
+		{
+			_lora_operate();
+		}
+
+		_free_retired_adapters();
 	}
 	else
 	{
@@ -1110,11 +1440,6 @@ GENERIC InfModelTextToText::update_t()
 		{
 			_initialize_model();
 		}
-
-		if(signal_lora_operation())
-		{
-			_lora_operate();
-		}
 	}
 }
 
@@ -2,6 +2,23 @@
 
 MBASE_BEGIN
 
+struct inf_t2t_histogram_description {
+    MSTRING mName;
+    MSTRING mHelp;
+    InfHistogram InfProcT2TDiagnostics::* mHistogram;
+    F64 mScale;
+};
+
+static const inf_t2t_histogram_description gInfT2tHistograms[] = {
+    {"queue_time_seconds", "Time between input submission and the start of its decoding.", &InfProcT2TDiagnostics::queueTimeMicroseconds, 1e-6},
+    {"time_to_first_token_seconds", "Time between input submission and the first sampled token.", &InfProcT2TDiagnostics::timeToFirstTokenMicroseconds, 1e-6},
+    {"inter_token_latency_seconds", "Time between consecutive sampled tokens.", &InfProcT2TDiagnostics::interTokenMicroseconds, 1e-6},
+    {"sampling_seconds", "Time spent in the sampler chain to pick a single token.", &InfProcT2TDiagnostics::samplingMicroseconds, 1e-6},
+    {"decode_step_seconds", "Duration of a single decode call.", &InfProcT2TDiagnostics::decodeStepMicroseconds, 1e-6},
+    {"batch_size_tokens", "Token count of a single decode call.", &InfProcT2TDiagnostics::batchSize, 1.0},
+    {"kv_occupancy_percent", "Context fill percentage after a decode call.", &InfProcT2TDiagnostics::kvOccupancyPercent, 1.0}
+};
+
 InfProcT2TDiagnostics::InfProcT2TDiagnostics():
     loadTimeInMilliseconds(0),
     ppTokensPerSecond(0),
@@ -9,4 +26,33 @@ InfProcT2TDiagnostics::InfProcT2TDiagnostics():
 {
 }
 
-MBASE_END
\ No newline at end of file
+GENERIC InfProcT2TDiagnostics::merge(const InfProcT2TDiagnostics& in_diagnostics) noexcept
+{
+    for(const inf_t2t_histogram_description& histDesc : gInfT2tHistograms)
+    {
+        (this->*histDesc.mHistogram).merge(in_diagnostics.*histDesc.mHistogram);
+    }
+}
+
+GENERIC InfProcT2TDiagnostics::reset_histograms() noexcept
+{
+    for(const inf_t2t_histogram_description& histDesc : gInfT2tHistograms)
+    {
+        (this->*histDesc.mHistogram).reset();
+    }
+}
+
+GENERIC InfProcT2TDiagnostics::write_prometheus(const mbase::string& in_prefix, const mbase::vector<inf_t2t_diagnostics_source>& in_sources, mbase::string& out_text)
+{
+    for(const inf_t2t_histogram_description& histDesc : gInfT2tHistograms)
+    {
+        mbase::string metricName = in_prefix + histDesc.mName;
+        InfHistogram::write_prometheus_header(metricName, histDesc.mHelp, out_text);
+        for(const inf_t2t_diagnostics_source& tmpSource : in_sources)
+        {
+            (tmpSource.mDiagnostics->*histDesc.mHistogram).write_prometheus(metricName, tmpSource.mLabels, histDesc.mScale, out_text);
+        }
+    }
+}
+
+MBASE_END
@@ -1,7 +1,9 @@
 #include <mbase/inference/inf_t2t_processor.h>
 #include <mbase/inference/inf_t2t_model.h>
 #include <mbase/inference/inf_t2t_client.h>
+#include <mbase/inference/inf_fused_sampler.h>
 #include <chrono>
+#include <cmath>
 
 MBASE_BEGIN
 
@@ -29,8 +31,34 @@ if(!this->is_running())\
 	return flags::INF_PROC_ERR_HALTED;\
 }
 
+static GENERIC inf_erase_adapter(mbase::vector<inf_lora_adapter>& in_adapters, const inf_lora_adapter& in_adapter)
+{
+	mbase::vector<inf_lora_adapter> newAdapters;
+	for(mbase::vector<inf_lora_adapter>::iterator It = in_adapters.begin(); It != in_adapters.end(); ++It)
+	{
+		if(*It != in_adapter)
+		{
+			newAdapters.push_back(*It);
+		}
+	}
+	in_adapters = newAdapters;
+}
+
+static bool inf_has_adapter_handle(mbase::vector<inf_lora_adapter>& in_adapters, llama_adapter_lora* in_handle)
+{
+	for(mbase::vector<inf_lora_adapter>::iterator It = in_adapters.begin(); It != in_adapters.end(); ++It)
+	{
+		if(It->mAdapterHandle == in_handle)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
 InfProcessorTextToText::InfProcessorTextToText():
 	mSamplerChain(NULL),
+	mGrammarSampler(NULL),
 	mModelContext(NULL),
 	mPresetCandidates(),
 	mContextCursor(0),
@@ -40,13 +68,19 @@ InfProcessorTextToText::InfProcessorTextToText():
 	mProcessedBatchLength(0),
 	mLogitStartIndex(0),
 	mPromptStartIndex(0),
+	mReusedTokenCount(0),
+	mChunkedTokenizeState(0),
 	mFinishState(finish_state::FINISHED),
 	mLastFailCode(last_fail_code::MODEL_NOT_INITIALIZED),
 	mFlashAttention(false),
 	mIsInitializeFailed(false),
 	mIsManualCaching(false),
 	mIsBenchmarkOn(false),
-	mCacheMode(cache_mode::AUTO_LOGIT_STORE_MODE)
+	mCacheMode(cache_mode::AUTO_LOGIT_STORE_MODE),
+	mKeyCacheType(inf_kv_cache_type::F16),
+	mValueCacheType(inf_kv_cache_type::F16),
+	mInputSubmitTime(0),
+	mAwaitingFirstToken(false)
 {
 	mModelCategory = inf_model_category::TEXT_TO_TEXT;
 }
@@ -65,6 +99,7 @@ InfProcessorTextToText::~InfProcessorTextToText()
 			mAssignedClient = NULL;
 		}
 	}
+	clear_grammar();
 }
 
 InfProcT2TDiagnostics& InfProcessorTextToText::get_diagnostics()
@@ -82,6 +117,16 @@ InfProcessorTextToText::cache_mode InfProcessorTextToText::get_manual_cache_mode
 	return mCacheMode;
 }
 
+inf_kv_cache_type InfProcessorTextToText::get_key_cache_type() const
+{
+	return mKeyCacheType;
+}
+
+inf_kv_cache_type InfProcessorTextToText::get_value_cache_type() const
+{
+	return mValueCacheType;
+}
+
 bool InfProcessorTextToText::is_benchmark() const
 {
 	return mIsBenchmarkOn;
@@ -96,6 +141,17 @@ bool InfProcessorTextToText::is_update_required() const
 	return false;
 }
 
+bool InfProcessorTextToText::has_grammar() const
+{
+	return mGrammarSampler != NULL;
+}
+
+mbase::vector<inf_lora_adapter> InfProcessorTextToText::get_assigned_adapters()
+{
+	mbase::lock_guard tmpLoraMutex(mLoraMutex);
+	return mAssignedAdapters;
+}
+
 bool InfProcessorTextToText::is_init_failed() const
 {
 	return mIsInitializeFailed;
@@ -171,6 +227,11 @@ const U32& InfProcessorTextToText::get_context_cursor_position() const
 	return mContextCursor;
 }
 
+const U32& InfProcessorTextToText::get_reused_token_count() const
+{
+	return mReusedTokenCount;
+}
+
 I32 InfProcessorTextToText::get_cache_token_count() const
 {
 	return llama_kv_self_n_tokens(mModelContext);
@@ -320,48 +381,161 @@ InfProcessorTextToText::flags InfProcessorTextToText::tokenize_input(context_lin
 		return flags::INF_PROC_ERR_INPUT_IS_EMPTY;
 	}
 
-	mbase::string totalMessage;
 	InfModelTextToText* t2tModel = static_cast<InfModelTextToText*>(this->mTargetModel_md_model);
 
+	// The prompt is a sequence of static fragments, pre-tokenized by the model at load (conversation start,
+	// role headers and footers), and message texts. The tokenizer splits the text on special tokens before
+	// anything else, so the tokens of both sides of a fragment that begins or ends with a special token are
+	// concatenated as they are. Pieces joined without such a boundary are tokenized together as a chunk, and
+	// chunks that didn't change since the last call reuse their tokens.
+	struct prompt_piece {
+		const inf_chat_fragment* mFragment;
+		const mbase::string* mText;
+	};
+
+	mbase::vector<prompt_piece> promptPieces;
+	auto addFragment = [&promptPieces](const inf_chat_fragment& in_fragment) {
+		if(in_fragment.mText.size())
+		{
+			promptPieces.push_back({&in_fragment, &in_fragment.mText});
+		}
+	};
+
+	const bool isAssistantAppended = in_append_assistant_token && in_lines[in_count - 1].mRole == context_role::USER;
+	addFragment(t2tModel->get_conversation_start_fragment());
 	for(size_type i = 0; i < in_count; ++i)
 	{
 		context_line* tmpLine = in_lines + i;
-		mbase::string roleString;
-		mbase::string endString;
-		if(tmpLine->mRole == context_role::SYSTEM)
+		addFragment(t2tModel->get_role_start_fragment(tmpLine->mRole));
+		if(tmpLine->mMessage.size())
 		{
-			roleString = t2tModel->get_sys_start();
-			endString = t2tModel->get_sys_end();
+			promptPieces.push_back({NULL, &tmpLine->mMessage});
 		}
+		addFragment(t2tModel->get_role_end_fragment(tmpLine->mRole));
+	}
 
-		else if(tmpLine->mRole == context_role::ASSISTANT)
+	if(isAssistantAppended)
+	{
+		addFragment(t2tModel->get_role_start_fragment(context_role::ASSISTANT));
+	}
+
+	if(!promptPieces.size())
+	{
+		return flags::INF_PROC_ERR_INPUT_IS_EMPTY;
+	}
+
+	// The boundaries depend on the template, not the messages, so the assembled tokens of the first prompt
+	// are compared to the tokens of the whole prompt. If they differ, the whole prompt is tokenized from then on.
+	inf_text_token_vector wholeTokens;
+	if(mChunkedTokenizeState != 1)
+	{
+		mbase::string wholeText;
+		for(const prompt_piece& tmpPiece : promptPieces)
 		{
-			roleString = t2tModel->get_assistant_start();
-			endString = t2tModel->get_assistant_end();
+			wholeText += *tmpPiece.mText;
 		}
 
-		else if(tmpLine->mRole == context_role::USER)
+		flags tokenizeResult = tokenize_input(wholeText.data(), wholeText.size(), wholeTokens);
+		if(tokenizeResult != flags::INF_PROC_SUCCESS)
 		{
-			roleString = t2tModel->get_usr_start();
-			endString = t2tModel->get_usr_end();
+			return tokenizeResult;
+		}
+
+		if(mChunkedTokenizeState == -1)
+		{
+			out_tokens = std::move(wholeTokens);
+			return flags::INF_PROC_SUCCESS;
 		}
-		
-		totalMessage += (roleString + tmpLine->mMessage + endString);
 	}
-	
-	if(totalMessage.size())
+
+	// every group is either a single fragment or the index of a text chunk
+	mbase::vector<const inf_chat_fragment*> promptGroups;
+	mbase::vector<mbase::string> chunkTexts;
+	mbase::string chunkText;
+	size_type groupBegin = 0;
+	for(size_type i = 0; i < promptPieces.size(); ++i)
 	{
-		context_line* lastLine = in_lines + (in_count - 1);
-		if(lastLine->mRole == context_role::USER)
+		const bool isLast = i + 1 == promptPieces.size();
+		const bool isBoundary = isLast ||
+			(promptPieces[i].mFragment && promptPieces[i].mFragment->mEndsSpecial) ||
+			(promptPieces[i + 1].mFragment && promptPieces[i + 1].mFragment->mBeginsSpecial);
+
+		if(!isBoundary)
+		{
+			continue;
+		}
+
+		if(groupBegin == i && promptPieces[i].mFragment && promptPieces[i].mFragment->mTokens.size())
+		{
+			promptGroups.push_back(promptPieces[i].mFragment);
+		}
+		else
 		{
-			if (in_append_assistant_token)
+			for(size_type j = groupBegin; j <= i; ++j)
 			{
-				totalMessage += t2tModel->get_assistant_start();
+				chunkText += *promptPieces[j].mText;
 			}
+			chunkTexts.push_back(std::move(chunkText));
+			chunkText.clear();
+			promptGroups.push_back(NULL);
 		}
+		groupBegin = i + 1;
 	}
-	
-	return tokenize_input(totalMessage.data(), totalMessage.size(), out_tokens);
+
+	mbase::vector<inf_tokenized_chunk> tokenizedChunks;
+	tokenizedChunks.reserve(chunkTexts.size());
+	for(size_type i = 0; i < chunkTexts.size(); ++i)
+	{
+		if(i < mTokenizedChunks.size() && mTokenizedChunks[i].mText == chunkTexts[i])
+		{
+			tokenizedChunks.push_back(std::move(mTokenizedChunks[i]));
+			continue;
+		}
+
+		inf_tokenized_chunk tokenizedChunk;
+		flags tokenizeResult = tokenize_input(chunkTexts[i].data(), chunkTexts[i].size(), tokenizedChunk.mTokens);
+		if(tokenizeResult != flags::INF_PROC_SUCCESS)
+		{
+			mTokenizedChunks.clear();
+			return tokenizeResult;
+		}
+		tokenizedChunk.mText = std::move(chunkTexts[i]);
+		tokenizedChunks.push_back(std::move(tokenizedChunk));
+	}
+	mTokenizedChunks = std::move(tokenizedChunks);
+
+	size_type totalTokenCount = 0;
+	size_type chunkIndex = 0;
+	for(const inf_chat_fragment* tmpGroup : promptGroups)
+	{
+		totalTokenCount += tmpGroup ? tmpGroup->mTokens.size() : mTokenizedChunks[chunkIndex++].mTokens.size();
+	}
+
+	inf_text_token_vector totalTokens;
+	totalTokens.reserve(totalTokenCount);
+	chunkIndex = 0;
+	for(const inf_chat_fragment* tmpGroup : promptGroups)
+	{
+		const inf_text_token_vector& groupTokens = tmpGroup ? tmpGroup->mTokens : mTokenizedChunks[chunkIndex++].mTokens;
+		for(const inf_text_token& tmpToken : groupTokens)
+		{
+			totalTokens.push_back(tmpToken);
+		}
+	}
+
+	if(!mChunkedTokenizeState)
+	{
+		mChunkedTokenizeState = (totalTokens.size() == wholeTokens.size() && std::equal(totalTokens.begin(), totalTokens.end(), wholeTokens.begin())) ? 1 : -1;
+		if(mChunkedTokenizeState == -1)
+		{
+			mTokenizedChunks.clear();
+			out_tokens = std::move(wholeTokens);
+			return flags::INF_PROC_SUCCESS;
+		}
+	}
+
+	out_tokens = std::move(totalTokens);
+	return flags::INF_PROC_SUCCESS;
 }
 
 InfProcessorTextToText::flags InfProcessorTextToText::execute_input(const inf_text_token_vector& in_tokens, bool in_kv_locked)
@@ -375,7 +549,9 @@ InfProcessorTextToText::flags InfProcessorTextToText::execute_input(const inf_te
 
 	if(is_manual_caching())
 	{
-		if(in_tokens.size() + get_cache_token_count() > mContextLength)
+		// in kv lock mode, everything after the locked prompt is replaced by the input
+		const I32 keptTokenCount = get_manual_cache_mode() == cache_mode::KV_LOCK_MODE ? static_cast<I32>(mPromptStartIndex) : get_cache_token_count();
+		if(in_tokens.size() + keptTokenCount > mContextLength)
 		{
 			return flags::INF_PROC_ERR_INPUT_EXCEED_TOKEN_LIMIT;
 		}
@@ -415,6 +591,8 @@ InfProcessorTextToText::flags InfProcessorTextToText::execute_input(const inf_te
 
 	else
 	{
+		mInputSubmitTime.store(std::chrono::steady_clock::now().time_since_epoch().count(), std::memory_order_relaxed);
+		mAwaitingFirstToken.store(true, std::memory_order_release);
 		mInputSignal.set_signal();
 	}
 
@@ -541,15 +719,125 @@ InfProcessorTextToText::flags InfProcessorTextToText::set_inference_client(InfCl
 	return flags::INF_PROC_SUCCESS;
 }
 
-InfProcessorTextToText::flags InfProcessorTextToText::declare_lora_assign([[maybe_unused]] const inf_lora_adapter& in_adapter)
+InfProcessorTextToText::flags InfProcessorTextToText::declare_lora_assign(const inf_lora_adapter& in_adapter)
+{
+	MBASE_INF_T2T_PROC_RETURN_UNREGISTERED;
+	InfModelTextToText* t2tModel = static_cast<InfModelTextToText*>(this->mTargetModel_md_model);
+	inf_lora_adapter loadedAdapter;
+	if(!t2tModel->has_lora_adapter(in_adapter.mAdapterName, loadedAdapter))
+	{
+		return flags::INF_PROC_ERR_LORA_MISSING;
+	}
+
+	mbase::lock_guard tmpLoraMutex(mLoraMutex);
+	inf_erase_adapter(mRemoveAdapters, in_adapter);
+	if(mbase::find(mDeclaredAdapters.begin(), mDeclaredAdapters.end(), in_adapter) == mDeclaredAdapters.end())
+	{
+		mDeclaredAdapters.push_back(in_adapter);
+	}
+	return flags::INF_PROC_SUCCESS;
+}
+
+InfProcessorTextToText::flags InfProcessorTextToText::declare_lora_remove(const inf_lora_adapter& in_adapter)
+{
+	MBASE_INF_T2T_PROC_RETURN_UNREGISTERED;
+	mbase::lock_guard tmpLoraMutex(mLoraMutex);
+	inf_erase_adapter(mDeclaredAdapters, in_adapter);
+	if(mbase::find(mRemoveAdapters.begin(), mRemoveAdapters.end(), in_adapter) == mRemoveAdapters.end())
+	{
+		mRemoveAdapters.push_back(in_adapter);
+	}
+	return flags::INF_PROC_SUCCESS;
+}
+
+InfProcessorTextToText::flags InfProcessorTextToText::start_lora_operation()
 {
 	MBASE_INF_T2T_PROC_RETURN_UNREGISTERED;
+	mbase::lock_guard tmpLoraMutex(mLoraMutex);
+	if(mDeclaredAdapters.size() || mRemoveAdapters.size())
+	{
+		mLoraOperationSignal.set_signal();
+	}
+	return flags::INF_PROC_SUCCESS;
+}
+
+InfProcessorTextToText::flags InfProcessorTextToText::select_lora_adapter(const mbase::string& in_name)
+{
+	MBASE_INF_T2T_PROC_RETURN_UNREGISTERED;
+	inf_lora_adapter selectedAdapter;
+	if(in_name.size())
+	{
+		InfModelTextToText* t2tModel = static_cast<InfModelTextToText*>(this->mTargetModel_md_model);
+		if(!t2tModel->has_lora_adapter(in_name, selectedAdapter))
+		{
+			return flags::INF_PROC_ERR_LORA_MISSING;
+		}
+	}
+
+	mbase::lock_guard tmpLoraMutex(mLoraMutex);
+	mDeclaredAdapters.clear();
+	for(mbase::vector<inf_lora_adapter>::iterator It = mAssignedAdapters.begin(); It != mAssignedAdapters.end(); ++It)
+	{
+		if(It->mAdapterName != in_name && mbase::find(mRemoveAdapters.begin(), mRemoveAdapters.end(), *It) == mRemoveAdapters.end())
+		{
+			mRemoveAdapters.push_back(*It);
+		}
+	}
+
+	if(in_name.size())
+	{
+		inf_erase_adapter(mRemoveAdapters, selectedAdapter);
+		if(mbase::find(mAssignedAdapters.begin(), mAssignedAdapters.end(), selectedAdapter) == mAssignedAdapters.end())
+		{
+			mDeclaredAdapters.push_back(selectedAdapter);
+		}
+	}
+
+	if(mDeclaredAdapters.size() || mRemoveAdapters.size())
+	{
+		// the same adapter on consecutive requests costs nothing, the kv cache prefix stays valid
+		mLoraOperationSignal.set_signal();
+	}
 	return flags::INF_PROC_SUCCESS;
 }
 
-InfProcessorTextToText::flags InfProcessorTextToText::declare_lora_remove([[maybe_unused]] const inf_lora_adapter& in_adapter)
+InfProcessorTextToText::flags InfProcessorTextToText::set_grammar(const mbase::string& in_grammar, const mbase::string& in_root)
 {
 	MBASE_INF_T2T_PROC_RETURN_UNREGISTERED;
+	if(!is_available())
+	{
+		return flags::INF_PROC_ERR_ALREADY_PROCESSING;
+	}
+
+	InfModelTextToText* t2tModel = static_cast<InfModelTextToText*>(this->mTargetModel_md_model);
+	llama_sampler* grammarSampler = NULL;
+	if(t2tModel->get_grammar_cache().acquire_grammar(llama_model_get_vocab(t2tModel->get_raw_model()), in_grammar, in_root, grammarSampler) != InfGrammar::flags::INF_GRAMMAR_SUCCESS)
+	{
+		return flags::INF_PROC_ERR_INVALID_GRAMMAR;
+	}
+
+	clear_grammar();
+	mGrammarSampler = grammarSampler;
+	return flags::INF_PROC_SUCCESS;
+}
+
+InfProcessorTextToText::flags InfProcessorTextToText::set_json_schema(const mbase::string& in_schema)
+{
+	MBASE_INF_T2T_PROC_RETURN_UNREGISTERED;
+	if(!is_available())
+	{
+		return flags::INF_PROC_ERR_ALREADY_PROCESSING;
+	}
+
+	InfModelTextToText* t2tModel = static_cast<InfModelTextToText*>(this->mTargetModel_md_model);
+	llama_sampler* grammarSampler = NULL;
+	if(t2tModel->get_grammar_cache().acquire_json_schema(llama_model_get_vocab(t2tModel->get_raw_model()), in_schema, grammarSampler) != InfGrammar::flags::INF_GRAMMAR_SUCCESS)
+	{
+		return flags::INF_PROC_ERR_INVALID_GRAMMAR;
+	}
+
+	clear_grammar();
+	mGrammarSampler = grammarSampler;
 	return flags::INF_PROC_SUCCESS;
 }
 
@@ -674,17 +962,39 @@ GENERIC InfProcessorTextToText::clear_samplers()
 	}
 }
 
+GENERIC InfProcessorTextToText::clear_grammar()
+{
+	if(mGrammarSampler)
+	{
+		llama_sampler_free(mGrammarSampler);
+		mGrammarSampler = NULL;
+	}
+}
+
 GENERIC InfProcessorTextToText::clear_kv_cache()
 {
 	mLogitStartIndex = 0;
 	mLogitTokenVector.clear();
+	mKvTokenVector.clear();
 	llama_kv_self_clear(mModelContext);
 }
 
+GENERIC InfProcessorTextToText::clear_tokenization_cache()
+{
+	mTokenizedChunks.clear();
+}
+
 GENERIC InfProcessorTextToText::set_manual_caching(bool in_manual_cache, cache_mode in_cache_mode)
 {
 	mIsManualCaching = in_manual_cache;
 	mCacheMode = in_cache_mode;
+	mKvTokenVector.clear();
+}
+
+GENERIC InfProcessorTextToText::set_kv_cache_types(inf_kv_cache_type in_key_type, inf_kv_cache_type in_value_type)
+{
+	mKeyCacheType = in_key_type;
+	mValueCacheType = in_value_type;
 }
 
 GENERIC InfProcessorTextToText::on_lora_operate([[maybe_unused]] const mbase::vector<inf_lora_adapter>& out_adapters)
@@ -754,7 +1064,9 @@ GENERIC InfProcessorTextToText::_decode_cached_logits()
 
 GENERIC InfProcessorTextToText::_decode_kv_locked_input()
 {
+	_apply_pending_lora();
 	_decode_cached_logits();
+	mKvTokenVector.clear(); // the conversation was removed along with the previous locked prompt
 	I32 totalPosition = get_cache_token_count();
 	U32 tmpBatchCursor = 0;
 	mProcessedBatchLength = 0;
@@ -766,7 +1078,7 @@ GENERIC InfProcessorTextToText::_decode_kv_locked_input()
 		inf_common_batch_add(tempBatch, mTokenizedInput[i], totalPosition, {0}, false);
 		if(tmpBatchCursor == mBatchSize)
 		{
-			llama_decode(mModelContext, tempBatch);
+			_timed_decode(tempBatch);
 			tempBatch.n_tokens = 0;
 			tmpBatchCursor = 0;
 		}
@@ -775,7 +1087,7 @@ GENERIC InfProcessorTextToText::_decode_kv_locked_input()
 
 	if(tmpBatchCursor)
 	{
-		llama_decode(mModelContext, tempBatch);
+		_timed_decode(tempBatch);
 	}
 	
 	mPromptStartIndex = get_cache_token_count();
@@ -783,36 +1095,148 @@ GENERIC InfProcessorTextToText::_decode_kv_locked_input()
 	mInputKvLockedSignal.set_signal_finished();
 }
 
+bool InfProcessorTextToText::_is_kv_tracked() const
+{
+	return !is_manual_caching() || get_manual_cache_mode() == cache_mode::KV_LOCK_MODE;
+}
+
+InfProcessorTextToText::size_type InfProcessorTextToText::_reuse_kv_prefix()
+{
+	// Keeps the kv cells of the longest common prefix of the new input and the tokens that are
+	// already in the cache after the locked prompt, if any. At least the last input token is decoded
+	// again, its logits are needed.
+	const I32 lockedLength = is_manual_caching() ? static_cast<I32>(mPromptStartIndex) : 0;
+	size_type prefixLength = 0;
+	const size_type maxPrefix = std::min(mKvTokenVector.size(), mTokenizedInput.size() - 1);
+	while(prefixLength < maxPrefix && mKvTokenVector[prefixLength] == mTokenizedInput[prefixLength])
+	{
+		++prefixLength;
+	}
+
+	mLogitStartIndex = 0;
+	mLogitTokenVector.clear();
+	if(is_benchmark() || !prefixLength || !llama_kv_self_seq_rm(mModelContext, 0, lockedLength + static_cast<I32>(prefixLength), -1))
+	{
+		// benchmark inputs must be processed completely, and some models can't drop partial sequences
+		mKvTokenVector.clear();
+		if(lockedLength)
+		{
+			llama_kv_self_seq_rm(mModelContext, 0, lockedLength, -1);
+		}
+		else
+		{
+			llama_kv_self_clear(mModelContext);
+		}
+		return 0;
+	}
+	return prefixLength;
+}
+
+I64 InfProcessorTextToText::_timed_decode(llama_batch& in_batch)
+{
+	std::chrono::steady_clock::time_point beginTime = std::chrono::steady_clock::now();
+	llama_decode(mModelContext, in_batch);
+	I64 usPassed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - beginTime).count();
+
+	mDiagnostics.decodeStepMicroseconds.record(usPassed);
+	mDiagnostics.batchSize.record(in_batch.n_tokens);
+	if(in_batch.n_tokens && mContextLength)
+	{
+		mDiagnostics.kvOccupancyPercent.record((static_cast<U64>(in_batch.pos[in_batch.n_tokens - 1]) + 1) * 100 / mContextLength);
+	}
+	return usPassed;
+}
+
+GENERIC InfProcessorTextToText::_fill_sample_candidates()
+{
+	InfModelTextToText* t2tModel = static_cast<InfModelTextToText*>(this->mTargetModel_md_model);
+	const I32 vocabCount = llama_vocab_n_tokens(llama_model_get_vocab(t2tModel->get_raw_model()));
+	const F32* tokenLogits = llama_get_logits_ith(mModelContext, -1);
+	if(mSampleCandidates.size() != static_cast<size_type>(vocabCount))
+	{
+		mSampleCandidates.clear();
+		mSampleCandidates.reserve(vocabCount);
+		for(I32 i = 0; i < vocabCount; i++)
+		{
+			mSampleCandidates.push_back(llama_token_data{i, tokenLogits[i], 0.0f});
+		}
+		return;
+	}
+
+	for(I32 i = 0; i < vocabCount; i++)
+	{
+		mSampleCandidates[i] = llama_token_data{i, tokenLogits[i], 0.0f};
+	}
+}
+
+inf_text_token InfProcessorTextToText::_sample_token()
+{
+	if(!mGrammarSampler)
+	{
+		return llama_sampler_sample(mSamplerChain, mModelContext, -1);
+	}
+
+	// Masking the whole vocabulary against the grammar is expensive, so the token is sampled
+	// unconstrained first and only checked against the grammar. Most of the time the model already
+	// follows the grammar and the full mask is only computed when the sampled token is rejected.
+	_fill_sample_candidates();
+	llama_token_data_array candidateArray = {mSampleCandidates.data(), mSampleCandidates.size(), -1, false};
+	llama_sampler_apply(mSamplerChain, &candidateArray);
+	inf_text_token sampledToken = candidateArray.data[candidateArray.selected].id;
+
+	llama_token_data singleCandidate = {sampledToken, 1.0f, 0.0f};
+	llama_token_data_array singleArray = {&singleCandidate, 1, -1, false};
+	llama_sampler_apply(mGrammarSampler, &singleArray);
+	if(singleCandidate.logit == -INFINITY)
+	{
+		_fill_sample_candidates();
+		candidateArray = {mSampleCandidates.data(), mSampleCandidates.size(), -1, false};
+		llama_sampler_apply(mGrammarSampler, &candidateArray);
+		llama_sampler_apply(mSamplerChain, &candidateArray);
+		sampledToken = candidateArray.data[candidateArray.selected].id;
+	}
+
+	llama_sampler_accept(mGrammarSampler, sampledToken);
+	llama_sampler_accept(mSamplerChain, sampledToken);
+	return sampledToken;
+}
+
 GENERIC InfProcessorTextToText::_decode_input()
 {
-	I32 totalPosition = get_cache_token_count();
-	if(!is_manual_caching())
+	if(mAwaitingFirstToken.load(std::memory_order_acquire))
+	{
+		std::chrono::steady_clock::time_point submitTime{std::chrono::steady_clock::duration(mInputSubmitTime.load(std::memory_order_relaxed))};
+		mDiagnostics.queueTimeMicroseconds.record(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - submitTime).count());
+	}
+
+	_apply_pending_lora();
+	size_type reusedCount = 0;
+	if(_is_kv_tracked())
 	{
-		clear_kv_cache();
-		totalPosition = 0;
+		reusedCount = _reuse_kv_prefix();
 	}
 	else
 	{
 		_decode_cached_logits();
 	}
-	totalPosition = get_cache_token_count();
+	mReusedTokenCount = static_cast<U32>(reusedCount);
+	I32 totalPosition = get_cache_token_count();
 	llama_sampler_reset(mSamplerChain);
-	std::chrono::high_resolution_clock::time_point beginTime;
-	std::chrono::high_resolution_clock::time_point endTime;
+	if(mGrammarSampler)
+	{
+		llama_sampler_reset(mGrammarSampler);
+	}
 	mProcessedBatchLength = 0;
 	U32 tmpBatchCursor = 0;
-	I64 msPassed = 0;
+	I64 usPassed = 0;
 	llama_batch tempBatch = llama_batch_init(mBatchSize, 0, 1);
-	for(size_type i = 0; i < mTokenizedInput.size() - 1; i++)
+	for(size_type i = reusedCount; i < mTokenizedInput.size() - 1; i++)
 	{
 		++tmpBatchCursor;
 		inf_common_batch_add(tempBatch, mTokenizedInput[i], totalPosition, {0}, false);
 		if(tmpBatchCursor == mBatchSize)
 		{
-			beginTime = std::chrono::high_resolution_clock::now();
-			llama_decode(mModelContext, tempBatch);
-			endTime = std::chrono::high_resolution_clock::now();
-			msPassed += std::chrono::duration_cast<std::chrono::milliseconds>(endTime - beginTime).count();
+			usPassed += _timed_decode(tempBatch);
 			tempBatch.n_tokens = 0;
 			tmpBatchCursor = 0;
 		}
@@ -820,8 +1244,7 @@ GENERIC InfProcessorTextToText::_decode_input()
 	}
 
 	inf_common_batch_add(tempBatch, mTokenizedInput.back(), totalPosition, {0}, true);
-	beginTime = std::chrono::high_resolution_clock::now();
-	llama_decode(mModelContext, tempBatch);
+	usPassed += _timed_decode(tempBatch);
 	mContextCursor = get_cache_token_count();
 	mProcessedBatchLength = mContextCursor;
 	mLogitTokenVector.clear();
@@ -831,11 +1254,16 @@ GENERIC InfProcessorTextToText::_decode_input()
 		mLogitTokenVector.push_back(mTokenizedInput.back());
 	}
 
-	endTime = std::chrono::high_resolution_clock::now();
-	msPassed += std::chrono::duration_cast<std::chrono::milliseconds>(endTime - beginTime).count();
-	
-	F32 secondsPassed = (F32)msPassed / 1000.0f;
-	mDiagnostics.ppTokensPerSecond = mContextCursor / secondsPassed;
+	if(_is_kv_tracked())
+	{
+		mKvTokenVector = mTokenizedInput;
+	}
+
+	if(usPassed)
+	{
+		F32 secondsPassed = (F32)usPassed / 1000000.0f;
+		mDiagnostics.ppTokensPerSecond = (mContextCursor - reusedCount) / secondsPassed;
+	}
 	llama_batch_free(tempBatch);
 	mInputSignal.set_signal_finished();
 	mFinishState = finish_state::CONTINUE;
@@ -844,27 +1272,38 @@ GENERIC InfProcessorTextToText::_decode_input()
 GENERIC InfProcessorTextToText::_decode_next()
 {
 	// Main Decode loop
-	I64 totalMilliseconds = 1;
+	I64 totalMicroseconds = 0;
 	I64 totalGeneratedTokens = 0;
 	llama_batch tempBatch = llama_batch_init(mDecodeBehavior.mTokenAtMost, 0, 1);
 	
 	for(U32 i = 0; i < mDecodeBehavior.mTokenAtMost; i++)
 	{
-		std::chrono::high_resolution_clock::time_point beginTime = std::chrono::high_resolution_clock::now();
+		std::chrono::steady_clock::time_point beginTime = std::chrono::steady_clock::now();
 		InfModelTextToText* t2tModel = static_cast<InfModelTextToText*>(this->mTargetModel_md_model);
 		const llama_vocab* tmpVocab = llama_model_get_vocab(t2tModel->get_raw_model());
 		
-		inf_text_token tmpGeneratedToken = llama_sampler_sample(mSamplerChain, mModelContext, -1);
+		inf_text_token tmpGeneratedToken = 0;
 		if(is_benchmark())
 		{
 			tmpGeneratedToken = llama_vocab_n_tokens(tmpVocab) / 2; // the token selection is arbitrary. it literally has no meaning
 		}
 		else
 		{	
-			tmpGeneratedToken = llama_sampler_sample(mSamplerChain, mModelContext, -1);
+			tmpGeneratedToken = _sample_token();
 		}
 		
-		//llama_sampler_accept(mSamplerChain, tmpGeneratedToken);
+		std::chrono::steady_clock::time_point sampleTime = std::chrono::steady_clock::now();
+		mDiagnostics.samplingMicroseconds.record(std::chrono::duration_cast<std::chrono::microseconds>(sampleTime - beginTime).count());
+		if(mAwaitingFirstToken.exchange(false, std::memory_order_acquire))
+		{
+			std::chrono::steady_clock::time_point submitTime{std::chrono::steady_clock::duration(mInputSubmitTime.load(std::memory_order_relaxed))};
+			mDiagnostics.timeToFirstTokenMicroseconds.record(std::chrono::duration_cast<std::chrono::microseconds>(sampleTime - submitTime).count());
+		}
+		else
+		{
+			mDiagnostics.interTokenMicroseconds.record(std::chrono::duration_cast<std::chrono::microseconds>(sampleTime - mLastTokenTime).count());
+		}
+		mLastTokenTime = sampleTime;
 		mGeneratedTokenVector.push_back(tmpGeneratedToken);
 		if(is_manual_caching())
 		{
@@ -879,7 +1318,7 @@ GENERIC InfProcessorTextToText::_decode_next()
 		{
 			// means end of generation
 			llama_sampler_reset(mSamplerChain);
-			if(is_manual_caching())
+			if(!_is_kv_tracked())
 			{
 				_decode_cached_logits();
 			}
@@ -894,7 +1333,7 @@ GENERIC InfProcessorTextToText::_decode_next()
 			{
 				// means token limit is reached
 				llama_sampler_reset(mSamplerChain);
-				if(is_manual_caching())
+				if(!_is_kv_tracked())
 				{
 					_decode_cached_logits();
 				}
@@ -907,17 +1346,20 @@ GENERIC InfProcessorTextToText::_decode_next()
 			{
 				tempBatch.n_tokens = 0;
 				inf_common_batch_add(tempBatch, tmpGeneratedToken, mContextCursor++, {0}, true);
-				llama_decode(mModelContext, tempBatch); // Handle error here
+				_timed_decode(tempBatch); // Handle error here
+				if(_is_kv_tracked())
+				{
+					mKvTokenVector.push_back(tmpGeneratedToken);
+				}
 				totalGeneratedTokens++;
-				std::chrono::high_resolution_clock::time_point endTime = std::chrono::high_resolution_clock::now();
-				totalMilliseconds += std::chrono::duration_cast<std::chrono::milliseconds>(endTime - beginTime).count();
+				totalMicroseconds += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - beginTime).count();
 			}
 		}
 	}
 	llama_batch_free(tempBatch);
-	if(totalGeneratedTokens)
+	if(totalGeneratedTokens && totalMicroseconds)
 	{
-		F32 secondsPassed = (F32)totalMilliseconds / 1000.0f;
+		F32 secondsPassed = (F32)totalMicroseconds / 1000000.0f;
 		mDiagnostics.evalTokensPerSecond = totalGeneratedTokens / secondsPassed;
 	}
 
@@ -926,12 +1368,28 @@ GENERIC InfProcessorTextToText::_decode_next()
 
 GENERIC InfProcessorTextToText::_lora_operate()
 {
+	// runs on the processor thread between decode steps, the other processors of the model keep running
+	InfModelTextToText* t2tModel = static_cast<InfModelTextToText*>(this->mTargetModel_md_model);
+	mbase::lock_guard tmpLoraMutex(mLoraMutex);
+	mbase::vector<inf_lora_adapter> modelAdapters = t2tModel->get_adapters();
+	bool isChanged = false;
+
 	for(mbase::vector<inf_lora_adapter>::iterator It = mDeclaredAdapters.begin(); It != mDeclaredAdapters.end(); ++It)
 	{
-		if(!llama_set_adapter_lora(mModelContext, It->mAdapterHandle, It->mLoraScale))
+		mbase::vector<inf_lora_adapter>::iterator loadedIt = mbase::find(modelAdapters.begin(), modelAdapters.end(), *It);
+		if(loadedIt == modelAdapters.end() || mbase::find(mAssignedAdapters.begin(), mAssignedAdapters.end(), *It) != mAssignedAdapters.end())
+		{
+			// removed from the model in the meantime, or already attached
+			continue;
+		}
+
+		inf_lora_adapter loraAdapter = *loadedIt;
+		loraAdapter.mLoraScale = It->mLoraScale;
+		if(!llama_set_adapter_lora(mModelContext, loraAdapter.mAdapterHandle, loraAdapter.mLoraScale))
 		{
 			// means success
-			mAssignedAdapters.push_back(*It);
+			mAssignedAdapters.push_back(loraAdapter);
+			isChanged = true;
 		}
 	}
 
@@ -941,9 +1399,11 @@ GENERIC InfProcessorTextToText::_lora_operate()
 
 	for(mbase::vector<inf_lora_adapter>::iterator It = mAssignedAdapters.begin(); It != mAssignedAdapters.end(); ++It)
 	{
-		if(mbase::find(mRemoveAdapters.begin(), mRemoveAdapters.end(), *It) != mRemoveAdapters.end())
+		// adapters the model retired are detached too, the model frees them after every processor did so
+		if(mbase::find(mRemoveAdapters.begin(), mRemoveAdapters.end(), *It) != mRemoveAdapters.end() || !inf_has_adapter_handle(modelAdapters, It->mAdapterHandle))
 		{
 			llama_rm_adapter_lora(mModelContext, It->mAdapterHandle);
+			isChanged = true;
 		}
 
 		else
@@ -955,25 +1415,46 @@ GENERIC InfProcessorTextToText::_lora_operate()
 	mRemoveAdapters.clear();
 	mAssignedAdapters = newAssignedAdapters;
 
+	if(isChanged)
+	{
+		mKvTokenVector.clear(); // cached cells were computed with the previous adapters
+	}
+
 	mLoraOperationSignal.set_signal_finished();
 }
 
-GENERIC InfProcessorTextToText::_internal_adapter_remove(mbase::vector<inf_lora_adapter>& in_adapters_to_remove)
+GENERIC InfProcessorTextToText::_apply_pending_lora()
 {
-	mbase::vector<inf_lora_adapter> newAssignedAdapters;
-	for(mbase::vector<inf_lora_adapter>::iterator It = mAssignedAdapters.begin(); It != mAssignedAdapters.end(); ++It)
+	// An adapter change requested before the input was executed may still be pending if update_t checked
+	// the lora signal before it was set. The input is decoded with the adapters it was submitted with.
+	mLoraMutex.acquire();
+	bool isLoraPending = signal_lora_operate_process();
+	mLoraMutex.release();
+	if(isLoraPending)
 	{
-		if(mbase::find(in_adapters_to_remove.begin(), in_adapters_to_remove.end(), *It) != in_adapters_to_remove.end())
-		{
-			llama_rm_adapter_lora(mModelContext, It->mAdapterHandle);
-		}
+		_lora_operate();
+	}
+}
 
-		else
+GENERIC InfProcessorTextToText::_internal_adapter_remove(mbase::vector<inf_lora_adapter>& in_adapters_to_remove)
+{
+	// called by the model thread, the adapters are detached by the processor thread at the next decode step boundary
+	mbase::lock_guard tmpLoraMutex(mLoraMutex);
+	for(mbase::vector<inf_lora_adapter>::iterator It = in_adapters_to_remove.begin(); It != in_adapters_to_remove.end(); ++It)
+	{
+		inf_erase_adapter(mDeclaredAdapters, *It);
+		if(mbase::find(mRemoveAdapters.begin(), mRemoveAdapters.end(), *It) == mRemoveAdapters.end())
 		{
-			newAssignedAdapters.push_back(*It);
+			mRemoveAdapters.push_back(*It);
 		}
 	}
-	mAssignedAdapters = newAssignedAdapters;
+	mLoraOperationSignal.set_signal();
+}
+
+bool InfProcessorTextToText::_internal_is_adapter_attached(llama_adapter_lora* in_handle)
+{
+	mbase::lock_guard tmpLoraMutex(mLoraMutex);
+	return inf_has_adapter_handle(mAssignedAdapters, in_handle);
 }
 
 GENERIC InfProcessorTextToText::_initialize_context()
@@ -985,7 +1466,9 @@ GENERIC InfProcessorTextToText::_initialize_context()
 	ctxParams.n_threads = mThreadCount;
 	ctxParams.n_threads_batch = mBatchProcessThreadCount;
 	ctxParams.n_ubatch = mBatchSize / 4;
-	ctxParams.flash_attn = mFlashAttention;
+	ctxParams.flash_attn = mFlashAttention || mValueCacheType != inf_kv_cache_type::F16; // quantized v cache is only supported with flash attention
+	ctxParams.type_k = inf_common_kv_cache_ggml_type(mKeyCacheType);
+	ctxParams.type_v = inf_common_kv_cache_ggml_type(mValueCacheType);
 
 	InfModelTextToText* t2tModel = static_cast<InfModelTextToText*>(this->mTargetModel_md_model);
 
@@ -1028,6 +1511,43 @@ GENERIC InfProcessorTextToText::_initialize_context()
 
 	else
 	{
+		// top-k, top-p, min-p and temp are applied by a single fused sampler,
+		// unless typical-p has to run between them
+		bool isFused = false;
+		bool isFusedAdded = false;
+		inf_fused_sampler_params fusedParams;
+		for(inf_sampling_set::iterator It = mSamplerDescriptions.begin(); It != mSamplerDescriptions.end(); ++It)
+		{
+			switch (It->mSamplerType)
+			{
+			case InfSamplerDescription::SAMPLER::TOP_K:
+				fusedParams.mTopK = static_cast<I32>(It->mTopK);
+				isFused = true;
+				break;
+			case InfSamplerDescription::SAMPLER::TOP_P:
+				fusedParams.mTopP = It->mTopP;
+				isFused = true;
+				break;
+			case InfSamplerDescription::SAMPLER::MIN_P:
+				fusedParams.mMinP = It->mMinP;
+				isFused = true;
+				break;
+			case InfSamplerDescription::SAMPLER::TEMP:
+				fusedParams.mTemp = It->mTemp;
+				isFused = true;
+				break;
+			default:
+				break;
+			}
+		}
+
+		InfSamplerDescription typicalDescription;
+		if(has_sampler(InfSamplerDescription::SAMPLER::TYPICAL_P, typicalDescription))
+		{
+			isFused = false;
+		}
+
+		const llama_vocab* tmpVocab = llama_model_get_vocab(t2tModel->get_raw_model());
 		for(inf_sampling_set::iterator It = mSamplerDescriptions.begin(); It != mSamplerDescriptions.end(); ++It)
 		{
 			if(It->mSamplerType == InfSamplerDescription::SAMPLER::RNG)
@@ -1035,6 +1555,17 @@ GENERIC InfProcessorTextToText::_initialize_context()
 				seedValue = It->mRng;
 			}
 
+			if(isFused && (It->mSamplerType == InfSamplerDescription::SAMPLER::TOP_K || It->mSamplerType == InfSamplerDescription::SAMPLER::TOP_P ||
+				It->mSamplerType == InfSamplerDescription::SAMPLER::MIN_P || It->mSamplerType == InfSamplerDescription::SAMPLER::TEMP))
+			{
+				if(!isFusedAdded)
+				{
+					llama_sampler_chain_add(mSamplerChain, InfFusedSampler::init(fusedParams));
+					isFusedAdded = true;
+				}
+				continue;
+			}
+
 			if(It->mSamplerType == InfSamplerDescription::SAMPLER::REPETITION)
 			{
 				InfSamplingRepetition repeatSampler = It->mRepetition;
@@ -1049,6 +1580,25 @@ GENERIC InfProcessorTextToText::_initialize_context()
 				);
 			}
 
+			else if(It->mSamplerType == InfSamplerDescription::SAMPLER::DRY)
+			{
+				InfSamplingDRY drySampler = It->mDry;
+				const char* sequenceBreakers[] = {"\n", ":", "\"", "*"};
+				llama_sampler_chain_add(
+					mSamplerChain,
+					llama_sampler_init_dry(
+						tmpVocab,
+						llama_model_n_ctx_train(t2tModel->get_raw_model()),
+						drySampler.mDryMultiplier,
+						drySampler.mDryBase,
+						drySampler.mDryAllowedLength,
+						drySampler.mDryPenaltyLastN,
+						sequenceBreakers,
+						sizeof(sequenceBreakers) / sizeof(sequenceBreakers[0])
+					)
+				);
+			}
+
 			else if(It->mSamplerType == InfSamplerDescription::SAMPLER::TOP_K)
 			{
 				U32 kValue = It->mTopK;
@@ -1093,6 +1643,19 @@ GENERIC InfProcessorTextToText::_initialize_context()
 					llama_sampler_init_temp(temperature)
 				);
 			}
+			else if(It->mSamplerType == InfSamplerDescription::SAMPLER::XTC)
+			{
+				InfSamplingXTC xtcSampler = It->mXtc;
+				llama_sampler_chain_add(
+					mSamplerChain,
+					llama_sampler_init_xtc(
+						xtcSampler.mProbability,
+						xtcSampler.mThreshold,
+						1,
+						seedValue
+					)
+				);
+			}
 			else if(It->mSamplerType == InfSamplerDescription::SAMPLER::MIROSTAT_V2)
 			{
 				InfSamplingMirostatV2 mirostatObject = It->mMiroV2;
@@ -1120,23 +1683,32 @@ GENERIC InfProcessorTextToText::_destroy_context()
 {
 	// CONTEXT FACTORY RESET
 
+	mLoraMutex.acquire();
 	llama_clear_adapter_lora(mModelContext); // if any
 	llama_free(mModelContext);
+	mLoraMutex.release();
 	mModelContext = NULL;
 	mPresetCandidates.clear();
 	mTokenizedInput.clear();
 	mSamplerDescriptions.clear();
+	mSampleCandidates.clear();
 	mGeneratedTokenVector.clear();
 	mLogitTokenVector.clear();
+	mKvTokenVector.clear();
+	mTokenizedChunks.clear();
+	mChunkedTokenizeState = 0;
+	mLoraMutex.acquire();
 	mDeclaredAdapters.clear();
 	mRemoveAdapters.clear();
 	mAssignedAdapters.clear();
+	mLoraMutex.release();
 	mContextCursor = 0;
 	mBatchSize = 0;
 	mThreadCount = 0;
 	mProcessedBatchLength = 0;
 	mLogitStartIndex = 0;
 	mPromptStartIndex = 0;
+	mReusedTokenCount = 0;
 	mFlashAttention = false;
 	mIsRunning = false;
 	mIsInitializeFailed = false;
@@ -1148,6 +1720,7 @@ GENERIC InfProcessorTextToText::_destroy_context()
 	mLastFailCode = last_fail_code::MODEL_NOT_INITIALIZED;
 
 	clear_samplers();
+	clear_grammar();
 	
 	mTargetModel_md_model = NULL;
 	mIsRegistered = false;
@@ -1222,7 +1795,7 @@ GENERIC InfProcessorTextToText::update()
 	if(signal_state_lora_operate())
 	{
 		mLoraOperationSignal.reset_signal_state();
-		on_lora_operate(mAssignedAdapters);
+		on_lora_operate(get_assigned_adapters());
 		return;
 	}
 
@@ -1288,7 +1861,8 @@ GENERIC InfProcessorTextToText::update_t()
 
 		if (is_running())
 		{
-			if(signal_lora_operate_process())
+			// a response being generated keeps its adapters, a change requested meanwhile applies to the next input
+			if(signal_lora_operate_process() && mFinishState != finish_state::CONTINUE)
 			{
 				_lora_operate();
 			}
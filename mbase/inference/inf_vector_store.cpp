@@ -0,0 +1,1649 @@
+#include <mbase/inference/inf_vector_store.h>
+#include <mbase/inference/inf_common.h>
+#include <mbase/filesystem.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+
+MBASE_BEGIN
+
+static const U32 gInfVsMagic = 0x5356424D; // "MBVS"
+static const U32 gInfVsLogMagic = 0x5256424D; // "MBVR"
+static const U32 gInfVsVersion = 1;
+static const U64 gInfVsSectionAlignment = 64;
+static const U32 gInfVsNoUpperLinks = 0xFFFFFFFF;
+static const U32 gInfVsMaxLevel = 15;
+static const SIZE_T gInfVsFlatBlockRows = 4096;
+
+#if defined(__GNUC__) || defined(__clang__)
+    #define INF_VS_PREFETCH(in_address) __builtin_prefetch(in_address)
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    #include <xmmintrin.h>
+    #define INF_VS_PREFETCH(in_address) _mm_prefetch(reinterpret_cast<const char*>(in_address), _MM_HINT_T0)
+#else
+    #define INF_VS_PREFETCH(in_address)
+#endif
+
+// Store file header, every section offset is aligned to gInfVsSectionAlignment
+// so that the vectors are read from the mapping with aligned SIMD loads
+struct inf_vs_file_header {
+    U32 mMagic;
+    U32 mVersion;
+    U32 mDimension;
+    U32 mIndexType;
+    U64 mRowCount;
+    U64 mFileSize;
+    U64 mVectorOffset;
+    U64 mTagOffset;
+    U64 mKeyOffsetsOffset;
+    U64 mKeyBlobOffset;
+    U64 mIndexSections[4]; // HNSW: levels, level 0 links, upper offsets, upper links. IVF: centroids, list offsets, list rows
+    U64 mIndexAux; // HNSW: upper link count
+    U32 mIndexTrained;
+    U32 mHnswM;
+    U32 mHnswEfConstruction;
+    U32 mHnswEntryPoint;
+    I32 mHnswMaxLevel;
+    U32 mIvfListCount;
+};
+
+// Log record, followed by the key bytes and mDimension floats
+struct inf_vs_log_record {
+    U32 mMagic;
+    U32 mKeyLength;
+    U64 mTag;
+    U32 mDimension;
+    U32 mChecksum;
+};
+
+static U64 inf_vs_align(const U64& in_offset)
+{
+    return (in_offset + gInfVsSectionAlignment - 1) & ~(gInfVsSectionAlignment - 1);
+}
+
+static U32 inf_vs_checksum(const U64& in_tag, const IBYTE* in_key, const U32& in_key_length, const F32* in_vector, const U32& in_dimension)
+{
+    // FNV-1a, only meant to detect torn or garbage records at the end of the log
+    U32 hashValue = 2166136261u;
+    auto feedBytes = [&hashValue](const U8* in_bytes, SIZE_T in_length) {
+        for(SIZE_T i = 0; i < in_length; ++i)
+        {
+            hashValue ^= in_bytes[i];
+            hashValue *= 16777619u;
+        }
+    };
+    feedBytes(reinterpret_cast<const U8*>(&in_tag), sizeof(in_tag));
+    feedBytes(reinterpret_cast<const U8*>(in_key), in_key_length);
+    feedBytes(reinterpret_cast<const U8*>(in_vector), sizeof(F32) * in_dimension);
+    return hashValue;
+}
+
+static bool inf_vs_section_fits(const U64& in_offset, const U64& in_length, const U64& in_file_size)
+{
+    return in_offset <= in_file_size && in_length <= in_file_size - in_offset;
+}
+
+// in_count elements of in_element_size bytes, the product is never formed so a huge count can't wrap around
+static bool inf_vs_array_fits(const U64& in_offset, const U64& in_count, const U64& in_element_size, const U64& in_file_size)
+{
+    return in_offset <= in_file_size && in_count <= (in_file_size - in_offset) / in_element_size;
+}
+
+// HNSW link list, [count, neighbors...], read from an untrusted file
+static bool inf_vs_links_valid(const U32* in_links, const U32& in_max_links, const U64& in_row_count)
+{
+    if(in_links[0] > in_max_links)
+    {
+        return false;
+    }
+    for(U32 i = 1; i <= in_links[0]; ++i)
+    {
+        if(in_links[i] >= in_row_count)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool inf_vs_rename(const mbase::string& in_from, const mbase::string& in_to)
+{
+#ifdef MBASE_PLATFORM_WINDOWS
+    return MoveFileExW(mbase::from_utf8(in_from).c_str(), mbase::from_utf8(in_to).c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#endif
+#ifdef MBASE_PLATFORM_UNIX
+    return rename(in_from.c_str(), in_to.c_str()) == 0;
+#endif
+}
+
+// heap comparators, with the higher score on the right the worst result stays on top (bounded result heap),
+// with the lower score on the right the best candidate stays on top (HNSW expansion queue)
+template<typename CandidateType>
+static bool inf_vs_candidate_worst_on_top(const CandidateType& in_lhs, const CandidateType& in_rhs)
+{
+    return in_lhs.mScore > in_rhs.mScore;
+}
+
+template<typename CandidateType>
+static bool inf_vs_candidate_best_on_top(const CandidateType& in_lhs, const CandidateType& in_rhs)
+{
+    return in_lhs.mScore < in_rhs.mScore;
+}
+
+template<typename T>
+static GENERIC inf_vs_append_raw(mbase::vector<T>& out_vector, const T* in_data, const SIZE_T& in_count)
+{
+    if(out_vector.size() + in_count > out_vector.capacity())
+    {
+        // geometric growth, appends of a row at a time would otherwise reallocate on every call
+        out_vector.reserve(std::max<SIZE_T>(out_vector.capacity() * 2, out_vector.size() + in_count));
+    }
+    for(SIZE_T i = 0; i < in_count; ++i)
+    {
+        out_vector.push_back(in_data[i]);
+    }
+}
+
+template<typename T>
+static GENERIC inf_vs_append_fill(mbase::vector<T>& out_vector, const T& in_value, const SIZE_T& in_count)
+{
+    if(out_vector.size() + in_count > out_vector.capacity())
+    {
+        out_vector.reserve(std::max<SIZE_T>(out_vector.capacity() * 2, out_vector.size() + in_count));
+    }
+    for(SIZE_T i = 0; i < in_count; ++i)
+    {
+        out_vector.push_back(in_value);
+    }
+}
+
+InfVectorStore::InfVectorStore() noexcept :
+    mStorePath(),
+    mMappedStore(),
+    mLogFile(),
+    mParams(),
+    mIndexType(index_type::HNSW),
+    mDimension(0),
+    mIsOpen(false),
+    mMappedRowCount(0),
+    mLogRowCount(0),
+    mMappedVectors(NULL),
+    mMappedTags(NULL),
+    mMappedKeyOffsets(NULL),
+    mMappedKeyBlob(NULL),
+    mKeyIndexBuilt(false),
+    mIvfMappedCentroids(NULL),
+    mIvfMappedListOffsets(NULL),
+    mIvfMappedListRows(NULL),
+    mIvfListCount(0),
+    mHnswMappedRows(0),
+    mHnswMappedLevels(NULL),
+    mHnswMappedLinks(NULL),
+    mHnswMappedUpperOffsets(NULL),
+    mHnswMappedUpperLinks(NULL),
+    mHnswM0(0),
+    mHnswEntryPoint(0),
+    mHnswMaxLevel(-1),
+    mHnswLevelMultiplier(0.0),
+    mVisitEpoch(0)
+{
+}
+
+InfVectorStore::~InfVectorStore() noexcept
+{
+    close_store();
+}
+
+MBASE_ND(MBASE_OBS_IGNORE) bool InfVectorStore::is_open() const noexcept
+{
+    return mIsOpen;
+}
+
+MBASE_ND(MBASE_OBS_IGNORE) bool InfVectorStore::is_persistent() const noexcept
+{
+    return mStorePath.size() != 0;
+}
+
+MBASE_ND(MBASE_OBS_IGNORE) bool InfVectorStore::is_index_trained() const noexcept
+{
+    if(mIndexType == index_type::IVF)
+    {
+        return mIvfListCount != 0;
+    }
+    return true;
+}
+
+MBASE_ND(MBASE_OBS_IGNORE) typename InfVectorStore::index_type InfVectorStore::get_index_type() const noexcept
+{
+    return mIndexType;
+}
+
+MBASE_ND(MBASE_OBS_IGNORE) const inf_vector_index_params& InfVectorStore::get_index_params() const noexcept
+{
+    return mParams;
+}
+
+MBASE_ND(MBASE_OBS_IGNORE) U32 InfVectorStore::get_dimension() const noexcept
+{
+    return mDimension;
+}
+
+MBASE_ND(MBASE_OBS_IGNORE) typename InfVectorStore::size_type InfVectorStore::get_row_count() const noexcept
+{
+    return mMappedRowCount + mTailTags.size();
+}
+
+MBASE_ND(MBASE_OBS_IGNORE) typename InfVectorStore::size_type InfVectorStore::get_mapped_row_count() const noexcept
+{
+    return mMappedRowCount;
+}
+
+MBASE_ND(MBASE_OBS_IGNORE) typename InfVectorStore::size_type InfVectorStore::get_log_row_count() const noexcept
+{
+    return mLogRowCount;
+}
+
+MBASE_ND(MBASE_OBS_IGNORE) const mbase::string& InfVectorStore::get_store_path() const noexcept
+{
+    return mStorePath;
+}
+
+MBASE_ND(MBASE_OBS_IGNORE) const F32* InfVectorStore::get_vector(const U32& in_row) const noexcept
+{
+    if(in_row < mMappedRowCount)
+    {
+        return mMappedVectors + static_cast<size_type>(in_row) * mDimension;
+    }
+    return mTailVectors.data() + static_cast<size_type>(in_row - mMappedRowCount) * mDimension;
+}
+
+MBASE_ND(MBASE_OBS_IGNORE) U64 InfVectorStore::get_tag(const U32& in_row) const noexcept
+{
+    if(in_row < mMappedRowCount)
+    {
+        return mMappedTags[in_row];
+    }
+    return mTailTags[in_row - mMappedRowCount];
+}
+
+MBASE_ND(MBASE_OBS_IGNORE) mbase::string InfVectorStore::get_key(const U32& in_row) const
+{
+    if(in_row < mMappedRowCount)
+    {
+        U64 keyBegin = mMappedKeyOffsets[in_row];
+        U64 keyEnd = mMappedKeyOffsets[in_row + 1];
+        if(keyBegin == keyEnd)
+        {
+            return mbase::string();
+        }
+        return mbase::string(mMappedKeyBlob + keyBegin, keyEnd - keyBegin);
+    }
+    return mTailKeys[in_row - mMappedRowCount];
+}
+
+MBASE_ND(MBASE_OBS_IGNORE) bool InfVectorStore::find_key(const mbase::string& in_key, U32& out_row)
+{
+    if(!mKeyIndexBuilt)
+    {
+        _build_key_index();
+    }
+    auto keyIt = mKeyIndex.find(in_key);
+    if(keyIt == mKeyIndex.end())
+    {
+        return false;
+    }
+    out_row = keyIt->second;
+    return true;
+}
+
+typename InfVectorStore::flags InfVectorStore::initialize(const U32& in_dimension, index_type in_type, const inf_vector_index_params& in_params)
+{
+    if(mIsOpen)
+    {
+        return flags::INF_VS_ERR_ALREADY_OPEN;
+    }
+
+    if(!in_dimension)
+    {
+        return flags::INF_VS_ERR_INVALID_DIMENSION;
+    }
+
+    mDimension = in_dimension;
+    mIndexType = in_type;
+    mParams = in_params;
+    _reset();
+    mIsOpen = true;
+    return flags::INF_VS_SUCCESS;
+}
+
+typename InfVectorStore::flags InfVectorStore::open_store(const mbase::string& in_path, const U32& in_dimension, index_type in_type, const inf_vector_index_params& in_params)
+{
+    if(mIsOpen)
+    {
+        return flags::INF_VS_ERR_ALREADY_OPEN;
+    }
+
+    // the dimension may be zero when opening an existing store, it is read from the file
+    mStorePath = in_path;
+    mDimension = in_dimension;
+    mIndexType = in_type;
+    mParams = in_params;
+    _reset();
+
+    flags loadResult = _load_store_file();
+    if(loadResult != flags::INF_VS_SUCCESS)
+    {
+        close_store();
+        return loadResult;
+    }
+
+    if(!mDimension)
+    {
+        close_store();
+        return flags::INF_VS_ERR_INVALID_DIMENSION;
+    }
+
+    loadResult = _replay_log();
+    if(loadResult != flags::INF_VS_SUCCESS)
+    {
+        close_store();
+        return loadResult;
+    }
+
+    mbase::string logPath = mStorePath + ".log";
+    if(mbase::is_file_valid(mbase::from_utf8(logPath)))
+    {
+        mLogFile.open_file(logPath, mbase::io_file::access_mode::WRITE_ACCESS, mbase::io_file::disposition::APPEND);
+    }
+    else
+    {
+        mLogFile.open_file(logPath, mbase::io_file::access_mode::WRITE_ACCESS, mbase::io_file::disposition::OVERWRITE);
+    }
+
+    if(!mLogFile.is_file_open())
+    {
+        close_store();
+        return flags::INF_VS_ERR_UNABLE_TO_OPEN_FILE;
+    }
+
+    mIsOpen = true;
+    return flags::INF_VS_SUCCESS;
+}
+
+typename InfVectorStore::flags InfVectorStore::add(const PTRF32 in_vector, const mbase::string& in_key, const U64& in_tag, U32* out_row)
+{
+    if(!mIsOpen)
+    {
+        return flags::INF_VS_ERR_NOT_OPEN;
+    }
+
+    U32 existingRow = 0;
+    if(in_key.size() && find_key(in_key, existingRow))
+    {
+        return flags::INF_VS_ERR_DUPLICATE_KEY;
+    }
+
+    U32 newRow = static_cast<U32>(get_row_count());
+    _append_row(in_vector, in_key, in_tag);
+    if(out_row)
+    {
+        *out_row = newRow;
+    }
+
+    if(!is_persistent())
+    {
+        return flags::INF_VS_SUCCESS;
+    }
+
+    // the record is assembled first so that it reaches the log in a single write
+    const F32* normalizedVector = get_vector(newRow);
+    inf_vs_log_record logRecord;
+    logRecord.mMagic = gInfVsLogMagic;
+    logRecord.mKeyLength = static_cast<U32>(in_key.size());
+    logRecord.mTag = in_tag;
+    logRecord.mDimension = mDimension;
+    logRecord.mChecksum = inf_vs_checksum(in_tag, in_key.c_str(), logRecord.mKeyLength, normalizedVector, mDimension);
+
+    mbase::vector<IBYTE> recordBuffer;
+    recordBuffer.reserve(sizeof(logRecord) + in_key.size() + sizeof(F32) * mDimension);
+    inf_vs_append_raw(recordBuffer, reinterpret_cast<const IBYTE*>(&logRecord), sizeof(logRecord));
+    inf_vs_append_raw(recordBuffer, in_key.c_str(), in_key.size());
+    inf_vs_append_raw(recordBuffer, reinterpret_cast<const IBYTE*>(normalizedVector), sizeof(F32) * mDimension);
+
+    if(mLogFile.write_data(recordBuffer.data(), recordBuffer.size()) != recordBuffer.size())
+    {
+        // the row stays searchable in memory but it will not survive a restart
+        return flags::INF_VS_ERR_UNABLE_TO_WRITE_FILE;
+    }
+    ++mLogRowCount;
+    return flags::INF_VS_SUCCESS;
+}
+
+typename InfVectorStore::flags InfVectorStore::build_index()
+{
+    return build_index(mIndexType);
+}
+
+typename InfVectorStore::flags InfVectorStore::build_index(index_type in_type)
+{
+    if(!mIsOpen)
+    {
+        return flags::INF_VS_ERR_NOT_OPEN;
+    }
+
+    mIndexType = in_type;
+    mIvfCentroids.clear();
+    mIvfLists.clear();
+    mIvfMappedCentroids = NULL;
+    mIvfMappedListOffsets = NULL;
+    mIvfMappedListRows = NULL;
+    mIvfListCount = 0;
+    _hnsw_reset();
+
+    if(mIndexType == index_type::IVF)
+    {
+        _ivf_train();
+    }
+    else if(mIndexType == index_type::HNSW)
+    {
+        size_type rowCount = get_row_count();
+        for(size_type i = 0; i < rowCount; ++i)
+        {
+            _hnsw_insert(static_cast<U32>(i));
+        }
+    }
+    return flags::INF_VS_SUCCESS;
+}
+
+typename InfVectorStore::flags InfVectorStore::search(const PTRF32 in_query, const size_type& in_k, search_result_vector& out_results, const inf_vector_search_options& in_options) const
+{
+    out_results.clear();
+    if(!mIsOpen)
+    {
+        return flags::INF_VS_ERR_NOT_OPEN;
+    }
+
+    if(!in_k || !get_row_count())
+    {
+        return flags::INF_VS_SUCCESS;
+    }
+
+    mbase::vector<F32> normalizedQuery;
+    inf_vs_append_raw(normalizedQuery, static_cast<const F32*>(in_query), mDimension);
+    inf_common_embd_normalize(normalizedQuery.data(), normalizedQuery.data(), mDimension);
+
+    candidate_vector resultHeap;
+    resultHeap.reserve(in_k + 1);
+
+    if(in_options.mExact || mIndexType == index_type::FLAT || !is_index_trained())
+    {
+        _search_flat(normalizedQuery.data(), in_k, in_options, resultHeap);
+    }
+    else if(mIndexType == index_type::IVF)
+    {
+        _search_ivf(normalizedQuery.data(), in_k, in_options, resultHeap);
+    }
+    else
+    {
+        _search_hnsw(normalizedQuery.data(), in_k, in_options, resultHeap);
+    }
+
+    _finish_results(resultHeap, out_results);
+    return flags::INF_VS_SUCCESS;
+}
+
+typename InfVectorStore::flags InfVectorStore::save()
+{
+    if(!mIsOpen)
+    {
+        return flags::INF_VS_ERR_NOT_OPEN;
+    }
+
+    if(!is_persistent())
+    {
+        return flags::INF_VS_ERR_NO_STORE_FILE;
+    }
+
+    if(mIndexType == index_type::IVF && !is_index_trained())
+    {
+        _ivf_train();
+    }
+
+    // the new store is written next to the old one and renamed over it,
+    // a crash at any point leaves either the old store and its log or the new store
+    mbase::string tmpPath = mStorePath + ".tmp";
+    flags writeResult = _write_store_file(tmpPath);
+    if(writeResult != flags::INF_VS_SUCCESS)
+    {
+        mbase::delete_file(mbase::from_utf8(tmpPath));
+        return writeResult;
+    }
+
+    mMappedStore.close_file();
+    bool isRenamed = inf_vs_rename(tmpPath, mStorePath);
+    if(isRenamed)
+    {
+        mLogFile.clear_file();
+    }
+
+    _reset();
+    flags loadResult = _load_store_file();
+    if(loadResult == flags::INF_VS_SUCCESS && !isRenamed)
+    {
+        loadResult = _replay_log();
+    }
+
+    if(loadResult != flags::INF_VS_SUCCESS)
+    {
+        close_store();
+        return loadResult;
+    }
+
+    if(!isRenamed)
+    {
+        mbase::delete_file(mbase::from_utf8(tmpPath));
+        return flags::INF_VS_ERR_UNABLE_TO_WRITE_FILE;
+    }
+    return flags::INF_VS_SUCCESS;
+}
+
+GENERIC InfVectorStore::close_store() noexcept
+{
+    _reset();
+    mMappedStore.close_file();
+    mLogFile.close_file();
+    mStorePath.clear();
+    mIsOpen = false;
+}
+
+typename InfVectorStore::flags InfVectorStore::_load_store_file()
+{
+    if(!mbase::is_file_valid(mbase::from_utf8(mStorePath)))
+    {
+        // new store, nothing is written until the first add
+        return flags::INF_VS_SUCCESS;
+    }
+
+    if(!mMappedStore.open_file(mStorePath, mbase::mapped_file::access_advice::RANDOM))
+    {
+        return flags::INF_VS_ERR_UNABLE_TO_OPEN_FILE;
+    }
+
+    const U64 fileSize = mMappedStore.get_file_size();
+    IBYTEBUFFER storeBuffer = mMappedStore.get_buffer();
+    if(fileSize < sizeof(inf_vs_file_header))
+    {
+        return flags::INF_VS_ERR_CORRUPTED_STORE;
+    }
+
+    inf_vs_file_header fileHeader;
+    memcpy(&fileHeader, storeBuffer, sizeof(fileHeader));
+    if(fileHeader.mMagic != gInfVsMagic || fileHeader.mVersion != gInfVsVersion || fileHeader.mFileSize != fileSize || !fileHeader.mDimension)
+    {
+        return flags::INF_VS_ERR_CORRUPTED_STORE;
+    }
+
+    if(mDimension && mDimension != fileHeader.mDimension)
+    {
+        return flags::INF_VS_ERR_DIMENSION_MISMATCH;
+    }
+
+    if(fileHeader.mIndexType > static_cast<U32>(index_type::HNSW))
+    {
+        return flags::INF_VS_ERR_CORRUPTED_STORE;
+    }
+
+    const U64 rowCount = fileHeader.mRowCount;
+    if(rowCount >= gInfVsNoUpperLinks ||
+        !inf_vs_array_fits(fileHeader.mVectorOffset, rowCount, static_cast<U64>(fileHeader.mDimension) * sizeof(F32), fileSize) ||
+        !inf_vs_array_fits(fileHeader.mTagOffset, rowCount, sizeof(U64), fileSize) ||
+        !inf_vs_array_fits(fileHeader.mKeyOffsetsOffset, rowCount + 1, sizeof(U64), fileSize))
+    {
+        return flags::INF_VS_ERR_CORRUPTED_STORE;
+    }
+
+    // get_key slices the blob between two neighboring offsets
+    const U64* keyOffsets = reinterpret_cast<const U64*>(storeBuffer + fileHeader.mKeyOffsetsOffset);
+    if(keyOffsets[0] || !inf_vs_section_fits(fileHeader.mKeyBlobOffset, keyOffsets[rowCount], fileSize))
+    {
+        return flags::INF_VS_ERR_CORRUPTED_STORE;
+    }
+    for(U64 i = 0; i < rowCount; ++i)
+    {
+        if(keyOffsets[i + 1] < keyOffsets[i])
+        {
+            return flags::INF_VS_ERR_CORRUPTED_STORE;
+        }
+    }
+
+    // the index type and the structural parameters of an existing store win over the requested ones,
+    // build_index(type) converts the store afterwards
+    mDimension = fileHeader.mDimension;
+    mIndexType = static_cast<index_type>(fileHeader.mIndexType);
+    mMappedRowCount = rowCount;
+    mMappedVectors = reinterpret_cast<const F32*>(storeBuffer + fileHeader.mVectorOffset);
+    mMappedTags = reinterpret_cast<const U64*>(storeBuffer + fileHeader.mTagOffset);
+    mMappedKeyOffsets = keyOffsets;
+    mMappedKeyBlob = storeBuffer + fileHeader.mKeyBlobOffset;
+
+    if(!fileHeader.mIndexTrained)
+    {
+        _hnsw_reset();
+        if(mIndexType == index_type::HNSW)
+        {
+            // store was saved without a graph, build it once over the mapped rows
+            for(U64 i = 0; i < rowCount; ++i)
+            {
+                _hnsw_insert(static_cast<U32>(i));
+            }
+        }
+        return flags::INF_VS_SUCCESS;
+    }
+
+    if(mIndexType == index_type::IVF)
+    {
+        const U64 listCount = fileHeader.mIvfListCount;
+        if(!listCount ||
+            !inf_vs_array_fits(fileHeader.mIndexSections[0], listCount, static_cast<U64>(mDimension) * sizeof(F32), fileSize) ||
+            !inf_vs_array_fits(fileHeader.mIndexSections[1], listCount + 1, sizeof(U64), fileSize) ||
+            !inf_vs_array_fits(fileHeader.mIndexSections[2], rowCount, sizeof(U32), fileSize))
+        {
+            return flags::INF_VS_ERR_CORRUPTED_STORE;
+        }
+
+        mIvfListCount = static_cast<U32>(listCount);
+        mIvfMappedCentroids = reinterpret_cast<const F32*>(storeBuffer + fileHeader.mIndexSections[0]);
+        mIvfMappedListOffsets = reinterpret_cast<const U64*>(storeBuffer + fileHeader.mIndexSections[1]);
+        mIvfMappedListRows = reinterpret_cast<const U32*>(storeBuffer + fileHeader.mIndexSections[2]);
+        if(mIvfMappedListOffsets[0] || mIvfMappedListOffsets[listCount] != rowCount)
+        {
+            return flags::INF_VS_ERR_CORRUPTED_STORE;
+        }
+        for(U64 i = 0; i < listCount; ++i)
+        {
+            if(mIvfMappedListOffsets[i + 1] < mIvfMappedListOffsets[i])
+            {
+                return flags::INF_VS_ERR_CORRUPTED_STORE;
+            }
+        }
+        for(U64 i = 0; i < rowCount; ++i)
+        {
+            if(mIvfMappedListRows[i] >= rowCount)
+            {
+                return flags::INF_VS_ERR_CORRUPTED_STORE;
+            }
+        }
+        mIvfLists.reserve(listCount);
+        for(U64 i = 0; i < listCount; ++i)
+        {
+            mIvfLists.push_back(mbase::vector<U32>());
+        }
+    }
+
+    else if(mIndexType == index_type::HNSW)
+    {
+        if(!fileHeader.mHnswM || fileHeader.mHnswM > 0xFFFF || fileHeader.mHnswMaxLevel > static_cast<I32>(gInfVsMaxLevel) ||
+            (rowCount && (fileHeader.mHnswEntryPoint >= rowCount || fileHeader.mHnswMaxLevel < 0)))
+        {
+            return flags::INF_VS_ERR_CORRUPTED_STORE;
+        }
+
+        mParams.mHnswM = fileHeader.mHnswM;
+        mParams.mHnswEfConstruction = fileHeader.mHnswEfConstruction;
+        _hnsw_reset();
+
+        const U64 linkStride = mHnswM0 + 1;
+        if(!inf_vs_section_fits(fileHeader.mIndexSections[0], rowCount, fileSize) ||
+            !inf_vs_array_fits(fileHeader.mIndexSections[1], rowCount, linkStride * sizeof(U32), fileSize) ||
+            !inf_vs_array_fits(fileHeader.mIndexSections[2], rowCount, sizeof(U32), fileSize) ||
+            !inf_vs_array_fits(fileHeader.mIndexSections[3], fileHeader.mIndexAux, sizeof(U32), fileSize))
+        {
+            return flags::INF_VS_ERR_CORRUPTED_STORE;
+        }
+
+        // the graph is walked without bounds checks, every level, offset and neighbor id is checked once here
+        const U8* nodeLevels = reinterpret_cast<const U8*>(storeBuffer + fileHeader.mIndexSections[0]);
+        const U32* levelZeroLinks = reinterpret_cast<const U32*>(storeBuffer + fileHeader.mIndexSections[1]);
+        const U32* upperOffsets = reinterpret_cast<const U32*>(storeBuffer + fileHeader.mIndexSections[2]);
+        const U32* upperLinks = reinterpret_cast<const U32*>(storeBuffer + fileHeader.mIndexSections[3]);
+        const U64 upperStride = static_cast<U64>(fileHeader.mHnswM) + 1;
+        if(rowCount && nodeLevels[fileHeader.mHnswEntryPoint] != static_cast<U32>(fileHeader.mHnswMaxLevel))
+        {
+            return flags::INF_VS_ERR_CORRUPTED_STORE;
+        }
+        for(U64 i = 0; i < rowCount; ++i)
+        {
+            const U32 nodeLevel = nodeLevels[i];
+            if(nodeLevel > static_cast<U32>(fileHeader.mHnswMaxLevel) || !inf_vs_links_valid(levelZeroLinks + i * linkStride, mHnswM0, rowCount))
+            {
+                return flags::INF_VS_ERR_CORRUPTED_STORE;
+            }
+
+            if(!nodeLevel)
+            {
+                if(upperOffsets[i] != gInfVsNoUpperLinks)
+                {
+                    return flags::INF_VS_ERR_CORRUPTED_STORE;
+                }
+                continue;
+            }
+
+            if(upperOffsets[i] > fileHeader.mIndexAux || nodeLevel * upperStride > fileHeader.mIndexAux - upperOffsets[i])
+            {
+                return flags::INF_VS_ERR_CORRUPTED_STORE;
+            }
+            for(U32 j = 0; j < nodeLevel; ++j)
+            {
+                if(!inf_vs_links_valid(upperLinks + upperOffsets[i] + j * upperStride, fileHeader.mHnswM, rowCount))
+                {
+                    return flags::INF_VS_ERR_CORRUPTED_STORE;
+                }
+            }
+        }
+
+        // links are mutable through the private mapping, reverse links of new rows land on copied pages
+        mHnswMappedRows = rowCount;
+        mHnswMappedLevels = reinterpret_cast<const U8*>(storeBuffer + fileHeader.mIndexSections[0]);
+        mHnswMappedLinks = reinterpret_cast<U32*>(storeBuffer + fileHeader.mIndexSections[1]);
+        mHnswMappedUpperOffsets = reinterpret_cast<const U32*>(storeBuffer + fileHeader.mIndexSections[2]);
+        mHnswMappedUpperLinks = reinterpret_cast<U32*>(storeBuffer + fileHeader.mIndexSections[3]);
+        mHnswEntryPoint = fileHeader.mHnswEntryPoint;
+        mHnswMaxLevel = rowCount ? fileHeader.mHnswMaxLevel : -1;
+    }
+
+    return flags::INF_VS_SUCCESS;
+}
+
+typename InfVectorStore::flags InfVectorStore::_replay_log()
+{
+    mbase::string logPath = mStorePath + ".log";
+    if(!mbase::is_file_valid(mbase::from_utf8(logPath)))
+    {
+        return flags::INF_VS_SUCCESS;
+    }
+
+    mbase::mapped_file logMapping;
+    if(!logMapping.open_file(logPath, mbase::mapped_file::access_advice::SEQUENTIAL))
+    {
+        return flags::INF_VS_ERR_UNABLE_TO_OPEN_FILE;
+    }
+
+    const IBYTE* logBuffer = logMapping.get_buffer();
+    const size_type logSize = logMapping.get_file_size();
+    size_type validLength = 0;
+    mbase::vector<F32> recordVector;
+    inf_vs_append_fill(recordVector, 0.0f, mDimension);
+
+    while(logSize - validLength >= sizeof(inf_vs_log_record))
+    {
+        inf_vs_log_record logRecord;
+        memcpy(&logRecord, logBuffer + validLength, sizeof(logRecord));
+        const size_type recordLength = sizeof(logRecord) + logRecord.mKeyLength + sizeof(F32) * static_cast<size_type>(logRecord.mDimension);
+        if(logRecord.mMagic != gInfVsLogMagic || logRecord.mDimension != mDimension || recordLength > logSize - validLength)
+        {
+            break;
+        }
+
+        const IBYTE* keyData = logBuffer + validLength + sizeof(logRecord);
+        memcpy(recordVector.data(), keyData + logRecord.mKeyLength, sizeof(F32) * mDimension);
+        if(logRecord.mChecksum != inf_vs_checksum(logRecord.mTag, keyData, logRecord.mKeyLength, recordVector.data(), mDimension))
+        {
+            break;
+        }
+
+        _append_row(recordVector.data(), mbase::string(keyData, logRecord.mKeyLength), logRecord.mTag);
+        ++mLogRowCount;
+        validLength += recordLength;
+    }
+
+    if(validLength != logSize)
+    {
+        // a torn record at the end of the log, keep the valid prefix only
+        mbase::string validPrefix(logBuffer, validLength);
+        logMapping.close_file();
+        if(!mbase::write_string_to_file(logPath, validPrefix))
+        {
+            return flags::INF_VS_ERR_UNABLE_TO_WRITE_FILE;
+        }
+    }
+    return flags::INF_VS_SUCCESS;
+}
+
+typename InfVectorStore::flags InfVectorStore::_append_row(const PTRF32 in_vector, const mbase::string& in_key, const U64& in_tag)
+{
+    const size_type vectorOffset = mTailVectors.size();
+    inf_vs_append_raw(mTailVectors, static_cast<const F32*>(in_vector), mDimension);
+    inf_common_embd_normalize(mTailVectors.data() + vectorOffset, mTailVectors.data() + vectorOffset, mDimension);
+    mTailTags.push_back(in_tag);
+    mTailKeys.push_back(in_key);
+
+    U32 newRow = static_cast<U32>(get_row_count() - 1);
+    if(mKeyIndexBuilt && in_key.size())
+    {
+        mKeyIndex[in_key] = newRow;
+    }
+    _index_row(newRow);
+    return flags::INF_VS_SUCCESS;
+}
+
+typename InfVectorStore::flags InfVectorStore::_write_store_file(const mbase::string& in_path)
+{
+    const U64 rowCount = get_row_count();
+    const U64 tailRowCount = rowCount - mMappedRowCount;
+    const U64 mappedKeyBlobSize = mMappedRowCount ? mMappedKeyOffsets[mMappedRowCount] : 0;
+    U64 keyBlobSize = mappedKeyBlobSize;
+    for(const mbase::string& tmpKey : mTailKeys)
+    {
+        keyBlobSize += tmpKey.size();
+    }
+
+    const bool hasIndex = is_index_trained() && mIndexType != index_type::FLAT && rowCount;
+
+    inf_vs_file_header fileHeader;
+    memset(&fileHeader, 0, sizeof(fileHeader));
+    fileHeader.mMagic = gInfVsMagic;
+    fileHeader.mVersion = gInfVsVersion;
+    fileHeader.mDimension = mDimension;
+    fileHeader.mIndexType = static_cast<U32>(mIndexType);
+    fileHeader.mRowCount = rowCount;
+    fileHeader.mIndexTrained = hasIndex ? 1 : 0;
+    fileHeader.mHnswM = mParams.mHnswM;
+    fileHeader.mHnswEfConstruction = mParams.mHnswEfConstruction;
+    fileHeader.mHnswEntryPoint = mHnswEntryPoint;
+    fileHeader.mHnswMaxLevel = mHnswMaxLevel;
+    fileHeader.mIvfListCount = mIvfListCount;
+
+    U64 fileCursor = inf_vs_align(sizeof(fileHeader));
+    fileHeader.mVectorOffset = fileCursor;
+    fileCursor = inf_vs_align(fileCursor + rowCount * mDimension * sizeof(F32));
+    fileHeader.mTagOffset = fileCursor;
+    fileCursor = inf_vs_align(fileCursor + rowCount * sizeof(U64));
+    fileHeader.mKeyOffsetsOffset = fileCursor;
+    fileCursor = inf_vs_align(fileCursor + (rowCount + 1) * sizeof(U64));
+    fileHeader.mKeyBlobOffset = fileCursor;
+    fileCursor = inf_vs_align(fileCursor + keyBlobSize);
+
+    U64 sectionSizes[4] = {0, 0, 0, 0};
+    if(hasIndex && mIndexType == index_type::IVF)
+    {
+        sectionSizes[0] = static_cast<U64>(mIvfListCount) * mDimension * sizeof(F32);
+        sectionSizes[1] = (static_cast<U64>(mIvfListCount) + 1) * sizeof(U64);
+        sectionSizes[2] = rowCount * sizeof(U32);
+    }
+    else if(hasIndex && mIndexType == index_type::HNSW)
+    {
+        U64 upperLinkCount = 0;
+        for(U64 i = 0; i < rowCount; ++i)
+        {
+            upperLinkCount += static_cast<U64>(_hnsw_node_level(static_cast<U32>(i))) * (mParams.mHnswM + 1);
+        }
+        fileHeader.mIndexAux = upperLinkCount;
+        sectionSizes[0] = rowCount;
+        sectionSizes[1] = rowCount * (mHnswM0 + 1) * sizeof(U32);
+        sectionSizes[2] = rowCount * sizeof(U32);
+        sectionSizes[3] = upperLinkCount * sizeof(U32);
+    }
+
+    for(I32 i = 0; i < 4; ++i)
+    {
+        fileHeader.mIndexSections[i] = fileCursor;
+        fileCursor = inf_vs_align(fileCursor + sectionSizes[i]);
+    }
+    fileHeader.mFileSize = fileCursor;
+
+    mbase::io_file storeFile;
+    storeFile.open_file(in_path, mbase::io_file::access_mode::WRITE_ACCESS, mbase::io_file::disposition::OVERWRITE);
+    if(!storeFile.is_file_open())
+    {
+        return flags::INF_VS_ERR_UNABLE_TO_OPEN_FILE;
+    }
+
+    U64 writtenBytes = 0;
+    bool isWriteOk = true;
+    const IBYTE zeroPadding[gInfVsSectionAlignment] = {0};
+    auto writeBytes = [&](const GENERIC* in_data, const U64& in_length) {
+        if(!isWriteOk || !in_length)
+        {
+            return;
+        }
+        isWriteOk = storeFile.write_data(static_cast<CBYTEBUFFER>(in_data), in_length) == in_length;
+        writtenBytes += in_length;
+    };
+    auto padTo = [&](const U64& in_offset) {
+        while(writtenBytes < in_offset && isWriteOk)
+        {
+            U64 padLength = std::min<U64>(in_offset - writtenBytes, gInfVsSectionAlignment);
+            writeBytes(zeroPadding, padLength);
+        }
+    };
+
+    writeBytes(&fileHeader, sizeof(fileHeader));
+
+    padTo(fileHeader.mVectorOffset);
+    writeBytes(mMappedVectors, mMappedRowCount * mDimension * sizeof(F32));
+    writeBytes(mTailVectors.data(), tailRowCount * mDimension * sizeof(F32));
+
+    padTo(fileHeader.mTagOffset);
+    writeBytes(mMappedTags, mMappedRowCount * sizeof(U64));
+    writeBytes(mTailTags.data(), tailRowCount * sizeof(U64));
+
+    padTo(fileHeader.mKeyOffsetsOffset);
+    writeBytes(mMappedKeyOffsets, mMappedRowCount * sizeof(U64));
+    U64 keyCursor = mappedKeyBlobSize;
+    writeBytes(&keyCursor, sizeof(U64));
+    for(const mbase::string& tmpKey : mTailKeys)
+    {
+        keyCursor += tmpKey.size();
+        writeBytes(&keyCursor, sizeof(U64));
+    }
+
+    padTo(fileHeader.mKeyBlobOffset);
+    writeBytes(mMappedKeyBlob, mappedKeyBlobSize);
+    for(const mbase::string& tmpKey : mTailKeys)
+    {
+        writeBytes(tmpKey.c_str(), tmpKey.size());
+    }
+
+    if(hasIndex && mIndexType == index_type::IVF)
+    {
+        const F32* ivfCentroids = mIvfMappedCentroids ? mIvfMappedCentroids : mIvfCentroids.data();
+        padTo(fileHeader.mIndexSections[0]);
+        writeBytes(ivfCentroids, sectionSizes[0]);
+
+        padTo(fileHeader.mIndexSections[1]);
+        U64 listCursor = 0;
+        writeBytes(&listCursor, sizeof(U64));
+        for(U32 i = 0; i < mIvfListCount; ++i)
+        {
+            listCursor += _ivf_list_size(i);
+            writeBytes(&listCursor, sizeof(U64));
+        }
+
+        padTo(fileHeader.mIndexSections[2]);
+        for(U32 i = 0; i < mIvfListCount; ++i)
+        {
+            if(mIvfMappedListOffsets)
+            {
+                writeBytes(mIvfMappedListRows + mIvfMappedListOffsets[i], (mIvfMappedListOffsets[i + 1] - mIvfMappedListOffsets[i]) * sizeof(U32));
+            }
+            writeBytes(mIvfLists[i].data(), mIvfLists[i].size() * sizeof(U32));
+        }
+    }
+
+    else if(hasIndex && mIndexType == index_type::HNSW)
+    {
+        // upper offsets are renumbered since mapped and memory rows are merged into one array
+        padTo(fileHeader.mIndexSections[0]);
+        if(mHnswMappedRows)
+        {
+            writeBytes(mHnswMappedLevels, mHnswMappedRows);
+        }
+        writeBytes(mHnswLevels.data(), mHnswLevels.size());
+
+        padTo(fileHeader.mIndexSections[1]);
+        writeBytes(mHnswMappedLinks, mHnswMappedRows * (mHnswM0 + 1) * sizeof(U32));
+        writeBytes(mHnswLinks.data(), mHnswLinks.size() * sizeof(U32));
+
+        padTo(fileHeader.mIndexSections[2]);
+        U32 upperCursor = 0;
+        for(U64 i = 0; i < rowCount; ++i)
+        {
+            U32 nodeLevel = _hnsw_node_level(static_cast<U32>(i));
+            U32 upperOffset = nodeLevel ? upperCursor : gInfVsNoUpperLinks;
+            upperCursor += nodeLevel * (mParams.mHnswM + 1);
+            writeBytes(&upperOffset, sizeof(U32));
+        }
+
+        padTo(fileHeader.mIndexSections[3]);
+        for(U64 i = 0; i < rowCount; ++i)
+        {
+            U32 nodeLevel = _hnsw_node_level(static_cast<U32>(i));
+            if(nodeLevel)
+            {
+                writeBytes(_hnsw_links(static_cast<U32>(i), 1), static_cast<U64>(nodeLevel) * (mParams.mHnswM + 1) * sizeof(U32));
+            }
+        }
+    }
+
+    padTo(fileHeader.mFileSize);
+    storeFile.close_file();
+
+    if(!isWriteOk || writtenBytes != fileHeader.mFileSize)
+    {
+        return flags::INF_VS_ERR_UNABLE_TO_WRITE_FILE;
+    }
+    return flags::INF_VS_SUCCESS;
+}
+
+GENERIC InfVectorStore::_reset() noexcept
+{
+    mMappedStore.close_file();
+    mMappedRowCount = 0;
+    mLogRowCount = 0;
+    mMappedVectors = NULL;
+    mMappedTags = NULL;
+    mMappedKeyOffsets = NULL;
+    mMappedKeyBlob = NULL;
+    mTailVectors.clear();
+    mTailTags.clear();
+    mTailKeys.clear();
+    mKeyIndex.clear();
+    mKeyIndexBuilt = false;
+
+    mIvfCentroids.clear();
+    mIvfMappedCentroids = NULL;
+    mIvfMappedListOffsets = NULL;
+    mIvfMappedListRows = NULL;
+    mIvfLists.clear();
+    mIvfListCount = 0;
+
+    _hnsw_reset();
+    mVisitedEpochs.clear();
+    mVisitEpoch = 0;
+}
+
+GENERIC InfVectorStore::_build_key_index()
+{
+    // the map doesn't rehash, size the buckets for the rows at hand and some growth
+    size_type rowCount = get_row_count();
+    mKeyIndex = mbase::unordered_map<mbase::string, U32>(std::max<size_type>(rowCount * 2, gUmapDefaultBucketCount));
+    for(size_type i = 0; i < rowCount; ++i)
+    {
+        mbase::string rowKey = get_key(static_cast<U32>(i));
+        if(rowKey.size())
+        {
+            mKeyIndex[rowKey] = static_cast<U32>(i);
+        }
+    }
+    mKeyIndexBuilt = true;
+}
+
+GENERIC InfVectorStore::_index_row(const U32& in_row)
+{
+    if(mIndexType == index_type::HNSW)
+    {
+        _hnsw_insert(in_row);
+    }
+    else if(mIndexType == index_type::IVF && mIvfListCount)
+    {
+        mbase::vector<F32> scoreBuffer;
+        inf_vs_append_fill(scoreBuffer, 0.0f, mIvfListCount);
+        mIvfLists[_ivf_nearest_list(get_vector(in_row), scoreBuffer.data())].push_back(in_row);
+    }
+}
+
+bool InfVectorStore::_row_accepted(const U32& in_row, const inf_vector_search_options& in_options) const
+{
+    if((get_tag(in_row) & in_options.mRequiredTags) != in_options.mRequiredTags)
+    {
+        return false;
+    }
+
+    if(in_options.mFilter)
+    {
+        return in_options.mFilter(*this, in_row, in_options.mFilterData);
+    }
+    return true;
+}
+
+GENERIC InfVectorStore::_push_result(candidate_vector& in_heap, const size_type& in_k, const candidate& in_candidate) const
+{
+    // bounded min-heap, the worst of the best k is on top
+    if(in_heap.size() < in_k)
+    {
+        in_heap.push_back(in_candidate);
+        std::push_heap(in_heap.begin(), in_heap.end(), inf_vs_candidate_worst_on_top<candidate>);
+    }
+    else if(in_candidate.mScore > in_heap.front().mScore)
+    {
+        std::pop_heap(in_heap.begin(), in_heap.end(), inf_vs_candidate_worst_on_top<candidate>);
+        in_heap.back() = in_candidate;
+        std::push_heap(in_heap.begin(), in_heap.end(), inf_vs_candidate_worst_on_top<candidate>);
+    }
+}
+
+GENERIC InfVectorStore::_finish_results(candidate_vector& in_heap, search_result_vector& out_results) const
+{
+    std::sort_heap(in_heap.begin(), in_heap.end(), inf_vs_candidate_worst_on_top<candidate>);
+    out_results.reserve(in_heap.size());
+    for(const candidate& tmpCandidate : in_heap)
+    {
+        inf_vector_search_result searchResult;
+        searchResult.mRow = tmpCandidate.mRow;
+        searchResult.mScore = tmpCandidate.mScore;
+        out_results.push_back(searchResult);
+    }
+}
+
+GENERIC InfVectorStore::_search_flat(const F32* in_query, const size_type& in_k, const inf_vector_search_options& in_options, candidate_vector& out_heap) const
+{
+    mbase::vector<F32> scoreBuffer;
+    inf_vs_append_fill(scoreBuffer, 0.0f, gInfVsFlatBlockRows);
+
+    const size_type rowCount = get_row_count();
+    const bool isFiltered = in_options.mRequiredTags || in_options.mFilter;
+    for(size_type blockBegin = 0; blockBegin < rowCount;)
+    {
+        // blocks never cross the mapped/tail boundary since the two are not contiguous
+        size_type blockEnd = blockBegin < mMappedRowCount ? mMappedRowCount : rowCount;
+        blockEnd = std::min(blockEnd, blockBegin + gInfVsFlatBlockRows);
+        const size_type blockRows = blockEnd - blockBegin;
+
+        inf_common_cosine_similarity_batch(
+            const_cast<PTRF32>(in_query),
+            const_cast<PTRF32>(get_vector(static_cast<U32>(blockBegin))),
+            blockRows,
+            mDimension,
+            scoreBuffer.data(),
+            true
+        );
+
+        for(size_type i = 0; i < blockRows; ++i)
+        {
+            const U32 rowIndex = static_cast<U32>(blockBegin + i);
+            if(out_heap.size() == in_k && scoreBuffer[i] <= out_heap.front().mScore)
+            {
+                continue;
+            }
+            if(isFiltered && !_row_accepted(rowIndex, in_options))
+            {
+                continue;
+            }
+            _push_result(out_heap, in_k, {scoreBuffer[i], rowIndex});
+        }
+        blockBegin = blockEnd;
+    }
+}
+
+GENERIC InfVectorStore::_search_ivf(const F32* in_query, const size_type& in_k, const inf_vector_search_options& in_options, candidate_vector& out_heap) const
+{
+    const F32* ivfCentroids = mIvfMappedCentroids ? mIvfMappedCentroids : mIvfCentroids.data();
+    U32 probeCount = in_options.mProbeCount ? in_options.mProbeCount : mParams.mIvfProbeCount;
+    probeCount = std::max(1u, std::min(probeCount, mIvfListCount));
+
+    mbase::vector<F32> centroidScores;
+    inf_vs_append_fill(centroidScores, 0.0f, mIvfListCount);
+    inf_common_cosine_similarity_batch(const_cast<PTRF32>(in_query), const_cast<PTRF32>(ivfCentroids), mIvfListCount, mDimension, centroidScores.data(), true);
+
+    candidate_vector probedLists;
+    probedLists.reserve(probeCount + 1);
+    for(U32 i = 0; i < mIvfListCount; ++i)
+    {
+        _push_result(probedLists, probeCount, {centroidScores[i], i});
+    }
+
+    const bool isFiltered = in_options.mRequiredTags || in_options.mFilter;
+    auto scanRow = [&](const U32& in_row) {
+        if(isFiltered && !_row_accepted(in_row, in_options))
+        {
+            return;
+        }
+        F32 rowScore = _similarity(in_query, get_vector(in_row));
+        _push_result(out_heap, in_k, {rowScore, in_row});
+    };
+
+    for(const candidate& listCandidate : probedLists)
+    {
+        const U32 listIndex = listCandidate.mRow;
+        if(mIvfMappedListOffsets)
+        {
+            for(U64 i = mIvfMappedListOffsets[listIndex]; i < mIvfMappedListOffsets[listIndex + 1]; ++i)
+            {
+                scanRow(mIvfMappedListRows[i]);
+            }
+        }
+        for(const U32& listRow : mIvfLists[listIndex])
+        {
+            scanRow(listRow);
+        }
+    }
+}
+
+GENERIC InfVectorStore::_search_hnsw(const F32* in_query, const size_type& in_k, const inf_vector_search_options& in_options, candidate_vector& out_heap) const
+{
+    if(mHnswMaxLevel < 0)
+    {
+        return;
+    }
+
+    U32 entryPoint = mHnswEntryPoint;
+    for(I32 i = mHnswMaxLevel; i > 0; --i)
+    {
+        entryPoint = _hnsw_greedy(in_query, entryPoint, static_cast<U32>(i));
+    }
+
+    U32 efSearch = in_options.mEfSearch ? in_options.mEfSearch : mParams.mHnswEfSearch;
+    efSearch = std::max(efSearch, static_cast<U32>(in_k));
+
+    const bool isFiltered = in_options.mRequiredTags || in_options.mFilter;
+    candidate_vector entryPoints;
+    entryPoints.push_back({_similarity(in_query, get_vector(entryPoint)), entryPoint});
+    candidate_vector layerResults;
+    _hnsw_search_layer(in_query, entryPoints, efSearch, 0, layerResults, isFiltered ? &in_options : NULL);
+
+    for(const candidate& tmpCandidate : layerResults)
+    {
+        _push_result(out_heap, in_k, tmpCandidate);
+    }
+
+    if(isFiltered && out_heap.size() < in_k && out_heap.size() < get_row_count())
+    {
+        // selective filters can starve the graph walk, the exact scan still returns every accepted row
+        out_heap.clear();
+        _search_flat(in_query, in_k, in_options, out_heap);
+    }
+}
+
+GENERIC InfVectorStore::_ivf_train()
+{
+    const size_type rowCount = get_row_count();
+    mIvfCentroids.clear();
+    mIvfLists.clear();
+    mIvfMappedCentroids = NULL;
+    mIvfMappedListOffsets = NULL;
+    mIvfMappedListRows = NULL;
+    mIvfListCount = 0;
+    if(!rowCount)
+    {
+        return;
+    }
+
+    U32 listCount = mParams.mIvfListCount ? mParams.mIvfListCount : static_cast<U32>(std::sqrt(static_cast<F64>(rowCount)));
+    listCount = static_cast<U32>(std::max<size_type>(1, std::min<size_type>(listCount, rowCount)));
+
+    // k-means runs over an evenly strided sample, 64 points per list is enough for stable centroids
+    const size_type sampleCount = std::min<size_type>(rowCount, static_cast<size_type>(listCount) * 64);
+    const F64 sampleStride = static_cast<F64>(rowCount) / sampleCount;
+    mbase::vector<U32> sampleRows;
+    sampleRows.reserve(sampleCount);
+    for(size_type i = 0; i < sampleCount; ++i)
+    {
+        sampleRows.push_back(static_cast<U32>(i * sampleStride));
+    }
+
+    mIvfCentroids.reserve(static_cast<size_type>(listCount) * mDimension);
+    for(U32 i = 0; i < listCount; ++i)
+    {
+        const size_type sampleIndex = (static_cast<size_type>(i) * sampleCount) / listCount;
+        inf_vs_append_raw(mIvfCentroids, get_vector(sampleRows[sampleIndex]), mDimension);
+    }
+    mIvfListCount = listCount;
+
+    mbase::vector<F32> scoreBuffer;
+    inf_vs_append_fill(scoreBuffer, 0.0f, listCount);
+    mbase::vector<F32> centroidSums;
+    inf_vs_append_fill(centroidSums, 0.0f, static_cast<size_type>(listCount) * mDimension);
+    mbase::vector<U32> centroidCounts;
+    inf_vs_append_fill(centroidCounts, 0u, listCount);
+
+    for(U32 iterationIndex = 0; iterationIndex < mParams.mIvfTrainIterations; ++iterationIndex)
+    {
+        std::fill(centroidSums.begin(), centroidSums.end(), 0.0f);
+        std::fill(centroidCounts.begin(), centroidCounts.end(), 0u);
+        for(const U32& sampleRow : sampleRows)
+        {
+            const F32* sampleVector = get_vector(sampleRow);
+            U32 nearestList = _ivf_nearest_list(sampleVector, scoreBuffer.data());
+            PTRF32 sumVector = centroidSums.data() + static_cast<size_type>(nearestList) * mDimension;
+            for(U32 j = 0; j < mDimension; ++j)
+            {
+                sumVector[j] += sampleVector[j];
+            }
+            ++centroidCounts[nearestList];
+        }
+
+        for(U32 i = 0; i < listCount; ++i)
+        {
+            PTRF32 centroidVector = mIvfCentroids.data() + static_cast<size_type>(i) * mDimension;
+            if(!centroidCounts[i])
+            {
+                // empty list, reseed it from the sample so that no list stays dead
+                const size_type reseedIndex = (static_cast<size_type>(iterationIndex) * 7919 + i) % sampleCount;
+                memcpy(centroidVector, get_vector(sampleRows[reseedIndex]), sizeof(F32) * mDimension);
+                continue;
+            }
+            // spherical k-means, the normalized sum is the direction of the mean
+            inf_common_embd_normalize(centroidSums.data() + static_cast<size_type>(i) * mDimension, centroidVector, mDimension);
+        }
+    }
+
+    mIvfLists.reserve(listCount);
+    for(U32 i = 0; i < listCount; ++i)
+    {
+        mIvfLists.push_back(mbase::vector<U32>());
+    }
+
+    for(size_type i = 0; i < rowCount; ++i)
+    {
+        mIvfLists[_ivf_nearest_list(get_vector(static_cast<U32>(i)), scoreBuffer.data())].push_back(static_cast<U32>(i));
+    }
+}
+
+U32 InfVectorStore::_ivf_nearest_list(const F32* in_vector, PTRF32 in_score_buffer) const
+{
+    const F32* ivfCentroids = mIvfMappedCentroids ? mIvfMappedCentroids : mIvfCentroids.data();
+    inf_common_cosine_similarity_batch(const_cast<PTRF32>(in_vector), const_cast<PTRF32>(ivfCentroids), mIvfListCount, mDimension, in_score_buffer, true);
+    return static_cast<U32>(std::max_element(in_score_buffer, in_score_buffer + mIvfListCount) - in_score_buffer);
+}
+
+typename InfVectorStore::size_type InfVectorStore::_ivf_list_size(const U32& in_list) const
+{
+    size_type listSize = mIvfLists[in_list].size();
+    if(mIvfMappedListOffsets)
+    {
+        listSize += mIvfMappedListOffsets[in_list + 1] - mIvfMappedListOffsets[in_list];
+    }
+    return listSize;
+}
+
+U32 InfVectorStore::_hnsw_node_level(const U32& in_row) const noexcept
+{
+    if(in_row < mHnswMappedRows)
+    {
+        return mHnswMappedLevels[in_row];
+    }
+    return mHnswLevels[in_row - mHnswMappedRows];
+}
+
+U32* InfVectorStore::_hnsw_links(const U32& in_row, const U32& in_level) noexcept
+{
+    return const_cast<U32*>(static_cast<const InfVectorStore*>(this)->_hnsw_links(in_row, in_level));
+}
+
+const U32* InfVectorStore::_hnsw_links(const U32& in_row, const U32& in_level) const noexcept
+{
+    const size_type linkStride = mHnswM0 + 1;
+    const size_type upperStride = mParams.mHnswM + 1;
+    if(in_row < mHnswMappedRows)
+    {
+        if(!in_level)
+        {
+            return mHnswMappedLinks + in_row * linkStride;
+        }
+        return mHnswMappedUpperLinks + mHnswMappedUpperOffsets[in_row] + (in_level - 1) * upperStride;
+    }
+
+    const size_type localRow = in_row - mHnswMappedRows;
+    if(!in_level)
+    {
+        return mHnswLinks.data() + localRow * linkStride;
+    }
+    return mHnswUpperLinks.data() + mHnswUpperOffsets[localRow] + (in_level - 1) * upperStride;
+}
+
+U32 InfVectorStore::_hnsw_max_links(const U32& in_level) const noexcept
+{
+    return in_level ? mParams.mHnswM : mHnswM0;
+}
+
+U32 InfVectorStore::_hnsw_random_level(const U32& in_row) const noexcept
+{
+    // splitmix64 over the row index, levels are reproducible and no generator state is persisted
+    U64 hashValue = static_cast<U64>(in_row) + 0x9E3779B97F4A7C15ull;
+    hashValue = (hashValue ^ (hashValue >> 30)) * 0xBF58476D1CE4E5B9ull;
+    hashValue = (hashValue ^ (hashValue >> 27)) * 0x94D049BB133111EBull;
+    hashValue = hashValue ^ (hashValue >> 31);
+
+    const F64 uniformValue = (static_cast<F64>(hashValue >> 11) + 1.0) * (1.0 / 9007199254740992.0);
+    const F64 nodeLevel = -std::log(uniformValue) * mHnswLevelMultiplier;
+    return static_cast<U32>(std::min<F64>(nodeLevel, gInfVsMaxLevel));
+}
+
+GENERIC InfVectorStore::_hnsw_reset()
+{
+    mParams.mHnswM = std::max(2u, mParams.mHnswM);
+    mHnswM0 = mParams.mHnswM * 2;
+    mHnswLevelMultiplier = 1.0 / std::log(static_cast<F64>(mParams.mHnswM));
+    mHnswMappedRows = 0;
+    mHnswMappedLevels = NULL;
+    mHnswMappedLinks = NULL;
+    mHnswMappedUpperOffsets = NULL;
+    mHnswMappedUpperLinks = NULL;
+    mHnswLevels.clear();
+    mHnswLinks.clear();
+    mHnswUpperOffsets.clear();
+    mHnswUpperLinks.clear();
+    mHnswEntryPoint = 0;
+    mHnswMaxLevel = -1;
+}
+
+GENERIC InfVectorStore::_hnsw_insert(const U32& in_row)
+{
+    // storage of the row is allocated up front, link pointers are not stable across vector growth
+    const U32 nodeLevel = _hnsw_random_level(in_row);
+    mHnswLevels.push_back(static_cast<U8>(nodeLevel));
+    inf_vs_append_fill(mHnswLinks, 0u, mHnswM0 + 1);
+    if(nodeLevel)
+    {
+        mHnswUpperOffsets.push_back(static_cast<U32>(mHnswUpperLinks.size()));
+        inf_vs_append_fill(mHnswUpperLinks, 0u, static_cast<size_type>(nodeLevel) * (mParams.mHnswM + 1));
+    }
+    else
+    {
+        mHnswUpperOffsets.push_back(gInfVsNoUpperLinks);
+    }
+
+    if(mHnswMaxLevel < 0)
+    {
+        mHnswEntryPoint = in_row;
+        mHnswMaxLevel = static_cast<I32>(nodeLevel);
+        return;
+    }
+
+    const F32* rowVector = get_vector(in_row);
+    U32 entryPoint = mHnswEntryPoint;
+    for(I32 i = mHnswMaxLevel; i > static_cast<I32>(nodeLevel); --i)
+    {
+        entryPoint = _hnsw_greedy(rowVector, entryPoint, static_cast<U32>(i));
+    }
+
+    candidate_vector entryPoints;
+    entryPoints.push_back({_similarity(rowVector, get_vector(entryPoint)), entryPoint});
+    candidate_vector layerResults;
+    for(I32 i = std::min(static_cast<I32>(nodeLevel), mHnswMaxLevel); i >= 0; --i)
+    {
+        _hnsw_search_layer(rowVector, entryPoints, mParams.mHnswEfConstruction, static_cast<U32>(i), layerResults, NULL);
+        entryPoints = layerResults;
+        _hnsw_select_neighbors(layerResults, mParams.mHnswM);
+        _hnsw_connect(in_row, static_cast<U32>(i), layerResults);
+    }
+
+    if(static_cast<I32>(nodeLevel) > mHnswMaxLevel)
+    {
+        mHnswEntryPoint = in_row;
+        mHnswMaxLevel = static_cast<I32>(nodeLevel);
+    }
+}
+
+U32 InfVectorStore::_hnsw_greedy(const F32* in_query, U32 in_entry, const U32& in_level) const
+{
+    F32 currentScore = _similarity(in_query, get_vector(in_entry));
+    bool isChanged = true;
+    while(isChanged)
+    {
+        isChanged = false;
+        const U32* nodeLinks = _hnsw_links(in_entry, in_level);
+        for(U32 i = 1; i <= nodeLinks[0]; ++i)
+        {
+            F32 neighborScore = _similarity(in_query, get_vector(nodeLinks[i]));
+            if(neighborScore > currentScore)
+            {
+                currentScore = neighborScore;
+                in_entry = nodeLinks[i];
+                isChanged = true;
+            }
+        }
+    }
+    return in_entry;
+}
+
+GENERIC InfVectorStore::_hnsw_search_layer(const F32* in_query, const candidate_vector& in_entries, const U32& in_ef, const U32& in_level, candidate_vector& out_results, const inf_vector_search_options* in_options) const
+{
+    const U32 visitEpoch = _next_visit_epoch();
+    candidate_vector expansionQueue;
+    mbase::vector<U32> pendingRowList;
+    inf_vs_append_fill(pendingRowList, 0u, mHnswM0);
+    PTRU32 pendingRows = pendingRowList.data();
+    out_results.clear();
+
+    // filtered out rows are still walked through, they are only kept out of the results
+    for(const candidate& entryCandidate : in_entries)
+    {
+        if(mVisitedEpochs[entryCandidate.mRow] == visitEpoch)
+        {
+            continue;
+        }
+        mVisitedEpochs[entryCandidate.mRow] = visitEpoch;
+        expansionQueue.push_back(entryCandidate);
+        std::push_heap(expansionQueue.begin(), expansionQueue.end(), inf_vs_candidate_best_on_top<candidate>);
+        if(!in_options || _row_accepted(entryCandidate.mRow, *in_options))
+        {
+            _push_result(out_results, in_ef, entryCandidate);
+        }
+    }
+
+    while(expansionQueue.size())
+    {
+        const candidate currentCandidate = expansionQueue.front();
+        if(out_results.size() >= in_ef && currentCandidate.mScore < out_results.front().mScore)
+        {
+            break;
+        }
+        std::pop_heap(expansionQueue.begin(), expansionQueue.end(), inf_vs_candidate_best_on_top<candidate>);
+        expansionQueue.pop_back();
+
+        // graph walks are bound by cache misses on the neighbor vectors, unvisited neighbors
+        // are collected first so that all of their vectors are in flight before the first dot product
+        const U32* nodeLinks = _hnsw_links(currentCandidate.mRow, in_level);
+        U32 pendingCount = 0;
+        for(U32 i = 1; i <= nodeLinks[0]; ++i)
+        {
+            const U32 neighborRow = nodeLinks[i];
+            if(mVisitedEpochs[neighborRow] == visitEpoch)
+            {
+                continue;
+            }
+            mVisitedEpochs[neighborRow] = visitEpoch;
+            pendingRows[pendingCount++] = neighborRow;
+            INF_VS_PREFETCH(get_vector(neighborRow));
+        }
+
+        for(U32 i = 0; i < pendingCount; ++i)
+        {
+            const U32 neighborRow = pendingRows[i];
+            const F32 neighborScore = _similarity(in_query, get_vector(neighborRow));
+            if(out_results.size() < in_ef || neighborScore > out_results.front().mScore)
+            {
+                expansionQueue.push_back({neighborScore, neighborRow});
+                std::push_heap(expansionQueue.begin(), expansionQueue.end(), inf_vs_candidate_best_on_top<candidate>);
+                if(!in_options || _row_accepted(neighborRow, *in_options))
+                {
+                    _push_result(out_results, in_ef, {neighborScore, neighborRow});
+                }
+            }
+        }
+    }
+}
+
+GENERIC InfVectorStore::_hnsw_select_neighbors(candidate_vector& in_candidates, const U32& in_max_count) const
+{
+    // heuristic from the HNSW paper, a candidate is kept only if it is closer to the base
+    // than to any neighbor selected so far, which keeps links spread across clusters
+    std::sort(in_candidates.begin(), in_candidates.end(), inf_vs_candidate_worst_on_top<candidate>);
+    if(in_candidates.size() <= in_max_count)
+    {
+        return;
+    }
+
+    candidate_vector selectedNeighbors;
+    selectedNeighbors.reserve(in_max_count);
+    for(const candidate& tmpCandidate : in_candidates)
+    {
+        if(selectedNeighbors.size() >= in_max_count)
+        {
+            break;
+        }
+        const F32* candidateVector = get_vector(tmpCandidate.mRow);
+        bool isDiverse = true;
+        for(const candidate& selectedCandidate : selectedNeighbors)
+        {
+            if(_similarity(candidateVector, get_vector(selectedCandidate.mRow)) > tmpCandidate.mScore)
+            {
+                isDiverse = false;
+                break;
+            }
+        }
+        if(isDiverse)
+        {
+            selectedNeighbors.push_back(tmpCandidate);
+        }
+    }
+    in_candidates = selectedNeighbors;
+}
+
+GENERIC InfVectorStore::_hnsw_connect(const U32& in_row, const U32& in_level, candidate_vector& in_neighbors)
+{
+    const U32 maxLinks = _hnsw_max_links(in_level);
+    U32* rowLinks = _hnsw_links(in_row, in_level);
+    rowLinks[0] = 0;
+    for(const candidate& tmpNeighbor : in_neighbors)
+    {
+        if(rowLinks[0] >= maxLinks)
+        {
+            break;
+        }
+        rowLinks[++rowLinks[0]] = tmpNeighbor.mRow;
+    }
+
+    candidate_vector prunedLinks;
+    for(const candidate& tmpNeighbor : in_neighbors)
+    {
+        U32* neighborLinks = _hnsw_links(tmpNeighbor.mRow, in_level);
+        if(neighborLinks[0] < maxLinks)
+        {
+            neighborLinks[++neighborLinks[0]] = in_row;
+            continue;
+        }
+
+        // neighbor is full, re-select its links among the old ones and the new row
+        const F32* neighborVector = get_vector(tmpNeighbor.mRow);
+        prunedLinks.clear();
+        prunedLinks.push_back({tmpNeighbor.mScore, in_row});
+        for(U32 i = 1; i <= neighborLinks[0]; ++i)
+        {
+            prunedLinks.push_back({_similarity(neighborVector, get_vector(neighborLinks[i])), neighborLinks[i]});
+        }
+        _hnsw_select_neighbors(prunedLinks, maxLinks);
+
+        neighborLinks[0] = 0;
+        for(const candidate& prunedCandidate : prunedLinks)
+        {
+            neighborLinks[++neighborLinks[0]] = prunedCandidate.mRow;
+        }
+    }
+}
+
+F32 InfVectorStore::_similarity(const F32* in_lhs, const F32* in_rhs) const noexcept
+{
+    // every stored vector and every query is normalized, the dot product is the cosine similarity
+    return inf_common_dot_product(const_cast<PTRF32>(in_lhs), const_cast<PTRF32>(in_rhs), mDimension);
+}
+
+U32 InfVectorStore::_next_visit_epoch() const
+{
+    const size_type rowCount = get_row_count();
+    if(mVisitedEpochs.size() < rowCount)
+    {
+        inf_vs_append_fill(mVisitedEpochs, 0u, rowCount - mVisitedEpochs.size());
+    }
+
+    if(++mVisitEpoch == 0)
+    {
+        std::fill(mVisitedEpochs.begin(), mVisitedEpochs.end(), 0u);
+        mVisitEpoch = 1;
+    }
+    return mVisitEpoch;
+}
+
+MBASE_END
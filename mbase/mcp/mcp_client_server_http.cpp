@@ -8,6 +8,7 @@ McpClientServerHttp::McpClientServerHttp(const McpServerHttpInit& in_init): McpS
     set_hostname(in_init.mHostname);
     set_api_key(in_init.mApiKey);
     set_mcp_endpoint(in_init.mMcpEndpoint);
+    set_unix_socket_path(in_init.mUnixSocketPath);
     add_header("Accept", "text/event-stream,application/json");
 }
 
@@ -21,6 +22,11 @@ const mbase::string& McpClientServerHttp::get_mcp_endpoint() const noexcept
     return mMcpEndpoint;
 }
 
+const mbase::string& McpClientServerHttp::get_unix_socket_path() const noexcept
+{
+    return mUnixSocketPath;
+}
+
 mbase::string McpClientServerHttp::get_header_value(const mbase::string& in_header) const noexcept
 {
     auto mapIt = mHeadersMap.find(in_header);
@@ -47,6 +53,11 @@ GENERIC McpClientServerHttp::set_hostname(const mbase::string& in_hostname)
     mHostname = in_hostname;
 }
 
+GENERIC McpClientServerHttp::set_unix_socket_path(const mbase::string& in_path)
+{
+    mUnixSocketPath = in_path;
+}
+
 GENERIC McpClientServerHttp::set_api_key(const mbase::string& in_api_key)
 {
     if(!in_api_key.size())
@@ -93,7 +104,20 @@ GENERIC McpClientServerHttp::update_t()
         mPayloadList = mbase::vector<mbase::string>();
         mPayloadListSync.release();
         std::string _mHostname = std::string(mHostname.c_str(), mHostname.size());
+        #ifdef MBASE_PLATFORM_UNIX
+        if(mUnixSocketPath.size())
+        {
+            // httplib connects to the host as a socket path, '@' is mapped to the abstract namespace
+            _mHostname = std::string(mUnixSocketPath.c_str(), mUnixSocketPath.size());
+        }
+        #endif
         httplib::Client clientInstance(_mHostname);
+        #ifdef MBASE_PLATFORM_UNIX
+        if(mUnixSocketPath.size())
+        {
+            clientInstance.set_address_family(AF_UNIX);
+        }
+        #endif
         if(mApiKey.size())
         {
             std::string _mApiKey = std::string(mApiKey.c_str(), mApiKey.size());
@@ -1,8 +1,88 @@
 #include <mbase/mcp/mcp_server_http_streamable.h>
 #include <cpp-httplib/httplib.h>
+#include <chrono>
+#include <cmath>
+#ifdef MBASE_PLATFORM_UNIX
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <errno.h>
+#include <cstdio>
+#include <cstring>
+#endif
 
 MBASE_BEGIN
 
+static const SIZE_T gMcpHttpBucketPruneThreshold = 1024;
+static thread_local bool gMcpHttpRequestAdmitted = false; // the worker's current request holds an in-flight slot
+static thread_local I32 gMcpHttpRejectStatus = 0; // decided before the body is read, answered by the /mcp handler once it is drained
+static thread_local I32 gMcpHttpRetryAfter = 0;
+
+static I64 mcp_http_now_ms()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+#ifdef MBASE_PLATFORM_UNIX
+static bool mcp_unix_socket_is_stale(const std::string& in_path)
+{
+    // the file stays behind when a server dies, it is only stale if nobody accepts on it
+    struct sockaddr_un localAddr = {};
+    if(in_path.size() >= sizeof(localAddr.sun_path))
+    {
+        return false;
+    }
+    localAddr.sun_family = AF_UNIX;
+    memcpy(localAddr.sun_path, in_path.c_str(), in_path.size());
+
+    int probeSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(probeSocket == -1)
+    {
+        return false;
+    }
+
+    const bool isStale = connect(probeSocket, reinterpret_cast<struct sockaddr*>(&localAddr), sizeof(localAddr)) == -1 && errno == ECONNREFUSED;
+    close(probeSocket);
+    return isStale;
+}
+
+#ifndef MBASE_PLATFORM_APPLE
+static I32 mcp_unix_peer_uid(I32 in_peerPid)
+{
+    // httplib keeps the pid it reads with SO_PEERCRED as the remote port of a unix socket peer,
+    // the effective uid of that process is the one it connected with unless it changed it since
+    if(in_peerPid <= 0)
+    {
+        return -1;
+    }
+
+    char statusPath[64];
+    snprintf(statusPath, sizeof(statusPath), "/proc/%d/status", in_peerPid);
+    FILE* statusFile = fopen(statusPath, "r");
+    if(!statusFile)
+    {
+        return -1;
+    }
+
+    I32 peerUid = -1;
+    char statusLine[256];
+    while(fgets(statusLine, sizeof(statusLine), statusFile))
+    {
+        unsigned int realUid = 0;
+        unsigned int effectiveUid = 0;
+        if(sscanf(statusLine, "Uid:\t%u\t%u", &realUid, &effectiveUid) == 2)
+        {
+            peerUid = static_cast<I32>(effectiveUid);
+            break;
+        }
+    }
+    fclose(statusFile);
+    return peerUid;
+}
+#endif
+#endif
+
 McpServerHttpBase::McpServerHttpBase(
     const mbase::string& in_server_name, 
     const mbase::string& in_version_string, 
@@ -46,6 +126,268 @@ const I32& McpServerHttpBase::get_port() const noexcept
     return mPort;
 }
 
+const mbase::string& McpServerHttpBase::get_unix_socket_path() const noexcept
+{
+    return mUnixSocketPath;
+}
+
+GENERIC McpServerHttpBase::set_unix_socket_path(const mbase::string& in_path)
+{
+    mUnixSocketPath = in_path;
+}
+
+const McpServerHttpLimits& McpServerHttpBase::get_limits() const noexcept
+{
+    return mLimits;
+}
+
+I32 McpServerHttpBase::get_in_flight_request_count() const noexcept
+{
+    return mInFlightRequests.load();
+}
+
+U64 McpServerHttpBase::get_rejected_request_count() const noexcept
+{
+    return mRejectedRequests.load();
+}
+
+GENERIC McpServerHttpBase::set_limits(const McpServerHttpLimits& in_limits)
+{
+    mLimits = in_limits;
+}
+
+bool McpServerHttpBase::_is_known_session([[maybe_unused]] const mbase::string& in_session_id)
+{
+    return false;
+}
+
+I32 McpServerHttpBase::_take_token(const mbase::string& in_key)
+{
+    if(mLimits.mRequestsPerSecond <= 0.0)
+    {
+        return 0;
+    }
+
+    const F64 bucketCapacity = mLimits.mBurst < 1.0 ? 1.0 : mLimits.mBurst;
+    const I64 currentTime = mcp_http_now_ms();
+
+    mbase::lock_guard bucketSync(mBucketSync);
+    if(mTokenBuckets.size() >= gMcpHttpBucketPruneThreshold && currentTime - mLastBucketPruneMs >= 1000)
+    {
+        // a bucket that would be full by now is no different than a new one
+        const I64 refillTime = static_cast<I64>(bucketCapacity / mLimits.mRequestsPerSecond * 1000.0);
+        mbase::vector<mbase::string> idleKeys;
+        for(auto& currentBucket : mTokenBuckets)
+        {
+            if(currentTime - currentBucket.second.mLastRefillMs >= refillTime)
+            {
+                idleKeys.push_back(currentBucket.first);
+            }
+        }
+
+        for(auto& currentKey : idleKeys)
+        {
+            mTokenBuckets.erase(currentKey);
+        }
+        mLastBucketPruneMs = currentTime;
+    }
+
+    mbase::unordered_map<mbase::string, token_bucket>::iterator It = mTokenBuckets.find(in_key);
+    if(It == mTokenBuckets.end())
+    {
+        token_bucket newBucket;
+        newBucket.mTokens = bucketCapacity - 1.0;
+        newBucket.mLastRefillMs = currentTime;
+        mTokenBuckets[in_key] = newBucket;
+        return 0;
+    }
+
+    token_bucket& activeBucket = It->second;
+    activeBucket.mTokens += static_cast<F64>(currentTime - activeBucket.mLastRefillMs) / 1000.0 * mLimits.mRequestsPerSecond;
+    if(activeBucket.mTokens > bucketCapacity)
+    {
+        activeBucket.mTokens = bucketCapacity;
+    }
+    activeBucket.mLastRefillMs = currentTime;
+
+    if(activeBucket.mTokens >= 1.0)
+    {
+        activeBucket.mTokens -= 1.0;
+        return 0;
+    }
+
+    I32 retryAfter = static_cast<I32>(std::ceil((1.0 - activeBucket.mTokens) / mLimits.mRequestsPerSecond));
+    return retryAfter < 1 ? 1 : retryAfter;
+}
+
+GENERIC McpServerHttpBase::_listen()
+{
+    const McpServerHttpLimits activeLimits = mLimits;
+    if(activeLimits.mWorkerCount > 0)
+    {
+        svr->new_task_queue = [activeLimits] {
+            const size_t maxQueued = activeLimits.mMaxQueuedConnections > 0 ? static_cast<size_t>(activeLimits.mMaxQueuedConnections) : 0;
+            return new httplib::ThreadPool(static_cast<size_t>(activeLimits.mWorkerCount), maxQueued);
+        };
+    }
+
+    if(activeLimits.mMaxBodySize)
+    {
+        svr->set_payload_max_length(static_cast<size_t>(activeLimits.mMaxBodySize));
+    }
+
+    const bool isUnixSocket = mUnixSocketPath.size() > 0;
+    svr->set_pre_routing_handler([this, activeLimits, isUnixSocket](const httplib::Request& in_request, httplib::Response& out_response) {
+        // runs before the body is read, the admission is decided here without parsing anything
+        gMcpHttpRequestAdmitted = false;
+        gMcpHttpRejectStatus = 0;
+        gMcpHttpRetryAfter = 0;
+        #if defined(MBASE_PLATFORM_UNIX) && !defined(MBASE_PLATFORM_APPLE)
+        if(isUnixSocket)
+        {
+            // an abstract socket has no file permissions, only the server's own user and root are served
+            const I32 peerUid = mcp_unix_peer_uid(in_request.remote_port);
+            if(peerUid == -1 || (peerUid != 0 && peerUid != static_cast<I32>(geteuid())))
+            {
+                ++mRejectedRequests;
+                out_response.status = 403;
+                out_response.set_header("Connection", "close");
+                out_response.set_content_provider("text/plain", [](size_t, httplib::DataSink&) { return false; });
+                return httplib::Server::HandlerResponse::Handled;
+            }
+        }
+        #else
+        (void)isUnixSocket;
+        #endif
+        if(in_request.method != "POST" || in_request.path != "/mcp")
+        {
+            return httplib::Server::HandlerResponse::Unhandled;
+        }
+
+        if(!in_request.has_header("Content-Length"))
+        {
+            ++mRejectedRequests;
+            out_response.status = 411;
+            if(in_request.has_header("Transfer-Encoding"))
+            {
+                // a chunked body has no bound to drain it within, answer and close the connection.
+                // without a length the client reads the response until the close, the provider failing is what closes it
+                out_response.set_header("Connection", "close");
+                out_response.set_content_provider("text/plain", [](size_t, httplib::DataSink&) { return false; });
+            }
+            // otherwise there is no body, the connection stays usable
+            return httplib::Server::HandlerResponse::Handled;
+        }
+
+        if(activeLimits.mMaxBodySize && in_request.get_header_value_u64("Content-Length") > activeLimits.mMaxBodySize)
+        {
+            // the payload limit answers 413 and skips the body
+            ++mRejectedRequests;
+            return httplib::Server::HandlerResponse::Unhandled;
+        }
+
+        I32 rejectStatus = 0;
+        I32 retryAfter = 0;
+        {
+            mbase::string bucketKey;
+            if(in_request.has_header("Mcp-Session-Id"))
+            {
+                const std::string& _sessId = in_request.get_header_value("Mcp-Session-Id");
+                mbase::string sessionId(_sessId.c_str(), _sessId.size());
+                if(this->_is_known_session(sessionId))
+                {
+                    bucketKey = "session:" + sessionId;
+                }
+            }
+
+            if(!bucketKey.size())
+            {
+                bucketKey = "address:" + mbase::string(in_request.remote_addr.c_str(), in_request.remote_addr.size());
+            }
+
+            retryAfter = this->_take_token(bucketKey);
+            if(retryAfter)
+            {
+                rejectStatus = 429;
+            }
+            else if(++mInFlightRequests > activeLimits.mMaxInFlightRequests && activeLimits.mMaxInFlightRequests > 0)
+            {
+                --mInFlightRequests;
+                rejectStatus = 503;
+                retryAfter = 1;
+            }
+            else
+            {
+                gMcpHttpRequestAdmitted = true;
+            }
+        }
+
+        if(rejectStatus)
+        {
+            // the body is within the cap, it is read and dropped before the rejection is answered
+            // so that the next request on the connection starts where this one ends
+            ++mRejectedRequests;
+            gMcpHttpRejectStatus = rejectStatus;
+            gMcpHttpRetryAfter = retryAfter;
+        }
+        return httplib::Server::HandlerResponse::Unhandled;
+    });
+
+    svr->set_post_routing_handler([this]([[maybe_unused]] const httplib::Request& in_request, [[maybe_unused]] httplib::Response& out_response) {
+        // called on the same worker once the response of the request is about to be written
+        if(gMcpHttpRequestAdmitted)
+        {
+            gMcpHttpRequestAdmitted = false;
+            --mInFlightRequests;
+        }
+    });
+
+    #ifdef MBASE_PLATFORM_UNIX
+    if(mUnixSocketPath.size())
+    {
+        std::string socketPath(mUnixSocketPath.c_str(), mUnixSocketPath.size());
+        const bool isAbstract = socketPath[0] == '@';
+        struct stat pathStat;
+        if(!isAbstract && !lstat(socketPath.c_str(), &pathStat) && S_ISSOCK(pathStat.st_mode))
+        {
+            if(!mcp_unix_socket_is_stale(socketPath))
+            {
+                // another server accepts on it or it can't be told, it is left alone
+                return;
+            }
+            // a socket file left by a previous run, bind fails on it otherwise
+            unlink(socketPath.c_str());
+        }
+
+        svr->set_address_family(AF_UNIX);
+        // bind_to_port listens right away, the file is created with 0600 so that no one connects before it is restricted
+        const mode_t previousMask = umask(0177);
+        const bool isBound = svr->bind_to_port(socketPath, 80);
+        umask(previousMask);
+        if(!isBound)
+        {
+            return;
+        }
+        svr->listen_after_bind();
+        return;
+    }
+    #endif
+    svr->listen(this->get_hostname().c_str(), this->get_port());
+}
+
+bool mcp_streamable_http_admitted(httplib::Response& out_response)
+{
+    if(!gMcpHttpRejectStatus)
+    {
+        return true;
+    }
+
+    out_response.status = gMcpHttpRejectStatus;
+    out_response.set_header("Retry-After", std::to_string(gMcpHttpRetryAfter));
+    gMcpHttpRejectStatus = 0;
+    return false;
+}
+
 bool mcp_streamable_http_validate(const httplib::Request& in_request, httplib::Response& out_response)
 {
     if(!in_request.body.size())
@@ -113,6 +455,12 @@ bool McpServerHttpStreamableStateful::is_server_running() const noexcept
     return this->is_processor_running();
 }
 
+bool McpServerHttpStreamableStateful::_is_known_session(const mbase::string& in_session_id)
+{
+    mbase::lock_guard clientsSync(mStreamableClientsSync);
+    return mStreambleClients.find(in_session_id) != mStreambleClients.end();
+}
+
 GENERIC McpServerHttpStreamableStateful::update_t()
 {
     svr->Get("/mcp", [&]([[maybe_unused]] const httplib::Request& in_request, httplib::Response& out_response){
@@ -122,7 +470,8 @@ GENERIC McpServerHttpStreamableStateful::update_t()
 
     svr->Post("/mcp", [&](const httplib::Request& in_request, httplib::Response& out_response){
         // for post request types
-        
+        if(!mcp_streamable_http_admitted(out_response)){ return; }
+
         if(this->get_api_key().size())
         {
             if(!in_request.has_header("Authorization"))
@@ -162,13 +511,16 @@ GENERIC McpServerHttpStreamableStateful::update_t()
         {
             const std::string& _sessId = in_request.get_header_value("Mcp-Session-Id");
             mcpSessionId = mbase::string(_sessId.c_str(), _sessId.size());
-            mbase::unordered_map<mbase::string, mbase::McpServerClientHttpStreamable*>::iterator It = mStreambleClients.find(mcpSessionId);
-            if(It == mStreambleClients.end())
             {
-                out_response.status = 404;
-                return;
+                mbase::lock_guard clientsSync(mStreamableClientsSync);
+                mbase::unordered_map<mbase::string, mbase::McpServerClientHttpStreamable*>::iterator It = mStreambleClients.find(mcpSessionId);
+                if(It == mStreambleClients.end())
+                {
+                    out_response.status = 404;
+                    return;
+                }
+                currentStreamableClient = It->second;
             }
-            currentStreamableClient = It->second;
             currentStreamableClient->acquire_synchronizer();
             while(!currentStreamableClient->is_request_processed()){ mbase::sleep(2); }
             currentStreamableClient->set_response_object(&out_response);
@@ -178,7 +530,10 @@ GENERIC McpServerHttpStreamableStateful::update_t()
         {
             mcpSessionId = mbase::string::generate_uuid();
             currentStreamableClient = new mbase::McpServerClientHttpStreamable(this, mcpSessionId);
-            mStreambleClients[mcpSessionId] = currentStreamableClient;
+            {
+                mbase::lock_guard clientsSync(mStreamableClientsSync);
+                mStreambleClients[mcpSessionId] = currentStreamableClient;
+            }
             out_response.set_header("Mcp-Session-Id", std::string(mcpSessionId.c_str(), mcpSessionId.size()));
             currentStreamableClient->set_response_object(&out_response);
         }
@@ -187,7 +542,7 @@ GENERIC McpServerHttpStreamableStateful::update_t()
         while(!currentStreamableClient->is_request_processed()){ mbase::sleep(2); }
         out_response.status = 200;
     }); 
-    svr->listen(this->get_hostname().c_str(), this->get_port());
+    _listen();
     mIsProcessorRunning = false;
 }
 
@@ -227,7 +582,8 @@ GENERIC McpServerHttpStreamableStateless::update_t()
 
     svr->Post("/mcp", [&](const httplib::Request& in_request, httplib::Response& out_response){
         // for post request types
-        
+        if(!mcp_streamable_http_admitted(out_response)){ return; }
+
         if(this->get_api_key().size())
         {
             if(!in_request.has_header("Authorization"))
@@ -267,7 +623,7 @@ GENERIC McpServerHttpStreamableStateless::update_t()
         while(!currentStreamableClient.is_request_processed()){mbase::sleep(2);}
         out_response.status = 200;
     });
-    svr->listen(this->get_hostname().c_str(), this->get_port());
+    _listen();
     mIsProcessorRunning = false;
 }
 
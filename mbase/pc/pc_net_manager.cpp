@@ -1,13 +1,31 @@
 #include <mbase/pc/pc_net_manager.h>
 #include <mbase/pc/pc_program.h>
+#include <mbase/pc/pc_diagnostics.h>
 #include <sys/types.h>
 
 #ifdef MBASE_PLATFORM_UNIX
 #include <sys/socket.h>
 #include <sys/ioctl.h>
+#include <sys/un.h>
+#include <sys/stat.h>
 #include <unistd.h>
+#include <fcntl.h>
 #include <netdb.h>
+#include <errno.h>
+#include <poll.h>
+#include <netinet/in.h>
+#include <sys/uio.h>
+#include <pthread.h>
+#include <sched.h>
+#if defined(__linux__)
+#include <linux/errqueue.h>
+#if defined(SO_ZEROCOPY) && defined(MSG_ZEROCOPY) && defined(SO_EE_ORIGIN_ZEROCOPY)
+#define MBASE_NET_ZERO_COPY
 #endif
+#endif
+#endif
+#include <chrono>
+#include <thread>
 
 MBASE_BEGIN
 
@@ -28,56 +46,219 @@ MBASE_BEGIN
 #define MBASE_SOCKET_ERROR -1
 #endif
 
+static U64 pc_net_now_ms()
+{
+	return static_cast<U64>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
 
-PcNetPacket::PcNetPacket(U16 in_min_packet_size) noexcept : mPacketContent(in_min_packet_size)
+static GENERIC pc_net_close_socket(PcNetClient::socket_handle in_socket) noexcept
 {
+	#ifdef MBASE_PLATFORM_WINDOWS
+	closesocket(in_socket);
+	#endif
+	#ifdef MBASE_PLATFORM_UNIX
+	close(in_socket);
+	#endif
 }
 
-PcNetPacket::PcNetPacket(const PcNetPacket& in_rhs) noexcept
+class PcNetIoWakeup : public non_copymovable {
+public:
+	PcNetIoWakeup() noexcept : mIsPending(false)
+	{
+		#ifdef MBASE_PLATFORM_UNIX
+		mPipe[0] = -1;
+		mPipe[1] = -1;
+		if(pipe(mPipe) == 0)
+		{
+			for(I32 pipeEnd : mPipe)
+			{
+				fcntl(pipeEnd, F_SETFL, fcntl(pipeEnd, F_GETFL) | O_NONBLOCK);
+				fcntl(pipeEnd, F_SETFD, FD_CLOEXEC);
+			}
+		}
+		#endif
+	}
+
+	~PcNetIoWakeup()
+	{
+		#ifdef MBASE_PLATFORM_UNIX
+		for(I32 pipeEnd : mPipe)
+		{
+			if(pipeEnd != -1)
+			{
+				close(pipeEnd);
+			}
+		}
+		#endif
+	}
+
+	#ifdef MBASE_PLATFORM_UNIX
+	I32 get_descriptor() const noexcept
+	{
+		return mPipe[0];
+	}
+	#endif
+
+	GENERIC wake() noexcept
+	{
+		if(mIsPending.exchange(true, std::memory_order_acq_rel))
+		{
+			// a wake is already on its way
+			return;
+		}
+
+		#ifdef MBASE_PLATFORM_UNIX
+		if(mPipe[1] != -1)
+		{
+			U8 wakeByte = 1;
+			[[maybe_unused]] ssize_t writeResult = write(mPipe[1], &wakeByte, 1);
+		}
+		#endif
+		// windows has no pipe to poll, the I/O thread waits at most a millisecond there
+	}
+
+	GENERIC drain() noexcept
+	{
+		// cleared first, a wake after this point leaves a byte for the next poll
+		mIsPending.store(false, std::memory_order_release);
+		#ifdef MBASE_PLATFORM_UNIX
+		if(mPipe[0] != -1)
+		{
+			U8 drainBuffer[64];
+			while(read(mPipe[0], drainBuffer, sizeof(drainBuffer)) > 0)
+			{
+			}
+		}
+		#endif
+	}
+
+private:
+	#ifdef MBASE_PLATFORM_UNIX
+	I32 mPipe[2];
+	#endif
+	std::atomic<bool> mIsPending;
+};
+
+PcNetPacket::PcNetPacket() noexcept :
+	mReadBuffer(NULL),
+	mReadCapacity(0),
+	mReadLength(0),
+	mWriteQueue(),
+	mWriteQueueFront(0),
+	mPendingWriteBytes(0),
+	mZeroCopyPending(),
+	mZeroCopySequence(0),
+	mZeroCopyState(0)
 {
-	mPacketContent = in_rhs.mPacketContent;
-	mWriteBuffer = in_rhs.mWriteBuffer;
 }
 
-PcNetPacket::PcNetPacket(PcNetPacket&& in_rhs) noexcept
+PcNetPacket::PcNetPacket(PcNetPacket&& in_rhs) noexcept :
+	mReadBuffer(in_rhs.mReadBuffer),
+	mReadCapacity(in_rhs.mReadCapacity),
+	mReadLength(in_rhs.mReadLength),
+	mWriteQueue(std::move(in_rhs.mWriteQueue)),
+	mWriteQueueFront(in_rhs.mWriteQueueFront),
+	mPendingWriteBytes(in_rhs.mPendingWriteBytes),
+	mZeroCopyPending(std::move(in_rhs.mZeroCopyPending)),
+	mZeroCopySequence(in_rhs.mZeroCopySequence),
+	mZeroCopyState(in_rhs.mZeroCopyState)
 {
-	mPacketContent = std::move(in_rhs.mPacketContent);
-	mWriteBuffer = std::move(in_rhs.mWriteBuffer);
+	in_rhs.mReadBuffer = NULL;
+	in_rhs.mReadCapacity = 0;
+	in_rhs.mReadLength = 0;
+	in_rhs.clear();
 }
 
-PcNetPacket& PcNetPacket::operator=(const PcNetPacket& in_rhs) noexcept
+PcNetPacket::~PcNetPacket()
 {
-	mPacketContent = in_rhs.mPacketContent;
-	mWriteBuffer = in_rhs.mWriteBuffer;
-	return *this;
+	release_read_buffer();
 }
 
 PcNetPacket& PcNetPacket::operator=(PcNetPacket&& in_rhs) noexcept
 {
-	mPacketContent = std::move(in_rhs.mPacketContent);
-	mWriteBuffer = std::move(in_rhs.mWriteBuffer);
+	release_read_buffer();
+	mReadBuffer = in_rhs.mReadBuffer;
+	mReadCapacity = in_rhs.mReadCapacity;
+	mReadLength = in_rhs.mReadLength;
+	mWriteQueue = std::move(in_rhs.mWriteQueue);
+	mWriteQueueFront = in_rhs.mWriteQueueFront;
+	mPendingWriteBytes = in_rhs.mPendingWriteBytes;
+	mZeroCopyPending = std::move(in_rhs.mZeroCopyPending);
+	mZeroCopySequence = in_rhs.mZeroCopySequence;
+	mZeroCopyState = in_rhs.mZeroCopyState;
+
+	in_rhs.mReadBuffer = NULL;
+	in_rhs.mReadCapacity = 0;
+	in_rhs.mReadLength = 0;
+	in_rhs.clear();
 	return *this;
 }
 
+GENERIC PcNetPacket::release_read_buffer() noexcept
+{
+	PcStreamManager::get_shared().release_buffer(mReadBuffer, mReadCapacity);
+	mReadBuffer = NULL;
+	mReadCapacity = 0;
+	mReadLength = 0;
+}
+
+GENERIC PcNetPacket::clear() noexcept
+{
+	mWriteQueue.clear();
+	mWriteQueueFront = 0;
+	mPendingWriteBytes = 0;
+	mZeroCopyPending.clear();
+	mZeroCopySequence = 0;
+	mZeroCopyState = 0;
+}
+
 PcNetPeerClient::PcNetPeerClient(socket_handle in_socket) :
 	mPeerSocket(in_socket), 
 	mPeerAddr(), 
 	mPeerPort(0),
-	mNetPacket()
+	mPeerPid(-1),
+	mPeerUid(-1),
+	mPeerGid(-1),
+	mIsLocalPeer(false),
+	mNetPacket(),
+	mIsDispatchingData(false),
+	mIsReadDeferred(false),
+	mIoWakeup(),
+	mWriteHighWatermark(0),
+	mWriteLowWatermark(0),
+	mMaxPendingWrite(0),
+	mIsWritePaused(false),
+	mIsWriteLimitExceeded(false),
+	mLastActivityTime(pc_net_now_ms()),
+	mWriteStallTime(0)
 {
 }
 
-PcNetPeerClient::PcNetPeerClient(PcNetPeerClient&& in_rhs) noexcept
+PcNetPeerClient::PcNetPeerClient(PcNetPeerClient&& in_rhs) noexcept : 
+	mIsDispatchingData(false), 
+	mIsReadDeferred(false),
+	mIoWakeup(in_rhs.mIoWakeup),
+	mWriteHighWatermark(in_rhs.mWriteHighWatermark),
+	mWriteLowWatermark(in_rhs.mWriteLowWatermark),
+	mMaxPendingWrite(in_rhs.mMaxPendingWrite),
+	mIsWritePaused(false),
+	mIsWriteLimitExceeded(false),
+	mLastActivityTime(in_rhs.mLastActivityTime),
+	mWriteStallTime(0)
 {
 	mPeerSocket = in_rhs.mPeerSocket;
+	mNetPacket = std::move(in_rhs.mNetPacket);
+	mPeerAddr = in_rhs.mPeerAddr;
 	mPeerPort = in_rhs.mPeerPort;
+	mPeerPid = in_rhs.mPeerPid;
+	mPeerUid = in_rhs.mPeerUid;
+	mPeerGid = in_rhs.mPeerGid;
+	mIsLocalPeer = in_rhs.mIsLocalPeer;
 
 	in_rhs.mPeerSocket = MBASE_INVALID_SOCKET;
 	in_rhs.mDisconnectSignal.reset_signal_with_state();
 	in_rhs.mReadSignal.reset_signal_with_state();
 	in_rhs.mWriteSignal.reset_signal_with_state();
-	in_rhs.mNetPacket.mPacketContent.set_cursor_front();
-	in_rhs.mNetPacket.mWriteBuffer.clear();
 }
 
 PcNetPeerClient::~PcNetPeerClient()
@@ -140,6 +321,38 @@ MBASE_ND(MBASE_OBS_IGNORE) typename PcNetPeerClient::socket_handle PcNetPeerClie
 	return mPeerSocket;
 }
 
+MBASE_ND(MBASE_OBS_IGNORE) bool PcNetPeerClient::is_local_peer() const noexcept
+{
+	return mIsLocalPeer;
+}
+
+MBASE_ND(MBASE_OBS_IGNORE) I32 PcNetPeerClient::get_peer_pid() const noexcept
+{
+	return mPeerPid;
+}
+
+MBASE_ND(MBASE_OBS_IGNORE) I32 PcNetPeerClient::get_peer_uid() const noexcept
+{
+	return mPeerUid;
+}
+
+MBASE_ND(MBASE_OBS_IGNORE) I32 PcNetPeerClient::get_peer_gid() const noexcept
+{
+	return mPeerGid;
+}
+
+MBASE_ND(MBASE_OBS_IGNORE) typename PcNetPeerClient::size_type PcNetPeerClient::get_pending_write_size() noexcept
+{
+	mbase::lock_guard writeGuard(mWriteMutex);
+	return mNetPacket.mPendingWriteBytes;
+}
+
+MBASE_ND(MBASE_OBS_IGNORE) bool PcNetPeerClient::is_write_paused() noexcept
+{
+	mbase::lock_guard writeGuard(mWriteMutex);
+	return mIsWritePaused;
+}
+
 PcNetPeerClient::flags PcNetPeerClient::write_data(CBYTEBUFFER in_data, size_type in_size)
 {
 	if(!is_connected())
@@ -152,14 +365,82 @@ PcNetPeerClient::flags PcNetPeerClient::write_data(CBYTEBUFFER in_data, size_typ
 		return flags::NET_PEER_ERR_INVALID_SIZE;
 	}
 
-	if (signal_write())
+	mbase::lock_guard writeGuard(mWriteMutex);
+	PcNetPacket& netPacket = mNetPacket;
+	if(mMaxPendingWrite && netPacket.mPendingWriteBytes + in_size > mMaxPendingWrite)
+	{
+		mIsWriteLimitExceeded = true;
+		mDisconnectSignal.set_signal();
+		_wake_io();
+		return flags::NET_PEER_ERR_WRITE_LIMIT;
+	}
+
+	netPacket.mPendingWriteBytes += in_size;
+	if(mWriteHighWatermark && netPacket.mPendingWriteBytes > mWriteHighWatermark)
+	{
+		mIsWritePaused = true;
+	}
+	if(netPacket.mWriteQueue.size() > netPacket.mWriteQueueFront)
+	{
+		// token sized writes of pipelined responses share one slice instead of one iovec each
+		PcNetBufferSlice& tailSlice = netPacket.mWriteQueue.back();
+		if(tailSlice.mAppendable && tailSlice.mLength + in_size <= gNetMinReadSize)
+		{
+			tailSlice.mAppendable->append(in_data, in_size);
+			tailSlice.mLength += in_size;
+			return flags::NET_PEER_SUCCCES;
+		}
+	}
+
+	std::shared_ptr<mbase::string> dataCopy = std::make_shared<mbase::string>(in_data, in_size);
+	PcNetBufferSlice newSlice;
+	newSlice.mAppendable = dataCopy.get();
+	newSlice.mLength = in_size;
+	newSlice.mBuffer = std::move(dataCopy);
+	netPacket.mWriteQueue.push_back(std::move(newSlice));
+	return flags::NET_PEER_SUCCCES;
+}
+
+PcNetPeerClient::flags PcNetPeerClient::write_buffer(const PcNetSharedBuffer& in_buffer)
+{
+	if(!in_buffer)
+	{
+		return flags::NET_PEER_ERR_INVALID_SIZE;
+	}
+	return write_buffer(in_buffer, 0, in_buffer->size());
+}
+
+PcNetPeerClient::flags PcNetPeerClient::write_buffer(const PcNetSharedBuffer& in_buffer, size_type in_offset, size_type in_length)
+{
+	if(!is_connected())
+	{
+		return flags::NET_PEER_ERR_DISCONNECTED;
+	}
+
+	if(!in_buffer || !in_length || in_offset > in_buffer->size() || in_length > in_buffer->size() - in_offset)
 	{
-		return flags::NET_PEER_ERR_ALREADY_PROCESSED;
+		return flags::NET_PEER_ERR_INVALID_SIZE;
 	}
 
-	mNetPacket.mWriteBuffer.clear();
-	mNetPacket.mWriteBuffer.append(in_data, in_size);
+	mbase::lock_guard writeGuard(mWriteMutex);
+	if(mMaxPendingWrite && mNetPacket.mPendingWriteBytes + in_length > mMaxPendingWrite)
+	{
+		mIsWriteLimitExceeded = true;
+		mDisconnectSignal.set_signal();
+		_wake_io();
+		return flags::NET_PEER_ERR_WRITE_LIMIT;
+	}
 
+	PcNetBufferSlice newSlice;
+	newSlice.mBuffer = in_buffer;
+	newSlice.mOffset = in_offset;
+	newSlice.mLength = in_length;
+	mNetPacket.mWriteQueue.push_back(std::move(newSlice));
+	mNetPacket.mPendingWriteBytes += in_length;
+	if(mWriteHighWatermark && mNetPacket.mPendingWriteBytes > mWriteHighWatermark)
+	{
+		mIsWritePaused = true;
+	}
 	return flags::NET_PEER_SUCCCES;
 }
 
@@ -170,12 +451,14 @@ PcNetPeerClient::flags PcNetPeerClient::send_write_signal()
 		return flags::NET_PEER_ERR_DISCONNECTED;
 	}
 
-	if(!mNetPacket.mWriteBuffer.size())
+	mbase::lock_guard writeGuard(mWriteMutex);
+	if(!mNetPacket.mPendingWriteBytes)
 	{
 		return flags::NET_PEER_ERR_DATA_IS_NOT_AVAILABLE;
 	}
 
 	mWriteSignal.set_signal();
+	_wake_io();
 	return flags::NET_PEER_SUCCCES;
 }
 
@@ -186,12 +469,24 @@ PcNetPeerClient::flags PcNetPeerClient::send_read_signal()
 		return flags::NET_PEER_ERR_DISCONNECTED;
 	}
 
+	mReadMutex.acquire();
 	if(signal_read())
 	{
+		mReadMutex.release();
+		return flags::NET_PEER_SUCCCES;
+	}
+
+	if(mIsDispatchingData)
+	{
+		// the next recv would overwrite the buffer on_data is still reading
+		mIsReadDeferred = true;
+		mReadMutex.release();
 		return flags::NET_PEER_SUCCCES;
 	}
 
 	mReadSignal.set_signal();
+	mReadMutex.release();
+	_wake_io();
 	return flags::NET_PEER_SUCCCES;
 }
 
@@ -202,9 +497,23 @@ PcNetPeerClient::flags PcNetPeerClient::disconnect()
 		return flags::NET_PEER_ERR_DISCONNECTED;
 	}
 	mDisconnectSignal.set_signal();
+	_wake_io();
 	return flags::NET_PEER_SUCCCES;
 }
 
+GENERIC PcNetPeerClient::set_write_watermarks(size_type in_high_watermark, size_type in_low_watermark)
+{
+	mbase::lock_guard writeGuard(mWriteMutex);
+	mWriteHighWatermark = in_high_watermark;
+	mWriteLowWatermark = in_low_watermark < in_high_watermark ? in_low_watermark : in_high_watermark;
+}
+
+GENERIC PcNetPeerClient::set_max_pending_write(size_type in_max_size)
+{
+	mbase::lock_guard writeGuard(mWriteMutex);
+	mMaxPendingWrite = in_max_size;
+}
+
 bool PcNetPeerClient::operator==(const PcNetPeerClient& in_rhs)
 {
 	return mPeerSocket == in_rhs.mPeerSocket;
@@ -238,122 +547,547 @@ GENERIC PcNetPeerClient::_destroy_peer() noexcept
 	mDisconnectSignal.reset_signal_with_state();
 	mReadSignal.reset_signal_with_state();
 	mWriteSignal.reset_signal_with_state();
-	mNetPacket.mPacketContent.set_cursor_front();
-	mNetPacket.mWriteBuffer.clear();
-}
 
-GENERIC PcNetPeerClient::_set_new_socket_handle(socket_handle in_socket) noexcept
-{
-	_destroy_peer();
-	mPeerSocket = in_socket;
+	// the read buffer stays until the peer is released, on_data may still be reading it
+	mWriteMutex.acquire();
+	mNetPacket.clear();
+	mWriteMutex.release();
 }
 
-PcNetServer::PcNetServer() : 
-	mIsListening(false), 
-	mRawSocket(MBASE_INVALID_SOCKET),
-	mAddr(""), 
-	mPort(0)
+GENERIC PcNetPeerClient::_begin_dispatch() noexcept
 {
+	mbase::lock_guard readGuard(mReadMutex);
+	mReadSignal.reset_signal_with_state();
+	mIsDispatchingData = true;
 }
 
-PcNetServer::~PcNetServer()
+GENERIC PcNetPeerClient::_end_dispatch() noexcept
 {
-	
+	mNetPacket.release_read_buffer(); // before a read can be signaled again
+	mReadMutex.acquire();
+	mIsDispatchingData = false;
+	bool isReadDeferred = mIsReadDeferred;
+	mIsReadDeferred = false;
+	if(isReadDeferred && is_connected())
+	{
+		mReadSignal.set_signal();
+	}
+	mReadMutex.release();
+
+	if(isReadDeferred)
+	{
+		_wake_io();
+	}
 }
 
-MBASE_ND(MBASE_OBS_IGNORE) bool PcNetServer::is_listening() const noexcept
+GENERIC PcNetPeerClient::_wake_io() noexcept
 {
-	return mIsListening;
+	if(mIoWakeup)
+	{
+		mIoWakeup->wake();
+	}
 }
 
-MBASE_ND(MBASE_OBS_IGNORE) mbase::string PcNetServer::get_address() const noexcept
+GENERIC PcNetPeerClient::_set_new_socket_handle(socket_handle in_socket) noexcept
 {
-	return mAddr;
+	_destroy_peer();
+	mPeerSocket = in_socket;
 }
 
-MBASE_ND(MBASE_OBS_IGNORE) I32 PcNetServer::get_port() const noexcept
+bool PcNetPeerClient::_update_io()
 {
-	return mPort;
+	if(signal_read() && !_read_io())
+	{
+		return false;
+	}
+
+	if(signal_write() && !_write_io())
+	{
+		return false;
+	}
+	return true;
 }
 
-PcNetServer::flags PcNetServer::listen() noexcept
+bool PcNetPeerClient::_read_io()
 {
-	#ifdef MBASE_PLATFORM_WINDOWS
-	if(mRawSocket == INVALID_SOCKET || mRawSocket == SOCKET_ERROR)
+	// idle peers with a pending read don't hold a buffer, most reads fit the stack buffer
+	IBYTE firstBytes[gNetMinReadSize];
+	I32 rResult = recv(mPeerSocket, firstBytes, gNetMinReadSize, 0);
+	if(rResult == MBASE_SOCKET_ERROR)
 	{
-		return flags::NET_SERVER_ERR_SOCKET_NOT_SET;
+		#ifdef MBASE_PLATFORM_WINDOWS 
+		if (WSAGetLastError() != WSAEWOULDBLOCK)
+		{
+			// Something bad happened
+			_destroy_peer();
+			return false;
+		}
+		#endif
+
+		#ifdef MBASE_PLATFORM_UNIX
+		if (errno != EWOULDBLOCK)
+		{
+			// Something bad happened
+			_destroy_peer();
+			return false;
+		}
+		#endif
+		return true;
 	}
-	#endif
 
-	#ifdef MBASE_PLATFORM_UNIX
-	if(mRawSocket == -1)
+	else if(!rResult)
 	{
-		return flags::NET_SERVER_ERR_SOCKET_NOT_SET;
+		_destroy_peer();
+		return false;
 	}
-	#endif
 
-	if(mIsListening)
+	size_type readLength = static_cast<size_type>(rResult);
+	u_long availableBytes = 0;
+	if(readLength == gNetMinReadSize)
 	{
-		return flags::NET_SERVER_WARN_ALREADY_LISTENING;
+		#ifdef MBASE_PLATFORM_WINDOWS
+		ioctlsocket(mPeerSocket, FIONREAD, &availableBytes);
+		#endif
+		#ifdef MBASE_PLATFORM_UNIX
+		I32 queuedBytes = 0;
+		if(!ioctl(mPeerSocket, FIONREAD, &queuedBytes) && queuedBytes > 0)
+		{
+			availableBytes = static_cast<u_long>(queuedBytes);
+		}
+		#endif
 	}
 
-	mIsListening = true;
-	on_listen();
-	return flags::NET_SERVER_SUCCESS;
+	size_type targetSize = readLength + static_cast<size_type>(availableBytes);
+	if(targetSize > gNetMaxReadSize)
+	{
+		targetSize = gNetMaxReadSize;
+	}
+
+	PcNetPacket& netPacket = mNetPacket;
+	netPacket.release_read_buffer();
+	netPacket.mReadBuffer = PcStreamManager::get_shared().acquire_buffer(targetSize, netPacket.mReadCapacity);
+	if(!netPacket.mReadBuffer)
+	{
+		_destroy_peer();
+		return false;
+	}
+	memcpy(netPacket.mReadBuffer, firstBytes, readLength);
+	if(availableBytes)
+	{
+		// a large request arrives in one on_data instead of a read signal round trip per 4KB
+		rResult = recv(mPeerSocket, netPacket.mReadBuffer + readLength, static_cast<I32>(netPacket.mReadCapacity - readLength), 0);
+		if(rResult > 0)
+		{
+			readLength += static_cast<size_type>(rResult);
+		}
+	}
+	netPacket.mReadLength = readLength;
+	mLastActivityTime = pc_net_now_ms();
+
+	mbase::lock_guard readGuard(mReadMutex);
+	mReadSignal.set_signal_state();
+	mReadSignal.reset_signal();
+	return true;
 }
 
-PcNetServer::flags PcNetServer::stop() noexcept
+bool PcNetPeerClient::_write_io()
 {
 	#ifdef MBASE_PLATFORM_WINDOWS
-	if(mRawSocket == INVALID_SOCKET || mRawSocket == SOCKET_ERROR)
+	WSABUF sendBuffers[gNetMaxWriteSlices];
+	#endif
+	#ifdef MBASE_PLATFORM_UNIX
+	struct iovec sendBuffers[gNetMaxWriteSlices];
+	#endif
+
+	// writers append behind the lock while a send is in progress
+	mWriteMutex.acquire();
+	PcNetPacket& netPacket = mNetPacket;
+	U32 sliceCount = 0;
+	size_type batchBytes = 0;
+	for(size_type i = netPacket.mWriteQueueFront; i < netPacket.mWriteQueue.size() && sliceCount < gNetMaxWriteSlices; i++)
 	{
-		return flags::NET_SERVER_ERR_SOCKET_NOT_SET;
+		PcNetBufferSlice& currentSlice = netPacket.mWriteQueue[i];
+		currentSlice.mAppendable = NULL; // the kernel may be reading it from now on
+		#ifdef MBASE_PLATFORM_WINDOWS
+		sendBuffers[sliceCount].buf = const_cast<CHAR*>(currentSlice.mBuffer->c_str() + currentSlice.mOffset);
+		sendBuffers[sliceCount].len = static_cast<ULONG>(currentSlice.mLength);
+		#endif
+		#ifdef MBASE_PLATFORM_UNIX
+		sendBuffers[sliceCount].iov_base = const_cast<IBYTEBUFFER>(currentSlice.mBuffer->c_str() + currentSlice.mOffset);
+		sendBuffers[sliceCount].iov_len = currentSlice.mLength;
+		#endif
+		batchBytes += currentSlice.mLength;
+		++sliceCount;
 	}
-	#endif
 
-	#ifdef MBASE_PLATFORM_UNIX
-	if(mRawSocket == -1)
+	if(!sliceCount)
 	{
-		return flags::NET_SERVER_ERR_SOCKET_NOT_SET;
+		mWriteStallTime = 0;
+		mWriteSignal.reset_signal_with_state();
+		mWriteMutex.release();
+		return true;
+	}
+
+	I64 sResult = MBASE_SOCKET_ERROR;
+	bool isZeroCopy = false;
+	#ifdef MBASE_PLATFORM_WINDOWS
+	DWORD sentBytes = 0;
+	if(WSASend(mPeerSocket, sendBuffers, sliceCount, &sentBytes, 0, NULL, NULL) != SOCKET_ERROR)
+	{
+		sResult = static_cast<I64>(sentBytes);
 	}
+	I32 sendError = sResult == MBASE_SOCKET_ERROR ? WSAGetLastError() : 0;
+	bool isWouldBlock = sendError == WSAEWOULDBLOCK;
 	#endif
 
-	mIsListening = false;
-	on_stop();
-	return flags::NET_SERVER_SUCCESS;
-}
+	#ifdef MBASE_PLATFORM_UNIX
+	#ifdef MBASE_PLATFORM_APPLE
+	I32 sendFlags = 0;
+	#else
+	I32 sendFlags = MSG_NOSIGNAL; // a peer that went away is reported by the return value
+	#endif
 
-GENERIC PcNetServer::acquire_object_watcher(mbase::list_object_watcher<PcNetServer>* in_watcher)
-{
-	if(in_watcher)
+	#ifdef MBASE_NET_ZERO_COPY
+	if(batchBytes >= gNetZeroCopyThreshold && netPacket.mZeroCopyState >= 0)
 	{
-		mObjectWatcher = in_watcher;
-		mObjectWatcher->mSubject = this;
+		if(!netPacket.mZeroCopyState)
+		{
+			I32 zeroCopyEnable = 1;
+			netPacket.mZeroCopyState = setsockopt(mPeerSocket, SOL_SOCKET, SO_ZEROCOPY, &zeroCopyEnable, sizeof(zeroCopyEnable)) ? -1 : 1;
+		}
+		isZeroCopy = netPacket.mZeroCopyState == 1;
 	}
-}
+	#endif
 
-GENERIC PcNetServer::release_object_watcher()
-{
-	if(mObjectWatcher)
+	struct msghdr sendHeader = {0};
+	sendHeader.msg_iov = sendBuffers;
+	sendHeader.msg_iovlen = sliceCount;
+	#ifdef MBASE_NET_ZERO_COPY
+	sResult = sendmsg(mPeerSocket, &sendHeader, sendFlags | (isZeroCopy ? MSG_ZEROCOPY : 0));
+	if(sResult == MBASE_SOCKET_ERROR && isZeroCopy && errno == ENOBUFS)
 	{
-		mObjectWatcher->mSubject = NULL;
+		// out of optmem for the pinned pages, this one is copied
+		isZeroCopy = false;
+		sResult = sendmsg(mPeerSocket, &sendHeader, sendFlags);
 	}
-}
-
-PcNetTcpServer::PcNetTcpServer()
-{
+	#else
+	sResult = sendmsg(mPeerSocket, &sendHeader, sendFlags);
+	#endif
+	I32 sendError = sResult == MBASE_SOCKET_ERROR ? errno : 0;
+	bool isWouldBlock = sendError == EWOULDBLOCK || sendError == EAGAIN;
+	#endif
 
-}
+	if(sResult > 0)
+	{
+		mLastActivityTime = pc_net_now_ms();
+		mWriteStallTime = 0;
+		size_type remainingBytes = static_cast<size_type>(sResult);
+		if(isZeroCopy)
+		{
+			for(size_type i = netPacket.mWriteQueueFront, sentLength = 0; i < netPacket.mWriteQueue.size() && sentLength < remainingBytes; i++)
+			{
+				netPacket.mZeroCopyPending.push_back(std::make_pair(netPacket.mZeroCopySequence, netPacket.mWriteQueue[i].mBuffer));
+				sentLength += netPacket.mWriteQueue[i].mLength;
+			}
+			++netPacket.mZeroCopySequence;
+		}
 
-PcNetTcpServer::~PcNetTcpServer()
-{
-	this->release_object_watcher();
-}
+		netPacket.mPendingWriteBytes -= remainingBytes;
+		while(remainingBytes)
+		{
+			PcNetBufferSlice& frontSlice = netPacket.mWriteQueue[netPacket.mWriteQueueFront];
+			if(remainingBytes < frontSlice.mLength)
+			{
+				frontSlice.mOffset += remainingBytes;
+				frontSlice.mLength -= remainingBytes;
+				break;
+			}
+			remainingBytes -= frontSlice.mLength;
+			frontSlice = PcNetBufferSlice();
+			++netPacket.mWriteQueueFront;
+		}
 
-MBASE_ND(MBASE_OBS_IGNORE) const typename PcNetTcpServer::client_list& PcNetTcpServer::get_connected_peers() const noexcept
-{
-	return mConnectedClients;
-}
+		if(netPacket.mWriteQueueFront == netPacket.mWriteQueue.size())
+		{
+			netPacket.mWriteQueue.clear();
+			netPacket.mWriteQueueFront = 0;
+			mWriteSignal.reset_signal_with_state();
+		}
+		else if(netPacket.mWriteQueueFront >= gNetMaxWriteSlices)
+		{
+			mbase::vector<PcNetBufferSlice> remainingSlices;
+			remainingSlices.reserve(netPacket.mWriteQueue.size() - netPacket.mWriteQueueFront);
+			for(size_type i = netPacket.mWriteQueueFront; i < netPacket.mWriteQueue.size(); i++)
+			{
+				remainingSlices.push_back(std::move(netPacket.mWriteQueue[i]));
+			}
+			netPacket.mWriteQueue = std::move(remainingSlices);
+			netPacket.mWriteQueueFront = 0;
+		}
+	}
+
+	else if(isWouldBlock && !mWriteStallTime)
+	{
+		mWriteStallTime = pc_net_now_ms();
+	}
+
+	if(mIsWritePaused && netPacket.mPendingWriteBytes <= mWriteLowWatermark)
+	{
+		mIsWritePaused = false;
+		mDrainSignal.set_signal_with_state();
+	}
+
+	if(netPacket.mZeroCopyPending.size())
+	{
+		_reap_zero_copy();
+	}
+	mWriteMutex.release();
+
+	if(sResult == MBASE_SOCKET_ERROR)
+	{
+		if(!isWouldBlock)
+		{
+			// Something bad happened
+			_destroy_peer();
+			return false;
+		}
+	}
+
+	else if(!sResult)
+	{
+		_destroy_peer();
+		return false;
+	}
+	return true;
+}
+
+GENERIC PcNetPeerClient::_reap_zero_copy() noexcept
+{
+	#ifdef MBASE_NET_ZERO_COPY
+	// completions arrive on the error queue as ranges of send call sequence numbers
+	PcNetPacket& netPacket = mNetPacket;
+	IBYTE controlBuffer[256];
+	while(netPacket.mZeroCopyPending.size())
+	{
+		struct msghdr errorHeader = {0};
+		errorHeader.msg_control = controlBuffer;
+		errorHeader.msg_controllen = sizeof(controlBuffer);
+		if(recvmsg(mPeerSocket, &errorHeader, MSG_ERRQUEUE | MSG_DONTWAIT) == -1)
+		{
+			break;
+		}
+
+		for(struct cmsghdr* controlMessage = CMSG_FIRSTHDR(&errorHeader); controlMessage; controlMessage = CMSG_NXTHDR(&errorHeader, controlMessage))
+		{
+			bool isRecvError = (controlMessage->cmsg_level == SOL_IP && controlMessage->cmsg_type == IP_RECVERR) || (controlMessage->cmsg_level == SOL_IPV6 && controlMessage->cmsg_type == IPV6_RECVERR);
+			if(!isRecvError)
+			{
+				continue;
+			}
+
+			struct sock_extended_err extendedError;
+			memcpy(&extendedError, CMSG_DATA(controlMessage), sizeof(extendedError));
+			if(extendedError.ee_errno || extendedError.ee_origin != SO_EE_ORIGIN_ZEROCOPY)
+			{
+				continue;
+			}
+
+			if(extendedError.ee_code & SO_EE_CODE_ZEROCOPY_COPIED)
+			{
+				// the route copies anyway (loopback), pinning the pages only adds the notification cost
+				netPacket.mZeroCopyState = -1;
+			}
+
+			size_type completedCount = 0;
+			while(completedCount < netPacket.mZeroCopyPending.size() && static_cast<I32>(netPacket.mZeroCopyPending[completedCount].first - extendedError.ee_data) <= 0)
+			{
+				++completedCount;
+			}
+
+			mbase::vector<std::pair<U32, PcNetSharedBuffer>> stillPending;
+			for(size_type i = completedCount; i < netPacket.mZeroCopyPending.size(); i++)
+			{
+				stillPending.push_back(std::move(netPacket.mZeroCopyPending[i]));
+			}
+			netPacket.mZeroCopyPending = std::move(stillPending);
+		}
+	}
+	#endif
+}
+
+PcNetServer::PcNetServer() : 
+	mObjectWatcher(NULL),
+	mIoWakeup(),
+	mIsListening(false), 
+	mIsAcceptReady(false),
+	mRawSocket(MBASE_INVALID_SOCKET),
+	mAddr(""), 
+	mPort(0),
+	mIsLocal(false),
+	mIsAnyLocalUidAllowed(false)
+{
+}
+
+PcNetServer::~PcNetServer()
+{
+	
+}
+
+MBASE_ND(MBASE_OBS_IGNORE) bool PcNetServer::is_listening() const noexcept
+{
+	return mIsListening;
+}
+
+MBASE_ND(MBASE_OBS_IGNORE) mbase::string PcNetServer::get_address() const noexcept
+{
+	return mAddr;
+}
+
+MBASE_ND(MBASE_OBS_IGNORE) I32 PcNetServer::get_port() const noexcept
+{
+	return mPort;
+}
+
+MBASE_ND(MBASE_OBS_IGNORE) bool PcNetServer::is_local() const noexcept
+{
+	return mIsLocal;
+}
+
+MBASE_ND(MBASE_OBS_IGNORE) bool PcNetServer::is_local_peer_allowed(I32 in_uid) const noexcept
+{
+	if(mIsAnyLocalUidAllowed)
+	{
+		return true;
+	}
+
+	#ifdef MBASE_PLATFORM_UNIX
+	if(in_uid == 0 || in_uid == static_cast<I32>(geteuid()))
+	{
+		return true;
+	}
+	#endif
+
+	for(const I32& allowedUid : mAllowedLocalUids)
+	{
+		if(allowedUid == in_uid)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+PcNetServer::flags PcNetServer::listen() noexcept
+{
+	#ifdef MBASE_PLATFORM_WINDOWS
+	if(mRawSocket == INVALID_SOCKET || mRawSocket == SOCKET_ERROR)
+	{
+		return flags::NET_SERVER_ERR_SOCKET_NOT_SET;
+	}
+	#endif
+
+	#ifdef MBASE_PLATFORM_UNIX
+	if(mRawSocket == -1)
+	{
+		return flags::NET_SERVER_ERR_SOCKET_NOT_SET;
+	}
+	#endif
+
+	if(mIsListening)
+	{
+		return flags::NET_SERVER_WARN_ALREADY_LISTENING;
+	}
+
+	mIsListening = true;
+	on_listen();
+	return flags::NET_SERVER_SUCCESS;
+}
+
+PcNetServer::flags PcNetServer::stop() noexcept
+{
+	#ifdef MBASE_PLATFORM_WINDOWS
+	if(mRawSocket == INVALID_SOCKET || mRawSocket == SOCKET_ERROR)
+	{
+		return flags::NET_SERVER_ERR_SOCKET_NOT_SET;
+	}
+	#endif
+
+	#ifdef MBASE_PLATFORM_UNIX
+	if(mRawSocket == -1)
+	{
+		return flags::NET_SERVER_ERR_SOCKET_NOT_SET;
+	}
+	#endif
+
+	mIsListening = false;
+	on_stop();
+	return flags::NET_SERVER_SUCCESS;
+}
+
+GENERIC PcNetServer::allow_local_uid(I32 in_uid)
+{
+	if(!is_local_peer_allowed(in_uid))
+	{
+		mAllowedLocalUids.push_back(in_uid);
+	}
+}
+
+GENERIC PcNetServer::allow_any_local_uid(bool in_allow) noexcept
+{
+	mIsAnyLocalUidAllowed = in_allow;
+}
+
+GENERIC PcNetServer::acquire_object_watcher(mbase::list_object_watcher<PcNetServer>* in_watcher)
+{
+	if(in_watcher)
+	{
+		mObjectWatcher = in_watcher;
+		mObjectWatcher->mSubject = this;
+	}
+}
+
+GENERIC PcNetServer::release_object_watcher()
+{
+	if(mObjectWatcher)
+	{
+		mObjectWatcher->mSubject = NULL;
+	}
+}
+
+GENERIC PcNetServer::_collect_io(mbase::vector<PcNetIoInterest>& out_interests)
+{
+	if(mIsListening && mRawSocket != MBASE_INVALID_SOCKET)
+	{
+		out_interests.push_back({mRawSocket, true, false});
+	}
+}
+
+PcNetTcpServer::PcNetTcpServer() : mDiagnostics(NULL)
+{
+
+}
+
+PcNetTcpServer::~PcNetTcpServer()
+{
+	this->release_object_watcher();
+}
+
+MBASE_ND(MBASE_OBS_IGNORE) const typename PcNetTcpServer::client_list& PcNetTcpServer::get_connected_peers() const noexcept
+{
+	return mConnectedClients;
+}
+
+MBASE_ND(MBASE_OBS_IGNORE) PcNetServerLimits PcNetTcpServer::get_limits() noexcept
+{
+	mbase::lock_guard limitsGuard(mLimitsMutex);
+	return mLimits;
+}
+
+MBASE_ND(MBASE_OBS_IGNORE) PcNetServerStatistics PcNetTcpServer::get_statistics() noexcept
+{
+	mbase::lock_guard limitsGuard(mLimitsMutex);
+	return mStatistics;
+}
 
 bool PcNetTcpServer::signal_accepting()
 {
@@ -375,9 +1109,28 @@ bool PcNetTcpServer::signal_state_processing_data()
 	return mDataProcess.get_signal_state();
 }
 
-GENERIC PcNetTcpServer::accept()
+GENERIC PcNetTcpServer::on_write_drained([[maybe_unused]] std::shared_ptr<PcNetPeerClient> out_peer)
+{
+
+}
+
+GENERIC PcNetTcpServer::set_limits(const PcNetServerLimits& in_limits)
+{
+	mbase::lock_guard limitsGuard(mLimitsMutex);
+	mLimits = in_limits;
+}
+
+GENERIC PcNetTcpServer::set_diagnostics(PcDiagnostics* in_diagnostics) noexcept
+{
+	mbase::lock_guard limitsGuard(mLimitsMutex);
+	mDiagnostics = in_diagnostics;
+}
+
+bool PcNetTcpServer::accept()
 {	
-	socket_handle resultClient = ::accept(mRawSocket, NULL, NULL);
+	struct sockaddr_storage peerAddress = {0};
+	socklen_t peerAddressLength = sizeof(peerAddress);
+	socket_handle resultClient = ::accept(mRawSocket, reinterpret_cast<struct sockaddr*>(&peerAddress), &peerAddressLength);
 	if (resultClient == MBASE_INVALID_SOCKET)
 	{
 		#ifdef MBASE_PLATFORM_WINDOWS
@@ -403,9 +1156,82 @@ GENERIC PcNetTcpServer::accept()
 			// TODO: DESTROY THE ENTIRE SERVER
 		}
 		#endif 	
+		return false;
 	}
 	else
 	{
+		I32 peerPid = -1;
+		I32 peerUid = -1;
+		I32 peerGid = -1;
+		#ifdef MBASE_PLATFORM_UNIX
+		if(mIsLocal)
+		{
+			// the credentials are the ones of the process that called connect, they can't be forged by the peer
+			#ifdef MBASE_PLATFORM_APPLE
+			uid_t credUid = 0;
+			gid_t credGid = 0;
+			if(!getpeereid(resultClient, &credUid, &credGid))
+			{
+				peerUid = static_cast<I32>(credUid);
+				peerGid = static_cast<I32>(credGid);
+			}
+			pid_t credPid = 0;
+			socklen_t credLength = sizeof(credPid);
+			if(!getsockopt(resultClient, SOL_LOCAL, LOCAL_PEERPID, &credPid, &credLength))
+			{
+				peerPid = static_cast<I32>(credPid);
+			}
+			#else
+			struct ucred peerCredentials = {0};
+			socklen_t credLength = sizeof(peerCredentials);
+			if(!getsockopt(resultClient, SOL_SOCKET, SO_PEERCRED, &peerCredentials, &credLength))
+			{
+				peerPid = static_cast<I32>(peerCredentials.pid);
+				peerUid = static_cast<I32>(peerCredentials.uid);
+				peerGid = static_cast<I32>(peerCredentials.gid);
+			}
+			#endif
+
+			if(peerUid == -1 || !is_local_peer_allowed(peerUid))
+			{
+				close(resultClient);
+				return true;
+			}
+		}
+		#endif
+
+		mbase::string peerAddr = mAddr;
+		I32 peerPort = 0;
+		if(!mIsLocal)
+		{
+			IBYTE hostBuffer[NI_MAXHOST] = {0};
+			IBYTE serviceBuffer[NI_MAXSERV] = {0};
+			if(!getnameinfo(reinterpret_cast<struct sockaddr*>(&peerAddress), peerAddressLength, hostBuffer, sizeof(hostBuffer), serviceBuffer, sizeof(serviceBuffer), NI_NUMERICHOST | NI_NUMERICSERV))
+			{
+				peerAddr = hostBuffer;
+				peerPort = atoi(serviceBuffer);
+			}
+		}
+
+		PcNetServerLimits acceptLimits = get_limits();
+		if(acceptLimits.mMaxConnections && mConnectedClientsProcessLoop.size() >= acceptLimits.mMaxConnections)
+		{
+			pc_net_close_socket(resultClient);
+			_record_event(&PcNetServerStatistics::mRejectedConnections, mbase::string::from_format("connection from %s is refused, %u connections are open", peerAddr.c_str(), acceptLimits.mMaxConnections));
+			return true;
+		}
+
+		if(!mIsLocal && acceptLimits.mMaxConnectionsPerAddress)
+		{
+			mbase::unordered_map<mbase::string, U32>::iterator addrIt = mAddressConnections.find(peerAddr);
+			if(addrIt != mAddressConnections.end() && addrIt->second >= acceptLimits.mMaxConnectionsPerAddress)
+			{
+				pc_net_close_socket(resultClient);
+				_record_event(&PcNetServerStatistics::mRejectedConnections, mbase::string::from_format("connection from %s is refused, the address has %u connections open", peerAddr.c_str(), addrIt->second));
+				return true;
+			}
+		}
+
 		u_long ctlMode = 1;
 		
 		#ifdef MBASE_PLATFORM_WINDOWS
@@ -417,12 +1243,30 @@ GENERIC PcNetTcpServer::accept()
 		#endif
 		
 		std::shared_ptr<PcNetPeerClient> connectedClient = std::make_shared<PcNetPeerClient>(PcNetPeerClient(resultClient));
+		connectedClient->mIoWakeup = mIoWakeup;
+		connectedClient->mPeerAddr = peerAddr;
+		connectedClient->mPeerPort = peerPort;
+		connectedClient->set_write_watermarks(acceptLimits.mWriteHighWatermark, acceptLimits.mWriteLowWatermark);
+		connectedClient->set_max_pending_write(acceptLimits.mMaxPendingWrite);
+		if(mIsLocal)
+		{
+			connectedClient->mPeerPid = peerPid;
+			connectedClient->mPeerUid = peerUid;
+			connectedClient->mPeerGid = peerGid;
+			connectedClient->mIsLocalPeer = true;
+		}
+		else
+		{
+			++mAddressConnections[peerAddr];
+		}
+		_record_event(&PcNetServerStatistics::mAcceptedConnections, mbase::string());
 		mConnectedClientsProcessLoop.push_back(connectedClient);
 		mAcceptMutex.acquire();
 		mAcceptClients.push_back(connectedClient);
 		mAcceptMutex.release();
 		mConnectionAccept.set_signal_with_state();
 	}
+	return true;
 }
 
 GENERIC PcNetTcpServer::update()
@@ -449,200 +1293,760 @@ GENERIC PcNetTcpServer::update()
 
 		if(netPeer->signal_read_state())
 		{
-			CBYTEBUFFER inData = netPeer->mNetPacket.mPacketContent.get_buffer();
-			size_type inDataLength = netPeer->mNetPacket.mPacketContent.buffer_length();
-			netPeer->mNetPacket.mPacketContent.set_cursor_front();
-			netPeer->mReadSignal.reset_signal_with_state();
+			CBYTEBUFFER inData = netPeer->mNetPacket.mReadBuffer;
+			size_type inDataLength = netPeer->mNetPacket.mReadLength;
+			netPeer->_begin_dispatch();
 			on_data(netPeer, inData, inDataLength);
+			netPeer->_end_dispatch();
+		}
+
+		if(netPeer->mDrainSignal.get_signal_state())
+		{
+			netPeer->mDrainSignal.reset_signal_with_state();
+			_record_event(&PcNetServerStatistics::mWritePauses, mbase::string());
+			on_write_drained(netPeer);
 		}
 
 		++It;
 	}
+
+	mLimitsMutex.acquire();
+	mbase::vector<mbase::string> limitEvents = std::move(mPendingEvents);
+	mPendingEvents = mbase::vector<mbase::string>();
+	PcDiagnostics* serverDiagnostics = mDiagnostics;
+	mLimitsMutex.release();
+	if(serverDiagnostics)
+	{
+		for(const mbase::string& limitEvent : limitEvents)
+		{
+			serverDiagnostics->log(PcDiagnostics::flags::LOGTYPE_WARNING, PcDiagnostics::flags::LOGIMPORTANCE_MID, limitEvent);
+		}
+	}
 }
 
 GENERIC PcNetTcpServer::update_t()
 {
-	if(this->is_listening())
+	U64 currentTime = pc_net_now_ms();
+	if(this->is_listening() && mIsAcceptReady)
 	{
-		this->accept();
+		// accepted only when the poll reports the listener readable, in batches,
+		// a backlog left over keeps it readable and the next poll returns at once
+		mIsAcceptReady = false;
+		U32 acceptCount = 0;
+		while(acceptCount < gNetMaxAcceptBatch && this->accept())
+		{
+			++acceptCount;
+		}
 	}
 
+	PcNetServerLimits peerLimits = get_limits();
 	for(client_list::iterator It = mConnectedClientsProcessLoop.begin(); It != mConnectedClientsProcessLoop.end();)
 	{
 		std::shared_ptr<PcNetPeerClient> netPeer = *It;
 		if(!netPeer->is_connected() || netPeer->signal_disconnect())
 		{
+			if(netPeer->mIsWriteLimitExceeded)
+			{
+				_record_event(&PcNetServerStatistics::mWriteLimitDisconnects, mbase::string::from_format("peer %s is disconnected, its unread output is over the limit", netPeer->mPeerAddr.c_str()));
+			}
 			netPeer->_destroy_peer();
 			netPeer->mDisconnectSignal.reset_signal_with_state();
+			_release_address(netPeer);
 			It = mConnectedClientsProcessLoop.erase(It);
 			continue;
 		}
 
-		if(netPeer->signal_read())
+		if(!netPeer->_update_io())
 		{
-			IBYTEBUFFER bytesToReceive = netPeer->mNetPacket.mPacketContent.data();
-			I32 rResult = recv(netPeer->mPeerSocket, bytesToReceive, gNetDefaultPacketSize, 0);
-			if(rResult == MBASE_SOCKET_ERROR)
-			{
-				#ifdef MBASE_PLATFORM_WINDOWS 
-				if (WSAGetLastError() != WSAEWOULDBLOCK)
-				{
-					// Something bad happened
-					netPeer->_destroy_peer();
-					It = mConnectedClientsProcessLoop.erase(It);
-					continue;
-				}
-				#endif
-
-				#ifdef MBASE_PLATFORM_UNIX
-				if (errno != EWOULDBLOCK)
-				{
-					// Something bad happened
-					netPeer->_destroy_peer();
-					It = mConnectedClientsProcessLoop.erase(It);
-					continue;
-				}
-				#endif
+			_release_address(netPeer);
+			It = mConnectedClientsProcessLoop.erase(It);
+			continue;
+		}
+
+		if(peerLimits.mIdleTimeoutMs && currentTime > netPeer->mLastActivityTime + peerLimits.mIdleTimeoutMs)
+		{
+			_record_event(&PcNetServerStatistics::mIdleTimeouts, mbase::string::from_format("peer %s is disconnected, idle for %u ms", netPeer->mPeerAddr.c_str(), peerLimits.mIdleTimeoutMs));
+			netPeer->_destroy_peer();
+			_release_address(netPeer);
+			It = mConnectedClientsProcessLoop.erase(It);
+			continue;
+		}
+
+		if(peerLimits.mReadTimeoutMs && netPeer->mWriteStallTime && currentTime > netPeer->mWriteStallTime + peerLimits.mReadTimeoutMs)
+		{
+			// a slow or stalled reader, its socket buffer is full and the output waits in memory
+			_record_event(&PcNetServerStatistics::mReadTimeouts, mbase::string::from_format("peer %s is disconnected, it didn't read its output for %u ms", netPeer->mPeerAddr.c_str(), peerLimits.mReadTimeoutMs));
+			netPeer->_destroy_peer();
+			_release_address(netPeer);
+			It = mConnectedClientsProcessLoop.erase(It);
+			continue;
+		}
+		++It;
+	}
+}
+
+GENERIC PcNetTcpServer::_collect_io(mbase::vector<PcNetIoInterest>& out_interests)
+{
+	PcNetServer::_collect_io(out_interests);
+	for(std::shared_ptr<PcNetPeerClient>& netPeer : mConnectedClientsProcessLoop)
+	{
+		// a peer that isn't asked to read or write is woken by the signal that asks it
+		bool isReading = netPeer->signal_read();
+		bool isWriting = netPeer->signal_write();
+		if(netPeer->mPeerSocket != MBASE_INVALID_SOCKET && (isReading || isWriting))
+		{
+			out_interests.push_back({netPeer->mPeerSocket, isReading, isWriting});
+		}
+	}
+}
+
+GENERIC PcNetTcpServer::_record_event(U64 PcNetServerStatistics::* in_counter, const mbase::string& in_message)
+{
+	mbase::lock_guard limitsGuard(mLimitsMutex);
+	++(mStatistics.*in_counter);
+	if(mDiagnostics && in_message.size())
+	{
+		// PcDiagnostics isn't thread safe, the messages are logged from update()
+		mPendingEvents.push_back(in_message);
+	}
+}
+
+GENERIC PcNetTcpServer::_release_address(const std::shared_ptr<PcNetPeerClient>& in_peer)
+{
+	if(in_peer->mIsLocalPeer)
+	{
+		return;
+	}
+
+	mbase::unordered_map<mbase::string, U32>::iterator addrIt = mAddressConnections.find(in_peer->mPeerAddr);
+	if(addrIt != mAddressConnections.end() && !--addrIt->second)
+	{
+		mAddressConnections.erase(addrIt);
+	}
+}
+
+static bool pc_net_is_in_progress() noexcept
+{
+	#ifdef MBASE_PLATFORM_WINDOWS
+	I32 wsaError = WSAGetLastError();
+	return wsaError == WSAEWOULDBLOCK || wsaError == WSAEINPROGRESS;
+	#endif
+	#ifdef MBASE_PLATFORM_UNIX
+	return errno == EINPROGRESS || errno == EWOULDBLOCK;
+	#endif
+}
+
+PcNetClient::PcNetClient() :
+	mManager(NULL),
+	mObjectWatcher(NULL),
+	mConnectState(connect_state::IDLE),
+	mConnectResult(flags::NET_CLIENT_SUCCESS),
+	mEndpointIndex(0),
+	mPendingSocket(MBASE_INVALID_SOCKET),
+	mAttemptDeadline(0),
+	mConnectDeadline(0),
+	mIsTimedOut(false),
+	mPeer(),
+	mAddr(),
+	mPort(0)
+{
+}
+
+PcNetClient::~PcNetClient()
+{
+	_release_watcher();
+	_close_pending_socket();
+	if(mPeer)
+	{
+		mPeer->_destroy_peer();
+	}
+}
+
+MBASE_ND(MBASE_OBS_IGNORE) bool PcNetClient::is_connecting() const noexcept
+{
+	return mConnectState == connect_state::CONNECTING;
+}
+
+MBASE_ND(MBASE_OBS_IGNORE) bool PcNetClient::is_connected() const noexcept
+{
+	return mConnectState == connect_state::CONNECTED;
+}
+
+MBASE_ND(MBASE_OBS_IGNORE) std::shared_ptr<PcNetPeerClient> PcNetClient::get_peer()
+{
+	mbase::lock_guard stateGuard(mStateMutex);
+	return mPeer;
+}
+
+MBASE_ND(MBASE_OBS_IGNORE) mbase::string PcNetClient::get_address() const noexcept
+{
+	return mAddr;
+}
+
+MBASE_ND(MBASE_OBS_IGNORE) I32 PcNetClient::get_port() const noexcept
+{
+	return mPort;
+}
+
+PcNetClient::flags PcNetClient::disconnect()
+{
+	mbase::lock_guard stateGuard(mStateMutex);
+	if(mConnectState == connect_state::CONNECTING)
+	{
+		// the attempt is abandoned, reported as a timeout
+		_close_pending_socket();
+		mIsTimedOut = true;
+		mConnectDeadline = 0;
+		if(mManager)
+		{
+			mManager->mIoWakeup->wake();
+		}
+		return flags::NET_CLIENT_SUCCESS;
+	}
+
+	if(mConnectState != connect_state::CONNECTED || !mPeer)
+	{
+		return flags::NET_CLIENT_ERR_NOT_CONNECTED;
+	}
+	mPeer->disconnect();
+	return flags::NET_CLIENT_SUCCESS;
+}
+
+GENERIC PcNetClient::update()
+{
+	if(mConnectSignal.get_signal())
+	{
+		mStateMutex.acquire();
+		mConnectSignal.reset_signal_with_state();
+		connect_state finishedState = mConnectState;
+		flags finishedResult = mConnectResult;
+		std::shared_ptr<PcNetPeerClient> connectedPeer = mPeer;
+		if(finishedState == connect_state::FAILED)
+		{
+			mConnectState = connect_state::IDLE;
+		}
+		mStateMutex.release();
+
+		if(finishedState == connect_state::CONNECTED)
+		{
+			on_connect(connectedPeer);
+		}
+		else if(finishedState == connect_state::FAILED)
+		{
+			on_connect_failed(finishedResult);
+		}
+	}
+
+	if(mConnectState != connect_state::CONNECTED)
+	{
+		return;
+	}
+
+	mStateMutex.acquire();
+	std::shared_ptr<PcNetPeerClient> netPeer = mPeer;
+	if(netPeer && !netPeer->is_connected())
+	{
+		mPeer.reset();
+		mConnectState = connect_state::IDLE;
+	}
+	mStateMutex.release();
+
+	if(!netPeer)
+	{
+		return;
+	}
+
+	if(!netPeer->is_connected())
+	{
+		on_disconnect(netPeer);
+		return;
+	}
+
+	if(netPeer->signal_read_state())
+	{
+		CBYTEBUFFER inData = netPeer->mNetPacket.mReadBuffer;
+		size_type inDataLength = netPeer->mNetPacket.mReadLength;
+		netPeer->_begin_dispatch();
+		on_data(netPeer, inData, inDataLength);
+		netPeer->_end_dispatch();
+	}
+}
+
+GENERIC PcNetClient::update_t()
+{
+	mbase::lock_guard stateGuard(mStateMutex);
+	if(mConnectState == connect_state::CONNECTING)
+	{
+		_step_connect();
+		return;
+	}
+
+	if(mConnectState == connect_state::CONNECTED && mPeer && mPeer->mPeerSocket != MBASE_INVALID_SOCKET)
+	{
+		if(mPeer->signal_disconnect())
+		{
+			mPeer->_destroy_peer();
+			return;
+		}
+		mPeer->_update_io();
+	}
+}
+
+GENERIC PcNetClient::_begin_connect(const mbase::vector<PcNetEndpoint>& in_endpoints, const mbase::string& in_addr, I32 in_port, U32 in_timeout_ms)
+{
+	mbase::lock_guard stateGuard(mStateMutex);
+	mEndpoints = in_endpoints;
+	mEndpointIndex = 0;
+	mAddr = in_addr;
+	mPort = in_port;
+	mConnectDeadline = pc_net_now_ms() + in_timeout_ms;
+	mAttemptDeadline = 0;
+	mIsTimedOut = false;
+	mConnectResult = flags::NET_CLIENT_SUCCESS;
+	mConnectSignal.reset_signal_with_state();
+	mConnectState = connect_state::CONNECTING;
+	if(mManager)
+	{
+		mManager->mIoWakeup->wake();
+	}
+}
+
+GENERIC PcNetClient::_attach_socket(socket_handle in_socket, const mbase::string& in_addr, I32 in_port)
+{
+	mbase::lock_guard stateGuard(mStateMutex);
+	mAddr = in_addr;
+	mPort = in_port;
+	mPeer = std::make_shared<PcNetPeerClient>(in_socket);
+	if(mManager)
+	{
+		mPeer->mIoWakeup = mManager->mIoWakeup;
+	}
+	mPeer->mPeerAddr = in_addr;
+	mPeer->mPeerPort = in_port;
+	mConnectResult = flags::NET_CLIENT_SUCCESS;
+	mConnectState = connect_state::CONNECTED;
+	mConnectSignal.set_signal();
+}
+
+typename PcNetClient::socket_handle PcNetClient::_detach_socket()
+{
+	// the caller holds mStateMutex so the I/O thread isn't using the socket
+	socket_handle detachedSocket = mPeer->mPeerSocket;
+	mPeer->mPeerSocket = MBASE_INVALID_SOCKET;
+	mPeer->_destroy_peer();
+	mPeer.reset();
+	mConnectState = connect_state::IDLE;
+	mConnectSignal.reset_signal_with_state();
+	return detachedSocket;
+}
+
+GENERIC PcNetClient::_close_pending_socket() noexcept
+{
+	if(mPendingSocket != MBASE_INVALID_SOCKET)
+	{
+		pc_net_close_socket(mPendingSocket);
+		mPendingSocket = MBASE_INVALID_SOCKET;
+	}
+}
+
+GENERIC PcNetClient::_step_connect()
+{
+	U64 currentTime = pc_net_now_ms();
+	while(true)
+	{
+		if(currentTime >= mConnectDeadline)
+		{
+			mIsTimedOut = true;
+		}
+
+		if(mPendingSocket == MBASE_INVALID_SOCKET)
+		{
+			if(mIsTimedOut || mEndpointIndex >= mEndpoints.size())
+			{
+				mConnectResult = mIsTimedOut ? flags::NET_CLIENT_ERR_TIMEOUT : flags::NET_CLIENT_ERR_CONNECTION_FAILED;
+				mConnectState = connect_state::FAILED;
+				mConnectSignal.set_signal();
+				return;
 			}
 
-			else if(!rResult)
+			const PcNetEndpoint& currentEndpoint = mEndpoints[mEndpointIndex++];
+			mPendingSocket = socket(currentEndpoint.mFamily, SOCK_STREAM, IPPROTO_TCP);
+			if(mPendingSocket == MBASE_INVALID_SOCKET)
 			{
-				netPeer->_destroy_peer();
-				It = mConnectedClientsProcessLoop.erase(It);
 				continue;
 			}
 
-			else
+			u_long ctlMode = 1;
+			#ifdef MBASE_PLATFORM_WINDOWS
+			ioctlsocket(mPendingSocket, FIONBIO, &ctlMode);
+			#endif
+			#ifdef MBASE_PLATFORM_UNIX
+			ioctl(mPendingSocket, FIONBIO, &ctlMode);
+			#endif
+
+			if(connect(mPendingSocket, reinterpret_cast<const struct sockaddr*>(currentEndpoint.mAddress), static_cast<socklen_t>(currentEndpoint.mLength)) != MBASE_SOCKET_ERROR)
+			{
+				break;
+			}
+
+			if(!pc_net_is_in_progress())
 			{
-				netPeer->mReadSignal.set_signal_state();
-				netPeer->mReadSignal.reset_signal();
-				netPeer->mNetPacket.mPacketContent.advance(rResult);
+				_close_pending_socket();
+				continue;
 			}
+
+			// an address that doesn't answer shouldn't use up the time of the ones after it
+			U64 remainingAttempts = mEndpoints.size() - mEndpointIndex + 1;
+			mAttemptDeadline = currentTime + (mConnectDeadline - currentTime) / remainingAttempts;
 		}
 
-		if(netPeer->signal_write())
+		#ifdef MBASE_PLATFORM_WINDOWS
+		WSAPOLLFD pollDescriptor = {0};
+		pollDescriptor.fd = mPendingSocket;
+		pollDescriptor.events = POLLOUT;
+		I32 pollResult = WSAPoll(&pollDescriptor, 1, 0);
+		#endif
+		#ifdef MBASE_PLATFORM_UNIX
+		struct pollfd pollDescriptor = {0};
+		pollDescriptor.fd = mPendingSocket;
+		pollDescriptor.events = POLLOUT;
+		I32 pollResult = poll(&pollDescriptor, 1, 0);
+		#endif
+
+		if(pollResult > 0)
 		{
-			I32 sResult = send(netPeer->mPeerSocket, netPeer->mNetPacket.mWriteBuffer.c_str(), static_cast<I32>(netPeer->mNetPacket.mWriteBuffer.size()), 0);
-			if(sResult == MBASE_SOCKET_ERROR)
+			I32 socketError = 0;
+			socklen_t errorLength = sizeof(socketError);
+			getsockopt(mPendingSocket, SOL_SOCKET, SO_ERROR, reinterpret_cast<char*>(&socketError), &errorLength);
+			if(!socketError)
 			{
-				#ifdef MBASE_PLATFORM_WINDOWS 
-				if (WSAGetLastError() != WSAEWOULDBLOCK)
-				{
-					// Something bad happened
-					netPeer->_destroy_peer();
-					It = mConnectedClientsProcessLoop.erase(It);
-					continue;
-				}
-				#endif
+				break;
+			}
+			_close_pending_socket();
+			continue;
+		}
 
-				#ifdef MBASE_PLATFORM_UNIX
-				if (errno != EWOULDBLOCK)
-				{
-					// Something bad happened
-					netPeer->_destroy_peer();
-					It = mConnectedClientsProcessLoop.erase(It);
-					continue;
-				}
-				#endif
+		if(pollResult < 0 || currentTime >= mAttemptDeadline || mIsTimedOut)
+		{
+			_close_pending_socket();
+			continue;
+		}
+		return;
+	}
+
+	mPeer = std::make_shared<PcNetPeerClient>(mPendingSocket);
+	if(mManager)
+	{
+		mPeer->mIoWakeup = mManager->mIoWakeup;
+	}
+	mPeer->mPeerAddr = mAddr;
+	mPeer->mPeerPort = mPort;
+	mPendingSocket = MBASE_INVALID_SOCKET;
+	mEndpoints.clear();
+	mConnectResult = flags::NET_CLIENT_SUCCESS;
+	mConnectState = connect_state::CONNECTED;
+	mConnectSignal.set_signal();
+}
+
+GENERIC PcNetClient::_collect_io(mbase::vector<PcNetIoInterest>& out_interests)
+{
+	mbase::lock_guard stateGuard(mStateMutex);
+	if(mConnectState == connect_state::CONNECTING && mPendingSocket != MBASE_INVALID_SOCKET)
+	{
+		out_interests.push_back({mPendingSocket, false, true});
+		return;
+	}
+
+	if(mConnectState == connect_state::CONNECTED && mPeer && mPeer->mPeerSocket != MBASE_INVALID_SOCKET)
+	{
+		bool isReading = mPeer->signal_read();
+		bool isWriting = mPeer->signal_write();
+		if(isReading || isWriting)
+		{
+			out_interests.push_back({mPeer->mPeerSocket, isReading, isWriting});
+		}
+	}
+}
+
+GENERIC PcNetClient::_release_watcher()
+{
+	if(!mManager)
+	{
+		return;
+	}
+
+	// the I/O thread iterates the clients under this lock
+	mManager->mClientReleaseLock.acquire();
+	if(mObjectWatcher)
+	{
+		mObjectWatcher->mSubject = NULL;
+		mObjectWatcher = NULL;
+	}
+	mManager->mClientReleaseLock.release();
+	mManager = NULL;
+}
+
+PcNetConnectionPool::PcNetConnectionPool(PcNetManager& in_manager, U32 in_max_idle_per_key, U32 in_idle_timeout_ms, U32 in_connect_timeout_ms) :
+	mManager(&in_manager),
+	mMaxIdlePerKey(in_max_idle_per_key),
+	mIdleTimeout(in_idle_timeout_ms),
+	mConnectTimeout(in_connect_timeout_ms)
+{
+}
+
+PcNetConnectionPool::~PcNetConnectionPool()
+{
+	clear();
+}
+
+MBASE_ND(MBASE_OBS_IGNORE) typename PcNetConnectionPool::size_type PcNetConnectionPool::get_idle_count() const noexcept
+{
+	size_type idleCount = 0;
+	for(auto& idleEntry : mIdleConnections)
+	{
+		idleCount += idleEntry.second.size();
+	}
+	return idleCount;
+}
+
+MBASE_ND(MBASE_OBS_IGNORE) typename PcNetConnectionPool::size_type PcNetConnectionPool::get_idle_count(const mbase::string& in_addr, I32 in_port) const noexcept
+{
+	auto idleIt = mIdleConnections.find(_make_key(in_addr, in_port));
+	if(idleIt == mIdleConnections.end())
+	{
+		return 0;
+	}
+	return idleIt->second.size();
+}
+
+PcNetConnectionPool::flags PcNetConnectionPool::acquire(const mbase::string& in_addr, I32 in_port, PcNetClient& out_client)
+{
+	if(out_client.mConnectState == PcNetClient::connect_state::CONNECTING || out_client.mConnectState == PcNetClient::connect_state::CONNECTED)
+	{
+		return flags::NET_POOL_ERR_CLIENT_BUSY;
+	}
+
+	auto idleIt = mIdleConnections.find(_make_key(in_addr, in_port));
+	if(idleIt != mIdleConnections.end())
+	{
+		idle_list& idleConnections = idleIt->second;
+		while(idleConnections.size())
+		{
+			// the most recently released one is the least likely to be closed by the peer
+			idle_connection idleConnection = idleConnections.back();
+			idleConnections.pop_back();
+			if(!_is_healthy(idleConnection.mSocket))
+			{
+				_close_socket(idleConnection.mSocket);
+				continue;
 			}
-			
-			else if(!sResult)
+
+			mManager->_register_client(out_client);
+			out_client._attach_socket(idleConnection.mSocket, in_addr, in_port);
+			return flags::NET_POOL_REUSED;
+		}
+	}
+
+	switch (mManager->create_connection(in_addr, in_port, out_client, mConnectTimeout))
+	{
+	case PcNetManager::flags::NET_MNG_SUCCESS:
+		return flags::NET_POOL_SUCCESS;
+	case PcNetManager::flags::NET_MNG_ERR_AWAITING_PREVIOUS_CONNECTION:
+		return flags::NET_POOL_ERR_CLIENT_BUSY;
+	default:
+		return flags::NET_POOL_ERR_HOST_NOT_FOUND;
+	}
+}
+
+PcNetConnectionPool::flags PcNetConnectionPool::release(PcNetClient& in_client)
+{
+	mbase::lock_guard stateGuard(in_client.mStateMutex);
+	if(in_client.mConnectState != PcNetClient::connect_state::CONNECTED || !in_client.mPeer || !in_client.mPeer->is_connected())
+	{
+		return flags::NET_POOL_ERR_NOT_CONNECTED;
+	}
+
+	if(in_client.mPeer->signal_write())
+	{
+		// the rest of the response would be lost with the client
+		return flags::NET_POOL_ERR_PENDING_WRITE;
+	}
+
+	mbase::string poolKey = _make_key(in_client.mAddr, in_client.mPort);
+	socket_handle releasedSocket = in_client._detach_socket();
+	idle_list& idleConnections = mIdleConnections[poolKey];
+	if(idleConnections.size() >= mMaxIdlePerKey || !_is_healthy(releasedSocket))
+	{
+		_close_socket(releasedSocket);
+		return flags::NET_POOL_SUCCESS;
+	}
+
+	idle_connection idleConnection;
+	idleConnection.mSocket = releasedSocket;
+	idleConnection.mIdleSince = pc_net_now_ms();
+	idleConnections.push_back(idleConnection);
+	return flags::NET_POOL_SUCCESS;
+}
+
+GENERIC PcNetConnectionPool::update()
+{
+	U64 currentTime = pc_net_now_ms();
+	for(auto& idleEntry : mIdleConnections)
+	{
+		idle_list& idleConnections = idleEntry.second;
+		size_type keptCount = 0;
+		for(size_type i = 0; i < idleConnections.size(); i++)
+		{
+			idle_connection& idleConnection = idleConnections[i];
+			if(currentTime - idleConnection.mIdleSince >= mIdleTimeout || !_is_healthy(idleConnection.mSocket))
 			{
-				netPeer->_destroy_peer();
-				It = mConnectedClientsProcessLoop.erase(It);
+				_close_socket(idleConnection.mSocket);
 				continue;
 			}
+			idleConnections[keptCount++] = idleConnection;
+		}
+
+		while(idleConnections.size() > keptCount)
+		{
+			idleConnections.pop_back();
+		}
+	}
+}
+
+GENERIC PcNetConnectionPool::clear()
+{
+	for(auto& idleEntry : mIdleConnections)
+	{
+		for(idle_connection& idleConnection : idleEntry.second)
+		{
+			_close_socket(idleConnection.mSocket);
+		}
+	}
+	mIdleConnections.clear();
+}
+
+mbase::string PcNetConnectionPool::_make_key(const mbase::string& in_addr, I32 in_port)
+{
+	return in_addr + mbase::string::from_format(":%d", in_port);
+}
+
+bool PcNetConnectionPool::_is_healthy(socket_handle in_socket) noexcept
+{
+	// the sockets are non-blocking, nothing to read is the only healthy answer for an idle connection
+	IBYTE peekByte = 0;
+	I32 peekResult = recv(in_socket, &peekByte, 1, MSG_PEEK);
+	if(peekResult != MBASE_SOCKET_ERROR)
+	{
+		return false;
+	}
+
+	#ifdef MBASE_PLATFORM_WINDOWS
+	return WSAGetLastError() == WSAEWOULDBLOCK;
+	#endif
+	#ifdef MBASE_PLATFORM_UNIX
+	return errno == EWOULDBLOCK || errno == EAGAIN;
+	#endif
+}
+
+GENERIC PcNetConnectionPool::_close_socket(socket_handle in_socket) noexcept
+{
+	pc_net_close_socket(in_socket);
+}
 
-			else
-			{
-				netPeer->mWriteSignal.reset_signal_with_state();
-				netPeer->mNetPacket.mWriteBuffer.clear();
-			}
-		}
-		++It;
+MBASE_ND(MBASE_OBS_IGNORE) typename PcNetHandoffQueue::size_type PcNetHandoffQueue::get_pending_count() noexcept
+{
+	mbase::lock_guard queueGuard(mQueueMutex);
+	return mEvents.size();
+}
+
+GENERIC PcNetHandoffQueue::post(event_type in_type, std::shared_ptr<PcNetPeerClient> in_peer, CBYTEBUFFER in_data, size_type in_size)
+{
+	handoff_event newEvent;
+	newEvent.mType = in_type;
+	newEvent.mPeer = std::move(in_peer);
+	if(in_data && in_size)
+	{
+		newEvent.mData = mbase::string(in_data, in_size);
 	}
+
+	mbase::lock_guard queueGuard(mQueueMutex);
+	mEvents.push_back(std::move(newEvent));
+}
+
+GENERIC PcNetHandoffQueue::take_all(event_list& out_events)
+{
+	out_events.clear();
+	mbase::lock_guard queueGuard(mQueueMutex);
+	std::swap(out_events, mEvents);
 }
 
-//PcNetManager::flags PcNetManager::create_connection(const mbase::string& in_addr, I32 in_port, PcNetClient& out_client)
-//{
-//	if(out_client.mConnectedClient.is_awaiting_connection())
-//	{
-//		return flags::NET_MNG_ERR_AWAITING_PREVIOUS_CONNECTION;
-//	}
-//
-//	if(out_client.mConnectedClient.is_connected())
-//	{
-//		out_client.on_disconnect();
-//		out_client.mConnectedClient._destroy_peer();
-//	}
-//
-//	SOCKET clientSocket = INVALID_SOCKET;
-//	struct addrinfo* result = NULL;
-//	struct addrinfo* ptr = NULL;
-//	struct addrinfo hints = { 0 };
-//
-//	hints.ai_family = AF_INET;
-//	hints.ai_socktype = SOCK_STREAM;
-//	hints.ai_protocol = IPPROTO_TCP;
-//
-//	out_client.mConnectedClient.mPeerAddr = in_addr;
-//	out_client.mConnectedClient.mPeerPort = in_port;
-//	out_client.mConnectedClient.mIsConnecting = true;
-//
-//	getaddrinfo(in_addr.data(), mbase::string::from_format("%d", in_port).data(), &hints, &result);
-//	for(ptr = result; ptr != NULL; ptr=ptr->ai_next)
-//	{
-//		clientSocket = socket(ptr->ai_family, ptr->ai_socktype, ptr->ai_protocol);
-//		if(clientSocket == INVALID_SOCKET)
-//		{
-//			out_client.mConnectedClient.mIsConnecting = false;
-//			return flags::NET_MNG_ERR_HOST_NOT_FOUND;
-//		}
-//
-//		int cnnResult = connect(clientSocket, ptr->ai_addr, ptr->ai_addrlen);
-//		if(cnnResult == SOCKET_ERROR)
-//		{
-//			closesocket(clientSocket);
-//			clientSocket = INVALID_SOCKET;
-//			continue;
-//		}
-//		break;
-//	}
-//
-//	if(clientSocket == INVALID_SOCKET)
-//	{
-//		out_client.mConnectedClient.mIsConnecting = false;
-//		return flags::NET_MNG_ERR_HOST_NOT_FOUND;
-//	}
-//
-//	out_client.mConnectedClient.mIsConnecting = false;
-//	u_long ctlMode = 1;
-//	ioctlsocket(clientSocket, FIONBIO, &ctlMode);
-//	
-//	out_client.mConnectedClient._set_new_socket_handle(clientSocket);
-//	out_client.on_connect(out_client.mConnectedClient);
-//
-//	return flags::NET_MNG_SUCCESS;
-//}
-
-PcNetManager::PcNetManager()
+PcNetManager::PcNetManager() : mIoWakeup(std::make_shared<PcNetIoWakeup>()), mProcessorCore(-1), mIsDispatchingOnIoThread(false)
 {
 }
 
 PcNetManager::~PcNetManager()
 {
+	// the I/O thread may be sleeping in poll
+	mIsProcessorRunning = false;
+	mIoWakeup->wake();
 	stop_processor();
 	for (servers_list::iterator It = mServers.begin(); It != mServers.end(); ++It)
 	{
 		if(It->mSubject)
 		{
-			It->mSubject->release_object_watcher();
+			PcNetServer* netServer = It->mSubject;
+			netServer->release_object_watcher();
+			netServer->mObjectWatcher = NULL; // the watcher goes with the list, a server outliving the manager must not touch it
 		}
 		
 	}
+
+	for (clients_list::iterator It = mClients.begin(); It != mClients.end(); ++It)
+	{
+		if(It->mSubject)
+		{
+			It->mSubject->mObjectWatcher = NULL;
+			It->mSubject->mManager = NULL;
+		}
+	}
+}
+
+PcNetManager::flags PcNetManager::create_connection(const mbase::string& in_addr, I32 in_port, PcNetClient& out_client, U32 in_timeout_ms)
+{
+	if(out_client.is_connecting())
+	{
+		return flags::NET_MNG_ERR_AWAITING_PREVIOUS_CONNECTION;
+	}
+
+	if(out_client.is_connected())
+	{
+		std::shared_ptr<PcNetPeerClient> previousPeer = out_client.get_peer();
+		out_client.mStateMutex.acquire();
+		out_client.mPeer.reset();
+		out_client.mConnectState = PcNetClient::connect_state::IDLE;
+		out_client.mStateMutex.release();
+		if(previousPeer)
+		{
+			previousPeer->_destroy_peer();
+			out_client.on_disconnect(previousPeer);
+		}
+	}
+
+	mbase::vector<PcNetEndpoint> resolvedEndpoints;
+	flags resolveResult = _resolve(in_addr, in_port, resolvedEndpoints);
+	if(resolveResult != flags::NET_MNG_SUCCESS)
+	{
+		return resolveResult;
+	}
+
+	_register_client(out_client);
+	out_client._begin_connect(resolvedEndpoints, in_addr, in_port, in_timeout_ms);
+	start_processor();
+
+	return flags::NET_MNG_SUCCESS;
 }
 
-PcNetManager::flags PcNetManager::create_server(const mbase::string& in_addr, I32 in_port, PcNetServer& out_server)
+PcNetManager::flags PcNetManager::create_server(const mbase::string& in_addr, I32 in_port, PcNetServer& out_server, bool in_reuse_port)
 {
 	#ifdef MBASE_PLATFORM_WINDOWS
 	SOCKET serverSocket = MBASE_INVALID_SOCKET;
@@ -675,6 +2079,23 @@ PcNetManager::flags PcNetManager::create_server(const mbase::string& in_addr, I3
 		return flags::NET_MNG_ERR_UNKNOWN;
 	}
 
+	if(in_reuse_port)
+	{
+		#ifdef SO_REUSEPORT
+		I32 reuseEnable = 1;
+		if(setsockopt(serverSocket, SOL_SOCKET, SO_REUSEPORT, reinterpret_cast<const char*>(&reuseEnable), sizeof(reuseEnable)) == MBASE_SOCKET_ERROR)
+		{
+			freeaddrinfo(result);
+			pc_net_close_socket(serverSocket);
+			return flags::NET_MNG_ERR_UNSUPPORTED;
+		}
+		#else
+		freeaddrinfo(result);
+		pc_net_close_socket(serverSocket);
+		return flags::NET_MNG_ERR_UNSUPPORTED;
+		#endif
+	}
+
 	iResult = bind(serverSocket, result->ai_addr, static_cast<I32>(result->ai_addrlen));
 	if (iResult == MBASE_SOCKET_ERROR) 
 	{
@@ -715,6 +2136,207 @@ PcNetManager::flags PcNetManager::create_server(const mbase::string& in_addr, I3
 	out_server.mRawSocket = serverSocket;
 	out_server.mAddr = in_addr;
 	out_server.mPort = in_port;
+	out_server.mIsLocal = false;
+	_register_server(out_server);
+
+	return flags::NET_MNG_SUCCESS;
+}
+
+PcNetManager::flags PcNetManager::create_local_server(const mbase::string& in_path, PcNetServer& out_server, U32 in_permissions)
+{
+	#ifdef MBASE_PLATFORM_WINDOWS
+	return flags::NET_MNG_ERR_UNSUPPORTED;
+	#endif
+
+	#ifdef MBASE_PLATFORM_UNIX
+	struct sockaddr_un localAddr = {0};
+	localAddr.sun_family = AF_UNIX;
+
+	const bool isAbstract = in_path.size() && in_path[0] == '@';
+	if(!in_path.size() || in_path.size() >= sizeof(localAddr.sun_path) || (isAbstract && in_path.size() == 1))
+	{
+		return flags::NET_MNG_ERR_INVALID_PATH;
+	}
+
+	socklen_t addrLength = 0;
+	if(isAbstract)
+	{
+		#ifdef MBASE_PLATFORM_APPLE
+		return flags::NET_MNG_ERR_UNSUPPORTED;
+		#else
+		// abstract names aren't null terminated, the length decides where they end
+		localAddr.sun_path[0] = '\0';
+		memcpy(localAddr.sun_path + 1, in_path.c_str() + 1, in_path.size() - 1);
+		addrLength = static_cast<socklen_t>(offsetof(struct sockaddr_un, sun_path) + in_path.size());
+		#endif
+	}
+	else
+	{
+		memcpy(localAddr.sun_path, in_path.c_str(), in_path.size());
+		addrLength = static_cast<socklen_t>(sizeof(localAddr));
+	}
+
+	I32 serverSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+	if(serverSocket == MBASE_INVALID_SOCKET)
+	{
+		return flags::NET_MNG_ERR_UNKNOWN;
+	}
+
+	if(!isAbstract)
+	{
+		struct stat pathStat;
+		if(!lstat(localAddr.sun_path, &pathStat))
+		{
+			if(!S_ISSOCK(pathStat.st_mode))
+			{
+				close(serverSocket);
+				return flags::NET_MNG_ERR_INVALID_PATH;
+			}
+
+			// the file stays behind when a server dies, it is only stale if nobody accepts on it
+			if(!connect(serverSocket, reinterpret_cast<struct sockaddr*>(&localAddr), addrLength))
+			{
+				close(serverSocket);
+				return flags::NET_MNG_ERR_ADDR_IN_USE;
+			}
+
+			if(errno != ECONNREFUSED)
+			{
+				close(serverSocket);
+				return flags::NET_MNG_ERR_UNKNOWN;
+			}
+
+			unlink(localAddr.sun_path);
+			close(serverSocket);
+			serverSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+			if(serverSocket == MBASE_INVALID_SOCKET)
+			{
+				return flags::NET_MNG_ERR_UNKNOWN;
+			}
+		}
+	}
+
+	if(bind(serverSocket, reinterpret_cast<struct sockaddr*>(&localAddr), addrLength) == MBASE_SOCKET_ERROR)
+	{
+		I32 bindError = errno;
+		close(serverSocket);
+		return bindError == EADDRINUSE ? flags::NET_MNG_ERR_ADDR_IN_USE : flags::NET_MNG_ERR_UNKNOWN;
+	}
+
+	if(!isAbstract && chmod(localAddr.sun_path, static_cast<mode_t>(in_permissions)) == -1)
+	{
+		unlink(localAddr.sun_path);
+		close(serverSocket);
+		return flags::NET_MNG_ERR_UNKNOWN;
+	}
+
+	if(::listen(serverSocket, SOMAXCONN) == MBASE_SOCKET_ERROR)
+	{
+		if(!isAbstract)
+		{
+			unlink(localAddr.sun_path);
+		}
+		close(serverSocket);
+		return flags::NET_MNG_ERR_UNKNOWN;
+	}
+
+	u_long ctlMode = 1;
+	ioctl(serverSocket, FIONBIO, &ctlMode);
+
+	out_server.mRawSocket = serverSocket;
+	out_server.mAddr = in_path;
+	out_server.mPort = 0;
+	out_server.mIsLocal = true;
+	_register_server(out_server);
+
+	return flags::NET_MNG_SUCCESS;
+	#endif
+}
+
+PcNetManager::flags PcNetManager::_resolve(const mbase::string& in_addr, I32 in_port, mbase::vector<PcNetEndpoint>& out_endpoints)
+{
+	struct addrinfo* result = NULL;
+	struct addrinfo hints = {0};
+
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	hints.ai_protocol = IPPROTO_TCP;
+	hints.ai_flags = AI_ADDRCONFIG;
+
+	mbase::string portString = mbase::string::from_format("%d", in_port);
+	if(getaddrinfo(in_addr.c_str(), portString.c_str(), &hints, &result))
+	{
+		return flags::NET_MNG_ERR_HOST_NOT_FOUND;
+	}
+
+	// the families alternate starting with the preferred one, so a broken IPv6 route
+	// delays the connection by one attempt instead of failing every address of it first
+	mbase::vector<PcNetEndpoint> firstFamily;
+	mbase::vector<PcNetEndpoint> otherFamily;
+	for(struct addrinfo* ptr = result; ptr != NULL; ptr = ptr->ai_next)
+	{
+		if(ptr->ai_addrlen > sizeof(PcNetEndpoint::mAddress))
+		{
+			continue;
+		}
+
+		PcNetEndpoint resolvedEndpoint;
+		resolvedEndpoint.mFamily = ptr->ai_family;
+		resolvedEndpoint.mLength = static_cast<U32>(ptr->ai_addrlen);
+		memcpy(resolvedEndpoint.mAddress, ptr->ai_addr, ptr->ai_addrlen);
+		if(ptr->ai_family == result->ai_family)
+		{
+			firstFamily.push_back(resolvedEndpoint);
+		}
+		else
+		{
+			otherFamily.push_back(resolvedEndpoint);
+		}
+	}
+	freeaddrinfo(result);
+
+	out_endpoints.clear();
+	for(SIZE_T i = 0; i < firstFamily.size() || i < otherFamily.size(); i++)
+	{
+		if(i < firstFamily.size())
+		{
+			out_endpoints.push_back(firstFamily[i]);
+		}
+		if(i < otherFamily.size())
+		{
+			out_endpoints.push_back(otherFamily[i]);
+		}
+	}
+
+	if(!out_endpoints.size())
+	{
+		return flags::NET_MNG_ERR_HOST_NOT_FOUND;
+	}
+	return flags::NET_MNG_SUCCESS;
+}
+
+GENERIC PcNetManager::_register_client(PcNetClient& out_client)
+{
+	if(out_client.mManager == this)
+	{
+		return;
+	}
+	out_client._release_watcher();
+
+	mClientReleaseLock.acquire();
+	mClients.push_back(client_watcher_type());
+	client_watcher_type& lastWatcher = mClients.back();
+	lastWatcher.mItSelf = mClients.end_node();
+	lastWatcher.mSubject = &out_client;
+	out_client.mObjectWatcher = &lastWatcher;
+	out_client.mManager = this;
+	mClientReleaseLock.release();
+	mIoWakeup->wake();
+	start_processor();
+}
+
+GENERIC PcNetManager::_register_server(PcNetServer& out_server)
+{
 	mServerReleaseLock.acquire();
 	
 	mServers.push_back(watcher_type());
@@ -722,11 +2344,21 @@ PcNetManager::flags PcNetManager::create_server(const mbase::string& in_addr, I3
 	lastWatcher.mItSelf = mServers.end_node();
 	lastWatcher.mSubject = &out_server;
 	out_server.acquire_object_watcher(&lastWatcher);
+	out_server.mIoWakeup = mIoWakeup;
 
 	mServerReleaseLock.release();
+	mIoWakeup->wake();
 	start_processor();
+}
 
-	return flags::NET_MNG_SUCCESS;
+GENERIC PcNetManager::set_processor_core(I32 in_core) noexcept
+{
+	mProcessorCore = in_core;
+}
+
+GENERIC PcNetManager::set_dispatch_on_io_thread(bool in_dispatch) noexcept
+{
+	mIsDispatchingOnIoThread = in_dispatch;
 }
 
 GENERIC PcNetManager::update()
@@ -742,22 +2374,199 @@ GENERIC PcNetManager::update()
 		}
 		++It;
 	}
+
+	mClientReleaseLock.acquire();
+	for (clients_list::iterator It = mClients.begin(); It != mClients.end();)
+	{
+		if(!It->mSubject)
+		{
+			It = mClients.erase(It);
+			continue;
+		}
+		++It;
+	}
+	mClientReleaseLock.release();
 }
 
 GENERIC PcNetManager::update_t()
 {
+	if(mProcessorCore >= 0)
+	{
+		#ifdef MBASE_PLATFORM_WINDOWS
+		if(mProcessorCore < 64)
+		{
+			SetThreadAffinityMask(GetCurrentThread(), static_cast<DWORD_PTR>(1) << mProcessorCore);
+		}
+		#elif defined(__linux__)
+		cpu_set_t processorSet;
+		CPU_ZERO(&processorSet);
+		CPU_SET(mProcessorCore, &processorSet);
+		pthread_setaffinity_np(pthread_self(), sizeof(processorSet), &processorSet);
+		#endif
+		// apple doesn't bind threads to cores, the scheduler decides
+	}
+
 	while(is_processor_running())
 	{
+		mIoInterests.clear();
 		mServerReleaseLock.acquire();
 		for (servers_list::iterator It = mServers.begin(); It != mServers.end(); ++It)
 		{
 			if(It->mSubject)
 			{
-				It->mSubject->update_t();
+				PcNetServer* netServer = It->mSubject;
+				for(PcNetServer::socket_handle& readyListener : mReadyListeners)
+				{
+					if(readyListener == netServer->mRawSocket)
+					{
+						netServer->mIsAcceptReady = true;
+					}
+				}
+				netServer->update_t();
+				if(mIsDispatchingOnIoThread)
+				{
+					netServer->update();
+				}
+				netServer->_collect_io(mIoInterests);
 			}
 			
 		}
 		mServerReleaseLock.release();
+
+		mClientReleaseLock.acquire();
+		for (clients_list::iterator It = mClients.begin(); It != mClients.end(); ++It)
+		{
+			if(It->mSubject)
+			{
+				It->mSubject->update_t();
+				if(mIsDispatchingOnIoThread)
+				{
+					It->mSubject->update();
+				}
+				It->mSubject->_collect_io(mIoInterests);
+			}
+		}
+		mClientReleaseLock.release();
+
+		_wait_io();
+	}
+}
+
+GENERIC PcNetManager::_wait_io()
+{
+	// the servers are matched by their listener after the poll, a server released meanwhile is never touched
+	mReadyListeners.clear();
+
+	#ifdef MBASE_PLATFORM_WINDOWS
+	mbase::vector<WSAPOLLFD> pollDescriptors;
+	#endif
+	#ifdef MBASE_PLATFORM_UNIX
+	mbase::vector<struct pollfd> pollDescriptors;
+	#endif
+
+	for(const PcNetIoInterest& ioInterest : mIoInterests)
+	{
+		pollDescriptors.push_back({});
+		pollDescriptors.back().fd = ioInterest.mSocket;
+		pollDescriptors.back().events = (ioInterest.mRead ? POLLIN : 0) | (ioInterest.mWrite ? POLLOUT : 0);
+	}
+
+	#ifdef MBASE_PLATFORM_WINDOWS
+	// nothing wakes a WSAPoll from another thread, the wait is kept short instead
+	I32 pollResult = 0;
+	if(pollDescriptors.size())
+	{
+		pollResult = WSAPoll(pollDescriptors.data(), static_cast<ULONG>(pollDescriptors.size()), 1);
+	}
+	else
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	#endif
+	#ifdef MBASE_PLATFORM_UNIX
+	pollDescriptors.push_back({});
+	pollDescriptors.back().fd = mIoWakeup->get_descriptor();
+	pollDescriptors.back().events = POLLIN;
+	I32 pollResult = poll(pollDescriptors.data(), static_cast<nfds_t>(pollDescriptors.size()), gNetMaxIoWaitMs);
+	#endif
+	mIoWakeup->drain();
+
+	if(pollResult <= 0)
+	{
+		return;
+	}
+
+	for(SIZE_T i = 0; i < mIoInterests.size(); i++)
+	{
+		if(mIoInterests[i].mRead && pollDescriptors[i].revents)
+		{
+			// matched against the listeners on the next loop, the peers just retry their I/O
+			mReadyListeners.push_back(mIoInterests[i].mSocket);
+		}
+	}
+}
+
+PcNetReactorGroup::PcNetReactorGroup(U32 in_shard_count, bool in_pin_to_cores)
+{
+	U32 coreCount = std::thread::hardware_concurrency();
+	if(!coreCount)
+	{
+		coreCount = 1;
+	}
+
+	if(!in_shard_count)
+	{
+		in_shard_count = coreCount;
+	}
+
+	for(U32 i = 0; i < in_shard_count; i++)
+	{
+		PcNetManager* shardManager = new PcNetManager;
+		shardManager->set_dispatch_on_io_thread(true);
+		if(in_pin_to_cores)
+		{
+			shardManager->set_processor_core(static_cast<I32>(i % coreCount));
+		}
+		mShards.push_back(shardManager);
+	}
+}
+
+PcNetReactorGroup::~PcNetReactorGroup()
+{
+	for(PcNetManager* shardManager : mShards)
+	{
+		delete shardManager;
+	}
+}
+
+MBASE_ND(MBASE_OBS_IGNORE) typename PcNetReactorGroup::size_type PcNetReactorGroup::get_shard_count() const noexcept
+{
+	return mShards.size();
+}
+
+MBASE_ND(MBASE_OBS_IGNORE) PcNetManager& PcNetReactorGroup::get_shard(size_type in_index)
+{
+	return *mShards[in_index];
+}
+
+PcNetManager::flags PcNetReactorGroup::create_server(const mbase::string& in_addr, I32 in_port, PcNetServer* const* in_servers)
+{
+	for(size_type i = 0; i < mShards.size(); i++)
+	{
+		PcNetManager::flags shardResult = mShards[i]->create_server(in_addr, in_port, *in_servers[i], true);
+		if(shardResult != PcNetManager::flags::NET_MNG_SUCCESS)
+		{
+			return shardResult;
+		}
+	}
+	return PcNetManager::flags::NET_MNG_SUCCESS;
+}
+
+GENERIC PcNetReactorGroup::update()
+{
+	for(PcNetManager* shardManager : mShards)
+	{
+		shardManager->update();
 	}
 }
 
@@ -1,12 +1,101 @@
 #include <mbase/pc/pc_stream_manager.h>
+#include <new>
+#include <thread>
+#include <cstring>
+
+#ifdef MBASE_PLATFORM_WINDOWS
+#include <Windows.h>
+#endif
+
+#ifdef MBASE_PLATFORM_UNIX
+#include <sys/mman.h>
+#endif
 
 MBASE_BEGIN
 
+// The head of a free list packs the buffer address with a push counter against ABA. Pooled buffers are
+// aligned to the smallest class, so the low 12 bits are free. On 64-bit targets user space addresses are
+// assumed to fit in 48 bits (x86-64 with 4-level paging, or 5-level paging without a high mmap hint, and
+// AArch64 with 48-bit VA), the upper 16 bits carry the rest of the counter. A buffer above that is not pooled.
+#if UINTPTR_MAX > 0xFFFFFFFFu
+static const U64 gStreamAddressMask = ((static_cast<U64>(1) << 48) - 1) & ~((static_cast<U64>(1) << gStreamMinClassShift) - 1);
+#else
+static const U64 gStreamAddressMask = static_cast<U64>(0xFFFFFFFFu) & ~((static_cast<U64>(1) << gStreamMinClassShift) - 1);
+#endif
+static const U64 gStreamTagMask = ~gStreamAddressMask;
+static const U32 gStreamThreadCacheDepth = 4;
+static const U32 gStreamThreadCacheMaxShift = 18; // 256KB, larger buffers always go through the shared free lists
+static const U32 gStreamTrimBatch = 64;
+
+static U64 pc_stream_next_tag(U64 in_head)
+{
+	// the address bits are set so that the carry of the low part goes on into the upper part
+	return ((in_head | gStreamAddressMask) + 1) & gStreamTagMask;
+}
+
+static U32 pc_stream_thread_cache_depth(U32 in_size_class)
+{
+	const U32 classShift = in_size_class + gStreamMinClassShift;
+	if(classShift > gStreamThreadCacheMaxShift)
+	{
+		return 0;
+	}
+	// a full cache holds less than 1MB per thread
+	return classShift <= 16 ? gStreamThreadCacheDepth : 1;
+}
+
+struct PcStreamManager::thread_cache {
+	IBYTEBUFFER mBuffers[gClassCount][gStreamThreadCacheDepth] = {};
+	U32 mCounts[gClassCount] = {};
+
+	~thread_cache()
+	{
+		// the shared pool is never destroyed, the buffers of an exiting thread go back to its free lists
+		PcStreamManager& sharedPool = PcStreamManager::get_shared();
+		for(U32 i = 0; i < gClassCount; i++)
+		{
+			while(mCounts[i])
+			{
+				sharedPool._push_free(i, mBuffers[i][--mCounts[i]]);
+			}
+		}
+	}
+};
+
+PcStreamManager::PcStreamManager(size_type in_high_watermark, bool in_huge_pages) :
+	mHighWatermark(in_high_watermark),
+	mIsHugePages(in_huge_pages)
+{
+}
+
+PcStreamManager::~PcStreamManager()
+{
+	trim();
+	for(deep_char_stream* tmpStream : mStreams)
+	{
+		delete tmpStream;
+	}
+}
+
+PcStreamManager& PcStreamManager::get_shared()
+{
+	// not destroyed at exit, threads that outlive the static destructors still flush their caches into it
+	static PcStreamManager* sharedPool = []() {
+		PcStreamManager* newPool = new PcStreamManager;
+		newPool->mIsThreadCached = true;
+		return newPool;
+	}();
+	return *sharedPool;
+}
+
 PcStreamManager::flags PcStreamManager::get_stream_by_handle(stream_handle& in_stream_handle, char_stream*& out_stream)
 {
-	// TODO: DO ERROR CHECK
-	out_stream = &mStreams[in_stream_handle];
+	if(in_stream_handle < 0 || static_cast<SIZE_T>(in_stream_handle) >= mStreams.size())
+	{
+		return flags::STREAM_ERR_INVALID_HANDLE;
+	}
 
+	out_stream = mStreams[in_stream_handle];
 	return flags::STREAM_MNG_SUCCESS;
 }
 
@@ -20,6 +109,28 @@ U32 PcStreamManager::get_stream_size()
 	return mStreamSize;
 }
 
+MBASE_ND(MBASE_OBS_IGNORE) PcStreamPoolStatistics PcStreamManager::get_statistics() const noexcept
+{
+	PcStreamPoolStatistics poolStatistics;
+	poolStatistics.mHits = mHits.load(std::memory_order_relaxed);
+	poolStatistics.mMisses = mMisses.load(std::memory_order_relaxed);
+	poolStatistics.mHugePageAllocations = mHugePageAllocations.load(std::memory_order_relaxed);
+	poolStatistics.mTrimmedBytes = mTrimmedBytes.load(std::memory_order_relaxed);
+	poolStatistics.mBytesResident = mBytesResident.load(std::memory_order_relaxed);
+	poolStatistics.mBytesInUse = mBytesInUse.load(std::memory_order_relaxed);
+	return poolStatistics;
+}
+
+MBASE_ND(MBASE_OBS_IGNORE) typename PcStreamManager::size_type PcStreamManager::get_high_watermark() const noexcept
+{
+	return mHighWatermark.load(std::memory_order_relaxed);
+}
+
+MBASE_ND(MBASE_OBS_IGNORE) bool PcStreamManager::is_huge_pages_enabled() const noexcept
+{
+	return mIsHugePages.load(std::memory_order_relaxed);
+}
+
 bool PcStreamManager::initialize(U32 in_stream_count, U32 in_stream_size)
 {
 	mStreamCount = in_stream_count;
@@ -35,16 +146,25 @@ bool PcStreamManager::initialize(U32 in_stream_count, U32 in_stream_size)
 		mStreamSize = gDefaultStreamSize;
 	}
 
-	mStreams = mbase::vector<deep_char_stream>(in_stream_count);
+	for(deep_char_stream* tmpStream : mStreams)
+	{
+		delete tmpStream;
+	}
+	mStreams.clear();
+	while(!mHandleStack.empty())
+	{
+		mHandleStack.pop();
+	}
 
+	mStreams.reserve(mStreamCount);
 	for (U32 i = 0; i < mStreamCount; i++)
 	{
-		mStreams.emplace_back(deep_char_stream(mStreamSize));
+		mStreams.push_back(new deep_char_stream(mStreamSize));
 	}
 
-	for (U32 i = mStreamCount - 1; i > 0; i--)
+	for (U32 i = mStreamCount; i-- > 0;)
 	{
-		mHandleStack.push(i);
+		mHandleStack.push(static_cast<I32>(i));
 	}
 
 	return true;
@@ -52,27 +172,23 @@ bool PcStreamManager::initialize(U32 in_stream_count, U32 in_stream_size)
 
 PcStreamManager::flags PcStreamManager::acquire_stream(stream_handle& out_stream_handle)
 {
-	if (mHandleStack.empty())
-	{
-		return flags::STREAM_ERR_STREAMS_ARE_FULL;
-	}
-	// TODO: DO ERROR CHECK
-	out_stream_handle = mHandleStack.top();
-	mHandleStack.pop();
-	mStreams[out_stream_handle].set_cursor_front();
-	return flags::STREAM_MNG_SUCCESS;
+	char_stream* acquiredStream = NULL;
+	return acquire_stream(out_stream_handle, acquiredStream);
 }
 
 PcStreamManager::flags PcStreamManager::acquire_stream(stream_handle& out_stream_handle, char_stream*& out_stream)
 {
 	if (mHandleStack.empty())
 	{
-		return flags::STREAM_ERR_STREAMS_ARE_FULL;
+		// every stream is taken, grow instead of failing the caller
+		mStreams.push_back(new deep_char_stream(mStreamSize));
+		mHandleStack.push(static_cast<I32>(mStreams.size() - 1));
+		++mStreamCount;
 	}
-	// TODO: DO ERROR CHECK
+
 	out_stream_handle = mHandleStack.top();
 	mHandleStack.pop();
-	out_stream = &mStreams[out_stream_handle];
+	out_stream = mStreams[out_stream_handle];
 	out_stream->set_cursor_front();
 
 	return flags::STREAM_MNG_SUCCESS;
@@ -80,8 +196,7 @@ PcStreamManager::flags PcStreamManager::acquire_stream(stream_handle& out_stream
 
 PcStreamManager::flags PcStreamManager::release_stream(stream_handle& in_stream_handle)
 {
-	// TODO: DO ERROR CHECK
-	if (in_stream_handle < 0)
+	if (in_stream_handle < 0 || static_cast<SIZE_T>(in_stream_handle) >= mStreams.size())
 	{
 		return flags::STREAM_ERR_INVALID_HANDLE;
 	}
@@ -90,4 +205,263 @@ PcStreamManager::flags PcStreamManager::release_stream(stream_handle& in_stream_
 	return flags::STREAM_MNG_SUCCESS;
 }
 
-MBASE_END
\ No newline at end of file
+IBYTEBUFFER PcStreamManager::acquire_buffer(size_type in_size, size_type& out_capacity)
+{
+	const U32 sizeClass = _get_size_class(in_size);
+	if(sizeClass == gClassCount)
+	{
+		mMisses.fetch_add(1, std::memory_order_relaxed);
+		IBYTEBUFFER largeBuffer = _allocate(in_size);
+		out_capacity = largeBuffer ? in_size : 0;
+		mBytesInUse.fetch_add(out_capacity, std::memory_order_relaxed);
+		return largeBuffer;
+	}
+
+	const size_type classCapacity = static_cast<size_type>(1) << (sizeClass + gStreamMinClassShift);
+	IBYTEBUFFER pooledBuffer = NULL;
+	if(mIsThreadCached && pc_stream_thread_cache_depth(sizeClass))
+	{
+		thread_cache& threadCache = _get_thread_cache();
+		if(threadCache.mCounts[sizeClass])
+		{
+			pooledBuffer = threadCache.mBuffers[sizeClass][--threadCache.mCounts[sizeClass]];
+		}
+	}
+
+	if(!pooledBuffer)
+	{
+		pooledBuffer = _pop_free(sizeClass);
+	}
+
+	if(pooledBuffer)
+	{
+		mHits.fetch_add(1, std::memory_order_relaxed);
+		mBytesResident.fetch_sub(classCapacity, std::memory_order_relaxed);
+	}
+	else
+	{
+		mMisses.fetch_add(1, std::memory_order_relaxed);
+		pooledBuffer = _allocate(classCapacity);
+		if(!pooledBuffer)
+		{
+			out_capacity = 0;
+			return NULL;
+		}
+	}
+
+	out_capacity = classCapacity;
+	mBytesInUse.fetch_add(classCapacity, std::memory_order_relaxed);
+	return pooledBuffer;
+}
+
+GENERIC PcStreamManager::release_buffer(IBYTEBUFFER in_buffer, size_type in_capacity) noexcept
+{
+	if(!in_buffer)
+	{
+		return;
+	}
+
+	mBytesInUse.fetch_sub(in_capacity, std::memory_order_relaxed);
+	const U32 sizeClass = _get_size_class(in_capacity);
+	const U64 bufferAddress = static_cast<U64>(reinterpret_cast<uintptr_t>(in_buffer));
+	if(sizeClass == gClassCount || (static_cast<size_type>(1) << (sizeClass + gStreamMinClassShift)) != in_capacity || (bufferAddress & gStreamTagMask))
+	{
+		_deallocate(in_buffer, in_capacity);
+		return;
+	}
+
+	mBytesResident.fetch_add(in_capacity, std::memory_order_relaxed);
+	const U32 cacheDepth = mIsThreadCached ? pc_stream_thread_cache_depth(sizeClass) : 0;
+	if(cacheDepth)
+	{
+		thread_cache& threadCache = _get_thread_cache();
+		if(threadCache.mCounts[sizeClass] < cacheDepth)
+		{
+			threadCache.mBuffers[sizeClass][threadCache.mCounts[sizeClass]++] = in_buffer;
+			return;
+		}
+	}
+
+	_push_free(sizeClass, in_buffer);
+	const size_type highWatermark = mHighWatermark.load(std::memory_order_relaxed);
+	if(mBytesResident.load(std::memory_order_relaxed) > highWatermark && !mIsTrimming.exchange(true))
+	{
+		trim(highWatermark / 2);
+		mIsTrimming.store(false);
+	}
+}
+
+GENERIC PcStreamManager::set_high_watermark(size_type in_bytes) noexcept
+{
+	mHighWatermark.store(in_bytes, std::memory_order_relaxed);
+}
+
+GENERIC PcStreamManager::set_huge_pages(bool in_state) noexcept
+{
+	mIsHugePages.store(in_state, std::memory_order_relaxed);
+}
+
+GENERIC PcStreamManager::trim(size_type in_target_bytes) noexcept
+{
+	IBYTEBUFFER trimmedBuffers[gStreamTrimBatch];
+	for(I32 sizeClass = static_cast<I32>(gClassCount) - 1; sizeClass >= 0; sizeClass--)
+	{
+		const size_type classCapacity = static_cast<size_type>(1) << (sizeClass + gStreamMinClassShift);
+		bool isClassEmpty = false;
+		while(!isClassEmpty && mBytesResident.load(std::memory_order_relaxed) > in_target_bytes)
+		{
+			U32 trimmedCount = 0;
+			while(trimmedCount < gStreamTrimBatch && mBytesResident.load(std::memory_order_relaxed) > in_target_bytes)
+			{
+				IBYTEBUFFER freeBuffer = _pop_free(sizeClass);
+				if(!freeBuffer)
+				{
+					isClassEmpty = true;
+					break;
+				}
+				mBytesResident.fetch_sub(classCapacity, std::memory_order_relaxed);
+				trimmedBuffers[trimmedCount++] = freeBuffer;
+			}
+
+			// a pop that loaded one of these as the list head may still read its link
+			while(mFreeLists[sizeClass].mPoppers.load())
+			{
+				std::this_thread::yield();
+			}
+
+			for(U32 i = 0; i < trimmedCount; i++)
+			{
+				_deallocate(trimmedBuffers[i], classCapacity);
+			}
+			mTrimmedBytes.fetch_add(trimmedCount * classCapacity, std::memory_order_relaxed);
+		}
+	}
+}
+
+PcStreamManager::thread_cache& PcStreamManager::_get_thread_cache() noexcept
+{
+	static thread_local thread_cache threadCache;
+	return threadCache;
+}
+
+U32 PcStreamManager::_get_size_class(size_type in_size) noexcept
+{
+	U32 sizeClass = 0;
+	while(sizeClass < gClassCount && (static_cast<size_type>(1) << (sizeClass + gStreamMinClassShift)) < in_size)
+	{
+		++sizeClass;
+	}
+	return sizeClass;
+}
+
+IBYTEBUFFER PcStreamManager::_allocate(size_type in_capacity) noexcept
+{
+	if(in_capacity < (static_cast<size_type>(1) << gStreamHugePageShift))
+	{
+		return static_cast<IBYTEBUFFER>(::operator new(in_capacity, std::align_val_t(static_cast<size_type>(1) << gStreamMinClassShift), std::nothrow));
+	}
+
+	const bool isHugePages = mIsHugePages.load(std::memory_order_relaxed);
+
+	#ifdef MBASE_PLATFORM_WINDOWS
+	if(isHugePages)
+	{
+		// needs the lock pages in memory privilege, falls back to regular pages without it
+		const SIZE_T largePageSize = GetLargePageMinimum();
+		if(largePageSize && !(in_capacity % largePageSize))
+		{
+			LPVOID mappedBuffer = VirtualAlloc(NULL, in_capacity, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+			if(mappedBuffer)
+			{
+				mHugePageAllocations.fetch_add(1, std::memory_order_relaxed);
+				return static_cast<IBYTEBUFFER>(mappedBuffer);
+			}
+		}
+	}
+	return static_cast<IBYTEBUFFER>(VirtualAlloc(NULL, in_capacity, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE));
+	#endif
+
+	#ifdef MBASE_PLATFORM_UNIX
+	#ifdef MAP_HUGETLB
+	if(isHugePages && !(in_capacity % (static_cast<size_type>(1) << gStreamHugePageShift)))
+	{
+		void* mappedBuffer = mmap(NULL, in_capacity, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+		if(mappedBuffer != MAP_FAILED)
+		{
+			mHugePageAllocations.fetch_add(1, std::memory_order_relaxed);
+			return static_cast<IBYTEBUFFER>(mappedBuffer);
+		}
+	}
+	#endif
+
+	void* mappedBuffer = mmap(NULL, in_capacity, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if(mappedBuffer == MAP_FAILED)
+	{
+		return NULL;
+	}
+
+	#ifdef MADV_HUGEPAGE
+	if(isHugePages)
+	{
+		// the hugetlb pool is empty or not configured, transparent huge pages may still back it
+		madvise(mappedBuffer, in_capacity, MADV_HUGEPAGE);
+	}
+	#endif
+	return static_cast<IBYTEBUFFER>(mappedBuffer);
+	#endif
+}
+
+GENERIC PcStreamManager::_deallocate(IBYTEBUFFER in_buffer, size_type in_capacity) noexcept
+{
+	if(in_capacity < (static_cast<size_type>(1) << gStreamHugePageShift))
+	{
+		::operator delete(in_buffer, std::align_val_t(static_cast<size_type>(1) << gStreamMinClassShift));
+		return;
+	}
+
+	#ifdef MBASE_PLATFORM_WINDOWS
+	VirtualFree(in_buffer, 0, MEM_RELEASE);
+	#endif
+
+	#ifdef MBASE_PLATFORM_UNIX
+	munmap(in_buffer, in_capacity);
+	#endif
+}
+
+IBYTEBUFFER PcStreamManager::_pop_free(U32 in_size_class) noexcept
+{
+	free_list& classList = mFreeLists[in_size_class];
+	classList.mPoppers.fetch_add(1);
+	U64 headValue = classList.mHead.load();
+	IBYTEBUFFER freeBuffer = NULL;
+	while((freeBuffer = reinterpret_cast<IBYTEBUFFER>(static_cast<uintptr_t>(headValue & gStreamAddressMask))) != NULL)
+	{
+		// the link is in the first bytes of the free buffer, if another thread took it
+		// meanwhile this reads garbage and the tag makes the exchange fail
+		U64 nextValue = 0;
+		memcpy(&nextValue, freeBuffer, sizeof(nextValue));
+		const U64 newHead = (nextValue & gStreamAddressMask) | pc_stream_next_tag(headValue);
+		if(classList.mHead.compare_exchange_weak(headValue, newHead))
+		{
+			break;
+		}
+	}
+	classList.mPoppers.fetch_sub(1);
+	return freeBuffer;
+}
+
+GENERIC PcStreamManager::_push_free(U32 in_size_class, IBYTEBUFFER in_buffer) noexcept
+{
+	free_list& classList = mFreeLists[in_size_class];
+	const U64 bufferAddress = static_cast<U64>(reinterpret_cast<uintptr_t>(in_buffer));
+	U64 headValue = classList.mHead.load(std::memory_order_relaxed);
+	U64 newHead = 0;
+	do
+	{
+		const U64 nextValue = headValue & gStreamAddressMask;
+		memcpy(in_buffer, &nextValue, sizeof(nextValue));
+		newHead = bufferAddress | pc_stream_next_tag(headValue);
+	} while(!classList.mHead.compare_exchange_weak(headValue, newHead));
+}
+
+MBASE_END
@@ -1,2 +1,16 @@
-from ._core import get_sys_name_total, cosine_similarity
-__all__ = ["get_sys_name_total", "cosine_similarity"]
+from ._core import (
+    get_sys_name_total,
+    cosine_similarity,
+    cosine_similarity_batch,
+    top_k_similarity,
+    Embedder,
+    FloatArray,
+)
+__all__ = [
+    "get_sys_name_total",
+    "cosine_similarity",
+    "cosine_similarity_batch",
+    "top_k_similarity",
+    "Embedder",
+    "FloatArray",
+]
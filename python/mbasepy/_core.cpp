@@ -1,6 +1,625 @@
+#define PY_SSIZE_T_CLEAN
 #include <Python.h>
 #include <mbase/inference/inf_common.h>
+#include <mbase/inference/inf_t2t_model.h>
+#include <mbase/inference/inf_embedder.h>
+#include <mbase/inference/inf_embedder_client.h>
 #include <vector>
+#include <algorithm>
+#include <functional>
+#include <cmath>
+#include <cstring>
+#include <chrono>
+#include <mutex>
+
+/* ===== FLOAT VIEW BEGIN ===== */
+
+// Read-only row major float32 view over a Python object.
+// Objects exporting the buffer protocol as C-contiguous float32 (NumPy arrays, array('f'), memoryview)
+// are viewed in place. float64 buffers are converted once without creating Python objects,
+// plain sequences and the buffers that can't be viewed (strided, integer ...) take the element-wise path.
+struct float_view {
+    Py_buffer mBuffer;
+    bool mHasBuffer = false;
+    std::vector<float> mOwned;
+    const float* mData = nullptr;
+    Py_ssize_t mRows = 0;
+    Py_ssize_t mCols = 0;
+
+    float_view() { std::memset(&mBuffer, 0, sizeof(mBuffer)); }
+    float_view(const float_view&) = delete;
+    float_view& operator=(const float_view&) = delete;
+    ~float_view() { reset(); }
+
+    void reset() {
+        if (mHasBuffer) {
+            PyBuffer_Release(&mBuffer);
+            mHasBuffer = false;
+        }
+        mOwned.clear();
+        mData = nullptr;
+        mRows = 0;
+        mCols = 0;
+    }
+};
+
+static char buffer_format_code(const char* in_format) {
+    if (!in_format) {
+        return 'B';
+    }
+    // native, little or big endian markers are all fine for same-host buffers
+    if (*in_format == '@' || *in_format == '=' || *in_format == '<' || *in_format == '>' || *in_format == '!') {
+        ++in_format;
+    }
+    if (in_format[0] && !in_format[1]) {
+        return in_format[0];
+    }
+    return '\0';
+}
+
+static bool acquire_float_buffer(PyObject* in_obj, float_view& out_view, bool in_writable) {
+    int bufferFlags = PyBUF_C_CONTIGUOUS | PyBUF_FORMAT;
+    if (in_writable) {
+        bufferFlags |= PyBUF_WRITABLE;
+    }
+    if (PyObject_GetBuffer(in_obj, &out_view.mBuffer, bufferFlags) != 0) {
+        return false;
+    }
+    out_view.mHasBuffer = true;
+
+    Py_buffer& buf = out_view.mBuffer;
+    if (buf.ndim == 0 || buf.ndim > 2) {
+        PyErr_SetString(PyExc_ValueError, "buffer must be one or two dimensional");
+        return false;
+    }
+    out_view.mRows = buf.ndim == 2 ? buf.shape[0] : 1;
+    out_view.mCols = buf.ndim == 2 ? buf.shape[1] : buf.shape[0];
+
+    char formatCode = buffer_format_code(buf.format);
+    if (formatCode == 'f' && buf.itemsize == sizeof(float)) {
+        out_view.mData = static_cast<const float*>(buf.buf);
+        return true;
+    }
+    if (!in_writable && formatCode == 'd' && buf.itemsize == sizeof(double)) {
+        Py_ssize_t elementCount = out_view.mRows * out_view.mCols;
+        const double* srcData = static_cast<const double*>(buf.buf);
+        out_view.mOwned.resize(elementCount);
+        for (Py_ssize_t i = 0; i < elementCount; ++i) {
+            out_view.mOwned[i] = static_cast<float>(srcData[i]);
+        }
+        out_view.mData = out_view.mOwned.data();
+        return true;
+    }
+    PyErr_SetString(PyExc_TypeError, in_writable ? "output buffer must be float32" : "buffer must be float32 or float64");
+    return false;
+}
+
+static bool acquire_float_sequence(PyObject* in_obj, float_view& out_view) {
+    PyObject* outerSeq = PySequence_Fast(in_obj, "argument must be a float buffer or a sequence");
+    if (!outerSeq) {
+        return false;
+    }
+    Py_ssize_t outerLength = PySequence_Fast_GET_SIZE(outerSeq);
+    PyObject** outerItems = PySequence_Fast_ITEMS(outerSeq);
+    bool isMatrix = outerLength && PySequence_Check(outerItems[0]) && !PyUnicode_Check(outerItems[0]);
+
+    if (!isMatrix) {
+        out_view.mRows = 1;
+        out_view.mCols = outerLength;
+        out_view.mOwned.resize(outerLength);
+        for (Py_ssize_t i = 0; i < outerLength; ++i) {
+            out_view.mOwned[i] = static_cast<float>(PyFloat_AsDouble(outerItems[i]));
+        }
+    }
+    else {
+        out_view.mRows = outerLength;
+        for (Py_ssize_t i = 0; i < outerLength; ++i) {
+            PyObject* rowSeq = PySequence_Fast(outerItems[i], "matrix rows must be sequences");
+            if (!rowSeq) {
+                Py_DECREF(outerSeq);
+                return false;
+            }
+            Py_ssize_t rowLength = PySequence_Fast_GET_SIZE(rowSeq);
+            if (i == 0) {
+                out_view.mCols = rowLength;
+                out_view.mOwned.reserve(outerLength * rowLength);
+            }
+            else if (rowLength != out_view.mCols) {
+                Py_DECREF(rowSeq);
+                Py_DECREF(outerSeq);
+                PyErr_SetString(PyExc_ValueError, "matrix rows must have the same length");
+                return false;
+            }
+            PyObject** rowItems = PySequence_Fast_ITEMS(rowSeq);
+            for (Py_ssize_t j = 0; j < rowLength; ++j) {
+                out_view.mOwned.push_back(static_cast<float>(PyFloat_AsDouble(rowItems[j])));
+            }
+            Py_DECREF(rowSeq);
+        }
+    }
+    Py_DECREF(outerSeq);
+    if (PyErr_Occurred()) {
+        return false;
+    }
+    out_view.mData = out_view.mOwned.data();
+    return true;
+}
+
+static bool acquire_float_view(PyObject* in_obj, float_view& out_view) {
+    if (PyObject_CheckBuffer(in_obj)) {
+        if (acquire_float_buffer(in_obj, out_view, false)) {
+            return true;
+        }
+        if (PyErr_ExceptionMatches(PyExc_MemoryError)) {
+            return false;
+        }
+        // not viewable in place, convert it element by element like a list
+        PyErr_Clear();
+        out_view.reset();
+    }
+    return acquire_float_sequence(in_obj, out_view);
+}
+
+/* ===== FLOAT VIEW END ===== */
+
+/* ===== FLOAT ARRAY TYPE BEGIN ===== */
+
+// Owning float32 array returned to Python. It exports the buffer protocol,
+// so numpy.asarray(result) or memoryview(result) wraps the same memory without a copy.
+typedef struct {
+    PyObject_HEAD
+    float* mData;
+    Py_ssize_t mShape[2];
+    Py_ssize_t mStrides[2];
+    int mNdim;
+} FloatArrayObject;
+
+static PyTypeObject FloatArrayType = { PyVarObject_HEAD_INIT(NULL, 0) };
+
+static FloatArrayObject* float_array_new(Py_ssize_t in_rows, Py_ssize_t in_cols, int in_ndim) {
+    FloatArrayObject* self = PyObject_New(FloatArrayObject, &FloatArrayType);
+    if (!self) {
+        return NULL;
+    }
+    Py_ssize_t elementCount = in_rows * in_cols;
+    self->mData = NULL;
+    self->mData = static_cast<float*>(PyMem_Calloc(elementCount ? elementCount : 1, sizeof(float)));
+    if (!self->mData) {
+        Py_DECREF(self);
+        PyErr_NoMemory();
+        return NULL;
+    }
+    self->mNdim = in_ndim;
+    if (in_ndim == 1) {
+        self->mShape[0] = in_cols;
+        self->mStrides[0] = sizeof(float);
+    }
+    else {
+        self->mShape[0] = in_rows;
+        self->mShape[1] = in_cols;
+        self->mStrides[0] = in_cols * sizeof(float);
+        self->mStrides[1] = sizeof(float);
+    }
+    return self;
+}
+
+static void float_array_dealloc(FloatArrayObject* self) {
+    PyMem_Free(self->mData);
+    PyObject_Del(self);
+}
+
+static int float_array_getbuffer(FloatArrayObject* self, Py_buffer* view, int flags) {
+    Py_ssize_t elementCount = self->mNdim == 1 ? self->mShape[0] : self->mShape[0] * self->mShape[1];
+    view->obj = reinterpret_cast<PyObject*>(self);
+    Py_INCREF(self);
+    view->buf = self->mData;
+    view->len = elementCount * sizeof(float);
+    view->readonly = 0;
+    view->itemsize = sizeof(float);
+    view->format = (flags & PyBUF_FORMAT) ? const_cast<char*>("f") : NULL;
+    view->ndim = self->mNdim;
+    view->shape = (flags & PyBUF_ND) == PyBUF_ND ? self->mShape : NULL;
+    view->strides = (flags & PyBUF_STRIDES) == PyBUF_STRIDES ? self->mStrides : NULL;
+    view->suboffsets = NULL;
+    view->internal = NULL;
+    return 0;
+}
+
+static Py_ssize_t float_array_length(FloatArrayObject* self) {
+    return self->mShape[0];
+}
+
+static PyObject* float_array_get_shape(FloatArrayObject* self, void*) {
+    if (self->mNdim == 1) {
+        return Py_BuildValue("(n)", self->mShape[0]);
+    }
+    return Py_BuildValue("(nn)", self->mShape[0], self->mShape[1]);
+}
+
+static PyObject* float_array_tolist(FloatArrayObject* self, PyObject*) {
+    Py_ssize_t rowCount = self->mNdim == 1 ? 1 : self->mShape[0];
+    Py_ssize_t colCount = self->mNdim == 1 ? self->mShape[0] : self->mShape[1];
+    PyObject* outerList = self->mNdim == 1 ? NULL : PyList_New(rowCount);
+    if (self->mNdim != 1 && !outerList) {
+        return NULL;
+    }
+    for (Py_ssize_t i = 0; i < rowCount; ++i) {
+        PyObject* rowList = PyList_New(colCount);
+        if (!rowList) {
+            Py_XDECREF(outerList);
+            return NULL;
+        }
+        for (Py_ssize_t j = 0; j < colCount; ++j) {
+            PyList_SET_ITEM(rowList, j, PyFloat_FromDouble(self->mData[i * colCount + j]));
+        }
+        if (!outerList) {
+            return rowList;
+        }
+        PyList_SET_ITEM(outerList, i, rowList);
+    }
+    return outerList;
+}
+
+static PyBufferProcs FloatArrayBufferProcs = {
+    (getbufferproc)float_array_getbuffer,
+    NULL
+};
+
+static PySequenceMethods FloatArraySequenceMethods = {
+    (lenfunc)float_array_length
+};
+
+static PyGetSetDef FloatArrayGetSet[] = {
+    {"shape", (getter)float_array_get_shape, NULL, "Array shape", NULL},
+    {NULL, NULL, NULL, NULL, NULL}
+};
+
+static PyMethodDef FloatArrayMethods[] = {
+    {"tolist", (PyCFunction)float_array_tolist, METH_NOARGS, "Copy the array into Python lists"},
+    {NULL, NULL, 0, NULL}
+};
+
+/* ===== FLOAT ARRAY TYPE END ===== */
+
+/* ===== SIMILARITY BEGIN ===== */
+
+// Scores every row of the matrix against the query with the dispatched SIMD kernels of inf_common.
+// If the inputs are known to be unit length, the norms are skipped and the score is the dot product.
+static void score_rows(const float_view& in_query, const float_view& in_matrix, bool in_normalized, float* out_scores) {
+    mbase::inf_common_cosine_similarity_batch(
+        const_cast<mbase::PTRF32>(in_query.mData),
+        const_cast<mbase::PTRF32>(in_matrix.mData),
+        static_cast<mbase::SIZE_T>(in_matrix.mRows),
+        static_cast<mbase::SIZE_T>(in_matrix.mCols),
+        out_scores,
+        in_normalized
+    );
+}
+
+static bool acquire_query_and_matrix(PyObject* in_query, PyObject* in_matrix, float_view& out_query, float_view& out_matrix) {
+    if (!acquire_float_view(in_query, out_query) || !acquire_float_view(in_matrix, out_matrix)) {
+        return false;
+    }
+    if (out_query.mRows != 1) {
+        PyErr_SetString(PyExc_ValueError, "query must be a single vector");
+        return false;
+    }
+    if (out_query.mCols != out_matrix.mCols) {
+        PyErr_SetString(PyExc_ValueError, "query and matrix rows must be same length");
+        return false;
+    }
+    return true;
+}
+
+/* ===== SIMILARITY END ===== */
+
+/* ===== EMBEDDER BEGIN ===== */
+
+class PyEmbedderModel : public mbase::InfModelTextToText {
+public:
+    void on_initialize_fail(init_fail_code) override {}
+    void on_initialize() override {}
+    void on_destroy() override {}
+};
+
+class PyEmbedderProcessor : public mbase::InfEmbedderProcessor {
+public:
+    bool mIsInitFailed = false;
+    bool mIsDestroyed = false;
+    void on_initialize_fail(last_fail_code) override { mIsInitFailed = true; }
+    void on_initialize() override {}
+    void on_destroy() override { mIsDestroyed = true; }
+};
+
+// Writes each generated embedding straight into the row of the destination buffer,
+// which is either the returned FloatArray or the caller supplied output array.
+class PyEmbedderClient : public mbase::InfClientEmbedder {
+public:
+    float* mDestination = nullptr; // null once the caller gave up on the input, its rows are dropped
+    bool mNormalize = true;
+    bool mIsFinished = true;
+    bool mIsUnregistered = false;
+
+    void on_register(mbase::InfProcessorBase*) override { mIsUnregistered = false; }
+    void on_unregister(mbase::InfProcessorBase*) override { mIsUnregistered = true; }
+    void on_batch_processed(mbase::InfEmbedderProcessor* out_processor, const mbase::U32&) override
+    {
+        out_processor->next();
+    }
+    void on_write(mbase::InfEmbedderProcessor* out_processor, mbase::PTRF32 out_embeddings, const mbase::U32& out_cursor, bool) override
+    {
+        if (!mDestination) {
+            return;
+        }
+        mbase::U32 embeddingLength = out_processor->get_embedding_length();
+        float* rowDestination = mDestination + static_cast<mbase::SIZE_T>(out_cursor) * embeddingLength;
+        if (mNormalize) {
+            mbase::inf_common_embd_normalize(out_embeddings, rowDestination, embeddingLength);
+        }
+        else {
+            std::memcpy(rowDestination, out_embeddings, embeddingLength * sizeof(float));
+        }
+    }
+    void on_finish(mbase::InfEmbedderProcessor*, const mbase::SIZE_T&) override
+    {
+        mIsFinished = true;
+    }
+};
+
+typedef struct {
+    PyObject_HEAD
+    PyEmbedderModel* mModel;
+    PyEmbedderProcessor* mProcessor;
+    PyEmbedderClient* mClient;
+    std::mutex* mMutex; // the client holds the state of one embed call, concurrent calls run one at a time
+    double mTimeout;
+} EmbedderObject;
+
+static PyTypeObject EmbedderType = { PyVarObject_HEAD_INIT(NULL, 0) };
+
+static void embedder_release(EmbedderObject* self) {
+    if (self->mProcessor) {
+        self->mProcessor->destroy_sync();
+        self->mProcessor->update();
+    }
+    if (self->mModel) {
+        self->mModel->destroy_sync();
+        self->mModel->update();
+    }
+    delete self->mClient;
+    delete self->mProcessor;
+    delete self->mModel;
+    self->mClient = NULL;
+    self->mProcessor = NULL;
+    self->mModel = NULL;
+}
+
+static PyObject* embedder_new(PyTypeObject* type, PyObject*, PyObject*) {
+    EmbedderObject* self = reinterpret_cast<EmbedderObject*>(type->tp_alloc(type, 0));
+    if (self) {
+        self->mModel = NULL;
+        self->mProcessor = NULL;
+        self->mClient = NULL;
+        self->mMutex = new std::mutex();
+        self->mTimeout = 0.0;
+    }
+    return reinterpret_cast<PyObject*>(self);
+}
+
+// Drives the processor until the running input finishes. Returns NULL, or the error and its exception type
+// if the processor stopped or the timeout (seconds, <= 0 waits as long as the processor runs) passed.
+static const char* embedder_wait_finish(EmbedderObject* self, double in_timeout, PyObject*& out_error_type) {
+    PyEmbedderClient* embedderClient = self->mClient;
+    std::chrono::steady_clock::time_point waitDeadline = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(in_timeout));
+    while (!embedderClient->mIsFinished) {
+        if (self->mProcessor->mIsDestroyed || !self->mProcessor->is_registered() || embedderClient->mIsUnregistered) {
+            out_error_type = PyExc_RuntimeError;
+            return "the embedder processor has stopped";
+        }
+        if (in_timeout > 0.0 && std::chrono::steady_clock::now() >= waitDeadline) {
+            out_error_type = PyExc_TimeoutError;
+            return "timed out waiting for the embedding";
+        }
+        self->mProcessor->update();
+        // the embedding is computed on the processor thread, its callbacks are dispatched by the update above
+        mbase::sleep(1);
+    }
+    return NULL;
+}
+
+static int embedder_init(EmbedderObject* self, PyObject* args, PyObject* kwargs) {
+    static const char* keywords[] = {"model_path", "context_length", "thread_count", "gpu_layers", "timeout", NULL};
+    const char* modelPath = NULL;
+    unsigned int contextLength = 0;
+    unsigned int threadCount = 8;
+    int gpuLayers = 999;
+    double waitTimeout = 300.0;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "s|IIid", const_cast<char**>(keywords), &modelPath, &contextLength, &threadCount, &gpuLayers, &waitTimeout))
+        return -1;
+
+    const char* errorMessage = NULL;
+    Py_BEGIN_ALLOW_THREADS
+    std::lock_guard<std::mutex> embedderLock(*self->mMutex);
+    embedder_release(self);
+    self->mModel = new PyEmbedderModel();
+    self->mProcessor = new PyEmbedderProcessor();
+    self->mClient = new PyEmbedderClient();
+    self->mTimeout = waitTimeout;
+
+    mbase::U32 totalContext = contextLength ? contextLength : 32000;
+    self->mModel->initialize_model_sync(mbase::from_utf8(modelPath), totalContext, gpuLayers);
+    self->mModel->update();
+    if (!self->mModel->is_initialized()) {
+        errorMessage = "unable to load the model";
+    }
+    else if (!self->mModel->is_embedding_model()) {
+        errorMessage = "model is not an embedding model";
+    }
+    else {
+        mbase::U32 processorContext = contextLength ? contextLength : std::min(self->mModel->get_max_embedding_context(), totalContext);
+        if (self->mModel->register_context_process(self->mProcessor, processorContext, threadCount) != mbase::InfModelTextToText::flags::INF_MODEL_INFO_REGISTERING_PROCESSOR) {
+            errorMessage = "unable to register the embedder context";
+        }
+        else {
+            while (!self->mProcessor->is_registered() && !self->mProcessor->mIsInitFailed) {
+                self->mProcessor->update();
+                mbase::sleep(2);
+            }
+            if (self->mProcessor->mIsInitFailed) {
+                errorMessage = "unable to create the embedder context";
+            }
+            else {
+                self->mProcessor->set_inference_client(self->mClient);
+            }
+        }
+    }
+    Py_END_ALLOW_THREADS
+
+    if (errorMessage) {
+        Py_BEGIN_ALLOW_THREADS
+        std::lock_guard<std::mutex> embedderLock(*self->mMutex);
+        embedder_release(self);
+        Py_END_ALLOW_THREADS
+        PyErr_SetString(PyExc_RuntimeError, errorMessage);
+        return -1;
+    }
+    return 0;
+}
+
+static void embedder_dealloc(EmbedderObject* self) {
+    embedder_release(self);
+    delete self->mMutex;
+    Py_TYPE(self)->tp_free(reinterpret_cast<PyObject*>(self));
+}
+
+static PyObject* embedder_get_embedding_length(EmbedderObject* self, void*) {
+    if (!self->mProcessor) {
+        return PyLong_FromLong(0);
+    }
+    return PyLong_FromUnsignedLong(self->mProcessor->get_embedding_length());
+}
+
+static PyObject* embedder_embed(EmbedderObject* self, PyObject* args, PyObject* kwargs) {
+    static const char* keywords[] = {"texts", "normalize", "out", NULL};
+    PyObject* textList = NULL;
+    int shouldNormalize = 1;
+    PyObject* outObject = Py_None;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|pO", const_cast<char**>(keywords), &textList, &shouldNormalize, &outObject))
+        return NULL;
+
+    if (!self->mProcessor || !self->mProcessor->is_registered()) {
+        PyErr_SetString(PyExc_RuntimeError, "embedder is not initialized");
+        return NULL;
+    }
+
+    PyObject* textSeq = PySequence_Fast(textList, "texts must be a sequence of str or bytes");
+    if (!textSeq) {
+        return NULL;
+    }
+
+    Py_ssize_t textCount = PySequence_Fast_GET_SIZE(textSeq);
+    std::vector<mbase::string> documentList;
+    documentList.reserve(textCount);
+    for (Py_ssize_t i = 0; i < textCount; ++i) {
+        PyObject* textItem = PySequence_Fast_GET_ITEM(textSeq, i);
+        const char* textData = NULL;
+        Py_ssize_t textLength = 0;
+        if (PyUnicode_Check(textItem)) {
+            textData = PyUnicode_AsUTF8AndSize(textItem, &textLength);
+        }
+        else if (PyBytes_Check(textItem)) {
+            PyBytes_AsStringAndSize(textItem, const_cast<char**>(&textData), &textLength);
+        }
+        else {
+            PyErr_SetString(PyExc_TypeError, "texts must be a sequence of str or bytes");
+        }
+        if (!textData) {
+            Py_DECREF(textSeq);
+            return NULL;
+        }
+        documentList.emplace_back(textData, static_cast<mbase::SIZE_T>(textLength));
+    }
+    Py_DECREF(textSeq);
+
+    Py_ssize_t embeddingLength = self->mProcessor->get_embedding_length();
+    float_view outView;
+    PyObject* resultObject = NULL;
+    float* destinationData = NULL;
+    if (outObject != Py_None) {
+        if (!acquire_float_buffer(outObject, outView, true)) {
+            return NULL;
+        }
+        if (outView.mRows * outView.mCols != textCount * embeddingLength) {
+            PyErr_SetString(PyExc_ValueError, "output buffer must hold len(texts) x embedding_length floats");
+            return NULL;
+        }
+        destinationData = const_cast<float*>(outView.mData);
+        resultObject = outObject;
+        Py_INCREF(resultObject);
+    }
+    else {
+        FloatArrayObject* resultArray = float_array_new(textCount, embeddingLength, 2);
+        if (!resultArray) {
+            return NULL;
+        }
+        destinationData = resultArray->mData;
+        resultObject = reinterpret_cast<PyObject*>(resultArray);
+    }
+
+    const char* errorMessage = NULL;
+    PyObject* errorType = PyExc_RuntimeError;
+    Py_BEGIN_ALLOW_THREADS
+    std::lock_guard<std::mutex> embedderLock(*self->mMutex);
+    PyEmbedderClient* embedderClient = self->mClient;
+    if (!embedderClient) {
+        errorMessage = "embedder is not initialized";
+    }
+    else {
+        // an input of a call that timed out may still be running
+        errorMessage = embedder_wait_finish(self, self->mTimeout, errorType);
+    }
+    for (Py_ssize_t i = 0; i < textCount && !errorMessage; ++i) {
+        embedderClient->mNormalize = shouldNormalize != 0;
+        mbase::inf_text_token_vector tokenVector;
+        if (self->mProcessor->tokenize_input(documentList[i], tokenVector) != mbase::InfEmbedderProcessor::flags::INF_PROC_SUCCESS) {
+            errorMessage = "unable to tokenize the input";
+            break;
+        }
+        embedderClient->mDestination = destinationData + i * embeddingLength;
+        embedderClient->mIsFinished = false;
+        if (self->mProcessor->execute_input({tokenVector}) != mbase::InfEmbedderProcessor::flags::INF_PROC_SUCCESS) {
+            embedderClient->mIsFinished = true;
+            errorMessage = "unable to execute the input, it may exceed the embedder context length";
+            break;
+        }
+        errorMessage = embedder_wait_finish(self, self->mTimeout, errorType);
+    }
+    if (errorMessage && embedderClient) {
+        // the destination is released below, late rows of an unfinished input must not land in it
+        embedderClient->mDestination = nullptr;
+    }
+    Py_END_ALLOW_THREADS
+
+    if (errorMessage) {
+        Py_DECREF(resultObject);
+        PyErr_SetString(errorType, errorMessage);
+        return NULL;
+    }
+    return resultObject;
+}
+
+static PyGetSetDef EmbedderGetSet[] = {
+    {"embedding_length", (getter)embedder_get_embedding_length, NULL, "Length of a single embedding vector", NULL},
+    {NULL, NULL, NULL, NULL, NULL}
+};
+
+static PyMethodDef EmbedderMethods[] = {
+    {"embed", (PyCFunction)(void(*)(void))embedder_embed, METH_VARARGS | METH_KEYWORDS,
+        "embed(texts, normalize=True, out=None) -> len(texts) x embedding_length float32 array"},
+    {NULL, NULL, 0, NULL}
+};
+
+/* ===== EMBEDDER END ===== */
 
 static PyObject* py_get_sys_name_total(PyObject*, PyObject*) {
     mbase::string result = mbase::inf_get_sys_name_total();
@@ -11,38 +630,92 @@ static PyObject* py_cosine_similarity(PyObject*, PyObject* args) {
     PyObject* list1; PyObject* list2;
     if (!PyArg_ParseTuple(args, "OO", &list1, &list2))
         return NULL;
-    if (!PySequence_Check(list1) || !PySequence_Check(list2)) {
-        PyErr_SetString(PyExc_TypeError, "arguments must be sequences");
+    float_view v1, v2;
+    if (!acquire_float_view(list1, v1) || !acquire_float_view(list2, v2))
         return NULL;
-    }
-    Py_ssize_t len1 = PySequence_Size(list1);
-    Py_ssize_t len2 = PySequence_Size(list2);
-    if (len1 != len2) {
+    if (v1.mRows * v1.mCols != v2.mRows * v2.mCols) {
         PyErr_SetString(PyExc_ValueError, "vectors must be same length");
         return NULL;
     }
-    std::vector<float> v1(len1), v2(len2);
-    for (Py_ssize_t i = 0; i < len1; ++i) {
-        PyObject* item1 = PySequence_GetItem(list1, i);
-        PyObject* item2 = PySequence_GetItem(list2, i);
-        if (!item1 || !item2) {
-            Py_XDECREF(item1);
-            Py_XDECREF(item2);
-            PyErr_SetString(PyExc_RuntimeError, "invalid sequence element");
+    float res = mbase::inf_common_cosine_similarity(const_cast<mbase::PTRF32>(v1.mData), const_cast<mbase::PTRF32>(v2.mData), (int)(v1.mRows * v1.mCols));
+    return PyFloat_FromDouble(res);
+}
+
+static PyObject* py_cosine_similarity_batch(PyObject*, PyObject* args, PyObject* kwargs) {
+    static const char* keywords[] = {"query", "matrix", "normalized", NULL};
+    PyObject* queryObject; PyObject* matrixObject;
+    int isNormalized = 0;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "OO|p", const_cast<char**>(keywords), &queryObject, &matrixObject, &isNormalized))
+        return NULL;
+    float_view queryView, matrixView;
+    if (!acquire_query_and_matrix(queryObject, matrixObject, queryView, matrixView))
+        return NULL;
+    FloatArrayObject* scoreArray = float_array_new(1, matrixView.mRows, 1);
+    if (!scoreArray)
+        return NULL;
+    Py_BEGIN_ALLOW_THREADS
+    score_rows(queryView, matrixView, isNormalized != 0, scoreArray->mData);
+    Py_END_ALLOW_THREADS
+    return reinterpret_cast<PyObject*>(scoreArray);
+}
+
+static PyObject* py_top_k_similarity(PyObject*, PyObject* args, PyObject* kwargs) {
+    static const char* keywords[] = {"query", "matrix", "k", "normalized", NULL};
+    PyObject* queryObject; PyObject* matrixObject;
+    Py_ssize_t topK = 10;
+    int isNormalized = 0;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "OO|np", const_cast<char**>(keywords), &queryObject, &matrixObject, &topK, &isNormalized))
+        return NULL;
+    if (topK <= 0) {
+        PyErr_SetString(PyExc_ValueError, "k must be positive");
+        return NULL;
+    }
+    float_view queryView, matrixView;
+    if (!acquire_query_and_matrix(queryObject, matrixObject, queryView, matrixView))
+        return NULL;
+
+    using scored_row = std::pair<float, Py_ssize_t>;
+    std::vector<float> scoreList(matrixView.mRows);
+    std::vector<scored_row> bestRows;
+    Py_BEGIN_ALLOW_THREADS
+    score_rows(queryView, matrixView, isNormalized != 0, scoreList.data());
+    // bounded min-heap keeps the selection O(N log k) instead of sorting every row
+    bestRows.reserve(std::min(topK, matrixView.mRows));
+    for (Py_ssize_t i = 0; i < matrixView.mRows; ++i) {
+        if ((Py_ssize_t)bestRows.size() < topK) {
+            bestRows.emplace_back(scoreList[i], i);
+            std::push_heap(bestRows.begin(), bestRows.end(), std::greater<scored_row>());
+        }
+        else if (scoreList[i] > bestRows.front().first) {
+            std::pop_heap(bestRows.begin(), bestRows.end(), std::greater<scored_row>());
+            bestRows.back() = scored_row(scoreList[i], i);
+            std::push_heap(bestRows.begin(), bestRows.end(), std::greater<scored_row>());
+        }
+    }
+    std::sort_heap(bestRows.begin(), bestRows.end(), std::greater<scored_row>());
+    Py_END_ALLOW_THREADS
+
+    PyObject* resultList = PyList_New(bestRows.size());
+    if (!resultList)
+        return NULL;
+    for (size_t i = 0; i < bestRows.size(); ++i) {
+        PyObject* resultPair = Py_BuildValue("(nd)", bestRows[i].second, (double)bestRows[i].first);
+        if (!resultPair) {
+            Py_DECREF(resultList);
             return NULL;
         }
-        v1[i] = static_cast<float>(PyFloat_AsDouble(item1));
-        v2[i] = static_cast<float>(PyFloat_AsDouble(item2));
-        Py_DECREF(item1);
-        Py_DECREF(item2);
+        PyList_SET_ITEM(resultList, i, resultPair);
     }
-    float res = mbase::inf_common_cosine_similarity(v1.data(), v2.data(), (int)len1);
-    return PyFloat_FromDouble(res);
+    return resultList;
 }
 
 static PyMethodDef Methods[] = {
     {"get_sys_name_total", py_get_sys_name_total, METH_NOARGS, "Return library name"},
     {"cosine_similarity", py_cosine_similarity, METH_VARARGS, "Compute cosine similarity"},
+    {"cosine_similarity_batch", (PyCFunction)(void(*)(void))py_cosine_similarity_batch, METH_VARARGS | METH_KEYWORDS,
+        "cosine_similarity_batch(query, matrix, normalized=False) -> float32 array of N scores"},
+    {"top_k_similarity", (PyCFunction)(void(*)(void))py_top_k_similarity, METH_VARARGS | METH_KEYWORDS,
+        "top_k_similarity(query, matrix, k=10, normalized=False) -> [(row_index, score), ...] best first"},
     {NULL, NULL, 0, NULL}
 };
 
@@ -56,5 +729,44 @@ static struct PyModuleDef moduledef = {
 };
 
 PyMODINIT_FUNC PyInit__core(void) {
-    return PyModule_Create(&moduledef);
+    FloatArrayType.tp_name = "mbasepy._core.FloatArray";
+    FloatArrayType.tp_basicsize = sizeof(FloatArrayObject);
+    FloatArrayType.tp_flags = Py_TPFLAGS_DEFAULT;
+    FloatArrayType.tp_doc = "float32 array exporting the buffer protocol";
+    FloatArrayType.tp_dealloc = (destructor)float_array_dealloc;
+    FloatArrayType.tp_as_buffer = &FloatArrayBufferProcs;
+    FloatArrayType.tp_as_sequence = &FloatArraySequenceMethods;
+    FloatArrayType.tp_getset = FloatArrayGetSet;
+    FloatArrayType.tp_methods = FloatArrayMethods;
+    if (PyType_Ready(&FloatArrayType) < 0)
+        return NULL;
+
+    EmbedderType.tp_name = "mbasepy._core.Embedder";
+    EmbedderType.tp_basicsize = sizeof(EmbedderObject);
+    EmbedderType.tp_flags = Py_TPFLAGS_DEFAULT;
+    EmbedderType.tp_doc = "Embedder(model_path, context_length=0, thread_count=8, gpu_layers=999)";
+    EmbedderType.tp_new = embedder_new;
+    EmbedderType.tp_init = (initproc)embedder_init;
+    EmbedderType.tp_dealloc = (destructor)embedder_dealloc;
+    EmbedderType.tp_getset = EmbedderGetSet;
+    EmbedderType.tp_methods = EmbedderMethods;
+    if (PyType_Ready(&EmbedderType) < 0)
+        return NULL;
+
+    PyObject* module = PyModule_Create(&moduledef);
+    if (!module)
+        return NULL;
+    Py_INCREF(&FloatArrayType);
+    if (PyModule_AddObject(module, "FloatArray", reinterpret_cast<PyObject*>(&FloatArrayType)) < 0) {
+        Py_DECREF(&FloatArrayType);
+        Py_DECREF(module);
+        return NULL;
+    }
+    Py_INCREF(&EmbedderType);
+    if (PyModule_AddObject(module, "Embedder", reinterpret_cast<PyObject*>(&EmbedderType)) < 0) {
+        Py_DECREF(&EmbedderType);
+        Py_DECREF(module);
+        return NULL;
+    }
+    return module;
 }
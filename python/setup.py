@@ -1,18 +1,36 @@
 from setuptools import setup, Extension
 from pathlib import Path
+import os
 import sys
 
 # Simple setuptools build using Python C API
+#
+# The embedder bindings link against the MBASE inference library.
+# Point MBASE_LIBRARY_DIR to the directory containing mb_inference (the CMake build directory by default)
+# and MBASE_LLAMA_INCLUDE_DIRS to the llama.cpp headers if they are not in the bundled submodule.
 
-mbase_include = Path(__file__).resolve().parent.parent / 'include'
+repo_root = Path(__file__).resolve().parent.parent
+mbase_include = repo_root / 'include'
+llama_include = [
+    str(repo_root / 'llama.cpp' / 'include'),
+    str(repo_root / 'llama.cpp' / 'ggml' / 'include'),
+]
+extra_llama_include = os.environ.get('MBASE_LLAMA_INCLUDE_DIRS')
+if extra_llama_include:
+    llama_include = extra_llama_include.split(os.pathsep) + llama_include
+
+mbase_library_dir = os.environ.get('MBASE_LIBRARY_DIR', str(repo_root / 'build'))
 
 ext = Extension(
     'mbasepy._core',
     sources=['mbasepy/_core.cpp'],
-    include_dirs=[str(mbase_include)],
+    include_dirs=[str(mbase_include)] + llama_include,
+    library_dirs=[mbase_library_dir],
+    libraries=['mb_inference'],
+    runtime_library_dirs=[] if sys.platform == 'win32' else [mbase_library_dir],
     language='c++',
     extra_compile_args=(
-        ['/std:c++17'] if sys.platform == 'win32' else ['-std=c++17']
+        ['/std:c++17', '/O2'] if sys.platform == 'win32' else ['-std=c++17', '-O3']
     )
 )
 